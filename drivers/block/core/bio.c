@@ -0,0 +1,499 @@
+/*
+ *
+ *      bio.c
+ *      Asynchronous block request layer (bio, request queues, plugging)
+ *
+ *      2026/10/17 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <arch/common.h>
+#include <arch/smp.h>
+#include <drivers/block/core/bio.h>
+#include <drivers/block/core/blockdev.h>
+#include <kernel/errno.h>
+#include <kernel/printk.h>
+#include <libs/std/string.h>
+#include <mem/alloc.h>
+#include <process/kthread.h>
+#include <process/sched.h>
+#include <process/task.h>
+#include <sync/spin_lock.h>
+
+/*
+ * Overview
+ * A bio describes one transfer over a scatter-gather vector.  Submitted bios
+ * are collected on the current task's plug, or on the request queue of their
+ * backing disk, where a bio (or plugged request) touching the end or start of
+ * a pending request of the same direction is chained onto it.  kblockd
+ * workers pull requests off the queues, issue each one to the driver as a
+ * single transfer and complete every chained bio.  Before the workers run
+ * (early boot, interrupts off) the submitter dispatches inline instead.
+ */
+
+/* Request queue of one backing disk */
+typedef struct blk_queue {
+        uint8_t  used;
+        uint8_t  ops_id;
+        uint8_t  drive;
+        void    *backend_data;
+        bio_t   *head; // pending requests, oldest first
+        bio_t   *tail;
+} blk_queue_t;
+
+static blk_queue_t  blk_queues[BLK_MAX_QUEUES];
+static spinlock_t   blk_lock;
+static uint32_t     blk_pending;    // requests queued, protected by blk_lock
+static uint32_t     blk_next_queue; // round-robin fetch cursor
+static wait_queue_t blk_worker_wait;
+static wait_queue_t blk_wait_table[BLK_WAIT_HASH];
+static uint32_t     blk_workers_running;
+static bool         blk_initialised;
+
+static const char *const blk_worker_names[BLK_MAX_WORKERS] = {"kblockd/0", "kblockd/1", "kblockd/2", "kblockd/3"};
+
+/* Hashed wait queue for bios waited on without a callback. */
+static wait_queue_t *blk_bio_waitqueue(const bio_t *bio)
+{
+    return &blk_wait_table[((uintptr_t)bio >> 6) % BLK_WAIT_HASH];
+}
+
+/* Whether kblockd can be relied on to dispatch, so the caller may sleep. */
+static bool blk_workers_usable(void)
+{
+    if (!__atomic_load_n(&blk_workers_running, __ATOMIC_ACQUIRE) || !__atomic_load_n(&scheduler.started, __ATOMIC_ACQUIRE)) return false;
+    return (get_rflags() & (1ULL << 9)) != 0;
+}
+
+/* Initialise a bio for op at lba; vecs are appended with bio_add_vec(). */
+void bio_init(bio_t *bio, const blockdev_device_t *device, bio_op_t op, uint64_t lba)
+{
+    memset(bio, 0, sizeof(*bio));
+    if (device) bio->device = *device;
+    bio->op       = (uint8_t)op;
+    bio->lba      = lba;
+    bio->vecs     = bio->inline_vecs;
+    bio->max_vecs = BIO_INLINE_VECS;
+}
+
+/* Append a segment; len must be a multiple of the sector size. */
+int bio_add_vec(bio_t *bio, void *base, uint32_t len)
+{
+    if (!bio || !base || !len || !bio->device.sector_size || len % bio->device.sector_size) return -EINVAL;
+
+    if (bio->nvec == bio->max_vecs) {
+        uint32_t   max_vecs = bio->max_vecs * 2;
+        bio_vec_t *vecs     = malloc(sizeof(bio_vec_t) * max_vecs);
+        if (!vecs) return -ENOMEM;
+        memcpy(vecs, bio->vecs, sizeof(bio_vec_t) * bio->nvec);
+        if (bio->vecs != bio->inline_vecs) free(bio->vecs);
+        bio->vecs     = vecs;
+        bio->max_vecs = max_vecs;
+    }
+    bio->vecs[bio->nvec].base = base;
+    bio->vecs[bio->nvec].len  = len;
+    bio->nvec++;
+    bio->sectors += len / bio->device.sector_size;
+    return EOK;
+}
+
+/* Free a heap-grown vector table. */
+void bio_release_vecs(bio_t *bio)
+{
+    if (!bio || bio->vecs == bio->inline_vecs) return;
+    free(bio->vecs);
+    bio->vecs     = bio->inline_vecs;
+    bio->max_vecs = BIO_INLINE_VECS;
+    bio->nvec     = 0;
+}
+
+/* Complete every bio chained in a request with the same status. */
+static void blk_complete(bio_t *rq, int status)
+{
+    bio_t *bio = rq;
+
+    while (bio) {
+        bio_t *next  = bio->bi_next;
+        bio->bi_next = NULL;
+        bio->rq_next = NULL;
+        bio->rq_tail = NULL;
+        bio->status  = status;
+        if (bio->end_io) {
+            bio->end_io(bio);
+        } else {
+            /* The waiter may free the bio as soon as done is visible. */
+            wait_queue_t *queue = blk_bio_waitqueue(bio);
+            __atomic_store_n(&bio->done, 1, __ATOMIC_RELEASE);
+            (void)wait_queue_wake_all(queue);
+        }
+        bio = next;
+    }
+}
+
+/* Hand one contiguous buffer to the driver. */
+static int blk_transfer(const blockdev_device_t *device, uint8_t op, uint64_t lba, uint32_t count, void *buffer)
+{
+    if (op == BIO_WRITE) return blk_ops(device, write_sectors)(device, lba, count, buffer);
+    return blk_ops(device, read_sectors)(device, lba, count, buffer);
+}
+
+/* Issue a request segment by segment; used when no bounce buffer is available. */
+static int blk_transfer_vectors(bio_t *rq)
+{
+    uint64_t lba = rq->lba;
+
+    for (bio_t *bio = rq; bio; bio = bio->bi_next) {
+        for (uint32_t i = 0; i < bio->nvec; i++) {
+            uint32_t count  = bio->vecs[i].len / rq->device.sector_size;
+            int      status = blk_transfer(&rq->device, rq->op, lba, count, bio->vecs[i].base);
+            if (status != EOK) return status;
+            lba += count;
+        }
+    }
+    return EOK;
+}
+
+/* Issue one request to its driver as a single transfer and complete its bios. */
+static void blk_execute(bio_t *rq)
+{
+    size_t   bytes      = (size_t)rq->rq_sectors * rq->device.sector_size;
+    uint8_t *expect     = rq->vecs[0].base;
+    bool     contiguous = true;
+    int      status;
+
+    for (bio_t *bio = rq; bio && contiguous; bio = bio->bi_next) {
+        for (uint32_t i = 0; i < bio->nvec; i++) {
+            if (bio->vecs[i].base != expect) {
+                contiguous = false;
+                break;
+            }
+            expect += bio->vecs[i].len;
+        }
+    }
+
+    if (contiguous) {
+        status = blk_transfer(&rq->device, rq->op, rq->lba, rq->rq_sectors, rq->vecs[0].base);
+        blk_complete(rq, status);
+        return;
+    }
+
+    /* Gather scattered segments so the driver still sees one command. */
+    uint8_t *bounce = malloc(bytes);
+    if (!bounce) {
+        blk_complete(rq, blk_transfer_vectors(rq));
+        return;
+    }
+
+    size_t offset = 0;
+    if (rq->op == BIO_WRITE) {
+        for (bio_t *bio = rq; bio; bio = bio->bi_next) {
+            for (uint32_t i = 0; i < bio->nvec; i++) {
+                memcpy(bounce + offset, bio->vecs[i].base, bio->vecs[i].len);
+                offset += bio->vecs[i].len;
+            }
+        }
+    }
+    status = blk_transfer(&rq->device, rq->op, rq->lba, rq->rq_sectors, bounce);
+    if (status == EOK && rq->op == BIO_READ) {
+        for (bio_t *bio = rq; bio; bio = bio->bi_next) {
+            for (uint32_t i = 0; i < bio->nvec; i++) {
+                memcpy(bio->vecs[i].base, bounce + offset, bio->vecs[i].len);
+                offset += bio->vecs[i].len;
+            }
+        }
+    }
+    free(bounce);
+    blk_complete(rq, status);
+}
+
+/* Whether two descriptors address the same backing disk through the same view. */
+static bool blk_same_view(const blockdev_device_t *a, const blockdev_device_t *b)
+{
+    return a->ops_id == b->ops_id && a->backend_data == b->backend_data && a->drive == b->drive && a->base_lba == b->base_lba && a->sector_size == b->sector_size;
+}
+
+/* Merge request next into request rq when they are contiguous; returns the merged head or NULL. */
+static bio_t *blk_try_merge(bio_t *rq, bio_t *next)
+{
+    if (rq->op != next->op || !blk_same_view(&rq->device, &next->device)) return NULL;
+    if ((uint64_t)rq->rq_sectors + next->rq_sectors > BLK_MAX_REQUEST_SIZE / rq->device.sector_size) return NULL;
+
+    /* Back merge: next continues rq */
+    if (rq->lba + rq->rq_sectors == next->lba) {
+        rq->rq_tail->bi_next = next;
+        rq->rq_tail          = next->rq_tail;
+        rq->rq_sectors += next->rq_sectors;
+        return rq;
+    }
+
+    /* Front merge: next ends where rq starts and takes over its list position */
+    if (next->lba + next->rq_sectors == rq->lba) {
+        next->rq_tail->bi_next = rq;
+        next->rq_tail          = rq->rq_tail;
+        next->rq_next          = rq->rq_next;
+        next->rq_sectors += rq->rq_sectors;
+        return next;
+    }
+    return NULL;
+}
+
+/* Append a request to a list, merging it into a contiguous one when possible. Returns true on merge. */
+static bool blk_list_add(bio_t **head, bio_t **tail, bio_t *rq)
+{
+    bio_t *prev = NULL;
+
+    for (bio_t *it = *head; it; prev = it, it = it->rq_next) {
+        bio_t *merged = blk_try_merge(it, rq);
+        if (!merged) continue;
+        if (merged != it) {
+            if (prev)
+                prev->rq_next = merged;
+            else
+                *head = merged;
+            if (*tail == it) *tail = merged;
+        }
+        return true;
+    }
+
+    rq->rq_next = NULL;
+    if (*tail)
+        (*tail)->rq_next = rq;
+    else
+        *head = rq;
+    *tail = rq;
+    return false;
+}
+
+/* Find (or create) the queue of a backing disk; caller holds blk_lock. */
+static blk_queue_t *blk_queue_lookup(const blockdev_device_t *device)
+{
+    blk_queue_t *free_slot = NULL;
+
+    for (uint32_t i = 0; i < BLK_MAX_QUEUES; i++) {
+        blk_queue_t *q = &blk_queues[i];
+        if (!q->used) {
+            if (!free_slot) free_slot = q;
+            continue;
+        }
+        if (q->ops_id == device->ops_id && q->backend_data == device->backend_data && q->drive == device->drive) return q;
+    }
+    if (free_slot) {
+        free_slot->used         = 1;
+        free_slot->ops_id       = device->ops_id;
+        free_slot->backend_data = device->backend_data;
+        free_slot->drive        = device->drive;
+    }
+    return free_slot;
+}
+
+/* Remove the oldest pending request, rotating across queues. */
+static bio_t *blk_fetch(void)
+{
+    spin_lock(&blk_lock);
+    for (uint32_t i = 0; i < BLK_MAX_QUEUES; i++) {
+        uint32_t     index = (blk_next_queue + i) % BLK_MAX_QUEUES;
+        blk_queue_t *q     = &blk_queues[index];
+        if (!q->head) continue;
+
+        bio_t *rq = q->head;
+        q->head   = rq->rq_next;
+        if (!q->head) q->tail = NULL;
+        rq->rq_next    = NULL;
+        blk_next_queue = (index + 1) % BLK_MAX_QUEUES;
+        blk_pending--;
+        spin_unlock(&blk_lock);
+        return rq;
+    }
+    spin_unlock(&blk_lock);
+    return NULL;
+}
+
+/* Put a request on its disk queue; a full queue table falls back to direct issue. */
+static void blk_queue_insert(bio_t *rq)
+{
+    spin_lock(&blk_lock);
+    blk_queue_t *q = blk_queue_lookup(&rq->device);
+    if (!q) {
+        spin_unlock(&blk_lock);
+        blk_execute(rq);
+        return;
+    }
+    if (!blk_list_add(&q->head, &q->tail, rq)) blk_pending++;
+    spin_unlock(&blk_lock);
+}
+
+/* Get queued requests moving: wake kblockd, or dispatch inline when it cannot run yet. */
+static void blk_kick(void)
+{
+    if (blk_workers_usable()) {
+        (void)wait_queue_wake_one(&blk_worker_wait);
+        return;
+    }
+
+    bio_t *rq;
+    while ((rq = blk_fetch())) blk_execute(rq);
+}
+
+/* Move every plugged request onto its disk queue. */
+static void blk_flush_plug(blk_plug_t *plug)
+{
+    bio_t *rq = plug->head;
+
+    plug->head  = NULL;
+    plug->tail  = NULL;
+    plug->count = 0;
+    if (!rq) return;
+
+    while (rq) {
+        bio_t *next = rq->rq_next;
+        blk_queue_insert(rq);
+        rq = next;
+    }
+    blk_kick();
+}
+
+/* Queue a bio. It completes asynchronously through end_io or bio_wait(). */
+void bio_submit(bio_t *bio)
+{
+    if (!bio) return;
+
+    bio->status     = EOK;
+    bio->done       = 0;
+    bio->bi_next    = NULL;
+    bio->rq_next    = NULL;
+    bio->rq_tail    = bio;
+    bio->rq_sectors = bio->sectors;
+
+    const blockdev_device_t *device = &bio->device;
+    if (!bio->nvec || !bio->sectors || bio->op > BIO_WRITE) {
+        blk_complete(bio, -EINVAL);
+        return;
+    }
+    if (bio->lba >= device->sector_count || bio->sectors > device->sector_count - bio->lba) {
+        blk_complete(bio, -EINVAL);
+        return;
+    }
+    if (bio->op == BIO_WRITE && device->read_only) {
+        blk_complete(bio, -EROFS);
+        return;
+    }
+
+    task_t     *task = current_task();
+    blk_plug_t *plug = task ? task->plug : NULL;
+    if (plug) {
+        if (!blk_list_add(&plug->head, &plug->tail, bio)) plug->count++;
+        if (plug->count >= BLK_PLUG_MAX) blk_flush_plug(plug);
+        return;
+    }
+
+    blk_queue_insert(bio);
+    blk_kick();
+}
+
+/* Wait for a bio without an end_io callback, returning its status. */
+int bio_wait(bio_t *bio)
+{
+    if (!bio) return -EINVAL;
+
+    /* Our own plug may still hold the bio. */
+    task_t *task = current_task();
+    if (task && task->plug) blk_flush_plug(task->plug);
+
+    while (!__atomic_load_n(&bio->done, __ATOMIC_ACQUIRE)) {
+        if (!blk_workers_usable()) {
+            bio_t *rq = blk_fetch();
+            if (rq)
+                blk_execute(rq);
+            else
+                __asm__ volatile("pause");
+            continue;
+        }
+
+        wait_queue_t *queue = blk_bio_waitqueue(bio);
+        wait_queue_prepare(queue);
+        if (__atomic_load_n(&bio->done, __ATOMIC_ACQUIRE)) {
+            wait_queue_cancel(queue);
+            break;
+        }
+        wait_queue_sleep();
+    }
+    return bio->status;
+}
+
+/* Submit a bio and wait for it. */
+int bio_submit_wait(bio_t *bio)
+{
+    if (!bio) return -EINVAL;
+    bio->end_io = NULL;
+    bio_submit(bio);
+    return bio_wait(bio);
+}
+
+/* Start plugging on the current task; nested plugs fold into the outermost one. */
+void blk_start_plug(blk_plug_t *plug)
+{
+    task_t *task = current_task();
+
+    plug->head  = NULL;
+    plug->tail  = NULL;
+    plug->count = 0;
+    if (task && !task->plug) task->plug = plug;
+}
+
+/* Finish plugging: the outermost plug releases its requests to the queues. */
+void blk_finish_plug(blk_plug_t *plug)
+{
+    task_t *task = current_task();
+
+    if (!task || task->plug != plug) return;
+    blk_flush_plug(plug);
+    task->plug = NULL;
+}
+
+/* kblockd: dispatch queued requests until asked to stop */
+static int blk_worker(void *arg)
+{
+    (void)arg;
+
+    __atomic_add_fetch(&blk_workers_running, 1, __ATOMIC_RELEASE);
+    while (!kthread_should_stop()) {
+        bio_t *rq = blk_fetch();
+        if (rq) {
+            blk_execute(rq);
+            continue;
+        }
+
+        spin_lock(&blk_lock);
+        if (!blk_pending) {
+            wait_queue_prepare(&blk_worker_wait);
+            spin_unlock(&blk_lock);
+            wait_queue_sleep();
+            continue;
+        }
+        spin_unlock(&blk_lock);
+    }
+    __atomic_sub_fetch(&blk_workers_running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Register the kblockd dispatch workers; called once during boot. */
+void blk_queue_init(void)
+{
+    if (blk_initialised) return;
+
+    blk_lock = (spinlock_t) {0};
+    wait_queue_init(&blk_worker_wait);
+    for (uint32_t i = 0; i < BLK_WAIT_HASH; i++) wait_queue_init(&blk_wait_table[i]);
+    blk_initialised = true;
+
+    uint32_t workers = get_cpu_count();
+    if (!workers) workers = 1;
+    if (workers > BLK_MAX_WORKERS) workers = BLK_MAX_WORKERS;
+    for (uint32_t i = 0; i < workers; i++) {
+        if (kernel_worker_register(blk_worker_names[i], blk_worker, NULL, NULL) != EOK) {
+            plogk("blk: Unable to register %s.\n", blk_worker_names[i]);
+            break;
+        }
+    }
+}
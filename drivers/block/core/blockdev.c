@@ -67,12 +67,26 @@ static void blk_empty_reference(const struct blockdev_device *dev)
     (void)dev;
 }
 
+static int blk_empty_get_poll(const struct blockdev_device *dev)
+{
+    (void)dev;
+    return 0;
+}
+
+static int blk_empty_set_poll(const struct blockdev_device *dev, int mode)
+{
+    (void)dev;
+    return mode ? -EINVAL : EOK;
+}
+
 static struct blockdev_ops blk_empty_ops = {
     .read_sectors  = blk_empty_read,
     .write_sectors = blk_empty_write,
     .flush         = blk_empty_flush,
     .retain        = blk_empty_reference,
     .release       = blk_empty_reference,
+    .get_poll      = blk_empty_get_poll,
+    .set_poll      = blk_empty_set_poll,
 };
 
 /* Register a block backend ops table, returning its type id. */
@@ -158,6 +172,8 @@ static struct blockdev_ops blk_nvme_ops = {
     .read_sectors  = nvme_read_sectors,
     .write_sectors = nvme_write_sectors,
     .flush         = nvme_flush,
+    .get_poll      = nvme_get_poll,
+    .set_poll      = nvme_set_poll,
 };
 
 static int blk_nvme_type_id = -1;
@@ -695,6 +711,20 @@ void blockdev_release(const blockdev_device_t *device)
     if (device) blk_ops(device, release)(device);
 }
 
+/* Query the backend's completion polling mode */
+int blockdev_get_poll(const blockdev_device_t *device)
+{
+    if (!device) return -EINVAL;
+    return blk_ops(device, get_poll)(device);
+}
+
+/* Select the backend's completion polling mode */
+int blockdev_set_poll(const blockdev_device_t *device, int mode)
+{
+    if (!device) return -EINVAL;
+    return blk_ops(device, set_poll)(device, mode);
+}
+
 /* Byte-granularity read (handles partial sectors internally) */
 int blockdev_read_bytes(const blockdev_device_t *device, uint64_t offset, void *buffer, size_t size)
 {
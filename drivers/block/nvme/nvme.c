@@ -9,17 +9,25 @@
  */
 
 #include <arch/common.h>
+#include <arch/idt.h>
+#include <arch/smp.h>
 #include <drivers/block/core/blockdev.h>
 #include <drivers/block/nvme/nvme.h>
 #include <drivers/bus/pci.h>
+#include <drivers/firmware/apic.h>
 #include <kernel/errno.h>
+#include <kernel/interrupt/interrupt.h>
 #include <kernel/printk.h>
+#include <kernel/timer/timer.h>
 #include <libs/std/stdlib.h>
 #include <libs/std/string.h>
+#include <mem/alloc.h>
 #include <mem/frame.h>
+#include <mem/heap.h>
 #include <mem/hhdm.h>
 #include <mem/page.h>
 #include <mem/page_walker.h>
+#include <process/sched.h>
 #include <sync/spin_lock.h>
 
 /* Global state */
@@ -85,7 +93,7 @@ static uint32_t nvme_cap_to(uint64_t cap)
 
 /* Queue memory management */
 
-/* Allocate and initialise SQ, CQ and PRP-list memory for a queue. */
+/* Allocate and initialise SQ and CQ memory for a queue. */
 static int nvme_alloc_queue(nvme_queue_t *q, uint32_t qid, uint16_t num_entries, nvme_controller_t *ctrl)
 {
     size_t sq_bytes = (size_t)num_entries * NVME_SQE_SIZE;
@@ -113,16 +121,6 @@ static int nvme_alloc_queue(nvme_queue_t *q, uint32_t qid, uint16_t num_entries,
     q->cq_pages = (uint32_t)cq_pages;
     memset(q->cq, 0, cq_pages * PAGE_4K_SIZE);
 
-    /* PRP list page */
-    q->prp_list_phys = alloc_frames(1);
-    if (!q->prp_list_phys) {
-        free_frames(q->cq_phys, q->cq_pages);
-        free_frames(q->sq_phys, q->sq_pages);
-        return -ENOMEM;
-    }
-    q->prp_list_virt  = phys_to_virt(q->prp_list_phys);
-    q->prp_list_inuse = 0;
-
     q->qid         = qid;
     q->num_entries = num_entries;
     q->sq_head     = 0;
@@ -137,12 +135,28 @@ static int nvme_alloc_queue(nvme_queue_t *q, uint32_t qid, uint16_t num_entries,
     return EOK;
 }
 
+/* Allocate the per-CID command slots of an I/O queue. */
+static int nvme_alloc_slots(nvme_queue_t *q)
+{
+    q->depth     = q->num_entries - 1u;
+    q->slot_hint = 0;
+    q->inflight  = 0;
+    q->slots     = calloc(q->depth, sizeof(nvme_cmd_slot_t));
+    if (!q->slots) return -ENOMEM;
+
+    for (uint32_t i = 0; i < q->depth; i++) wait_queue_init(&q->slots[i].wait);
+    wait_queue_init(&q->slot_wait);
+    return EOK;
+}
+
 /* Release the memory backing a queue. */
 static void nvme_free_queue(nvme_queue_t *q)
 {
-    if (q->prp_list_phys) {
-        free_frames(q->prp_list_phys, 1);
-        q->prp_list_phys = 0;
+    if (q->slots) {
+        for (uint32_t i = 0; i < q->depth; i++)
+            if (q->slots[i].prp_list_phys) free_frames(q->slots[i].prp_list_phys, 1);
+        free(q->slots);
+        q->slots = NULL;
     }
     if (q->cq_phys) {
         free_frames(q->cq_phys, q->cq_pages);
@@ -229,7 +243,7 @@ static int nvme_admin_cmd(nvme_controller_t *ctrl, uint8_t opc, uint32_t nsid, u
  * Because alloc_frames() returns physically contiguous pages,
  * the PRP list is a linear walk of page-aligned addresses.
  */
-static int nvme_build_prp(nvme_queue_t *q, uint64_t dma_phys, uint32_t byte_count, uint64_t *prp1_out, uint64_t *prp2_out)
+static int nvme_build_prp(nvme_cmd_slot_t *slot, uint64_t dma_phys, uint32_t byte_count, uint64_t *prp1_out, uint64_t *prp2_out)
 {
     uint32_t offset           = (uint32_t)(dma_phys & (PAGE_4K_SIZE - 1));
     uint32_t first_page_avail = PAGE_4K_SIZE - offset;
@@ -252,11 +266,14 @@ static int nvme_build_prp(nvme_queue_t *q, uint64_t dma_phys, uint32_t byte_coun
         return EOK;
     }
 
-    /* Need a PRP list page - use the pre-allocated one */
-    if (q->prp_list_inuse) return -EBUSY;
-    q->prp_list_inuse = 1;
+    /* Need a PRP list page - each CID keeps its own once allocated */
+    if (!slot->prp_list_phys) {
+        slot->prp_list_phys = alloc_frames(1);
+        if (!slot->prp_list_phys) return -ENOMEM;
+        slot->prp_list_virt = phys_to_virt(slot->prp_list_phys);
+    }
 
-    uint64_t *list = (uint64_t *)q->prp_list_virt;
+    uint64_t *list = (uint64_t *)slot->prp_list_virt;
     memset(list, 0, PAGE_4K_SIZE);
 
     /* First list entry is the rest of page 1 (offset-adjusted page 2) */
@@ -271,13 +288,309 @@ static int nvme_build_prp(nvme_queue_t *q, uint64_t dma_phys, uint32_t byte_coun
         next_page += PAGE_4K_SIZE;
     }
 
-    if (remaining > 0) {
-        q->prp_list_inuse = 0;
-        return -E2BIG; // transfer too large for single PRP list
+    if (remaining > 0) return -E2BIG; // transfer too large for single PRP list
+
+    *prp2_out = slot->prp_list_phys;
+    return EOK;
+}
+
+/* I/O queue completion handling */
+
+/* Return a CID to the free pool and wake one submitter waiting for it; caller holds q->lock. */
+static void nvme_release_slot_locked(nvme_queue_t *q, uint32_t cid)
+{
+    nvme_cmd_slot_t *slot = &q->slots[cid];
+
+    slot->inuse     = 0;
+    slot->abandoned = 0;
+    slot->done      = 0;
+    q->inflight--;
+    (void)wait_queue_wake_one(&q->slot_wait);
+}
+
+/* Consume every posted CQE of an I/O queue and complete its CID; caller holds q->lock. */
+static uint32_t nvme_reap_cq(nvme_queue_t *q)
+{
+    uint32_t reaped = 0;
+
+    for (;;) {
+        compiler_barrier();
+        nvme_cqe_t *cqe = &q->cq[q->cq_head];
+        if (NVME_CQE_PHASE(cqe) != q->cq_phase) break;
+
+        uint16_t cid    = cqe->cmd_id;
+        uint16_t status = (uint16_t)(cqe->sfp >> 1);
+        uint32_t result = cqe->dw0;
+        q->sq_head      = cqe->sq_head;
+
+        q->cq_head++;
+        if (q->cq_head == q->num_entries) {
+            q->cq_head = 0;
+            q->cq_phase ^= 1;
+        }
+        reaped++;
+
+        if (cid >= q->depth || !q->slots[cid].inuse) {
+            plogk("nvme: Spurious completion CID %u on queue %u\n", cid, q->qid);
+            continue;
+        }
+
+        nvme_cmd_slot_t *slot = &q->slots[cid];
+        slot->status          = status;
+        slot->result          = result;
+
+        /* The submitter gave up on this command; only the CID is left to free. */
+        if (slot->abandoned) {
+            nvme_release_slot_locked(q, cid);
+            continue;
+        }
+        __atomic_store_n(&slot->done, 1, __ATOMIC_RELEASE);
+        (void)wait_queue_wake_all(&slot->wait);
+    }
+
+    /* One head doorbell write covers the whole batch. */
+    if (reaped) mmio_write32((uint32_t *)q->cq_doorbell, q->cq_head);
+    return reaped;
+}
+
+/* Reap the queue under its lock. */
+static void nvme_reap_queue(nvme_queue_t *q)
+{
+    uint64_t rflags = spin_lock_irqsave(&q->lock);
+    (void)nvme_reap_cq(q);
+    spin_unlock_irqrestore(&q->lock, rflags);
+}
+
+/* Whether the caller may block until a completion interrupt arrives. */
+static int nvme_can_sleep(const nvme_queue_t *q)
+{
+    if (!q->irq_enabled || !__atomic_load_n(&scheduler.started, __ATOMIC_ACQUIRE)) return 0;
+    return (get_rflags() & (1ULL << 9)) != 0;
+}
+
+/* Scheduler deadline for the next lost-interrupt recheck, capped by the command deadline. */
+static uint64_t nvme_recheck_deadline(uint64_t deadline)
+{
+    uint64_t next = sched_ticks() + timer_ns_to_ticks_ceil(NVME_IRQ_RECHECK_MS * 1000000ULL);
+    return next < deadline ? next : deadline;
+}
+
+/* Claim a free CID, sleeping (or reaping, when sleeping is impossible) while all are in flight. */
+static int nvme_get_slot(nvme_queue_t *q, uint32_t *cid_out)
+{
+    uint64_t loops = 0;
+
+    for (;;) {
+        uint64_t rflags = spin_lock_irqsave(&q->lock);
+        if (q->inflight < q->depth) {
+            uint32_t cid = q->slot_hint;
+            while (q->slots[cid].inuse) cid = (cid + 1) % q->depth;
+
+            q->slots[cid].inuse = 1;
+            q->slots[cid].done  = 0;
+            q->slot_hint        = (cid + 1) % q->depth;
+            q->inflight++;
+            spin_unlock_irqrestore(&q->lock, rflags);
+            *cid_out = cid;
+            return EOK;
+        }
+
+        if (nvme_can_sleep(q)) {
+            wait_queue_prepare(&q->slot_wait);
+            spin_unlock_irqrestore(&q->lock, rflags);
+            (void)wait_queue_wait_timed(&q->slot_wait, nvme_recheck_deadline(UINT64_MAX));
+            continue;
+        }
+
+        (void)nvme_reap_cq(q);
+        spin_unlock_irqrestore(&q->lock, rflags);
+        if (++loops > NVME_TIMEOUT_LOOPS) return -EBUSY;
+        __asm__ volatile("pause");
+    }
+}
+
+/* Copy a command into the SQ under the given CID and ring the tail doorbell. */
+static void nvme_submit_cmd(nvme_queue_t *q, uint32_t cid, const nvme_sqe_t *cmd)
+{
+    uint64_t    rflags = spin_lock_irqsave(&q->lock);
+    nvme_sqe_t *sqe    = &q->sq[q->sq_tail];
+
+    memcpy(sqe, cmd, sizeof(*sqe));
+    sqe->cdw0 = (sqe->cdw0 & 0xFFFF) | (cid << 16);
+
+    compiler_barrier();
+    q->sq_tail = (q->sq_tail + 1) % q->num_entries;
+    mmio_write32((uint32_t *)q->sq_doorbell, q->sq_tail);
+    spin_unlock_irqrestore(&q->lock, rflags);
+}
+
+/*
+ * Wait for a CID to complete and release it.  Hybrid mode spins on the CQ
+ * for about the queue's mean latency before sleeping; without a usable
+ * interrupt (early boot, IRQs off, no MSI) the wait degrades to polling.
+ */
+static int nvme_wait_slot(nvme_controller_t *ctrl, nvme_queue_t *q, uint32_t cid)
+{
+    nvme_cmd_slot_t *slot     = &q->slots[cid];
+    int              sleep    = nvme_can_sleep(q);
+    int              hybrid   = sleep && __atomic_load_n(&ctrl->poll_mode, __ATOMIC_RELAXED) == NVME_POLL_HYBRID;
+    uint64_t         start    = hybrid ? timer_monotonic_ns() : 0;
+    uint64_t         window   = q->mean_ns && q->mean_ns < NVME_HYBRID_POLL_MAX_NS ? q->mean_ns : NVME_HYBRID_POLL_MAX_NS;
+    uint64_t         deadline = sleep ? sched_ticks() + timer_ns_to_ticks_ceil(NVME_IO_TIMEOUT_MS * 1000000ULL) : 0;
+    uint64_t         loops    = 0;
+    uint64_t         rflags;
+
+    while (!__atomic_load_n(&slot->done, __ATOMIC_ACQUIRE)) {
+        if (!sleep || (hybrid && timer_monotonic_ns() - start < window)) {
+            nvme_reap_queue(q);
+            if (__atomic_load_n(&slot->done, __ATOMIC_ACQUIRE)) break;
+            if (!sleep && ++loops > NVME_TIMEOUT_LOOPS) goto timeout;
+            __asm__ volatile("pause");
+            continue;
+        }
+
+        if (sched_ticks() >= deadline) goto timeout;
+        wait_queue_prepare(&slot->wait);
+
+        /* Close the completion/prepare race before committing the sleep. */
+        if (__atomic_load_n(&slot->done, __ATOMIC_ACQUIRE)) {
+            wait_queue_cancel(&slot->wait);
+            break;
+        }
+        if (wait_queue_wait_timed(&slot->wait, nvme_recheck_deadline(deadline)) == -ETIMEDOUT) nvme_reap_queue(q); // lost interrupt
+    }
+
+    if (hybrid) {
+        uint64_t elapsed = timer_monotonic_ns() - start;
+        q->mean_ns       = q->mean_ns ? (q->mean_ns * 7 + elapsed) / 8 : elapsed;
+    }
+
+complete:
+    rflags          = spin_lock_irqsave(&q->lock);
+    uint16_t status = slot->status;
+    nvme_release_slot_locked(q, cid);
+    spin_unlock_irqrestore(&q->lock, rflags);
+
+    uint16_t sc  = status & 0xFF;
+    uint16_t sct = (status >> 8) & 0x7;
+    if (sct != NVME_SCT_GENERIC || sc != NVME_SC_SUCCESS) {
+        plogk("nvme: CQE error CID=%u queue=%u SCT=%u SC=%02x\n", cid, q->qid, sct, sc);
+        return -EIO;
+    }
+    return EOK;
+
+timeout:
+    rflags = spin_lock_irqsave(&q->lock);
+    (void)nvme_reap_cq(q);
+    if (__atomic_load_n(&slot->done, __ATOMIC_ACQUIRE)) {
+        spin_unlock_irqrestore(&q->lock, rflags);
+        goto complete;
+    }
+    slot->abandoned = 1;
+    spin_unlock_irqrestore(&q->lock, rflags);
+    plogk("nvme: Timeout waiting for CID %u on queue %u\n", cid, q->qid);
+    return -ETIMEDOUT;
+}
+
+/* Reap every interrupt-driven I/O queue that has a completion posted. */
+INTERRUPT_BEGIN static void nvme_irq_handler(interrupt_frame_t *frame)
+{
+    irq_enter_gs(frame);
+
+    /*
+     * Handlers do not learn their vector, so each MSI-X entry lands here and
+     * peeks the phase bit of every queue; only queues with work take a lock.
+     */
+    for (int i = 0; i < NVME_MAX_CONTROLLERS; i++) {
+        nvme_controller_t *ctrl = &nvme_controllers[i];
+        for (uint32_t j = 0; j < ctrl->io_queue_count; j++) {
+            nvme_queue_t *q = &ctrl->io_queues[j];
+            if (!q->irq_enabled || NVME_CQE_PHASE(&q->cq[q->cq_head]) != q->cq_phase) continue;
+            spin_lock(&q->lock);
+            (void)nvme_reap_cq(q);
+            spin_unlock(&q->lock);
+        }
+    }
+
+    send_eoi();
+    irq_leave_gs(frame);
+}
+INTERRUPT_END
+
+/* Allocate completion vectors: one MSI-X entry per queue, else a shared MSI vector. Returns the entry count. */
+static int nvme_setup_irqs(nvme_controller_t *ctrl, uint32_t queues)
+{
+    pci_device_cache_t *pci = ctrl->pci;
+    int                 nvec;
+    int                 vector;
+
+    pci_msi_init(pci);
+    nvec = pci_enable_msix(pci, (int)queues + 1);
+    if (nvec > 0) {
+        for (int i = 0; i < nvec; i++) register_interrupt_handler((uint16_t)pci_irq_vector(pci, i), (void *)nvme_irq_handler, 0, 0x8e);
+        ctrl->irq_mode   = NVME_IRQ_MSIX;
+        ctrl->irq_vector = (uint32_t)pci_irq_vector(pci, 0);
+        return nvec;
+    }
+
+    vector = pci_enable_msi(pci);
+    if (vector >= 0) {
+        register_interrupt_handler((uint16_t)vector, (void *)nvme_irq_handler, 0, 0x8e);
+        ctrl->irq_mode   = NVME_IRQ_MSI;
+        ctrl->irq_vector = (uint32_t)vector;
+
+        /* With plain MSI the INTMS/INTMC registers mask per vector. */
+        nvme_write32(ctrl->regs, NVME_REG_INTMC, 1);
+        return 1;
     }
 
-    *prp2_out = q->prp_list_phys;
+    ctrl->irq_mode = NVME_IRQ_NONE;
+    return 0;
+}
+
+/* Tear down the I/O queues and completion vectors of a controller. */
+static void nvme_release_io(nvme_controller_t *ctrl)
+{
+    uint32_t count = ctrl->io_queue_count;
+
+    ctrl->io_queue_count = 0;
+    for (uint32_t i = 0; i < count; i++) nvme_free_queue(&ctrl->io_queues[i]);
+
+    if (ctrl->irq_mode == NVME_IRQ_MSIX) pci_disable_msix(ctrl->pci);
+    if (ctrl->irq_mode == NVME_IRQ_MSI) pci_disable_msi(ctrl->pci);
+    ctrl->irq_mode = NVME_IRQ_NONE;
+}
+
+/* Create I/O queue pair qid, wired to the given MSI-X entry when interrupts are available. */
+static int nvme_create_io_queue(nvme_controller_t *ctrl, nvme_queue_t *q, uint32_t qid, uint16_t entries, int irq_entry)
+{
+    uint32_t   cq_flags = 1u; // physically contiguous
+    nvme_cqe_t cqe;
+    int        ret;
+
+    ret = nvme_alloc_queue(q, qid, entries, ctrl);
+    if (ret) return ret;
+    ret = nvme_alloc_slots(q);
+    if (ret) goto err_free;
+
+    if (irq_entry >= 0) {
+        q->irq_entry   = (uint16_t)irq_entry;
+        q->irq_enabled = 1;
+        cq_flags |= 2u | ((uint32_t)irq_entry << 16); // IEN + IV
+    }
+
+    ret = nvme_admin_cmd(ctrl, NVME_ADMIN_CREATE_IO_CQ, 0, q->cq_phys, 0, ((uint32_t)(entries - 1) << 16) | qid, cq_flags, 0, &cqe);
+    if (ret) goto err_free;
+
+    ret = nvme_admin_cmd(ctrl, NVME_ADMIN_CREATE_IO_SQ, 0, q->sq_phys, 0, ((uint32_t)(entries - 1) << 16) | qid, (qid << 16) | 1u, 0, &cqe);
+    if (ret) {
+        (void)nvme_admin_cmd(ctrl, NVME_ADMIN_DELETE_IO_CQ, 0, 0, 0, qid, 0, 0, &cqe);
+        goto err_free;
+    }
     return EOK;
+err_free:
+    nvme_free_queue(q);
+    return ret;
 }
 
 /* Probe and initialise a single NVMe controller. */
@@ -286,6 +599,7 @@ static int nvme_controller_init(pci_device_cache_t *pci_dev, uint16_t ctrl_id)
     nvme_controller_t *ctrl;
     uint32_t           vendor_id, device_id;
     uint64_t           cap;
+    uint32_t           io_queues;
     int                ret;
 
     if (ctrl_id >= NVME_MAX_CONTROLLERS) return -ENOSPC;
@@ -343,7 +657,7 @@ static int nvme_controller_init(pci_device_cache_t *pci_dev, uint16_t ctrl_id)
 
     plogk("nvme: controller %u: MQES=%u, doorbell stride=%u bytes.\n", ctrl_id, ctrl->max_qsize - 1, ctrl->stride);
 
-    /* This driver completes commands by polling. Keep legacy INTx masked. */
+    /* Completions arrive over MSI-X/MSI or are polled. Keep legacy INTx masked. */
     nvme_write32(ctrl->regs, NVME_REG_INTMS, 0xFFFFFFFF);
 
     /* Disable controller */
@@ -394,32 +708,50 @@ static int nvme_controller_init(pci_device_cache_t *pci_dev, uint16_t ctrl_id)
     }
 
     /* Set Features: Number of Queues */
-    /* Request 1 I/O SQ + 1 I/O CQ */
+    /* Request one I/O SQ/CQ pair per CPU; the controller may grant fewer */
     {
+        uint32_t   wanted = get_cpu_count() ? get_cpu_count() : 1;
         nvme_cqe_t cqe;
-        ret = nvme_admin_cmd(ctrl, NVME_ADMIN_SET_FEATURES, 0, 0, 0, NVME_FID_NUM_QUEUES, 0, 0, &cqe);
+
+        if (wanted > NVME_MAX_IO_QUEUES) wanted = NVME_MAX_IO_QUEUES;
+        ret = nvme_admin_cmd(ctrl, NVME_ADMIN_SET_FEATURES, 0, 0, 0, NVME_FID_NUM_QUEUES, ((wanted - 1) << 16) | (wanted - 1), 0, &cqe);
         if (ret) {
             plogk("nvme: controller %u: Set Features (num queues) = %d\n", ctrl_id, ret);
             goto err_admin;
         }
+
+        uint32_t nsqa = (cqe.dw0 & 0xFFFF) + 1;
+        uint32_t ncqa = (cqe.dw0 >> 16) + 1;
+        io_queues     = wanted;
+        if (io_queues > nsqa) io_queues = nsqa;
+        if (io_queues > ncqa) io_queues = ncqa;
     }
 
     plogk("nvme: controller %u: Admin queue configured, %u entries.\n", ctrl_id, ctrl->admin_q.num_entries);
 
-    /* Create polling I/O queue pair 1 */
+    /* Create the I/O queue pairs, each with its own completion vector when possible */
     {
-        uint16_t   io_entries = NVME_IO_QSIZE;
-        nvme_cqe_t cqe;
+        uint16_t io_entries = NVME_IO_QSIZE;
+        int      nvec       = nvme_setup_irqs(ctrl, io_queues);
 
         if (io_entries > ctrl->max_qsize) io_entries = (uint16_t)ctrl->max_qsize;
-        ret = nvme_alloc_queue(&ctrl->io_q, 1, io_entries, ctrl);
-        if (ret) goto err_admin;
-
-        ret = nvme_admin_cmd(ctrl, NVME_ADMIN_CREATE_IO_CQ, 0, ctrl->io_q.cq_phys, 0, ((uint32_t)(io_entries - 1) << 16) | 1u, 1u, 0, &cqe);
-        if (ret) goto err_io;
+        for (uint32_t i = 0; i < io_queues; i++) {
+            int irq_entry = -1;
+            if (ctrl->irq_mode == NVME_IRQ_MSIX) irq_entry = nvec > 1 ? 1 + (int)(i % (uint32_t)(nvec - 1)) : 0;
+            if (ctrl->irq_mode == NVME_IRQ_MSI) irq_entry = 0;
+
+            ret = nvme_create_io_queue(ctrl, &ctrl->io_queues[i], i + 1, io_entries, irq_entry);
+            if (ret) break;
+            ctrl->io_queue_count++;
+        }
+        if (!ctrl->io_queue_count) {
+            plogk("nvme: controller %u: failed to create I/O queues: %d\n", ctrl_id, ret);
+            goto err_io;
+        }
+        ret = EOK;
 
-        ret = nvme_admin_cmd(ctrl, NVME_ADMIN_CREATE_IO_SQ, 0, ctrl->io_q.sq_phys, 0, ((uint32_t)(io_entries - 1) << 16) | 1u, (1u << 16) | 1u, 0, &cqe);
-        if (ret) goto err_io;
+        plogk("nvme: controller %u: %u I/O queue(s), %s completions.\n", ctrl_id, ctrl->io_queue_count,
+              ctrl->irq_mode == NVME_IRQ_MSIX ? "MSI-X" : ctrl->irq_mode == NVME_IRQ_MSI ? "MSI" : "polled");
     }
 
     /* Identify Controller */
@@ -457,6 +789,11 @@ static int nvme_controller_init(pci_device_cache_t *pci_dev, uint16_t ctrl_id)
 
         ctrl->num_namespaces = (id->nn > NVME_MAX_NAMESPACES) ? NVME_MAX_NAMESPACES : id->nn;
 
+        /* MDTS is a power of two in units of the minimum memory page size */
+        ctrl->max_xfer_pages = NVME_MAX_XFER_PAGES;
+        if (id->mdts && id->mdts + NVME_CAP_MPSMIN(cap) < 32 && (1u << (id->mdts + NVME_CAP_MPSMIN(cap))) < ctrl->max_xfer_pages)
+            ctrl->max_xfer_pages = 1u << (id->mdts + NVME_CAP_MPSMIN(cap));
+
         plogk("nvme: controller %u: \"%s\" SN=%s FW=%s, %u namespace(s)\n", ctrl_id, model, serial, fw, ctrl->num_namespaces);
 
         free_frames(ident_phys, 1);
@@ -521,39 +858,61 @@ err_admin:
     nvme_free_queue(&ctrl->admin_q);
     return ret;
 err_io:
-    nvme_free_queue(&ctrl->io_q);
+    nvme_release_io(ctrl);
     goto err_admin;
 }
 
-/* Submit one I/O command on the I/O queue and wait for completion. */
-static int nvme_do_io(nvme_controller_t *ctrl, uint8_t opc, uint32_t nsid, uint64_t prp1, uint64_t prp2, uint64_t slba, uint16_t nlb)
+/* Return the controller that owns a namespace descriptor, or NULL. */
+static nvme_controller_t *nvme_ns_controller(const nvme_namespace_t *ns)
 {
-    nvme_queue_t *q = &ctrl->io_q;
-    int           ret;
+    for (int i = 0; i < nvme_ctrl_count; i++) {
+        nvme_controller_t *ctrl = &nvme_controllers[i];
+        if (ns >= ctrl->namespaces && ns < ctrl->namespaces + ctrl->num_namespaces) return ctrl;
+    }
+    return NULL;
+}
 
-    spin_lock(&ctrl->lock);
+/* Pick the I/O queue pair owned by the current CPU. */
+static nvme_queue_t *nvme_cpu_queue(nvme_controller_t *ctrl)
+{
+    uint32_t cpu = get_cpu_count() ? get_current_cpu_id() : 0;
+    return &ctrl->io_queues[cpu % ctrl->io_queue_count];
+}
 
-    uint32_t    tail = q->sq_tail;
-    uint32_t    cid  = q->sq_cid++;
-    nvme_sqe_t *cmd  = &q->sq[tail];
+/* Submit one I/O command on this CPU's queue and wait for its completion. */
+static int nvme_do_io(nvme_controller_t *ctrl, uint8_t opc, uint32_t nsid, uint64_t dma_phys, uint32_t bytes, uint64_t slba, uint16_t nlb)
+{
+    nvme_queue_t *q    = nvme_cpu_queue(ctrl);
+    uint64_t      prp1 = 0;
+    uint64_t      prp2 = 0;
+    uint32_t      cid;
+    nvme_sqe_t    cmd;
+    int           ret;
 
-    memset(cmd, 0, sizeof(*cmd));
-    cmd->cdw0  = ((uint32_t)opc & 0xFF) | ((uint32_t)cid << 16);
-    cmd->nsid  = nsid;
-    cmd->prp1  = prp1;
-    cmd->prp2  = prp2;
-    cmd->cdw10 = (uint32_t)(slba & 0xFFFFFFFF);
-    cmd->cdw11 = (uint32_t)(slba >> 32);
-    cmd->cdw12 = (uint32_t)(nlb & 0xFFFF);
+    ret = nvme_get_slot(q, &cid);
+    if (ret) return ret;
 
-    compiler_barrier();
-    q->sq_tail = (tail + 1) % q->num_entries;
-    mmio_write32((uint32_t *)q->sq_doorbell, q->sq_tail);
+    if (bytes) {
+        ret = nvme_build_prp(&q->slots[cid], dma_phys, bytes, &prp1, &prp2);
+        if (ret) {
+            uint64_t rflags = spin_lock_irqsave(&q->lock);
+            nvme_release_slot_locked(q, cid);
+            spin_unlock_irqrestore(&q->lock, rflags);
+            return ret;
+        }
+    }
 
-    nvme_cqe_t cqe;
-    ret = nvme_poll_completion(q, cid, &cqe);
-    spin_unlock(&ctrl->lock);
-    return ret;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.cdw0  = (uint32_t)opc & 0xFF;
+    cmd.nsid  = nsid;
+    cmd.prp1  = prp1;
+    cmd.prp2  = prp2;
+    cmd.cdw10 = (uint32_t)(slba & 0xFFFFFFFF);
+    cmd.cdw11 = (uint32_t)(slba >> 32);
+    cmd.cdw12 = (uint32_t)(nlb & 0xFFFF);
+
+    nvme_submit_cmd(q, cid, &cmd);
+    return nvme_wait_slot(ctrl, q, cid);
 }
 
 /* Backend I/O entry points (called via blockdev ops table) */
@@ -563,7 +922,6 @@ int nvme_read_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
 {
     nvme_namespace_t  *ns;
     nvme_controller_t *ctrl;
-    nvme_queue_t      *q;
     uint8_t           *buf;
     int                ret;
 
@@ -571,25 +929,13 @@ int nvme_read_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
     if (!count) return EOK;
 
     ns   = (nvme_namespace_t *)dev->backend_data;
-    ctrl = NULL;
-
-    /* Find the controller that owns this namespace */
-    for (int i = 0; i < nvme_ctrl_count; i++) {
-        for (uint32_t j = 0; j < nvme_controllers[i].num_namespaces; j++) {
-            if (&nvme_controllers[i].namespaces[j] == ns) {
-                ctrl = &nvme_controllers[i];
-                break;
-            }
-        }
-        if (ctrl) break;
-    }
+    ctrl = nvme_ns_controller(ns);
     if (!ctrl || !ctrl->initialised) return -ENODEV;
 
-    q   = &ctrl->io_q;
     buf = (uint8_t *)buffer;
 
-    /* Chunk size: up to 2 pages (8 KB) per command to keep DMA simple */
-    uint32_t max_sectors_per_cmd = (PAGE_4K_SIZE * 2) / ns->sector_size;
+    /* Chunk size: bounded by MDTS and the per-CID PRP list */
+    uint32_t max_sectors_per_cmd = (PAGE_4K_SIZE * ctrl->max_xfer_pages) / ns->sector_size;
 
     while (count > 0) {
         uint32_t chunk = (count > max_sectors_per_cmd) ? max_sectors_per_cmd : count;
@@ -604,22 +950,12 @@ int nvme_read_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
         }
         void *dma_virt = phys_to_virt(dma_phys);
 
-        /* Build PRP */
-        uint64_t prp1, prp2;
-        ret = nvme_build_prp(q, dma_phys, bytes, &prp1, &prp2);
-        if (ret) {
-            plogk("nvme: ns%u: PRP build failed for read at LBA %llu (%u bytes): %d\n", ns->nsid, (unsigned long long)dev->base_lba + lba, bytes, ret);
-            free_frames(dma_phys, pages);
-            return ret;
-        }
-
         /* Submit READ command */
-        ret = nvme_do_io(ctrl, NVME_NVM_READ, ns->nsid, prp1, prp2, dev->base_lba + lba, (uint16_t)(chunk - 1));
-
-        if (q->prp_list_inuse) q->prp_list_inuse = 0;
-
+        ret = nvme_do_io(ctrl, NVME_NVM_READ, ns->nsid, dma_phys, bytes, dev->base_lba + lba, (uint16_t)(chunk - 1));
         if (ret == EOK) memcpy(buf, dma_virt, bytes);
-        free_frames(dma_phys, pages);
+
+        /* A timed-out command may still DMA into the buffer; leave it to the device. */
+        if (ret != -ETIMEDOUT) free_frames(dma_phys, pages);
         if (ret) return ret;
 
         buf += bytes;
@@ -635,7 +971,6 @@ int nvme_write_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
 {
     nvme_namespace_t  *ns;
     nvme_controller_t *ctrl;
-    nvme_queue_t      *q;
     const uint8_t     *buf;
     int                ret;
 
@@ -643,23 +978,12 @@ int nvme_write_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
     if (!count) return EOK;
 
     ns   = (nvme_namespace_t *)dev->backend_data;
-    ctrl = NULL;
-
-    for (int i = 0; i < nvme_ctrl_count; i++) {
-        for (uint32_t j = 0; j < nvme_controllers[i].num_namespaces; j++) {
-            if (&nvme_controllers[i].namespaces[j] == ns) {
-                ctrl = &nvme_controllers[i];
-                break;
-            }
-        }
-        if (ctrl) break;
-    }
+    ctrl = nvme_ns_controller(ns);
     if (!ctrl || !ctrl->initialised) return -ENODEV;
 
-    q   = &ctrl->io_q;
     buf = (const uint8_t *)buffer;
 
-    uint32_t max_sectors_per_cmd = (PAGE_4K_SIZE * 2) / ns->sector_size;
+    uint32_t max_sectors_per_cmd = (PAGE_4K_SIZE * ctrl->max_xfer_pages) / ns->sector_size;
 
     while (count > 0) {
         uint32_t chunk = (count > max_sectors_per_cmd) ? max_sectors_per_cmd : count;
@@ -676,19 +1000,9 @@ int nvme_write_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
         /* Copy caller data into DMA buffer */
         memcpy(dma_virt, buf, bytes);
 
-        uint64_t prp1, prp2;
-        ret = nvme_build_prp(q, dma_phys, bytes, &prp1, &prp2);
-        if (ret) {
-            plogk("nvme: ns%u: PRP build failed for write at LBA %llu (%u bytes): %d\n", ns->nsid, (unsigned long long)dev->base_lba + lba, bytes, ret);
-            free_frames(dma_phys, pages);
-            return ret;
-        }
-
-        ret = nvme_do_io(ctrl, NVME_NVM_WRITE, ns->nsid, prp1, prp2, dev->base_lba + lba, (uint16_t)(chunk - 1));
-
-        if (q->prp_list_inuse) q->prp_list_inuse = 0;
+        ret = nvme_do_io(ctrl, NVME_NVM_WRITE, ns->nsid, dma_phys, bytes, dev->base_lba + lba, (uint16_t)(chunk - 1));
 
-        free_frames(dma_phys, pages);
+        if (ret != -ETIMEDOUT) free_frames(dma_phys, pages);
         if (ret) return ret;
 
         buf += bytes;
@@ -703,26 +1017,38 @@ int nvme_write_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
 int nvme_flush(const struct blockdev_device *dev)
 {
     nvme_namespace_t  *ns;
-    nvme_controller_t *ctrl = NULL;
+    nvme_controller_t *ctrl;
 
     if (!dev) return -EINVAL;
     ns = (nvme_namespace_t *)dev->backend_data;
     if (!ns || !ns->ready) return -ENODEV;
 
-    for (int i = 0; i < nvme_ctrl_count; i++) {
-        for (uint32_t j = 0; j < nvme_controllers[i].num_namespaces; j++) {
-            if (&nvme_controllers[i].namespaces[j] == ns) {
-                ctrl = &nvme_controllers[i];
-                break;
-            }
-        }
-        if (ctrl) break;
-    }
+    ctrl = nvme_ns_controller(ns);
     if (!ctrl || !ctrl->initialised) return -ENODEV;
 
     return nvme_do_io(ctrl, NVME_NVM_FLUSH, ns->nsid, 0, 0, 0, 0);
 }
 
+/* Return the completion mode of the namespace's controller. */
+int nvme_get_poll(const struct blockdev_device *dev)
+{
+    nvme_controller_t *ctrl = dev ? nvme_ns_controller((const nvme_namespace_t *)dev->backend_data) : NULL;
+
+    if (!ctrl || !ctrl->initialised) return -ENODEV;
+    return __atomic_load_n(&ctrl->poll_mode, __ATOMIC_RELAXED);
+}
+
+/* Switch the namespace's controller between interrupt-driven and hybrid-polled completions. */
+int nvme_set_poll(const struct blockdev_device *dev, int mode)
+{
+    nvme_controller_t *ctrl = dev ? nvme_ns_controller((const nvme_namespace_t *)dev->backend_data) : NULL;
+
+    if (!ctrl || !ctrl->initialised) return -ENODEV;
+    if (mode != NVME_POLL_OFF && mode != NVME_POLL_HYBRID) return -EINVAL;
+    __atomic_store_n(&ctrl->poll_mode, (uint8_t)mode, __ATOMIC_RELAXED);
+    return EOK;
+}
+
 /* Probe and initialise all NVMe controllers found on the PCI bus. */
 void nvme_init(void)
 {
@@ -14,6 +14,7 @@
 #include <boot/limine.h>
 #include <drivers/firmware/acpi.h>
 #include <drivers/firmware/apic.h>
+#include <drivers/time/tsc.h>
 #include <kernel/printk.h>
 #include <kernel/timer/timer.h>
 #include <kernel/uinxed.h>
@@ -21,11 +22,19 @@
 #include <libs/std/stdint.h>
 #include <mem/hhdm.h>
 
-#define CPUID_FEAT_EDX_APIC   (1 << 9)
-#define CPUID_FEAT_ECX_X2APIC (1 << 21)
+#define CPUID_FEAT_EDX_APIC         (1 << 9)
+#define CPUID_FEAT_ECX_X2APIC       (1 << 21)
+#define CPUID_FEAT_ECX_TSC_DEADLINE (1 << 24)
+#define MSR_IA32_TSC_DEADLINE       0x6e0
+
+#define LAPIC_TIMER_PERIODIC     (1 << 17)
+#define LAPIC_TIMER_TSC_DEADLINE (2 << 17)
 
 int x2apic_mode = -1;
 
+static uint32_t lapic_timer_initial; // initial count of one periodic tick
+static int      lapic_tsc_deadline;  // CPU supports TSC-deadline timer mode
+
 pointer_cast_t lapic_ptr;
 pointer_cast_t ioapic_ptr;
 
@@ -104,8 +113,9 @@ void local_apic_init(void)
             plogk("apic: Local APIC not supported.\n");
             return;
         }
-        x2apic_mode = smp_request.response && (smp_request.response->flags & 1) && (ecx & CPUID_FEAT_ECX_X2APIC);
-        plogk("apic: Local APIC: %s\n", x2apic_mode ? "x2APIC" : "xAPIC");
+        x2apic_mode        = smp_request.response && (smp_request.response->flags & 1) && (ecx & CPUID_FEAT_ECX_X2APIC);
+        lapic_tsc_deadline = (ecx & CPUID_FEAT_ECX_TSC_DEADLINE) != 0;
+        plogk("apic: Local APIC: %s%s\n", x2apic_mode ? "x2APIC" : "xAPIC", lapic_tsc_deadline ? ", TSC-deadline timer" : "");
     }
 
     lapic_write(LAPIC_REG_SPURIOUS, 0xff | 1 << 8);
@@ -119,10 +129,46 @@ void local_apic_init(void)
     uint64_t lapic_timer              = (~(uint32_t)0) - lapic_read(LAPIC_REG_TIMER_CURCNT);
     uint64_t calibrated_timer_initial = (uint64_t)((uint64_t)(lapic_timer * 1000) / TIMER_HZ);
 
-    lapic_write(LAPIC_REG_TIMER, lapic_read(LAPIC_REG_TIMER) | 1 << 17);
+    lapic_timer_initial = (uint32_t)calibrated_timer_initial;
+    lapic_write(LAPIC_REG_TIMER, lapic_read(LAPIC_REG_TIMER) | LAPIC_TIMER_PERIODIC);
     lapic_write(LAPIC_REG_TIMER_INITCNT, calibrated_timer_initial);
 }
 
+/* Whether one-shot events can use the TSC-deadline timer mode */
+static int lapic_use_tsc_deadline(void)
+{
+    return lapic_tsc_deadline && tsc_clocksource_available();
+}
+
+/* Return the local APIC timer to its periodic tick */
+void lapic_timer_periodic(void)
+{
+    if (lapic_use_tsc_deadline()) wrmsr(MSR_IA32_TSC_DEADLINE, 0);
+    lapic_write(LAPIC_REG_TIMER, IRQ_0 | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_REG_TIMER_INITCNT, lapic_timer_initial);
+}
+
+/* Program a single timer interrupt delta_ns from now, replacing the periodic tick */
+void lapic_timer_oneshot(uint64_t delta_ns)
+{
+    if (lapic_use_tsc_deadline()) {
+        lapic_write(LAPIC_REG_TIMER, IRQ_0 | LAPIC_TIMER_TSC_DEADLINE);
+        __asm__ volatile("mfence" ::: "memory"); // order the LVT write before the MSR write
+        wrmsr(MSR_IA32_TSC_DEADLINE, rdtsc() + tsc_ns_to_cycles(delta_ns));
+        return;
+    }
+
+    /* Saturate before multiplying so the product stays within 64 bits. */
+    uint64_t count;
+    if (lapic_timer_initial && delta_ns > (uint64_t)UINT32_MAX * TIMER_TICK_NS / lapic_timer_initial)
+        count = UINT32_MAX;
+    else
+        count = delta_ns * lapic_timer_initial / TIMER_TICK_NS;
+    if (!count) count = 1;
+    lapic_write(LAPIC_REG_TIMER, IRQ_0);
+    lapic_write(LAPIC_REG_TIMER_INITCNT, (uint32_t)count);
+}
+
 /* Initialize I/O APIC */
 void io_apic_init(void)
 {
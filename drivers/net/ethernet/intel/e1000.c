@@ -19,6 +19,7 @@
 #include <libs/std/string.h>
 #include <mem/alloc.h>
 #include <mem/frame.h>
+#include <mem/heap.h>
 #include <mem/hhdm.h>
 #include <mem/page.h>
 #include <net/core/netdev.h>
@@ -34,6 +35,9 @@
 #define E1000_MAX_FRAME_SIZE    (E1000_MTU + 18)
 #define E1000_WORK_BUDGET       64
 #define E1000_TX_RECLAIM_BUDGET 64
+#define E1000_TX_SEGMENTS       2   // a standard frame spans at most two pages
+#define E1000_RX_OFFSET         NET_PBUF_HEADROOM
+#define E1000_RX_POOL_SIZE      512 // recycled RX pages kept across all devices
 #define E1000_RESET_TIMEOUT_US  100000
 #define E1000_EEPROM_TIMEOUT_US 10000
 
@@ -43,6 +47,15 @@
  * descriptors is set up in DMA memory and programmed through the
  * device's MMIO BAR; interrupts queue work to a worker task that
  * feeds received frames into the net stack and reclaims TX rings.
+ *
+ * Both directions are zero-copy. Each RX descriptor owns a whole page
+ * that is handed up the stack as the pbuf's storage once filled, and
+ * a page from a shared recycle pool takes its place; pbufs return
+ * their pages to the pool when freed. TX descriptors point straight
+ * at pbuf data, one per page it spans, and hold a pbuf reference until
+ * reclaimed, with TCP/UDP checksums left to a context descriptor.
+ * Doorbells are batched: RDT once per poll, TDT once per poll batch
+ * for frames the stack sends while that batch is delivered.
  */
 
 #define E1000_REG_CTRL     0x0000
@@ -72,6 +85,7 @@
 #define E1000_REG_TDT      0x3818
 #define E1000_REG_TIDV     0x3820
 #define E1000_REG_TADV     0x382c
+#define E1000_REG_RXCSUM   0x5000
 #define E1000_REG_RAL0     0x5400
 #define E1000_REG_RAH0     0x5404
 #define E1000_REG_MTA      0x5200
@@ -85,6 +99,8 @@
 #define E1000_RCTL_EN         (1u << 1)
 #define E1000_RCTL_BAM        (1u << 15)
 #define E1000_RCTL_SECRC      (1u << 26)
+#define E1000_RXCSUM_IPOFL    (1u << 8)
+#define E1000_RXCSUM_TUOFL    (1u << 9)
 #define E1000_TCTL_EN         (1u << 1)
 #define E1000_TCTL_PSP        (1u << 3)
 #define E1000_TCTL_CT_SHIFT   4
@@ -100,16 +116,22 @@
 #define E1000_RX_INT_MASK  (E1000_ICR_RXDMT0 | E1000_ICR_RXO | E1000_ICR_RXT0)
 #define E1000_WORK_INITIAL (E1000_ICR_TXDW | E1000_ICR_LSC | E1000_ICR_RXT0)
 
-#define E1000_RXD_STAT_DD  (1u << 0)
-#define E1000_RXD_STAT_EOP (1u << 1)
-#define E1000_TXD_STAT_DD  (1u << 0)
-#define E1000_TXD_STAT_EC  (1u << 1)
-#define E1000_TXD_STAT_LC  (1u << 2)
-#define E1000_TXD_STAT_TU  (1u << 3)
-#define E1000_TXD_ERROR    (E1000_TXD_STAT_EC | E1000_TXD_STAT_LC | E1000_TXD_STAT_TU)
-#define E1000_TXD_CMD_EOP  (1u << 0)
-#define E1000_TXD_CMD_IFCS (1u << 1)
-#define E1000_TXD_CMD_RS   (1u << 3)
+#define E1000_RXD_STAT_DD    (1u << 0)
+#define E1000_RXD_STAT_EOP   (1u << 1)
+#define E1000_RXD_STAT_IXSM  (1u << 2)
+#define E1000_RXD_STAT_TCPCS (1u << 5)
+#define E1000_TXD_STAT_DD    (1u << 0)
+#define E1000_TXD_STAT_EC    (1u << 1)
+#define E1000_TXD_STAT_LC    (1u << 2)
+#define E1000_TXD_STAT_TU    (1u << 3)
+#define E1000_TXD_ERROR      (E1000_TXD_STAT_EC | E1000_TXD_STAT_LC | E1000_TXD_STAT_TU)
+#define E1000_TXD_CMD_EOP    (1u << 0)
+#define E1000_TXD_CMD_IFCS   (1u << 1)
+#define E1000_TXD_CMD_RS     (1u << 3)
+#define E1000_TXD_CMD_DEXT   (1u << 5)
+#define E1000_TXD_DTYP_DATA  0x10 // extended data descriptor, in the cso byte
+#define E1000_TXD_POPTS_TXSM 0x02 // insert the TCP/UDP checksum, in the css byte
+#define E1000_TXC_CMD_IP     (1u << 1)
 
 #define E1000_F_EERD_SMALL (1u << 0)
 #define E1000_F_E1000E     (1u << 1)
@@ -147,6 +169,22 @@ typedef struct {
         uint16_t special;
 } __attribute__((packed, aligned(16))) e1000_tx_desc_t;
 
+/* TCP/IP context descriptor: checksum offsets applied to later extended data descriptors. */
+typedef struct {
+        uint8_t  ipcss;
+        uint8_t  ipcso;
+        uint16_t ipcse;
+        uint8_t  tucss;
+        uint8_t  tucso;
+        uint16_t tucse;
+        uint16_t paylen;
+        uint8_t  dtyp;
+        uint8_t  tucmd;
+        uint8_t  status;
+        uint8_t  hdrlen;
+        uint16_t mss;
+} __attribute__((packed, aligned(16))) e1000_tx_ctx_desc_t;
+
 typedef struct e1000_device {
         pci_device_cache_t       *pci;
         volatile uint8_t         *mmio;
@@ -179,10 +217,17 @@ typedef struct e1000_device {
         uint64_t                  tx_ring_phys;
         uint64_t                  rx_buffer_phys[E1000_RX_COUNT];
         uint64_t                  tx_buffer_phys[E1000_TX_COUNT];
+        net_pbuf_t               *tx_pbuf[E1000_TX_COUNT];
+        uint16_t                  tx_frame_length[E1000_TX_COUNT];
         uint16_t                  rx_next;
         uint16_t                  tx_next;
         uint16_t                  tx_clean;
         uint16_t                  tx_used;
+        uint16_t                  tx_tail;
+        uint8_t                   tx_ctx_start;
+        uint8_t                   tx_ctx_field;
+        int                       tx_ctx_valid;
+        int                       tx_batching;
         int                       rx_dropping;
         spinlock_t                rx_lock;
         spinlock_t                tx_lock;
@@ -198,6 +243,10 @@ static e1000_device_t *e1000_irq_slots[E1000_MAX_DEVICES];
 static spinlock_t      e1000_irq_lock;
 static int             e1000_scheduler_ready;
 
+static uint64_t   e1000_rx_pool[E1000_RX_POOL_SIZE];
+static size_t     e1000_rx_pool_count;
+static spinlock_t e1000_rx_pool_lock;
+
 /* Read a 32-bit MMIO register. */
 static inline uint32_t e1000_read(const e1000_device_t *device, uint32_t reg)
 {
@@ -358,16 +407,47 @@ static int e1000_reset(e1000_device_t *device)
     return -ETIMEDOUT;
 }
 
+/* Take an RX page from the recycle pool, falling back to the frame allocator. */
+static uint64_t e1000_rx_page_get(void)
+{
+    uint64_t page   = 0;
+    uint64_t rflags = spin_lock_irqsave(&e1000_rx_pool_lock);
+    if (e1000_rx_pool_count) page = e1000_rx_pool[--e1000_rx_pool_count];
+    spin_unlock_irqrestore(&e1000_rx_pool_lock, rflags);
+    return page ? page : alloc_frames(1);
+}
+
+/* Return an RX page to the recycle pool, or to the frame allocator once the pool is full. */
+static void e1000_rx_page_put(uint64_t page)
+{
+    uint64_t rflags = spin_lock_irqsave(&e1000_rx_pool_lock);
+    if (e1000_rx_pool_count < E1000_RX_POOL_SIZE) {
+        e1000_rx_pool[e1000_rx_pool_count++] = page;
+        page                                 = 0;
+    }
+    spin_unlock_irqrestore(&e1000_rx_pool_lock, rflags);
+    if (page) free_frames(page, 1);
+}
+
+/* pbuf release hook for received frames, whose storage is a whole RX page. */
+static void e1000_rx_page_release(void *context, void *data)
+{
+    (void)context;
+    e1000_rx_page_put((uint64_t)virt_to_phys((uint64_t)data));
+}
+
 /* Release all ring and buffer pages and reset the DMA pointers. */
 static void e1000_free_dma(e1000_device_t *device)
 {
     for (size_t i = 0; i < E1000_RX_COUNT; i++) {
-        if (device->rx_buffer_phys[i]) free_frames(device->rx_buffer_phys[i], 1);
+        if (device->rx_buffer_phys[i]) e1000_rx_page_put(device->rx_buffer_phys[i]);
         device->rx_buffer_phys[i] = 0;
     }
     for (size_t i = 0; i < E1000_TX_COUNT; i++) {
         if (device->tx_buffer_phys[i]) free_frames(device->tx_buffer_phys[i], 1);
+        if (device->tx_pbuf[i]) net_pbuf_free(device->tx_pbuf[i]);
         device->tx_buffer_phys[i] = 0;
+        device->tx_pbuf[i]        = NULL;
     }
     if (device->rx_ring_phys) free_frames(device->rx_ring_phys, 1);
     if (device->tx_ring_phys) free_frames(device->tx_ring_phys, 1);
@@ -395,12 +475,12 @@ static int e1000_alloc_dma(e1000_device_t *device)
     memset((void *)device->tx_ring, 0, PAGE_4K_SIZE);
 
     for (size_t i = 0; i < E1000_RX_COUNT; i++) {
-        device->rx_buffer_phys[i] = alloc_frames(1);
+        device->rx_buffer_phys[i] = e1000_rx_page_get();
         if (!device->rx_buffer_phys[i]) {
             plogk("e1000: %04x:%04x: RX buffer allocation failed (index %zu)\n", (unsigned)device->pci->vendor_id, (unsigned)device->pci->device_id, i);
             return -ENOMEM;
         }
-        device->rx_ring[i].address = device->rx_buffer_phys[i];
+        device->rx_ring[i].address = device->rx_buffer_phys[i] + E1000_RX_OFFSET;
     }
     for (size_t i = 0; i < E1000_TX_COUNT; i++) {
         device->tx_buffer_phys[i] = alloc_frames(1);
@@ -443,10 +523,13 @@ static void e1000_program_rings(e1000_device_t *device)
     e1000_write(device, E1000_REG_TDT, 0);
     e1000_write(device, E1000_REG_TIDV, 0);
     e1000_write(device, E1000_REG_TADV, 0);
+    device->tx_tail      = 0;
+    device->tx_ctx_valid = 0;
     dma_write_barrier();
 
     e1000_write(device, E1000_REG_TIPG, 8 | (8u << 10) | (6u << 20));
     e1000_write(device, E1000_REG_TCTL, E1000_TCTL_EN | E1000_TCTL_PSP | (0x0fu << E1000_TCTL_CT_SHIFT) | (0x40u << E1000_TCTL_COLD_SHIFT));
+    e1000_write(device, E1000_REG_RXCSUM, E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL);
     e1000_write(device, E1000_REG_RCTL, E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC);
     e1000_write_flush(device);
 }
@@ -468,23 +551,27 @@ static void e1000_update_link(e1000_device_t *device)
     }
 }
 
-/* Reap completed TX descriptors, updating stats, up to a budget. */
+/* Reap completed TX descriptors, dropping pbuf references and counting frames at EOP, up to a budget. */
 static size_t e1000_tx_reclaim_locked(e1000_device_t *device, size_t budget)
 {
     size_t reclaimed = 0;
 
     while (device->tx_used && reclaimed < budget) {
-        volatile e1000_tx_desc_t *desc = &device->tx_ring[device->tx_clean];
+        uint16_t                  idx  = device->tx_clean;
+        volatile e1000_tx_desc_t *desc = &device->tx_ring[idx];
         if (!(desc->status & E1000_TXD_STAT_DD)) break;
         dma_read_barrier();
         if (desc->status & E1000_TXD_ERROR) {
             device->stats.tx_errors++;
             plogk("e1000: %s: TX descriptor error (status=%#x)\n", device->netdev.name, (unsigned)desc->status);
-        } else {
+        } else if (device->tx_frame_length[idx]) {
             device->stats.tx_packets++;
-            device->stats.tx_bytes += desc->length;
+            device->stats.tx_bytes += device->tx_frame_length[idx];
         }
-        device->tx_clean = (device->tx_clean + 1) % E1000_TX_COUNT;
+        if (device->tx_pbuf[idx]) net_pbuf_free(device->tx_pbuf[idx]);
+        device->tx_pbuf[idx]         = NULL;
+        device->tx_frame_length[idx] = 0;
+        device->tx_clean             = (idx + 1) % E1000_TX_COUNT;
         device->tx_used--;
         reclaimed++;
     }
@@ -537,12 +624,14 @@ static void e1000_net_stop(net_device_t *netdev)
     (void)netdev;
 }
 
-/* netdev transmit callback: forward the pbuf to the TX ring. */
+static int e1000_transmit_frame(e1000_device_t *device, const void *data, size_t length, net_pbuf_t *packet);
+
+/* netdev transmit callback: queue the pbuf's data on the TX ring by reference. */
 static int e1000_net_xmit(net_device_t *netdev, net_pbuf_t *packet)
 {
     e1000_device_t *device = netdev_private(netdev);
     if (!packet) return -EINVAL;
-    return e1000_transmit(device, packet->data, packet->length);
+    return e1000_transmit_frame(device, packet->data, packet->length, packet);
 }
 
 /* Only the driver's fixed MTU is supported. */
@@ -559,10 +648,64 @@ static const netdev_ops_t e1000_netdev_ops = {
     .set_mtu = e1000_net_set_mtu,
 };
 
-/* Queue one frame on the TX ring and kick the controller. */
-int e1000_transmit(e1000_device_t *device, const void *packet, size_t length)
+/* Fill the descriptor at tx_next and advance; the caller holds tx_lock and has checked for room. */
+static void e1000_tx_queue_locked(e1000_device_t *device, uint64_t address, size_t length, uint8_t command, uint8_t options, net_pbuf_t *packet, size_t frame_length)
+{
+    uint16_t                  idx  = device->tx_next;
+    volatile e1000_tx_desc_t *desc = &device->tx_ring[idx];
+    desc->address                  = address;
+    desc->length                   = (uint16_t)length;
+    desc->cso                      = (command & E1000_TXD_CMD_DEXT) ? E1000_TXD_DTYP_DATA : 0;
+    desc->command                  = command;
+    desc->css                      = options;
+    desc->special                  = 0;
+    desc->status                   = 0;
+    device->tx_pbuf[idx]           = packet;
+    device->tx_frame_length[idx]   = (uint16_t)frame_length;
+    device->tx_next                = (idx + 1) % E1000_TX_COUNT;
+    device->tx_used++;
+}
+
+/* Load a checksum context for the following frames unless the device already holds this one. */
+static void e1000_tx_context_locked(e1000_device_t *device, uint8_t start, uint8_t field)
 {
-    if (!device || !packet || length == 0) return -EINVAL;
+    if (device->tx_ctx_valid && device->tx_ctx_start == start && device->tx_ctx_field == field) return;
+    uint16_t                      idx = device->tx_next;
+    volatile e1000_tx_ctx_desc_t *ctx = (volatile e1000_tx_ctx_desc_t *)&device->tx_ring[idx];
+    ctx->ipcss                        = 0;
+    ctx->ipcso                        = 0;
+    ctx->ipcse                        = 0;
+    ctx->tucss                        = start;
+    ctx->tucso                        = (uint8_t)(start + field);
+    ctx->tucse                        = 0;
+    ctx->paylen                       = 0;
+    ctx->dtyp                         = 0;
+    ctx->tucmd                        = E1000_TXD_CMD_DEXT | E1000_TXD_CMD_RS | E1000_TXC_CMD_IP;
+    ctx->hdrlen                       = 0;
+    ctx->mss                          = 0;
+    ctx->status                       = 0;
+    device->tx_pbuf[idx]              = NULL;
+    device->tx_frame_length[idx]      = 0;
+    device->tx_next                   = (idx + 1) % E1000_TX_COUNT;
+    device->tx_used++;
+    device->tx_ctx_start = start;
+    device->tx_ctx_field = field;
+    device->tx_ctx_valid = 1;
+}
+
+/* Publish queued descriptors to the controller, unless a poll batch will do it. */
+static void e1000_tx_kick_locked(e1000_device_t *device)
+{
+    if (device->tx_batching || device->tx_tail == device->tx_next) return;
+    dma_write_barrier();
+    e1000_write(device, E1000_REG_TDT, device->tx_next);
+    device->tx_tail = device->tx_next;
+}
+
+/* Queue one frame on the TX ring: by reference when it lives in a pbuf, otherwise through a bounce page. */
+static int e1000_transmit_frame(e1000_device_t *device, const void *data, size_t length, net_pbuf_t *packet)
+{
+    if (!device || !data || length == 0) return -EINVAL;
     if (length > E1000_MAX_FRAME_SIZE) {
         device->stats.tx_dropped++;
         device->stats.tx_errors++;
@@ -572,6 +715,35 @@ int e1000_transmit(e1000_device_t *device, const void *packet, size_t length)
     if (!device->running) return -ENODEV;
     if (!device->link_up) return -ENETDOWN;
 
+    /* Offload a partial checksum only if the device's 8-bit offsets can describe it. */
+    uint8_t options = 0;
+    size_t  start   = 0;
+    if (packet && packet->csum_partial) {
+        start = packet->csum_start - net_pbuf_headroom(packet);
+        if (start + packet->csum_offset + 2 <= length && start + packet->csum_offset <= UINT8_MAX)
+            options = E1000_TXD_POPTS_TXSM;
+        else
+            net_pbuf_checksum_resolve(packet);
+    }
+
+    /* One descriptor per page the frame touches; anything unmappable falls back to the bounce page. */
+    uint64_t segment_phys[E1000_TX_SEGMENTS];
+    size_t   segment_length[E1000_TX_SEGMENTS];
+    size_t   segments = 0;
+    for (size_t offset = 0; packet && offset < length;) {
+        const uint8_t *piece = (const uint8_t *)data + offset;
+        size_t         chunk = PAGE_4K_SIZE - ((uint64_t)piece & (PAGE_4K_SIZE - 1));
+        uint64_t       phys  = (uint64_t)virt_any_to_phys((uint64_t)piece);
+        if (chunk > length - offset) chunk = length - offset;
+        if (!phys || segments == E1000_TX_SEGMENTS) {
+            segments = 0;
+            break;
+        }
+        segment_phys[segments]     = phys;
+        segment_length[segments++] = chunk;
+        offset += chunk;
+    }
+
     uint64_t rflags = spin_lock_irqsave(&device->tx_lock);
     e1000_tx_reclaim_locked(device, E1000_TX_RECLAIM_BUDGET);
     if (!device->running || device->stopping) {
@@ -584,34 +756,96 @@ int e1000_transmit(e1000_device_t *device, const void *packet, size_t length)
     }
 
     /* Keep one descriptor unused so equal head and tail always means empty. */
-    if (device->tx_used == E1000_TX_COUNT - 1) {
+    size_t needed = (segments ? segments : 1) + !!options;
+    if (device->tx_used + needed > E1000_TX_COUNT - 1) {
         device->stats.tx_busy++;
         spin_unlock_irqrestore(&device->tx_lock, rflags);
         return -EAGAIN;
     }
 
-    uint16_t idx = device->tx_next;
-    memcpy(phys_to_virt(device->tx_buffer_phys[idx]), packet, length);
-    device->tx_ring[idx].length  = (uint16_t)length;
-    device->tx_ring[idx].cso     = 0;
-    device->tx_ring[idx].command = E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS;
-    device->tx_ring[idx].css     = 0;
-    device->tx_ring[idx].special = 0;
-    device->tx_ring[idx].status  = 0;
-    device->tx_next              = (idx + 1) % E1000_TX_COUNT;
-    device->tx_used++;
-    dma_write_barrier();
-    e1000_write(device, E1000_REG_TDT, device->tx_next);
+    if (options) e1000_tx_context_locked(device, (uint8_t)start, (uint8_t)packet->csum_offset);
+    uint8_t command = E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS | (options ? E1000_TXD_CMD_DEXT : 0);
+    if (!segments) {
+        uint64_t bounce = device->tx_buffer_phys[device->tx_next];
+        memcpy(phys_to_virt(bounce), data, length);
+        e1000_tx_queue_locked(device, bounce, length, command | E1000_TXD_CMD_EOP, options, NULL, length);
+    } else {
+        /* The pbuf stays referenced until the EOP descriptor is reclaimed. */
+        net_pbuf_ref(packet);
+        for (size_t i = 0; i < segments; i++) {
+            int last = i + 1 == segments;
+            e1000_tx_queue_locked(device, segment_phys[i], segment_length[i], command | (last ? E1000_TXD_CMD_EOP : 0), options, last ? packet : NULL, last ? length : 0);
+        }
+    }
+    e1000_tx_kick_locked(device);
     spin_unlock_irqrestore(&device->tx_lock, rflags);
     return 0;
 }
 
-/* Process completed RX descriptors, delivering frames to the net stack. */
+/* Queue one frame on the TX ring and kick the controller. */
+int e1000_transmit(e1000_device_t *device, const void *packet, size_t length)
+{
+    if (!packet) return -EINVAL;
+    return e1000_transmit_frame(device, packet, length, NULL);
+}
+
+/* Hold back TDT writes while a poll batch is delivered, so the replies it triggers share one doorbell. */
+static void e1000_tx_batch_begin(e1000_device_t *device)
+{
+    uint64_t rflags     = spin_lock_irqsave(&device->tx_lock);
+    device->tx_batching = 1;
+    spin_unlock_irqrestore(&device->tx_lock, rflags);
+}
+
+/* End a poll batch and ring the TX doorbell once for everything it queued. */
+static void e1000_tx_batch_end(e1000_device_t *device)
+{
+    uint64_t rflags     = spin_lock_irqsave(&device->tx_lock);
+    device->tx_batching = 0;
+    if (device->running && !device->stopping) e1000_tx_kick_locked(device);
+    spin_unlock_irqrestore(&device->tx_lock, rflags);
+}
+
+/*
+ * Detach the filled page at descriptor idx as a pbuf and give the
+ * descriptor a fresh page. Returns NULL, leaving the old page in place
+ * for reuse, when either allocation fails.
+ */
+static net_pbuf_t *e1000_rx_take_locked(e1000_device_t *device, uint16_t idx, size_t length, uint8_t status)
+{
+    uint64_t fresh = e1000_rx_page_get();
+    if (!fresh) return NULL;
+    net_pbuf_t *packet = calloc(1, sizeof(*packet));
+    if (!packet) {
+        e1000_rx_page_put(fresh);
+        return NULL;
+    }
+    packet->storage       = phys_to_virt(device->rx_buffer_phys[idx]);
+    packet->data          = packet->storage + E1000_RX_OFFSET;
+    packet->length        = length;
+    packet->capacity      = PAGE_4K_SIZE;
+    packet->refs          = 1;
+    packet->release       = e1000_rx_page_release;
+    packet->external      = 1;
+    packet->csum_verified = (status & E1000_RXD_STAT_TCPCS) && !(status & E1000_RXD_STAT_IXSM);
+
+    device->rx_buffer_phys[idx]  = fresh;
+    device->rx_ring[idx].address = fresh + E1000_RX_OFFSET;
+    return packet;
+}
+
+/*
+ * Process completed RX descriptors. Filled pages are swapped out under
+ * rx_lock, RDT is advanced once for the whole batch, and the frames are
+ * then delivered with the lock dropped.
+ */
 size_t e1000_poll(e1000_device_t *device, size_t budget)
 {
-    size_t  done = 0;
-    uint8_t frame[E1000_MAX_FRAME_SIZE];
+    net_pbuf_t *batch[E1000_WORK_BUDGET];
+    size_t      count = 0;
+    size_t      done  = 0;
     if (!device || !device->running) return 0;
+    if (budget > E1000_WORK_BUDGET) budget = E1000_WORK_BUDGET;
 
     uint64_t rflags = spin_lock_irqsave(&device->rx_lock);
     if (!device->running || device->stopping) {
@@ -625,8 +859,8 @@ size_t e1000_poll(e1000_device_t *device, size_t budget)
         uint8_t status = desc->status;
         if (!(status & E1000_RXD_STAT_DD)) break;
 
-        size_t length       = desc->length;
-        size_t frame_length = 0;
+        size_t      length = desc->length;
+        net_pbuf_t *packet = NULL;
         if (desc->errors || !length || length > E1000_MAX_FRAME_SIZE || !(status & E1000_RXD_STAT_EOP)) {
             /* A standard frame fits one 2 KiB buffer; chained descriptors are jumbo input. */
             if (!device->rx_dropping) {
@@ -639,8 +873,15 @@ size_t e1000_poll(e1000_device_t *device, size_t budget)
             }
             device->rx_dropping = 1;
         } else if (!device->rx_dropping) {
-            memcpy(frame, phys_to_virt(device->rx_buffer_phys[idx]), length);
-            frame_length = length;
+            packet = e1000_rx_take_locked(device, idx, length, status);
+            if (!packet) {
+                static uint64_t last_log;
+                if (sched_ticks() - last_log >= 1000) {
+                    plogk("e1000: %s: RX buffer allocation failed.\n", device->netdev.name);
+                    last_log = sched_ticks();
+                }
+                device->stats.rx_dropped++;
+            }
         }
 
         if (status & E1000_RXD_STAT_EOP) {
@@ -653,35 +894,29 @@ size_t e1000_poll(e1000_device_t *device, size_t budget)
         desc->errors   = 0;
         desc->special  = 0;
         dma_write_barrier();
-        desc->status = 0;
-        dma_write_barrier();
+        desc->status    = 0;
         device->rx_next = (idx + 1) % E1000_RX_COUNT;
-        e1000_write(device, E1000_REG_RDT, idx);
         done++;
+        if (packet) batch[count++] = packet;
+    }
+    if (done) {
+        dma_write_barrier();
+        e1000_write(device, E1000_REG_RDT, (device->rx_next + E1000_RX_COUNT - 1) % E1000_RX_COUNT);
+    }
+    spin_unlock_irqrestore(&device->rx_lock, rflags);
 
-        if (frame_length) {
-            spin_unlock_irqrestore(&device->rx_lock, rflags);
-            net_pbuf_t *packet = net_pbuf_from(frame, frame_length, NET_PBUF_HEADROOM);
-            if (!packet) {
-                static uint64_t last_log;
-                if (sched_ticks() - last_log >= 1000) {
-                    plogk("e1000: %s: RX frame allocation failed.\n", device->netdev.name);
-                    last_log = sched_ticks();
-                }
-                device->stats.rx_dropped++;
-            } else {
-                if (netdev_rx(&device->netdev, packet))
-                    device->stats.rx_dropped++;
-                else {
-                    device->stats.rx_packets++;
-                    device->stats.rx_bytes += frame_length;
-                }
-            }
-            rflags = spin_lock_irqsave(&device->rx_lock);
-            if (!device->running) break;
+    if (!count) return done;
+    e1000_tx_batch_begin(device);
+    for (size_t i = 0; i < count; i++) {
+        size_t length = batch[i]->length;
+        if (netdev_rx(&device->netdev, batch[i]))
+            device->stats.rx_dropped++;
+        else {
+            device->stats.rx_packets++;
+            device->stats.rx_bytes += length;
         }
     }
-    spin_unlock_irqrestore(&device->rx_lock, rflags);
+    e1000_tx_batch_end(device);
     return done;
 }
 
@@ -1023,7 +1258,7 @@ int e1000_probe(pci_device_cache_t *pci)
     if (ret) goto fail;
     memcpy(device->netdev.address, device->mac, sizeof(device->mac));
     device->netdev.mtu   = E1000_MTU;
-    device->netdev.flags = NETDEV_F_BROADCAST;
+    device->netdev.flags = NETDEV_F_BROADCAST | NETDEV_F_TX_CSUM;
     stage                = "netdev registration";
     ret                  = netdev_register(&device->netdev);
     if (ret) goto fail;
@@ -119,6 +119,18 @@ uint64_t tsc_nano_time(void)
     return tsc_epoch_ns + elapsed_ns;
 }
 
+/* Convert a nanosecond interval to TSC cycles, saturating on overflow. */
+uint64_t tsc_ns_to_cycles(uint64_t ns)
+{
+    /* Whole seconds and the sub-second rest separately, so no 128-bit division is needed. */
+    uint64_t seconds = ns / 1000000000ULL;
+    uint64_t rest    = ns % 1000000000ULL;
+    if (tsc_frequency && seconds > UINT64_MAX / tsc_frequency) return UINT64_MAX;
+    uint64_t cycles   = seconds * tsc_frequency;
+    uint64_t fraction = rest * tsc_frequency / 1000000000ULL; // rest < 2^30, fine below 17 GHz
+    return cycles > UINT64_MAX - fraction ? UINT64_MAX : cycles + fraction;
+}
+
 /* Initialize and, when safe, select TSC as the high-resolution clocksource. */
 void tsc_init(void)
 {
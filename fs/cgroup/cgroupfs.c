@@ -305,7 +305,7 @@ static struct vfs_callback callbacks = {
 void cgroupfs_regist(void)
 {
 #if CONFIG_CGROUP
-    cgroupfs_id = vfs_regist_fs_flags("cgroup2", &callbacks, VFS_FS_NODEV);
+    cgroupfs_id = vfs_regist_fs_flags("cgroup2", &callbacks, VFS_FS_NODEV | VFS_FS_DYNAMIC);
     if (cgroupfs_id & ERRNO_MASK)
         plogk("cgroup2: Registration failed (%d)\n", cgroupfs_id);
     else
@@ -8,6 +8,7 @@
  *
  */
 
+#include <drivers/block/core/bio.h>
 #include <fs/core/fs_txn.h>
 #include <kernel/errno.h>
 #include <kernel/printk.h>
@@ -68,15 +69,21 @@ static int fs_txn_home_block_valid(const fs_txn_log_t *log, uint64_t home_block)
     return home_block < log->device.sector_count / sectors_per_block;
 }
 
-/* Write staged buffers matching required_flags to their home blocks. */
-static int fs_txn_write_home(fs_txn_t *transaction, uint32_t required_flags)
+/* Whether a staged buffer takes part in a home write for required_flags. */
+static int fs_txn_home_selected(const fs_txn_buffer_t *buffer, uint32_t required_flags)
+{
+    if (!(buffer->flags & required_flags)) return 0;
+    return !(required_flags == FS_TXN_ORDERED_DATA && (buffer->flags & FS_TXN_METADATA));
+}
+
+/* Write staged buffers matching required_flags to their home blocks, one at a time. */
+static int fs_txn_write_home_sync(fs_txn_t *transaction, uint32_t required_flags)
 {
     fs_txn_buffer_t *buffer;
     fs_txn_log_t    *log = transaction->log;
 
     for (buffer = transaction->buffers; buffer; buffer = buffer->next) {
-        if (!(buffer->flags & required_flags)) continue;
-        if (required_flags == FS_TXN_ORDERED_DATA && (buffer->flags & FS_TXN_METADATA)) continue;
+        if (!fs_txn_home_selected(buffer, required_flags)) continue;
         if (!fs_txn_home_block_valid(log, buffer->home_block)) {
             plogk("fs_txn: Write_home block %llu out of range (block_size %u)\n", (unsigned long long)buffer->home_block, log->block_size);
             return -EIO;
@@ -90,6 +97,56 @@ static int fs_txn_write_home(fs_txn_t *transaction, uint32_t required_flags)
     return EOK;
 }
 
+/*
+ * Write staged buffers matching required_flags to their home blocks.  All
+ * writes are submitted under one plug so adjacent blocks merge into larger
+ * requests and stay in flight together; the first failure is reported.
+ */
+static int fs_txn_write_home(fs_txn_t *transaction, uint32_t required_flags)
+{
+    fs_txn_buffer_t *buffer;
+    fs_txn_log_t    *log   = transaction->log;
+    uint32_t         count = 0;
+
+    for (buffer = transaction->buffers; buffer; buffer = buffer->next) {
+        if (!fs_txn_home_selected(buffer, required_flags)) continue;
+        if (!fs_txn_home_block_valid(log, buffer->home_block)) {
+            plogk("fs_txn: Write_home block %llu out of range (block_size %u)\n", (unsigned long long)buffer->home_block, log->block_size);
+            return -EIO;
+        }
+        count++;
+    }
+    if (!count) return EOK;
+
+    bio_t *bios = calloc(count, sizeof(bio_t));
+    if (!bios) return fs_txn_write_home_sync(transaction, required_flags);
+
+    uint64_t   sectors_per_block = log->block_size / log->device.sector_size;
+    uint32_t   index             = 0;
+    blk_plug_t plug;
+    blk_start_plug(&plug);
+    for (buffer = transaction->buffers; buffer; buffer = buffer->next) {
+        if (!fs_txn_home_selected(buffer, required_flags)) continue;
+        bio_t *bio = &bios[index++];
+        bio_init(bio, &log->device, BIO_WRITE, buffer->home_block * sectors_per_block);
+        bio->private_data = buffer;
+        (void)bio_add_vec(bio, buffer->data, log->block_size);
+        bio_submit(bio);
+    }
+    blk_finish_plug(&plug);
+
+    int result = EOK;
+    for (index = 0; index < count; index++) {
+        int status = bio_wait(&bios[index]);
+        if (status == EOK) continue;
+        buffer = bios[index].private_data;
+        plogk("fs_txn: Write_home block %llu write failed (drive %u, status %d)\n", (unsigned long long)buffer->home_block, log->device.drive, status);
+        if (result == EOK) result = status;
+    }
+    free(bios);
+    return result;
+}
+
 /* Release the transaction's buffers and mark the log inactive. */
 static void fs_txn_finish(fs_txn_t *transaction)
 {
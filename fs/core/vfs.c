@@ -8,6 +8,8 @@
  *
  */
 
+#include <arch/common.h>
+#include <arch/smp.h>
 #include <fs/core/inotify.h>
 #include <fs/core/vfs.h>
 #include <kernel/errno.h>
@@ -490,12 +492,329 @@ static vfs_node_t vfs_child_append(vfs_node_t parent, const char *name, void *ha
     return node;
 }
 
+/*
+ * Name cache for path lookup.  Entries map (parent, name) either to a child
+ * node or, as negative entries, to a recorded miss.  A positive entry is
+ * re-validated against the node it names, so renames and unlinks need no
+ * hooks beyond the node dropping its entry before it is freed.  A negative
+ * entry only holds while its parent's dcache_gen is unchanged; every path
+ * that can make a child name appear moves that generation on.  Generations
+ * are unique across nodes, so a directory reallocated at the same address
+ * never inherits stale misses.  Updates are serialized by vfs_namespace_lock;
+ * chains are published with release stores so lock-free walks can read them.
+ * The bucket table doubles once chains average VFS_DCACHE_LOAD entries, and
+ * the entry count is capped in proportion to memory; only at that cap does
+ * an insert evict, taking the oldest entry of the bucket under a clock hand.
+ */
+#    define VFS_DCACHE_BUCKETS         1024U // initial bucket count, power of two
+#    define VFS_DCACHE_LOAD            2U    // average chain length that triggers a resize
+#    define VFS_DCACHE_FRAMES_PER_NAME 4U    // one cached name per this many physical frames
+
+typedef struct vfs_dentry {
+        struct vfs_dentry *next;
+        vfs_node_t         parent;
+        vfs_node_t         node;          // NULL for a negative entry
+        uint64_t           gen;           // parent->dcache_gen a negative entry was recorded at
+        struct vfs_dentry *retired_next;  // Dropped entry awaiting the end of lock-free walks
+        uint64_t           retired_epoch; // Walk epoch the entry was dropped at
+        uint32_t           hash;
+        char               name[];
+} vfs_dentry_t;
+
+typedef struct vfs_dcache_table {
+        vfs_dentry_t           **buckets;
+        uint32_t                 mask;
+        struct vfs_dcache_table *retired_next;  // Replaced table awaiting the end of lock-free walks
+        uint64_t                 retired_epoch; // Walk epoch the table was replaced at
+} vfs_dcache_table_t;
+
+static vfs_dentry_t       *vfs_dcache_inline[VFS_DCACHE_BUCKETS];
+static vfs_dcache_table_t  vfs_dcache_boot     = {.buckets = vfs_dcache_inline, .mask = VFS_DCACHE_BUCKETS - 1};
+static vfs_dcache_table_t *vfs_dcache          = &vfs_dcache_boot;
+static size_t              vfs_dcache_limit    = (size_t)VFS_DCACHE_BUCKETS * VFS_DCACHE_LOAD; // entries before inserts evict; raised from memory size at init
+static uint64_t            vfs_dcache_next_gen = 1;
+static size_t              vfs_dcache_count;
+static uint32_t            vfs_dcache_hand; // next bucket to evict from
+
+/*
+ * Lock-free path walks.  Namespace changes which hide or move a name run
+ * inside vfs_namespace_write_begin()/end() under vfs_namespace_lock, keeping
+ * vfs_namespace_seq odd meanwhile.  A walk samples the count before reading
+ * the tree and only trusts its result if the count is unchanged once it holds
+ * the lock for the final reference.  Nodes and name-cache entries are freed
+ * through walk epochs: a walker publishes the epoch it started in on its CPU
+ * slot with interrupts off, and retired objects are released once every
+ * active slot has moved past the epoch they were retired at.
+ */
+#    define VFS_WALK_MAX_CPUS      256U
+#    define VFS_WALK_RECLAIM_BATCH 64U // retired objects before a reclaim pass
+
+typedef struct {
+        uint64_t epoch; // 0 while no walk is in progress
+        uint8_t  pad[56];
+} vfs_walk_slot_t;
+
+static vfs_walk_slot_t     vfs_walk_slots[VFS_WALK_MAX_CPUS];
+static uint64_t            vfs_walk_epoch = 1;
+static uint64_t            vfs_namespace_seq;
+static vfs_node_t          vfs_retired_nodes;
+static vfs_dentry_t       *vfs_retired_dentries;
+static vfs_dcache_table_t *vfs_retired_tables;
+static size_t              vfs_retired_count;
+
+/* Open a namespace change lock-free walks must not straddle (namespace lock held). */
+static void vfs_namespace_write_begin(void)
+{
+    __atomic_add_fetch(&vfs_namespace_seq, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Close a namespace change (namespace lock held). */
+static void vfs_namespace_write_end(void)
+{
+    __atomic_add_fetch(&vfs_namespace_seq, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Oldest walk epoch a lock-free walker may still be reading under. */
+static uint64_t vfs_walk_oldest(void)
+{
+    uint64_t oldest = __atomic_load_n(&vfs_walk_epoch, __ATOMIC_SEQ_CST);
+    for (uint32_t cpu = 0; cpu < VFS_WALK_MAX_CPUS; cpu++) {
+        uint64_t epoch = __atomic_load_n(&vfs_walk_slots[cpu].epoch, __ATOMIC_SEQ_CST);
+        if (epoch && epoch < oldest) oldest = epoch;
+    }
+    return oldest;
+}
+
+/* Free retired objects no walker can still reach (namespace lock held). */
+static void vfs_walk_reclaim_locked(void)
+{
+    uint64_t oldest = vfs_walk_oldest();
+
+    for (vfs_node_t *link = &vfs_retired_nodes; *link;) {
+        vfs_node_t node = *link;
+        if (node->retired_epoch >= oldest) {
+            link = &node->retired_next;
+            continue;
+        }
+        *link = node->retired_next;
+        vfs_retired_count--;
+        free(node);
+    }
+    for (vfs_dentry_t **link = &vfs_retired_dentries; *link;) {
+        vfs_dentry_t *entry = *link;
+        if (entry->retired_epoch >= oldest) {
+            link = &entry->retired_next;
+            continue;
+        }
+        *link = entry->retired_next;
+        vfs_retired_count--;
+        free(entry);
+    }
+    for (vfs_dcache_table_t **link = &vfs_retired_tables; *link;) {
+        vfs_dcache_table_t *table = *link;
+        if (table->retired_epoch >= oldest) {
+            link = &table->retired_next;
+            continue;
+        }
+        *link = table->retired_next;
+        vfs_retired_count--;
+        free(table);
+    }
+}
+
+/* Queue an unreachable node for freeing after current walks (namespace lock held). */
+static void vfs_walk_retire_node(vfs_node_t node)
+{
+    node->retired_epoch = __atomic_fetch_add(&vfs_walk_epoch, 1, __ATOMIC_SEQ_CST);
+    node->retired_next  = vfs_retired_nodes;
+    vfs_retired_nodes   = node;
+    if (++vfs_retired_count >= VFS_WALK_RECLAIM_BATCH) vfs_walk_reclaim_locked();
+}
+
+/* Queue an unlinked name-cache entry for freeing after current walks (namespace lock held). */
+static void vfs_walk_retire_dentry(vfs_dentry_t *entry)
+{
+    entry->retired_epoch = __atomic_fetch_add(&vfs_walk_epoch, 1, __ATOMIC_SEQ_CST);
+    entry->retired_next  = vfs_retired_dentries;
+    vfs_retired_dentries = entry;
+    if (++vfs_retired_count >= VFS_WALK_RECLAIM_BATCH) vfs_walk_reclaim_locked();
+}
+
+/* Queue a replaced name-cache table for freeing after current walks (namespace lock held). */
+static void vfs_walk_retire_table(vfs_dcache_table_t *table)
+{
+    table->retired_epoch = __atomic_fetch_add(&vfs_walk_epoch, 1, __ATOMIC_SEQ_CST);
+    table->retired_next  = vfs_retired_tables;
+    vfs_retired_tables   = table;
+    if (++vfs_retired_count >= VFS_WALK_RECLAIM_BATCH) vfs_walk_reclaim_locked();
+}
+
+/* Hash a child name together with its parent directory. */
+static uint32_t vfs_dcache_hash(vfs_node_t parent, const char *name, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t)(uintptr_t)parent;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ (uint8_t)name[i]) * 1099511628211ULL;
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/* vfs_dcache_invalidate - drop cached lookup misses in a directory */
+void vfs_dcache_invalidate(vfs_node_t dir)
+{
+    if (dir) __atomic_store_n(&dir->dcache_gen, __atomic_add_fetch(&vfs_dcache_next_gen, 1, __ATOMIC_RELAXED), __ATOMIC_RELEASE);
+}
+
+/* Unlink and retire the entry at link (namespace lock held). */
+static void vfs_dcache_drop(vfs_dentry_t **link)
+{
+    vfs_dentry_t *entry = *link;
+
+    __atomic_store_n(link, entry->next, __ATOMIC_RELEASE);
+    if (entry->node) entry->node->dentry = NULL;
+    vfs_dcache_count--;
+    vfs_walk_retire_dentry(entry);
+}
+
+/* Drop the entry resolving to a node (namespace lock held). */
+static void vfs_dcache_forget_locked(vfs_node_t node)
+{
+    vfs_dentry_t *entry = node->dentry;
+    if (!entry) return;
+
+    for (vfs_dentry_t **link = &vfs_dcache->buckets[entry->hash & vfs_dcache->mask]; *link; link = &(*link)->next) {
+        if (*link != entry) continue;
+        vfs_dcache_drop(link);
+        return;
+    }
+}
+
+/* Whether a child is visible to pathname lookup. */
+static bool vfs_child_visible(vfs_node_t node)
+{
+    return !(node->flags & (VFS_NODE_FINALIZING | VFS_NODE_UNLINKING | VFS_NODE_UNLINKED | VFS_NODE_INITIALIZING)) && !(node->type & file_delete);
+}
+
+/* Resolve a name from the cache; *hit reports whether the cache could answer. */
+static vfs_node_t vfs_dcache_lookup(vfs_node_t parent, const char *name, uint32_t hash, bool *hit)
+{
+    *hit = false;
+    for (vfs_dentry_t **link = &vfs_dcache->buckets[hash & vfs_dcache->mask]; *link; link = &(*link)->next) {
+        vfs_dentry_t *entry = *link;
+        if (entry->hash != hash || entry->parent != parent || !streq(entry->name, name)) continue;
+
+        vfs_node_t node = entry->node;
+        if (node ? node->parent == parent && vfs_child_visible(node) && streq(node->name, name) : entry->gen == parent->dcache_gen) {
+            *hit = true;
+            return node;
+        }
+        vfs_dcache_drop(link);
+        return NULL;
+    }
+    return NULL;
+}
+
+/*
+ * Resolve one component from the cache without the namespace lock (walk
+ * epoch held).  Only positive entries are trusted; node names are not read,
+ * since a rename drops the node's entry before the new name is visible.  A
+ * walk racing a resize may miss an entry and falls back to the locked path.
+ */
+static vfs_node_t vfs_dcache_lookup_rcu(vfs_node_t parent, const char *name, size_t length)
+{
+    uint32_t            hash  = vfs_dcache_hash(parent, name, length);
+    vfs_dcache_table_t *table = __atomic_load_n(&vfs_dcache, __ATOMIC_ACQUIRE);
+
+    for (vfs_dentry_t *entry = __atomic_load_n(&table->buckets[hash & table->mask], __ATOMIC_ACQUIRE); entry; entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE)) {
+        if (entry->hash != hash || entry->parent != parent || memcmp(entry->name, name, length) || entry->name[length]) continue;
+
+        vfs_node_t node = entry->node;
+        if (node && __atomic_load_n(&node->parent, __ATOMIC_ACQUIRE) == parent && vfs_child_visible(node)) return node;
+        return NULL;
+    }
+    return NULL;
+}
+
+/*
+ * Double the bucket table (namespace lock held).  Entries are relinked in
+ * place; a lock-free walk still on the old table may be led into a new chain
+ * and miss, which only sends it down the locked path.
+ */
+static void vfs_dcache_grow_locked(void)
+{
+    vfs_dcache_table_t *old   = vfs_dcache;
+    uint32_t            count = (old->mask + 1) * 2;
+    vfs_dcache_table_t *table = malloc(sizeof(vfs_dcache_table_t) + count * sizeof(vfs_dentry_t *));
+    if (!table) return;
+
+    table->buckets = (vfs_dentry_t **)(table + 1);
+    table->mask    = count - 1;
+    memset(table->buckets, 0, count * sizeof(vfs_dentry_t *));
+    for (uint32_t i = 0; i <= old->mask; i++) {
+        for (vfs_dentry_t *entry = old->buckets[i], *next; entry; entry = next) {
+            vfs_dentry_t **head = &table->buckets[entry->hash & table->mask];
+            next                = entry->next;
+            __atomic_store_n(&entry->next, *head, __ATOMIC_RELEASE);
+            *head = entry;
+        }
+    }
+    __atomic_store_n(&vfs_dcache, table, __ATOMIC_RELEASE);
+    if (old != &vfs_dcache_boot) vfs_walk_retire_table(old);
+}
+
+/* Evict the oldest entry of the next non-empty bucket under the clock hand (namespace lock held). */
+static void vfs_dcache_evict_locked(void)
+{
+    for (uint32_t scanned = 0; scanned <= vfs_dcache->mask; scanned++) {
+        vfs_dentry_t **link = &vfs_dcache->buckets[vfs_dcache_hand & vfs_dcache->mask];
+        vfs_dcache_hand++;
+        if (!*link) continue;
+        while ((*link)->next) link = &(*link)->next;
+        vfs_dcache_drop(link);
+        return;
+    }
+}
+
+/* Record a lookup result, evicting only once the cache is at its size limit (namespace lock held). */
+static void vfs_dcache_insert(vfs_node_t parent, const char *name, uint32_t hash, vfs_node_t node)
+{
+    size_t        length = strlen(name);
+    vfs_dentry_t *entry  = malloc(sizeof(vfs_dentry_t) + length + 1);
+    if (!entry) return;
+
+    if (node) vfs_dcache_forget_locked(node);
+    if (vfs_dcache_count >= vfs_dcache_limit) vfs_dcache_evict_locked();
+    if (vfs_dcache_count >= (size_t)(vfs_dcache->mask + 1) * VFS_DCACHE_LOAD) vfs_dcache_grow_locked();
+    entry->parent = parent;
+    entry->node   = node;
+    entry->gen    = parent->dcache_gen;
+    entry->hash   = hash;
+    memcpy(entry->name, name, length + 1);
+
+    vfs_dentry_t **head = &vfs_dcache->buckets[hash & vfs_dcache->mask];
+    entry->next         = *head;
+    __atomic_store_n(head, entry, __ATOMIC_RELEASE);
+    if (node) node->dentry = entry;
+    vfs_dcache_count++;
+}
+
+/* Clear transient hiding flags; names may reappear in and below the node. */
+static void vfs_node_reveal(vfs_node_t node, uint64_t flags)
+{
+    node->flags &= ~flags;
+    vfs_dcache_invalidate(node);
+    vfs_dcache_invalidate(node->parent);
+}
+
 /* Find a child node by name within a parent directory */
 static vfs_node_t vfs_child_find(vfs_node_t parent, const char *name)
 {
-    return clist_first(parent->child, data,
-                       !(((vfs_node_t)data)->flags & (VFS_NODE_FINALIZING | VFS_NODE_UNLINKING | VFS_NODE_UNLINKED | VFS_NODE_INITIALIZING)) && !(((vfs_node_t)data)->type & file_delete)
-                           && streq(name, ((vfs_node_t)data)->name));
+    bool       hit;
+    uint32_t   hash = vfs_dcache_hash(parent, name, strlen(name));
+    vfs_node_t node = vfs_dcache_lookup(parent, name, hash, &hit);
+    if (hit) return node;
+
+    node = clist_first(parent->child, data, vfs_child_visible((vfs_node_t)data) && streq(name, ((vfs_node_t)data)->name));
+    vfs_dcache_insert(parent, name, hash, node);
+    return node;
 }
 
 /*
@@ -553,8 +872,12 @@ vfs_node_t vfs_node_alloc(vfs_node_t parent, const char *name)
     node->linkto     = 0;
     node->createtime = node->readtime = node->writetime = vfs_now_seconds();
     vfs_poll_source_init(&node->poll_source);
+    vfs_dcache_invalidate(node);
 
-    if (parent) parent->child = clist_prepend(parent->child, node);
+    if (parent) {
+        parent->child = clist_prepend(parent->child, node);
+        vfs_dcache_invalidate(parent);
+    }
     return node;
 }
 
@@ -677,11 +1000,83 @@ err:
     return 0;
 }
 
+/* Whether a node belongs to a filesystem whose children are regenerated by stat. */
+static bool vfs_fs_dynamic(vfs_node_t node)
+{
+    return node->fsid < 256 && (fs_flags[node->fsid] & VFS_FS_DYNAMIC);
+}
+
+/*
+ * Resolve a path from the name cache without taking per-component locks or
+ * references.  Any case the locked walk handles differently (a cache miss, a
+ * symlink to follow, a dynamic filesystem, an error to report, or a namespace
+ * change in flight) returns NULL so the caller falls back to that walk.  The
+ * only shared write is the final reference, taken in one short namespace-lock
+ * section because vfs_close() decides the last release under that lock.
+ */
+static vfs_node_t vfs_open_fast(const char *str, bool follow_final)
+{
+    if (!str || str[0] != '/' || !rootdir) return NULL;
+
+    uint64_t rflags = get_rflags();
+    disable_intr();
+    uint32_t cpu = get_current_cpu_id();
+    if (cpu >= VFS_WALK_MAX_CPUS) {
+        if (rflags & (1ULL << 9)) enable_intr();
+        return NULL;
+    }
+    vfs_walk_slot_t *slot = &vfs_walk_slots[cpu];
+    __atomic_store_n(&slot->epoch, __atomic_load_n(&vfs_walk_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint64_t    seq     = __atomic_load_n(&vfs_namespace_seq, __ATOMIC_ACQUIRE);
+    vfs_node_t  current = rootdir;
+    vfs_node_t  result  = NULL;
+    const char *cursor  = str;
+    if (seq & 1) goto out;
+
+    for (;;) {
+        while (*cursor == '/') cursor++;
+        if (*cursor == '\0') break;
+
+        const char *name = cursor;
+        while (*cursor != '\0' && *cursor != '/') cursor++;
+        size_t length = (size_t)(cursor - name);
+
+        if (!(current->type & file_dir) || vfs_fs_dynamic(current) || vfs_access_check(current, VFS_ACCESS_X) != EOK) goto out;
+        if (length == 1 && name[0] == '.') continue;
+        if (length == 2 && name[0] == '.' && name[1] == '.') {
+            vfs_node_t parent = __atomic_load_n(&current->parent, __ATOMIC_ACQUIRE);
+            if (parent) current = parent;
+            continue;
+        }
+
+        current = vfs_dcache_lookup_rcu(current, name, length);
+        if (!current) goto out;
+        if ((current->type & file_symlink) && (follow_final || *cursor != '\0')) goto out;
+    }
+    if ((cursor[-1] == '/' && !(current->type & file_dir)) || vfs_fs_dynamic(current)) goto out;
+
+    spin_lock(&vfs_namespace_lock);
+    if (vfs_namespace_seq == seq && (current == rootdir || vfs_child_visible(current))) {
+        do_update(current);
+        current->refcount++;
+        result = current;
+    }
+    spin_unlock(&vfs_namespace_lock);
+out:
+    __atomic_store_n(&slot->epoch, 0, __ATOMIC_RELEASE);
+    if (rflags & (1ULL << 9)) enable_intr();
+    return result;
+}
+
 /* Open a file or directory by path. */
 vfs_node_t vfs_open(const char *str)
 {
+    vfs_node_t node = vfs_open_fast(str, true);
+    if (node) return node;
     spin_lock(&vfs_namespace_lock);
-    vfs_node_t node = vfs_open_internal(str, 0, true, NULL);
+    node = vfs_open_internal(str, 0, true, NULL);
     spin_unlock(&vfs_namespace_lock);
     return node;
 }
@@ -689,8 +1084,13 @@ vfs_node_t vfs_open(const char *str)
 /* Open a file or directory by path, reporting lookup errors. */
 vfs_node_t vfs_open_checked(const char *str, int *error)
 {
+    vfs_node_t node = vfs_open_fast(str, true);
+    if (node) {
+        if (error) *error = EOK;
+        return node;
+    }
     spin_lock(&vfs_namespace_lock);
-    vfs_node_t node = vfs_open_internal(str, 0, true, error);
+    node = vfs_open_internal(str, 0, true, error);
     spin_unlock(&vfs_namespace_lock);
     return node;
 }
@@ -698,8 +1098,10 @@ vfs_node_t vfs_open_checked(const char *str, int *error)
 /* Open a path without following the final symlink component. */
 vfs_node_t vfs_open_nofollow(const char *str)
 {
+    vfs_node_t node = vfs_open_fast(str, false);
+    if (node) return node;
     spin_lock(&vfs_namespace_lock);
-    vfs_node_t node = vfs_open_internal(str, 0, false, NULL);
+    node = vfs_open_internal(str, 0, false, NULL);
     spin_unlock(&vfs_namespace_lock);
     return node;
 }
@@ -707,8 +1109,13 @@ vfs_node_t vfs_open_nofollow(const char *str)
 /* Open a path without following the final symlink, reporting errors. */
 vfs_node_t vfs_open_nofollow_checked(const char *str, int *error)
 {
+    vfs_node_t node = vfs_open_fast(str, false);
+    if (node) {
+        if (error) *error = EOK;
+        return node;
+    }
     spin_lock(&vfs_namespace_lock);
-    vfs_node_t node = vfs_open_internal(str, 0, false, error);
+    node = vfs_open_internal(str, 0, false, error);
     spin_unlock(&vfs_namespace_lock);
     return node;
 }
@@ -829,7 +1236,7 @@ static vfs_node_t vfs_reserve_child(vfs_node_t parent, const char *name, int *st
 static void vfs_publish_child(vfs_node_t node)
 {
     spin_lock(&vfs_namespace_lock);
-    node->flags &= ~VFS_NODE_INITIALIZING;
+    vfs_node_reveal(node, VFS_NODE_INITIALIZING);
     spin_unlock(&vfs_namespace_lock);
 }
 
@@ -1217,7 +1624,7 @@ static int vfs_mount_id(const char *src, vfs_node_t node, int fsid)
     char       *source_copy    = strdup(display_source);
     if (!source_copy) {
         spin_lock(&vfs_namespace_lock);
-        node->flags &= ~VFS_NODE_INITIALIZING;
+        vfs_node_reveal(node, VFS_NODE_INITIALIZING);
         spin_unlock(&vfs_namespace_lock);
         return -ENOMEM;
     }
@@ -1234,7 +1641,7 @@ static int vfs_mount_id(const char *src, vfs_node_t node, int fsid)
         node->root     = node;
         node->is_mount = 1;
         spin_lock(&vfs_namespace_lock);
-        node->flags &= ~VFS_NODE_INITIALIZING;
+        vfs_node_reveal(node, VFS_NODE_INITIALIZING);
         spin_unlock(&vfs_namespace_lock);
         return EOK;
     }
@@ -1242,7 +1649,7 @@ static int vfs_mount_id(const char *src, vfs_node_t node, int fsid)
     free(source_copy);
     node->fsid = old_fsid;
     spin_lock(&vfs_namespace_lock);
-    node->flags &= ~VFS_NODE_INITIALIZING;
+    vfs_node_reveal(node, VFS_NODE_INITIALIZING);
     spin_unlock(&vfs_namespace_lock);
     return status;
 }
@@ -1342,7 +1749,7 @@ int vfs_umount(const char *path)
     node->is_mount     = 0;
     if (node->fsid) do_update(node);
     spin_lock(&vfs_namespace_lock);
-    node->flags &= ~VFS_NODE_INITIALIZING;
+    vfs_node_reveal(node, VFS_NODE_INITIALIZING);
     spin_unlock(&vfs_namespace_lock);
     vfs_close(node);
     return EOK;
@@ -1564,6 +1971,30 @@ int64_t vfs_file_read(vfs_node_t file, void *private_data, uint64_t flags, void
     return vfs_file_read_process(file, private_data, flags, addr, offset, size, process_current());
 }
 
+/*
+ * Hand the cached pages backing [offset, offset + size) of a regular file to
+ * actor, one locked span at a time, so splice and sendfile can take buffer
+ * pins on them instead of copying.  Files without a page cache return
+ * -EOPNOTSUPP and are left to the copying paths.
+ */
+int64_t vfs_file_read_pages(vfs_node_t file, uint64_t offset, size_t size, int (*actor)(void *context, pagecache_page_t *page, void *data, size_t count), void *context, process_t *proc)
+{
+    if (!file || !actor) return -EINVAL;
+    if (vfs_access_check_process(file, VFS_ACCESS_R, proc)) return -EACCES;
+    do_update(file);
+    if (file->type & file_dir) return -EISDIR;
+
+    pagecache_mapping_t *mapping = vfs_pagecache_mapping(file, 1);
+    if (!mapping) return -EOPNOTSUPP;
+
+    int64_t result = pagecache_read_iter(mapping, offset, size, actor, context);
+    if (result > 0) {
+        vfs_touch_access(file);
+        inotify_notify(file, IN_ACCESS);
+    }
+    return result;
+}
+
 /* Write to a file node as a specific process, enforcing its permissions. */
 int64_t vfs_file_write_process(vfs_node_t file, void *private_data, uint64_t flags, const void *addr, size_t offset, size_t size, process_t *proc)
 {
@@ -1610,10 +2041,76 @@ int64_t vfs_file_write(vfs_node_t file, void *private_data, uint64_t flags, cons
 
 #    define VFS_USER_IO_CHUNK PAGE_4K_SIZE
 
+/* A user buffer being filled or drained by page-cache spans. */
+typedef struct {
+        process_t *proc;
+        uintptr_t  user;  // next user byte to copy
+        bool       fault; // a span hit a user page that is not present
+} vfs_user_span_t;
+
+/* Copy a locked cached span to user memory without resolving faults. */
+static int vfs_span_to_user(void *context, pagecache_page_t *page, void *data, size_t count)
+{
+    (void)page;
+    vfs_user_span_t *span = context;
+    if (copy_to_user_process_nofault(span->proc, (void *)span->user, data, count)) {
+        span->fault = true;
+        return -EFAULT;
+    }
+    span->user += count;
+    return EOK;
+}
+
+/* Copy user memory into a locked cached span without resolving faults. */
+static int vfs_span_from_user(void *context, pagecache_page_t *page, void *data, size_t count)
+{
+    (void)page;
+    vfs_user_span_t *span = context;
+    if (copy_from_user_process_nofault(span->proc, data, (const void *)span->user, count)) {
+        span->fault = true;
+        return -EFAULT;
+    }
+    span->user += count;
+    return EOK;
+}
+
+/*
+ * Move bytes between a mapping and a user buffer with no staging copy.  The
+ * spans are copied under their page locks without resolving faults; when a
+ * user page is missing the walk stops, the page is faulted in (which may
+ * sleep) with no page locked, and the walk resumes where it stopped.
+ */
+static int64_t vfs_cache_user_io(pagecache_mapping_t *mapping, uintptr_t addr, size_t offset, size_t size, bool write, process_t *proc)
+{
+    vfs_user_span_t span    = {.proc = proc, .user = addr};
+    size_t          done    = 0;
+    bool            faulted = false;
+
+    while (done < size) {
+        size_t want = size - done;
+        span.fault  = false;
+        int64_t ret = write ? pagecache_write_iter(mapping, offset + done, want, vfs_span_from_user, &span) : pagecache_read_iter(mapping, offset + done, want, vfs_span_to_user, &span);
+        if (ret > 0) {
+            done += (size_t)ret;
+            faulted = false;
+        }
+        if (span.fault) {
+            size_t fault_size = size - done < PAGE_4K_SIZE ? size - done : PAGE_4K_SIZE;
+            if (faulted || !user_access_ok_process(proc, (const void *)span.user, fault_size, !write)) return done ? (int64_t)done : -EFAULT;
+            faulted = true;
+            continue;
+        }
+        if (ret < 0) return done ? (int64_t)done : ret;
+        if ((size_t)ret < want) break;
+    }
+    return (int64_t)done;
+}
+
 /*
  * Userspace I/O is carried through VFS instead of being unconditionally
  * bounced by the syscall layer.  Filesystems that understand user buffers
- * (pipes and no-copy devices) can consume them directly; all existing
+ * (pipes and no-copy devices) can consume them directly, page-cached files
+ * copy straight between cached pages and the user buffer, and all other
  * callbacks retain their old semantics through this bounded fallback.
  */
 int64_t vfs_file_read_user_process(vfs_node_t file, void *private_data, uint64_t flags, void *addr, size_t offset, size_t size, process_t *proc)
@@ -1660,6 +2157,19 @@ int64_t vfs_file_read_user_process(vfs_node_t file, void *private_data, uint64_t
 
     if (!size) return 0;
 
+    if (mapping) {
+        if (vfs_access_check_process(file, VFS_ACCESS_R, proc)) return -EACCES;
+        do_update(file);
+        if (file->type & file_dir) return -EISDIR;
+
+        int64_t ret = vfs_cache_user_io(mapping, (uintptr_t)addr, offset, size, false, proc);
+        if (ret > 0) {
+            vfs_touch_access(file);
+            inotify_notify(file, IN_ACCESS);
+        }
+        return ret;
+    }
+
     size_t   capacity = size < VFS_USER_IO_CHUNK ? size : VFS_USER_IO_CHUNK;
     uint8_t *tmp      = malloc(capacity);
     if (!tmp) return -ENOMEM;
@@ -1734,6 +2244,28 @@ int64_t vfs_file_write_user_process(vfs_node_t file, void *private_data, uint64_
         return vfs_file_write_process(file, private_data, flags, &empty, offset, 0, proc);
     }
 
+    if (mapping) {
+        if (file->flags & VFS_NODE_SWAPFILE) return -EBUSY;
+        if (vfs_access_check_process(file, VFS_ACCESS_W, proc)) return -EACCES;
+        do_update(file);
+        if (file->type & file_dir) return -EISDIR;
+
+        int64_t ret = vfs_cache_user_io(mapping, (uintptr_t)addr, offset, size, true, proc);
+        file->size  = pagecache_size(mapping);
+        if (ret > 0 && (flags & 0x101000U)) {
+            int sync_result = pagecache_writeback(mapping, offset, offset + (size_t)ret - 1, PAGECACHE_WB_SYNC);
+            if (sync_result) {
+                plogk("vfs: Writeback of %s failed (%d)\n", file->name, sync_result);
+                ret = sync_result;
+            }
+        }
+        if (ret > 0) {
+            vfs_touch_modify(file);
+            inotify_notify(file, IN_MODIFY);
+        }
+        return ret;
+    }
+
     size_t   capacity = size < VFS_USER_IO_CHUNK ? size : VFS_USER_IO_CHUNK;
     uint8_t *tmp      = malloc(capacity);
     if (!tmp) return -ENOMEM;
@@ -2113,7 +2645,7 @@ int vfs_close(vfs_node_t node)
         spin_unlock(&vfs_namespace_lock);
         if (not_empty) {
             spin_lock(&vfs_namespace_lock);
-            node->flags &= ~VFS_NODE_FINALIZING;
+            vfs_node_reveal(node, VFS_NODE_FINALIZING);
             spin_unlock(&vfs_namespace_lock);
             return -ENOTEMPTY;
         }
@@ -2123,7 +2655,7 @@ int vfs_close(vfs_node_t node)
         int result = pagecache_writeback(node->mapping, 0, UINT64_MAX, PAGECACHE_WB_SYNC);
         if (result) {
             spin_lock(&vfs_namespace_lock);
-            node->flags &= ~VFS_NODE_FINALIZING;
+            vfs_node_reveal(node, VFS_NODE_FINALIZING);
             spin_unlock(&vfs_namespace_lock);
             return result;
         }
@@ -2133,7 +2665,7 @@ int vfs_close(vfs_node_t node)
         int res = node->parent ? callbackof(node, delete)(node->parent->handle, node) : EOK;
         if (res < 0) {
             spin_lock(&vfs_namespace_lock);
-            node->flags &= ~VFS_NODE_FINALIZING;
+            vfs_node_reveal(node, VFS_NODE_FINALIZING);
             spin_unlock(&vfs_namespace_lock);
             return res;
         }
@@ -2148,6 +2680,7 @@ int vfs_close(vfs_node_t node)
     callbackof(node, close)(node->handle);
     vfs_node_t retained_parent = NULL;
     spin_lock(&vfs_namespace_lock);
+    vfs_namespace_write_begin();
     if (!(node->flags & VFS_NODE_UNLINKED) && node->parent) {
         node->parent->child = clist_delete(node->parent->child, node);
         node->flags |= VFS_NODE_UNLINKED;
@@ -2157,6 +2690,7 @@ int vfs_close(vfs_node_t node)
         node->flags &= ~VFS_NODE_PARENT_RETAINED;
     }
     node->parent = NULL;
+    vfs_namespace_write_end();
     spin_unlock(&vfs_namespace_lock);
     callbackof(node, free)(node->handle);
     node->handle = 0;
@@ -2188,7 +2722,7 @@ int vfs_namespace_unlink(vfs_node_t node)
     int status = callbackof(node, delete)(node->parent->handle, node);
     if (status < 0) {
         spin_lock(&vfs_namespace_lock);
-        node->flags &= ~VFS_NODE_UNLINKING;
+        vfs_node_reveal(node, VFS_NODE_UNLINKING);
         spin_unlock(&vfs_namespace_lock);
         return status;
     }
@@ -2199,12 +2733,14 @@ int vfs_namespace_unlink(vfs_node_t node)
     }
 
     spin_lock(&vfs_namespace_lock);
+    vfs_namespace_write_begin();
     vfs_node_t parent = node->parent;
     parent->child     = clist_delete(parent->child, node);
     node->parent      = NULL;
-    node->flags &= ~VFS_NODE_UNLINKING;
+    vfs_node_reveal(node, VFS_NODE_UNLINKING);
     node->flags |= VFS_NODE_DELETE_COMMITTED | VFS_NODE_UNLINKED;
     node->type |= file_delete;
+    vfs_namespace_write_end();
     spin_unlock(&vfs_namespace_lock);
     return EOK;
 }
@@ -2227,10 +2763,12 @@ void vfs_namespace_detach(vfs_node_t node)
     }
 
     spin_lock(&vfs_namespace_lock);
+    vfs_namespace_write_begin();
     if (node->parent) node->parent->child = clist_delete(node->parent->child, node);
     node->parent = NULL;
     node->flags |= VFS_NODE_UNLINKED | VFS_NODE_DELETE_COMMITTED | VFS_NODE_UNLINKING;
     node->type |= file_delete;
+    vfs_namespace_write_end();
     spin_unlock(&vfs_namespace_lock);
 
     /*
@@ -2241,7 +2779,7 @@ void vfs_namespace_detach(vfs_node_t node)
     vfs_free_child(node);
 
     spin_lock(&vfs_namespace_lock);
-    node->flags &= ~VFS_NODE_UNLINKING;
+    vfs_node_reveal(node, VFS_NODE_UNLINKING);
     int release_now = node->refcount == 0;
     spin_unlock(&vfs_namespace_lock);
     if (release_now) vfs_close(node);
@@ -2288,8 +2826,10 @@ int vfs_delete(vfs_node_t node)
     }
     if (node->parent) vfs_touch_modify(node->parent);
     spin_lock(&vfs_namespace_lock);
+    vfs_namespace_write_begin();
     node->type |= file_delete;
-    node->flags &= ~VFS_NODE_UNLINKING;
+    vfs_node_reveal(node, VFS_NODE_UNLINKING);
+    vfs_namespace_write_end();
     if (node->parent && !(node->flags & VFS_NODE_PARENT_RETAINED)) {
         node->parent->refcount++;
         node->flags |= VFS_NODE_PARENT_RETAINED;
@@ -2300,7 +2840,7 @@ int vfs_delete(vfs_node_t node)
     return EOK;
 delete_failed:
     spin_lock(&vfs_namespace_lock);
-    node->flags &= ~VFS_NODE_UNLINKING;
+    vfs_node_reveal(node, VFS_NODE_UNLINKING);
     spin_unlock(&vfs_namespace_lock);
     return status;
 }
@@ -2437,10 +2977,10 @@ int vfs_rename(vfs_node_t node, vfs_node_t new_parent, const char *new_name_arg,
     status = callbackof(node, rename)(&context);
     if (status != EOK) {
         spin_lock(&vfs_namespace_lock);
-        node->flags &= ~VFS_NODE_INITIALIZING;
+        vfs_node_reveal(node, VFS_NODE_INITIALIZING);
         old_parent->flags &= ~VFS_NODE_RENAME_BUSY;
         new_parent->flags &= ~VFS_NODE_RENAME_BUSY;
-        if (target) target->flags &= ~VFS_NODE_INITIALIZING;
+        if (target) vfs_node_reveal(target, VFS_NODE_INITIALIZING);
         spin_unlock(&vfs_namespace_lock);
         goto out;
     }
@@ -2450,11 +2990,12 @@ int vfs_rename(vfs_node_t node, vfs_node_t new_parent, const char *new_name_arg,
         inotify_notify_delete(target);
     }
     spin_lock(&vfs_namespace_lock);
+    vfs_namespace_write_begin();
     if (target) {
         new_parent->child = clist_delete(new_parent->child, target);
         target->parent    = NULL;
         target->type |= file_delete;
-        target->flags &= ~VFS_NODE_INITIALIZING;
+        vfs_node_reveal(target, VFS_NODE_INITIALIZING);
         target->flags |= VFS_NODE_DELETE_COMMITTED | VFS_NODE_UNLINKED;
     }
     if (old_parent != new_parent) {
@@ -2465,10 +3006,12 @@ int vfs_rename(vfs_node_t node, vfs_node_t new_parent, const char *new_name_arg,
         new_link          = NULL;
         node->parent      = new_parent;
     }
+    vfs_dcache_forget_locked(node);
     free(node->name);
     node->name = new_name;
     new_name   = NULL;
-    node->flags &= ~VFS_NODE_INITIALIZING;
+    vfs_node_reveal(node, VFS_NODE_INITIALIZING);
+    vfs_namespace_write_end();
     old_parent->flags &= ~VFS_NODE_RENAME_BUSY;
     new_parent->flags &= ~VFS_NODE_RENAME_BUSY;
     old_parent->visited = 0;
@@ -2489,7 +3032,7 @@ out:
     vfs_rename_serial_release();
     if (target_retained && (target->flags & VFS_NODE_INITIALIZING)) {
         spin_lock(&vfs_namespace_lock);
-        target->flags &= ~VFS_NODE_INITIALIZING;
+        vfs_node_reveal(target, VFS_NODE_INITIALIZING);
         spin_unlock(&vfs_namespace_lock);
     }
     if (target_retained) vfs_close(target);
@@ -2549,10 +3092,18 @@ void vfs_free(vfs_node_t vfs)
         callbackof(vfs, free)(vfs->handle);
         vfs->handle = 0;
     }
-    free(vfs->linkname);
-    free(vfs->mount_source);
-    free(vfs->name);
-    free(vfs);
+    char *linkname     = vfs->linkname;
+    char *mount_source = vfs->mount_source;
+    char *name         = vfs->name;
+    spin_lock(&vfs_namespace_lock);
+    vfs_namespace_write_begin();
+    vfs_dcache_forget_locked(vfs);
+    vfs_namespace_write_end();
+    vfs_walk_retire_node(vfs);
+    spin_unlock(&vfs_namespace_lock);
+    free(linkname);
+    free(mount_source);
+    free(name);
 }
 
 /* Initialize the virtual file system */
@@ -2565,6 +3116,7 @@ void init_vfs(void)
     size_t                max_pages = frame_allocator.origin_frames / 2;
     if (max_pages < 256) max_pages = 256;
     (void)pagecache_init(&allocator, max_pages);
+    if (frame_allocator.origin_frames / VFS_DCACHE_FRAMES_PER_NAME > vfs_dcache_limit) vfs_dcache_limit = frame_allocator.origin_frames / VFS_DCACHE_FRAMES_PER_NAME;
     rootdir       = vfs_node_alloc(0, "/");
     rootdir->type = file_dir;
     plogk("vfs: Initial root directory of the virtual file system: '/'\n");
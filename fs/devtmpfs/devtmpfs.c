@@ -29,6 +29,7 @@
 #include <libs/std/string.h>
 #include <mem/alloc.h>
 #include <mem/heap.h>
+#include <mem/zram.h>
 #include <process/uaccess.h>
 #include <sync/spin_lock.h>
 
@@ -405,6 +406,46 @@ static int devtmpfs_create_rtc_node(void)
     return 1;
 }
 
+#if CONFIG_ZRAM
+/* zram pages are only reachable through swap, so the node itself transfers nothing. */
+static size_t devtmpfs_zram_read(void *ctx, void *addr, size_t offset, size_t size)
+{
+    (void)ctx;
+    (void)addr;
+    (void)offset;
+    (void)size;
+    return 0;
+}
+
+/* Refuse writes through a zram node; see devtmpfs_zram_read(). */
+static size_t devtmpfs_zram_write(void *ctx, const void *addr, size_t offset, size_t size)
+{
+    (void)ctx;
+    (void)addr;
+    (void)offset;
+    (void)size;
+    return 0;
+}
+
+/* Register the /dev/zramN nodes named by swapon. */
+static int devtmpfs_create_zram_nodes(void)
+{
+    static const tmpfs_device_ops_t zram_device = {
+        .read  = devtmpfs_zram_read,
+        .write = devtmpfs_zram_write,
+    };
+    int            count = 0;
+    zram_device_t *zram;
+
+    for (uint32_t i = 0; (zram = zram_get_device(i)) != NULL; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/dev/%s", zram_device_name(zram));
+        if (devtmpfs_register_char_device(path, MKDEV(ZRAM_MAJOR, i), MKDEV(ZRAM_MAJOR, i), file_block, &zram_device) == EOK) count++;
+    }
+    return count;
+}
+#endif
+
 /* /proc block-device export helpers */
 
 typedef void (*devtmpfs_block_walk_fn)(const char *name, uint32_t major, uint32_t minor, uint64_t blocks, void *opaque);
@@ -629,6 +670,9 @@ void devtmpfs_init(void)
     total_devices += devtmpfs_create_ptmx_node();
 #endif
     total_devices += devtmpfs_create_rtc_node();
+#if CONFIG_ZRAM
+    total_devices += devtmpfs_create_zram_nodes();
+#endif
     devtmpfs_populated = true; // Boot-time population done; later devices stay silent.
 
     /* Conventional process-fd aliases expected by libc and service scripts. */
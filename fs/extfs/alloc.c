@@ -18,11 +18,16 @@
 
 /*
  * Block and inode allocation
- * Bitmap-based allocation for data blocks and inode numbers: search
- * the block/inode bitmaps for a free slot, mark it and update the
- * on-disk group descriptors.
+ * Bitmap-based allocation for data blocks and inode numbers.  Bitmaps
+ * are cached per group and changed in memory together with the group
+ * descriptor and superblock counters; extfs_alloc_flush() writes the
+ * dirty state back in one batch when a transaction commits (or on
+ * sync/unmount), and an aborted transaction simply discards it.
  */
 
+#define EXTFS_BITMAP_CACHE_MAX 128 // clean bitmaps kept across flushes
+#define EXTFS_ALLOC_MIN_RUN    8   // free run preferred when the goal block is taken
+
 /* Test a bit in a bitmap. */
 static int extfs_test_bit(const uint8_t *bitmap, uint32_t bit)
 {
@@ -44,70 +49,100 @@ static void extfs_clear_bit(uint8_t *bitmap, uint32_t bit)
 static int extfs_initialize_block_bitmap(extfs_sb_info_t *sb, uint32_t group, uint8_t *bitmap);
 static int extfs_initialize_inode_bitmap(extfs_sb_info_t *sb, uint32_t group, uint8_t *bitmap);
 
-/* Find a free bit in a block/inode bitmap, initializing it if needed. */
-static int extfs_alloc_bit_from_bitmap(extfs_sb_info_t *sb, uint32_t group, int inode_bitmap, uint32_t bitmap_block, uint32_t total_bits, uint32_t start, uint32_t *out)
+/* Allocator state of a group, creating the state table on first use. */
+static extfs_group_state_t *extfs_group_state(extfs_sb_info_t *sb, uint32_t group)
 {
-    uint8_t *buf;
-    uint32_t i;
+    if (!sb->groups) sb->groups = calloc(sb->groups_count, sizeof(*sb->groups));
+    return sb->groups ? &sb->groups[group] : 0;
+}
 
-    buf = malloc(sb->block_size);
-    if (!buf) return -ENOMEM;
+/* Return a group's cached bitmap, reading (or initializing) it on first use. */
+static int extfs_group_bitmap(extfs_sb_info_t *sb, uint32_t group, int inode_bitmap, uint8_t **out)
+{
+    extfs_group_state_t *state = extfs_group_state(sb, group);
+    if (!state) return -ENOMEM;
 
-    if (extfs_read_block(sb, bitmap_block, buf) != EOK) {
-        free(buf);
-        return -EIO;
+    uint8_t **slot = inode_bitmap ? &state->inode_bitmap : &state->block_bitmap;
+    if (*slot) {
+        *out = *slot;
+        return EOK;
     }
 
+    uint8_t *buf = malloc(sb->block_size);
+    if (!buf) return -ENOMEM;
+
+    int      status;
     uint16_t uninit = inode_bitmap ? EXT4_BG_INODE_UNINIT : EXT4_BG_BLOCK_UNINIT;
     if (sb->group_desc[group].bg_flags & uninit) {
-        int status = inode_bitmap ? extfs_initialize_inode_bitmap(sb, group, buf) : extfs_initialize_block_bitmap(sb, group, buf);
-        if (status != EOK) {
-            free(buf);
-            return status;
+        status = inode_bitmap ? extfs_initialize_inode_bitmap(sb, group, buf) : extfs_initialize_block_bitmap(sb, group, buf);
+        if (status == EOK) {
+            if (inode_bitmap)
+                state->inode_dirty = 1;
+            else
+                state->block_dirty = 1;
+            state->desc_dirty = 1;
         }
+    } else {
+        status = extfs_read_block(sb, inode_bitmap ? sb->group_desc[group].bg_inode_bitmap : sb->group_desc[group].bg_block_bitmap, buf);
+        if (status != EOK) status = -EIO;
     }
-
-    for (i = start; i < total_bits; i++) {
-        if (!extfs_test_bit(buf, i)) {
-            extfs_set_bit(buf, i);
-            extfs_update_bitmap_checksum(sb, group, inode_bitmap, buf);
-            if (extfs_write_block(sb, bitmap_block, buf) != EOK) {
-                free(buf);
-                return -EIO;
-            }
-            *out = i;
-            free(buf);
-            return EOK;
-        }
+    if (status != EOK) {
+        free(buf);
+        return status;
     }
-
-    free(buf);
-    return -ENOSPC;
+    *slot = buf;
+    *out  = buf;
+    sb->cached_bitmaps++;
+    return EOK;
 }
 
-/* Clear a bit in a block/inode bitmap, detecting double frees. */
-static int extfs_free_bit_in_bitmap(extfs_sb_info_t *sb, uint32_t group, int inode_bitmap, uint32_t bitmap_block, uint32_t bit)
+/* Record a descriptor change, writing it immediately if no state table exists. */
+static int extfs_group_desc_dirty(extfs_sb_info_t *sb, uint32_t group)
 {
-    uint8_t *buf;
-
-    buf = malloc(sb->block_size);
-    if (!buf) return -ENOMEM;
+    extfs_group_state_t *state = extfs_group_state(sb, group);
+    if (!state) return extfs_write_group_desc(sb, group, &sb->group_desc[group]);
+    state->desc_dirty = 1;
+    return EOK;
+}
 
-    if (extfs_read_block(sb, bitmap_block, buf) != EOK) {
-        free(buf);
-        return -EIO;
+/* Find the first clear bit in [start, total), skipping full bytes. */
+static uint32_t extfs_find_clear_bit(const uint8_t *bitmap, uint32_t start, uint32_t total)
+{
+    uint32_t bit = start;
+    while (bit < total) {
+        if (!(bit % 8) && bitmap[bit / 8] == 0xFF) {
+            bit += 8;
+            continue;
+        }
+        if (!extfs_test_bit(bitmap, bit)) return bit;
+        bit++;
     }
+    return total;
+}
 
-    if (!extfs_test_bit(buf, bit)) {
-        plogk("extfs: Drive %u: %s bitmap bit %u not allocated (double free)\n", sb->device.drive, inode_bitmap ? "inode" : "block", bit);
-        free(buf);
-        return -EINVAL;
+/* Length of the clear run starting at bit, up to limit. */
+static uint32_t extfs_clear_run(const uint8_t *bitmap, uint32_t bit, uint32_t total, uint32_t limit)
+{
+    uint32_t length = 0;
+    while (bit + length < total && length < limit && !extfs_test_bit(bitmap, bit + length)) length++;
+    return length;
+}
+
+/*
+ * Pick where a run of up to want bits starts in [start, end): the first
+ * clear bit that begins a run of at least min_run, else the first clear bit.
+ */
+static uint32_t extfs_pick_run(const uint8_t *bitmap, uint32_t start, uint32_t end, uint32_t min_run)
+{
+    uint32_t fallback = end;
+    uint32_t bit      = extfs_find_clear_bit(bitmap, start, end);
+    while (bit < end) {
+        uint32_t run = extfs_clear_run(bitmap, bit, end, min_run);
+        if (run >= min_run) return bit;
+        if (fallback == end) fallback = bit;
+        bit = extfs_find_clear_bit(bitmap, bit + run, end);
     }
-    extfs_clear_bit(buf, bit);
-    extfs_update_bitmap_checksum(sb, group, inode_bitmap, buf);
-    int status = extfs_write_block(sb, bitmap_block, buf);
-    free(buf);
-    return status;
+    return fallback;
 }
 
 /* Number of valid data blocks in a group (the last group may be short). */
@@ -205,15 +240,49 @@ static int extfs_initialize_inode_bitmap(extfs_sb_info_t *sb, uint32_t group, ui
     return extfs_update_bitmap_checksum(sb, group, 1, bitmap);
 }
 
-/* Allocate a data block, preferring the group around the goal block. */
-int extfs_alloc_block(extfs_sb_info_t *sb, uint32_t goal, uint32_t *out)
+/* Take up to count contiguous free blocks of a group, starting at bit when it is free. */
+static int extfs_group_alloc_blocks(extfs_sb_info_t *sb, uint32_t group, uint32_t bit, uint32_t count, uint32_t *out, uint32_t *allocated)
+{
+    uint8_t *bitmap;
+    int      status = extfs_group_bitmap(sb, group, 0, &bitmap);
+    if (status != EOK) return status;
+
+    uint32_t total   = extfs_blocks_in_group(sb, group);
+    uint32_t min_run = count < EXTFS_ALLOC_MIN_RUN ? count : EXTFS_ALLOC_MIN_RUN;
+    uint32_t start   = total;
+    if (bit < total && !extfs_test_bit(bitmap, bit)) {
+        start = bit;
+    } else {
+        start = extfs_pick_run(bitmap, bit < total ? bit : 0, total, min_run);
+        if (start == total && bit && bit < total) start = extfs_pick_run(bitmap, 0, bit, min_run);
+    }
+    if (start >= total) return -ENOSPC;
+
+    uint32_t length = extfs_clear_run(bitmap, start, total, count);
+    if (length > sb->group_desc[group].bg_free_blocks_count) length = sb->group_desc[group].bg_free_blocks_count;
+    if (!length) return -ENOSPC;
+    for (uint32_t i = 0; i < length; i++) extfs_set_bit(bitmap, start + i);
+
+    sb->groups[group].block_dirty = 1;
+    sb->groups[group].desc_dirty  = 1;
+    sb->group_desc[group].bg_free_blocks_count -= (uint16_t)length;
+    sb->es->s_free_blocks_count -= length;
+    sb->super_dirty = 1;
+    *out            = start + group * sb->blocks_per_group + sb->s_first_data_block;
+    *allocated      = length;
+    return EOK;
+}
+
+/* Allocate up to count contiguous data blocks, preferring the goal block and its group. */
+int extfs_alloc_blocks(extfs_sb_info_t *sb, uint32_t goal, uint32_t count, uint32_t *out, uint32_t *allocated)
 {
-    uint32_t group, i, bit;
+    uint32_t group;
     int      status;
 
-    if (!sb || !sb->es || !out) return -EINVAL;
+    if (!sb || !sb->es || !out || !allocated || !count) return -EINVAL;
     if (sb->read_only) return -EROFS;
-    *out = 0;
+    *out       = 0;
+    *allocated = 0;
     if (sb->es->s_free_blocks_count == 0) {
         static uint64_t last_log;
         if (sched_ticks() - last_log >= 1000) {
@@ -222,36 +291,25 @@ int extfs_alloc_block(extfs_sb_info_t *sb, uint32_t goal, uint32_t *out)
         }
         return -ENOSPC;
     }
+    if (count > sb->es->s_free_blocks_count) count = sb->es->s_free_blocks_count;
 
     /* Try goal group first */
     if (goal > sb->s_first_data_block) {
         group = (goal - sb->s_first_data_block) / sb->blocks_per_group;
         if (group < sb->groups_count && sb->group_desc[group].bg_free_blocks_count > 0) {
-            bit    = (goal - sb->s_first_data_block) % sb->blocks_per_group;
-            status = extfs_alloc_bit_from_bitmap(sb, group, 0, sb->group_desc[group].bg_block_bitmap, extfs_blocks_in_group(sb, group), bit, out);
-            if (status == EOK) {
-                *out += group * sb->blocks_per_group + sb->s_first_data_block;
-                sb->group_desc[group].bg_free_blocks_count--;
-                sb->es->s_free_blocks_count--;
-                status = extfs_write_group_desc(sb, group, &sb->group_desc[group]);
-                if (status == EOK) status = extfs_write_super(sb);
-                return status;
-            }
+            status = extfs_group_alloc_blocks(sb, group, (goal - sb->s_first_data_block) % sb->blocks_per_group, count, out, allocated);
+            if (status != -ENOSPC) return status;
         }
     }
 
-    /* Scan all groups */
-    for (i = 0; i < sb->groups_count; i++) {
-        if (sb->group_desc[i].bg_free_blocks_count == 0) continue;
-        status = extfs_alloc_bit_from_bitmap(sb, i, 0, sb->group_desc[i].bg_block_bitmap, extfs_blocks_in_group(sb, i), 0, out);
-        if (status == EOK) {
-            *out += i * sb->blocks_per_group + sb->s_first_data_block;
-            sb->group_desc[i].bg_free_blocks_count--;
-            sb->es->s_free_blocks_count--;
-            status = extfs_write_group_desc(sb, i, &sb->group_desc[i]);
-            if (status == EOK) status = extfs_write_super(sb);
-            return status;
-        }
+    /* Next-fit over all groups */
+    for (uint32_t i = 0; i < sb->groups_count; i++) {
+        group = (sb->alloc_next_group + i) % sb->groups_count;
+        if (sb->group_desc[group].bg_free_blocks_count == 0) continue;
+        status = extfs_group_alloc_blocks(sb, group, 0, count, out, allocated);
+        if (status == -ENOSPC) continue;
+        if (status == EOK) sb->alloc_next_group = group;
+        return status;
     }
 
     static uint64_t last_log;
@@ -262,10 +320,18 @@ int extfs_alloc_block(extfs_sb_info_t *sb, uint32_t goal, uint32_t *out)
     return -ENOSPC;
 }
 
+/* Allocate a data block, preferring the group around the goal block. */
+int extfs_alloc_block(extfs_sb_info_t *sb, uint32_t goal, uint32_t *out)
+{
+    uint32_t allocated;
+    return extfs_alloc_blocks(sb, goal, 1, out, &allocated);
+}
+
 /* Free a data block back to its group bitmap. */
 void extfs_free_block(extfs_sb_info_t *sb, uint32_t block)
 {
     uint32_t group, bit;
+    uint8_t *bitmap;
 
     if (!sb || !sb->es || sb->read_only || block < sb->s_first_data_block) return;
 
@@ -275,16 +341,21 @@ void extfs_free_block(extfs_sb_info_t *sb, uint32_t block)
     if (group >= sb->groups_count) return;
 
     if (bit >= extfs_blocks_in_group(sb, group)) return;
-    int status = extfs_free_bit_in_bitmap(sb, group, 0, sb->group_desc[group].bg_block_bitmap, bit);
+    int status = extfs_group_bitmap(sb, group, 0, &bitmap);
+    if (status == EOK && !extfs_test_bit(bitmap, bit)) {
+        plogk("extfs: Drive %u: block bitmap bit %u not allocated (double free)\n", sb->device.drive, bit);
+        status = -EINVAL;
+    }
     if (status != EOK) {
         if (sb->active_transaction) sb->active_transaction->error = status;
         return;
     }
+    extfs_clear_bit(bitmap, bit);
+    sb->groups[group].block_dirty = 1;
+    sb->groups[group].desc_dirty  = 1;
     sb->group_desc[group].bg_free_blocks_count++;
     sb->es->s_free_blocks_count++;
-    status = extfs_write_group_desc(sb, group, &sb->group_desc[group]);
-    if (status == EOK) status = extfs_write_super(sb);
-    if (status != EOK && sb->active_transaction) sb->active_transaction->error = status;
+    sb->super_dirty = 1;
 }
 
 /* Allocate an inode number from the first group with a free slot. */
@@ -308,23 +379,30 @@ int extfs_alloc_inode(extfs_sb_info_t *sb, uint32_t *out)
     for (i = 0; i < sb->groups_count; i++) {
         if (sb->group_desc[i].bg_free_inodes_count == 0) continue;
 
+        uint8_t *bitmap;
+        status = extfs_group_bitmap(sb, i, 1, &bitmap);
+        if (status != EOK) return status;
+
         uint32_t start = i == 0 && sb->s_first_ino > 1 ? sb->s_first_ino - 1 : 0;
-        status         = extfs_alloc_bit_from_bitmap(sb, i, 1, sb->group_desc[i].bg_inode_bitmap, extfs_inodes_in_group(sb, i), start, out);
-        if (status == EOK) {
-            *out += i * sb->inodes_per_group + 1;
-            sb->group_desc[i].bg_free_inodes_count--;
-            sb->group_desc[i].bg_flags &= (uint16_t)~EXT4_BG_INODE_UNINIT;
-            uint32_t unused = sb->group_desc[i].bg_itable_unused_lo | (uint32_t)sb->group_desc[i].bg_itable_unused_hi << 16;
-            uint32_t after  = extfs_inodes_in_group(sb, i) - ((*out - 1) % sb->inodes_per_group + 1);
-            if (after < unused) {
-                sb->group_desc[i].bg_itable_unused_lo = (uint16_t)after;
-                sb->group_desc[i].bg_itable_unused_hi = (uint16_t)(after >> 16);
-            }
-            sb->es->s_free_inodes_count--;
-            status = extfs_write_group_desc(sb, i, &sb->group_desc[i]);
-            if (status == EOK) status = extfs_write_super(sb);
-            return status;
+        uint32_t total = extfs_inodes_in_group(sb, i);
+        uint32_t bit   = extfs_find_clear_bit(bitmap, start, total);
+        if (bit >= total) continue;
+
+        extfs_set_bit(bitmap, bit);
+        sb->groups[i].inode_dirty = 1;
+        sb->groups[i].desc_dirty  = 1;
+        *out                      = bit + i * sb->inodes_per_group + 1;
+        sb->group_desc[i].bg_free_inodes_count--;
+        sb->group_desc[i].bg_flags &= (uint16_t)~EXT4_BG_INODE_UNINIT;
+        uint32_t unused = sb->group_desc[i].bg_itable_unused_lo | (uint32_t)sb->group_desc[i].bg_itable_unused_hi << 16;
+        uint32_t after  = total - (bit + 1);
+        if (after < unused) {
+            sb->group_desc[i].bg_itable_unused_lo = (uint16_t)after;
+            sb->group_desc[i].bg_itable_unused_hi = (uint16_t)(after >> 16);
         }
+        sb->es->s_free_inodes_count--;
+        sb->super_dirty = 1;
+        return EOK;
     }
 
     static uint64_t last_log;
@@ -339,6 +417,7 @@ int extfs_alloc_inode(extfs_sb_info_t *sb, uint32_t *out)
 void extfs_free_inode(extfs_sb_info_t *sb, uint32_t ino)
 {
     uint32_t group, bit;
+    uint8_t *bitmap;
 
     if (!sb || !sb->es || sb->read_only || ino == 0) return;
 
@@ -348,16 +427,21 @@ void extfs_free_inode(extfs_sb_info_t *sb, uint32_t ino)
     if (group >= sb->groups_count) return;
 
     if (ino < sb->s_first_ino || bit >= extfs_inodes_in_group(sb, group)) return;
-    int status = extfs_free_bit_in_bitmap(sb, group, 1, sb->group_desc[group].bg_inode_bitmap, bit);
+    int status = extfs_group_bitmap(sb, group, 1, &bitmap);
+    if (status == EOK && !extfs_test_bit(bitmap, bit)) {
+        plogk("extfs: Drive %u: inode bitmap bit %u not allocated (double free)\n", sb->device.drive, bit);
+        status = -EINVAL;
+    }
     if (status != EOK) {
         if (sb->active_transaction) sb->active_transaction->error = status;
         return;
     }
+    extfs_clear_bit(bitmap, bit);
+    sb->groups[group].inode_dirty = 1;
+    sb->groups[group].desc_dirty  = 1;
     sb->group_desc[group].bg_free_inodes_count++;
     sb->es->s_free_inodes_count++;
-    status = extfs_write_group_desc(sb, group, &sb->group_desc[group]);
-    if (status == EOK) status = extfs_write_super(sb);
-    if (status != EOK && sb->active_transaction) sb->active_transaction->error = status;
+    sb->super_dirty = 1;
 }
 
 /* Adjust the used-directory counter of an inode's group. */
@@ -372,7 +456,7 @@ int extfs_adjust_used_dirs(extfs_sb_info_t *sb, uint32_t ino, int delta)
     count                                       = (uint32_t)(count + delta);
     sb->group_desc[group].bg_used_dirs_count    = (uint16_t)count;
     sb->group_desc[group].bg_used_dirs_count_hi = (uint16_t)(count >> 16);
-    return extfs_write_group_desc(sb, group, &sb->group_desc[group]);
+    return extfs_group_desc_dirty(sb, group);
 }
 
 /* Sum the free-block counters across all groups. */
@@ -396,3 +480,66 @@ uint32_t extfs_count_free_inodes(extfs_sb_info_t *sb)
 
     return count;
 }
+
+/* Write dirty bitmaps, group descriptors and the superblock back in one batch. */
+int extfs_alloc_flush(extfs_sb_info_t *sb)
+{
+    int status;
+
+    if (!sb || !sb->es) return -EINVAL;
+    if (sb->read_only) return EOK;
+
+    for (uint32_t group = 0; sb->groups && group < sb->groups_count; group++) {
+        extfs_group_state_t *state = &sb->groups[group];
+        if (state->block_dirty) {
+            extfs_update_bitmap_checksum(sb, group, 0, state->block_bitmap);
+            status = extfs_write_block(sb, sb->group_desc[group].bg_block_bitmap, state->block_bitmap);
+            if (status != EOK) return status;
+            state->block_dirty = 0;
+        }
+        if (state->inode_dirty) {
+            extfs_update_bitmap_checksum(sb, group, 1, state->inode_bitmap);
+            status = extfs_write_block(sb, sb->group_desc[group].bg_inode_bitmap, state->inode_bitmap);
+            if (status != EOK) return status;
+            state->inode_dirty = 0;
+        }
+        if (state->desc_dirty) {
+            status = extfs_write_group_desc(sb, group, &sb->group_desc[group]);
+            if (status != EOK) return status;
+            state->desc_dirty = 0;
+        }
+    }
+    if (sb->super_dirty) {
+        status = extfs_write_super(sb);
+        if (status != EOK) return status;
+        sb->super_dirty = 0;
+    }
+
+    /* Everything is clean now; keep the bitmap cache bounded. */
+    if (sb->cached_bitmaps > EXTFS_BITMAP_CACHE_MAX) {
+        for (uint32_t group = 0; group < sb->groups_count; group++) {
+            free(sb->groups[group].block_bitmap);
+            free(sb->groups[group].inode_bitmap);
+            sb->groups[group].block_bitmap = 0;
+            sb->groups[group].inode_bitmap = 0;
+        }
+        sb->cached_bitmaps = 0;
+    }
+    return EOK;
+}
+
+/* Forget all cached allocator state, e.g. after the transaction that changed it was aborted. */
+void extfs_alloc_discard(extfs_sb_info_t *sb)
+{
+    if (!sb) return;
+    if (sb->groups) {
+        for (uint32_t group = 0; group < sb->groups_count; group++) {
+            free(sb->groups[group].block_bitmap);
+            free(sb->groups[group].inode_bitmap);
+        }
+        free(sb->groups);
+    }
+    sb->groups         = 0;
+    sb->cached_bitmaps = 0;
+    sb->super_dirty    = 0;
+}
@@ -23,7 +23,10 @@
  * extents.c implements the ext4 extent tree used to map file logical
  * blocks to physical blocks. The tree can be up to EXT4_EXT_MAX_DEPTH
  * levels of index nodes; this file provides lookup, splitting,
- * insertion and removal of extents.
+ * insertion and removal of extents.  Lookups go through a per-handle
+ * sorted copy of the tree (the extent status cache); allocations update
+ * the affected leaf in place and only fall back to a full rebuild when
+ * the root or an index node overflows.
  */
 
 typedef struct ext4_extent_header {
@@ -69,6 +72,24 @@ typedef struct extent_child {
         uint32_t block;
 } extent_child_t;
 
+/* Sorted, flattened copy of one inode's extent tree */
+struct extfs_extent_cache {
+        extent_item_t *items;
+        uint32_t       count;
+        uint32_t       capacity;
+        uint32_t       metadata_count;      // Index and leaf blocks below the root
+        uint32_t       hint;                // Item of the most recent lookup
+        uint32_t       generation;          // Generation bucket value when last synced
+        uint32_t       root[EXT2_N_BLOCKS]; // i_data the cache describes
+};
+
+/* One level of a root-to-leaf walk */
+typedef struct extent_path {
+        uint8_t *node;  // h->ei.i_data for the root, a heap copy below it
+        uint32_t block; // 0 for the in-inode root
+        uint16_t slot;  // Index entry followed
+} extent_path_t;
+
 /* Append an extent to the vector, growing it as needed. */
 static int extent_push(extent_vector_t *vector, extent_item_t item)
 {
@@ -223,8 +244,8 @@ static void extent_vector_destroy(extent_vector_t *vector)
     memset(vector, 0, sizeof(*vector));
 }
 
-/* Sort extents by logical block and merge adjacent contiguous runs. */
-static void extent_sort_and_merge(extent_vector_t *vector)
+/* Sort extents by logical block (the collected order is almost always sorted already). */
+static void extent_sort(extent_vector_t *vector)
 {
     for (uint32_t i = 1; i < vector->count; i++) {
         extent_item_t item = vector->items[i];
@@ -235,6 +256,12 @@ static void extent_sort_and_merge(extent_vector_t *vector)
         }
         vector->items[j] = item;
     }
+}
+
+/* Sort extents by logical block and merge adjacent contiguous runs. */
+static void extent_sort_and_merge(extent_vector_t *vector)
+{
+    extent_sort(vector);
     uint32_t output = 0;
     for (uint32_t i = 0; i < vector->count; i++) {
         extent_item_t item = vector->items[i];
@@ -408,62 +435,440 @@ fail:
     return status;
 }
 
-/* Map a logical block through the extent tree, allocating on demand. */
-uint32_t extfs_extent_map_block(extfs_handle_t *h, uint32_t logical, int create)
+/* Generation bucket shared by every handle of this inode. */
+static uint32_t *extent_generation(extfs_handle_t *h)
 {
-    extent_vector_t vector;
-    if (!h || extent_collect(h, &vector) != EOK) return 0;
-    for (uint32_t i = 0; i < vector.count; i++) {
-        extent_item_t item = vector.items[i];
-        if (logical < item.logical || logical >= item.logical + item.length) continue;
-        if (!item.unwritten) {
-            uint32_t result = item.physical + logical - item.logical;
-            extent_vector_destroy(&vector);
-            return result;
-        }
-        if (!create) {
-            extent_vector_destroy(&vector);
-            return 0;
-        }
-        vector.items[i].length = (uint16_t)(logical - item.logical);
-        extent_item_t written  = {.logical = logical, .physical = item.physical + logical - item.logical, .length = 1};
-        extent_item_t suffix   = {.logical = logical + 1, .physical = written.physical + 1, .length = (uint16_t)(item.logical + item.length - logical - 1), .unwritten = 1};
-        if (!vector.items[i].length) {
-            vector.items[i] = written;
-        } else if (extent_push(&vector, written) != EOK) {
-            extent_vector_destroy(&vector);
-            return 0;
-        }
-        if (suffix.length && extent_push(&vector, suffix) != EOK) {
-            extent_vector_destroy(&vector);
-            return 0;
-        }
-        uint32_t result = written.physical;
-        if (extent_rebuild(h, &vector) != EOK) result = 0;
-        extent_vector_destroy(&vector);
-        return result;
+    return &h->sb->extent_generation[h->inode_no % EXTFS_GEN_HASH];
+}
+
+/* Drop the handle's extent status cache. */
+void extfs_extent_cache_drop(extfs_handle_t *h)
+{
+    if (!h || !h->extent_cache) return;
+    free(h->extent_cache->items);
+    free(h->extent_cache);
+    h->extent_cache = 0;
+}
+
+/* Publish an extent tree change; a cache updated in step with it stays valid. */
+static void extent_tree_changed(extfs_handle_t *h, int cache_current)
+{
+    uint32_t *generation = extent_generation(h);
+
+    (*generation)++;
+    if (!cache_current) {
+        extfs_extent_cache_drop(h);
+        return;
     }
-    if (!create) {
+    if (!h->extent_cache) return;
+    h->extent_cache->generation = *generation;
+    memcpy(h->extent_cache->root, h->ei.i_data, sizeof(h->extent_cache->root));
+}
+
+/* Return the handle's extent cache, rebuilding it from disk when stale. */
+static extfs_extent_cache_t *extent_cache_get(extfs_handle_t *h)
+{
+    extfs_extent_cache_t *cache = h->extent_cache;
+    if (cache && cache->generation == *extent_generation(h) && !memcmp(cache->root, h->ei.i_data, sizeof(cache->root))) return cache;
+    extfs_extent_cache_drop(h);
+
+    extent_vector_t vector;
+    if (extent_collect(h, &vector) != EOK) {
         extent_vector_destroy(&vector);
         return 0;
     }
-    uint32_t physical;
-    if (extfs_alloc_block(h->sb, 0, &physical) != EOK) {
+    cache = calloc(1, sizeof(*cache));
+    if (!cache) {
         extent_vector_destroy(&vector);
         return 0;
     }
-    uint8_t      *zero   = calloc(1, h->sb->block_size);
-    extent_item_t item   = {.logical = logical, .physical = physical, .length = 1};
-    int           status = zero ? extfs_write_data_block(h->sb, physical, zero) : -ENOMEM;
-    free(zero);
-    if (status == EOK) status = extent_push(&vector, item);
-    if (status == EOK) status = extent_rebuild(h, &vector);
+    extent_sort(&vector);
+    cache->items          = vector.items;
+    cache->count          = vector.count;
+    cache->capacity       = vector.capacity;
+    cache->metadata_count = vector.metadata_count;
+    cache->generation     = *extent_generation(h);
+    memcpy(cache->root, h->ei.i_data, sizeof(cache->root));
+    free(vector.metadata);
+    h->extent_cache = cache;
+    return cache;
+}
+
+/* Index of the last cached extent starting at or before logical, or count if none. */
+static uint32_t extent_cache_find(extfs_extent_cache_t *cache, uint32_t logical)
+{
+    uint32_t hint = cache->hint;
+    for (uint32_t i = hint; i < cache->count && i <= hint + 1; i++) {
+        if (cache->items[i].logical <= logical && (i + 1 == cache->count || cache->items[i + 1].logical > logical)) {
+            cache->hint = i;
+            return i;
+        }
+    }
+
+    uint32_t low = 0, high = cache->count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (cache->items[middle].logical <= logical)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (!low) return cache->count;
+    cache->hint = low - 1;
+    return low - 1;
+}
+
+/* Make room for count cached extents. */
+static int extent_cache_reserve(extfs_extent_cache_t *cache, uint32_t count)
+{
+    if (count <= cache->capacity) return EOK;
+    uint32_t capacity = cache->capacity ? cache->capacity * 2 : 16;
+    if (capacity < count) capacity = count;
+    void *items = realloc(cache->items, capacity * sizeof(*cache->items));
+    if (!items) return -ENOMEM;
+    cache->items    = items;
+    cache->capacity = capacity;
+    return EOK;
+}
+
+/* Replace remove cached extents at pos with items; room must be reserved. */
+static void extent_cache_splice(extfs_extent_cache_t *cache, uint32_t pos, uint32_t remove, const extent_item_t *items, uint32_t count)
+{
+    memmove(&cache->items[pos + count], &cache->items[pos + remove], (cache->count - pos - remove) * sizeof(*cache->items));
+    memcpy(&cache->items[pos], items, count * sizeof(*items));
+    cache->count = cache->count - remove + count;
+}
+
+/* Encode an extent item as an on-disk leaf entry. */
+static void extent_store(ext4_extent_t *entry, const extent_item_t *item)
+{
+    entry->logical  = item->logical;
+    entry->length   = item->length | (item->unwritten ? EXT4_EXT_UNWRITTEN : 0);
+    entry->start_hi = 0;
+    entry->start_lo = item->physical;
+}
+
+/* Free the heap copies of the nodes below the root. */
+static void extent_path_release(extent_path_t *path)
+{
+    for (uint32_t level = 1; level <= EXT4_EXT_MAX_DEPTH; level++) free(path[level].node);
+}
+
+/* Walk from the root to the leaf whose range covers logical. */
+static int extent_find_path(extfs_handle_t *h, uint32_t logical, extent_path_t *path, uint16_t *depth)
+{
+    ext4_extent_header_t *root = (ext4_extent_header_t *)h->ei.i_data;
+
+    memset(path, 0, sizeof(*path) * (EXT4_EXT_MAX_DEPTH + 1));
+    if (!extent_header_valid(h->sb, root, root->depth, 1)) return -EIO;
+    path[0].node = (uint8_t *)h->ei.i_data;
+    *depth       = root->depth;
+
+    for (uint16_t level = 0; level < *depth; level++) {
+        ext4_extent_header_t *header  = (ext4_extent_header_t *)path[level].node;
+        ext4_extent_index_t  *indices = (ext4_extent_index_t *)(header + 1);
+        uint16_t              slot    = 0;
+        if (!header->entries) return -EIO;
+        while (slot + 1 < header->entries && indices[slot + 1].logical <= logical) slot++;
+        path[level].slot = slot;
+
+        uint64_t block = indices[slot].leaf_lo | (uint64_t)indices[slot].leaf_hi << 32;
+        if (!block || block > UINT32_MAX || block >= h->sb->blocks_count) return -EIO;
+        path[level + 1].node  = malloc(h->sb->block_size);
+        path[level + 1].block = (uint32_t)block;
+        if (!path[level + 1].node) return -ENOMEM;
+
+        int status = extfs_read_block(h->sb, (uint32_t)block, path[level + 1].node);
+        if (status != EOK) return status;
+        if (!extent_block_checksum_verify(h, path[level + 1].node)) return -EIO;
+        if (!extent_header_valid(h->sb, (ext4_extent_header_t *)path[level + 1].node, (uint16_t)(*depth - level - 1), 0)) return -EIO;
+    }
+    return EOK;
+}
+
+/* Write back one node of a path; the in-inode root is flushed with the inode. */
+static int extent_write_node(extfs_handle_t *h, extent_path_t *entry)
+{
+    if (!entry->block) return EOK;
+    extent_block_checksum_set(h, entry->node);
+    return extfs_write_block(h->sb, entry->block, entry->node);
+}
+
+/* Lower the index keys above a leaf whose first extent moved below them. */
+static int extent_lower_keys(extfs_handle_t *h, extent_path_t *path, uint16_t depth, uint32_t first)
+{
+    for (uint16_t level = depth; level--;) {
+        ext4_extent_index_t *indices = (ext4_extent_index_t *)((ext4_extent_header_t *)path[level].node + 1);
+        ext4_extent_index_t *index   = &indices[path[level].slot];
+        if (index->logical <= first) break;
+        index->logical = first;
+        int status     = extent_write_node(h, &path[level]);
+        if (status != EOK) return status;
+    }
+    return EOK;
+}
+
+/* Split a full leaf after splicing into it, linking the new sibling into the parent. */
+static int extent_split_leaf(extfs_handle_t *h, extent_path_t *path, uint16_t depth, uint16_t pos, uint16_t remove, const extent_item_t *items, uint16_t count)
+{
+    extent_path_t        *leaf    = &path[depth];
+    extent_path_t        *parent  = &path[depth - 1];
+    ext4_extent_header_t *header  = (ext4_extent_header_t *)leaf->node;
+    ext4_extent_header_t *pheader = (ext4_extent_header_t *)parent->node;
+    ext4_extent_t        *entries = (ext4_extent_t *)(header + 1);
+    uint32_t              total   = header->entries - remove + count;
+
+    if (pheader->entries >= pheader->max) return -ENOSPC;
+
+    ext4_extent_t *merged = malloc(total * sizeof(*merged));
+    if (!merged) return -ENOMEM;
+    memcpy(merged, entries, pos * sizeof(*merged));
+    for (uint16_t i = 0; i < count; i++) extent_store(&merged[pos + i], &items[i]);
+    memcpy(&merged[pos + count], &entries[pos + remove], (header->entries - pos - remove) * sizeof(*merged));
+
+    /* Appends leave the old leaf full; anything else splits it evenly. */
+    uint32_t keep = pos + remove == header->entries ? header->max : total / 2;
+    if (keep >= total) keep = total - 1;
+
+    uint32_t block;
+    int      status = extfs_alloc_block(h->sb, leaf->block, &block);
+    if (status != EOK) {
+        free(merged);
+        return status;
+    }
+    uint8_t *sibling = calloc(1, h->sb->block_size);
+    if (!sibling) {
+        extfs_free_block(h->sb, block);
+        free(merged);
+        return -ENOMEM;
+    }
+    extent_fill_header((ext4_extent_header_t *)sibling, (uint16_t)(total - keep), header->max, 0);
+    memcpy((ext4_extent_header_t *)sibling + 1, &merged[keep], (total - keep) * sizeof(*merged));
+    extent_block_checksum_set(h, sibling);
+    status = extfs_write_block(h->sb, block, sibling);
+    free(sibling);
+    if (status == EOK) {
+        memcpy(entries, merged, keep * sizeof(*merged));
+        header->entries = (uint16_t)keep;
+        status          = extent_write_node(h, leaf);
+    }
     if (status != EOK) {
-        extfs_free_block(h->sb, physical);
-        physical = 0;
+        extfs_free_block(h->sb, block);
+        free(merged);
+        return status;
+    }
+
+    ext4_extent_index_t *indices = (ext4_extent_index_t *)(pheader + 1);
+    uint16_t             slot    = parent->slot + 1;
+    memmove(&indices[slot + 1], &indices[slot], (pheader->entries - slot) * sizeof(*indices));
+    indices[slot].logical = merged[keep].logical;
+    indices[slot].leaf_lo = block;
+    indices[slot].leaf_hi = 0;
+    indices[slot].unused  = 0;
+    pheader->entries++;
+    status = extent_write_node(h, parent);
+    if (status == EOK && !pos) status = extent_lower_keys(h, path, depth, merged[0].logical);
+    if (status == EOK && h->extent_cache) h->extent_cache->metadata_count++;
+    free(merged);
+    return status;
+}
+
+/*
+ * Replace `remove` (0 or 1) extents starting at key with items, touching only
+ * the leaf that holds them (and its parent when the leaf has to split).
+ * Returns -ENOSPC when the change needs a deeper or repacked tree.
+ */
+static int extent_tree_splice(extfs_handle_t *h, uint32_t key, uint16_t remove, const extent_item_t *items, uint16_t count)
+{
+    extent_path_t path[EXT4_EXT_MAX_DEPTH + 1];
+    uint16_t      depth;
+    int           status = extent_find_path(h, key, path, &depth);
+    if (status != EOK) {
+        extent_path_release(path);
+        return status;
+    }
+
+    ext4_extent_header_t *header  = (ext4_extent_header_t *)path[depth].node;
+    ext4_extent_t        *entries = (ext4_extent_t *)(header + 1);
+    uint16_t              pos     = 0;
+    while (pos < header->entries && (remove ? entries[pos].logical < key : entries[pos].logical <= key)) pos++;
+    if (remove && (pos + remove > header->entries || entries[pos].logical != key)) {
+        extent_path_release(path);
+        return -EIO;
+    }
+
+    uint32_t total = header->entries - remove + count;
+    if (total <= header->max) {
+        memmove(&entries[pos + count], &entries[pos + remove], (header->entries - pos - remove) * sizeof(*entries));
+        for (uint16_t i = 0; i < count; i++) extent_store(&entries[pos + i], &items[i]);
+        header->entries = (uint16_t)total;
+        status          = extent_write_node(h, &path[depth]);
+        if (status == EOK && !pos && depth) status = extent_lower_keys(h, path, depth, entries[0].logical);
+    } else {
+        status = depth ? extent_split_leaf(h, path, depth, pos, remove, items, count) : -ENOSPC;
+    }
+    extent_path_release(path);
+    return status;
+}
+
+/* Apply a change by collecting and rebuilding the whole tree. */
+static int extent_rebuild_replacing(extfs_handle_t *h, uint32_t key, uint16_t remove, const extent_item_t *items, uint16_t count)
+{
+    extent_vector_t vector;
+    int             status = extent_collect(h, &vector);
+
+    for (uint32_t i = 0; status == EOK && remove && i < vector.count; i++) {
+        if (vector.items[i].logical != key) continue;
+        vector.items[i] = vector.items[--vector.count];
+        break;
     }
+    for (uint16_t i = 0; status == EOK && i < count; i++) status = extent_push(&vector, items[i]);
+    if (status == EOK) status = extent_rebuild(h, &vector);
     extent_vector_destroy(&vector);
-    return physical;
+    extent_tree_changed(h, 0);
+    return status;
+}
+
+/* Record a newly allocated written run at logical, extending its predecessor when contiguous. */
+static int extent_record(extfs_handle_t *h, extfs_extent_cache_t *cache, uint32_t index, uint32_t logical, uint32_t physical, uint32_t length)
+{
+    extent_item_t item   = {.logical = logical, .physical = physical, .length = (uint16_t)length};
+    int           status = extent_cache_reserve(cache, cache->count + 1);
+    if (status != EOK) return status;
+
+    extent_item_t *previous = index < cache->count ? &cache->items[index] : 0;
+
+    if (previous && !previous->unwritten && previous->logical + previous->length == logical && previous->physical + previous->length == physical && previous->length + length <= 0x7fffU) {
+        extent_item_t grown = *previous;
+        grown.length        = (uint16_t)(grown.length + length);
+        status              = extent_tree_splice(h, previous->logical, 1, &grown, 1);
+        if (status == EOK) {
+            *previous = grown;
+            extent_tree_changed(h, 1);
+            return EOK;
+        }
+        if (status != -ENOSPC) return status;
+        return extent_rebuild_replacing(h, previous->logical, 1, &grown, 1);
+    }
+
+    status = extent_tree_splice(h, logical, 0, &item, 1);
+    if (status == EOK) {
+        extent_cache_splice(cache, previous ? index + 1 : 0, 0, &item, 1);
+        extent_tree_changed(h, 1);
+        return EOK;
+    }
+    if (status != -ENOSPC) return status;
+    return extent_rebuild_replacing(h, 0, 0, &item, 1);
+}
+
+/* Allocate up to want physically contiguous blocks for the hole at logical, zeroing them unless the caller overwrites the run. */
+static uint32_t extent_allocate(extfs_handle_t *h, extfs_extent_cache_t *cache, uint32_t index, uint32_t logical, uint32_t want, int zero_fill, uint32_t *count)
+{
+    extent_item_t *previous = index < cache->count ? &cache->items[index] : 0;
+    uint32_t       goal     = previous ? previous->physical + (logical - previous->logical) : 0;
+    uint32_t       first, allocated;
+
+    /* Without a neighbouring extent, keep the file's data near its inode. */
+    if (!goal) goal = h->sb->s_first_data_block + (h->inode_no - 1) / h->sb->inodes_per_group * h->sb->blocks_per_group;
+    if (want > 0x7fffU) want = 0x7fffU;
+    if (extfs_alloc_blocks(h->sb, goal, want, &first, &allocated) != EOK) return 0;
+
+    int status = EOK;
+    if (zero_fill) {
+        uint32_t chunk = EXTFS_IO_RUN_MAX / h->sb->block_size;
+        chunk          = chunk && chunk < allocated ? chunk : allocated;
+        uint8_t *zero  = calloc(chunk, h->sb->block_size);
+        status         = zero ? EOK : -ENOMEM;
+        for (uint32_t done = 0; status == EOK && done < allocated; done += chunk) {
+            uint32_t blocks = allocated - done < chunk ? allocated - done : chunk;
+            status          = extfs_write_data_blocks(h->sb, first + done, blocks, zero);
+        }
+        free(zero);
+    }
+
+    if (status == EOK) status = extent_record(h, cache, index, logical, first, allocated);
+    if (status != EOK) {
+        for (uint32_t i = 0; i < allocated; i++) extfs_free_block(h->sb, first + i);
+        return 0;
+    }
+    if (count) *count = allocated;
+    return first;
+}
+
+/* Convert part of an unwritten extent to written, splitting off the untouched ends. */
+static uint32_t extent_convert_unwritten(extfs_handle_t *h, extfs_extent_cache_t *cache, uint32_t index, uint32_t logical, uint32_t length, uint32_t *count)
+{
+    extent_item_t item = cache->items[index];
+    uint32_t      end  = logical + length;
+    extent_item_t pieces[3];
+    uint16_t      pieces_count = 0, written;
+
+    if (logical > item.logical) pieces[pieces_count++] = (extent_item_t) {.logical = item.logical, .physical = item.physical, .length = (uint16_t)(logical - item.logical), .unwritten = 1};
+    written                  = pieces_count;
+    pieces[pieces_count++]   = (extent_item_t) {.logical = logical, .physical = item.physical + logical - item.logical, .length = (uint16_t)length};
+    if (end < item.logical + item.length)
+        pieces[pieces_count++] = (extent_item_t) {.logical = end, .physical = item.physical + end - item.logical, .length = (uint16_t)(item.logical + item.length - end), .unwritten = 1};
+
+    int status = extent_cache_reserve(cache, cache->count + 2);
+    if (status == EOK) status = extent_tree_splice(h, item.logical, 1, pieces, pieces_count);
+    if (status == EOK) {
+        extent_cache_splice(cache, index, 1, pieces, pieces_count);
+        extent_tree_changed(h, 1);
+    } else if (status == -ENOSPC) {
+        status = extent_rebuild_replacing(h, item.logical, 1, pieces, pieces_count);
+    }
+    if (status != EOK) return 0;
+    if (count) *count = length;
+    return pieces[written].physical;
+}
+
+/*
+ * Map up to max_blocks logical blocks starting at logical.  Returns the first
+ * physical block of the run (0 for a hole or unwritten run) and its length in
+ * count.  With create set, holes are filled by one physically contiguous
+ * allocation recorded as a single extent; EXTFS_MAP_OVERWRITE leaves it
+ * unzeroed for a caller that writes the whole returned run.
+ */
+uint32_t extfs_extent_map_range(extfs_handle_t *h, uint32_t logical, uint32_t max_blocks, int create, uint32_t *count)
+{
+    if (count) *count = 0;
+    if (!h || !h->sb || !max_blocks) return 0;
+
+    extfs_extent_cache_t *cache = extent_cache_get(h);
+    if (!cache) return 0;
+
+    uint32_t index = extent_cache_find(cache, logical);
+    if (index < cache->count) {
+        extent_item_t *item = &cache->items[index];
+        uint64_t       end  = (uint64_t)item->logical + item->length;
+        if (logical < end) {
+            uint32_t run = end - logical < max_blocks ? (uint32_t)(end - logical) : max_blocks;
+            if (item->unwritten) {
+                if (create) return extent_convert_unwritten(h, cache, index, logical, run, count);
+                if (count) *count = run;
+                return 0;
+            }
+            if (count) *count = run;
+            return item->physical + (logical - item->logical);
+        }
+    }
+
+    /* A hole, ending at the next extent */
+    uint32_t next = index < cache->count ? index + 1 : 0;
+    uint64_t hole = next < cache->count ? cache->items[next].logical - logical : (uint64_t)UINT32_MAX - logical;
+    uint32_t run  = hole < max_blocks ? (uint32_t)hole : max_blocks;
+    if (!run) return 0;
+    if (!create) {
+        if (count) *count = run;
+        return 0;
+    }
+    return extent_allocate(h, cache, index, logical, run, create != EXTFS_MAP_OVERWRITE, count);
+}
+
+/* Map a logical block through the extent tree, allocating on demand. */
+uint32_t extfs_extent_map_block(extfs_handle_t *h, uint32_t logical, int create)
+{
+    return extfs_extent_map_range(h, logical, 1, create, 0);
 }
 
 /* Free the extent space covering logical blocks [first, last). */
@@ -503,6 +908,7 @@ int extfs_extent_remove_space(extfs_handle_t *h, uint32_t first, uint32_t last)
     if (status == EOK) status = extent_rebuild(h, &replacement);
     extent_vector_destroy(&replacement);
     extent_vector_destroy(&old);
+    extent_tree_changed(h, 0);
     return status;
 }
 
@@ -515,14 +921,9 @@ int extfs_extent_free_all(extfs_handle_t *h)
 /* Count the data and index blocks owned by the extent tree. */
 int extfs_extent_count_blocks(extfs_handle_t *h, uint64_t *blocks)
 {
-    extent_vector_t vector;
-    int             status = extent_collect(h, &vector);
-    if (status != EOK) {
-        extent_vector_destroy(&vector);
-        return status;
-    }
-    *blocks = vector.metadata_count;
-    for (uint32_t i = 0; i < vector.count; i++) *blocks += vector.items[i].length;
-    extent_vector_destroy(&vector);
+    extfs_extent_cache_t *cache = extent_cache_get(h);
+    if (!cache) return -EIO;
+    *blocks = cache->metadata_count;
+    for (uint32_t i = 0; i < cache->count; i++) *blocks += cache->items[i].length;
     return EOK;
 }
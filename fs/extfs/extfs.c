@@ -172,7 +172,7 @@ static int extfs_load_directory(vfs_node_t node)
                 }
                 vfs_node_t child = vfs_node_alloc(node, name);
                 if (!child) {
-                    free(child_h);
+                    extfs_free_handle(child_h);
                     free(block);
                     return -ENOMEM;
                 }
@@ -237,7 +237,7 @@ static int extfs_mount(const char *src, vfs_node_t node)
     if (!(node->type & file_dir) || !node->size) {
         extfs_free_super(sb);
         free(sb);
-        free(h);
+        extfs_free_handle(h);
         node->handle = 0;
         return -EIO;
     }
@@ -246,7 +246,7 @@ static int extfs_mount(const char *src, vfs_node_t node)
     if (status != EOK) {
         extfs_free_super(sb);
         free(sb);
-        free(h);
+        extfs_free_handle(h);
         node->handle = 0;
         return status;
     }
@@ -259,7 +259,7 @@ static int extfs_mount(const char *src, vfs_node_t node)
         if (status != EOK) {
             extfs_free_super(sb);
             free(sb);
-            free(h);
+            extfs_free_handle(h);
             node->handle = 0;
             return status;
         }
@@ -282,7 +282,7 @@ static void extfs_unmount(void *root)
 
     if (!h) return;
     if (h->owns_sb && h->sb) {
-        if (!h->sb->read_only && blockdev_flush(&h->sb->device) == EOK) {
+        if (!h->sb->read_only && extfs_alloc_flush(h->sb) == EOK && blockdev_flush(&h->sb->device) == EOK) {
             h->sb->es->s_state |= EXT2_VALID_FS;
             if (h->sb->journal) h->sb->es->s_feature_incompat &= ~EXT3_FEATURE_INCOMPAT_RECOVER;
             if (extfs_write_super(h->sb) == EOK) (void)blockdev_flush(&h->sb->device);
@@ -290,7 +290,7 @@ static void extfs_unmount(void *root)
         extfs_free_super(h->sb);
         free(h->sb);
     }
-    free(h);
+    extfs_free_handle(h);
     node->handle = 0;
 }
 
@@ -378,6 +378,7 @@ static int extfs_sync(void *file, int data_only)
     (void)data_only;
     if (!h) return -EINVAL;
     int status = extfs_flush_inode(h);
+    if (status == EOK) status = extfs_alloc_flush(h->sb);
     if (status == EOK) status = blockdev_flush(&h->sb->device);
     if (status != EOK) h->sb->read_only = 1;
     return status;
@@ -468,7 +469,7 @@ static int extfs_mkdir_impl(void *parent, const char *name, vfs_node_t node)
 
     status = extfs_make_empty_dir(new_h, new_ino, dir_h->inode_no);
     if (status != EOK) {
-        free(new_h);
+        extfs_free_handle(new_h);
         extfs_free_inode(sb, new_ino);
         return status;
     }
@@ -477,7 +478,7 @@ static int extfs_mkdir_impl(void *parent, const char *name, vfs_node_t node)
     if (status != EOK) {
         extfs_free_inode_blocks(new_h);
         extfs_free_inode(sb, new_ino);
-        free(new_h);
+        extfs_free_handle(new_h);
         return status;
     }
 
@@ -485,7 +486,7 @@ static int extfs_mkdir_impl(void *parent, const char *name, vfs_node_t node)
     if (status != EOK) {
         extfs_free_inode_blocks(new_h);
         extfs_free_inode(sb, new_ino);
-        free(new_h);
+        extfs_free_handle(new_h);
         return status;
     }
 
@@ -493,7 +494,7 @@ static int extfs_mkdir_impl(void *parent, const char *name, vfs_node_t node)
     parent_raw.i_mtime = parent_raw.i_ctime;
     status             = extfs_write_inode_raw(sb, dir_h->inode_no, &parent_raw);
     if (status != EOK) {
-        free(new_h);
+        extfs_free_handle(new_h);
         return status;
     }
 
@@ -632,7 +633,7 @@ static int extfs_link_impl(void *parent, const char *target_name, vfs_node_t nod
         goto out;
     }
     if (extfs_load_inode(new_h) != EOK) {
-        free(new_h);
+        extfs_free_handle(new_h);
         status = -EIO;
         goto out;
     }
@@ -707,7 +708,7 @@ static int extfs_symlink_impl(void *parent, const char *name, vfs_node_t node)
         if (status != (int)target_len) {
             extfs_free_inode_blocks(new_h);
             extfs_free_inode(sb, new_ino);
-            free(new_h);
+            extfs_free_handle(new_h);
             return status < 0 ? status : -EIO;
         }
     }
@@ -716,12 +717,12 @@ static int extfs_symlink_impl(void *parent, const char *name, vfs_node_t node)
     if (status != EOK) {
         extfs_free_inode_blocks(new_h);
         extfs_free_inode(sb, new_ino);
-        free(new_h);
+        extfs_free_handle(new_h);
         return status;
     }
     status = extfs_touch_inode(sb, dir_h->inode_no, 1);
     if (status != EOK) {
-        free(new_h);
+        extfs_free_handle(new_h);
         return status;
     }
 
@@ -814,20 +815,20 @@ static int extfs_rmdir_impl(void *parent, const char *name)
 
     status = extfs_dir_empty(child_h);
     if (status <= 0) {
-        free(child_h);
+        extfs_free_handle(child_h);
         return status < 0 ? status : -ENOTEMPTY;
     }
 
     status = extfs_dir_remove_entry(dir_h, name);
     if (status != EOK) {
-        free(child_h);
+        extfs_free_handle(child_h);
         return status;
     }
 
     extfs_free_inode_blocks(child_h);
     status = extfs_release_xattr_block(child_h);
     if (status != EOK) {
-        free(child_h);
+        extfs_free_handle(child_h);
         return status;
     }
     memset(raw.i_block, 0, sizeof(raw.i_block));
@@ -840,13 +841,13 @@ static int extfs_rmdir_impl(void *parent, const char *name)
     raw.i_ctime           = raw.i_dtime;
     status                = extfs_write_inode_raw(sb, child_ino, &raw);
     if (status != EOK) {
-        free(child_h);
+        extfs_free_handle(child_h);
         return status;
     }
     extfs_free_inode(sb, child_ino);
     status = extfs_adjust_used_dirs(sb, child_ino, -1);
     if (status != EOK) {
-        free(child_h);
+        extfs_free_handle(child_h);
         return status;
     }
 
@@ -854,7 +855,7 @@ static int extfs_rmdir_impl(void *parent, const char *name)
     ext2_inode_t parent_raw;
     status = extfs_read_inode_raw(sb, dir_h->inode_no, &parent_raw);
     if (status != EOK) {
-        free(child_h);
+        extfs_free_handle(child_h);
         return status;
     }
     if (parent_raw.i_links_count > 2) parent_raw.i_links_count--;
@@ -862,11 +863,11 @@ static int extfs_rmdir_impl(void *parent, const char *name)
     parent_raw.i_mtime = parent_raw.i_ctime;
     status             = extfs_write_inode_raw(sb, dir_h->inode_no, &parent_raw);
     if (status != EOK) {
-        free(child_h);
+        extfs_free_handle(child_h);
         return status;
     }
 
-    free(child_h);
+    extfs_free_handle(child_h);
     return EOK;
 }
 
@@ -1125,7 +1126,7 @@ static int extfs_free(void *handle)
 {
     extfs_handle_t *h = handle;
     if (!h) return EOK;
-    free(h);
+    extfs_free_handle(h);
     return EOK;
 }
 
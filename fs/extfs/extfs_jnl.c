@@ -717,7 +717,7 @@ void extfs_jnl_close(extfs_journal_t *journal)
     if (!journal) return;
     extfs_jnl_free_records(journal);
     free(journal->super_buffer);
-    free(journal->inode);
+    extfs_free_handle(journal->inode);
     free(journal);
 }
 
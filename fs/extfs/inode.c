@@ -47,6 +47,14 @@ extfs_handle_t *extfs_alloc_handle(extfs_sb_info_t *sb, uint32_t ino)
     return h;
 }
 
+/* Free a handle and its cached extent state. */
+void extfs_free_handle(extfs_handle_t *h)
+{
+    if (!h) return;
+    extfs_extent_cache_drop(h);
+    free(h);
+}
+
 /* Load an inode's block pointers and flags into the handle. */
 int extfs_load_inode(extfs_handle_t *h)
 {
@@ -55,9 +63,14 @@ int extfs_load_inode(extfs_handle_t *h)
 
     if (!h || !h->sb) return -EINVAL;
 
-    status = extfs_read_inode_raw(h->sb, h->inode_no, &raw);
+    uint32_t generation = h->sb->inode_generation[h->inode_no % EXTFS_GEN_HASH];
+    status              = extfs_read_inode_raw(h->sb, h->inode_no, &raw);
     if (status != EOK) return status;
 
+    h->raw            = raw;
+    h->raw_generation = generation;
+    h->raw_valid      = 1;
+    extfs_extent_cache_drop(h);
     memcpy(h->ei.i_data, raw.i_block, sizeof(h->ei.i_data));
     h->ei.i_flags       = raw.i_flags;
     h->ei.i_file_acl    = raw.i_file_acl;
@@ -68,6 +81,32 @@ int extfs_load_inode(extfs_handle_t *h)
     return EOK;
 }
 
+/* Remember raw as the current on-disk inode after writing it through this handle. */
+static void extfs_cache_inode(extfs_handle_t *h, const ext2_inode_t *raw)
+{
+    h->raw            = *raw;
+    h->raw_generation = h->sb->inode_generation[h->inode_no % EXTFS_GEN_HASH];
+    h->raw_valid      = 1;
+}
+
+/* Return the on-disk inode, from the handle cache unless it was written since. */
+int extfs_get_inode(extfs_handle_t *h, ext2_inode_t *raw)
+{
+    if (!h || !h->sb || !raw) return -EINVAL;
+
+    uint32_t generation = h->sb->inode_generation[h->inode_no % EXTFS_GEN_HASH];
+    if (h->raw_valid && h->raw_generation == generation) {
+        *raw = h->raw;
+        return EOK;
+    }
+    int status = extfs_read_inode_raw(h->sb, h->inode_no, raw);
+    if (status != EOK) return status;
+    h->raw            = *raw;
+    h->raw_generation = generation;
+    h->raw_valid      = 1;
+    return EOK;
+}
+
 /* Write the handle's cached inode metadata back to disk. */
 int extfs_flush_inode(extfs_handle_t *h)
 {
@@ -324,20 +363,41 @@ uint32_t extfs_map_block(extfs_handle_t *h, uint32_t logical, int create)
     return 0;
 }
 
+/* Map a run of up to max_blocks logical blocks; count receives the run length. */
+uint32_t extfs_map_range(extfs_handle_t *h, uint32_t logical, uint32_t max_blocks, int create, uint32_t *count)
+{
+    if (count) *count = 0;
+    if (!h || !h->sb || !max_blocks) return 0;
+    if (h->ei.i_flags & EXT4_EXTENTS_FL) return extfs_extent_map_range(h, logical, max_blocks, create, count);
+
+    uint32_t physical = extfs_map_block(h, logical, create);
+    if (!physical && create) return 0;
+
+    /* Extend the run while the pointer map stays contiguous (or stays a hole). */
+    uint32_t run = 1;
+    while (run < max_blocks && logical + run > logical) {
+        uint32_t next = extfs_map_block(h, logical + run, create);
+        if (physical ? next != physical + run : next != 0) break;
+        run++;
+    }
+    if (count) *count = run;
+    return physical;
+}
+
 /* Read a byte range from an inode's data blocks. */
 int extfs_read_data(extfs_handle_t *h, void *buf, uint64_t offset, size_t size)
 {
     extfs_sb_info_t *sb;
     ext2_inode_t     raw;
-    uint8_t         *block_buf;
-    size_t           done = 0;
+    uint8_t         *block_buf = 0;
+    size_t           done      = 0;
     int              status;
 
     if (!h || !h->sb || !buf || size == 0) return 0;
     if (size > (UINT32_MAX >> 1)) return -EFBIG;
     sb = h->sb;
 
-    status = extfs_read_inode_raw(sb, h->inode_no, &raw);
+    status = extfs_get_inode(h, &raw);
     if (status != EOK) return status;
 
     uint64_t file_size = raw.i_size;
@@ -348,8 +408,21 @@ int extfs_read_data(extfs_handle_t *h, void *buf, uint64_t offset, size_t size)
     if (size > file_size - offset) size = (size_t)(file_size - offset);
     if (size > maximum_size - offset) size = (size_t)(maximum_size - offset);
 
-    block_buf = malloc(sb->block_size);
-    if (!block_buf) return -ENOMEM;
+    /* Only partial head and tail blocks are staged through a bounce buffer. */
+    if (offset % sb->block_size || (offset + size) % sb->block_size) {
+        block_buf = malloc(sb->block_size);
+        if (!block_buf) return -ENOMEM;
+    }
+
+    /* Map through the on-disk inode, sharing the handle's extent cache when it describes the same tree. */
+    extfs_handle_t  snapshot = *h;
+    extfs_handle_t *map_h    = h;
+    if (memcmp(h->ei.i_data, raw.i_block, sizeof(raw.i_block)) || h->ei.i_flags != raw.i_flags) {
+        memcpy(snapshot.ei.i_data, raw.i_block, sizeof(raw.i_block));
+        snapshot.ei.i_flags   = raw.i_flags;
+        snapshot.extent_cache = 0;
+        map_h                 = &snapshot;
+    }
 
     while (done < size) {
         uint64_t abs_pos   = offset + done;
@@ -360,12 +433,24 @@ int extfs_read_data(extfs_handle_t *h, void *buf, uint64_t offset, size_t size)
         uint32_t chunk   = (uint32_t)(size - done);
         uint32_t phys;
 
+        /* Whole blocks: read each contiguous run straight into the caller's buffer. */
+        if (!inblock && size - done >= sb->block_size) {
+            uint64_t blocks = (size - done) / sb->block_size;
+            uint32_t run;
+            if (blocks > EXTFS_IO_RUN_MAX / sb->block_size) blocks = EXTFS_IO_RUN_MAX / sb->block_size;
+            phys = extfs_map_range(map_h, logical, (uint32_t)blocks, 0, &run);
+            if (!run) run = 1;
+            if (!phys)
+                memset((uint8_t *)buf + done, 0, (size_t)run * sb->block_size);
+            else if (extfs_read_blocks(sb, phys, run, (uint8_t *)buf + done) != EOK)
+                break;
+            done += (size_t)run * sb->block_size;
+            continue;
+        }
+
         if (chunk > sb->block_size - inblock) chunk = sb->block_size - inblock;
 
-        extfs_handle_t tmp_h = *h;
-        memcpy(tmp_h.ei.i_data, raw.i_block, sizeof(raw.i_block));
-        tmp_h.ei.i_flags = raw.i_flags;
-        phys             = extfs_map_block(&tmp_h, logical, 0);
+        phys = extfs_map_block(map_h, logical, 0);
 
         if (phys == 0) {
             memset((uint8_t *)buf + done, 0, chunk);
@@ -379,6 +464,7 @@ int extfs_read_data(extfs_handle_t *h, void *buf, uint64_t offset, size_t size)
         done += chunk;
     }
 
+    if (map_h == &snapshot) extfs_extent_cache_drop(&snapshot);
     free(block_buf);
     return (int)done;
 }
@@ -388,8 +474,8 @@ int extfs_write_data(extfs_handle_t *h, const void *buf, uint64_t offset, size_t
 {
     extfs_sb_info_t *sb;
     ext2_inode_t     raw;
-    uint8_t         *block_buf;
-    size_t           done = 0;
+    uint8_t         *block_buf = 0;
+    size_t           done      = 0;
     int              status;
 
     if (!h || !h->sb || !buf || size == 0) return 0;
@@ -397,11 +483,14 @@ int extfs_write_data(extfs_handle_t *h, const void *buf, uint64_t offset, size_t
     uint64_t maximum_size = (uint64_t)UINT32_MAX * sb->block_size;
     if (size > (UINT32_MAX >> 1) || offset >= maximum_size || size > maximum_size - offset) return -EFBIG;
 
-    status = extfs_read_inode_raw(sb, h->inode_no, &raw);
+    status = extfs_get_inode(h, &raw);
     if (status != EOK) return status;
 
-    block_buf = malloc(sb->block_size);
-    if (!block_buf) return -ENOMEM;
+    /* Only partial head and tail blocks need a read-modify-write buffer. */
+    if (offset % sb->block_size || (offset + size) % sb->block_size) {
+        block_buf = malloc(sb->block_size);
+        if (!block_buf) return -ENOMEM;
+    }
 
     while (done < size) {
         uint64_t abs_pos   = offset + done;
@@ -412,16 +501,26 @@ int extfs_write_data(extfs_handle_t *h, const void *buf, uint64_t offset, size_t
         uint32_t chunk   = (uint32_t)(size - done);
         uint32_t phys;
 
+        /* Whole blocks: allocate a contiguous run and write it straight from the caller's buffer. */
+        if (!inblock && size - done >= sb->block_size) {
+            uint64_t blocks = (size - done) / sb->block_size;
+            uint32_t run;
+            if (blocks > EXTFS_IO_RUN_MAX / sb->block_size) blocks = EXTFS_IO_RUN_MAX / sb->block_size;
+            phys = extfs_map_range(h, logical, (uint32_t)blocks, EXTFS_MAP_OVERWRITE, &run);
+            if (phys == 0 || !run) break;
+            if (extfs_write_data_blocks(sb, phys, run, (const uint8_t *)buf + done) != EOK) break;
+            done += (size_t)run * sb->block_size;
+            continue;
+        }
+
         if (chunk > sb->block_size - inblock) chunk = sb->block_size - inblock;
 
         phys = extfs_map_block(h, logical, 1);
         if (phys == 0) break;
 
-        if (inblock > 0 || chunk < sb->block_size) {
-            if (extfs_read_block(sb, phys, block_buf) != EOK) {
-                plogk("extfs: Read of inode %llu failed at block %u\n", (unsigned long long)h->inode_no, phys);
-                break;
-            }
+        if (extfs_read_block(sb, phys, block_buf) != EOK) {
+            plogk("extfs: Read of inode %llu failed at block %u\n", (unsigned long long)h->inode_no, phys);
+            break;
         }
 
         memcpy(block_buf + inblock, (const uint8_t *)buf + done, chunk);
@@ -432,7 +531,7 @@ int extfs_write_data(extfs_handle_t *h, const void *buf, uint64_t offset, size_t
     }
 
     if (done) {
-        status = extfs_read_inode_raw(sb, h->inode_no, &raw);
+        status = extfs_get_inode(h, &raw);
         if (status != EOK) {
             free(block_buf);
             return status;
@@ -457,6 +556,7 @@ int extfs_write_data(extfs_handle_t *h, const void *buf, uint64_t offset, size_t
             free(block_buf);
             return status;
         }
+        extfs_cache_inode(h, &raw);
     }
 
     free(block_buf);
@@ -256,12 +256,57 @@ int extfs_write_data_block(extfs_sb_info_t *sb, uint32_t phys_block, const void
     return blockdev_write_bytes(&sb->device, extfs_block_offset(sb, phys_block), buf, sb->block_size);
 }
 
+/* Whether count blocks at phys_block can go to the device as one sector request. */
+static int extfs_direct_io(extfs_sb_info_t *sb, uint32_t phys_block, uint32_t count)
+{
+    uint32_t sector_size = sb->device.sector_size;
+    if (sb->active_transaction || !sector_size || sb->block_size % sector_size) return 0;
+    return (uint64_t)count * (sb->block_size / sector_size) <= UINT32_MAX && phys_block < sb->blocks_count && count <= sb->blocks_count - phys_block;
+}
+
+/* Read count contiguous blocks into buf, as a single device request when possible. */
+int extfs_read_blocks(extfs_sb_info_t *sb, uint32_t phys_block, uint32_t count, void *buf)
+{
+    if (!sb || !sb->es || !buf) return -EINVAL;
+    if (!extfs_direct_io(sb, phys_block, count)) {
+        for (uint32_t i = 0; i < count; i++) {
+            int status = extfs_read_block(sb, phys_block + i, (uint8_t *)buf + (size_t)i * sb->block_size);
+            if (status != EOK) return status;
+        }
+        return EOK;
+    }
+    uint32_t per_block = sb->block_size / sb->device.sector_size;
+    int      status    = blockdev_read_sectors(&sb->device, (uint64_t)phys_block * per_block, count * per_block, buf);
+    if (status != EOK) plogk("extfs: Drive %u: read of blocks %u+%u failed: %d\n", sb->device.drive, phys_block, count, status);
+    return status;
+}
+
+/* Write count contiguous data blocks from buf, as a single device request when possible. */
+int extfs_write_data_blocks(extfs_sb_info_t *sb, uint32_t phys_block, uint32_t count, const void *buf)
+{
+    if (!sb || !sb->es || !buf || sb->read_only) return sb && sb->read_only ? -EROFS : -EINVAL;
+    if (!extfs_direct_io(sb, phys_block, count)) {
+        for (uint32_t i = 0; i < count; i++) {
+            int status = extfs_write_data_block(sb, phys_block + i, (const uint8_t *)buf + (size_t)i * sb->block_size);
+            if (status != EOK) return status;
+        }
+        return EOK;
+    }
+    uint32_t per_block = sb->block_size / sb->device.sector_size;
+    int      status    = blockdev_write_sectors(&sb->device, (uint64_t)phys_block * per_block, count * per_block, buf);
+    if (status != EOK) plogk("extfs: Drive %u: write of blocks %u+%u failed: %d\n", sb->device.drive, phys_block, count, status);
+    return status;
+}
+
 /* Begin a transaction, making it the volume's active one. */
 int extfs_transaction_begin(extfs_sb_info_t *sb, fs_txn_t *transaction, uint32_t credits)
 {
     int status;
     if (!sb || !transaction || sb->active_transaction || !sb->transaction_log_initialized) return -EINVAL;
     if (sb->read_only) return -EROFS;
+    /* Allocator changes made outside a transaction must not be rolled back with this one. */
+    status = extfs_alloc_flush(sb);
+    if (status != EOK) return status;
     status = fs_txn_begin(&sb->transaction_log, credits, transaction);
     if (status == EOK) sb->active_transaction = transaction;
     return status;
@@ -271,8 +316,15 @@ int extfs_transaction_begin(extfs_sb_info_t *sb, fs_txn_t *transaction, uint32_t
 int extfs_transaction_commit(extfs_sb_info_t *sb, fs_txn_t *transaction)
 {
     if (!sb || !transaction || sb->active_transaction != transaction) return -EINVAL;
+
+    /* Stage the batched bitmap, descriptor and superblock updates into this transaction. */
+    int status = extfs_alloc_flush(sb);
+    if (status != EOK) {
+        extfs_transaction_abort(sb, transaction, status);
+        return status;
+    }
     sb->active_transaction = 0;
-    int status             = fs_txn_commit(transaction);
+    status                 = fs_txn_commit(transaction);
     if (status != EOK) sb->read_only = 1;
     return status;
 }
@@ -283,6 +335,9 @@ void extfs_transaction_abort(extfs_sb_info_t *sb, fs_txn_t *transaction, int err
     if (!sb || !transaction || sb->active_transaction != transaction) return;
     sb->active_transaction = 0;
     fs_txn_abort(transaction, error);
+    extfs_alloc_discard(sb);
+    /* Inodes cached while the transaction was staged may no longer match the disk. */
+    for (uint32_t i = 0; i < EXTFS_GEN_HASH; i++) sb->inode_generation[i]++;
     /* Discard allocator counter changes that only existed in the aborted transaction. */
     if (blockdev_read_bytes(&sb->device, 1024, sb->es, sizeof(*sb->es)) != EOK) {
         sb->read_only = 1;
@@ -373,6 +428,7 @@ int extfs_write_inode_raw(extfs_sb_info_t *sb, uint32_t ino, const ext2_inode_t
         }
         status = extfs_disk_write(sb, byte_offset, inode, sb->inode_size);
     }
+    sb->inode_generation[ino % EXTFS_GEN_HASH]++;
     free(inode);
     return status;
 }
@@ -597,6 +653,7 @@ void extfs_free_super(extfs_sb_info_t *sb)
     if (!sb) return;
     if (sb->transaction_log_initialized) fs_txn_log_destroy(&sb->transaction_log);
     if (sb->journal) extfs_jnl_close(sb->journal);
+    extfs_alloc_discard(sb);
     if (sb->group_desc) free(sb->group_desc);
     if (sb->es) free(sb->es);
     blockdev_release(&sb->device);
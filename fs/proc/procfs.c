@@ -32,10 +32,12 @@
 #include <mem/hhdm.h>
 #include <mem/page.h>
 #include <mem/pagecache.h>
+#include <mem/rmap.h>
 #include <mem/swap.h>
 #include <net/abi/inet.h>
 #include <net/core/netdev.h>
 #include <net/socket.h>
+#include <net/transport/tcp_cong.h>
 #include <process/process.h>
 #include <process/sched.h>
 #include <security/seccomp.h>
@@ -155,6 +157,8 @@ typedef struct procfs_sysctl {
         uint64_t    minimum;
         uint64_t    maximum;
         char        string[64];
+        int (*store)(const char *string);        // PROC_SYS_STR: validate and act on a write
+        void (*show)(char *string, size_t size); // PROC_SYS_STR: refresh string before a read
 } procfs_sysctl_t;
 
 static procfs_sysctl_t procfs_sysctl_kernel[] = {
@@ -187,8 +191,32 @@ static procfs_sysctl_t procfs_sysctl_kernel[] = {
     {.name = "printk", .kind = PROC_SYS_MULTI, .values = {7, 4, 1, 7}, .readonly = 1, .count = 4},
 };
 
-#define PROCFS_SYSCTL_KERNEL_COUNT (sizeof(procfs_sysctl_kernel) / sizeof(procfs_sysctl_kernel[0]))
-#define PROC_SYS_KERNEL            0
+static procfs_sysctl_t procfs_sysctl_net_ipv4[] = {
+    {.name = "tcp_congestion_control", .kind = PROC_SYS_STR, .string = "cubic", .count = 0, .store = tcp_congestion_set_default},
+    {.name = "tcp_available_congestion_control", .kind = PROC_SYS_STR, .readonly = 1, .count = 0, .show = tcp_congestion_available},
+};
+
+#define PROCFS_SYSCTL_KERNEL_COUNT   (sizeof(procfs_sysctl_kernel) / sizeof(procfs_sysctl_kernel[0]))
+#define PROCFS_SYSCTL_NET_IPV4_COUNT (sizeof(procfs_sysctl_net_ipv4) / sizeof(procfs_sysctl_net_ipv4[0]))
+#define PROC_SYS_KERNEL              0
+#define PROC_SYS_NET                 1
+#define PROC_SYS_NET_IPV4            2
+
+/* Directories below /proc/sys, indexed by PROC_SYS_*; parent -1 is /proc/sys itself. */
+typedef struct procfs_sysctl_dir {
+        const char      *name;
+        int              parent;
+        procfs_sysctl_t *entries;
+        size_t           count;
+} procfs_sysctl_dir_t;
+
+static const procfs_sysctl_dir_t procfs_sysctl_dirs[] = {
+    [PROC_SYS_KERNEL]   = {"kernel", -1, procfs_sysctl_kernel, PROCFS_SYSCTL_KERNEL_COUNT},
+    [PROC_SYS_NET]      = {"net", -1, NULL, 0},
+    [PROC_SYS_NET_IPV4] = {"ipv4", PROC_SYS_NET, procfs_sysctl_net_ipv4, PROCFS_SYSCTL_NET_IPV4_COUNT},
+};
+
+#define PROCFS_SYSCTL_DIR_COUNT (sizeof(procfs_sysctl_dirs) / sizeof(procfs_sysctl_dirs[0]))
 
 /* No-op for procfs link callbacks that need no implementation. */
 static void procfs_dummy(void)
@@ -245,6 +273,7 @@ static vfs_node_t procfs_ensure_child(vfs_node_t parent, const char *name, procf
 
     child->flags &= ~(VFS_NODE_UNLINKED | VFS_NODE_UNLINKING | VFS_NODE_FINALIZING | VFS_NODE_INITIALIZING);
     child->flags |= VFS_NODE_NOCACHE;
+    vfs_dcache_invalidate(child->parent);
     child->type = node_type;
     return child;
 }
@@ -340,12 +369,19 @@ static void gen_info_meminfo(procfs_file_t *pf)
     size_t       cached_kb    = cache.pages * PAGE_4K_SIZE / 1024;
     size_t       dirty_kb     = cache.dirty * PAGE_4K_SIZE / 1024;
     size_t       writeback_kb = cache.writeback * PAGE_4K_SIZE / 1024;
-    size_t       active_kb    = cache.active * PAGE_4K_SIZE / 1024;
-    size_t       inactive_kb  = cache.inactive * PAGE_4K_SIZE / 1024;
+    rmap_stats_t anon;
+    rmap_get_stats(&anon);
+    size_t       anon_kb      = (anon.active + anon.inactive) * PAGE_4K_SIZE / 1024;
+    size_t       active_kb    = (cache.active + anon.active) * PAGE_4K_SIZE / 1024;
+    size_t       inactive_kb  = (cache.inactive + anon.inactive) * PAGE_4K_SIZE / 1024;
     size_t       clean_pages  = cache.pages > cache.dirty ? cache.pages - cache.dirty : 0;
     size_t       available_kb = free_kb + clean_pages * PAGE_4K_SIZE / 1024;
     swap_stats_t swap;
     swap_get_stats(&swap);
+    heap_stats_t heap;
+    heap_get_stats(&heap);
+    size_t       heap_used = heap.arena_bytes + heap.metadata_bytes; // mapped, not merely reserved
+
     int n = snprintf(buf, PROCFS_BUF_SIZE,
                      "MemTotal:       %8zu kB\n"
                      "MemFree:        %8zu kB\n"
@@ -368,8 +404,9 @@ static void gen_info_meminfo(procfs_file_t *pf)
                      "VmallocTotal:   %8zu kB\n"
                      "VmallocUsed:    %8zu kB\n"
                      "VmallocChunk:   %8zu kB\n",
-                     total_kb, free_kb, available_kb, 0UL, cached_kb, 0UL, active_kb, inactive_kb, (size_t)(swap.total_pages * SWAP_PAGE_SIZE / 1024),
-                     (size_t)(swap.free_pages * SWAP_PAGE_SIZE / 1024), dirty_kb, writeback_kb, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, (KERNEL_HEAP_SIZE) / 1024, 0UL, (KERNEL_HEAP_SIZE) / 1024);
+                     total_kb, free_kb, available_kb, 0UL, cached_kb, (size_t)(swap.cache_pages * SWAP_PAGE_SIZE / 1024), active_kb, inactive_kb, (size_t)(swap.total_pages * SWAP_PAGE_SIZE / 1024),
+                     (size_t)(swap.free_pages * SWAP_PAGE_SIZE / 1024), dirty_kb, writeback_kb, anon_kb, 0UL, 0UL, 0UL, 0UL, 0UL, heap.window_bytes / 1024, heap_used / 1024,
+                     (heap.window_bytes > heap_used ? heap.window_bytes - heap_used : 0) / 1024);
 
     pf->content  = buf;
     pf->size     = n < 0 ? 0 : (size_t)n;
@@ -385,23 +422,44 @@ static void gen_info_vmstat(procfs_file_t *pf)
     pagecache_get_stats(&cache);
     swap_stats_t swap;
     swap_get_stats(&swap);
+    frame_watermarks_t watermarks;
+    frame_get_watermarks(&watermarks);
+    frame_reclaim_stats_t reclaim;
+    frame_get_reclaim_stats(&reclaim);
+    rmap_stats_t anon;
+    rmap_get_stats(&anon);
     int n        = snprintf(buf, PROCFS_BUF_SIZE,
-                            "nr_file_pages %llu\n"
+                            "nr_free_pages %llu\n"
+                                   "nr_active_anon %llu\n"
+                                   "nr_inactive_anon %llu\n"
+                                   "nr_file_pages %llu\n"
                                    "nr_active_file %llu\n"
                                    "nr_inactive_file %llu\n"
                                    "nr_dirty %llu\n"
                                    "nr_writeback %llu\n"
+                                   "nr_min_free_pages %llu\n"
+                                   "nr_low_free_pages %llu\n"
+                                   "nr_high_free_pages %llu\n"
                                    "pgpgin %llu\n"
                                    "pgpgout %llu\n"
                                    "pswpin %llu\n"
                                    "pswpout %llu\n"
+                                   "swap_ra %llu\n"
+                                   "swap_ra_hit %llu\n"
                                    "pgactivate %llu\n"
+                                   "pgdeactivate %llu\n"
+                                   "pgscan_kswapd %llu\n"
+                                   "pgscan_direct %llu\n"
                                    "pgsteal_kswapd %llu\n"
+                                   "pgsteal_direct %llu\n"
+                                   "pageoutrun %llu\n"
+                                   "allocstall_normal %llu\n"
                                    "workingset_refault_file %llu\n"
                                    "workingset_activate_file %llu\n"
                                    "nr_vmscan_write %llu\n",
-                            cache.pages, cache.active, cache.inactive, cache.dirty, cache.writeback, cache.reads * 4, cache.writes * 4, swap.pages_in, swap.pages_out, cache.active, cache.reclaimed,
-                            cache.misses, cache.hits, cache.writeback_errors);
+                            (uint64_t)frame_allocator.usable_frames, anon.active, anon.inactive, cache.pages, cache.active, cache.inactive, cache.dirty, cache.writeback, (uint64_t)watermarks.min,
+                            (uint64_t)watermarks.low, (uint64_t)watermarks.high, cache.reads * 4, cache.writes * 4, swap.pages_in, swap.pages_out, swap.readahead, swap.readahead_hits, anon.activated, anon.deactivated, reclaim.scan_kswapd,
+                            reclaim.scan_direct, reclaim.steal_kswapd, reclaim.steal_direct, reclaim.kswapd_wakeups, reclaim.alloc_stalls, cache.misses, cache.hits, cache.writeback_errors);
     pf->content  = buf;
     pf->size     = n < 0 ? 0 : (size_t)n;
     pf->capacity = PROCFS_BUF_SIZE;
@@ -953,18 +1011,25 @@ static void gen_tty_ldiscs(procfs_file_t *pf)
 /* Return the sysctl entry for a directory index. */
 static procfs_sysctl_t *procfs_sysctl_lookup(int dir, size_t index)
 {
-    if (dir == PROC_SYS_KERNEL && index < PROCFS_SYSCTL_KERNEL_COUNT) return &procfs_sysctl_kernel[index];
-    return NULL;
+    if (dir < 0 || (size_t)dir >= PROCFS_SYSCTL_DIR_COUNT || index >= procfs_sysctl_dirs[dir].count) return NULL;
+    return &procfs_sysctl_dirs[dir].entries[index];
 }
 
-/* Find a sysctl entry by name. */
-static procfs_sysctl_t *procfs_sysctl_find(int dir, const char *name)
+/* Find a sysctl entry by name, returning its index in the directory or -1. */
+static int procfs_sysctl_find(int dir, const char *name)
 {
-    if (dir == PROC_SYS_KERNEL) {
-        for (size_t i = 0; i < PROCFS_SYSCTL_KERNEL_COUNT; i++)
-            if (streq(procfs_sysctl_kernel[i].name, name)) return &procfs_sysctl_kernel[i];
-    }
-    return NULL;
+    if (dir < 0 || (size_t)dir >= PROCFS_SYSCTL_DIR_COUNT) return -1;
+    for (size_t i = 0; i < procfs_sysctl_dirs[dir].count; i++)
+        if (streq(procfs_sysctl_dirs[dir].entries[i].name, name)) return (int)i;
+    return -1;
+}
+
+/* Find a subdirectory of a /proc/sys directory by name, returning its PROC_SYS_* index or -1. */
+static int procfs_sysctl_find_dir(int parent, const char *name)
+{
+    for (size_t i = 0; i < PROCFS_SYSCTL_DIR_COUNT; i++)
+        if (procfs_sysctl_dirs[i].parent == parent && streq(procfs_sysctl_dirs[i].name, name)) return (int)i;
+    return -1;
 }
 
 /* Generate a /proc/sys sysctl file content. */
@@ -977,6 +1042,7 @@ static void gen_sysctl_file(procfs_file_t *pf)
 
     int n = 0;
     if (sc->kind == PROC_SYS_STR) {
+        if (sc->show) sc->show(sc->string, sizeof(sc->string));
         n = snprintf(buf, PROCFS_BUF_SIZE, "%s\n", sc->string);
     } else if (sc->kind == PROC_SYS_UINT) {
         n = snprintf(buf, PROCFS_BUF_SIZE, "%llu\n", (unsigned long long)sc->values[0]);
@@ -1008,6 +1074,13 @@ static int procfs_sysctl_apply(procfs_sysctl_t *sc, const char *data, size_t siz
         size_t len = size;
         while (len && (data[len - 1] == '\n' || data[len - 1] == '\r' || data[len - 1] == ' ' || data[len - 1] == '\t')) len--;
         if (!len || memchr(data, '\0', len) || len >= sizeof(sc->string)) return -EINVAL;
+        if (sc->store) {
+            char string[sizeof(sc->string)];
+            memcpy(string, data, len);
+            string[len] = '\0';
+            int status  = sc->store(string);
+            if (status) return status;
+        }
         memcpy(sc->string, data, len);
         sc->string[len] = '\0';
         return EOK;
@@ -2116,20 +2189,21 @@ static void procfs_open(void *parent, const char *name, vfs_node_t node)
             break;
         }
         case PROCFS_SYS_DIR : {
-            if (streq(name, "kernel")) {
+            int dir = procfs_sysctl_find_dir(ppf->subtype, name);
+            if (dir >= 0) {
                 pf->type    = PROCFS_SYS_DIR;
-                pf->subtype = PROC_SYS_KERNEL;
+                pf->subtype = dir;
                 node->type  = file_dir;
                 break;
             }
-            procfs_sysctl_t *sc = procfs_sysctl_find(ppf->subtype, name);
-            if (!sc) {
+            int index = procfs_sysctl_find(ppf->subtype, name);
+            if (index < 0) {
                 free(pf);
                 return;
             }
             pf->type    = PROCFS_SYS_FILE;
             pf->subtype = ppf->subtype;
-            pf->pid     = (pid_t)(sc - procfs_sysctl_kernel);
+            pf->pid     = (pid_t)index;
             break;
         }
         default :
@@ -2302,7 +2376,7 @@ static int procfs_stat(void *file, vfs_node_t node)
 
             (void)procfs_ensure_child(node, "net", PROCFS_NET_DIR, 0, 0, file_dir);
             (void)procfs_ensure_child(node, "tty", PROCFS_TTY_DIR, 0, 0, file_dir);
-            (void)procfs_ensure_child(node, "sys", PROCFS_SYS_DIR, 0, 0, file_dir);
+            (void)procfs_ensure_child(node, "sys", PROCFS_SYS_DIR, 0, -1, file_dir);
             (void)procfs_ensure_child(node, "driver", PROCFS_DRIVER_DIR, 0, 0, file_dir);
             (void)procfs_ensure_child(node, "self", PROCFS_SELF_LINK, 0, 0, file_symlink);
             (void)procfs_ensure_child(node, "thread-self", PROCFS_SELF_LINK, 0, 1, file_symlink);
@@ -2435,10 +2509,11 @@ static int procfs_stat(void *file, vfs_node_t node)
         }
         case PROCFS_SYS_DIR : {
             node->type = file_dir;
-            if (pf->subtype < 0) {
-                (void)procfs_ensure_child(node, "kernel", PROCFS_SYS_DIR, 0, PROC_SYS_KERNEL, file_dir);
-            } else if (pf->subtype == PROC_SYS_KERNEL) {
-                for (size_t i = 0; i < PROCFS_SYSCTL_KERNEL_COUNT; i++) (void)procfs_ensure_child(node, procfs_sysctl_kernel[i].name, PROCFS_SYS_FILE, (pid_t)i, PROC_SYS_KERNEL, file_none);
+            for (size_t i = 0; i < PROCFS_SYSCTL_DIR_COUNT; i++)
+                if (procfs_sysctl_dirs[i].parent == pf->subtype) (void)procfs_ensure_child(node, procfs_sysctl_dirs[i].name, PROCFS_SYS_DIR, 0, (int)i, file_dir);
+            if (pf->subtype >= 0 && (size_t)pf->subtype < PROCFS_SYSCTL_DIR_COUNT) {
+                const procfs_sysctl_dir_t *dir = &procfs_sysctl_dirs[pf->subtype];
+                for (size_t i = 0; i < dir->count; i++) (void)procfs_ensure_child(node, dir->entries[i].name, PROCFS_SYS_FILE, (pid_t)i, pf->subtype, file_none);
             }
             break;
         }
@@ -2661,7 +2736,7 @@ void procfs_regist(void)
      * Linux exposes this filesystem to mount(2) as "proc".  User space
      * (BusyBox mount, OpenRC and /etc/fstab) consequently passes -t proc.
      */
-    procfs_id = vfs_regist_fs_flags("proc", &procfs_callbacks, VFS_FS_NODEV);
+    procfs_id = vfs_regist_fs_flags("proc", &procfs_callbacks, VFS_FS_NODEV | VFS_FS_DYNAMIC);
     if (procfs_id & ERRNO_MASK) plogk("procfs: Register error.\n");
     if (!(procfs_id & ERRNO_MASK)) plogk("procfs: Filesystem registered (fsid=%d)\n", procfs_id);
 }
@@ -95,6 +95,30 @@ static ssize_t removable_show(struct kobject *kobj, struct attribute *attr, char
     return (ssize_t)sysfs_emit(buf, "%d\n", to_bsd(kobj)->removable);
 }
 
+/* Show the completion polling mode (0 = interrupt-driven). */
+static ssize_t io_poll_show(struct kobject *kobj, struct attribute *attr, char *buf)
+{
+    block_sysfs_dev_t *bsd = to_bsd(kobj);
+    (void)attr;
+    if (!bsd->valid) return -EIO;
+    int mode = blockdev_get_poll(&bsd->bdev);
+    return (ssize_t)sysfs_emit(buf, "%d\n", mode < 0 ? 0 : mode);
+}
+
+/* Select the completion polling mode; only a single digit is accepted. */
+static ssize_t io_poll_store(struct kobject *kobj, const char *buf, size_t count)
+{
+    block_sysfs_dev_t *bsd = to_bsd(kobj);
+    size_t             len = count;
+
+    while (len && (buf[len - 1] == '\n' || buf[len - 1] == ' ')) len--;
+    if (len != 1 || buf[0] < '0' || buf[0] > '9') return -EINVAL;
+    if (!bsd->valid) return -EIO;
+
+    int ret = blockdev_set_poll(&bsd->bdev, buf[0] - '0');
+    return ret ? ret : (ssize_t)count;
+}
+
 /* Dispatch a show operation to the matching block attribute. */
 static ssize_t block_attr_show(struct kobject *kobj, struct attribute *attr, char *buf)
 {
@@ -104,6 +128,7 @@ static ssize_t block_attr_show(struct kobject *kobj, struct attribute *attr, cha
     if (streq(attr->name, "removable")) return removable_show(kobj, attr, buf);
     if (streq(attr->name, "partition")) return partition_show(kobj, attr, buf);
     if (streq(attr->name, "start")) return start_show(kobj, attr, buf);
+    if (streq(attr->name, "io_poll")) return io_poll_show(kobj, attr, buf);
     if (streq(attr->name, "uevent")) {
         struct kobj_uevent_env env = {0};
         block_sysfs_dev_t     *bsd = to_bsd(kobj);
@@ -117,12 +142,13 @@ static ssize_t block_attr_show(struct kobject *kobj, struct attribute *attr, cha
     return -EIO;
 }
 
-/* Handle the writable uevent attribute. */
+/* Handle the writable uevent and io_poll attributes. */
 static ssize_t block_attr_store(struct kobject *kobj, struct attribute *attr, const char *buf, size_t count)
 {
-    if (!streq(attr->name, "uevent")) return -EIO;
+    if (!streq(attr->name, "uevent") && !streq(attr->name, "io_poll")) return -EIO;
     process_t *process = process_current();
     if (!process || process->uid != 0) return -EPERM;
+    if (streq(attr->name, "io_poll")) return io_poll_store(kobj, buf, count);
     int ret = kobject_synth_uevent(kobj, buf, count);
     return ret ? ret : (ssize_t)count;
 }
@@ -141,9 +167,10 @@ static struct attribute removable_attr   = __ATTR_RO(removable);
 static struct attribute partition_attr   = __ATTR_RO(partition);
 static struct attribute start_attr       = __ATTR_RO(start);
 static struct attribute uevent_attr      = __ATTR(uevent, 0644);
+static struct attribute io_poll_attr     = __ATTR(io_poll, 0644);
 
 static struct attribute *block_attrs[] = {
-    &size_attr, &sector_size_attr, &ro_attr, &removable_attr, &uevent_attr, NULL,
+    &size_attr, &sector_size_attr, &ro_attr, &removable_attr, &io_poll_attr, &uevent_attr, NULL,
 };
 
 static struct attribute *partition_attrs[] = {
@@ -1425,6 +1425,7 @@ int sysfs_rename_dir(struct kobject *kobj, const char *new_name)
     free(kobj->sd->name);
     kobj->sd->name = replacement;
     if (kobj->sd->parent) kobj->sd->parent->visited = 0;
+    vfs_dcache_invalidate(kobj->sd->parent);
     return EOK;
 }
 
@@ -1458,6 +1459,7 @@ int sysfs_move_dir(struct kobject *kobj, struct kobject *new_parent)
     new_parent->sd->child = new_link;
     if (old_parent) old_parent->visited = 0;
     new_parent->sd->visited = 0;
+    vfs_dcache_invalidate(new_parent->sd);
     return EOK;
 }
 
@@ -1467,7 +1469,7 @@ int sysfs_move_dir(struct kobject *kobj, struct kobject *new_parent)
 void sysfs_regist(void)
 {
 #if CONFIG_SYSFS
-    sysfs_id = vfs_regist_fs_flags("sysfs", &sysfs_callbacks, VFS_FS_NODEV);
+    sysfs_id = vfs_regist_fs_flags("sysfs", &sysfs_callbacks, VFS_FS_NODEV | VFS_FS_DYNAMIC);
     if (!(sysfs_id & ERRNO_MASK)) plogk("sysfs: Filesystem registered (fsid=%d)\n", sysfs_id);
     if (sysfs_id & ERRNO_MASK) plogk("sysfs: Register error.\n");
 #endif
@@ -0,0 +1,203 @@
+/*
+ *
+ *      zram_sysfs.c
+ *      zram device sysfs integration (/sys/block/zramN)
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <fs/sysfs/sysfs.h>
+#include <fs/sysfs/zram_sysfs.h>
+#include <kernel/errno.h>
+#include <kernel/printk.h>
+#include <libs/kobject/kobject.h>
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+#include <libs/std/string.h>
+#include <mem/zram.h>
+#include <process/process.h>
+
+/* Per-device wrapper */
+
+typedef struct zram_sysfs_dev {
+        struct kobject kobj;
+        zram_device_t *zram;
+} zram_sysfs_dev_t;
+
+static zram_sysfs_dev_t zram_sysfs_devs[ZRAM_DEVICES];
+
+/* Return the zram device behind a kobject. */
+static zram_device_t *to_zram(struct kobject *kobj)
+{
+    return ((zram_sysfs_dev_t *)((char *)kobj - offsetof(zram_sysfs_dev_t, kobj)))->zram;
+}
+
+/* Show the device size in bytes. */
+static ssize_t disksize_show(struct kobject *kobj, char *buf)
+{
+    zram_stats_t stats;
+    zram_get_stats(to_zram(kobj), &stats);
+    return (ssize_t)sysfs_emit(buf, "%llu\n", (unsigned long long)stats.disksize);
+}
+
+/* Resize the device; accepts a byte count with an optional K, M or G suffix. */
+static ssize_t disksize_store(struct kobject *kobj, const char *buf, size_t count)
+{
+    uint64_t bytes = 0;
+    size_t   i     = 0;
+
+    for (; i < count && buf[i] >= '0' && buf[i] <= '9'; i++) {
+        if (bytes > (UINT64_MAX - 9) / 10) return -EINVAL;
+        bytes = bytes * 10 + (uint64_t)(buf[i] - '0');
+    }
+    if (!i) return -EINVAL;
+    unsigned shift = 0;
+    if (i < count && (buf[i] == 'K' || buf[i] == 'k')) shift = 10;
+    if (i < count && (buf[i] == 'M' || buf[i] == 'm')) shift = 20;
+    if (i < count && (buf[i] == 'G' || buf[i] == 'g')) shift = 30;
+    if (shift) {
+        if (bytes > UINT64_MAX >> shift) return -EINVAL;
+        bytes <<= shift;
+        i++;
+    }
+    while (i < count && (buf[i] == '\n' || buf[i] == ' ')) i++;
+    if (i != count) return -EINVAL;
+
+    int ret = zram_set_disksize(to_zram(kobj), bytes);
+    return ret ? ret : (ssize_t)count;
+}
+
+/* Show whether the device is in use as a swap area. */
+static ssize_t initstate_show(struct kobject *kobj, char *buf)
+{
+    zram_stats_t stats;
+    zram_get_stats(to_zram(kobj), &stats);
+    return (ssize_t)sysfs_emit(buf, "%d\n", stats.initstate ? 1 : 0);
+}
+
+/* Show the compression algorithm, selected one in brackets. */
+static ssize_t comp_algorithm_show(struct kobject *kobj, char *buf)
+{
+    (void)kobj;
+    return (ssize_t)sysfs_emit(buf, "[lz4]\n");
+}
+
+/*
+ * Linux mm_stat: orig_data_size compr_data_size mem_used_total mem_limit
+ * mem_used_max same_pages pages_compacted huge_pages huge_pages_since.
+ * There is no memory limit or compaction, so those fields read 0.
+ */
+static ssize_t mm_stat_show(struct kobject *kobj, char *buf)
+{
+    zram_stats_t stats;
+    zram_get_stats(to_zram(kobj), &stats);
+    return (ssize_t)sysfs_emit(buf, "%8llu %8llu %8llu %8llu %8llu %8llu %8llu %8llu %8llu\n", (unsigned long long)stats.orig_data_size, (unsigned long long)stats.compr_data_size,
+                               (unsigned long long)stats.mem_used_total, 0ULL, (unsigned long long)stats.mem_used_max, (unsigned long long)stats.same_pages, 0ULL,
+                               (unsigned long long)stats.huge_pages, (unsigned long long)stats.huge_pages);
+}
+
+/* Linux io_stat: failed_reads failed_writes invalid_io notify_free. */
+static ssize_t io_stat_show(struct kobject *kobj, char *buf)
+{
+    zram_stats_t stats;
+    zram_get_stats(to_zram(kobj), &stats);
+    return (ssize_t)sysfs_emit(buf, "%8llu %8llu %8llu %8llu\n", (unsigned long long)stats.failed_reads, (unsigned long long)stats.failed_writes, 0ULL, 0ULL);
+}
+
+/* Show stored bytes per byte of pool memory, i.e. the effective overcommit factor. */
+static ssize_t compr_ratio_show(struct kobject *kobj, char *buf)
+{
+    zram_stats_t stats;
+    zram_get_stats(to_zram(kobj), &stats);
+    if (!stats.mem_used_total) return (ssize_t)sysfs_emit(buf, "%s\n", stats.orig_data_size ? "inf" : "0.00");
+    uint64_t ratio = stats.orig_data_size * 100 / stats.mem_used_total;
+    return (ssize_t)sysfs_emit(buf, "%llu.%02llu\n", (unsigned long long)(ratio / 100), (unsigned long long)(ratio % 100));
+}
+
+/* Attributes and kobj_type */
+
+static struct attribute disksize_attr       = __ATTR(disksize, 0644);
+static struct attribute initstate_attr      = __ATTR_RO(initstate);
+static struct attribute comp_algorithm_attr = __ATTR_RO(comp_algorithm);
+static struct attribute mm_stat_attr        = __ATTR_RO(mm_stat);
+static struct attribute io_stat_attr        = __ATTR_RO(io_stat);
+static struct attribute compr_ratio_attr    = __ATTR_RO(compr_ratio);
+
+static struct attribute *zram_attrs[] = {
+    &disksize_attr, &initstate_attr, &comp_algorithm_attr, &mm_stat_attr, &io_stat_attr, &compr_ratio_attr, NULL,
+};
+
+/* Dispatch a show operation to the matching zram attribute. */
+static ssize_t zram_attr_show(struct kobject *kobj, struct attribute *attr, char *buf)
+{
+    if (attr == &disksize_attr) return disksize_show(kobj, buf);
+    if (attr == &initstate_attr) return initstate_show(kobj, buf);
+    if (attr == &comp_algorithm_attr) return comp_algorithm_show(kobj, buf);
+    if (attr == &mm_stat_attr) return mm_stat_show(kobj, buf);
+    if (attr == &io_stat_attr) return io_stat_show(kobj, buf);
+    if (attr == &compr_ratio_attr) return compr_ratio_show(kobj, buf);
+    return -EIO;
+}
+
+/* Handle the writable disksize attribute. */
+static ssize_t zram_attr_store(struct kobject *kobj, struct attribute *attr, const char *buf, size_t count)
+{
+    if (attr != &disksize_attr) return -EIO;
+    process_t *process = process_current();
+    if (!process || process->uid != 0) return -EPERM;
+    return disksize_store(kobj, buf, count);
+}
+
+static const struct sysfs_ops zram_sysfs_ops = {
+    .show  = zram_attr_show,
+    .store = zram_attr_store,
+};
+
+/* Release a static zram kobject. */
+static void zram_kobj_release(struct kobject *kobj)
+{
+    (void)kobj;
+    /* Static, nothing to free */
+}
+
+static struct kobj_type zram_ktype = {
+    .release       = zram_kobj_release,
+    .sysfs_ops     = &zram_sysfs_ops,
+    .default_attrs = zram_attrs,
+};
+
+/* Register /sys/block/zramN with its size and compression statistics. */
+void zram_sysfs_init(void)
+{
+#if CONFIG_SYSFS && CONFIG_ZRAM
+    struct kobject *block_kobj = NULL;
+    clist_t         node;
+    int             count = 0;
+
+    if (!sysfs_root_kobj) return;
+
+    for (node = sysfs_root_kobj->children; node; node = node->next) {
+        struct kobject *child = node->data;
+        if (child && child->name && streq(child->name, "block")) {
+            block_kobj = child;
+            break;
+        }
+    }
+
+    if (!block_kobj) {
+        plogk("zram_sysfs: /sys/block/ kobject not found.\n");
+        return;
+    }
+    for (uint32_t i = 0; i < ZRAM_DEVICES; i++) {
+        zram_sysfs_dev_t *dev = &zram_sysfs_devs[i];
+        dev->zram             = zram_get_device(i);
+        if (!dev->zram) continue;
+        kobject_init(&dev->kobj, &zram_ktype);
+        if (kobject_add(&dev->kobj, block_kobj, "%s", zram_device_name(dev->zram)) == EOK) count++;
+    }
+
+    plogk("zram_sysfs: exported %d zram device(s) to /sys/block\n", count);
+#endif
+}
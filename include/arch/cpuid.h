@@ -104,4 +104,10 @@ int cpu_support_avx2(void);
 /* Check CPU supports AVX-512F (base AVX-512) */
 int cpu_support_avx512f(void);
 
+/* Check CPU supports process-context identifiers */
+int cpu_support_pcid(void);
+
+/* Check CPU supports the INVPCID instruction */
+int cpu_support_invpcid(void);
+
 #endif // INCLUDE_CPUID_H_
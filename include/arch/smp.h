@@ -27,6 +27,7 @@
 typedef uint8_t kernel_stack_t[KERNEL_STACK_SIZE];
 
 struct task;
+struct page_directory;
 
 #define SYSCALL_CPU_USER_RSP_OFFSET   0
 #define SYSCALL_CPU_KERNEL_RSP_OFFSET 8
@@ -117,9 +118,12 @@ void send_ipi_self(uint8_t vector);
 /* Flush TLBs of all CPUs */
 void flush_tlb_all(void);
 
-/* Flushing TLB by address range */
+/* Flushing TLB by address range on this CPU only */
 void flush_tlb_range(uint64_t start, uint64_t end);
 
+/* Shoot down a user range on every CPU that may cache the address space */
+void flush_tlb_mm_range(struct page_directory *directory, uint64_t start, uint64_t end);
+
 /* Handle an NMI used for a pending TLB shootdown. */
 int smp_handle_nmi(void);
 
@@ -0,0 +1,99 @@
+/*
+ *
+ *      bio.h
+ *      Asynchronous block request layer (bio, request queues, plugging)
+ *
+ *      2026/10/17 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_BIO_H_
+#define INCLUDE_BIO_H_
+
+#include <drivers/block/core/blockdev.h>
+#include <libs/std/stdbool.h>
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+
+#define BIO_INLINE_VECS      8      // segments stored inside the bio itself
+#define BLK_MAX_QUEUES       32     // distinct backing disks with a request queue
+#define BLK_MAX_WORKERS      4      // kblockd dispatch threads
+#define BLK_MAX_REQUEST_SIZE 131072 // merge limit for one dispatched request (bytes)
+#define BLK_PLUG_MAX         32     // plugged requests before an implicit flush
+#define BLK_WAIT_HASH        64     // hashed completion wait queues
+
+typedef enum {
+    BIO_READ = 0,
+    BIO_WRITE,
+} bio_op_t;
+
+/* One scatter-gather segment: kernel-virtual memory, a whole number of sectors. */
+typedef struct bio_vec {
+        void    *base;
+        uint32_t len;
+} bio_vec_t;
+
+typedef struct bio bio_t;
+
+/*
+ * Completion callback.  It runs in the dispatching context (a kblockd worker,
+ * or the submitter during early boot) and owns the bio afterwards; bios with
+ * a callback are never touched by the block layer once it returns.
+ */
+typedef void (*bio_end_io_t)(bio_t *bio);
+
+struct bio {
+        blockdev_device_t device; // target view (whole disk or partition)
+        uint8_t           op;     // bio_op_t
+        uint64_t          lba;    // first sector, relative to device
+        uint32_t          sectors;
+        bio_vec_t        *vecs;
+        uint32_t          nvec;
+        uint32_t          max_vecs;
+        bio_vec_t         inline_vecs[BIO_INLINE_VECS];
+        int               status;
+        volatile uint8_t  done;
+        bio_end_io_t      end_io;
+        void             *private_data;
+
+        /* Request bookkeeping, owned by the block layer while in flight */
+        bio_t   *bi_next;    // next bio merged into the same request
+        bio_t   *rq_tail;    // request head only: last merged bio
+        bio_t   *rq_next;    // request head only: next request on a queue or plug
+        uint32_t rq_sectors; // request head only: sectors covered by the chain
+};
+
+/* Per-task plug: requests collect (and merge) here until blk_finish_plug(). */
+typedef struct blk_plug {
+        bio_t   *head;
+        bio_t   *tail;
+        uint32_t count;
+} blk_plug_t;
+
+/* Initialise a bio for op at lba; vecs are appended with bio_add_vec(). */
+void bio_init(bio_t *bio, const blockdev_device_t *device, bio_op_t op, uint64_t lba);
+
+/* Append a segment; len must be a multiple of the sector size. Returns 0 or -errno. */
+int bio_add_vec(bio_t *bio, void *base, uint32_t len);
+
+/* Free a heap-grown vector table (bios with <= BIO_INLINE_VECS segments own none). */
+void bio_release_vecs(bio_t *bio);
+
+/* Queue a bio. It completes asynchronously through end_io or bio_wait(). */
+void bio_submit(bio_t *bio);
+
+/* Wait for a bio without an end_io callback, returning its status. */
+int bio_wait(bio_t *bio);
+
+/* Submit a bio and wait for it. */
+int bio_submit_wait(bio_t *bio);
+
+/* Start/finish plugging on the current task; nested plugs fold into the outermost one. */
+void blk_start_plug(blk_plug_t *plug);
+void blk_finish_plug(blk_plug_t *plug);
+
+/* Register the kblockd dispatch workers; called once during boot. */
+void blk_queue_init(void);
+
+#endif // INCLUDE_BIO_H_
@@ -38,6 +38,8 @@ typedef struct blockdev_ops {
         int (*flush)(const struct blockdev_device *dev);
         void (*retain)(const struct blockdev_device *dev);
         void (*release)(const struct blockdev_device *dev);
+        int (*get_poll)(const struct blockdev_device *dev);
+        int (*set_poll)(const struct blockdev_device *dev, int mode);
 } *blockdev_ops_t;
 
 /* Drive encoding for blockdev_open_drive / blockdev_parse_drive */
@@ -113,6 +115,10 @@ int blockdev_flush(const blockdev_device_t *device);
 void blockdev_retain(const blockdev_device_t *device);
 void blockdev_release(const blockdev_device_t *device);
 
+/* Query/select the backend's completion polling mode (0 = interrupt-driven). */
+int blockdev_get_poll(const blockdev_device_t *device);
+int blockdev_set_poll(const blockdev_device_t *device, int mode);
+
 /* Byte-granularity read (handles partial sectors internally) */
 int blockdev_read_bytes(const blockdev_device_t *device, uint64_t offset, void *buffer, size_t size);
 
@@ -14,6 +14,7 @@
 #include <drivers/bus/pci.h>
 #include <libs/std/stddef.h>
 #include <libs/std/stdint.h>
+#include <process/task.h>
 #include <sync/spin_lock.h>
 
 struct blockdev_device;
@@ -33,9 +34,10 @@ struct blockdev_device;
 #define NVME_REG_DBS   0x1000 // Doorbell Stride start
 
 /* CAP bits */
-#define NVME_CAP_MQES(cap)  ((uint32_t)((cap) & 0xFFFF))
-#define NVME_CAP_DSTRD(cap) (((cap) >> 32) & 0xF)
-#define NVME_CAP_TO(cap)    (((cap) >> 24) & 0xFF)
+#define NVME_CAP_MQES(cap)   ((uint32_t)((cap) & 0xFFFF))
+#define NVME_CAP_DSTRD(cap)  (((cap) >> 32) & 0xF)
+#define NVME_CAP_TO(cap)     (((cap) >> 24) & 0xFF)
+#define NVME_CAP_MPSMIN(cap) ((uint32_t)(((cap) >> 48) & 0xF))
 
 /* CC bits */
 #define NVME_CC_EN           (1ULL << 0)
@@ -60,6 +62,8 @@ struct blockdev_device;
 #define NVME_MAX_CONTROLLERS 8
 #define NVME_MAX_NAMESPACES  16
 #define NVME_SECTOR_SIZE     512
+#define NVME_MAX_IO_QUEUES   (PCI_MAX_MSI_VECTORS - 1) // MSI-X entry 0 stays with the admin queue
+#define NVME_MAX_XFER_PAGES  32                        // bounce-buffer pages per command, before MDTS
 
 /* Admin commands */
 #define NVME_ADMIN_DELETE_IO_SQ 0x00
@@ -117,8 +121,22 @@ struct blockdev_device;
 #define NVME_PRP_ENTRIES_PER_PAGE (PAGE_4K_SIZE / 8)
 
 /* Timeouts */
-#define NVME_TIMEOUT_MS    5000 // controller enable timeout (ms)
-#define NVME_TIMEOUT_LOOPS 0x400000
+#define NVME_TIMEOUT_MS     5000 // controller enable timeout (ms)
+#define NVME_TIMEOUT_LOOPS  0x400000
+#define NVME_IO_TIMEOUT_MS  30000 // interrupt-driven command timeout (ms)
+#define NVME_IRQ_RECHECK_MS 10    // sleeping waiters re-reap the CQ this often
+
+/* Completion modes, selectable at runtime through /sys/block/<disk>/io_poll */
+#define NVME_POLL_OFF    0 // sleep until the completion interrupt
+#define NVME_POLL_HYBRID 1 // spin for about the mean latency, then sleep
+
+/* Upper bound for the hybrid spin window (ns) */
+#define NVME_HYBRID_POLL_MAX_NS 200000
+
+/* Interrupt delivery for I/O completion queues */
+#define NVME_IRQ_NONE 0 // polled only
+#define NVME_IRQ_MSI  1 // single MSI vector shared by every queue
+#define NVME_IRQ_MSIX 2 // one MSI-X entry per queue
 
 /* 64-byte Submission Queue Entry */
 typedef struct {
@@ -261,6 +279,20 @@ typedef struct nvme_namespace {
         uint8_t  ready;
 } nvme_namespace_t;
 
+/* Per-CID command slot of an I/O queue */
+typedef struct nvme_cmd_slot {
+        volatile uint8_t done;      // completion has been posted
+        uint8_t          inuse;     // CID is owned by a submitter
+        uint8_t          abandoned; // submitter timed out; reaper frees the CID
+        uint16_t         status;    // CQE status field without the phase bit
+        uint32_t         result;    // CQE dword 0
+        wait_queue_t     wait;      // submitter sleeps here
+
+        /* PRP list page, allocated the first time this CID needs one */
+        void    *prp_list_virt;
+        uint64_t prp_list_phys;
+} nvme_cmd_slot_t;
+
 /* Queue Pair descriptor */
 typedef struct nvme_queue {
         uint32_t qid;
@@ -281,13 +313,19 @@ typedef struct nvme_queue {
         volatile uint32_t *sq_doorbell; // SQyTDBL MMIO pointer
         volatile uint32_t *cq_doorbell; // CQyHDBL MMIO pointer
 
-        spinlock_t lock;   // per-queue lock
-        uint32_t   sq_cid; // monotonically incrementing CID
+        spinlock_t lock;   // per-queue lock (also taken from the IRQ handler)
+        uint32_t   sq_cid; // monotonically incrementing CID (admin queue)
 
-        /* Pre-allocated PRP list page (one per queue pair) */
-        void    *prp_list_virt;
-        uint64_t prp_list_phys;
-        uint8_t  prp_list_inuse;
+        /* I/O queues only: outstanding commands are tracked by CID */
+        nvme_cmd_slot_t *slots;     // depth entries, indexed by CID
+        uint32_t         depth;     // num_entries - 1, so the SQ never overflows
+        uint32_t         slot_hint; // next CID to try
+        uint32_t         inflight;  // CIDs currently owned
+        wait_queue_t     slot_wait; // submitters waiting for a free CID
+
+        uint16_t irq_entry;   // MSI-X table entry (CQ interrupt vector)
+        uint8_t  irq_enabled; // completions raise an interrupt
+        uint64_t mean_ns;     // running mean completion latency (hybrid poll)
 } nvme_queue_t;
 
 /* Controller descriptor */
@@ -300,13 +338,17 @@ typedef struct nvme_controller {
         uint32_t       stride;    // doorbell stride in bytes (4 << DSTRD)
         uint32_t       max_qsize; // MQES + 1, capped
 
-        nvme_queue_t admin_q; // queue pair 0
-        nvme_queue_t io_q;    // queue pair 1
+        nvme_queue_t admin_q;                      // queue pair 0
+        nvme_queue_t io_queues[NVME_MAX_IO_QUEUES]; // queue pairs 1..io_queue_count
+        uint32_t     io_queue_count;
 
         nvme_namespace_t namespaces[NVME_MAX_NAMESPACES];
         uint32_t         num_namespaces;
 
-        uint32_t irq_vector;
+        uint32_t irq_vector;     // first completion vector
+        uint8_t  irq_mode;       // NVME_IRQ_*
+        uint8_t  poll_mode;      // NVME_POLL_*
+        uint32_t max_xfer_pages; // per-command transfer limit
 
         uint8_t    initialised;
         spinlock_t lock; // global controller lock
@@ -326,4 +368,8 @@ int nvme_read_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t
 int nvme_write_sectors(const struct blockdev_device *dev, uint64_t lba, uint32_t count, const void *buffer);
 int nvme_flush(const struct blockdev_device *dev);
 
+/* Query/select the completion mode of the namespace's controller (NVME_POLL_*) */
+int nvme_get_poll(const struct blockdev_device *dev);
+int nvme_set_poll(const struct blockdev_device *dev, int mode);
+
 #endif // INCLUDE_NVME_H_
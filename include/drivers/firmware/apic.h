@@ -145,6 +145,12 @@ void send_eoi(void);
 /* Stop the local APIC timer */
 void lapic_timer_stop(void);
 
+/* Return the local APIC timer to its periodic tick */
+void lapic_timer_periodic(void);
+
+/* Program a single timer interrupt delta_ns from now (TSC-deadline mode when available) */
+void lapic_timer_oneshot(uint64_t delta_ns);
+
 /* Send interrupt handling instruction */
 void send_ipi(uint32_t apic_id, uint32_t command);
 
@@ -32,6 +32,9 @@ uint64_t tsc_resolution_ns(void);
 /* Returns TSC time aligned to the boot-relative monotonic epoch */
 uint64_t tsc_nano_time(void);
 
+/* Convert a nanosecond interval to TSC cycles */
+uint64_t tsc_ns_to_cycles(uint64_t ns);
+
 /* Initialize TSC */
 void tsc_init(void);
 
@@ -42,6 +42,7 @@
 
 typedef struct vfs_node             *vfs_node_t;
 typedef struct pagecache_mapping     pagecache_mapping_t;
+typedef struct pagecache_page        pagecache_page_t;
 typedef struct vfs_poll_subscription vfs_poll_subscription_t;
 struct process;
 
@@ -146,7 +147,8 @@ enum {
 };
 
 enum {
-    VFS_FS_NODEV = 1U << 0, // filesystem has no block-device backing
+    VFS_FS_NODEV   = 1U << 0, // filesystem has no block-device backing
+    VFS_FS_DYNAMIC = 1U << 1, // stat regenerates children; lookups always take the locked walk
 };
 
 typedef struct vfs_callback {
@@ -220,6 +222,10 @@ typedef struct vfs_node {
         vfs_poll_source_t    poll_source;
         uint32_t             inotify_watch_count; // Direct inotify watches; avoids global scans for ordinary I/O
         pagecache_mapping_t *mapping;             // Unified cache for regular-file contents
+        uint64_t             dcache_gen;          // Changes whenever a child name may appear; validates cached misses
+        struct vfs_dentry   *dentry;              // Name-cache entry resolving to this node
+        struct vfs_node     *retired_next;        // Freed node awaiting the end of lock-free walks
+        uint64_t             retired_epoch;       // Walk epoch the node was retired at
 } *vfs_node_t;
 
 extern struct vfs_callback vfs_empty_callback;
@@ -239,6 +245,9 @@ void set_rootdir(vfs_node_t node);
 /* Search for a file or directory by name in the specified directory */
 vfs_node_t vfs_do_search(vfs_node_t dir, const char *name);
 
+/* Drop cached lookup misses in a directory after a child name may have appeared */
+void vfs_dcache_invalidate(vfs_node_t dir);
+
 /* Update a file or directory, ensuring it is open and ready */
 void vfs_update(vfs_node_t node);
 
@@ -357,6 +366,7 @@ int64_t            vfs_file_read(vfs_node_t file, void *private_data, uint64_t f
 int64_t            vfs_file_write(vfs_node_t file, void *private_data, uint64_t flags, const void *addr, size_t offset, size_t size);
 int64_t            vfs_file_read_process(vfs_node_t file, void *private_data, uint64_t flags, void *addr, size_t offset, size_t size, struct process *proc);
 int64_t            vfs_file_write_process(vfs_node_t file, void *private_data, uint64_t flags, const void *addr, size_t offset, size_t size, struct process *proc);
+int64_t            vfs_file_read_pages(vfs_node_t file, uint64_t offset, size_t size, int (*actor)(void *context, pagecache_page_t *page, void *data, size_t count), void *context, struct process *proc);
 int64_t            vfs_file_read_user_process(vfs_node_t file, void *private_data, uint64_t flags, void *addr, size_t offset, size_t size, struct process *proc);
 int64_t            vfs_file_write_user_process(vfs_node_t file, void *private_data, uint64_t flags, const void *addr, size_t offset, size_t size, struct process *proc);
 int                vfs_file_ioctl(vfs_node_t file, void *private_data, uint64_t flags, size_t req, void *arg);
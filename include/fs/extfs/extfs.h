@@ -17,7 +17,8 @@
 #include <libs/std/stdint.h>
 #include <sync/spin_lock.h>
 
-typedef struct extfs_journal extfs_journal_t;
+typedef struct extfs_journal      extfs_journal_t;
+typedef struct extfs_extent_cache extfs_extent_cache_t;
 
 /* Special inode numbers */
 #define EXT2_BAD_INO            1
@@ -32,6 +33,16 @@ typedef struct extfs_journal extfs_journal_t;
 #define EXT2_MIN_BLOCK_LOG_SIZE 10
 #define EXT2_MAX_BLOCK_LOG_SIZE 16
 
+/* Inode and extent-tree generation buckets, indexed by inode number */
+#define EXTFS_GEN_HASH 64
+
+/* Largest contiguous run issued as one device request by the data path */
+#define EXTFS_IO_RUN_MAX (1024 * 1024)
+
+/* create modes of extfs_map_block() and extfs_map_range() */
+#define EXTFS_MAP_CREATE    1 // fill holes with zeroed blocks
+#define EXTFS_MAP_OVERWRITE 2 // fill holes the caller writes in full right away, skipping the zeroing
+
 /* Constants relative to data blocks */
 #define EXT2_NDIR_BLOCKS 12
 #define EXT2_IND_BLOCK   EXT2_NDIR_BLOCKS
@@ -251,31 +262,46 @@ typedef struct ext2_dir_entry {
         char     name[EXT2_NAME_LEN];
 } __attribute__((packed)) ext2_dir_entry_t;
 
+/* In-memory allocator state of one block group (alloc.c) */
+typedef struct extfs_group_state {
+        uint8_t *block_bitmap; // Cached block bitmap, or NULL until first use
+        uint8_t *inode_bitmap; // Cached inode bitmap, or NULL until first use
+        uint8_t  block_dirty;  // Bitmap changed since the last flush
+        uint8_t  inode_dirty;  // Bitmap changed since the last flush
+        uint8_t  desc_dirty;   // Descriptor changed since the last flush
+} extfs_group_state_t;
+
 /* Per-filesystem superblock info */
 typedef struct extfs_sb_info {
-        blockdev_device_t   device;
-        ext2_super_block_t *es;         // Pointer to on-disk superblock
-        ext2_group_desc_t  *group_desc; // Array of group descriptors
-        uint32_t            block_size;
-        uint32_t            blocks_per_group;
-        uint32_t            inodes_per_group;
-        uint32_t            groups_count;
-        uint32_t            desc_per_block;
-        uint32_t            desc_size;
-        uint64_t            blocks_count;
-        uint32_t            checksum_seed;
-        uint32_t            s_first_data_block;
-        uint32_t            inode_size;
-        uint32_t            s_first_ino;
-        uint32_t            gdb_count; // Group descriptor blocks count
-        uint32_t            sb_block;  // Superblock block number
-        uint8_t             log_block_size;
-        spinlock_t          lock;
-        int                 read_only;
-        fs_txn_log_t        transaction_log;
-        fs_txn_t           *active_transaction;
-        int                 transaction_log_initialized;
-        extfs_journal_t    *journal;
+        blockdev_device_t    device;
+        ext2_super_block_t  *es;         // Pointer to on-disk superblock
+        ext2_group_desc_t   *group_desc; // Array of group descriptors
+        uint32_t             block_size;
+        uint32_t             blocks_per_group;
+        uint32_t             inodes_per_group;
+        uint32_t             groups_count;
+        uint32_t             desc_per_block;
+        uint32_t             desc_size;
+        uint64_t             blocks_count;
+        uint32_t             checksum_seed;
+        uint32_t             s_first_data_block;
+        uint32_t             inode_size;
+        uint32_t             s_first_ino;
+        uint32_t             gdb_count; // Group descriptor blocks count
+        uint32_t             sb_block;  // Superblock block number
+        uint8_t              log_block_size;
+        spinlock_t           lock;
+        int                  read_only;
+        fs_txn_log_t         transaction_log;
+        fs_txn_t            *active_transaction;
+        int                  transaction_log_initialized;
+        extfs_journal_t     *journal;
+        uint32_t             extent_generation[EXTFS_GEN_HASH]; // Bumped whenever an extent tree changes
+        uint32_t             inode_generation[EXTFS_GEN_HASH];  // Bumped whenever an on-disk inode is written
+        extfs_group_state_t *groups;                            // Allocator cache, written back by extfs_alloc_flush
+        uint32_t             cached_bitmaps;                    // Bitmaps currently held in groups
+        uint32_t             alloc_next_group;                  // Next-fit cursor for allocations without a goal
+        int                  super_dirty;                       // Free counters changed since the last flush
 } extfs_sb_info_t;
 
 /* Per-inode info */
@@ -290,10 +316,14 @@ typedef struct extfs_inode_info {
 
 /* VFS handle stored in node->handle */
 typedef struct extfs_handle {
-        extfs_sb_info_t   *sb;       // Pointer to superblock info
-        extfs_inode_info_t ei;       // In-core inode info
-        uint32_t           inode_no; // On-disk inode number
-        int                owns_sb;  // Whether this handle owns the sb_info
+        extfs_sb_info_t      *sb;           // Pointer to superblock info
+        extfs_inode_info_t    ei;           // In-core inode info
+        uint32_t              inode_no;     // On-disk inode number
+        int                   owns_sb;      // Whether this handle owns the sb_info
+        extfs_extent_cache_t *extent_cache; // Sorted extent status cache, or NULL
+        ext2_inode_t          raw;          // Cached on-disk inode (extfs_get_inode)
+        uint32_t              raw_generation;
+        int                   raw_valid;
 } extfs_handle_t;
 
 /* super.c */
@@ -308,6 +338,8 @@ int  extfs_write_group_desc(extfs_sb_info_t *sb, uint32_t group, const ext2_grou
 int  extfs_read_block(extfs_sb_info_t *sb, uint32_t phys_block, void *buf);
 int  extfs_write_block(extfs_sb_info_t *sb, uint32_t phys_block, const void *buf);
 int  extfs_write_data_block(extfs_sb_info_t *sb, uint32_t phys_block, const void *buf);
+int  extfs_read_blocks(extfs_sb_info_t *sb, uint32_t phys_block, uint32_t count, void *buf);
+int  extfs_write_data_blocks(extfs_sb_info_t *sb, uint32_t phys_block, uint32_t count, const void *buf);
 int  extfs_update_bitmap_checksum(extfs_sb_info_t *sb, uint32_t group, int inode_bitmap, const void *bitmap);
 int  extfs_transaction_begin(extfs_sb_info_t *sb, fs_txn_t *transaction, uint32_t credits);
 int  extfs_transaction_commit(extfs_sb_info_t *sb, fs_txn_t *transaction);
@@ -315,18 +347,24 @@ void extfs_transaction_abort(extfs_sb_info_t *sb, fs_txn_t *transaction, int err
 
 /* alloc.c */
 int      extfs_alloc_block(extfs_sb_info_t *sb, uint32_t goal, uint32_t *out);
+int      extfs_alloc_blocks(extfs_sb_info_t *sb, uint32_t goal, uint32_t count, uint32_t *out, uint32_t *allocated);
 void     extfs_free_block(extfs_sb_info_t *sb, uint32_t block);
 int      extfs_alloc_inode(extfs_sb_info_t *sb, uint32_t *out);
 void     extfs_free_inode(extfs_sb_info_t *sb, uint32_t ino);
 int      extfs_adjust_used_dirs(extfs_sb_info_t *sb, uint32_t ino, int delta);
 uint32_t extfs_count_free_blocks(extfs_sb_info_t *sb);
 uint32_t extfs_count_free_inodes(extfs_sb_info_t *sb);
+int      extfs_alloc_flush(extfs_sb_info_t *sb);
+void     extfs_alloc_discard(extfs_sb_info_t *sb);
 
 /* inode.c */
 extfs_handle_t *extfs_alloc_handle(extfs_sb_info_t *sb, uint32_t ino);
+void            extfs_free_handle(extfs_handle_t *h);
 int             extfs_load_inode(extfs_handle_t *h);
+int             extfs_get_inode(extfs_handle_t *h, ext2_inode_t *raw);
 int             extfs_flush_inode(extfs_handle_t *h);
 uint32_t        extfs_map_block(extfs_handle_t *h, uint32_t logical, int create);
+uint32_t        extfs_map_range(extfs_handle_t *h, uint32_t logical, uint32_t max_blocks, int create, uint32_t *count);
 int             extfs_read_data(extfs_handle_t *h, void *buf, uint64_t offset, size_t size);
 int             extfs_write_data(extfs_handle_t *h, const void *buf, uint64_t offset, size_t size);
 int             extfs_truncate(extfs_handle_t *h, uint64_t size);
@@ -335,6 +373,8 @@ int             extfs_release_xattr_block(extfs_handle_t *h);
 
 /* extents.c */
 uint32_t extfs_extent_map_block(extfs_handle_t *h, uint32_t logical, int create);
+uint32_t extfs_extent_map_range(extfs_handle_t *h, uint32_t logical, uint32_t max_blocks, int create, uint32_t *count);
+void     extfs_extent_cache_drop(extfs_handle_t *h);
 int      extfs_extent_remove_space(extfs_handle_t *h, uint32_t first, uint32_t last);
 int      extfs_extent_free_all(extfs_handle_t *h);
 int      extfs_extent_count_blocks(extfs_handle_t *h, uint64_t *blocks);
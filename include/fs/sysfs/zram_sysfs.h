@@ -0,0 +1,17 @@
+/*
+ *
+ *      zram_sysfs.h
+ *      zram device sysfs integration header
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_ZRAM_SYSFS_H_
+#define INCLUDE_ZRAM_SYSFS_H_
+
+/* Register /sys/block/zramN with its size and compression statistics. */
+void zram_sysfs_init(void);
+
+#endif // INCLUDE_ZRAM_SYSFS_H_
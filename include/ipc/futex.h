@@ -69,12 +69,9 @@ int64_t sys_futex_wait(uint64_t uaddr, uint64_t val, uint64_t mask, uint64_t fla
 int64_t sys_futex_requeue(uint64_t waiters, uint64_t flags, uint64_t nr_wake, uint64_t nr_requeue, uint64_t a4, uint64_t a5);
 
 /* Kernel-side wake operation, including clear_child_tid users. */
-int futex_wake(uint32_t *uaddr, int nr_wake, uint64_t bitset);
+int futex_wake(uint32_t *uaddr, int nr_wake, uint64_t bitset, int flags);
 
 /* Initialize the futex subsystem. */
 void futex_init(void);
 
-/* Weak default realtime-clock hook (overridable by the syscall clock layer). */
-uint64_t futex_realtime_ticks(void);
-
 #endif // INCLUDE_FUTEX_H_
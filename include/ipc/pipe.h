@@ -11,8 +11,21 @@
 #ifndef INCLUDE_PIPE_H_
 #define INCLUDE_PIPE_H_
 
+#include <fs/core/vfs.h>
+#include <libs/std/stdbool.h>
+#include <libs/std/stddef.h>
 #include <libs/std/stdint.h>
 
+/* A span of pinned page-cache data queued on a pipe (see pagecache_buffer_get()). */
+typedef struct pipe_buffer {
+        pagecache_page_t *page;
+        uint32_t          offset;
+        uint32_t          len;
+} pipe_buffer_t;
+
+/* Sink for pipe_splice_out(): returns the bytes taken from data, or -errno. */
+typedef int64_t (*pipe_actor_t)(void *context, const void *data, size_t count);
+
 /* Initialize the pipe subsystem. */
 void pipe_init(void);
 
@@ -25,4 +38,16 @@ int64_t sys_pipe2(int pipefd[2], int flags);
 /* Create a FIFO (named pipe) node at the given resolved path. */
 int pipe_mknod(char *path, uint16_t mode, uint64_t dev);
 
+/* Whether node is a pipe or FIFO. */
+bool pipe_node_is_pipe(vfs_node_t node);
+
+/* Queue pinned page spans on a pipe; the pins of queued buffers pass to the pipe. */
+int64_t pipe_splice_in(vfs_node_t node, void *private_data, uint64_t flags, const pipe_buffer_t *bufs, size_t count);
+
+/* Drain up to size bytes from a pipe through actor without a staging copy. */
+int64_t pipe_splice_out(vfs_node_t node, void *private_data, uint64_t flags, size_t size, pipe_actor_t actor, void *context);
+
+/* Move (consume) or duplicate (tee) up to size bytes between two pipes. */
+int64_t pipe_transfer(vfs_node_t in_node, void *in_private, vfs_node_t out_node, void *out_private, uint64_t flags, size_t size, bool consume);
+
 #endif // INCLUDE_PIPE_H_
@@ -150,6 +150,10 @@
 #    define CONFIG_SWAP 1
 #endif
 
+#ifndef CONFIG_ZRAM
+#    define CONFIG_ZRAM 1
+#endif
+
 #ifndef CONFIG_SYSFS
 #    define CONFIG_SYSFS 1
 #endif
@@ -250,8 +254,8 @@
 #    define CPU_MAX_COUNT 0
 #endif
 
-#ifndef EPOLL_MAX_FDS
-#    define EPOLL_MAX_FDS 1024
+#ifndef EPOLL_MAX_WATCHES
+#    define EPOLL_MAX_WATCHES 65536
 #endif
 
 #ifndef FUTEX_HASH_BITS
@@ -0,0 +1,70 @@
+/*
+ *
+ *      hrtimer.h
+ *      High-resolution timer header file
+ *
+ *      2026/10/17 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_HRTIMER_H_
+#define INCLUDE_HRTIMER_H_
+
+#include <libs/std/stdbool.h>
+#include <libs/std/stdint.h>
+#include <libs/util/rbtree.h>
+#include <sync/spin_lock.h>
+
+typedef struct hrtimer      hrtimer_t;
+typedef struct hrtimer_base hrtimer_base_t;
+
+/* Expiry callback.  It runs from the timer interrupt with interrupts disabled. */
+typedef void (*hrtimer_fn_t)(hrtimer_t *timer);
+
+struct hrtimer {
+        rb_node_t       node;     // linkage in the owning CPU's queue
+        uint64_t        expires;  // CLOCK_MONOTONIC deadline in nanoseconds
+        hrtimer_fn_t    function; // expiry callback
+        void           *data;     // caller-owned context
+        hrtimer_base_t *base;     // queue holding the timer, or NULL when inactive
+};
+
+/* Per-CPU queue of pending timers, ordered by expiry. */
+struct hrtimer_base {
+        spinlock_t lock;
+        rb_root_t  root;    // pending timers, leftmost expires first
+        hrtimer_t *running; // callback currently executing, if any
+        uint64_t   expired; // statistics: callbacks run on this CPU
+};
+
+/* Prepare a timer; it stays inactive until hrtimer_start(). */
+void hrtimer_init(hrtimer_t *timer, hrtimer_fn_t function, void *data);
+
+/*
+ * (Re)arm a timer on the current CPU for an absolute CLOCK_MONOTONIC deadline.
+ * Starting and cancelling one timer must be serialized by its owner.  Returns
+ * -ENODEV, leaving the timer inactive, if the CPU has no timer queue; the
+ * callback never runs from here, so the caller may hold locks it takes.
+ */
+int hrtimer_start(hrtimer_t *timer, uint64_t expires_ns);
+
+/*
+ * Disarm a timer, waiting for its callback to finish if it is running on
+ * another CPU.  Returns true if the timer was still pending.
+ */
+bool hrtimer_cancel(hrtimer_t *timer);
+
+/* Whether a timer is pending. */
+bool hrtimer_active(const hrtimer_t *timer);
+
+/* Earliest pending expiry on a CPU, or UINT64_MAX. */
+uint64_t hrtimer_next_expiry(uint32_t cpu);
+
+/* Run the expired timers of the current CPU (timer interrupt context). */
+void hrtimer_run_queues(void);
+
+/* Allocate the per-CPU timer queues. */
+void hrtimer_init_cpus(uint32_t cpu_count);
+
+#endif // INCLUDE_HRTIMER_H_
@@ -0,0 +1,43 @@
+/*
+ *
+ *      tick.h
+ *      Periodic tick and tickless idle header file
+ *
+ *      2026/10/17 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_TICK_H_
+#define INCLUDE_TICK_H_
+
+#include <libs/std/stdbool.h>
+#include <libs/std/stdint.h>
+
+/* Per-CPU tick device state */
+typedef struct tick_cpu {
+        uint8_t  stopped;    // periodic tick replaced by a one-shot event while idle
+        uint64_t stop_ns;    // tick-aligned time from which skipped ticks are counted
+        uint64_t carry_ns;   // partial tick left over from the previous idle period
+        uint64_t next_event; // programmed one-shot expiry (CLOCK_MONOTONIC ns)
+        uint64_t stops;      // statistics: idle periods that stopped the tick
+} tick_cpu_t;
+
+/* Allocate per-CPU tick and high-resolution timer state. */
+void tick_init(uint32_t cpu_count);
+
+/*
+ * Timer interrupt hook: runs expired high-resolution timers and catches up
+ * skipped ticks.  Returns false for a one-shot idle event, in which case the
+ * periodic tick work must not run.
+ */
+bool tick_handle_interrupt(void);
+
+/* Idle loop hooks (interrupts disabled): stop the tick before halting, restart it after. */
+void tick_nohz_idle_enter(void);
+void tick_nohz_idle_exit(void);
+
+/* Up-to-date global tick count while CPU 0's tick is stopped (lock-free). */
+uint64_t tick_nohz_jiffies(uint64_t ticks);
+
+#endif // INCLUDE_TICK_H_
@@ -124,4 +124,7 @@ void timer_handle(void);
 /* Register timer bottom-half processing before kernel workers start. */
 void timer_deferred_init(void);
 
+/* Ask the timer bottom half to run once (IRQ-safe). */
+void timer_queue_deferred_work(void);
+
 #endif // INCLUDE_TIMER_H_
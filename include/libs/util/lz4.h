@@ -0,0 +1,25 @@
+/*
+ *
+ *      lz4.h
+ *      LZ4 block compression
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_LZ4_H_
+#define INCLUDE_LZ4_H_
+
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+
+#define LZ4_MAX_INPUT 65535U // match offsets are 16-bit, so inputs are kept below 64 KiB
+
+/* Compress size bytes into an LZ4 block; returns the block length, or 0 if it does not fit in capacity. */
+size_t lz4_compress(const void *source, size_t size, void *dest, size_t capacity);
+
+/* Decompress an LZ4 block; returns the decoded length, or a negative errno on malformed input. */
+int lz4_decompress(const void *source, size_t size, void *dest, size_t capacity);
+
+#endif // INCLUDE_LZ4_H_
@@ -20,6 +20,7 @@ typedef enum {
 } heap_error_t;
 
 typedef struct {
+        size_t window_bytes;
         size_t arena_bytes;
         size_t metadata_bytes;
         size_t free_page_bytes;
@@ -32,8 +33,11 @@ typedef struct {
 
 typedef void (*error_handler)(heap_error_t error, void *ptr);
 
-/* Initializes the heap memory arena */
-int heap_init(uint8_t *address, size_t size);
+/* Initializes the heap over a reserved virtual window, backing the first initial bytes */
+int heap_init(uint8_t *address, size_t size, size_t initial);
+
+/* Returns fully free heap chunks to the frame allocator; reports the pages released */
+size_t heap_trim(void);
 
 /* Set a custom error handling function */
 void heap_onerror(error_handler handler);
@@ -31,7 +31,7 @@ typedef struct {
         uint32_t tag; // Caller-owned while the page is allocated/reserved.
         uint8_t  order;
         uint8_t  state;
-        uint16_t reserved;
+        uint16_t flags; // Caller-owned flag bits, like tag.
 } buddy_page_t;
 
 typedef struct {
@@ -49,6 +49,12 @@ int buddy_init(buddy_allocator_t *allocator, buddy_page_t *metadata, size_t page
 /* Add a reserved range to the allocator, maximally coalescing it. */
 int buddy_add_range(buddy_allocator_t *allocator, size_t start, size_t count);
 
+/* Grow the managed index space; the new tail starts out reserved. */
+int buddy_extend(buddy_allocator_t *allocator, size_t page_count);
+
+/* Take an aligned, completely free block back out of the allocator as reserved. */
+int buddy_claim(buddy_allocator_t *allocator, size_t index, unsigned order);
+
 /* Allocate/free an aligned 2^order-unit block. */
 size_t buddy_alloc(buddy_allocator_t *allocator, unsigned order);
 int    buddy_free(buddy_allocator_t *allocator, size_t index, unsigned order);
@@ -17,6 +17,10 @@
 #include <mem/buddy.h>
 #include <sync/spin_lock.h>
 
+/* buddy_page_t flags of an allocated 4 KiB frame. */
+#define FRAME_PAGE_RELEASED 0x1 // final reference dropped; the releaser owns the PCP handoff
+#define FRAME_PAGE_ANON     0x2 // may have a reverse-map record to forget on release
+
 typedef struct {
         buddy_allocator_t buddy;
         size_t            frame_count;
@@ -34,6 +38,23 @@ typedef struct {
         unsigned max_order;
 } frame_stats_t;
 
+/* Free-page watermarks: kswapd wakes below low and works up to high; allocators stall below min. */
+typedef struct {
+        size_t min;
+        size_t low;
+        size_t high;
+} frame_watermarks_t;
+
+/* Reclaim counters exported through /proc/vmstat. */
+typedef struct {
+        uint64_t scan_kswapd;    // LRU pages examined by kswapd
+        uint64_t scan_direct;    // LRU pages examined by allocating tasks
+        uint64_t steal_kswapd;   // pages freed by kswapd
+        uint64_t steal_direct;   // pages freed by allocating tasks
+        uint64_t kswapd_wakeups; // low-watermark wakeups of kswapd
+        uint64_t alloc_stalls;   // allocations that fell back to direct reclaim
+} frame_reclaim_stats_t;
+
 extern log_buffer_t      frame_log;
 extern frame_allocator_t frame_allocator;
 
@@ -52,6 +73,13 @@ int frame_reclaim_pages(size_t target);
 /* Refill the low-memory watermark from a caller that holds no VM locks. */
 void frame_reclaim_if_needed(size_t requested);
 
+/* Report the current watermarks and reclaim counters. */
+void frame_get_watermarks(frame_watermarks_t *watermarks);
+void frame_get_reclaim_stats(frame_reclaim_stats_t *stats);
+
+/* Register the background reclaim worker (kswapd). */
+void kswapd_start_worker(void);
+
 /* Allocate 2M memory frames */
 uint64_t alloc_frames_2M(size_t count);
 
@@ -64,6 +92,9 @@ int frame_retain_range(uint64_t addr, size_t count);
 /* Release ownership of a range, returning final references to the bitmap. */
 int frame_release_range(uint64_t addr, size_t count);
 
+/* Flag a frame whose final release must also drop its reverse-map record. */
+void frame_mark_anon(uint64_t addr);
+
 /* Return the current ownership count of a 4 KiB physical frame. */
 uint32_t frame_refcount(uint64_t addr);
 
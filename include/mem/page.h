@@ -46,6 +46,20 @@ struct process;
 #define PAGE_2M_MASK 0x000fffffffe00000ULL // (~(PAGE_2M_SIZE - 1) & PAGE_4K_MASK)
 #define PAGE_1G_MASK 0x000fffffc0000000ULL // (~(PAGE_1G_SIZE - 1) & PAGE_4K_MASK)
 
+/* End of the lower (user) canonical half */
+#define PAGE_USER_SPACE_END 0x0000800000000000ULL
+
+/* CPUs tracked per address space; higher CPUs are always shot down */
+#define PAGE_TLB_MAX_CPUS  256U
+#define PAGE_TLB_MASK_BITS 64U
+#define PAGE_TLB_MASK_SIZE (PAGE_TLB_MAX_CPUS / PAGE_TLB_MASK_BITS)
+
+/* Ranges longer than this many pages are flushed by reloading CR3 instead of invlpg */
+#define PAGE_TLB_FLUSH_CEILING 33U
+
+/* Frames whose release a TLB batch can defer before it must flush */
+#define TLB_BATCH_FRAMES 64U
+
 typedef struct {
         uint64_t value;
 } page_table_entry_t;
@@ -54,11 +68,28 @@ typedef struct {
         page_table_entry_t entries[512];
 } page_table_t;
 
-typedef struct {
-        page_table_t *table;
-        spinlock_t    lock;
+typedef struct page_directory {
+        page_table_t     *table;
+        spinlock_t        lock;
+        uint64_t          tlb_id;                       // Unique PCID tag, 0 = untracked (kernel)
+        volatile uint64_t tlb_generation;               // Bumped by every flush of this address space
+        volatile uint64_t cpu_mask[PAGE_TLB_MASK_SIZE]; // CPUs that may cache translations for it
 } page_directory_t;
 
+/*
+ * Deferred shootdown for one address space: unmapped ranges are merged and
+ * their frames are held back until a single flush covers every CPU that may
+ * still cache them.
+ */
+typedef struct {
+        page_directory_t *directory;
+        uint64_t          start;
+        uint64_t          end;
+        size_t            count;
+        uint64_t          frames[TLB_BATCH_FRAMES];
+        uint32_t          frame_counts[TLB_BATCH_FRAMES];
+} tlb_batch_t;
+
 typedef struct {
         char    pat_str[64];
         uint8_t entries[8];
@@ -89,6 +120,9 @@ void copy_page_table_recursive(page_table_t *source_table, page_table_t *new_tab
 /* Recursively free memory page tables using an explicit stack */
 void free_page_table_recursive(page_table_t *table, int level);
 
+/* Give a new directory its TLB tag and an empty CPU mask */
+void page_directory_tlb_init(page_directory_t *directory);
+
 /* Clone a page directory */
 page_directory_t *clone_directory(page_directory_t *src);
 
@@ -113,15 +147,36 @@ uint64_t page_unmap(page_directory_t *directory, uint64_t addr);
 /* Unmap a user leaf and release its physical ownership reference. */
 int page_unmap_release(page_directory_t *directory, uint64_t addr);
 
+/* Unmap a user leaf, deferring the shootdown and frame release to the batch. */
+int page_unmap_release_batch(tlb_batch_t *batch, uint64_t addr);
+
+/* Start an empty shootdown batch for directory */
+void tlb_batch_init(tlb_batch_t *batch, page_directory_t *directory);
+
+/* Queue a range (and optionally its frames) for the next batch flush */
+void tlb_batch_add(tlb_batch_t *batch, uint64_t start, uint64_t end, uint64_t frame, size_t frame_count);
+
+/* Shoot down the batched range once, then release the deferred frames */
+void tlb_batch_finish(tlb_batch_t *batch);
+
 /* Maps a virtual address to a physical frame using 2MB huge pages */
 void page_map_to_2M(page_directory_t *directory, uint64_t addr, uint64_t frame, uint64_t flags);
 
+/* Unmap a 2MB huge page and return its physical frame, or zero if unmapped */
+uint64_t page_unmap_2M(page_directory_t *directory, uint64_t addr);
+
 /* Maps a virtual address to a physical frame using 1GB huge pages */
 void page_map_to_1G(page_directory_t *directory, uint64_t addr, uint64_t frame, uint64_t flags);
 
 /* Switch the page directory of the current process */
 void switch_page_directory(page_directory_t *dir);
 
+/* Flush a range of directory on this CPU if it is live here, otherwise drop this CPU from its mask */
+void page_tlb_flush_local(page_directory_t *directory, uint64_t start, uint64_t end);
+
+/* Enable PCID tagging on the calling CPU when supported */
+void page_tlb_init_cpu(void);
+
 /* Maps a contiguous physical memory range to the specified virtual address range */
 void page_map_range(page_directory_t *directory, uint64_t addr, uint64_t frame, uint64_t length, uint64_t flags);
 
@@ -42,6 +42,9 @@ typedef struct {
         pagecache_sync_op_t   sync;
 } pagecache_ops_t;
 
+/* Span callback for the iterators: runs with the page locked, returns 0 or -errno to stop. */
+typedef int (*pagecache_actor_t)(void *context, pagecache_page_t *page, void *data, size_t count);
+
 typedef void *(*pagecache_alloc_page_t)(uint64_t *physical);
 typedef void (*pagecache_free_page_t)(void *page, uint64_t physical);
 
@@ -79,6 +82,8 @@ void                 pagecache_mapping_destroy(pagecache_mapping_t *mapping);
 /* Core Functions */
 int64_t  pagecache_read(pagecache_mapping_t *mapping, void *buffer, uint64_t offset, size_t size);
 int64_t  pagecache_write(pagecache_mapping_t *mapping, const void *buffer, uint64_t offset, size_t size);
+int64_t  pagecache_read_iter(pagecache_mapping_t *mapping, uint64_t offset, size_t size, pagecache_actor_t actor, void *context);
+int64_t  pagecache_write_iter(pagecache_mapping_t *mapping, uint64_t offset, size_t size, pagecache_actor_t actor, void *context);
 int      pagecache_writeback(pagecache_mapping_t *mapping, uint64_t start, uint64_t end, uint32_t flags);
 int      pagecache_writeback_all(uint32_t flags);
 int      pagecache_invalidate(pagecache_mapping_t *mapping, uint64_t start, uint64_t end, uint32_t flags);
@@ -101,8 +106,17 @@ uint64_t          pagecache_page_physical(pagecache_page_t *page);
 uint64_t          pagecache_page_index(pagecache_page_t *page);
 void              pagecache_mark_dirty(pagecache_page_t *page);
 
+/*
+ * Buffer pins keep a page's data valid (not its cache membership) while a
+ * pipe or splice holds it without a page reference; eviction of a pinned
+ * page defers freeing the data to the last pagecache_buffer_put().
+ */
+void pagecache_buffer_get(pagecache_page_t *page);
+void pagecache_buffer_put(pagecache_page_t *page);
+
 /* Reclaim pages to free memory and report resulting stats */
 size_t pagecache_reclaim(size_t target);
+size_t pagecache_reclaim_scan(size_t target, size_t *scanned);
 void   pagecache_get_stats(pagecache_stats_t *stats);
 
 #endif // INCLUDE_PAGECACHE_H_
@@ -0,0 +1,65 @@
+/*
+ *
+ *      rmap.h
+ *      Anonymous page reverse mapping and LRU header file
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_RMAP_H_
+#define INCLUDE_RMAP_H_
+
+#include <libs/std/stdbool.h>
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+
+#define RMAP_SCAN_MAPPINGS 8U // mappings examined per isolated page
+
+/* LRU destinations for rmap_putback() */
+#define RMAP_LRU_INACTIVE 0
+#define RMAP_LRU_ACTIVE   1
+#define RMAP_LRU_FORGET   2 // no live mapping is left; drop the record
+
+struct process;
+struct page_directory;
+
+/* One anonymous page taken off its LRU list, with a snapshot of its mappings. */
+typedef struct {
+        void     *page; // opaque record, owned by the scanner until putback
+        uint64_t  frame;
+        uint32_t  count; // mappings copied below
+        int64_t   pid[RMAP_SCAN_MAPPINGS];
+        uintptr_t address[RMAP_SCAN_MAPPINGS];
+} rmap_scan_t;
+
+typedef struct {
+        uint64_t active;
+        uint64_t inactive;
+        uint64_t activated;   // inactive -> active promotions
+        uint64_t deactivated; // active -> inactive demotions
+} rmap_stats_t;
+
+/* Size the frame hash; called once the heap is up. */
+void rmap_init(void);
+
+/* Record that proc maps the anonymous frame at address, adding it to the inactive list if new. */
+void rmap_add_anon(uint64_t frame, struct process *proc, uintptr_t address);
+
+/* Add the child's mappings of every tracked frame after a fork's COW clone. */
+void rmap_clone_user(struct page_directory *directory, struct process *child);
+
+/* Forget a frame whose last reference was just dropped. */
+void rmap_frame_freed(uint64_t frame);
+
+/* Take the tail of the active or inactive list for scanning. */
+bool rmap_isolate(bool active, rmap_scan_t *scan);
+
+/* Return an isolated page to an LRU list, dropping mappings flagged in stale_mask. */
+void rmap_putback(rmap_scan_t *scan, int lru, uint32_t stale_mask);
+
+/* Report LRU sizes and aging counters. */
+void rmap_get_stats(rmap_stats_t *stats);
+
+#endif // INCLUDE_RMAP_H_
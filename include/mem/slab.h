@@ -27,6 +27,7 @@ typedef struct {
         size_t empty_slabs;
         size_t allocations;
         size_t frees;
+        size_t magazine_objects;
 } slab_cache_stats_t;
 
 /* Create/destroy a typed object cache.  Alignment must be a power of two. */
@@ -37,8 +38,11 @@ int           slab_cache_destroy(slab_cache_t *cache);
 void *slab_cache_alloc(slab_cache_t *cache);
 int   slab_cache_free(slab_cache_t *cache, void *object);
 
-/* Return completely empty slabs to the heap page buddy. */
+/* Drain the magazine depot and return completely empty slabs to the heap page buddy. */
 size_t slab_cache_shrink(slab_cache_t *cache);
 void   slab_cache_get_stats(slab_cache_t *cache, slab_cache_stats_t *stats);
 
+/* Drain all per-CPU magazines and shrink every cache; called under memory pressure. */
+size_t slab_reclaim(void);
+
 #endif // INCLUDE_SLAB_H_
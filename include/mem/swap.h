@@ -23,6 +23,10 @@
 #define SWAP_PAGE_SIZE        4096ULL
 #define SWAP_MAX_AREAS        32
 #define SWAP_PRIORITY_DEFAULT (-2)
+#define SWAP_CLUSTER_SLOTS    64U   // slots per allocation cluster (one bitmap word)
+#define SWAP_WRITE_BATCH      16U   // pages written per clustered swap-out
+#define SWAP_READAHEAD        8U    // pages in the swap-in readahead window
+#define SWAP_CACHE_MAX        1024U // swap-cache pages beyond which readahead stops
 
 /* Linux swapon(2) flags. */
 #define SWAP_FLAG_PREFER    0x8000U
@@ -59,6 +63,10 @@ typedef struct swap_stats {
         uint64_t pages_in;
         uint64_t pages_out;
         uint64_t faults;
+        uint64_t cache_pages;
+        uint64_t cache_hits;
+        uint64_t readahead;
+        uint64_t readahead_hits;
         uint32_t areas;
 } swap_stats_t;
 
@@ -73,6 +81,7 @@ uint64_t swap_entry_pte_flags(uint64_t pte);
 /* Slot bitmap management with cluster hinting. */
 int      swap_slot_map_init(swap_slot_map_t *map, uint64_t *bitmap, uint32_t *refs, uint64_t slots);
 uint64_t swap_slot_alloc(swap_slot_map_t *map);
+uint64_t swap_slot_alloc_run(swap_slot_map_t *map, uint64_t want, uint64_t *count);
 int      swap_slot_retain(swap_slot_map_t *map, uint64_t slot);
 int      swap_slot_release(swap_slot_map_t *map, uint64_t slot);
 uint32_t swap_slot_refs(const swap_slot_map_t *map, uint64_t slot);
@@ -80,13 +89,15 @@ uint32_t swap_slot_refs(const swap_slot_map_t *map, uint64_t slot);
 #ifndef SWAP_TEST_ONLY
 #    include <mem/page.h>
 
+struct process;
+
 /* Lifecycle, swap files, reclaim, and fault handling. */
 void swap_init(void);
 int  swap_activate_path(const char *path, uint32_t flags);
 int  swap_deactivate_path(const char *path);
-int  swap_reclaim(size_t target);
+int  swap_reclaim(size_t target, size_t *scanned);
 bool swap_has_free_space(void);
-int  swap_fault(page_directory_t *directory, uintptr_t address);
+int  swap_fault(struct process *proc, uintptr_t address);
 int  swap_entry_retain_pte(uint64_t pte);
 int  swap_entry_release_pte(uint64_t pte);
 void swap_get_stats(swap_stats_t *stats);
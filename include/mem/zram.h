@@ -0,0 +1,73 @@
+/*
+ *
+ *      zram.h
+ *      Compressed in-memory swap store header file
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_ZRAM_H_
+#define INCLUDE_ZRAM_H_
+
+#include <libs/std/stdbool.h>
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+
+#define ZRAM_MAJOR   252 // Linux allocates the zram major dynamically; this is its usual value
+#define ZRAM_DEVICES 1
+#define ZRAM_NAME    "zram"
+
+typedef struct zram_device zram_device_t;
+
+typedef struct zram_stats {
+        uint64_t disksize;
+        uint64_t orig_data_size;  // bytes of pages stored, before compression
+        uint64_t compr_data_size; // bytes of compressed payload
+        uint64_t mem_used_total;  // pool frames backing the payload, in bytes
+        uint64_t mem_used_max;
+        uint64_t same_pages; // pages kept as a single repeated word
+        uint64_t huge_pages; // incompressible pages kept whole
+        uint64_t pages_stored;
+        uint64_t num_reads;
+        uint64_t num_writes;
+        uint64_t failed_reads;
+        uint64_t failed_writes;
+        bool     initstate; // claimed as a swap area
+} zram_stats_t;
+
+/* Set up the zram devices; disk sizes default to half of RAM until configured. */
+void zram_init(void);
+
+/* Return device id, or NULL past the last one. */
+zram_device_t *zram_get_device(uint32_t id);
+
+/* Resolve a /dev/zramN path to its device. */
+zram_device_t *zram_lookup_path(const char *path);
+
+/* Return the device's name, e.g. "zram0". */
+const char *zram_device_name(const zram_device_t *zram);
+
+/* Change the disk size in bytes; fails with -EBUSY while the device is in use. */
+int zram_set_disksize(zram_device_t *zram, uint64_t bytes);
+
+/* Take exclusive use of a device and allocate its slot table; returns the page count. */
+int zram_claim(zram_device_t *zram, uint64_t *pages);
+
+/* Free every stored page and release a claimed device. */
+void zram_unclaim(zram_device_t *zram);
+
+/* Compress and store one 4 KiB page at index, replacing what was there. */
+int zram_write_page(zram_device_t *zram, uint64_t index, const void *page);
+
+/* Decompress the page at index into a 4 KiB buffer; an empty index reads as zeros. */
+int zram_read_page(zram_device_t *zram, uint64_t index, void *page);
+
+/* Drop the page at index. */
+void zram_discard_page(zram_device_t *zram, uint64_t index);
+
+/* Snapshot a device's usage and compression counters. */
+void zram_get_stats(zram_device_t *zram, zram_stats_t *stats);
+
+#endif // INCLUDE_ZRAM_H_
@@ -77,5 +77,6 @@ uint32_t net_checksum_add(uint32_t sum, const void *data, size_t length);
 uint16_t net_checksum_finish(uint32_t sum);
 uint16_t net_checksum(const void *data, size_t length);
 uint16_t net_checksum_ipv4_pseudo(uint32_t source, uint32_t destination, uint8_t protocol, const void *data, size_t length);
+uint16_t net_checksum_ipv4_pseudo_partial(uint32_t source, uint32_t destination, uint8_t protocol, size_t length);
 
 #endif // INCLUDE_ENDIAN_H_
@@ -29,6 +29,7 @@
 #define NETDEV_F_RUNNING   0x0002U
 #define NETDEV_F_BROADCAST 0x0004U
 #define NETDEV_F_PROMISC   0x0008U
+#define NETDEV_F_TX_CSUM   0x0010U // device fills in partial TCP/UDP checksums
 
 typedef struct net_device net_device_t;
 typedef net_device_t      netdev_t;
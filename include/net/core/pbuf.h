@@ -25,8 +25,12 @@ typedef struct net_pbuf {
         size_t   capacity;
         uint32_t refs;
         void (*release)(void *context, void *data);
-        void   *release_context;
-        uint8_t external;
+        void    *release_context;
+        uint8_t  external;
+        uint16_t csum_start;    // TX: storage offset where the partial transport checksum begins
+        uint16_t csum_offset;   // TX: checksum field offset from csum_start
+        uint8_t  csum_partial;  // TX: checksum field holds only the pseudo-header sum
+        uint8_t  csum_verified; // RX: the device validated the transport checksum
 } net_pbuf_t;
 
 /* Allocation and lifecycle. */
@@ -42,4 +46,8 @@ void  *net_pbuf_pull(net_pbuf_t *pbuf, size_t length);
 int    net_pbuf_trim(net_pbuf_t *pbuf, size_t length);
 size_t net_pbuf_headroom(const net_pbuf_t *pbuf);
 
+/* Transmit checksum offload: mark the transport header at start, or finish its checksum in software. */
+void net_pbuf_checksum_partial(net_pbuf_t *pbuf, const void *start, size_t offset);
+void net_pbuf_checksum_resolve(net_pbuf_t *pbuf);
+
 #endif // INCLUDE_PBUF_H_
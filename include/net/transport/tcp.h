@@ -18,11 +18,12 @@
 #include <net/ipv6/ipv6.h>
 #include <process/task.h>
 
-#define TCP_ENDPOINT_MAX    128U
-#define TCP_ACCEPT_MAX      16U
-#define TCP_RX_BUFFER_MAX   65535U
-#define TCP_TX_SEGMENT_MAX  32U
-#define TCP_OOO_SEGMENT_MAX 16U
+#define TCP_ACCEPT_MAX        16U
+#define TCP_RX_BUFFER_MIN     4096U                // smallest receive ring accepted by TCP_OPTION_RCVBUF
+#define TCP_RX_BUFFER_DEFAULT (256U * 1024U)       // receive ring of a fresh PCB
+#define TCP_RX_BUFFER_MAX     (4U * 1024U * 1024U) // receive ring ceiling, also fixes our window scale
+#define TCP_TX_SEGMENT_MAX    4096U
+#define TCP_OOO_SEGMENT_MAX   256U
 
 #define TCP_KEEPIDLE_DEFAULT_TICKS  ((uint64_t)7200U * TIMER_HZ)
 #define TCP_KEEPINTVL_DEFAULT_TICKS ((uint64_t)75U * TIMER_HZ)
@@ -94,6 +95,8 @@ typedef enum tcp_option {
     TCP_OPTION_KEEPCNT,
     TCP_OPTION_SYN_RETRIES,
     TCP_OPTION_DATA_RETRIES,
+    TCP_OPTION_RCVBUF,     // receive ring size in bytes
+    TCP_OPTION_CONGESTION, // congestion-control algorithm, by tcp_congestion_id()
 } tcp_option_t;
 
 typedef struct tcp_endpoint_info {
@@ -108,8 +111,9 @@ typedef struct tcp_endpoint_info {
         uint32_t       receive_queued;
         uint32_t       send_unacknowledged;
         uint32_t       congestion_window;
-        uint16_t       receive_window;
-        uint16_t       send_window;
+        uint32_t       ssthresh;
+        uint32_t       receive_window;
+        uint32_t       send_window;
         uint16_t       peer_mss;
         uint32_t       retransmit_timeout;
         uint32_t       retransmissions;
@@ -120,6 +124,12 @@ typedef struct tcp_endpoint_info {
         uint64_t       last_received_ticks;
         uint64_t       next_timer_ticks;
         uint8_t        keepalive_enabled;
+        uint8_t        send_wscale;    // shift applied to the peer's windows, 0 if not negotiated
+        uint8_t        receive_wscale; // shift applied to our windows, 0 if not negotiated
+        uint8_t        timestamps;
+        uint8_t        sack;
+        uint64_t       pacing_rate; // bytes per second, 0 if unpaced
+        const char    *congestion;  // congestion-control algorithm name
 } tcp_endpoint_info_t;
 
 /* TCP endpoint lifecycle and socket-like operations. */
@@ -133,7 +143,7 @@ tcp_endpoint_t *tcp_accept(tcp_endpoint_t *endpoint);
 int             tcp_connect(tcp_endpoint_t *endpoint, uint32_t address, uint16_t port);
 int             tcp_connect6(tcp_endpoint_t *endpoint, const ipv6_address_t *address, uint16_t port);
 int             tcp_send(tcp_endpoint_t *endpoint, const void *data, size_t length);
-int             tcp_receive(tcp_endpoint_t *endpoint, void *data, size_t capacity);
+int             tcp_receive(tcp_endpoint_t *endpoint, void *data, size_t capacity, int peek);
 int             tcp_shutdown(tcp_endpoint_t *endpoint);
 
 /* Endpoint state, options, and readiness. */
@@ -148,6 +158,7 @@ void          tcp_set_event_callback(tcp_endpoint_t *endpoint, tcp_event_callbac
 wait_queue_t *tcp_wait_queue(tcp_endpoint_t *endpoint);
 
 /* Protocol entry points and packet parsing. */
+void        tcp_init(void);
 int         tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet);
 int         tcp_input6(net_device_t *device, const ipv6_info_t *ip, net_pbuf_t *packet);
 void        tcp_timer(uint64_t now_ticks);
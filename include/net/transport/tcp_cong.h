@@ -0,0 +1,73 @@
+/*
+ *
+ *      tcp_cong.h
+ *      Pluggable TCP congestion control
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#ifndef INCLUDE_TCP_CONG_H_
+#define INCLUDE_TCP_CONG_H_
+
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+
+#define TCP_CA_NAME_MAX 16U // longest algorithm name, including the NUL
+#define TCP_CA_PRIV     8U  // 64-bit words of algorithm-private state
+
+/*
+ * Congestion state shared between the TCP core and an algorithm.  The core
+ * refreshes mss, srtt, min_rtt, flight and in_recovery before every hook;
+ * algorithms own cwnd, ssthresh and priv.
+ */
+typedef struct tcp_cc {
+        uint32_t cwnd;     // congestion window in bytes
+        uint32_t ssthresh; // slow-start threshold in bytes
+        uint32_t mss;      // sender segment size the window is counted in
+        uint32_t srtt;     // smoothed RTT in ticks, 0 before the first sample
+        uint32_t min_rtt;  // lowest RTT sample seen, in ticks, 0 before the first sample
+        uint32_t flight;   // bytes sent and not yet acknowledged
+        uint8_t  in_recovery;
+        uint64_t priv[TCP_CA_PRIV];
+} tcp_cc_t;
+
+/*
+ * One congestion-control algorithm.  Every hook runs with the endpoint lock
+ * held and must not sleep; init and pacing_rate may be NULL.
+ *
+ *  init         fresh connection, called with priv zeroed
+ *  on_ack       new data acknowledged; rtt is this ACK's sample in ticks or 0
+ *  on_loss      fast retransmit: pick ssthresh
+ *  on_rto       retransmission timeout: pick ssthresh and cwnd
+ *  pacing_rate  bytes per second to pace at, 0 to send unpaced
+ *
+ * During fast recovery the core inflates and deflates cwnd itself (RFC 6582);
+ * on_ack still runs so model-based algorithms keep their estimates current.
+ */
+typedef struct tcp_congestion_ops {
+        const char *name;
+        void (*init)(tcp_cc_t *cc);
+        void (*on_ack)(tcp_cc_t *cc, uint32_t acked, uint32_t rtt, uint64_t now);
+        void (*on_loss)(tcp_cc_t *cc, uint64_t now);
+        void (*on_rto)(tcp_cc_t *cc, uint64_t now);
+        uint64_t (*pacing_rate)(const tcp_cc_t *cc);
+} tcp_congestion_ops_t;
+
+extern const tcp_congestion_ops_t tcp_reno_ops;
+extern const tcp_congestion_ops_t tcp_cubic_ops;
+extern const tcp_congestion_ops_t tcp_bbr_ops;
+
+/* Look up an algorithm by index or name; the index doubles as TCP_OPTION_CONGESTION's value. */
+const tcp_congestion_ops_t *tcp_congestion_get(unsigned id);
+int                         tcp_congestion_id(const char *name);
+
+/* Algorithm given to new sockets (net.ipv4.tcp_congestion_control). */
+const tcp_congestion_ops_t *tcp_congestion_default(void);
+int                         tcp_congestion_set_default(const char *name);
+
+/* Space-separated list of the available algorithms. */
+void tcp_congestion_available(char *buffer, size_t size);
+
+#endif // INCLUDE_TCP_CONG_H_
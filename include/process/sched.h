@@ -78,6 +78,10 @@ typedef struct {
         uint64_t         system_ticks;
         uint64_t         idle_ticks;
         uint64_t         context_switches;
+        spinlock_t       timer_lock;      // protects timers and timer_next
+        rb_root_t        timers;          // tick deadlines of tasks that went to sleep on this CPU
+        uint64_t         timer_next;      // earliest queued deadline, or UINT64_MAX
+        uint64_t         timer_expired;   // deadlines that fired on this CPU
         volatile uint8_t need_resched;    // local wakeup should preempt at a safe return point
         volatile uint8_t resched_pending; // coalesce remote reschedule IPIs
         uint8_t          online;          // CPU is online
@@ -86,16 +90,14 @@ typedef struct {
 /* Global scheduler state */
 
 typedef struct {
-        eevdf_rq_t  *rqs;      // per-CPU runqueues
-        uint32_t     nr_cpus;  // number of CPUs
-        uint64_t     next_pid; // next PID to assign
-        uint64_t     ticks;    // global tick counter
-        uint64_t     tasks_created;
-        uint64_t     processes_created;
-        int          started;     // 1 once sched_start() has run
-        spinlock_t   lock;        // global scheduler lock
-        ilist_node_t sleep_queue; // sleeping tasks (ordered by wake_tick)
-        ilist_node_t timer_queue; // timed wait-queue tasks (wake on deadline)
+        eevdf_rq_t *rqs;      // per-CPU runqueues
+        uint32_t    nr_cpus;  // number of CPUs
+        uint64_t    next_pid; // next PID to assign
+        uint64_t    ticks;    // global tick counter
+        uint64_t    tasks_created;
+        uint64_t    processes_created;
+        int         started; // 1 once sched_start() has run
+        spinlock_t  lock;    // global scheduler lock
 } scheduler_t;
 
 /* External interface */
@@ -144,6 +146,15 @@ void sched_maybe_preempt(void);
 /* Return the scheduler tick count */
 uint64_t sched_ticks(void);
 
+/* Account ticks a CPU skipped while its periodic tick was stopped in idle */
+void sched_tick_skipped(uint32_t cpu_id, uint64_t ticks);
+
+/* Earliest sleep or timed-wait deadline queued on a CPU in ticks, or UINT64_MAX */
+uint64_t sched_next_timer_tick(uint32_t cpu_id);
+
+/* Drop a task's tick deadline from its CPU's timer tree before the task is freed */
+void sched_timer_release(task_t *task);
+
 /* Finish the current task. This function does not return */
 __attribute__((noreturn)) void task_exit(void);
 
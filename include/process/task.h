@@ -11,6 +11,7 @@
 #ifndef INCLUDE_TASK_H_
 #define INCLUDE_TASK_H_
 
+#include <kernel/timer/hrtimer.h>
 #include <libs/list/intrusive_list.h>
 #include <libs/std/stdbool.h>
 #include <libs/std/stddef.h>
@@ -23,6 +24,7 @@
 typedef struct process process_t;
 typedef struct cgroup  cgroup_t;
 struct seccomp_filter;
+struct blk_plug;
 
 #define TASK_NAME_LEN      32
 #define TASK_KERNEL_STACK  0x10000
@@ -108,12 +110,15 @@ struct task {
         task_context_t     context;
         thread_struct_t    thread;     // per-thread arch state (fs_base, gs_base)
         rb_node_t          run_node;   // EEVDF red-black tree node
-        ilist_node_t       sched_node; // sleep / wait_queue linkage
-        ilist_node_t       timer_node; // timed-waiter linkage (scheduler.timer_queue)
+        ilist_node_t       sched_node; // wait_queue linkage
+        rb_node_t          timer_node; // tick-deadline linkage in a per-CPU timer tree
         page_directory_t  *page_directory;
         uint8_t           *kernel_stack;
         uint64_t           time_slice;
         uint64_t           wake_tick;
+        uint64_t           timer_expires; // timer tree key, stable while timer_node is queued
+        int32_t            timer_cpu;     // CPU whose timer tree holds timer_node, or -1
+        volatile uint8_t   timer_armed;   // cleared to cancel the deadline without the tree lock
         wait_queue_t      *wait_queue;
         task_wake_reason_t wake_reason;
         uint32_t           cpu_id;
@@ -163,9 +168,11 @@ struct task {
         struct seccomp_filter *seccomp_filter;
         uint8_t                seccomp_mode;
         bool                   no_new_privs;
-        ptrace_state_t         ptrace;  // Linux ptrace state is per-thread
-        uint64_t               flags;   // PF_KTHREAD etc.
-        kthread_info_t         kthread; // kernel-thread lifecycle (PF_KTHREAD only)
+        ptrace_state_t         ptrace;     // Linux ptrace state is per-thread
+        uint64_t               flags;      // PF_KTHREAD etc.
+        kthread_info_t         kthread;    // kernel-thread lifecycle (PF_KTHREAD only)
+        struct blk_plug       *plug;       // active block-layer plug, or NULL
+        hrtimer_t              wait_timer; // deadline of wait_queue_wait_deadline()
 };
 
 /* Initialize a wait queue */
@@ -204,6 +211,9 @@ void wait_queue_cancel(wait_queue_t *queue);
  */
 int wait_queue_wait_timed(wait_queue_t *queue, uint64_t deadline_ticks);
 
+/* Same, with a CLOCK_MONOTONIC deadline in nanoseconds (high-resolution timer). */
+int wait_queue_wait_deadline(wait_queue_t *queue, uint64_t deadline_ns);
+
 /* Wake one task from a wait queue */
 task_t *wait_queue_wake_one(wait_queue_t *queue);
 
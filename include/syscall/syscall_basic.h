@@ -93,6 +93,7 @@ int64_t sys_unshare_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint6
 int64_t sys_splice_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
 int64_t sys_tee_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
 int64_t sys_vmsplice_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
+int64_t sys_copy_file_range_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
 int64_t sys_ioprio_set_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
 int64_t sys_ioprio_get_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
 int64_t sys_timer_create_impl(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
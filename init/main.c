@@ -19,6 +19,7 @@
 #include <drivers/base/device.h>
 #include <drivers/block/ata/pata/ide.h>
 #include <drivers/block/ata/sata/ahci.h>
+#include <drivers/block/core/bio.h>
 #include <drivers/block/core/gendisk.h>
 #include <drivers/block/nvme/nvme.h>
 #include <drivers/bus/pci.h>
@@ -70,6 +71,7 @@
 #include <fs/sysfs/tpm_sysfs.h>
 #include <fs/sysfs/tty_sysfs.h>
 #include <fs/sysfs/usb_sysfs.h>
+#include <fs/sysfs/zram_sysfs.h>
 #include <fs/tmpfs/tmpfs.h>
 #include <ipc/epoll.h>
 #include <ipc/futex.h>
@@ -83,6 +85,7 @@
 #include <kernel/interrupt/interrupt.h>
 #include <kernel/module/module.h>
 #include <kernel/printk.h>
+#include <kernel/timer/tick.h>
 #include <kernel/timer/timer.h>
 #include <kernel/uinxed.h>
 #include <libs/std/string.h>
@@ -90,7 +93,9 @@
 #include <mem/heap.h>
 #include <mem/hhdm.h>
 #include <mem/page.h>
+#include <mem/rmap.h>
 #include <mem/swap.h>
+#include <mem/zram.h>
 #include <net/core/netdev.h>
 #include <net/ipv4/dhcp.h>
 #include <net/netlink/netlink.h>
@@ -259,7 +264,9 @@ void kernel_entry(void)
     init_frame();           // Physical Memory Frame
     page_init();            // Standard 4-Level Page Table
     init_heap();            // Standard Memory Heap
+    rmap_init();            // Anonymous reverse map and LRU lists
     swap_init();            // Anonymous-memory swap area manager
+    zram_init();            // Compressed in-memory swap devices
     lmodule_init();         // Limine Kernel Module
                             //
     init_serial();          // Standard RS-232 Serial Port (needs the heap)
@@ -315,6 +322,7 @@ void kernel_entry(void)
                                                                    //
     /* Process Management */                                       //
     sched_init();                                                  // Preemptive Scheduler
+    tick_init(sched_cpu_count());                                  // Tickless idle and high-resolution timers
     timer_realtime_set_ns(rtc_since_epoch() * TIMER_NSEC_PER_SEC); // Set realtime clock to current RTC time
     process_init();                                                // Process Management
     signal_init();                                                 // POSIX Signals
@@ -362,6 +370,7 @@ void kernel_entry(void)
     vt_driver_init();              // Register vt/aux tty drivers
     devtmpfs_init();               // Device Temporary File System
     /* Device Drivers */           //
+    blk_queue_init();              // Block request queues and kblockd workers
     init_ide();                    // ATA / ATAPI
     init_ahci();                   // Advanced Host Controller Interface
     nvme_init();                   // Non-Volatile Memory Express
@@ -384,6 +393,7 @@ void kernel_entry(void)
     i2c_sysfs_init();              // /sys/bus/i2c + /sys/class/i2c-dev
     usb_sysfs_init();              // /sys/bus/usb/ + /sys/bus/usb/devices/
     block_sysfs_init();            // /sys/block/{hdX,sdX,nvme*}
+    zram_sysfs_init();             // /sys/block/zramN
     tty_sysfs_init();              // /sys/class/tty/
     net_sysfs_init();              // /sys/class/net/<interface>/
     input_sysfs_init();            // /sys/class/input/eventX
@@ -417,6 +427,7 @@ void kernel_entry(void)
     usb_host_start_workers();     // Register USB host workers
     video_start_refresh_worker(); // Register display refresh worker
     timer_deferred_init();        // Register timer bottom-half processing
+    kswapd_start_worker();        // Register background page reclaim
     kernel_workers_start();       // Create every registered kernel worker
     swapper_enqueue_init();       // Finally make init runnable
                                   //
@@ -13,11 +13,13 @@
 #include <kernel/errno.h>
 #include <kernel/printk.h>
 #include <kernel/timer/timer.h>
+#include <libs/list/intrusive_list.h>
 #include <libs/std/stddef.h>
 #include <libs/std/stdint.h>
 #include <libs/std/stdlib.h>
 #include <libs/std/string.h>
 #include <mem/alloc.h>
+#include <mem/heap.h>
 #include <process/process.h>
 #include <process/sched.h>
 #include <process/task.h>
@@ -29,11 +31,16 @@
 
 /* Constants */
 
-#ifndef EPOLL_MAX_FDS
-#    define EPOLL_MAX_FDS 1024
+#ifndef EPOLL_MAX_WATCHES
+#    define EPOLL_MAX_WATCHES 65536
 #endif
-#define EPOLL_MAX_NESTS     4
-#define EPOLL_TICKS_PER_SEC TIMER_HZ
+#define EPOLL_MAX_NESTS       4
+#define EPOLL_TICKS_PER_SEC   TIMER_HZ
+#define EPOLL_HASH_MIN_BITS   4U
+#define EPOLL_HASH_MAX_BITS   16U
+#define EPOLL_HASH_MIN_SIZE   (1U << EPOLL_HASH_MIN_BITS)
+#define EPOLL_HASH_MAX_SIZE   (1U << EPOLL_HASH_MAX_BITS)
+#define EPOLL_HASH_LOAD       2U
 
 /* Internal structures */
 
@@ -42,7 +49,6 @@ typedef struct epoll_instance epoll_instance_t;
 typedef struct epoll_item {
         int                     fd;
         uint32_t                events;
-        uint32_t                revents;
         epoll_data_t            data;
         epoll_instance_t       *epi;
         int                     active;
@@ -54,12 +60,27 @@ typedef struct epoll_item {
         vfs_poll_subscription_t close_subscription;
         uint32_t                pending_events;
         bool                    target_closed;
+        struct epoll_item      *hash_next;  // interest table chain
+        ilist_node_t            ready_node; // link on epi->ready_list
+        bool                    ready;      // queued on the ready list
 } epoll_item_t;
 
+/*
+ * The interest table is a hash on fd that grows with the number of watches,
+ * and the ready list holds only items whose source signalled a change (or
+ * that were still level-ready when last reported), so epoll_wait() costs
+ * O(ready) rather than O(watched).  The ready list is fed from poll-source
+ * callbacks that may run in interrupt context, hence its own IRQ-safe lock
+ * nested inside epi->lock.
+ */
 typedef struct epoll_instance {
-        epoll_item_t    *items[EPOLL_MAX_FDS];
+        epoll_item_t   **buckets;
+        epoll_item_t    *inline_buckets[EPOLL_HASH_MIN_SIZE];
+        uint32_t         bucket_count;
         int              fd_count;
-        int              max_fd;
+        ilist_node_t     ready_list;
+        uint32_t         ready_count;
+        spinlock_t       ready_lock;
         wait_queue_t     wq;
         spinlock_t       lock;
         struct vfs_node *node;
@@ -90,12 +111,13 @@ static bool epoll_path_reaches(epoll_instance_t *start, epoll_instance_t *needle
 {
     if (start == needle) return true;
     if (depth >= EPOLL_MAX_NESTS) return true;
-    for (int fd = 0; fd <= start->max_fd; fd++) {
-        epoll_item_t *item = start->items[fd];
-        if (!item || !__atomic_load_n(&item->active, __ATOMIC_ACQUIRE)) continue;
+    for (uint32_t i = 0; i < start->bucket_count; i++) {
+        for (epoll_item_t *item = start->buckets[i]; item; item = item->hash_next) {
+            if (!__atomic_load_n(&item->active, __ATOMIC_ACQUIRE)) continue;
 
-        epoll_instance_t *child = epoll_file_instance(item->file);
-        if (child && epoll_path_reaches(child, needle, depth + 1)) return true;
+            epoll_instance_t *child = epoll_file_instance(item->file);
+            if (child && epoll_path_reaches(child, needle, depth + 1)) return true;
+        }
     }
     return false;
 }
@@ -128,23 +150,61 @@ static uint32_t epoll_map_poll_result(int poll_result, uint32_t requested)
     return revents & (requested | EPOLLERR | EPOLLHUP);
 }
 
+/*
+ * Queue an item on the ready list unless it is already there or being
+ * deleted.  Returns true if it was newly queued.  Must be called with
+ * epi->ready_lock held.
+ */
+static bool epoll_ready_queue_locked(epoll_instance_t *epi, epoll_item_t *item)
+{
+    if (item->ready || !__atomic_load_n(&item->active, __ATOMIC_ACQUIRE)) return false;
+    ilist_insert_before(&epi->ready_list, &item->ready_node);
+    item->ready = true;
+    epi->ready_count++;
+    return true;
+}
+
+/* Take an item off the ready list.  Must be called with epi->ready_lock held. */
+static void epoll_ready_unqueue_locked(epoll_instance_t *epi, epoll_item_t *item)
+{
+    if (!item->ready) return;
+    ilist_remove(&item->ready_node);
+    item->ready = false;
+    epi->ready_count--;
+}
+
+/* Queue an item as ready and wake waiters, including an outer poll of this epoll fd. */
+static void epoll_item_signal(epoll_item_t *item, uint32_t events)
+{
+    epoll_instance_t *epi = item->epi;
+
+    spin_lock(&epi->ready_lock);
+    if (!__atomic_load_n(&item->active, __ATOMIC_ACQUIRE)) {
+        spin_unlock(&epi->ready_lock);
+        return;
+    }
+    __atomic_fetch_or(&item->pending_events, events, __ATOMIC_RELEASE);
+    bool queued = epoll_ready_queue_locked(epi, item);
+    spin_unlock(&epi->ready_lock);
+
+    /* An item already on the list has a wakeup pending from when it was queued. */
+    if (!queued) return;
+    __atomic_add_fetch(&epi->event_generation, 1, __ATOMIC_RELEASE);
+    wait_queue_wake_all(&epi->wq);
+
+    /*
+     * An epoll fd is itself pollable.  libinput exposes its internal
+     * epoll fd to Xorg, which then watches it from Xorg's outer epoll.
+     * Propagate target readiness to that outer poll source as well as to
+     * threads directly blocked in epoll_wait() on this instance.
+     */
+    if (epi->node) vfs_poll_notify(epi->node, POLLIN);
+}
+
 /* Notify the epoll instance that a watched fd became ready. */
 static void epoll_item_notify(vfs_poll_subscription_t *subscription, uint32_t events)
 {
-    epoll_item_t *item = subscription->context;
-    if (__atomic_load_n(&item->active, __ATOMIC_ACQUIRE)) {
-        __atomic_fetch_or(&item->pending_events, events, __ATOMIC_RELEASE);
-        __atomic_add_fetch(&item->epi->event_generation, 1, __ATOMIC_RELEASE);
-        wait_queue_wake_all(&item->epi->wq);
-
-        /*
-         * An epoll fd is itself pollable.  libinput exposes its internal
-         * epoll fd to Xorg, which then watches it from Xorg's outer epoll.
-         * Propagate target readiness to that outer poll source as well as to
-         * threads directly blocked in epoll_wait() on this instance.
-         */
-        if (item->epi->node) vfs_poll_notify(item->epi->node, POLLIN);
-    }
+    epoll_item_signal(subscription->context, events);
 }
 
 /* Handle closure of a watched fd by publishing EPOLLHUP. */
@@ -153,18 +213,52 @@ static void epoll_target_close(vfs_poll_subscription_t *subscription, uint32_t e
     (void)events;
     epoll_item_t *item = subscription->context;
     __atomic_store_n(&item->target_closed, true, __ATOMIC_RELEASE);
-    __atomic_fetch_or(&item->pending_events, EPOLLHUP, __ATOMIC_RELEASE);
     vfs_poll_source_unsubscribe(item->event_source, &item->subscription);
-    __atomic_add_fetch(&item->epi->event_generation, 1, __ATOMIC_RELEASE);
-    wait_queue_wake_all(&item->epi->wq);
-    if (item->epi->node) vfs_poll_notify(item->epi->node, POLLIN);
+    epoll_item_signal(item, EPOLLHUP);
+}
+
+/* Hash an fd into the interest table. */
+static inline uint32_t epoll_hash(int fd, uint32_t bucket_count)
+{
+    return (uint32_t)fd & (bucket_count - 1);
 }
 
 /* Find an epoll_item by fd.  Must be called with epi->lock held. */
 static epoll_item_t *epoll_item_find(epoll_instance_t *epi, int fd)
 {
-    if (fd < 0 || fd >= EPOLL_MAX_FDS) return NULL;
-    return epi->items[fd];
+    if (fd < 0) return NULL;
+    for (epoll_item_t *item = epi->buckets[epoll_hash(fd, epi->bucket_count)]; item; item = item->hash_next)
+        if (item->fd == fd) return item;
+    return NULL;
+}
+
+/*
+ * Double the interest table once its chains pass the load factor.  Growth is
+ * best-effort: allocation failure only keeps the old valid table.  Must be
+ * called with epi->lock held.
+ */
+static void epoll_grow_hash_locked(epoll_instance_t *epi)
+{
+    if (epi->bucket_count >= EPOLL_HASH_MAX_SIZE || (uint32_t)epi->fd_count < epi->bucket_count * EPOLL_HASH_LOAD) return;
+
+    uint32_t       new_count   = epi->bucket_count << 1;
+    epoll_item_t **new_buckets = calloc(new_count, sizeof(*new_buckets)); // NOLINT(bugprone-sizeof-expression)
+    if (!new_buckets) return;
+
+    for (uint32_t i = 0; i < epi->bucket_count; i++) {
+        epoll_item_t *item = epi->buckets[i];
+        while (item) {
+            epoll_item_t *next = item->hash_next;
+            uint32_t      hash = epoll_hash(item->fd, new_count);
+            item->hash_next    = new_buckets[hash];
+            new_buckets[hash]  = item;
+            item               = next;
+        }
+    }
+
+    if (epi->buckets != epi->inline_buckets) free(epi->buckets);
+    epi->buckets      = new_buckets;
+    epi->bucket_count = new_count;
 }
 
 /*
@@ -173,8 +267,8 @@ static epoll_item_t *epoll_item_find(epoll_instance_t *epi, int fd)
  */
 static epoll_item_t *epoll_item_add(epoll_instance_t *epi, int fd, process_file_t *file, const epoll_event_t *event)
 {
-    if (fd < 0 || fd >= EPOLL_MAX_FDS) return NULL;
-    if (epi->items[fd]) return NULL; // already present
+    if (fd < 0 || epi->fd_count >= EPOLL_MAX_WATCHES) return NULL;
+    if (epoll_item_find(epi, fd)) return NULL; // already present
 
     epoll_item_t *item = malloc(sizeof(epoll_item_t));
     if (!item) {
@@ -185,7 +279,6 @@ static epoll_item_t *epoll_item_add(epoll_instance_t *epi, int fd, process_file_
 
     item->fd               = fd;
     item->events           = event->events;
-    item->revents          = 0;
     item->data             = event->data;
     item->epi              = epi;
     item->active           = 1;
@@ -193,9 +286,11 @@ static epoll_item_t *epoll_item_add(epoll_instance_t *epi, int fd, process_file_
     item->oneshot_disabled = 0;
     item->file             = file;
 
-    epi->items[fd] = item;
+    epoll_grow_hash_locked(epi);
+    uint32_t bucket      = epoll_hash(fd, epi->bucket_count);
+    item->hash_next      = epi->buckets[bucket];
+    epi->buckets[bucket] = item;
     epi->fd_count++;
-    if (fd > epi->max_fd) epi->max_fd = fd;
 
     return item;
 }
@@ -206,16 +301,21 @@ static epoll_item_t *epoll_item_add(epoll_instance_t *epi, int fd, process_file_
  */
 static epoll_item_t *epoll_item_del(epoll_instance_t *epi, int fd)
 {
-    if (fd < 0 || fd >= EPOLL_MAX_FDS) return NULL;
+    if (fd < 0) return NULL;
 
-    epoll_item_t *item = epi->items[fd];
+    epoll_item_t **link = &epi->buckets[epoll_hash(fd, epi->bucket_count)];
+    while (*link && (*link)->fd != fd) link = &(*link)->hash_next;
+    epoll_item_t *item = *link;
     if (!item) return NULL;
 
-    epi->items[fd] = NULL;
+    *link = item->hash_next;
     epi->fd_count--;
-    if (fd == epi->max_fd)
-        while (epi->max_fd >= 0 && !epi->items[epi->max_fd]) epi->max_fd--;
+
+    /* Callbacks test active under the ready lock, so none can requeue it. */
+    spin_lock(&epi->ready_lock);
     __atomic_store_n(&item->active, 0, __ATOMIC_RELEASE);
+    epoll_ready_unqueue_locked(epi, item);
+    spin_unlock(&epi->ready_lock);
     return item;
 }
 
@@ -235,112 +335,116 @@ static int epoll_item_mod(epoll_instance_t *epi, int fd, const epoll_event_t *ev
     return EOK;
 }
 
-/* Polling: check all registered fds for readiness */
+/* Readiness: only items on the ready list are examined */
 
 /*
- * Poll all registered fds and update their revents.
- * Must be called with epi->lock held.
- * Returns the number of ready fds.
+ * Compute the events to report for an item taken off the ready list,
+ * consuming edge-triggered state.  Must be called with epi->lock held.
  */
-static int epoll_poll_all(epoll_instance_t *epi)
+static uint32_t epoll_item_revents(epoll_item_t *item)
 {
-    int ready = 0;
-
-    for (int fd = 0; fd <= epi->max_fd; fd++) {
-        epoll_item_t *item = epi->items[fd];
-        if (!item || !__atomic_load_n(&item->active, __ATOMIC_ACQUIRE)) continue;
-        if (__atomic_load_n(&item->target_closed, __ATOMIC_ACQUIRE)) {
-            item->revents = EPOLLHUP;
-            ready++;
-            continue;
-        }
-
-        /* Skip one-shot items that have been disabled after reporting */
-        if (item->oneshot_disabled) continue;
-
-        int      poll_result = process_file_poll(item->file, (size_t)(item->events | POLLERR | POLLHUP));
-        uint32_t current     = epoll_map_poll_result(poll_result, item->events);
-
-        if (item->events & EPOLLET) {
-            /*
-             * Edge-triggered: only report events that transitioned
-             * from not-ready to ready since the last poll.
-             */
-            uint32_t changed = __atomic_exchange_n(&item->pending_events, 0, __ATOMIC_ACQ_REL);
-            item->last_revents &= ~changed;
-            uint32_t new_ready = current & ~item->last_revents;
-            item->last_revents = current;
-
-            /*
-             * Preserve an edge that was found by an earlier scan but could
-             * not be returned because maxevents was already exhausted.
-             */
-            item->revents |= new_ready;
-        } else {
-            /* Level-triggered: report all currently ready events */
-            item->revents = current;
-        }
-
-        if (item->revents) ready++;
-    }
-
-    return ready;
+    if (__atomic_load_n(&item->target_closed, __ATOMIC_ACQUIRE)) return EPOLLHUP;
+
+    /* Skip one-shot items that have been disabled after reporting */
+    if (item->oneshot_disabled) return 0;
+
+    int      poll_result = process_file_poll(item->file, (size_t)(item->events | POLLERR | POLLHUP));
+    uint32_t current     = epoll_map_poll_result(poll_result, item->events);
+    if (!(item->events & EPOLLET)) return current; // level-triggered: report all currently ready events
+
+    /*
+     * Edge-triggered: only report events that transitioned from not-ready
+     * to ready since the last report.
+     */
+    uint32_t changed = __atomic_exchange_n(&item->pending_events, 0, __ATOMIC_ACQ_REL);
+    item->last_revents &= ~changed;
+    uint32_t new_ready = current & ~item->last_revents;
+    item->last_revents = current;
+    return new_ready;
 }
 
 /*
  * Check whether an epoll fd is readable without consuming edge state.
  * This is used when the epoll fd is itself watched by poll or another epoll
  * instance (libinput's epoll fd inside Xorg's epoll).  Only epoll_wait() may
- * exchange pending_events and advance last_revents.
+ * exchange pending_events and advance last_revents.  Must be called with
+ * epi->lock held, which keeps queued items linked; callbacks only append.
  */
 static bool epoll_has_ready(epoll_instance_t *epi)
 {
-    for (int fd = 0; fd <= epi->max_fd; fd++) {
-        epoll_item_t *item = epi->items[fd];
-        if (!item || !__atomic_load_n(&item->active, __ATOMIC_ACQUIRE) || item->oneshot_disabled) continue;
-        if (__atomic_load_n(&item->target_closed, __ATOMIC_ACQUIRE) || item->revents) return true;
-
-        int      poll_result = process_file_poll(item->file, (size_t)(item->events | POLLERR | POLLHUP));
-        uint32_t current     = epoll_map_poll_result(poll_result, item->events);
-        if (!(item->events & EPOLLET)) {
-            if (current) return true;
-            continue;
+    spin_lock(&epi->ready_lock);
+    ilist_node_t *node = epi->ready_list.next;
+    spin_unlock(&epi->ready_lock);
+
+    while (node != &epi->ready_list) {
+        epoll_item_t *item = container_of(node, epoll_item_t, ready_node);
+        if (__atomic_load_n(&item->target_closed, __ATOMIC_ACQUIRE)) return true;
+        if (!item->oneshot_disabled) {
+            int      poll_result = process_file_poll(item->file, (size_t)(item->events | POLLERR | POLLHUP));
+            uint32_t current     = epoll_map_poll_result(poll_result, item->events);
+            if (!(item->events & EPOLLET)) {
+                if (current) return true;
+            } else {
+                uint32_t pending  = __atomic_load_n(&item->pending_events, __ATOMIC_ACQUIRE);
+                uint32_t observed = item->last_revents & ~pending;
+                if (current & ~observed) return true;
+            }
         }
 
-        uint32_t pending  = __atomic_load_n(&item->pending_events, __ATOMIC_ACQUIRE);
-        uint32_t observed = item->last_revents & ~pending;
-        if (current & ~observed) return true;
+        spin_lock(&epi->ready_lock);
+        node = node->next;
+        spin_unlock(&epi->ready_lock);
     }
     return false;
 }
 
 /*
- * Collect ready events from the epoll set and copy them to user space.
- * Must be called with epi->lock held.
+ * Report ready items to user space, visiting each item that was queued on
+ * entry at most once.  Level-triggered items that reported events go back
+ * on the tail, as on Linux, so they are rechecked on the next call and
+ * cannot starve the rest of the list.  Must be called with epi->lock held.
  * Returns number of events collected (0..maxevents), or -EFAULT on copy error.
  */
 static int epoll_collect_events(epoll_instance_t *epi, epoll_event_t *user_events, int maxevents)
 {
     int collected = 0;
 
-    for (int fd = 0; fd <= epi->max_fd && collected < maxevents; fd++) {
-        epoll_item_t *item = epi->items[fd];
-        if (!item || !item->active) continue;
-        if (item->revents == 0) continue;
+    spin_lock(&epi->ready_lock);
+    uint32_t budget = epi->ready_count;
+    spin_unlock(&epi->ready_lock);
 
-        epoll_event_t ev;
-        ev.events = item->revents;
-        ev.data   = item->data;
+    while (budget-- && collected < maxevents) {
+        spin_lock(&epi->ready_lock);
+        if (ilist_is_empty(&epi->ready_list)) {
+            spin_unlock(&epi->ready_lock);
+            break;
+        }
+        epoll_item_t *item = container_of(epi->ready_list.next, epoll_item_t, ready_node);
+        epoll_ready_unqueue_locked(epi, item);
+        spin_unlock(&epi->ready_lock);
 
-        if (copy_to_user(&user_events[collected], &ev, sizeof(epoll_event_t))) return -EFAULT;
+        uint32_t revents = epoll_item_revents(item);
+        if (!revents) continue;
 
+        epoll_event_t ev;
+        ev.events = revents;
+        ev.data   = item->data;
+        if (copy_to_user(&user_events[collected], &ev, sizeof(epoll_event_t))) {
+            spin_lock(&epi->ready_lock);
+            epoll_ready_queue_locked(epi, item);
+            spin_unlock(&epi->ready_lock);
+            return collected ? collected : -EFAULT;
+        }
         collected++;
 
         /* Handle EPOLLONESHOT: disable this fd after reporting */
-        if (item->events & EPOLLONESHOT) item->oneshot_disabled = 1;
-
-        /* Clear revents for level-triggered; edge-triggered already cleared */
-        item->revents = 0;
+        if (item->events & EPOLLONESHOT) {
+            item->oneshot_disabled = 1;
+        } else if (!(item->events & EPOLLET) || __atomic_load_n(&item->target_closed, __ATOMIC_ACQUIRE)) {
+            spin_lock(&epi->ready_lock);
+            epoll_ready_queue_locked(epi, item);
+            spin_unlock(&epi->ready_lock);
+        }
     }
 
     return collected;
@@ -419,15 +523,35 @@ static int epoll_vfs_free(void *handle)
     epoll_instance_t *epi = (epoll_instance_t *)handle;
     if (!epi) return -EINVAL;
 
-    for (int fd = 0; fd <= epi->max_fd; fd++) {
-        spin_lock(&epoll_topology_lock);
-        spin_lock(&epi->lock);
-        epoll_item_t *item = epoll_item_del(epi, fd);
-        spin_unlock(&epi->lock);
-        spin_unlock(&epoll_topology_lock);
+    /* Detach every watch in one pass over the table, then release them unlocked. */
+    epoll_item_t *detached = NULL;
+    spin_lock(&epoll_topology_lock);
+    spin_lock(&epi->lock);
+    for (uint32_t i = 0; i < epi->bucket_count; i++) {
+        while (epi->buckets[i]) {
+            epoll_item_t *item = epi->buckets[i];
+            epi->buckets[i]    = item->hash_next;
+            epi->fd_count--;
+
+            spin_lock(&epi->ready_lock);
+            __atomic_store_n(&item->active, 0, __ATOMIC_RELEASE);
+            epoll_ready_unqueue_locked(epi, item);
+            spin_unlock(&epi->ready_lock);
+
+            item->hash_next = detached;
+            detached        = item;
+        }
+    }
+    spin_unlock(&epi->lock);
+    spin_unlock(&epoll_topology_lock);
+
+    while (detached) {
+        epoll_item_t *item = detached;
+        detached           = item->hash_next;
         epoll_item_release(item);
     }
 
+    if (epi->buckets != epi->inline_buckets) free(epi->buckets);
     free(epi);
     return EOK;
 }
@@ -508,9 +632,11 @@ static vfs_node_t epoll_node_create(void)
     }
     memset(epi, 0, sizeof(epoll_instance_t));
 
-    epi->fd_count = 0;
-    epi->max_fd   = -1;
-    epi->refcount = 1;
+    epi->buckets      = epi->inline_buckets;
+    epi->bucket_count = EPOLL_HASH_MIN_SIZE;
+    epi->fd_count     = 0;
+    epi->refcount     = 1;
+    ilist_init(&epi->ready_list);
     wait_queue_init(&epi->wq);
 
     vfs_node_t node = vfs_node_alloc(NULL, "[epoll]");
@@ -655,9 +781,13 @@ int64_t sys_epoll_ctl(int epfd, int op, int fd, epoll_event_t *event)
 
             epoll_item_t *old = epoll_item_find(epi, fd);
             if (old && __atomic_load_n(&old->target_closed, __ATOMIC_ACQUIRE)) release = epoll_item_del(epi, fd);
+            if (!old && epi->fd_count >= EPOLL_MAX_WATCHES) {
+                ret = -ENOSPC;
+                break;
+            }
             epoll_item_t *item = epoll_item_add(epi, fd, target, &ev);
             if (!item) {
-                ret = -EEXIST;
+                ret = old && !release ? -EEXIST : -ENOMEM;
                 break;
             }
             target             = NULL;
@@ -668,12 +798,14 @@ int64_t sys_epoll_ctl(int epfd, int op, int fd, epoll_event_t *event)
             /* Poll immediately for initial readiness */
             int      poll_result = process_file_poll(item->file, (size_t)(item->events | POLLERR | POLLHUP));
             uint32_t current     = epoll_map_poll_result(poll_result, item->events);
-            item->last_revents   = 0;
-            item->pending_events = current;
-            item->revents        = current;
-
-            /* Wake any waiters if this fd is immediately ready */
-            if (item->revents) {
+            item->last_revents = 0;
+
+            /* Queue the item and wake any waiters if this fd is immediately ready */
+            if (current) {
+                spin_lock(&epi->ready_lock);
+                __atomic_fetch_or(&item->pending_events, current, __ATOMIC_RELEASE);
+                epoll_ready_queue_locked(epi, item);
+                spin_unlock(&epi->ready_lock);
                 __atomic_add_fetch(&epi->event_generation, 1, __ATOMIC_RELEASE);
                 wait_queue_wake_all(&epi->wq);
                 publish_ready = true;
@@ -703,28 +835,28 @@ int64_t sys_epoll_ctl(int epfd, int op, int fd, epoll_event_t *event)
             if (ret != EOK) break;
 
             /* Re-poll for readiness after modification */
-            int      poll_result = process_file_poll(epi->items[fd]->file, (size_t)(ev.events | POLLERR | POLLHUP));
-            uint32_t current     = epoll_map_poll_result(poll_result, ev.events);
-
-            epoll_item_t *item = epoll_item_find(epi, fd);
-            if (item) {
-                /*
-                 * EPOLL_CTL_MOD re-arms the descriptor.  In particular,
-                 * users such as Xorg add an EPOLLET fd with no read/write
-                 * interest and then enable EPOLLIN after data may already
-                 * have arrived.  Treat readiness observed during MOD as a
-                 * fresh edge; recording it in last_revents here would make
-                 * the following epoll_wait silently consume that edge.
-                 */
-                item->last_revents = 0;
-                __atomic_store_n(&item->pending_events, current, __ATOMIC_RELEASE);
-                item->revents = current;
-
-                if (item->revents) {
-                    __atomic_add_fetch(&epi->event_generation, 1, __ATOMIC_RELEASE);
-                    wait_queue_wake_all(&epi->wq);
-                    publish_ready = true;
-                }
+            epoll_item_t *item        = epoll_item_find(epi, fd);
+            int           poll_result = process_file_poll(item->file, (size_t)(ev.events | POLLERR | POLLHUP));
+            uint32_t      current     = epoll_map_poll_result(poll_result, ev.events);
+
+            /*
+             * EPOLL_CTL_MOD re-arms the descriptor.  In particular,
+             * users such as Xorg add an EPOLLET fd with no read/write
+             * interest and then enable EPOLLIN after data may already
+             * have arrived.  Treat readiness observed during MOD as a
+             * fresh edge; recording it in last_revents here would make
+             * the following epoll_wait silently consume that edge.
+             */
+            item->last_revents = 0;
+            __atomic_store_n(&item->pending_events, current, __ATOMIC_RELEASE);
+
+            if (current) {
+                spin_lock(&epi->ready_lock);
+                epoll_ready_queue_locked(epi, item);
+                spin_unlock(&epi->ready_lock);
+                __atomic_add_fetch(&epi->event_generation, 1, __ATOMIC_RELEASE);
+                wait_queue_wake_all(&epi->wq);
+                publish_ready = true;
             }
 
             ret = EOK;
@@ -772,12 +904,10 @@ int64_t sys_epoll_wait(int epfd, epoll_event_t *events, int maxevents, int timeo
     for (;;) {
         uint64_t generation = __atomic_load_n(&epi->event_generation, __ATOMIC_ACQUIRE);
 
-        /* Poll all registered fds */
-        int ready = epoll_poll_all(epi);
-
-        if (ready > 0) {
-            /* Collect events into user buffer */
-            ret = epoll_collect_events(epi, events, maxevents);
+        /* Report whatever the ready list holds */
+        int collected = epoll_collect_events(epi, events, maxevents);
+        if (collected != 0) {
+            ret = collected;
             break;
         }
 
@@ -897,5 +1027,5 @@ void epoll_init(void)
         return;
     }
 
-    plogk("epoll: Epoll subsystem registered (fsid=%d, max_fds=%d)\n", epoll_fsid, EPOLL_MAX_FDS);
+    plogk("epoll: Epoll subsystem registered (fsid=%d, max_watches=%d)\n", epoll_fsid, EPOLL_MAX_WATCHES);
 }
@@ -8,6 +8,7 @@
  *
  */
 
+#include <arch/smp.h>
 #include <ipc/futex.h>
 #include <kernel/debug/debug.h>
 #include <kernel/errno.h>
@@ -19,6 +20,7 @@
 #include <libs/std/string.h>
 #include <mem/alloc.h>
 #include <mem/page.h>
+#include <mem/page_walker.h>
 #include <process/process.h>
 #include <process/sched.h>
 #include <process/task.h>
@@ -29,23 +31,13 @@
 
 /* Constants */
 
+/* Boot-time table size and floor; futex_init() scales it with the CPU count. */
 #ifndef FUTEX_HASH_BITS
 #    define FUTEX_HASH_BITS 8
 #endif
-#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
-
-#define FUTEX_TICKS_PER_SEC TIMER_HZ
-#define FUTEX_NSEC_PER_TICK TIMER_TICK_NS
-
-/* The syscall clock layer may provide the realtime clock in scheduler ticks. */
-#ifndef FUTEX_REALTIME_TICKS
-__attribute__((weak)) uint64_t futex_realtime_ticks(void)
-{
-    int64_t ns = timer_realtime_ns();
-    return ns > 0 ? (uint64_t)ns / TIMER_TICK_NS : 0;
-}
-#    define FUTEX_REALTIME_TICKS() futex_realtime_ticks()
-#endif
+#define FUTEX_HASH_SIZE    (1 << FUTEX_HASH_BITS)
+#define FUTEX_HASH_PER_CPU 256
+#define FUTEX_KEY_SHARED   1 // tags a physical-frame key space
 
 /* FUTEX_WAKE_OP operation codes */
 #define FUTEX_OP_SET  0
@@ -64,8 +56,19 @@ __attribute__((weak)) uint64_t futex_realtime_ticks(void)
 
 /* Type definitions */
 
+/*
+ * Futex identity.  Private futexes are (address space, user address);
+ * a futex in a shared mapping is (physical frame, offset in the page), so
+ * every process mapping that page - page cache included - meets the same
+ * waiters.  Frame keys carry FUTEX_KEY_SHARED in the low bit of space.
+ */
+typedef struct futex_key {
+        uintptr_t space;
+        uintptr_t offset;
+} futex_key_t;
+
 typedef struct futex_entry {
-        uintptr_t           key;
+        futex_key_t         key;
         uint64_t            bitset; // mask/bitset: classic FUTEX_WAIT_BITSET or futex2 mask
         wait_queue_t        wq;
         struct futex_entry *next;
@@ -79,13 +82,14 @@ typedef struct futex_bucket {
 
 /* Static state */
 
-static futex_bucket_t futex_hash[FUTEX_HASH_SIZE];
+static futex_bucket_t  futex_hash_boot[FUTEX_HASH_SIZE];
+static futex_bucket_t *futex_hash      = futex_hash_boot;
+static uint32_t        futex_hash_mask = FUTEX_HASH_SIZE - 1;
 
 #define FUTEX_WAITV_MAX 128U
 
 typedef struct futex_waitv_registration {
-        process_t                       *owner;
-        struct futex_waitv              *waiters;
+        futex_key_t                     *keys;
         uint32_t                         count;
         int                              woken_index;
         bool                             registered;
@@ -107,18 +111,23 @@ static bool futex_signal_pending(void)
     return pending;
 }
 
-/* Wake registered vector waiters on this address, up to the caller's limit. */
-static int futex_waitv_notify(uintptr_t key, int max_wake)
+/* True when two keys name the same futex. */
+static inline bool futex_key_equal(const futex_key_t *a, const futex_key_t *b)
+{
+    return a->space == b->space && a->offset == b->offset;
+}
+
+/* Wake registered vector waiters on this key, up to the caller's limit. */
+static int futex_waitv_notify(const futex_key_t *key, int max_wake)
 {
     if (max_wake <= 0) return 0;
 
-    process_t *owner = process_current();
-    int        woken = 0;
+    int woken = 0;
     spin_lock(&futex_waitv_notify_lock);
     for (futex_waitv_registration_t *registration = futex_waitv_registrations; registration && woken < max_wake; registration = registration->next) {
-        if (!registration->registered || registration->woken_index >= 0 || registration->owner != owner) continue;
+        if (!registration->registered || registration->woken_index >= 0) continue;
         for (uint32_t i = 0; i < registration->count; i++) {
-            if ((uintptr_t)registration->waiters[i].uaddr != key) continue;
+            if (!futex_key_equal(&registration->keys[i], key)) continue;
             registration->woken_index = (int)i;
             wait_queue_wake_all(&registration->wq);
             woken++;
@@ -129,22 +138,71 @@ static int futex_waitv_notify(uintptr_t key, int max_wake)
     return woken;
 }
 
-/* Hash a user address into a bucket index. */
-static inline uint32_t futex_hash_index(uint32_t *uaddr)
+/*
+ * Build the key for uaddr.  Private futexes skip the page tables.  Otherwise
+ * the word is faulted in and its leaf inspected: a PTE_SHARED mapping gives
+ * a frame key, anything else the private key, as Linux does for private
+ * anonymous memory.
+ */
+static int futex_get_key(const void *uaddr, int private_futex, futex_key_t *key)
+{
+    process_t *proc = process_current();
+    if (!proc) return -ESRCH;
+
+    page_directory_t *directory = proc->user_page_dir;
+    key->space                  = directory ? (uintptr_t)directory : (uintptr_t)proc;
+    key->offset                 = (uintptr_t)uaddr;
+    if (private_futex || !directory) return 0;
+
+    /* Retry once if the page is reclaimed between the fault-in and the walk. */
+    for (int attempt = 0; attempt < 2; attempt++) {
+        uint8_t probe;
+        if (copy_from_user(&probe, uaddr, sizeof(probe)) != 0) return -EFAULT;
+
+        page_walk_state_t state;
+        uint64_t          leaf = 0;
+        spin_lock(&directory->lock);
+        page_walk_init(&state, directory, (uintptr_t)uaddr);
+        if (page_walk_execute(&state)) {
+            if (state.page_size == 2)
+                leaf = state.l3_table->entries[state.l3_index].value;
+            else if (state.page_size == 1)
+                leaf = state.l2_table->entries[state.l2_index].value;
+            else
+                leaf = state.l1_table->entries[state.l1_index].value;
+        }
+        spin_unlock(&directory->lock);
+        if (!(leaf & PTE_PRESENT)) continue;
+        if (leaf & PTE_SHARED) {
+            key->space  = (state.physical_addr & ~(uintptr_t)(PAGE_4K_SIZE - 1)) | FUTEX_KEY_SHARED;
+            key->offset = (uintptr_t)uaddr & (PAGE_4K_SIZE - 1);
+        }
+        return 0;
+    }
+    return -EFAULT;
+}
+
+/* Mix both key words (murmur3 finalizer) so neighbouring words spread across buckets. */
+static inline futex_bucket_t *futex_bucket(const futex_key_t *key)
 {
-    return ((uintptr_t)uaddr >> 2) & (FUTEX_HASH_SIZE - 1);
+    uint64_t hash = (uint64_t)key->space ^ ((uint64_t)key->offset * 0x9e3779b97f4a7c15ULL);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return &futex_hash[hash & futex_hash_mask];
 }
 
 /*
- * Find an entry for uaddr in the given bucket (no creation).
+ * Find an entry for key in the given bucket (no creation).
  * Must be called with the bucket lock held.
  * Returns NULL if no entry exists.
  */
-static futex_entry_t *futex_find(futex_bucket_t *bucket, uint32_t *uaddr)
+static futex_entry_t *futex_find(futex_bucket_t *bucket, const futex_key_t *key)
 {
-    uintptr_t key = (uintptr_t)uaddr;
     for (futex_entry_t *entry = bucket->head; entry; entry = entry->next)
-        if (entry->key == key) return entry;
+        if (futex_key_equal(&entry->key, key)) return entry;
     return NULL;
 }
 
@@ -155,9 +213,9 @@ static futex_entry_t *futex_find(futex_bucket_t *bucket, uint32_t *uaddr)
  * If the entry already exists, its bitset is OR-ed with the new bitset
  * so that all waiters on the same futex can be woken by a matching wake.
  */
-static futex_entry_t *futex_find_or_create(futex_bucket_t *bucket, uint32_t *uaddr, uint64_t bitset)
+static futex_entry_t *futex_find_or_create(futex_bucket_t *bucket, const futex_key_t *key, uint64_t bitset)
 {
-    futex_entry_t *entry = futex_find(bucket, uaddr);
+    futex_entry_t *entry = futex_find(bucket, key);
     if (entry) {
         entry->bitset |= bitset;
         return entry;
@@ -165,11 +223,11 @@ static futex_entry_t *futex_find_or_create(futex_bucket_t *bucket, uint32_t *uad
 
     entry = (futex_entry_t *)malloc(sizeof(futex_entry_t));
     if (!entry) {
-        plogk("futex: Entry allocation failed for %p\n", (void *)uaddr);
+        plogk("futex: Entry allocation failed for %#lx\n", (unsigned long)key->offset);
         return NULL;
     }
 
-    entry->key      = (uintptr_t)uaddr;
+    entry->key      = *key;
     entry->bitset   = bitset;
     entry->pi_mutex = NULL;
     wait_queue_init(&entry->wq);
@@ -179,29 +237,27 @@ static futex_entry_t *futex_find_or_create(futex_bucket_t *bucket, uint32_t *uad
     return entry;
 }
 
-/* Find a waiter entry matching the exact address and bitset. */
-static futex_entry_t *futex_find_waiter(futex_bucket_t *bucket, uint32_t *uaddr, uint64_t bitset)
+/* Find a waiter entry matching the exact key and bitset. */
+static futex_entry_t *futex_find_waiter(futex_bucket_t *bucket, const futex_key_t *key, uint64_t bitset)
 {
-    uintptr_t key = (uintptr_t)uaddr;
-
     for (futex_entry_t *entry = bucket->head; entry; entry = entry->next)
-        if (entry->key == key && entry->bitset == bitset && !entry->pi_mutex) return entry;
+        if (futex_key_equal(&entry->key, key) && entry->bitset == bitset && !entry->pi_mutex) return entry;
     return NULL;
 }
 
 /* Separate queues per bitset make WAKE_BITSET selection exact. */
-static futex_entry_t *futex_create_waiter(futex_bucket_t *bucket, uint32_t *uaddr, uint64_t bitset)
+static futex_entry_t *futex_create_waiter(futex_bucket_t *bucket, const futex_key_t *key, uint64_t bitset)
 {
-    futex_entry_t *entry = futex_find_waiter(bucket, uaddr, bitset);
+    futex_entry_t *entry = futex_find_waiter(bucket, key, bitset);
     if (entry) return entry;
 
     entry = (futex_entry_t *)malloc(sizeof(futex_entry_t));
     if (!entry) {
-        plogk("futex: Waiter allocation failed for %p\n", (void *)uaddr);
+        plogk("futex: Waiter allocation failed for %#lx\n", (unsigned long)key->offset);
         return NULL;
     }
 
-    entry->key      = (uintptr_t)uaddr;
+    entry->key      = *key;
     entry->bitset   = bitset;
     entry->pi_mutex = NULL;
     wait_queue_init(&entry->wq);
@@ -263,47 +319,37 @@ static int futex_try_cleanup(futex_bucket_t *bucket, futex_entry_t *entry)
     return 0;
 }
 
-/* Convert a validated user-space timespec to scheduler ticks. */
-typedef struct {
-        int64_t tv_sec;
-        int64_t tv_nsec;
-} futex_timespec_t;
-
-static int futex_read_timespec(uint64_t timeout_ptr, uint64_t *ticks)
+/* Convert a validated user-space timespec to nanoseconds. */
+static int futex_read_timespec(uint64_t timeout_ptr, uint64_t *ns)
 {
-    futex_timespec_t ts;
-    uint64_t         nsec_ticks;
+    timer_timespec_t ts;
 
     if (copy_from_user(&ts, (const void *)timeout_ptr, sizeof(ts)) != 0) return -EFAULT;
-    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000LL) return -EINVAL;
-    if ((uint64_t)ts.tv_sec > UINT64_MAX / FUTEX_TICKS_PER_SEC) return -EINVAL;
-
-    *ticks     = (uint64_t)ts.tv_sec * FUTEX_TICKS_PER_SEC;
-    nsec_ticks = ((uint64_t)ts.tv_nsec + FUTEX_NSEC_PER_TICK - 1) / FUTEX_NSEC_PER_TICK;
-    if (nsec_ticks > UINT64_MAX - *ticks) return -EINVAL;
-    *ticks += nsec_ticks;
-    return 0;
+    return timer_timespec_to_ns(&ts, ns) ? 0 : -EINVAL;
 }
 
-/* Return the current tick count on the selected clock. */
-static uint64_t futex_clock_ticks(int realtime)
+/* Return the current time on the selected clock in nanoseconds. */
+static uint64_t futex_clock_ns(int realtime)
 {
-    if (realtime) return FUTEX_REALTIME_TICKS();
-    return sched_ticks();
+    if (realtime) {
+        int64_t ns = timer_realtime_ns();
+        return ns > 0 ? (uint64_t)ns : 0;
+    }
+    return timer_monotonic_ns();
 }
 
-/* Convert a relative/absolute timeout to an absolute scheduler-tick deadline. */
-static uint64_t futex_deadline(uint64_t ticks, int absolute, int realtime)
+/* Convert a relative/absolute timeout to an absolute CLOCK_MONOTONIC deadline. */
+static uint64_t futex_deadline(uint64_t ns, int absolute, int realtime)
 {
-    uint64_t now = sched_ticks();
+    uint64_t now = timer_monotonic_ns();
 
-    if (!absolute) return ticks > UINT64_MAX - now ? UINT64_MAX : now + ticks;
-    if (!realtime) return ticks;
+    if (!absolute) return ns > UINT64_MAX - now ? UINT64_MAX : now + ns;
+    if (!realtime) return ns;
 
-    uint64_t realtime_now = futex_clock_ticks(1);
-    if (ticks <= realtime_now) return now;
-    ticks -= realtime_now;
-    return ticks > UINT64_MAX - now ? UINT64_MAX : now + ticks;
+    uint64_t realtime_now = futex_clock_ns(1);
+    if (ns <= realtime_now) return now;
+    ns -= realtime_now;
+    return ns > UINT64_MAX - now ? UINT64_MAX : now + ns;
 }
 
 /*
@@ -314,15 +360,19 @@ static uint64_t futex_deadline(uint64_t ticks, int absolute, int realtime)
  * bitset is the mask of bits that must match for wakeup;
  * FUTEX_BITSET_MATCH_ANY (0xffffffff) matches any wake.
  */
-static int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t timeout, uint64_t bitset, int absolute, int realtime)
+static int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t timeout, uint64_t bitset, int absolute, int realtime, int private_futex)
 {
-    futex_bucket_t *bucket = &futex_hash[futex_hash_index(uaddr)];
+    futex_bucket_t *bucket;
     futex_entry_t  *entry;
+    futex_key_t     key;
     uint32_t        cur_val;
     uint64_t        deadline = 0;
     int             ret;
 
     if (bitset == 0) return -EINVAL;
+    ret = futex_get_key(uaddr, private_futex, &key);
+    if (ret) return ret;
+    bucket = futex_bucket(&key);
     if (timeout) {
         ret = futex_read_timespec(timeout, &deadline);
         if (ret) return ret;
@@ -339,7 +389,7 @@ static int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t timeout, uint64_t
         return -EAGAIN;
     }
 
-    entry = futex_create_waiter(bucket, uaddr, bitset);
+    entry = futex_create_waiter(bucket, &key, bitset);
     if (!entry) {
         spin_unlock(&bucket->lock);
         return -ENOMEM;
@@ -352,7 +402,7 @@ static int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t timeout, uint64_t
         ret = -ERESTARTSYS;
     } else {
         if (timeout)
-            ret = wait_queue_wait_timed(&entry->wq, deadline);
+            ret = wait_queue_wait_deadline(&entry->wq, deadline);
         else {
             wait_queue_sleep();
             ret = 0;
@@ -361,7 +411,7 @@ static int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t timeout, uint64_t
     }
 
     spin_lock(&bucket->lock);
-    entry = futex_find_waiter(bucket, uaddr, bitset);
+    entry = futex_find_waiter(bucket, &key, bitset);
     futex_try_cleanup(bucket, entry);
     spin_unlock(&bucket->lock);
     return ret;
@@ -372,19 +422,23 @@ static int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t timeout, uint64_t
  * Only wake tasks whose bitset matches the wake bitset.
  * Returns the number of tasks actually woken.
  */
-int futex_wake(uint32_t *uaddr, int nr_wake, uint64_t bitset)
+int futex_wake(uint32_t *uaddr, int nr_wake, uint64_t bitset, int flags)
 {
-    futex_bucket_t *bucket = &futex_hash[futex_hash_index(uaddr)];
+    futex_bucket_t *bucket;
     futex_entry_t  *entry;
+    futex_key_t     key;
     int             woken = 0;
 
     if (bitset == 0) return -EINVAL;
     if (nr_wake <= 0) return 0;
+    int ret = futex_get_key(uaddr, flags & FUTEX_PRIVATE_FLAG, &key);
+    if (ret) return ret;
+    bucket = futex_bucket(&key);
 
     spin_lock(&bucket->lock);
 
     for (entry = bucket->head; entry; entry = entry->next) {
-        if (entry->key != (uintptr_t)uaddr) continue;
+        if (!futex_key_equal(&entry->key, &key)) continue;
 
         /*
          * bitset filtering: only wake tasks whose bitset
@@ -408,7 +462,7 @@ int futex_wake(uint32_t *uaddr, int nr_wake, uint64_t bitset)
      */
 
     spin_unlock(&bucket->lock);
-    woken += futex_waitv_notify((uintptr_t)uaddr, nr_wake - woken);
+    woken += futex_waitv_notify(&key, nr_wake - woken);
     return woken;
 }
 
@@ -476,10 +530,16 @@ static int futex_move_waiter(wait_queue_t *wq_src, wait_queue_t *wq_dst)
  * nr_requeue waiters from uaddr to uaddr2 without waking them.
  * Returns the number of tasks woken.
  */
-static int futex_requeue(uint32_t *uaddr, int nr_wake, int nr_requeue, uint32_t *uaddr2, uint32_t val3, int cmp_requeue)
+static int futex_requeue(uint32_t *uaddr, int nr_wake, int nr_requeue, uint32_t *uaddr2, uint32_t val3, int cmp_requeue, int private_futex)
 {
-    futex_bucket_t *bucket1  = &futex_hash[futex_hash_index(uaddr)];
-    futex_bucket_t *bucket2  = &futex_hash[futex_hash_index(uaddr2)];
+    futex_key_t key1;
+    futex_key_t key2;
+    int         ret = futex_get_key(uaddr, private_futex, &key1);
+    if (!ret) ret = futex_get_key(uaddr2, private_futex, &key2);
+    if (ret) return ret;
+
+    futex_bucket_t *bucket1  = futex_bucket(&key1);
+    futex_bucket_t *bucket2  = futex_bucket(&key2);
     futex_entry_t  *entry1   = NULL;
     futex_entry_t  *entry2   = NULL;
     int             woken    = 0;
@@ -501,8 +561,7 @@ static int futex_requeue(uint32_t *uaddr, int nr_wake, int nr_requeue, uint32_t
     }
 
     /* Find entry for uaddr */
-    for (entry1 = bucket1->head; entry1; entry1 = entry1->next)
-        if (entry1->key == (uintptr_t)uaddr) break;
+    entry1 = futex_find(bucket1, &key1);
     if (!entry1) {
         if (bucket1 != bucket2) spin_unlock(&bucket2->lock);
         spin_unlock(&bucket1->lock);
@@ -535,7 +594,7 @@ static int futex_requeue(uint32_t *uaddr, int nr_wake, int nr_requeue, uint32_t
     /* Requeue up to nr_requeue tasks to uaddr2 */
     if (nr_requeue > 0) {
         /* Find or create entry for uaddr2 */
-        entry2 = futex_find_or_create(bucket2, uaddr2, FUTEX_BITSET_MATCH_ANY);
+        entry2 = futex_find_or_create(bucket2, &key2, FUTEX_BITSET_MATCH_ANY);
         if (!entry2) {
             futex_try_cleanup(bucket1, entry1);
             if (bucket1 != bucket2) {
@@ -618,10 +677,16 @@ static int futex_wake_op_cmp(uint32_t old_val, uint32_t cmp, uint32_t cmparg)
  * waiters on uaddr.  If the comparison condition matches the old value
  * at uaddr2, also wake waiters on uaddr2.
  */
-static int futex_wake_op(uint32_t *uaddr, int nr_wake, int nr_wake2, uint32_t *uaddr2, uint32_t val3)
+static int futex_wake_op(uint32_t *uaddr, int nr_wake, int nr_wake2, uint32_t *uaddr2, uint32_t val3, int private_futex)
 {
-    futex_bucket_t *bucket1 = &futex_hash[futex_hash_index(uaddr)];
-    futex_bucket_t *bucket2 = &futex_hash[futex_hash_index(uaddr2)];
+    futex_key_t key1;
+    futex_key_t key2;
+    int         ret = futex_get_key(uaddr, private_futex, &key1);
+    if (!ret) ret = futex_get_key(uaddr2, private_futex, &key2);
+    if (ret) return ret;
+
+    futex_bucket_t *bucket1 = futex_bucket(&key1);
+    futex_bucket_t *bucket2 = futex_bucket(&key2);
     futex_entry_t  *entry1  = NULL;
     futex_entry_t  *entry2  = NULL;
     uint32_t        op      = (val3 >> 12) & 0xf;
@@ -665,7 +730,7 @@ static int futex_wake_op(uint32_t *uaddr, int nr_wake, int nr_wake2, uint32_t *u
 
     /* Wake nr_wake tasks from uaddr */
     for (entry1 = bucket1->head; entry1; entry1 = entry1->next) {
-        if (entry1->key != (uintptr_t)uaddr) continue;
+        if (!futex_key_equal(&entry1->key, &key1)) continue;
 
         while (woken < nr_wake) {
             task_t *task = wait_queue_wake_one(&entry1->wq);
@@ -678,7 +743,7 @@ static int futex_wake_op(uint32_t *uaddr, int nr_wake, int nr_wake2, uint32_t *u
     /* If comparison matches, wake nr_wake2 tasks from uaddr2 */
     if (cmp_result && nr_wake2 > 0) {
         for (entry2 = bucket2->head; entry2; entry2 = entry2->next) {
-            if (entry2->key != (uintptr_t)uaddr2) continue;
+            if (!futex_key_equal(&entry2->key, &key2)) continue;
 
             int woken2 = 0;
             while (woken2 < nr_wake2) {
@@ -705,9 +770,9 @@ static int futex_wake_op(uint32_t *uaddr, int nr_wake, int nr_wake2, uint32_t *u
  * Get or create a rt_mutex for the given futex word.
  * Must be called with the bucket lock held.
  */
-static rt_mutex_t *futex_get_pi_mutex(futex_bucket_t *bucket, uint32_t *uaddr)
+static rt_mutex_t *futex_get_pi_mutex(futex_bucket_t *bucket, const futex_key_t *key, uint32_t *uaddr)
 {
-    futex_entry_t *entry = futex_find_or_create(bucket, uaddr, FUTEX_BITSET_MATCH_ANY);
+    futex_entry_t *entry = futex_find_or_create(bucket, key, FUTEX_BITSET_MATCH_ANY);
     if (!entry) return NULL;
 
     if (!entry->pi_mutex) {
@@ -731,17 +796,20 @@ static rt_mutex_t *futex_get_pi_mutex(futex_bucket_t *bucket, uint32_t *uaddr)
  * internally by wait_queue_* / task_wakeup).  scheduler.lock is never held
  * across an acquisition of either outer lock.
  */
-static int futex_lock_pi(uint32_t *uaddr)
+static int futex_lock_pi(uint32_t *uaddr, int private_futex)
 {
     task_t *self = current_task();
     if (!self) return -ESRCH;
 
-    futex_bucket_t *bucket = &futex_hash[futex_hash_index(uaddr)];
+    futex_key_t key;
+    int         ret = futex_get_key(uaddr, private_futex, &key);
+    if (ret) return ret;
+    futex_bucket_t *bucket = futex_bucket(&key);
 
     for (;;) {
         spin_lock(&bucket->lock);
 
-        rt_mutex_t *pi_mutex = futex_get_pi_mutex(bucket, uaddr);
+        rt_mutex_t *pi_mutex = futex_get_pi_mutex(bucket, &key, uaddr);
         if (!pi_mutex) {
             spin_unlock(&bucket->lock);
             return -ENOMEM;
@@ -850,17 +918,17 @@ static int futex_lock_pi(uint32_t *uaddr)
  * Userspace fastpath: cmpxchg(*uaddr, tid, 0) - success if no waiters.
  * Kernel slowpath (this function): wake the highest-priority waiter.
  */
-static int futex_unlock_pi(uint32_t *uaddr)
+static int futex_unlock_pi(uint32_t *uaddr, int private_futex)
 {
     task_t *self = current_task();
     if (!self) return -ESRCH;
 
-    futex_bucket_t *bucket = &futex_hash[futex_hash_index(uaddr)];
+    futex_key_t key;
+    int         ret = futex_get_key(uaddr, private_futex, &key);
+    if (ret) return ret;
+    futex_bucket_t *bucket = futex_bucket(&key);
     spin_lock(&bucket->lock);
-    futex_entry_t *entry;
-
-    for (entry = bucket->head; entry; entry = entry->next)
-        if (entry->key == (uintptr_t)uaddr) break;
+    futex_entry_t *entry = futex_find(bucket, &key);
     if (!entry || !entry->pi_mutex) {
         spin_unlock(&bucket->lock);
         return -EPERM;
@@ -924,12 +992,15 @@ static int futex_unlock_pi(uint32_t *uaddr)
 }
 
 /* FUTEX_TRYLOCK_PI: non-blocking attempt to acquire a PI mutex. */
-static int futex_trylock_pi(uint32_t *uaddr)
+static int futex_trylock_pi(uint32_t *uaddr, int private_futex)
 {
     task_t *self = current_task();
     if (!self) return -ESRCH;
 
-    futex_bucket_t *bucket = &futex_hash[futex_hash_index(uaddr)];
+    futex_key_t key;
+    int         ret = futex_get_key(uaddr, private_futex, &key);
+    if (ret) return ret;
+    futex_bucket_t *bucket = futex_bucket(&key);
     spin_lock(&bucket->lock);
 
     uint32_t cur_val;
@@ -942,7 +1013,7 @@ static int futex_trylock_pi(uint32_t *uaddr)
         return -EAGAIN;
     }
 
-    rt_mutex_t *pi_mutex = futex_get_pi_mutex(bucket, uaddr);
+    rt_mutex_t *pi_mutex = futex_get_pi_mutex(bucket, &key, uaddr);
     if (!pi_mutex) {
         spin_unlock(&bucket->lock);
         return -ENOMEM;
@@ -969,10 +1040,16 @@ static int futex_trylock_pi(uint32_t *uaddr)
  * FUTEX_CMP_REQUEUE_PI: wake some waiters from uaddr, then requeue
  * remaining waiters from uaddr to uaddr2 (a PI futex).
  */
-static int futex_cmp_requeue_pi(uint32_t *uaddr, int nr_wake, int nr_requeue, uint32_t *uaddr2, uint32_t cmpval)
+static int futex_cmp_requeue_pi(uint32_t *uaddr, int nr_wake, int nr_requeue, uint32_t *uaddr2, uint32_t cmpval, int private_futex)
 {
-    futex_bucket_t *bucket1 = &futex_hash[futex_hash_index(uaddr)];
-    futex_bucket_t *bucket2 = &futex_hash[futex_hash_index(uaddr2)];
+    futex_key_t key1;
+    futex_key_t key2;
+    int         ret = futex_get_key(uaddr, private_futex, &key1);
+    if (!ret) ret = futex_get_key(uaddr2, private_futex, &key2);
+    if (ret) return ret;
+
+    futex_bucket_t *bucket1 = futex_bucket(&key1);
+    futex_bucket_t *bucket2 = futex_bucket(&key2);
     futex_entry_t  *entry1  = NULL;
     futex_entry_t  *entry2  = NULL;
     int             woken   = 0;
@@ -986,9 +1063,7 @@ static int futex_cmp_requeue_pi(uint32_t *uaddr, int nr_wake, int nr_requeue, ui
     } else {
         spin_lock(&bucket1->lock);
     }
-    for (entry1 = bucket1->head; entry1; entry1 = entry1->next)
-        if (entry1->key == (uintptr_t)uaddr) break;
-
+    entry1 = futex_find(bucket1, &key1);
     if (!entry1) {
         if (bucket1 != bucket2) spin_unlock(&bucket2->lock);
         spin_unlock(&bucket1->lock);
@@ -1017,7 +1092,7 @@ static int futex_cmp_requeue_pi(uint32_t *uaddr, int nr_wake, int nr_requeue, ui
 
     /* Requeue remaining waiters to uaddr2 */
     if (nr_requeue > 0) {
-        entry2 = futex_find_or_create(bucket2, uaddr2, FUTEX_BITSET_MATCH_ANY);
+        entry2 = futex_find_or_create(bucket2, &key2, FUTEX_BITSET_MATCH_ANY);
         if (!entry2) {
             plogk("futex: Cmp_requeue_pi requeue entry allocation failed for %p\n", (void *)uaddr2);
             futex_try_cleanup(bucket1, entry1);
@@ -1070,6 +1145,7 @@ int64_t sys_futex(uint32_t *uaddr, int futex_op, uint32_t val, uint64_t timeout,
     int cmd           = futex_op & 0x7f;
     int flags         = futex_op & ~0x7f;
     int allowed_flags = FUTEX_PRIVATE_FLAG;
+    int private_futex = (flags & FUTEX_PRIVATE_FLAG) != 0;
 
     if (cmd == FUTEX_WAIT_BITSET || cmd == FUTEX_WAIT_REQUEUE_PI || cmd == FUTEX_LOCK_PI2) allowed_flags |= FUTEX_CLOCK_REALTIME;
     if (flags & ~allowed_flags) return -EINVAL;
@@ -1079,22 +1155,22 @@ int64_t sys_futex(uint32_t *uaddr, int futex_op, uint32_t val, uint64_t timeout,
             /* Validate user address */
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 0) == 0) return -EFAULT;
-            return futex_wait(uaddr, val, timeout, FUTEX_BITSET_MATCH_ANY, 0, 0);
+            return futex_wait(uaddr, val, timeout, FUTEX_BITSET_MATCH_ANY, 0, 0, private_futex);
         }
         case FUTEX_WAIT_BITSET : {
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 0) == 0) return -EFAULT;
-            return futex_wait(uaddr, val, timeout, (uint64_t)val3, 1, (flags & FUTEX_CLOCK_REALTIME) != 0);
+            return futex_wait(uaddr, val, timeout, (uint64_t)val3, 1, (flags & FUTEX_CLOCK_REALTIME) != 0, private_futex);
         }
         case FUTEX_WAKE : {
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 0) == 0) return -EFAULT;
-            return futex_wake(uaddr, (int)val, FUTEX_BITSET_MATCH_ANY);
+            return futex_wake(uaddr, (int)val, FUTEX_BITSET_MATCH_ANY, flags);
         }
         case FUTEX_WAKE_BITSET : {
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 0) == 0) return -EFAULT;
-            return futex_wake(uaddr, (int)val, (uint64_t)val3);
+            return futex_wake(uaddr, (int)val, (uint64_t)val3, flags);
         }
         case FUTEX_REQUEUE : {
             if (!uaddr || !uaddr2) return -EFAULT;
@@ -1106,7 +1182,7 @@ int64_t sys_futex(uint32_t *uaddr, int futex_op, uint32_t val, uint64_t timeout,
              * timeout = nr_requeue  (Linux passes nr_requeue via utime)
              * val3    = unused for plain REQUEUE
              */
-            return futex_requeue(uaddr, (int)val, (int)timeout, uaddr2, val3, 0);
+            return futex_requeue(uaddr, (int)val, (int)timeout, uaddr2, val3, 0, private_futex);
         }
         case FUTEX_CMP_REQUEUE : {
             if (!uaddr || !uaddr2) return -EFAULT;
@@ -1118,7 +1194,7 @@ int64_t sys_futex(uint32_t *uaddr, int futex_op, uint32_t val, uint64_t timeout,
              * val3  = expected value at uaddr2
              * timeout = nr_requeue
              */
-            return futex_requeue(uaddr, (int)val, (int)timeout, uaddr2, val3, 1);
+            return futex_requeue(uaddr, (int)val, (int)timeout, uaddr2, val3, 1, private_futex);
         }
         case FUTEX_WAKE_OP : {
             if (!uaddr || !uaddr2) return -EFAULT;
@@ -1130,41 +1206,41 @@ int64_t sys_futex(uint32_t *uaddr, int futex_op, uint32_t val, uint64_t timeout,
              * val3  = encoded operation
              * timeout = nr_wake2
              */
-            return futex_wake_op(uaddr, (int)val, (int)timeout, uaddr2, val3);
+            return futex_wake_op(uaddr, (int)val, (int)timeout, uaddr2, val3, private_futex);
         }
         case FUTEX_FD :
             return -ENOSYS; // FD-based futexes are not supported
         case FUTEX_LOCK_PI : {
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 1) == 0) return -EFAULT;
-            return futex_lock_pi(uaddr);
+            return futex_lock_pi(uaddr, private_futex);
         }
         case FUTEX_UNLOCK_PI : {
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 1) == 0) return -EFAULT;
-            return futex_unlock_pi(uaddr);
+            return futex_unlock_pi(uaddr, private_futex);
         }
         case FUTEX_TRYLOCK_PI : {
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 1) == 0) return -EFAULT;
-            return futex_trylock_pi(uaddr);
+            return futex_trylock_pi(uaddr, private_futex);
         }
         case FUTEX_CMP_REQUEUE_PI : {
             if (!uaddr || !uaddr2) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 0) == 0) return -EFAULT;
             if (user_access_ok(uaddr2, sizeof(uint32_t), 1) == 0) return -EFAULT;
-            return futex_cmp_requeue_pi(uaddr, (int)val, (int)timeout, uaddr2, val3);
+            return futex_cmp_requeue_pi(uaddr, (int)val, (int)timeout, uaddr2, val3, private_futex);
         }
         case FUTEX_WAIT_REQUEUE_PI : {
             if (!uaddr || !uaddr2) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 0) == 0) return -EFAULT;
             if (user_access_ok(uaddr2, sizeof(uint32_t), 1) == 0) return -EFAULT;
-            return futex_cmp_requeue_pi(uaddr, 0, (int)val, uaddr2, val3);
+            return futex_cmp_requeue_pi(uaddr, 0, (int)val, uaddr2, val3, private_futex);
         }
         case FUTEX_LOCK_PI2 : {
             if (!uaddr) return -EFAULT;
             if (user_access_ok(uaddr, sizeof(uint32_t), 1) == 0) return -EFAULT;
-            return futex_lock_pi(uaddr);
+            return futex_lock_pi(uaddr, private_futex);
         }
         default :
             return -EINVAL;
@@ -1234,17 +1310,14 @@ static int futex2_validate_value(unsigned int size_code, uint64_t value)
 }
 
 /*
- * Futex key for futex2 words.  Linux derives the hash key from the page
- * address plus the offset within the page; the classic futex path in this
- * kernel keys on the raw user address, so futex2 uses the same key to keep
- * classic and futex2 futexes on the same address interoperable.  The
- * FUTEX2_SIZE_* width only affects how val/mask are validated and how the
- * word is read, not the key.
+ * Futex key for futex2 words.  futex2 shares futex_get_key() with the
+ * classic path, so classic and futex2 futexes on the same word stay
+ * interoperable.  The FUTEX2_SIZE_* width only affects how val/mask are
+ * validated and how the word is read, not the key.
  */
-static inline uintptr_t futex2_key(uint64_t uaddr, unsigned int size_code)
+static inline int futex2_key(uint64_t uaddr, uint64_t flags, futex_key_t *key)
 {
-    (void)size_code;
-    return (uintptr_t)uaddr;
+    return futex_get_key((const void *)(uintptr_t)uaddr, (flags & FUTEX2_PRIVATE) != 0, key);
 }
 
 /* Read the futex word (1/2/4/8 bytes) from user space. */
@@ -1259,18 +1332,21 @@ static int futex2_read_word(uint64_t uaddr, unsigned int size_code, uint64_t *ou
  * Block on a futex2 word.  The timeout (if any) is an absolute timeout on
  * the clock selected by `realtime` (CLOCK_REALTIME) or CLOCK_MONOTONIC.
  */
-static int futex2_wait_core(uint64_t uaddr, unsigned int size_code, uint64_t val, uint64_t mask, uint64_t timeout, int realtime)
+static int futex2_wait_core(uint64_t uaddr, uint64_t flags, uint64_t val, uint64_t mask, uint64_t timeout, int realtime)
 {
+    unsigned int    size_code = (unsigned int)(flags & FUTEX2_SIZE_MASK);
     futex_bucket_t *bucket;
     futex_entry_t  *entry;
+    futex_key_t     key;
     uint64_t        cur_val;
     uint64_t        deadline = 0;
     int             ret;
 
     if (mask == 0) return -EINVAL; // same as classic bitset == 0
 
-    uintptr_t key = futex2_key(uaddr, size_code);
-    bucket        = &futex_hash[futex_hash_index((uint32_t *)(uintptr_t)key)];
+    ret = futex2_key(uaddr, flags, &key);
+    if (ret) return ret;
+    bucket = futex_bucket(&key);
 
     if (timeout) {
         ret = futex_read_timespec(timeout, &deadline);
@@ -1288,7 +1364,7 @@ static int futex2_wait_core(uint64_t uaddr, unsigned int size_code, uint64_t val
         return -EAGAIN;
     }
 
-    entry = futex_create_waiter(bucket, (uint32_t *)(uintptr_t)key, mask);
+    entry = futex_create_waiter(bucket, &key, mask);
     if (!entry) {
         plogk("futex: Futex2 waiter allocation failed for %#lx\n", (unsigned long)uaddr);
         spin_unlock(&bucket->lock);
@@ -1302,7 +1378,7 @@ static int futex2_wait_core(uint64_t uaddr, unsigned int size_code, uint64_t val
         ret = -ERESTARTSYS;
     } else {
         if (timeout)
-            ret = wait_queue_wait_timed(&entry->wq, deadline);
+            ret = wait_queue_wait_deadline(&entry->wq, deadline);
         else {
             wait_queue_sleep();
             ret = 0;
@@ -1311,7 +1387,7 @@ static int futex2_wait_core(uint64_t uaddr, unsigned int size_code, uint64_t val
     }
 
     spin_lock(&bucket->lock);
-    entry = futex_find_waiter(bucket, (uint32_t *)(uintptr_t)key, mask);
+    entry = futex_find_waiter(bucket, &key, mask);
     futex_try_cleanup(bucket, entry);
     spin_unlock(&bucket->lock);
     return ret;
@@ -1321,9 +1397,9 @@ static int futex2_wait_core(uint64_t uaddr, unsigned int size_code, uint64_t val
  * Wake up to nr_wake waiters whose mask overlaps `mask` on the futex2
  * word identified by `key`.  Returns the number actually woken.
  */
-static int futex2_wake_core(uintptr_t key, uintptr_t user_address, int nr_wake, uint64_t mask)
+static int futex2_wake_core(const futex_key_t *key, int nr_wake, uint64_t mask)
 {
-    futex_bucket_t *bucket = &futex_hash[futex_hash_index((uint32_t *)(uintptr_t)key)];
+    futex_bucket_t *bucket = futex_bucket(key);
     futex_entry_t  *entry;
     int             woken = 0;
 
@@ -1331,7 +1407,7 @@ static int futex2_wake_core(uintptr_t key, uintptr_t user_address, int nr_wake,
 
     spin_lock(&bucket->lock);
     for (entry = bucket->head; entry; entry = entry->next) {
-        if (entry->key != key) continue;
+        if (!futex_key_equal(&entry->key, key)) continue;
         if (!(entry->bitset & mask)) continue;
 
         while (woken < nr_wake) {
@@ -1343,7 +1419,7 @@ static int futex2_wake_core(uintptr_t key, uintptr_t user_address, int nr_wake,
 
     /* Cleanup is deferred to the final waiter, like classic futex_wake. */
     spin_unlock(&bucket->lock);
-    woken += futex_waitv_notify(user_address, nr_wake - woken);
+    woken += futex_waitv_notify(key, nr_wake - woken);
     return woken;
 }
 
@@ -1364,6 +1440,13 @@ static int futex_waitv_unregister(futex_waitv_registration_t *registration)
     return index;
 }
 
+/* Release the copied vector and its keys. */
+static void futex_waitv_free(struct futex_waitv *waiters, futex_key_t *keys)
+{
+    free(waiters);
+    free(keys);
+}
+
 /* Linux futex_waitv(2): wait until any one of a vector of 32-bit futexes wakes. */
 int64_t sys_futex_waitv(uint64_t waiters_ptr, uint64_t nr_waiters, uint64_t flags, uint64_t timeout, uint64_t clockid, uint64_t reserved)
 {
@@ -1374,28 +1457,38 @@ int64_t sys_futex_waitv(uint64_t waiters_ptr, uint64_t nr_waiters, uint64_t flag
 
     size_t              bytes   = (size_t)nr_waiters * sizeof(struct futex_waitv);
     struct futex_waitv *waiters = malloc(bytes);
+    futex_key_t        *keys    = malloc((size_t)nr_waiters * sizeof(futex_key_t));
 
-    if (!waiters) return -ENOMEM;
-    if (copy_from_user(waiters, (const void *)(uintptr_t)waiters_ptr, bytes)) {
+    if (!waiters || !keys) {
         free(waiters);
+        free(keys);
+        return -ENOMEM;
+    }
+    if (copy_from_user(waiters, (const void *)(uintptr_t)waiters_ptr, bytes)) {
+        futex_waitv_free(waiters, keys);
         return -EFAULT;
     }
     for (uint32_t i = 0; i < (uint32_t)nr_waiters; i++) {
         if (waiters[i].__reserved || (waiters[i].flags & ~(FUTEX2_SIZE_MASK | FUTEX_PRIVATE_FLAG)) || (waiters[i].flags & FUTEX2_SIZE_MASK) != FUTEX2_SIZE_U32 || waiters[i].val > UINT32_MAX) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return -EINVAL;
         }
         if (!waiters[i].uaddr || !user_access_ok((void *)(uintptr_t)waiters[i].uaddr, sizeof(uint32_t), 0)) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return -EFAULT;
         }
+        int ret = futex_get_key((const void *)(uintptr_t)waiters[i].uaddr, (waiters[i].flags & FUTEX_PRIVATE_FLAG) != 0, &keys[i]);
+        if (ret) {
+            futex_waitv_free(waiters, keys);
+            return ret;
+        }
         uint32_t value;
         if (copy_from_user(&value, (const void *)(uintptr_t)waiters[i].uaddr, sizeof(value))) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return -EFAULT;
         }
         if (value != (uint32_t)waiters[i].val) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return -EAGAIN;
         }
     }
@@ -1404,15 +1497,14 @@ int64_t sys_futex_waitv(uint64_t waiters_ptr, uint64_t nr_waiters, uint64_t flag
     if (timeout) {
         int ret = futex_read_timespec(timeout, &deadline);
         if (ret) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return ret;
         }
         deadline = futex_deadline(deadline, 1, clockid == 0);
     }
     for (;;) {
         futex_waitv_registration_t registration = {
-            .owner       = process_current(),
-            .waiters     = waiters,
+            .keys        = keys,
             .count       = (uint32_t)nr_waiters,
             .woken_index = -1,
         };
@@ -1447,27 +1539,27 @@ int64_t sys_futex_waitv(uint64_t waiters_ptr, uint64_t nr_waiters, uint64_t flag
         spin_unlock(&futex_waitv_notify_lock);
 
         if (error) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return error;
         }
         if (changed >= 0) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return changed;
         }
         if (futex_signal_pending()) {
             int index = futex_waitv_unregister(&registration);
             wait_queue_cancel(&registration.wq);
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return index >= 0 ? index : -ERESTARTSYS;
         }
         if (timeout) {
-            if (sched_ticks() >= deadline) {
+            if (timer_monotonic_ns() >= deadline) {
                 int index = futex_waitv_unregister(&registration);
                 wait_queue_cancel(&registration.wq);
-                free(waiters);
+                futex_waitv_free(waiters, keys);
                 return index >= 0 ? index : -ETIMEDOUT;
             }
-            (void)wait_queue_wait_timed(&registration.wq, deadline);
+            (void)wait_queue_wait_deadline(&registration.wq, deadline);
         } else {
             wait_queue_sleep();
         }
@@ -1475,47 +1567,45 @@ int64_t sys_futex_waitv(uint64_t waiters_ptr, uint64_t nr_waiters, uint64_t flag
         int index = futex_waitv_unregister(&registration);
         wait_queue_cancel(&registration.wq);
         if (index >= 0) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return index;
         }
         if (futex_signal_pending()) {
-            free(waiters);
+            futex_waitv_free(waiters, keys);
             return -ERESTARTSYS;
         }
-        if (timeout && sched_ticks() >= deadline) {
-            free(waiters);
+        if (timeout && timer_monotonic_ns() >= deadline) {
+            futex_waitv_free(waiters, keys);
             return -ETIMEDOUT;
         }
     }
 }
 
-/* Find the first entry with the given key (bucket lock must be held). */
-static futex_entry_t *futex2_find_key(futex_bucket_t *bucket, uintptr_t key)
-{
-    for (futex_entry_t *entry = bucket->head; entry; entry = entry->next)
-        if (entry->key == key) return entry;
-    return NULL;
-}
-
 /*
  * futex_requeue(): CMP_REQUEUE semantics.  If *uaddr != cmpval return
  * -EAGAIN.  Otherwise wake up to nr_wake waiters on key1, then move up
  * to nr_requeue remaining waiters to key2.  Moved waiters keep their own
  * mask: each lands in the (key2, mask) queue.
  */
-static int futex2_requeue_core(uint64_t uaddr, unsigned int size_code1, uint64_t uaddr2, unsigned int size_code2, int nr_wake, int nr_requeue, uint64_t cmpval)
+static int futex2_requeue_core(uint64_t uaddr, uint64_t flags1, uint64_t uaddr2, uint64_t flags2, int nr_wake, int nr_requeue, uint64_t cmpval)
 {
-    uintptr_t       key1    = futex2_key(uaddr, size_code1);
-    uintptr_t       key2    = futex2_key(uaddr2, size_code2);
-    futex_bucket_t *bucket1 = &futex_hash[futex_hash_index((uint32_t *)(uintptr_t)key1)];
-    futex_bucket_t *bucket2 = &futex_hash[futex_hash_index((uint32_t *)(uintptr_t)key2)];
+    unsigned int size_code1 = (unsigned int)(flags1 & FUTEX2_SIZE_MASK);
+    futex_key_t  key1;
+    futex_key_t  key2;
+    int          ret;
+
+    if (nr_wake < 0 || nr_requeue < 0) return -EINVAL;
+    ret = futex2_key(uaddr, flags1, &key1);
+    if (!ret) ret = futex2_key(uaddr2, flags2, &key2);
+    if (ret) return ret;
+
+    futex_bucket_t *bucket1 = futex_bucket(&key1);
+    futex_bucket_t *bucket2 = futex_bucket(&key2);
     futex_entry_t  *entry;
     uint64_t        cur_val;
     int             woken    = 0;
     int             requeued = 0;
 
-    if (nr_wake < 0 || nr_requeue < 0) return -EINVAL;
-
     /* Lock both buckets in address order to avoid deadlock. */
     if (bucket1 < bucket2) {
         spin_lock(&bucket1->lock);
@@ -1539,7 +1629,7 @@ static int futex2_requeue_core(uint64_t uaddr, unsigned int size_code1, uint64_t
 
     /* Phase 1: wake up to nr_wake waiters on key1. */
     for (entry = bucket1->head; entry && woken < nr_wake; entry = entry->next) {
-        if (entry->key != key1) continue;
+        if (!futex_key_equal(&entry->key, &key1)) continue;
         while (woken < nr_wake) {
             task_t *task = wait_queue_wake_one(&entry->wq);
             if (!task) break;
@@ -1550,11 +1640,11 @@ static int futex2_requeue_core(uint64_t uaddr, unsigned int size_code1, uint64_t
     /* Phase 2: move up to nr_requeue waiters to key2, preserving masks. */
     if (nr_requeue > 0) {
         for (entry = bucket1->head; entry && requeued < nr_requeue; entry = entry->next) {
-            if (entry->key != key1) continue;
+            if (!futex_key_equal(&entry->key, &key1)) continue;
             while (requeued < nr_requeue) {
-                futex_entry_t *dst = futex_find_waiter(bucket2, (uint32_t *)(uintptr_t)key2, entry->bitset);
+                futex_entry_t *dst = futex_find_waiter(bucket2, &key2, entry->bitset);
                 if (!dst) {
-                    dst = futex_create_waiter(bucket2, (uint32_t *)(uintptr_t)key2, entry->bitset);
+                    dst = futex_create_waiter(bucket2, &key2, entry->bitset);
                     if (!dst) goto requeue_done;
                 }
                 if (!futex_move_waiter(&entry->wq, &dst->wq)) break;
@@ -1564,10 +1654,10 @@ static int futex2_requeue_core(uint64_t uaddr, unsigned int size_code1, uint64_t
     }
 requeue_done:
     /* Remove entries left empty by wake/requeue. */
-    while ((entry = futex2_find_key(bucket1, key1)) != NULL)
+    while ((entry = futex_find(bucket1, &key1)) != NULL)
         if (!futex_try_cleanup(bucket1, entry)) break;
     if (bucket1 != bucket2) {
-        while ((entry = futex2_find_key(bucket2, key2)) != NULL)
+        while ((entry = futex_find(bucket2, &key2)) != NULL)
             if (!futex_try_cleanup(bucket2, entry)) break;
         spin_unlock(&bucket2->lock);
     }
@@ -1591,7 +1681,10 @@ int64_t sys_futex_wake(uint64_t uaddr, uint64_t mask, uint64_t nr, uint64_t flag
     if (!uaddr) return -EFAULT;
     if (user_access_ok((void *)(uintptr_t)uaddr, futex2_size_bytes(size_code), 0) == 0) return -EFAULT;
 
-    return futex2_wake_core(futex2_key(uaddr, size_code), (uintptr_t)uaddr, (int)nr, mask);
+    futex_key_t key;
+    int         ret = futex2_key(uaddr, flags, &key);
+    if (ret) return ret;
+    return futex2_wake_core(&key, (int)nr, mask);
 }
 
 /*
@@ -1609,7 +1702,7 @@ int64_t sys_futex_wait(uint64_t uaddr, uint64_t val, uint64_t mask, uint64_t fla
     if (!uaddr) return -EFAULT;
     if (user_access_ok((void *)(uintptr_t)uaddr, futex2_size_bytes(size_code), 0) == 0) return -EFAULT;
 
-    return futex2_wait_core(uaddr, size_code, val, mask, timeout, clockid == 0);
+    return futex2_wait_core(uaddr, flags, val, mask, timeout, clockid == 0);
 }
 
 /*
@@ -1644,7 +1737,7 @@ int64_t sys_futex_requeue(uint64_t waiters, uint64_t flags, uint64_t nr_wake, ui
     if (user_access_ok((void *)(uintptr_t)wv[0].uaddr, futex2_size_bytes(size_code0), 0) == 0) return -EFAULT;
     if (user_access_ok((void *)(uintptr_t)wv[1].uaddr, futex2_size_bytes(size_code1), 0) == 0) return -EFAULT;
 
-    return futex2_requeue_core(wv[0].uaddr, size_code0, wv[1].uaddr, size_code1, (int)nr_wake, (int)nr_requeue, wv[0].val);
+    return futex2_requeue_core(wv[0].uaddr, wv[0].flags, wv[1].uaddr, wv[1].flags, (int)nr_wake, (int)nr_requeue, wv[0].val);
 }
 
 /*
@@ -1653,11 +1746,22 @@ int64_t sys_futex_requeue(uint64_t waiters, uint64_t flags, uint64_t nr_wake, ui
  */
 void futex_init(void)
 {
-    for (int i = 0; i < FUTEX_HASH_SIZE; i++) {
-        futex_hash[i].head        = NULL;
-        futex_hash[i].lock.lock   = 0;
-        futex_hash[i].lock.rflags = 0;
+    uint64_t size = FUTEX_HASH_SIZE;
+    while (size < (uint64_t)FUTEX_HASH_PER_CPU * get_cpu_count()) size <<= 1;
+
+    futex_bucket_t *table = size > FUTEX_HASH_SIZE ? malloc(size * sizeof(futex_bucket_t)) : NULL;
+    if (!table) {
+        if (size > FUTEX_HASH_SIZE) plogk("futex: Hash allocation failed, using %d boot buckets\n", FUTEX_HASH_SIZE);
+        table = futex_hash_boot;
+        size  = FUTEX_HASH_SIZE;
+    }
+    for (uint64_t i = 0; i < size; i++) {
+        table[i].head        = NULL;
+        table[i].lock.lock   = 0;
+        table[i].lock.rflags = 0;
     }
+    futex_hash      = table;
+    futex_hash_mask = (uint32_t)(size - 1);
 
-    plogk("futex: Futex subsystem initialized (buckets=%d)\n", FUTEX_HASH_SIZE);
+    plogk("futex: Futex subsystem initialized (buckets=%lu)\n", (unsigned long)size);
 }
@@ -20,6 +20,7 @@
 #include <libs/std/string.h>
 #include <mem/alloc.h>
 #include <mem/heap.h>
+#include <mem/pagecache.h>
 #include <process/process.h>
 #include <process/sched.h>
 #include <process/task.h>
@@ -40,6 +41,8 @@
 #ifndef PIPE_ADAPTIVE_SPIN_ITERS
 #    define PIPE_ADAPTIVE_SPIN_ITERS 192U
 #endif
+#define PIPE_MAX_SEGS  32U                  // queued buffers once page references are spliced in
+#define PIPE_MAX_SPANS (PIPE_MAX_SEGS * 2U) // contiguous pieces, ring bytes may wrap once per buffer
 
 /* Pipe ring buffer structure */
 
@@ -61,8 +64,33 @@ typedef struct pipe_ring {
         spinlock_t   lock;
         wait_queue_t read_wq;
         wait_queue_t write_wq;
+
+        /*
+         * Spliced page references.  While seg_count is zero the pipe is a
+         * plain byte ring; otherwise the readable stream is exactly the
+         * segment queue, where page == NULL stands for the next len bytes of
+         * the byte ring.
+         */
+        pipe_buffer_t *segs; // allocated by the first splice into the pipe
+        uint32_t       seg_tail;
+        uint32_t       seg_count;
+        uint32_t       page_bytes; // readable bytes held in page segments
+        bool           splicing;   // a splice-out owns the front of the stream
 } pipe_ring_t;
 
+/* Position of a walk over the readable stream, not consuming anything. */
+typedef struct pipe_cursor {
+        uint32_t seg;      // segment, relative to seg_tail
+        uint32_t seg_used; // bytes of that segment already visited
+        uint32_t byte_pos; // ring index of the next byte-segment byte
+} pipe_cursor_t;
+
+/* One contiguous piece of the readable stream. */
+typedef struct pipe_span {
+        const uint8_t *data;
+        uint32_t       len;
+} pipe_span_t;
+
 /*
  * One endpoint per open-file description.  fork(2) and dup(2) share the
  * process_file object, so the endpoint is released only after the last
@@ -112,16 +140,31 @@ static inline void pipe_poll_notify(vfs_node_t node, uint32_t events)
     vfs_poll_source_notify(&node->poll_source, events);
 }
 
+/* Return the segment n places after the oldest one. */
+static inline pipe_buffer_t *pipe_seg_at(const pipe_ring_t *ring, uint32_t n)
+{
+    return &ring->segs[(ring->seg_tail + n) % PIPE_MAX_SEGS];
+}
+
 /* Return the number of unread bytes in the ring. */
 static uint32_t pipe_ring_readable(const pipe_ring_t *ring)
 {
-    return ring->size;
+    return ring->size + ring->page_bytes;
 }
 
-/* Return the number of free bytes in the ring. */
+/* Return the number of bytes a write may add to the ring. */
 static uint32_t pipe_ring_writable(const pipe_ring_t *ring)
 {
-    return ring->capacity - ring->size;
+    /* Bytes written behind a page segment need a segment of their own. */
+    if (ring->seg_count == PIPE_MAX_SEGS && pipe_seg_at(ring, PIPE_MAX_SEGS - 1)->page) return 0;
+    return ring->capacity - ring->size - ring->page_bytes;
+}
+
+/* Whether a page segment of len bytes can be queued behind the current data. */
+static bool pipe_ring_page_room(const pipe_ring_t *ring, uint32_t len)
+{
+    uint32_t segs = ring->seg_count ? 1 : (ring->size ? 2 : 1);
+    return ring->segs && ring->seg_count + segs <= PIPE_MAX_SEGS && ring->capacity - ring->size - ring->page_bytes >= len;
 }
 
 /*
@@ -144,7 +187,8 @@ static void pipe_spin_for_reader(pipe_ring_t *ring)
     if (!pipe_peer_is_remote(peer)) return;
 
     for (uint32_t i = 0; i < PIPE_ADAPTIVE_SPIN_ITERS; i++) {
-        if (__atomic_load_n(&ring->size, __ATOMIC_ACQUIRE) != 0 || __atomic_load_n(&ring->writers, __ATOMIC_RELAXED) == 0 || __atomic_load_n(&ring->closed, __ATOMIC_RELAXED)) break;
+        if (__atomic_load_n(&ring->size, __ATOMIC_ACQUIRE) != 0 || __atomic_load_n(&ring->page_bytes, __ATOMIC_ACQUIRE) != 0) break;
+        if (__atomic_load_n(&ring->writers, __ATOMIC_RELAXED) == 0 || __atomic_load_n(&ring->closed, __ATOMIC_RELAXED)) break;
         __asm__ volatile("pause");
     }
 }
@@ -156,7 +200,7 @@ static void pipe_spin_for_writer(pipe_ring_t *ring, uint32_t needed)
     if (!pipe_peer_is_remote(peer)) return;
 
     for (uint32_t i = 0; i < PIPE_ADAPTIVE_SPIN_ITERS; i++) {
-        uint32_t used = __atomic_load_n(&ring->size, __ATOMIC_ACQUIRE);
+        uint32_t used = __atomic_load_n(&ring->size, __ATOMIC_ACQUIRE) + __atomic_load_n(&ring->page_bytes, __ATOMIC_ACQUIRE);
         if (ring->capacity - used >= needed || __atomic_load_n(&ring->readers, __ATOMIC_RELAXED) == 0 || __atomic_load_n(&ring->closed, __ATOMIC_RELAXED)) break;
         __asm__ volatile("pause");
     }
@@ -171,23 +215,157 @@ static inline uint32_t pipe_ring_advance(const pipe_ring_t *ring, uint32_t index
     return next >= ring->capacity ? next - ring->capacity : next;
 }
 
+/* Consume count bytes from the front of the segment queue, releasing emptied pages. */
+static void pipe_seg_consume(pipe_ring_t *ring, uint32_t count)
+{
+    while (count && ring->seg_count) {
+        pipe_buffer_t *seg   = pipe_seg_at(ring, 0);
+        uint32_t       chunk = seg->len < count ? seg->len : count;
+        if (seg->page) {
+            seg->offset += chunk;
+            ring->page_bytes -= chunk;
+        } else {
+            ring->tail = pipe_ring_advance(ring, ring->tail, chunk);
+            ring->size -= chunk;
+        }
+        seg->len -= chunk;
+        count -= chunk;
+        if (seg->len) continue;
+
+        if (seg->page) pagecache_buffer_put(seg->page);
+        seg->page      = NULL;
+        ring->seg_tail = (ring->seg_tail + 1) % PIPE_MAX_SEGS;
+        ring->seg_count--;
+    }
+}
+
 /* Advance the tail past count consumed bytes. */
 static void pipe_ring_consume(pipe_ring_t *ring, uint32_t count)
 {
+    if (ring->seg_count) {
+        pipe_seg_consume(ring, count);
+        return;
+    }
     ring->tail = pipe_ring_advance(ring, ring->tail, count);
     ring->size -= count;
 }
 
+/* Account count produced ring bytes in the segment queue. */
+static void pipe_seg_produce(pipe_ring_t *ring, uint32_t count)
+{
+    pipe_buffer_t *last = pipe_seg_at(ring, ring->seg_count - 1);
+    if (!last->page) {
+        last->len += count;
+        return;
+    }
+    pipe_buffer_t *seg = pipe_seg_at(ring, ring->seg_count++);
+    seg->page          = NULL;
+    seg->offset        = 0;
+    seg->len           = count;
+}
+
 /* Advance the head past count produced bytes. */
 static void pipe_ring_produce(pipe_ring_t *ring, uint32_t count)
 {
     ring->head = pipe_ring_advance(ring, ring->head, count);
     ring->size += count;
+    if (ring->seg_count) pipe_seg_produce(ring, count);
+}
+
+/* Queue a pinned page span behind the current data; pipe_ring_page_room() must allow it. */
+static void pipe_ring_push_page(pipe_ring_t *ring, pagecache_page_t *page, uint32_t offset, uint32_t len)
+{
+    if (!ring->seg_count && ring->size) {
+        pipe_buffer_t *bytes = pipe_seg_at(ring, 0);
+        bytes->page          = NULL;
+        bytes->offset        = 0;
+        bytes->len           = ring->size;
+        ring->seg_count      = 1;
+    }
+    pipe_buffer_t *seg = pipe_seg_at(ring, ring->seg_count++);
+    seg->page          = page;
+    seg->offset        = offset;
+    seg->len           = len;
+    ring->page_bytes += len;
+}
+
+/* Allocate the segment queue before a ring first takes page references. */
+static int pipe_ring_prepare_segs(pipe_ring_t *ring)
+{
+    if (__atomic_load_n(&ring->segs, __ATOMIC_ACQUIRE)) return EOK;
+
+    pipe_buffer_t *segs = calloc(PIPE_MAX_SEGS, sizeof(*segs));
+    if (!segs) return -ENOMEM;
+    pipe_buffer_t *expected = NULL;
+    if (!__atomic_compare_exchange_n(&ring->segs, &expected, segs, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) free(segs);
+    return EOK;
+}
+
+/*
+ * Return the next contiguous readable piece after cursor, at most limit
+ * bytes, or 0 at the end of the data.  page is set for page segments.
+ */
+static uint32_t pipe_cursor_next(const pipe_ring_t *ring, pipe_cursor_t *cursor, uint32_t limit, const uint8_t **data, pagecache_page_t **page)
+{
+    const pipe_buffer_t *seg = NULL;
+    uint32_t             total;
+    if (ring->seg_count) {
+        if (cursor->seg >= ring->seg_count) return 0;
+        seg   = pipe_seg_at(ring, cursor->seg);
+        total = seg->len;
+    } else {
+        if (cursor->seg) return 0;
+        total = ring->size;
+    }
+
+    uint32_t len = total - cursor->seg_used;
+    if (len > limit) len = limit;
+    if (!len) return 0;
+
+    *page = seg ? seg->page : NULL;
+    if (*page) {
+        *data = (const uint8_t *)pagecache_page_data(*page) + seg->offset + cursor->seg_used;
+    } else {
+        uint32_t contiguous = ring->capacity - cursor->byte_pos;
+        if (len > contiguous) len = contiguous;
+        *data            = ring->buf + cursor->byte_pos;
+        cursor->byte_pos = pipe_ring_advance(ring, cursor->byte_pos, len);
+    }
+    cursor->seg_used += len;
+    if (cursor->seg_used == total) {
+        cursor->seg++;
+        cursor->seg_used = 0;
+    }
+    return len;
+}
+
+/* Copy the first count readable bytes of a segmented ring, to user memory when proc is set. */
+static int pipe_seg_copy_out(const pipe_ring_t *ring, process_t *proc, uint8_t *dst, uint32_t count)
+{
+    pipe_cursor_t cursor = {.byte_pos = ring->tail};
+    while (count) {
+        const uint8_t    *data;
+        pagecache_page_t *page;
+        uint32_t          len = pipe_cursor_next(ring, &cursor, count, &data, &page);
+        if (!len) break;
+        if (!proc)
+            memcpy(dst, data, len);
+        else if (copy_to_user_process_nofault_current(proc, dst, data, len))
+            return -EFAULT;
+        dst += len;
+        count -= len;
+    }
+    return EOK;
 }
 
 /* Copy data from ring buffer to linear buffer, handling wraparound */
 static uint32_t pipe_ring_copy_out(pipe_ring_t *ring, uint8_t *dst, uint32_t count)
 {
+    if (ring->seg_count) {
+        pipe_seg_copy_out(ring, NULL, dst, count);
+        return count;
+    }
+
     uint32_t first_chunk = ring->capacity - ring->tail;
 
     if (first_chunk > count) first_chunk = count;
@@ -212,6 +390,8 @@ static uint32_t pipe_ring_copy_in(pipe_ring_t *ring, const uint8_t *src, uint32_
 /* Copy ring data to user memory, handling tail wraparound. */
 static int pipe_ring_copy_out_user(pipe_ring_t *ring, process_t *proc, uint8_t *dst, uint32_t count)
 {
+    if (ring->seg_count) return pipe_seg_copy_out(ring, proc, dst, count);
+
     uint32_t first_chunk = ring->capacity - ring->tail;
     if (first_chunk > count) first_chunk = count;
 
@@ -272,6 +452,9 @@ static void pipe_ring_free(pipe_ring_t *ring)
 {
     if (!ring) return;
     if (ring->buf) free(ring->buf);
+    for (uint32_t i = 0; i < ring->seg_count; i++)
+        if (pipe_seg_at(ring, i)->page) pagecache_buffer_put(pipe_seg_at(ring, i)->page);
+    if (ring->segs) free(ring->segs);
     free(ring);
 }
 
@@ -457,12 +640,8 @@ static int64_t pipe_read_common(vfs_node_t node, pipe_ring_t *ring, uint64_t fla
      * writers have gone away.  On each wakeup we re-check the
      * condition under the lock.
      */
-    while (pipe_ring_readable(ring) == 0) {
-        if (ring->closed) {
-            spin_unlock(&ring->lock);
-            return 0;
-        }
-        if (ring->writers == 0) {
+    while (pipe_ring_readable(ring) == 0 || ring->splicing) {
+        if (!ring->splicing && (ring->closed || ring->writers == 0)) {
             spin_unlock(&ring->lock);
             return 0;
         }
@@ -542,8 +721,8 @@ static int64_t pipe_file_read_user(vfs_node_t node, void *private_data, uint64_t
     bool         spun = false;
     for (;;) {
         spin_lock(&ring->lock);
-        while (pipe_ring_readable(ring) == 0) {
-            if (ring->closed || ring->writers == 0) {
+        while (pipe_ring_readable(ring) == 0 || ring->splicing) {
+            if (!ring->splicing && (ring->closed || ring->writers == 0)) {
                 spin_unlock(&ring->lock);
                 return 0;
             }
@@ -775,6 +954,272 @@ static int64_t pipe_file_write_user(vfs_node_t node, void *private_data, uint64_
     return (int64_t)total_written;
 }
 
+/* Whether node is an anonymous pipe or FIFO served by this subsystem. */
+bool pipe_node_is_pipe(vfs_node_t node)
+{
+    return node && pipe_fsid >= 0 && node->fsid == pipe_fsid;
+}
+
+/*
+ * Queue pinned page-cache spans on a pipe without copying them.  Each queued
+ * buffer's pin passes to the pipe and the caller keeps the rest.  Buffers are
+ * queued whole, waiting for room only until the first one fits.  Returns the
+ * bytes queued or -errno.
+ */
+int64_t pipe_splice_in(vfs_node_t node, void *private_data, uint64_t flags, const pipe_buffer_t *bufs, size_t count)
+{
+    pipe_endpoint_t *endpoint = private_data;
+    if (!endpoint || !endpoint->writable) return -EBADF;
+    if (!bufs || !count) return 0;
+    if (bufs[0].len > PIPE_ATOMIC_SIZE) return -EINVAL;
+
+    pipe_ring_t *ring = endpoint->ring;
+    if (pipe_ring_prepare_segs(ring)) return -ENOMEM;
+
+    spin_lock(&ring->lock);
+    while (!pipe_ring_page_room(ring, bufs[0].len) || ring->closed || ring->readers == 0) {
+        if (ring->closed || ring->readers == 0) {
+            spin_unlock(&ring->lock);
+            pipe_raise_sigpipe();
+            return -EPIPE;
+        }
+        if (flags & O_NONBLOCK) {
+            spin_unlock(&ring->lock);
+            return -EAGAIN;
+        }
+        if (pipe_signal_pending()) {
+            spin_unlock(&ring->lock);
+            return -EINTR;
+        }
+        if (!ring->write_waiters || bufs[0].len < ring->write_wake_threshold) ring->write_wake_threshold = bufs[0].len;
+        ring->write_waiters++;
+        wait_queue_prepare(&ring->write_wq);
+        spin_unlock(&ring->lock);
+        wait_queue_sleep();
+        spin_lock(&ring->lock);
+        if (ring->write_waiters) ring->write_waiters--;
+        if (!ring->write_waiters) ring->write_wake_threshold = 0;
+    }
+
+    bool   was_empty = pipe_ring_readable(ring) == 0;
+    size_t queued    = 0;
+    for (size_t i = 0; i < count && bufs[i].len <= PIPE_ATOMIC_SIZE && pipe_ring_page_room(ring, bufs[i].len); i++) {
+        pipe_ring_push_page(ring, bufs[i].page, bufs[i].offset, bufs[i].len);
+        queued += bufs[i].len;
+    }
+    __atomic_store_n(&ring->last_writer_cpu, get_current_cpu_id(), __ATOMIC_RELAXED);
+    bool wake_readers = was_empty && ring->read_waiters != 0;
+    spin_unlock(&ring->lock);
+
+    if (wake_readers) wait_queue_wake_one_sync(&ring->read_wq);
+    if (was_empty) pipe_poll_notify(node, POLLIN);
+    return (int64_t)queued;
+}
+
+/*
+ * Feed up to size readable bytes to actor straight out of the pipe's ring
+ * and page buffers, then consume what it accepted.  The ring lock is not held
+ * across actor calls (the sink may sleep); other readers wait on the splicing
+ * flag instead, so the front of the stream cannot move underneath.
+ */
+int64_t pipe_splice_out(vfs_node_t node, void *private_data, uint64_t flags, size_t size, pipe_actor_t actor, void *context)
+{
+    pipe_endpoint_t *endpoint = private_data;
+    if (!endpoint || !endpoint->readable) return -EBADF;
+    if (!actor) return -EINVAL;
+    if (!size) return 0;
+
+    pipe_ring_t *ring = endpoint->ring;
+    spin_lock(&ring->lock);
+    while (pipe_ring_readable(ring) == 0 || ring->splicing) {
+        if (!ring->splicing && (ring->closed || ring->writers == 0)) {
+            spin_unlock(&ring->lock);
+            return 0;
+        }
+        if (flags & O_NONBLOCK) {
+            spin_unlock(&ring->lock);
+            return -EAGAIN;
+        }
+        if (pipe_signal_pending()) {
+            spin_unlock(&ring->lock);
+            return -EINTR;
+        }
+        ring->read_waiters++;
+        wait_queue_prepare(&ring->read_wq);
+        spin_unlock(&ring->lock);
+        wait_queue_sleep();
+        spin_lock(&ring->lock);
+        if (ring->read_waiters) ring->read_waiters--;
+    }
+
+    pipe_span_t   spans[PIPE_MAX_SPANS];
+    uint32_t      nr_spans = 0;
+    pipe_cursor_t cursor   = {.byte_pos = ring->tail};
+    uint32_t      limit    = size < pipe_ring_readable(ring) ? (uint32_t)size : pipe_ring_readable(ring);
+    while (limit && nr_spans < PIPE_MAX_SPANS) {
+        pagecache_page_t *page;
+        uint32_t          len = pipe_cursor_next(ring, &cursor, limit, &spans[nr_spans].data, &page);
+        if (!len) break;
+        spans[nr_spans++].len = len;
+        limit -= len;
+    }
+    ring->splicing = true;
+    spin_unlock(&ring->lock);
+
+    size_t  done  = 0;
+    int64_t error = 0;
+    for (uint32_t i = 0; i < nr_spans; i++) {
+        int64_t ret = actor(context, spans[i].data, spans[i].len);
+        if (ret < 0) {
+            error = ret;
+            break;
+        }
+        done += (size_t)ret;
+        if ((uint32_t)ret < spans[i].len) break;
+    }
+
+    spin_lock(&ring->lock);
+    bool was_full = pipe_ring_writable(ring) == 0;
+    pipe_ring_consume(ring, (uint32_t)done);
+    ring->splicing = false;
+    __atomic_store_n(&ring->last_reader_cpu, get_current_cpu_id(), __ATOMIC_RELAXED);
+    bool wake_writers = done && ring->write_waiters != 0 && pipe_ring_writable(ring) >= ring->write_wake_threshold;
+    bool wake_readers = ring->read_waiters != 0;
+    spin_unlock(&ring->lock);
+
+    if (wake_writers) wait_queue_wake_one_sync(&ring->write_wq);
+    if (wake_readers) wait_queue_wake_all(&ring->read_wq);
+    if (done && was_full) pipe_poll_notify(node, POLLOUT);
+    return done ? (int64_t)done : error;
+}
+
+/* Take two ring locks in address order. */
+static void pipe_ring_lock_pair(pipe_ring_t *first, pipe_ring_t *second)
+{
+    if (first > second) {
+        pipe_ring_t *swap = first;
+        first             = second;
+        second            = swap;
+    }
+    spin_lock(&first->lock);
+    spin_lock(&second->lock);
+}
+
+/* Release both ring locks taken by pipe_ring_lock_pair(). */
+static void pipe_ring_unlock_pair(pipe_ring_t *first, pipe_ring_t *second)
+{
+    spin_unlock(&first->lock);
+    spin_unlock(&second->lock);
+}
+
+/*
+ * Move up to size bytes from one pipe to another, or with consume clear
+ * duplicate them as tee(2) does.  Page buffers are shared by taking another
+ * pin while room for a whole segment remains; ring bytes are copied.  Waits
+ * for input, then for output room, as read and write would.
+ */
+int64_t pipe_transfer(vfs_node_t in_node, void *in_private, vfs_node_t out_node, void *out_private, uint64_t flags, size_t size, bool consume)
+{
+    pipe_endpoint_t *in  = in_private;
+    pipe_endpoint_t *out = out_private;
+    if (!in || !in->readable || !out || !out->writable) return -EBADF;
+    if (in->ring == out->ring) return -EINVAL;
+    if (!size) return 0;
+
+    pipe_ring_t *src = in->ring;
+    pipe_ring_t *dst = out->ring;
+    if (pipe_ring_prepare_segs(dst)) return -ENOMEM;
+
+    for (;;) {
+        pipe_ring_lock_pair(src, dst);
+        if (pipe_ring_readable(src) == 0 || src->splicing) {
+            if (!src->splicing && (src->closed || src->writers == 0)) {
+                pipe_ring_unlock_pair(src, dst);
+                return 0;
+            }
+            if (flags & O_NONBLOCK) {
+                pipe_ring_unlock_pair(src, dst);
+                return -EAGAIN;
+            }
+            if (pipe_signal_pending()) {
+                pipe_ring_unlock_pair(src, dst);
+                return -EINTR;
+            }
+            src->read_waiters++;
+            wait_queue_prepare(&src->read_wq);
+            pipe_ring_unlock_pair(src, dst);
+            wait_queue_sleep();
+            spin_lock(&src->lock);
+            if (src->read_waiters) src->read_waiters--;
+            spin_unlock(&src->lock);
+            continue;
+        }
+        if (dst->closed || dst->readers == 0) {
+            pipe_ring_unlock_pair(src, dst);
+            pipe_raise_sigpipe();
+            return -EPIPE;
+        }
+        if (pipe_ring_writable(dst) == 0) {
+            if (flags & O_NONBLOCK) {
+                pipe_ring_unlock_pair(src, dst);
+                return -EAGAIN;
+            }
+            if (pipe_signal_pending()) {
+                pipe_ring_unlock_pair(src, dst);
+                return -EINTR;
+            }
+            if (!dst->write_waiters || !dst->write_wake_threshold) dst->write_wake_threshold = 1;
+            dst->write_waiters++;
+            wait_queue_prepare(&dst->write_wq);
+            pipe_ring_unlock_pair(src, dst);
+            wait_queue_sleep();
+            spin_lock(&dst->lock);
+            if (dst->write_waiters) dst->write_waiters--;
+            if (!dst->write_waiters) dst->write_wake_threshold = 0;
+            spin_unlock(&dst->lock);
+            continue;
+        }
+        break;
+    }
+
+    bool          src_full  = pipe_ring_writable(src) == 0;
+    bool          dst_empty = pipe_ring_readable(dst) == 0;
+    pipe_cursor_t cursor    = {.byte_pos = src->tail};
+    uint32_t      limit     = size < pipe_ring_readable(src) ? (uint32_t)size : pipe_ring_readable(src);
+    uint32_t      done      = 0;
+    while (limit) {
+        uint32_t room = pipe_ring_writable(dst);
+        if (!room) break;
+
+        const uint8_t    *data;
+        pagecache_page_t *page;
+        uint32_t          len = pipe_cursor_next(src, &cursor, limit < room ? limit : room, &data, &page);
+        if (!len) break;
+        if (page && pipe_ring_page_room(dst, len)) {
+            pagecache_buffer_get(page);
+            pipe_ring_push_page(dst, page, (uint32_t)(data - (const uint8_t *)pagecache_page_data(page)), len);
+        } else {
+            pipe_ring_copy_in(dst, data, len);
+            pipe_ring_produce(dst, len);
+        }
+        done += len;
+        limit -= len;
+    }
+    if (consume) pipe_ring_consume(src, done);
+
+    __atomic_store_n(&dst->last_writer_cpu, get_current_cpu_id(), __ATOMIC_RELAXED);
+    bool wake_readers = done && dst_empty && dst->read_waiters != 0;
+    bool wake_writers = consume && done && src->write_waiters != 0 && pipe_ring_writable(src) >= src->write_wake_threshold;
+    if (consume) __atomic_store_n(&src->last_reader_cpu, get_current_cpu_id(), __ATOMIC_RELAXED);
+    pipe_ring_unlock_pair(src, dst);
+
+    if (wake_readers) wait_queue_wake_one_sync(&dst->read_wq);
+    if (wake_writers) wait_queue_wake_one_sync(&src->write_wq);
+    if (done && dst_empty) pipe_poll_notify(out_node, POLLIN);
+    if (done && consume && src_full) pipe_poll_notify(in_node, POLLOUT);
+    return (int64_t)done;
+}
+
 /* VFS callback: poll */
 static int pipe_vfs_poll(void *file, size_t events)
 {
@@ -855,7 +1300,7 @@ static int pipe_vfs_stat(void *file, vfs_node_t node)
     if (!node) return -EINVAL;
 
     pipe_ring_t *ring = (pipe_ring_t *)node->handle;
-    if (ring) node->size = ring->size;
+    if (ring) node->size = pipe_ring_readable(ring);
     node->type |= file_pipe;
     node->mode = PIPE_DEFAULT_MODE;
     return EOK;
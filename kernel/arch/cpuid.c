@@ -242,6 +242,24 @@ int cpu_support_avx512f(void)
     return ((ebx & (1 << 16)) != 0);
 }
 
+/* Check CPU supports process-context identifiers */
+int cpu_support_pcid(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0x00000001, &eax, &ebx, &ecx, &edx);
+    return ((ecx & (1 << 17)) != 0);
+}
+
+/* Check CPU supports the INVPCID instruction */
+int cpu_support_invpcid(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0x00000000, &eax, &ebx, &ecx, &edx);
+    if (eax < 7) return 0;
+    cpuid_count(0x00000007, 0, &eax, &ebx, &ecx, &edx);
+    return ((ebx & (1 << 10)) != 0);
+}
+
 /* Safe CPUID wrapper - uses local temporaries to avoid register clobber issues */
 void cpuid_safe(uint32_t leaf, uint32_t sub, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d)
 {
@@ -44,6 +44,18 @@ static volatile uint32_t  smp_tsc_aux_ready;
 spinlock_t                ap_start_lock = {0};
 static spinlock_t         tlb_shootdown_lock;
 
+/*
+ * The request published with each shootdown generation.  Initiators are
+ * serialized by tlb_shootdown_lock, and the descriptor is only rewritten once
+ * every target of the previous generation has acknowledged it.  A NULL
+ * directory requests a full flush.  The target mask is stored last, so a
+ * CPU that finds itself in it also observes the matching directory/range.
+ */
+static page_directory_t *volatile tlb_request_directory;
+static volatile uint64_t          tlb_request_start;
+static volatile uint64_t          tlb_request_end;
+static volatile uint64_t          tlb_request_targets[PAGE_TLB_MASK_SIZE];
+
 /*
  * CPUID leaves 0x1f/0x0b describe topology by giving bit shifts in the
  * x2APIC id.  The shifts are uniform across the machine, so the BSP can
@@ -102,6 +114,26 @@ static inline void flush_local_tlb_all(void)
     __asm__ volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
 }
 
+/*
+ * Carry out the published request on this CPU.  Only a CPU named in the
+ * target mask may touch the request's directory (its initiator is still
+ * waiting, so it is alive); anything else falls back to a full flush.
+ */
+static void tlb_shootdown_apply(uint32_t cpu_id)
+{
+    if (cpu_id >= PAGE_TLB_MAX_CPUS) {
+        flush_local_tlb_all();
+        return;
+    }
+    uint64_t          targeted  = __atomic_load_n(&tlb_request_targets[cpu_id / PAGE_TLB_MASK_BITS], __ATOMIC_ACQUIRE) & (1ULL << (cpu_id % PAGE_TLB_MASK_BITS));
+    page_directory_t *directory = __atomic_load_n(&tlb_request_directory, __ATOMIC_ACQUIRE);
+    if (!targeted || !directory) {
+        flush_local_tlb_all();
+        return;
+    }
+    page_tlb_flush_local(directory, tlb_request_start, tlb_request_end);
+}
+
 /* Handle an NMI on this CPU, flushing the local TLB if a shootdown is pending */
 int smp_handle_nmi(void)
 {
@@ -121,7 +153,7 @@ int smp_handle_nmi(void)
         generation = __atomic_load_n(&tlb_shootdown_generation, __ATOMIC_ACQUIRE);
         if (__atomic_load_n(&tlb_shootdown_ack[cpu_id], __ATOMIC_ACQUIRE) >= generation) return 0;
 
-        flush_local_tlb_all();
+        tlb_shootdown_apply(cpu_id);
         __atomic_store_n(&tlb_shootdown_ack[cpu_id], generation, __ATOMIC_RELEASE);
     } while (__atomic_load_n(&tlb_shootdown_generation, __ATOMIC_RELAXED) != generation);
 
@@ -256,14 +288,24 @@ void send_ipi_self(uint8_t vector)
     if (cpu_id < cpu_count) send_ipi(cpus[cpu_id].lapic_id, vector);
 }
 
-/* Flush TLBs of all CPUs */
-void flush_tlb_all(void)
+/* Whether cpu is named by a shootdown target mask; untracked CPUs always are */
+static int tlb_cpu_targeted(const volatile uint64_t *targets, size_t cpu)
 {
-    flush_local_tlb_all();
-    if (!__atomic_load_n(&smp_ready, __ATOMIC_ACQUIRE) || cpu_count < 2 || !tlb_shootdown_ack) return;
+    if (cpu >= PAGE_TLB_MAX_CPUS) return 1;
+    return (targets[cpu / PAGE_TLB_MASK_BITS] >> (cpu % PAGE_TLB_MASK_BITS)) & 1;
+}
+
+/*
+ * Publish the request in the descriptor, raise the generation and wait for
+ * every targeted CPU.  Called with tlb_shootdown_lock held.
+ */
+static void tlb_shootdown_locked(uint32_t self, page_directory_t *directory, uint64_t start, uint64_t end, const uint64_t *targets)
+{
+    __atomic_store_n(&tlb_request_directory, directory, __ATOMIC_RELAXED);
+    __atomic_store_n(&tlb_request_start, start, __ATOMIC_RELAXED);
+    __atomic_store_n(&tlb_request_end, end, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < PAGE_TLB_MASK_SIZE; i++) __atomic_store_n(&tlb_request_targets[i], targets[i], __ATOMIC_RELEASE);
 
-    uint64_t irq_flags  = spin_lock_irqsave(&tlb_shootdown_lock);
-    uint32_t self       = get_current_cpu_id();
     uint64_t generation = __atomic_add_fetch(&tlb_shootdown_generation, 1, __ATOMIC_ACQ_REL);
     __atomic_store_n(&tlb_shootdown_ack[self], generation, __ATOMIC_RELEASE);
 
@@ -279,12 +321,12 @@ void flush_tlb_all(void)
     const uint64_t resend_period = 200000ULL; /* ~80 us at 2.5 GHz TSC */
 
     for (size_t i = 0; i < cpu_count; i++) {
-        if (i == self) continue;
+        if (i == self || !tlb_cpu_targeted(targets, i)) continue;
         send_ipi(cpus[i].lapic_id, IPI_NMI | APIC_ICR_PHYSICAL);
     }
 
     for (size_t i = 0; i < cpu_count; i++) {
-        if (i == self) continue;
+        if (i == self || !tlb_cpu_targeted(targets, i)) continue;
         uint64_t deadline = rdtsc() + resend_period;
         while (__atomic_load_n(&tlb_shootdown_ack[i], __ATOMIC_ACQUIRE) < generation) {
             if (rdtsc() > deadline) {
@@ -294,10 +336,62 @@ void flush_tlb_all(void)
             __asm__ volatile("pause");
         }
     }
+}
+
+/* Flush TLBs of all CPUs */
+void flush_tlb_all(void)
+{
+    flush_local_tlb_all();
+    if (!__atomic_load_n(&smp_ready, __ATOMIC_ACQUIRE) || cpu_count < 2 || !tlb_shootdown_ack) return;
+
+    uint64_t targets[PAGE_TLB_MASK_SIZE];
+    for (size_t i = 0; i < PAGE_TLB_MASK_SIZE; i++) targets[i] = UINT64_MAX;
+
+    uint64_t irq_flags = spin_lock_irqsave(&tlb_shootdown_lock);
+    tlb_shootdown_locked(get_current_cpu_id(), NULL, 0, 0, targets);
     spin_unlock_irqrestore(&tlb_shootdown_lock, irq_flags);
 }
 
-/* Flushing TLB by address range */
+/*
+ * Invalidate [start, end) of one user address space.  Only CPUs that have
+ * the directory loaded (or have not yet noticed they left it) are
+ * interrupted; idle PCIDs catch up through the generation bump when the
+ * directory is next switched in.
+ */
+void flush_tlb_mm_range(page_directory_t *directory, uint64_t start, uint64_t end)
+{
+    if (!directory || !directory->tlb_id || end > PAGE_USER_SPACE_END) {
+        flush_tlb_all();
+        return;
+    }
+    if (start >= end) return;
+
+    /* Bump before sampling the mask; pairs with switch_page_directory(). */
+    __atomic_add_fetch(&directory->tlb_generation, 1, __ATOMIC_SEQ_CST);
+
+    uint64_t rflags = get_rflags();
+    disable_intr();
+    page_tlb_flush_local(directory, start, end);
+
+    if (__atomic_load_n(&smp_ready, __ATOMIC_ACQUIRE) && cpu_count > 1 && tlb_shootdown_ack) {
+        uint32_t self   = get_current_cpu_id();
+        int      remote = cpu_count > PAGE_TLB_MAX_CPUS;
+        uint64_t targets[PAGE_TLB_MASK_SIZE];
+        for (size_t i = 0; i < PAGE_TLB_MASK_SIZE; i++) {
+            targets[i] = __atomic_load_n(&directory->cpu_mask[i], __ATOMIC_SEQ_CST);
+            if (self / PAGE_TLB_MASK_BITS == i) targets[i] &= ~(1ULL << (self % PAGE_TLB_MASK_BITS));
+            if (targets[i]) remote = 1;
+        }
+        if (remote) {
+            uint64_t irq_flags = spin_lock_irqsave(&tlb_shootdown_lock);
+            tlb_shootdown_locked(self, directory, start, end, targets);
+            spin_unlock_irqrestore(&tlb_shootdown_lock, irq_flags);
+        }
+    }
+    if (rflags & (1ULL << 9)) enable_intr();
+}
+
+/* Flushing TLB by address range on this CPU only */
 void flush_tlb_range(uint64_t start, uint64_t end)
 {
     for (uint64_t addr = start; addr < end; addr += PAGE_4K_SIZE) flush_tlb(addr);
@@ -452,6 +546,9 @@ void ap_entry(struct limine_smp_info *info)
     /* Establish the kernel-mode GS base for this AP. */
     cpu_gs_install(cpu);
 
+    /* Tag address spaces with PCIDs on this AP as well. */
+    page_tlb_init_cpu();
+
     /* Initializing Local APIC */
     local_apic_init();
 
@@ -18,6 +18,7 @@
 #include <mem/heap.h>
 #include <mem/hhdm.h>
 #include <mem/page.h>
+#include <mem/rmap.h>
 #include <process/elf_loader.h>
 #include <process/process.h>
 #include <process/sched.h>
@@ -35,8 +36,15 @@ typedef struct elf_source {
         size_t         window_capacity;
         size_t         window_offset;
         size_t         window_size;
+        bool           pinned; // node's page cache is pinned; segments fault in from it
 } elf_source_t;
 
+typedef enum {
+    ELF_PAGE_FILE, // shared with the page cache until written
+    ELF_PAGE_ZERO, // demand-zero
+    ELF_PAGE_COPY, // filled and mapped at load time
+} elf_page_backing_t;
+
 /* Read from the ELF source (memory buffer or VFS node), using the window when useful */
 static int elf_source_read(elf_source_t *source, size_t offset, void *buffer, size_t size)
 {
@@ -74,6 +82,31 @@ static int elf_source_read(elf_source_t *source, size_t offset, void *buffer, si
     return 0;
 }
 
+/*
+ * Prepare a node source for loading.  If the node's page cache can back
+ * mappings, it is pinned and the segments are faulted in from it later;
+ * otherwise they are copied now through a read window of window_capacity.
+ */
+static void elf_source_setup(elf_source_t *source, size_t window_capacity)
+{
+    if (source->node && vfs_cache_mapping_pin(source->node) == EOK) {
+        source->pinned = true;
+        return;
+    }
+    source->window_capacity = window_capacity;
+    source->window          = malloc(source->window_capacity);
+    if (!source->window) source->window_capacity = 0;
+}
+
+/* Drop the read window and page-cache pin taken by elf_source_setup() */
+static void elf_source_release(elf_source_t *source)
+{
+    free(source->window);
+    source->window = NULL;
+    if (source->pinned) vfs_cache_mapping_unpin(source->node);
+    source->pinned = false;
+}
+
 /* Validate the ELF header fields relevant to a process image */
 static int validate_ehdr(const Elf64_Ehdr *ehdr, size_t size)
 {
@@ -166,7 +199,6 @@ static int elf_segment_range(const Elf64_Phdr *segment, uintptr_t load_bias, uin
 static int elf_page_attributes(const Elf64_Phdr *phdr, int phnum, uintptr_t load_bias, uintptr_t va, uint64_t *pte_flags_out, vm_flags_t *vm_flags_out)
 {
     int       covered    = 0;
-    int       readable   = 0;
     int       writable   = 0;
     int       executable = 0;
     uintptr_t page_end   = va + PAGE_4K_SIZE;
@@ -179,7 +211,6 @@ static int elf_page_attributes(const Elf64_Phdr *phdr, int phnum, uintptr_t load
         if (va >= seg_end || page_end <= seg_start) continue;
 
         covered = 1;
-        if (phdr[i].flags & PF_R) readable = 1;
         if (phdr[i].flags & PF_W) writable = 1;
         if (phdr[i].flags & PF_X) executable = 1;
     }
@@ -190,8 +221,8 @@ static int elf_page_attributes(const Elf64_Phdr *phdr, int phnum, uintptr_t load
     if (writable) pte_flags |= PTE_WRITEABLE;
     if (!executable) pte_flags |= PTE_NO_EXECUTE;
 
-    vm_flags_t vm_flags = 0;
-    if (readable) vm_flags |= VM_READ;
+    /* Every present x86 page is readable, and demand faults require VM_READ. */
+    vm_flags_t vm_flags = VM_READ;
     if (writable) vm_flags |= VM_WRITE;
     if (executable) vm_flags |= VM_EXEC;
 
@@ -200,8 +231,46 @@ static int elf_page_attributes(const Elf64_Phdr *phdr, int phnum, uintptr_t load
     return 1;
 }
 
-/* Record a non-overlapping VMA for a loaded PT_LOAD range */
-static int insert_elf_vma(process_t *proc, uintptr_t start, uintptr_t end, vm_flags_t flags)
+/*
+ * Decide how one covered page is backed.  The page can come straight from
+ * the page cache when every segment with file bytes in it agrees on the
+ * file page and no segment's zero-filled tail (.bss) reaches into it.  A
+ * page without file bytes is demand-zero; anything else is copied at load.
+ */
+static elf_page_backing_t elf_page_backing(const Elf64_Phdr *phdr, int phnum, uintptr_t load_bias, uintptr_t va, uint64_t *pgoff_out)
+{
+    bool      file     = false;
+    bool      bss      = false;
+    uint64_t  pgoff    = 0;
+    uintptr_t page_end = va + PAGE_4K_SIZE;
+
+    for (int i = 0; i < phnum; i++) {
+        if (phdr[i].type != PT_LOAD || phdr[i].memsz == 0) continue;
+
+        uintptr_t base, seg_start, seg_end;
+        if (elf_segment_range(&phdr[i], load_bias, &base, &seg_start, &seg_end) <= 0) continue;
+        if (va >= seg_end || page_end <= seg_start) continue;
+
+        uintptr_t file_end = base + phdr[i].filesz;
+        if (base + phdr[i].memsz > file_end && va < base + phdr[i].memsz && file_end < page_end) bss = true;
+        if (!phdr[i].filesz || va >= file_end || page_end <= base) continue;
+
+        /* A file page is only shareable when the segment keeps file and memory in page step. */
+        if ((base - phdr[i].offset) & (PAGE_4K_SIZE - 1)) return ELF_PAGE_COPY;
+        uint64_t index = phdr[i].offset / PAGE_4K_SIZE + (va - seg_start) / PAGE_4K_SIZE;
+        if (file && index != pgoff) return ELF_PAGE_COPY;
+        file  = true;
+        pgoff = index;
+    }
+
+    if (!file) return ELF_PAGE_ZERO;
+    if (bss) return ELF_PAGE_COPY;
+    *pgoff_out = pgoff;
+    return ELF_PAGE_FILE;
+}
+
+/* Record a non-overlapping VMA for a loaded PT_LOAD range, backed by file from pgoff if given */
+static int insert_elf_vma(process_t *proc, uintptr_t start, uintptr_t end, vm_flags_t flags, vfs_node_t file, uint64_t pgoff)
 {
     if (start >= end) return 0;
 
@@ -211,7 +280,22 @@ static int insert_elf_vma(process_t *proc, uintptr_t start, uintptr_t end, vm_fl
     vma->end   = end;
     vma->flags = flags;
     vma->type  = VM_REGION_MMAP;
+    if (file) {
+        vma->flags |= VM_LAZY;
+        vma->vm_file      = vfs_node_retain(file);
+        vma->vm_pgoff     = pgoff;
+        vma->vm_pagecache = true;
+        if (!vma->vm_file || vfs_cache_mapping_pin(vma->vm_file) != EOK) {
+            if (vma->vm_file) vfs_close(vma->vm_file);
+            free(vma);
+            return -ENOMEM;
+        }
+    }
     if (vm_area_insert(proc, vma)) {
+        if (vma->vm_file) {
+            vfs_cache_mapping_unpin(vma->vm_file);
+            vfs_close(vma->vm_file);
+        }
         free(vma);
         return -ENOMEM;
     }
@@ -246,12 +330,16 @@ static int load_elf_segments_source(process_t *proc, const Elf64_Ehdr *ehdr, con
      * ELF files commonly put the end of an R segment and the beginning of
      * the following RW segment in the same page (GNU_RELRO).  Loading one
      * segment at a time incorrectly treats that normal layout as a collision.
+     * With a pinned page cache only the pages elf_page_backing() cannot
+     * share are copied here; the rest fault in on first touch.
      */
     for (uintptr_t va = lowest_start; va < highest_end; va += PAGE_4K_SIZE) {
         uint64_t   pte_flags;
         vm_flags_t vm_flags;
+        uint64_t   pgoff;
         if (!elf_page_attributes(phdr, ehdr->e_phnum, load_bias, va, &pte_flags, &vm_flags)) continue;
         (void)vm_flags;
+        if (source->pinned && elf_page_backing(phdr, ehdr->e_phnum, load_bias, va, &pgoff) != ELF_PAGE_COPY) continue;
 
         uint64_t frame = alloc_frames(1);
         if (!frame) return -ENOMEM;
@@ -262,6 +350,7 @@ static int load_elf_segments_source(process_t *proc, const Elf64_Ehdr *ehdr, con
             (void)frame_release_range(frame, 1);
             return -ENOMEM;
         }
+        rmap_add_anon(frame, proc, va);
 
         for (int i = 0; i < ehdr->e_phnum; i++) {
             if (phdr[i].type != PT_LOAD || phdr[i].filesz == 0) continue;
@@ -282,34 +371,41 @@ static int load_elf_segments_source(process_t *proc, const Elf64_Ehdr *ehdr, con
         }
     }
 
-    /* Build non-overlapping VMAs, merging pages with identical permissions. */
+    /*
+     * Build non-overlapping VMAs, merging pages with identical permissions
+     * and backing.  A file-backed run also needs consecutive file pages.
+     */
     uintptr_t  run_start = 0;
     uintptr_t  run_end   = 0;
     vm_flags_t run_flags = 0;
+    vfs_node_t run_file  = NULL;
+    uint64_t   run_pgoff = 0;
     for (uintptr_t va = lowest_start; va < highest_end; va += PAGE_4K_SIZE) {
         uint64_t   pte_flags;
         vm_flags_t vm_flags;
         if (!elf_page_attributes(phdr, ehdr->e_phnum, load_bias, va, &pte_flags, &vm_flags)) {
-            if (run_start && insert_elf_vma(proc, run_start, run_end, run_flags)) return -ENOMEM;
+            if (run_start && insert_elf_vma(proc, run_start, run_end, run_flags, run_file, run_pgoff)) return -ENOMEM;
             run_start = 0;
             continue;
         }
         (void)pte_flags;
 
-        if (!run_start) {
-            run_start = va;
-            run_end   = va + PAGE_4K_SIZE;
-            run_flags = vm_flags;
-        } else if (run_end != va || run_flags != vm_flags) {
-            if (insert_elf_vma(proc, run_start, run_end, run_flags)) return -ENOMEM;
-            run_start = va;
-            run_end   = va + PAGE_4K_SIZE;
-            run_flags = vm_flags;
-        } else {
+        uint64_t   pgoff = 0;
+        vfs_node_t file  = NULL;
+        if (source->pinned && elf_page_backing(phdr, ehdr->e_phnum, load_bias, va, &pgoff) == ELF_PAGE_FILE) file = source->node;
+
+        if (run_start && run_end == va && run_flags == vm_flags && run_file == file && (!file || run_pgoff + (va - run_start) / PAGE_4K_SIZE == pgoff)) {
             run_end += PAGE_4K_SIZE;
+            continue;
         }
+        if (run_start && insert_elf_vma(proc, run_start, run_end, run_flags, run_file, run_pgoff)) return -ENOMEM;
+        run_start = va;
+        run_end   = va + PAGE_4K_SIZE;
+        run_flags = vm_flags;
+        run_file  = file;
+        run_pgoff = pgoff;
     }
-    if (run_start && insert_elf_vma(proc, run_start, run_end, run_flags)) return -ENOMEM;
+    if (run_start && insert_elf_vma(proc, run_start, run_end, run_flags, run_file, run_pgoff)) return -ENOMEM;
 
     if (set_brk && highest_end > PROCESS_HEAP_START) proc->start_brk = proc->heap_brk = highest_end;
     return 0;
@@ -454,10 +550,8 @@ int elf_loader_load_interpreter(struct process *proc, const char *interp_path, E
 
     uintptr_t load_bias = compute_load_bias(&ehdr, phdr, interp_base);
 
-    /* Stream the linker through a small window instead of copying its entire file per exec. */
-    source.window_capacity = 64U * 1024U;
-    source.window          = malloc(source.window_capacity);
-    if (!source.window) source.window_capacity = 0;
+    /* Map the linker from the page cache, or stream it through a small window if that is unavailable. */
+    elf_source_setup(&source, 64U * 1024U);
 
     result = load_elf_segments_source(proc, &ehdr, phdr, &source, load_bias, 0);
     if (result) goto out;
@@ -480,7 +574,7 @@ int elf_loader_load_interpreter(struct process *proc, const char *interp_path, E
     *entry_out = ehdr.e_entry + load_bias;
     result     = 0;
 out:
-    free(source.window);
+    elf_source_release(&source);
     free(phdr);
     vfs_close(node);
     return result;
@@ -778,12 +872,12 @@ int elf_loader_load_user_node(process_t *proc, vfs_node_t node, char *const argv
     }
 
     /*
-     * A bounded read-ahead window keeps large node-backed images streaming
-     * while avoiding one VFS/page-cache lookup for every mapped 4 KiB page.
+     * Segments normally fault in from the page cache, so read-only text is
+     * shared by every process running the image.  Without a cacheable node
+     * a bounded read-ahead window keeps the eager copy streaming while
+     * avoiding one VFS lookup for every mapped 4 KiB page.
      */
-    source.window_capacity = (size_t)1024 * 1024;
-    source.window          = malloc(source.window_capacity);
-    if (!source.window) source.window_capacity = 0;
+    elf_source_setup(&source, (size_t)1024 * 1024);
 
     uintptr_t load_bias = 0;
     if (ehdr.e_type == ET_DYN) load_bias = compute_load_bias(&ehdr, phdrs, PROCESS_USER_CODE_MIN);
@@ -807,12 +901,12 @@ int elf_loader_load_user_node(process_t *proc, vfs_node_t node, char *const argv
 
     int seg_ret = load_elf_segments_source(proc, &ehdr, phdrs, &source, load_bias, 1);
     if (seg_ret) {
-        free(source.window);
+        elf_source_release(&source);
         free(phdrs);
         return seg_ret;
     }
     if (process_mmap(proc, proc->stack_brk, (size_t)PROCESS_STACK_SIZE, VM_READ | VM_WRITE | VM_LAZY)) {
-        free(source.window);
+        elf_source_release(&source);
         free(phdrs);
         return -ENOMEM;
     }
@@ -826,7 +920,7 @@ int elf_loader_load_user_node(process_t *proc, vfs_node_t node, char *const argv
     if (has_interp) {
         int interp_ret = elf_loader_load_interpreter(proc, interp_path, &interpreter_base, &interpreter_entry);
         if (interp_ret) {
-            free(source.window);
+            elf_source_release(&source);
             free(phdrs);
             return interp_ret;
         }
@@ -844,7 +938,7 @@ int elf_loader_load_user_node(process_t *proc, vfs_node_t node, char *const argv
         }
     }
     if (!valid_entry) {
-        free(source.window);
+        elf_source_release(&source);
         free(phdrs);
         return -ENOEXEC;
     }
@@ -852,7 +946,7 @@ int elf_loader_load_user_node(process_t *proc, vfs_node_t node, char *const argv
     uintptr_t user_rsp  = 0;
     int       stack_ret = setup_user_stack(proc, phdr_addr, ehdr.e_phnum, ehdr.e_phentsize, interpreter_base, ehdr.e_entry + load_bias, argv, envp, &user_rsp);
     if (stack_ret) {
-        free(source.window);
+        elf_source_release(&source);
         free(phdrs);
         return stack_ret;
     }
@@ -867,7 +961,7 @@ int elf_loader_load_user_node(process_t *proc, vfs_node_t node, char *const argv
     proc->task->context.rdi    = 0;
     if (entry_out) *entry_out = actual_entry;
     if (rsp_out) *rsp_out = user_rsp;
-    free(source.window);
+    elf_source_release(&source);
     free(phdrs);
     return 0;
 }
@@ -32,6 +32,7 @@
 #include <mem/heap.h>
 #include <mem/hhdm.h>
 #include <mem/page.h>
+#include <mem/rmap.h>
 #include <net/socket.h>
 #include <process/file_status.h>
 #include <process/process.h>
@@ -483,6 +484,7 @@ int setup_process_page_dir(process_t *proc)
     new_dir->table       = pml4;
     new_dir->lock.lock   = 0;
     new_dir->lock.rflags = 0;
+    page_directory_tlb_init(new_dir);
 
     page_directory_t *kern_dir  = get_kernel_pagedir();
     page_table_t     *kern_pml4 = kern_dir->table;
@@ -2386,7 +2388,7 @@ process_t *process_fork_status_event_mode(int *error, uint32_t ptrace_event, boo
      * parent directory lock was still held; nothing here can reintroduce a
      * stale writable translation before the child runs.
      */
-
+    rmap_clone_user(child->user_page_dir, child);
     return child;
 }
 
@@ -2658,6 +2660,8 @@ int process_mmap(process_t *proc, uintptr_t addr, size_t length, vm_flags_t flag
         for (size_t i = 0; i < mapped; i++) frames[i] = 0;
         goto rollback_frames;
     }
+    if (!(flags & VM_SHARED))
+        for (size_t i = 0; i < pages; i++) rmap_add_anon(frames[i], proc, addr + i * PAGE_4K_SIZE);
 
     vma->type = VM_REGION_MMAP;
     if (previous) {
@@ -2759,6 +2763,8 @@ int process_demand_fault(process_t *proc, uintptr_t addr, int write, int exec)
             spin_unlock(&proc->mmap_lock);
             goto fail;
         }
+    } else if (!vm_file && !(flags & VM_SHARED)) {
+        rmap_add_anon(frame, proc, page);
     }
     spin_unlock(&proc->mmap_lock);
     if (vm_file) vfs_close(vm_file);
@@ -2805,8 +2811,13 @@ int process_unmap_complete_range(process_t *proc, uintptr_t addr, size_t length)
     }
     spin_unlock(&proc->mmap_lock);
 
-    for (uintptr_t va = addr; va < end; va += PAGE_4K_SIZE)
-        if (page_unmap_release(proc->user_page_dir, va) < 0) return -ENOMEM;
+    tlb_batch_t batch;
+    int         unmapped = EOK;
+    tlb_batch_init(&batch, proc->user_page_dir);
+    for (uintptr_t va = addr; va < end && unmapped == EOK; va += PAGE_4K_SIZE)
+        if (page_unmap_release_batch(&batch, va) < 0) unmapped = -ENOMEM;
+    tlb_batch_finish(&batch);
+    if (unmapped != EOK) return unmapped;
 
     vm_area_t *removed = NULL;
     spin_lock(&proc->mmap_lock);
@@ -177,12 +177,12 @@ task_t *task_alloc_status(const char *name, int *error)
     task->base_weight              = SCHED_NICE_0_LOAD;
     task->pi_weight                = SCHED_NICE_0_LOAD;
     task->blocked_on               = NULL;
+    task->timer_cpu                = -1;
     task->thread.fs_base           = 0;
     task->thread.gs_base           = 0;
     ptrace_state_init(&task->ptrace);
     task_name_copy(task, name);
     ilist_init(&task->sched_node);
-    ilist_init(&task->timer_node);
     ilist_init(&task->thread_node);
     ilist_init(&task->cgroup_node);
     wait_queue_init(&task->kthread.exit_wait);
@@ -230,6 +230,7 @@ void task_free(task_t *task)
 
     seccomp_task_release(task);
     cgroup_task_exit(task);
+    sched_timer_release(task);
 
     spin_lock(&pid_hash_lock);
     pid_entry_t *pid_entry = pid_hash_remove(task);
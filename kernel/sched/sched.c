@@ -17,6 +17,9 @@
 #include <kernel/debug/debug.h>
 #include <kernel/errno.h>
 #include <kernel/printk.h>
+#include <kernel/timer/hrtimer.h>
+#include <kernel/timer/tick.h>
+#include <kernel/timer/timer.h>
 #include <libs/list/intrusive_list.h>
 #include <libs/std/stddef.h>
 #include <libs/std/stdint.h>
@@ -112,10 +115,10 @@ static task_t *sched_node_to_task(ilist_node_t *node)
     return (task_t *)((uint8_t *)node - offsetof(task_t, sched_node));
 }
 
-/* Return the task whose timer-list node is given */
-static task_t *timer_node_to_task(ilist_node_t *node)
+/* Return the task whose timer-tree node is given */
+static task_t *timer_node_to_task(const rb_node_t *node)
 {
-    return (task_t *)((uint8_t *)node - offsetof(task_t, timer_node));
+    return rb_entry(node, task_t, timer_node);
 }
 
 /* EEVDF core: virtual-time arithmetic */
@@ -525,7 +528,7 @@ void enqueue_task_initial(task_t *task)
 }
 
 /* Wake a sleeping or blocked task, enqueueing it if runnable */
-static void wake_task_locked(task_t *task, int remove_linked_node)
+static void wake_task_locked(task_t *task)
 {
     if (!task) return;
 
@@ -545,7 +548,6 @@ static void wake_task_locked(task_t *task, int remove_linked_node)
         return;
     }
 
-    if (remove_linked_node && ilist_remove(&task->sched_node)) panic("sched: corrupt sleep-queue node on wake (task %llu %s)", task->pid, task->name);
     if (task->process && __atomic_load_n(&task->process->signal.group_stopped, __ATOMIC_ACQUIRE)) {
         task->state     = TASK_STOPPED;
         task->wake_tick = 0;
@@ -572,7 +574,18 @@ static void place_waking_task_locked(task_t *task, bool sync)
     __atomic_add_fetch(&cpu_rqs[new_cpu].nr_wakeups, 1, __ATOMIC_RELAXED);
 }
 
-/* Wait-queue and timer membership are serialized by scheduler.lock. */
+/*
+ * Disarm a task's tick deadline.  This only clears the armed flag, so a wake
+ * on one CPU never touches the timer tree of the CPU the task slept on: the
+ * stale entry is dropped when it reaches the front of that tree, or when the
+ * task arms a new deadline or is freed.
+ */
+static void sched_timer_cancel(task_t *task)
+{
+    __atomic_store_n(&task->timer_armed, 0, __ATOMIC_RELEASE);
+}
+
+/* Wait-queue membership is serialized by scheduler.lock. */
 static void finish_wait_locked(task_t *task, task_wake_reason_t reason)
 {
     if (!task || !task->wait_queue) return;
@@ -589,12 +602,9 @@ static void finish_wait_locked(task_t *task, task_wake_reason_t reason)
     task->wake_reason = reason;
     task->wake_tick   = 0;
 
-    /*
-     * The timer node lives independently of the wait queue, but a timed
-     * waiter always has both linked; drop the timer entry on any wake.
-     */
-    if (ilist_is_linked(&task->timer_node) && ilist_remove(&task->timer_node)) panic("sched: timer node unlink failed (task %llu %s)", task->pid, task->name);
-    if (task->state == TASK_BLOCKED) wake_task_locked(task, 0);
+    /* A timed waiter may still have its deadline queued; disarm it on any wake. */
+    sched_timer_cancel(task);
+    if (task->state == TASK_BLOCKED) wake_task_locked(task);
 }
 
 /* Send a reschedule IPI to a CPU when it is remote. */
@@ -616,39 +626,119 @@ void request_task_cpu(task_t *task)
     request_cpu_reschedule(task->cpu_id);
 }
 
-/* Insert a sleeping task into the deadline-ordered sleep queue. */
-static void insert_sleep_deadline_locked(task_t *task)
+/* Per-CPU deadline timers */
+
+/*
+ * Sleeping tasks and timed waiters queue their tick deadline on the timer
+ * tree of the CPU they went to sleep on, and that CPU expires them from its
+ * own tick.  Arming only ever touches the local tree, cancellation is the
+ * lock-free sched_timer_cancel(), and expiry takes scheduler.lock only when
+ * a deadline is actually due.  Lock order: scheduler.lock, then timer_lock,
+ * then a runqueue lock.
+ */
+
+/* Order deadlines by tick; equal deadlines keep their arming order. */
+static int sched_timer_less(const rb_node_t *a, const rb_node_t *b)
+{
+    return timer_node_to_task(a)->timer_expires < timer_node_to_task(b)->timer_expires;
+}
+
+/* Unlink a queued deadline from its CPU's tree (timer_lock held). */
+static void sched_timer_dequeue_locked(eevdf_rq_t *rq, task_t *task)
 {
-    ilist_node_t *position = scheduler.sleep_queue.next;
+    rb_erase_augmented(&rq->timers, &task->timer_node, NULL, NULL);
+    __atomic_store_n(&task->timer_cpu, -1, __ATOMIC_RELEASE);
+}
+
+/* Republish the earliest queued deadline of a CPU (timer_lock held). */
+static void sched_timer_update_next_locked(eevdf_rq_t *rq)
+{
+    rb_node_t *first = rb_first(&rq->timers);
+    __atomic_store_n(&rq->timer_next, first ? timer_node_to_task(first)->timer_expires : UINT64_MAX, __ATOMIC_RELEASE);
+}
+
+/* sched_timer_release - drop a task's queued deadline, armed or stale */
+void sched_timer_release(task_t *task)
+{
+    if (!task || !cpu_rqs) return;
+
+    for (;;) {
+        int32_t cpu = __atomic_load_n(&task->timer_cpu, __ATOMIC_ACQUIRE);
+        if (cpu < 0 || (uint32_t)cpu >= cpu_scheduler_count) return;
+
+        eevdf_rq_t *rq = &cpu_rqs[cpu];
+        spin_lock(&rq->timer_lock);
+        if (__atomic_load_n(&task->timer_cpu, __ATOMIC_ACQUIRE) == cpu) {
+            sched_timer_dequeue_locked(rq, task);
+            sched_timer_update_next_locked(rq);
+            spin_unlock(&rq->timer_lock);
+            return;
+        }
 
-    while (position != &scheduler.sleep_queue) {
-        task_t *queued = sched_node_to_task(position);
-        if (task->wake_tick < queued->wake_tick) break;
-        position = position->next;
+        /* The owning CPU expired it meanwhile. */
+        spin_unlock(&rq->timer_lock);
     }
-    if (ilist_insert_before(position, &task->sched_node)) panic("sched: sleep-queue insert rejected (task %llu %s)", task->pid, task->name);
 }
 
-/* Insert a timed wait into the separately-linked deadline queue. */
-static void insert_timer_deadline_locked(task_t *task)
+/*
+ * Queue the current task's deadline on the local timer tree and enter state.
+ * Publishing the state under timer_lock keeps expiry from seeing an armed
+ * deadline of a task that has not committed to sleeping yet.
+ */
+static void sched_timer_arm(task_t *task, uint64_t expires, task_state_t state)
 {
-    ilist_node_t *position = scheduler.timer_queue.next;
+    sched_timer_release(task);
+
+    uint32_t    cpu = get_current_cpu_id();
+    eevdf_rq_t *rq  = &cpu_rqs[cpu];
+
+    spin_lock(&rq->timer_lock);
+    task->timer_expires = expires;
+    task->wake_tick     = expires;
+    rb_insert_augmented(&rq->timers, &task->timer_node, sched_timer_less, NULL, NULL);
+    __atomic_store_n(&task->timer_cpu, (int32_t)cpu, __ATOMIC_RELEASE);
+    __atomic_store_n(&task->timer_armed, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&task->state, state, __ATOMIC_RELEASE);
+    if (expires < rq->timer_next) __atomic_store_n(&rq->timer_next, expires, __ATOMIC_RELEASE);
+    spin_unlock(&rq->timer_lock);
+}
 
-    while (position != &scheduler.timer_queue) {
-        task_t *queued = timer_node_to_task(position);
-        if (task->wake_tick < queued->wake_tick) break;
-        position = position->next;
+/* Wake the tasks whose deadlines on a CPU's timer tree have expired by now. */
+static void sched_run_timers(uint32_t cpu_id, uint64_t now)
+{
+    eevdf_rq_t *rq = &cpu_rqs[cpu_id];
+    if (__atomic_load_n(&rq->timer_next, __ATOMIC_ACQUIRE) > now) return;
+
+    spin_lock(&scheduler.lock);
+    spin_lock(&rq->timer_lock);
+    for (;;) {
+        rb_node_t *first = rb_first(&rq->timers);
+        if (!first) break;
+
+        task_t *task = timer_node_to_task(first);
+        if (task->timer_expires > now) break;
+
+        sched_timer_dequeue_locked(rq, task);
+        if (!__atomic_exchange_n(&task->timer_armed, 0, __ATOMIC_ACQ_REL)) continue; // cancelled by an earlier wake
+        rq->timer_expired++;
+
+        place_waking_task_locked(task, false);
+        if (task->state == TASK_SLEEPING)
+            wake_task_locked(task);
+        else
+            finish_wait_locked(task, TASK_WAKE_TIMEOUT);
+        request_cpu_reschedule(task->cpu_id);
     }
-    if (ilist_insert_before(position, &task->timer_node)) panic("sched: timer-queue insert rejected (task %llu %s)", task->pid, task->name);
+    sched_timer_update_next_locked(rq);
+    spin_unlock(&rq->timer_lock);
+    spin_unlock(&scheduler.lock);
 }
 
-/* Put a task to sleep until a wake tick */
-static void sleep_task(task_t *task, uint64_t wake_tick)
+/* sched_next_timer_tick - earliest deadline queued on a CPU */
+uint64_t sched_next_timer_tick(uint32_t cpu_id)
 {
-    task->state      = TASK_SLEEPING;
-    task->wake_tick  = wake_tick;
-    task->wait_queue = NULL;
-    insert_sleep_deadline_locked(task);
+    if (!cpu_rqs || cpu_id >= cpu_scheduler_count) return UINT64_MAX;
+    return __atomic_load_n(&cpu_rqs[cpu_id].timer_next, __ATOMIC_ACQUIRE);
 }
 
 /* Load balancing */
@@ -1101,49 +1191,38 @@ static task_t *rebalance_domains_locked(uint32_t dst_cpu)
     return first;
 }
 
-/* Wake sleeping tasks and timed wait-queue tasks whose deadlines have expired */
-static void wake_sleeping_tasks(void)
+/* Account ticks a CPU skipped while its periodic tick was stopped in idle. */
+void sched_tick_skipped(uint32_t cpu_id, uint64_t ticks)
 {
-    while (!ilist_is_empty(&scheduler.sleep_queue)) {
-        ilist_node_t *node = scheduler.sleep_queue.next;
-        task_t       *task = sched_node_to_task(node);
+    if (!cpu_rqs || cpu_id >= cpu_scheduler_count || !ticks) return;
 
-        if (task->wake_tick > scheduler.ticks) break;
-        if (ilist_remove(node)) panic("sched: corrupt sleep queue head");
-        place_waking_task_locked(task, false);
-        wake_task_locked(task, 0);
-    }
-
-    /*
-     * Check timed wait-queue tasks: tasks that are in a wait queue
-     * but also have a wake_tick deadline (e.g. futex timeouts).
-     * On expiry, remove from the wait queue and wake.
-     */
-    while (!ilist_is_empty(&scheduler.timer_queue)) {
-        ilist_node_t *node = scheduler.timer_queue.next;
-        task_t       *task = timer_node_to_task(node);
+    __atomic_add_fetch(&cpu_rqs[cpu_id].idle_ticks, ticks, __ATOMIC_RELAXED);
+    if (cpu_id == 0) __atomic_add_fetch(&scheduler.ticks, ticks, __ATOMIC_RELEASE);
+    sched_run_timers(cpu_id, sched_ticks());
+}
 
-        if (task->wake_tick > scheduler.ticks) break;
-        /*
-         * finish_wait_locked() drops both the timer entry and the wait-queue
-         * entry; the explicit removal here is what makes the loop terminate.
-         */
-        if (ilist_remove(node)) panic("sched: corrupt timer queue head");
-        place_waking_task_locked(task, false);
-        finish_wait_locked(task, TASK_WAKE_TIMEOUT);
+/*
+ * Idle loop: halt until an interrupt, then yield to real work.  The tick is
+ * stopped for the halt, and sti;hlt stays one sequence so that an interrupt
+ * arriving after the runnable check still ends the halt.
+ */
+__attribute__((noreturn)) static void idle_loop(void)
+{
+    for (;;) {
+        disable_intr();
+        tick_nohz_idle_enter();
+        __asm__ volatile("sti; hlt" ::: "memory");
+        disable_intr();
+        tick_nohz_idle_exit();
+        sched_yield();
     }
 }
 
-/* Per-CPU idle loop: halt until an interrupt, then yield to real work */
+/* Per-CPU idle thread entry */
 static void idle_thread(void *arg)
 {
     (void)arg;
-    while (1) {
-        enable_intr();
-        __asm__ volatile("hlt");
-        disable_intr();
-        sched_yield();
-    }
+    idle_loop();
 }
 
 /*
@@ -1164,8 +1243,8 @@ static task_t *idle_task_alloc(uint32_t cpu_id)
     idle->weight         = SCHED_NICE_0_LOAD;
     idle->base_weight    = SCHED_NICE_0_LOAD;
     idle->pi_weight      = SCHED_NICE_0_LOAD;
+    idle->timer_cpu      = -1;
     ilist_init(&idle->sched_node);
-    ilist_init(&idle->timer_node);
     ilist_init(&idle->thread_node);
     ilist_init(&idle->cgroup_node);
     (void)snprintf(idle->name, sizeof(idle->name), "swapper/%u", cpu_id);
@@ -1188,8 +1267,6 @@ static task_t *idle_task_alloc(uint32_t cpu_id)
 void sched_init(void)
 {
     memset(&scheduler, 0, sizeof(scheduler));
-    ilist_init(&scheduler.sleep_queue);
-    ilist_init(&scheduler.timer_queue);
     scheduler.next_pid = 0;
 
     cpu_scheduler_count = get_cpu_count();
@@ -1200,7 +1277,9 @@ void sched_init(void)
 
     for (uint32_t i = 0; i < cpu_scheduler_count; i++) {
         rb_init_root(&cpu_rqs[i].timeline);
-        cpu_rqs[i].online = 1;
+        rb_init_root(&cpu_rqs[i].timers);
+        cpu_rqs[i].timer_next = UINT64_MAX;
+        cpu_rqs[i].online     = 1;
     }
     sched_domain_build();
 
@@ -1215,9 +1294,9 @@ void sched_init(void)
     boot_task.kernel_stack   = &boot_stack_marker;
     boot_task.weight         = SCHED_NICE_0_LOAD;
     boot_task.process        = NULL;
+    boot_task.timer_cpu      = -1;
     task_name_copy(&boot_task, "swapper/0");
     ilist_init(&boot_task.sched_node);
-    ilist_init(&boot_task.timer_node);
 
     /* boot_task is the swapper/0 idle task for CPU 0 */
     cpu_rqs[0].idle = &boot_task;
@@ -1239,8 +1318,8 @@ void sched_init(void)
         ap_boot_tasks[i].page_directory = get_kernel_pagedir();
         ap_boot_tasks[i].cpu_id         = i;
         ap_boot_tasks[i].weight         = SCHED_NICE_0_LOAD;
+        ap_boot_tasks[i].timer_cpu      = -1;
         ilist_init(&ap_boot_tasks[i].sched_node);
-        ilist_init(&ap_boot_tasks[i].timer_node);
         __atomic_store_n(&cpu_rqs[i].curr, &ap_boot_tasks[i], __ATOMIC_RELAXED);
     }
 }
@@ -1477,12 +1556,7 @@ void sched_start(void)
     sched_yield();
 
     /* swapper/0 resumed - enter idle loop */
-    for (;;) {
-        enable_intr();
-        __asm__ volatile("hlt");
-        disable_intr();
-        sched_yield();
-    }
+    idle_loop();
 }
 
 /* task_sleep_ticks - voluntary sleep for N ticks */
@@ -1494,7 +1568,6 @@ void task_sleep_ticks(uint64_t ticks)
     }
 
     disable_intr();
-    spin_lock(&scheduler.lock);
 
     eevdf_rq_t *rq   = local_rq();
     task_t     *curr = local_current();
@@ -1503,11 +1576,11 @@ void task_sleep_ticks(uint64_t ticks)
     spin_lock(&rq->lock);
     curr->vlag = (int64_t)(avg_vruntime(rq) - curr->vruntime);
     spin_unlock(&rq->lock);
-    uint64_t now      = scheduler.ticks;
+    uint64_t now      = sched_ticks();
     uint64_t deadline = ticks > UINT64_MAX - now ? UINT64_MAX : now + ticks;
-    sleep_task(curr, deadline);
 
-    spin_unlock(&scheduler.lock);
+    /* Only the local timer tree is touched; wakers serialize on the state it publishes. */
+    sched_timer_arm(curr, deadline, TASK_SLEEPING);
     sched_yield();
     enable_intr();
 }
@@ -1556,9 +1629,10 @@ int task_wakeup(task_t *task)
     if (task->wait_queue) {
         finish_wait_locked(task, TASK_WAKE_NORMAL);
     } else if (task->state == TASK_SLEEPING) {
-        wake_task_locked(task, 1);
+        sched_timer_cancel(task);
+        wake_task_locked(task);
     } else {
-        wake_task_locked(task, 0);
+        wake_task_locked(task);
     }
     uint32_t target_cpu = task->cpu_id;
     spin_unlock(&scheduler.lock);
@@ -1759,21 +1833,19 @@ int wait_queue_wait_timed(wait_queue_t *queue, uint64_t deadline_ticks)
 
     /*
      * The task is already in the wait queue (via wait_queue_prepare).
-     * Now also add it to the timer queue so the scheduler tick can
-     * wake it when the deadline expires.
+     * Now also queue its deadline on this CPU's timer tree so the local
+     * tick can wake it when the deadline expires.
      */
     task_t *curr  = local_current();
     int     sleep = 0;
 
     spin_lock(&scheduler.lock);
     if (curr->wait_queue == queue && curr->wake_reason == TASK_WAKE_NONE) {
-        if (deadline_ticks <= scheduler.ticks) {
+        if (deadline_ticks <= sched_ticks()) {
             finish_wait_locked(curr, TASK_WAKE_TIMEOUT);
         } else {
-            curr->wake_tick = deadline_ticks;
-            insert_timer_deadline_locked(curr);
-            curr->state = TASK_BLOCKED;
-            sleep       = 1;
+            sched_timer_arm(curr, deadline_ticks, TASK_BLOCKED);
+            sleep = 1;
         }
     }
 
@@ -1795,6 +1867,59 @@ int wait_queue_wait_timed(wait_queue_t *queue, uint64_t deadline_ticks)
     return ret;
 }
 
+/* hrtimer callback: time out the deadline wait of the task it belongs to. */
+static void wait_timer_expired(hrtimer_t *timer)
+{
+    task_t *task = timer->data;
+
+    spin_lock(&scheduler.lock);
+    if (task->wait_queue && task->wake_reason == TASK_WAKE_NONE) {
+        place_waking_task_locked(task, false);
+        finish_wait_locked(task, TASK_WAKE_TIMEOUT);
+    }
+    spin_unlock(&scheduler.lock);
+}
+
+/*
+ * Like wait_queue_wait_timed(), but with a CLOCK_MONOTONIC deadline in
+ * nanoseconds backed by a high-resolution timer instead of the tick queue.
+ */
+int wait_queue_wait_deadline(wait_queue_t *queue, uint64_t deadline_ns)
+{
+    if (!queue) {
+        task_block();
+        return 0;
+    }
+
+    task_t *curr  = local_current();
+    int     sleep = 0;
+
+    hrtimer_init(&curr->wait_timer, wait_timer_expired, curr);
+    spin_lock(&scheduler.lock);
+    if (curr->wait_queue == queue && curr->wake_reason == TASK_WAKE_NONE) {
+        uint64_t now_ns = timer_monotonic_ns();
+        if (deadline_ns <= now_ns) {
+            finish_wait_locked(curr, TASK_WAKE_TIMEOUT);
+        } else if (hrtimer_start(&curr->wait_timer, deadline_ns) == EOK) {
+            curr->state = TASK_BLOCKED;
+            sleep       = 1;
+        } else {
+            /* No timer queue on this CPU: wait on the tick, rounding the deadline up. */
+            sched_timer_arm(curr, sched_ticks() + (deadline_ns - now_ns + TIMER_TICK_NS - 1) / TIMER_TICK_NS, TASK_BLOCKED);
+            sleep = 1;
+        }
+    }
+    spin_unlock(&scheduler.lock);
+
+    if (sleep) sched_yield();
+    (void)hrtimer_cancel(&curr->wait_timer);
+    int ret = curr->wake_reason == TASK_WAKE_TIMEOUT ? -ETIMEDOUT : 0;
+
+    /* Consume the wake reason, as wait_queue_wait_timed() does. */
+    curr->wake_reason = TASK_WAKE_NONE;
+    return ret;
+}
+
 /* Wake one task from the queue, returning it */
 task_t *wait_queue_wake_one(wait_queue_t *queue)
 {
@@ -1931,13 +2056,9 @@ void sched_tick(bool user_mode)
     }
     spin_unlock(&rq->lock);
 
-    /* CPU 0 owns the global time base and ordered timer queues. */
-    if (cpu_id == 0) {
-        spin_lock(&scheduler.lock);
-        scheduler.ticks++;
-        wake_sleeping_tasks();
-        spin_unlock(&scheduler.lock);
-    }
+    /* CPU 0 owns the global time base; every CPU expires its own deadlines. */
+    if (cpu_id == 0) __atomic_add_fetch(&scheduler.ticks, 1, __ATOMIC_RELEASE);
+    sched_run_timers(cpu_id, sched_ticks());
 
     /* Each CPU periodically pulls work through its nested scheduling domains. */
     uint64_t now = __atomic_load_n(&scheduler.ticks, __ATOMIC_RELAXED);
@@ -1976,7 +2097,7 @@ void sched_maybe_preempt(void)
 /* sched_ticks - return the global tick count */
 uint64_t sched_ticks(void)
 {
-    return scheduler.ticks;
+    return tick_nohz_jiffies(__atomic_load_n(&scheduler.ticks, __ATOMIC_ACQUIRE));
 }
 
 /* task_exit - terminate the current task */
@@ -154,10 +154,14 @@ static int vma_remove_range(process_t *proc, uintptr_t start, uintptr_t end)
 /* Unmap physical pages in a range from the page directory */
 static int unmap_physical_pages(process_t *proc, uintptr_t start, size_t length)
 {
-    uintptr_t end = ALIGN_UP(start + length, PAGE_4K_SIZE);
-    for (uintptr_t va = start; va < end; va += PAGE_4K_SIZE)
-        if (page_unmap_release(proc->user_page_dir, va) < 0) return -ENOMEM;
-    return EOK;
+    uintptr_t   end    = ALIGN_UP(start + length, PAGE_4K_SIZE);
+    int         result = EOK;
+    tlb_batch_t batch;
+    tlb_batch_init(&batch, proc->user_page_dir);
+    for (uintptr_t va = start; va < end && result == EOK; va += PAGE_4K_SIZE)
+        if (page_unmap_release_batch(&batch, va) < 0) result = -ENOMEM;
+    tlb_batch_finish(&batch);
+    return result;
 }
 
 /* Split a VMA at an address, retaining backing references on both halves */
@@ -564,7 +568,7 @@ int sys_mprotect(uint64_t addr, uint64_t length, uint64_t prot)
     }
     free(changes);
     spin_unlock(&proc->mmap_lock);
-    flush_tlb_all();
+    flush_tlb_mm_range(proc->user_page_dir, (uintptr_t)addr, end);
     return EOK;
 }
 
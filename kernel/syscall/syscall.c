@@ -462,36 +462,34 @@ static int64_t clock_sleep(uint64_t clockid, uint64_t flags, uint64_t req, uint6
     uint64_t duration_ns;
     uint64_t sleep_ticks;
     if (!timer_sleep_duration(&request, now_ns, flags == TIMER_ABSTIME, &duration_ns, &sleep_ticks)) return -EINVAL;
-    if (!sleep_ticks) return EOK;
+    if (!duration_ns) return EOK;
 
-    uint64_t     start_tick    = sched_ticks();
-    uint64_t     deadline_tick = UINT64_MAX - start_tick < sleep_ticks ? UINT64_MAX : start_tick + sleep_ticks;
+    /* Sleep on the monotonic timeline with a high-resolution deadline. */
+    uint64_t     start_ns = timer_monotonic_ns();
+    uint64_t     deadline = UINT64_MAX - start_ns < duration_ns ? UINT64_MAX : start_ns + duration_ns;
     wait_queue_t sleep_queue;
     wait_queue_init(&sleep_queue);
 
     for (;;) {
-        uint64_t now_tick = sched_ticks();
-        if (now_tick >= deadline_tick) return EOK;
+        if (timer_monotonic_ns() >= deadline) return EOK;
 
         wait_queue_prepare(&sleep_queue);
-        now_tick = sched_ticks();
+        uint64_t current_ns = timer_monotonic_ns();
         if (clock_sleep_signal_pending()) {
             wait_queue_cancel(&sleep_queue);
             if (!(flags & TIMER_ABSTIME) && rem) {
-                uint64_t         elapsed_ticks = now_tick - start_tick;
-                uint64_t         elapsed_ns    = elapsed_ticks > UINT64_MAX / TIMER_TICK_NS ? UINT64_MAX : elapsed_ticks * TIMER_TICK_NS;
-                uint64_t         remaining_ns  = elapsed_ns < duration_ns ? duration_ns - elapsed_ns : 0;
-                timer_timespec_t remaining     = timer_ns_to_timespec(remaining_ns);
+                uint64_t         remaining_ns = current_ns < deadline ? deadline - current_ns : 0;
+                timer_timespec_t remaining    = timer_ns_to_timespec(remaining_ns);
                 if (copy_to_user((void *)rem, &remaining, sizeof(remaining))) return -EFAULT;
             }
             return -EINTR;
         }
 
-        if (now_tick >= deadline_tick) {
+        if (current_ns >= deadline) {
             wait_queue_cancel(&sleep_queue);
             return EOK;
         }
-        wait_queue_wait_timed(&sleep_queue, deadline_tick);
+        wait_queue_wait_deadline(&sleep_queue, deadline);
     }
 }
 
@@ -2470,83 +2468,6 @@ static int64_t sys_membarrier_stub(uint64_t cmd, uint64_t flags, uint64_t cpu_id
     }
 }
 
-/* copy_file_range syscall: copy a byte range between two descriptors */
-static int64_t sys_copy_file_range_stub(uint64_t fd_in, uint64_t off_in, uint64_t fd_out, uint64_t off_out, uint64_t len, uint64_t flags)
-{
-    if (flags) return -EINVAL;
-    if (fd_in == fd_out) return -EINVAL;
-
-    process_t *proc = process_current();
-    if (!proc) return -ESRCH;
-
-    process_file_t *pf_in  = process_fd_get(proc, (int)fd_in);
-    process_file_t *pf_out = process_fd_get(proc, (int)fd_out);
-    if (!pf_in || !pf_out) {
-        if (pf_in) process_file_put(pf_in);
-        if (pf_out) process_file_put(pf_out);
-        return -EBADF;
-    }
-
-    /* Save and restore offsets if off_in/off_out are NULL */
-    bool    have_off_in  = (off_in != 0);
-    bool    have_off_out = (off_out != 0);
-    int64_t saved_off_in = 0, saved_off_out = 0;
-
-    if (have_off_in) {
-        if (copy_from_user(&saved_off_in, (const void *)off_in, sizeof(saved_off_in))) {
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return -EFAULT;
-        }
-    } else {
-        saved_off_in = (int64_t)pf_in->offset;
-    }
-
-    if (have_off_out) {
-        if (copy_from_user(&saved_off_out, (const void *)off_out, sizeof(saved_off_out))) {
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return -EFAULT;
-        }
-    } else {
-        saved_off_out = (int64_t)pf_out->offset;
-    }
-
-    uint8_t buf[SYSCALL_IO_CHUNK];
-    size_t  total_copied = 0;
-
-    while (total_copied < len) {
-        size_t chunk = len - total_copied;
-        if (chunk > sizeof(buf)) chunk = sizeof(buf);
-
-        int64_t nread = process_fd_read(proc, (int)fd_in, buf, chunk);
-        if (nread < 0) {
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return total_copied ? (int64_t)total_copied : nread;
-        }
-        if (nread == 0) break;
-
-        int64_t nwritten = process_fd_write(proc, (int)fd_out, buf, (size_t)nread);
-        if (nwritten < 0) {
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return total_copied ? (int64_t)total_copied : nwritten;
-        }
-
-        total_copied += (size_t)nwritten;
-        if ((size_t)nread < chunk) break;
-    }
-
-    /* Restore offsets if caller didn't specify them */
-    if (!have_off_in) process_fd_seek(proc, (int)fd_in, saved_off_in, SEEK_SET);
-    if (!have_off_out) process_fd_seek(proc, (int)fd_out, saved_off_out, SEEK_SET);
-
-    process_file_put(pf_in);
-    process_file_put(pf_out);
-    return (int64_t)total_copied;
-}
-
 static int64_t sys_mlock2_stub(uint64_t addr, uint64_t length, uint64_t flags, uint64_t arg3, uint64_t arg4, uint64_t arg5)
 {
     (void)flags;
@@ -4921,7 +4842,7 @@ static const syscall_fn_t syscall_table[SYS_MAX] = {
     [SYS_USERFAULTFD]            = sys_stub,
     [SYS_MEMBARRIER]             = sys_membarrier_stub,
     [SYS_MLOCK2]                 = sys_mlock2_stub,
-    [SYS_COPY_FILE_RANGE]        = sys_copy_file_range_stub,
+    [SYS_COPY_FILE_RANGE]        = sys_copy_file_range_impl,
     [SYS_PREADV2]                = sys_preadv2_impl,
     [SYS_PWRITEV2]               = sys_pwritev2_impl,
     [SYS_PKEY_MPROTECT]          = sys_pkey_mprotect_stub,
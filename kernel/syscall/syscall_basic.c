@@ -20,6 +20,8 @@
 #include <libs/std/stdlib.h>
 #include <libs/std/string.h>
 #include <mem/alloc.h>
+#include <mem/page.h>
+#include <mem/pagecache.h>
 #include <process/process.h>
 #include <process/sched.h>
 #include <process/task.h>
@@ -1416,7 +1418,219 @@ int64_t sys_mknodat_impl(uint64_t dirfd, uint64_t path, uint64_t mode, uint64_t
     return mknod_create_node(resolved, mode, dev);
 }
 
-/* sendfile syscall: copy data between file descriptors */
+/* Zero-copy transfers: sendfile / splice / tee / copy_file_range */
+
+#define SPLICE_F_MOVE      1U
+#define SPLICE_F_NONBLOCK  2U
+#define SPLICE_F_MORE      4U
+#define SPLICE_F_GIFT      8U
+#define SPLICE_F_ALL       (SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT)
+#define SPLICE_BATCH_PAGES 16U   // cached source spans pinned per transfer step
+#define SPLICE_BOUNCE_SIZE 4096U // staging buffer for sources without a page cache
+
+/* Destination of a transfer: a pipe, socket or stream, or a file written at pos. */
+typedef struct splice_sink {
+        process_t      *proc;
+        process_file_t *file;
+        uint64_t        flags; // open flags, plus O_NONBLOCK for SPLICE_F_NONBLOCK
+        uint64_t        pos;
+        bool            positionless;
+} splice_sink_t;
+
+/* Source page spans pinned for one transfer step. */
+typedef struct splice_batch {
+        pipe_buffer_t bufs[SPLICE_BATCH_PAGES];
+        size_t        count;
+} splice_batch_t;
+
+/* Whether a description has no file position (pipes, sockets and streams). */
+static bool splice_positionless(const process_file_t *file)
+{
+    return (file->node->type & (file_stream | file_pipe | file_socket)) != 0;
+}
+
+/* Check that a description may be the source (or, with write, the sink) of a transfer. */
+static int splice_check_access(const process_file_t *file, bool write)
+{
+    uint64_t flags = __atomic_load_n(&file->flags, __ATOMIC_RELAXED);
+    if (flags & O_PATH) return -EBADF;
+    if ((flags & O_ACCMODE) == (write ? O_RDONLY : O_WRONLY)) return -EBADF;
+    if (write && !splice_positionless(file) && vfs_mount_is_readonly(file->node)) return -EROFS;
+    return EOK;
+}
+
+/* Load a transfer position from a user offset pointer, or from the file offset. */
+static int splice_load_pos(process_file_t *file, uint64_t user_off, uint64_t *pos)
+{
+    if (user_off) {
+        int64_t value;
+        if (copy_from_user(&value, (const void *)user_off, sizeof(value))) return -EFAULT;
+        if (value < 0) return -EINVAL;
+        *pos = (uint64_t)value;
+        return EOK;
+    }
+    spin_lock(&file->lock);
+    *pos = file->offset;
+    spin_unlock(&file->lock);
+    return EOK;
+}
+
+/* Store an advanced position to the user offset pointer, or to the file offset. */
+static int splice_store_pos(process_file_t *file, uint64_t user_off, uint64_t pos)
+{
+    if (user_off) {
+        int64_t value = (int64_t)pos;
+        return copy_to_user((void *)user_off, &value, sizeof(value)) ? -EFAULT : EOK;
+    }
+    spin_lock(&file->lock);
+    file->offset = (size_t)pos;
+    spin_unlock(&file->lock);
+    return EOK;
+}
+
+/* Prepare a sink; positionless sinks reject an explicit offset. */
+static int splice_sink_init(splice_sink_t *sink, process_t *proc, process_file_t *file, uint64_t user_off, uint64_t extra_flags)
+{
+    sink->proc         = proc;
+    sink->file         = file;
+    sink->flags        = __atomic_load_n(&file->flags, __ATOMIC_RELAXED) | extra_flags;
+    sink->pos          = 0;
+    sink->positionless = splice_positionless(file);
+    if (sink->positionless) return user_off ? -ESPIPE : EOK;
+    return splice_load_pos(file, user_off, &sink->pos);
+}
+
+/* Write a kernel span to the sink, advancing its position. */
+static int64_t splice_sink_write(void *context, const void *data, size_t count)
+{
+    splice_sink_t *sink = context;
+    vfs_node_t     node = sink->file->node;
+    if (!sink->positionless && (sink->flags & O_APPEND)) sink->pos = node->size;
+
+    int64_t ret = vfs_file_write_process(node, sink->file->private_data, sink->flags, data, sink->positionless ? 0 : sink->pos, count, sink->proc);
+    if (ret > 0 && !sink->positionless) sink->pos += (uint64_t)ret;
+    return ret;
+}
+
+/* Pin one locked cached span of the source into the batch. */
+static int splice_gather_page(void *context, pagecache_page_t *page, void *data, size_t count)
+{
+    splice_batch_t *batch = context;
+    if (batch->count == SPLICE_BATCH_PAGES) return -ENOSPC;
+
+    pagecache_buffer_get(page);
+    pipe_buffer_t *buf = &batch->bufs[batch->count++];
+    buf->page          = page;
+    buf->offset        = (uint32_t)((uint8_t *)data - (uint8_t *)pagecache_page_data(page));
+    buf->len           = (uint32_t)count;
+    return EOK;
+}
+
+/* Drop the pins of batch buffers from first onwards. */
+static void splice_batch_release(splice_batch_t *batch, size_t first)
+{
+    for (size_t i = first; i < batch->count; i++) pagecache_buffer_put(batch->bufs[i].page);
+    batch->count = 0;
+}
+
+/* Copy up to len bytes through a bounce buffer, for sources without a page cache. */
+static int64_t splice_copy(process_t *proc, process_file_t *in, uint64_t *pos, splice_sink_t *sink, size_t len)
+{
+    uint8_t  buf[SPLICE_BOUNCE_SIZE];
+    bool     in_stream = splice_positionless(in);
+    uint64_t flags     = __atomic_load_n(&in->flags, __ATOMIC_RELAXED);
+    size_t   total     = 0;
+
+    while (total < len) {
+        size_t  chunk = len - total < sizeof(buf) ? len - total : sizeof(buf);
+        int64_t n     = vfs_file_read_process(in->node, in->private_data, flags, buf, in_stream ? 0 : *pos, chunk, proc);
+        if (n < 0) return total ? (int64_t)total : n;
+        if (!n) break;
+
+        size_t  written = 0;
+        int64_t error   = 0;
+        while (written < (size_t)n) {
+            int64_t w = splice_sink_write(sink, buf + written, (size_t)n - written);
+            if (w <= 0) {
+                error = w ? w : -EIO;
+                break;
+            }
+            written += (size_t)w;
+        }
+        if (!in_stream) *pos += written;
+        total += written;
+        if (error) return total ? (int64_t)total : error;
+        if ((size_t)n < chunk) break;
+    }
+    return (int64_t)total;
+}
+
+/*
+ * Transfer up to len bytes of a file at *pos to the sink.  A page-cached
+ * source is pinned a batch of pages at a time: a pipe sink queues the pins
+ * themselves, any other sink is written straight from the cached pages with
+ * no page locked.  Sources without a page cache use splice_copy().
+ */
+static int64_t splice_from_file(process_t *proc, process_file_t *in, uint64_t *pos, splice_sink_t *sink, size_t len)
+{
+    bool   to_pipe = pipe_node_is_pipe(sink->file->node);
+    size_t total   = 0;
+
+    while (total < len) {
+        size_t want   = len - total;
+        size_t window = SPLICE_BATCH_PAGES * PAGE_4K_SIZE - (size_t)(*pos % PAGE_4K_SIZE);
+        if (want > window) want = window;
+
+        splice_batch_t batch = {.count = 0};
+        int64_t        got   = -EOPNOTSUPP;
+        if (!splice_positionless(in)) got = vfs_file_read_pages(in->node, *pos, want, splice_gather_page, &batch, proc);
+        if (got == -EOPNOTSUPP) {
+            int64_t ret = splice_copy(proc, in, pos, sink, len - total);
+            if (ret < 0) return total ? (int64_t)total : ret;
+            return (int64_t)(total + (size_t)ret);
+        }
+        if (got <= 0) {
+            splice_batch_release(&batch, 0);
+            if (got < 0) return total ? (int64_t)total : got;
+            break;
+        }
+
+        size_t  sent  = 0;
+        int64_t error = 0;
+        if (to_pipe) {
+            /* Only the first step may wait for room; later ones take what fits. */
+            uint64_t flags = sink->flags | (total ? O_NONBLOCK : 0);
+            int64_t  ret   = pipe_splice_in(sink->file->node, sink->file->private_data, flags, batch.bufs, batch.count);
+            size_t   kept  = 0;
+            if (ret < 0)
+                error = ret;
+            else
+                sent = (size_t)ret;
+            for (size_t queued = 0; kept < batch.count && queued < sent; kept++) queued += batch.bufs[kept].len;
+            splice_batch_release(&batch, kept);
+        } else {
+            for (size_t i = 0; i < batch.count; i++) {
+                const uint8_t *data = (const uint8_t *)pagecache_page_data(batch.bufs[i].page) + batch.bufs[i].offset;
+                int64_t        ret  = splice_sink_write(sink, data, batch.bufs[i].len);
+                if (ret < 0) {
+                    error = ret;
+                    break;
+                }
+                sent += (size_t)ret;
+                if ((uint32_t)ret < batch.bufs[i].len) break;
+            }
+            splice_batch_release(&batch, 0);
+        }
+
+        *pos += sent;
+        total += sent;
+        if (error) return total ? (int64_t)total : error;
+        if (sent < (size_t)got || (size_t)got < want) break;
+    }
+    return (int64_t)total;
+}
+
+/* sendfile syscall: transfer file data to another descriptor without a user copy */
 int64_t sys_sendfile_impl(uint64_t out_fd, uint64_t in_fd, uint64_t offset, uint64_t count, uint64_t arg4, uint64_t arg5)
 {
     (void)arg4;
@@ -1432,58 +1646,37 @@ int64_t sys_sendfile_impl(uint64_t out_fd, uint64_t in_fd, uint64_t offset, uint
         return -EBADF;
     }
 
-    int64_t old_off  = 0;
-    bool    have_off = (offset != 0);
-    int64_t user_off = 0;
-
-    if (have_off) {
-        if (copy_from_user(&user_off, (const void *)offset, sizeof(user_off))) {
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return -EFAULT;
-        }
-        old_off = process_fd_seek(proc, (int)in_fd, 0, SEEK_CUR);
-        process_fd_seek(proc, (int)in_fd, user_off, SEEK_SET);
-    }
-
-    uint8_t buf[4096];
-    size_t  total = 0;
-    while (total < count) {
-        size_t chunk = count - total;
-        if (chunk > sizeof(buf)) chunk = sizeof(buf);
-        int64_t n = process_fd_read(proc, (int)in_fd, buf, chunk);
-        if (n < 0) {
-            if (have_off) process_fd_seek(proc, (int)in_fd, old_off, SEEK_SET);
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return total ? (int64_t)total : n;
-        }
-        if (!n) break;
-        int64_t w = process_fd_write(proc, (int)out_fd, buf, (size_t)n);
-        if (w < 0) {
-            if (have_off) process_fd_seek(proc, (int)in_fd, old_off, SEEK_SET);
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return total ? (int64_t)total : w;
+    splice_sink_t sink;
+    int64_t       ret = splice_check_access(pf_in, false);
+    if (!ret) ret = splice_check_access(pf_out, true);
+    if (!ret) ret = splice_sink_init(&sink, proc, pf_out, 0, 0);
+    if (ret) goto out;
+
+    if (pipe_node_is_pipe(pf_in->node)) {
+        if (offset)
+            ret = -ESPIPE;
+        else if (pipe_node_is_pipe(pf_out->node))
+            ret = pipe_transfer(pf_in->node, pf_in->private_data, pf_out->node, pf_out->private_data, (pf_in->flags | pf_out->flags) & O_NONBLOCK, count, true);
+        else
+            ret = pipe_splice_out(pf_in->node, pf_in->private_data, pf_in->flags, count, splice_sink_write, &sink);
+    } else {
+        uint64_t pos = 0;
+        if (splice_positionless(pf_in))
+            ret = offset ? -ESPIPE : EOK;
+        else
+            ret = splice_load_pos(pf_in, offset, &pos);
+        if (!ret) ret = splice_from_file(proc, pf_in, &pos, &sink, count);
+        if (ret >= 0 && !splice_positionless(pf_in) && (offset || ret > 0)) {
+            int stored = splice_store_pos(pf_in, offset, pos);
+            if (stored) ret = stored;
         }
-        total += (size_t)w;
-        if ((size_t)n < chunk) break;
     }
+    if (ret > 0 && !sink.positionless) splice_store_pos(pf_out, 0, sink.pos);
 
-    if (have_off) {
-        int64_t new_off = process_fd_seek(proc, (int)in_fd, 0, SEEK_CUR);
-        if (copy_to_user((void *)offset, &new_off, sizeof(int64_t))) {
-            plogk("sys_sendfile: copy_to_user offset failed.\n");
-            process_fd_seek(proc, (int)in_fd, old_off, SEEK_SET);
-            process_file_put(pf_in);
-            process_file_put(pf_out);
-            return -EFAULT;
-        }
-        process_fd_seek(proc, (int)in_fd, old_off, SEEK_SET);
-    }
+out:
     process_file_put(pf_in);
     process_file_put(pf_out);
-    return (int64_t)total;
+    return ret;
 }
 
 /* preadv / pwritev */
@@ -1703,40 +1896,138 @@ int64_t sys_unshare_impl(uint64_t unshare_flags, uint64_t arg1, uint64_t arg2, u
     return 0;
 }
 
-/* splice syscall: copy data between file descriptors */
+/* splice syscall: move data between a pipe and another descriptor */
 int64_t sys_splice_impl(uint64_t fd_in, uint64_t off_in, uint64_t fd_out, uint64_t off_out, uint64_t len, uint64_t flags)
 {
-    if (flags & ~6ULL) return -EINVAL;
-    /* Simple fallback: read from fd_in, write to fd_out */
+    if (flags & ~(uint64_t)SPLICE_F_ALL) return -EINVAL;
     process_t *proc = process_current();
     if (!proc) return -ESRCH;
     if (!len) return 0;
 
-    uint8_t buf[4096];
-    size_t  total = 0;
-    while (total < len) {
-        size_t chunk = len - total;
-        if (chunk > sizeof(buf)) chunk = sizeof(buf);
-        int64_t n = process_fd_read(proc, (int)fd_in, buf, chunk);
-        if (n < 0) return total ? (int64_t)total : n;
-        if (!n) break;
-        int64_t w = process_fd_write(proc, (int)fd_out, buf, (size_t)n);
-        if (w < 0) return total ? (int64_t)total : w;
-        total += (size_t)w;
-        if ((size_t)n < chunk) break;
+    process_file_t *pf_in  = process_fd_get(proc, (int)fd_in);
+    process_file_t *pf_out = process_fd_get(proc, (int)fd_out);
+    if (!pf_in || !pf_out) {
+        if (pf_in) process_file_put(pf_in);
+        if (pf_out) process_file_put(pf_out);
+        return -EBADF;
     }
-    (void)off_in;
-    (void)off_out;
-    return (int64_t)total;
+
+    uint64_t      nonblock = (flags & SPLICE_F_NONBLOCK) ? O_NONBLOCK : 0;
+    bool          in_pipe  = pipe_node_is_pipe(pf_in->node);
+    bool          out_pipe = pipe_node_is_pipe(pf_out->node);
+    splice_sink_t sink;
+    int64_t       ret = splice_check_access(pf_in, false);
+    if (!ret) ret = splice_check_access(pf_out, true);
+    if (!ret && !in_pipe && !out_pipe) ret = -EINVAL;
+    if (!ret && ((in_pipe && off_in) || (out_pipe && off_out))) ret = -ESPIPE;
+    if (ret) goto out;
+
+    if (in_pipe && out_pipe) {
+        ret = pipe_transfer(pf_in->node, pf_in->private_data, pf_out->node, pf_out->private_data, nonblock | ((pf_in->flags | pf_out->flags) & O_NONBLOCK), len, true);
+    } else if (in_pipe) {
+        ret = splice_sink_init(&sink, proc, pf_out, off_out, nonblock);
+        if (!ret) ret = pipe_splice_out(pf_in->node, pf_in->private_data, pf_in->flags | nonblock, len, splice_sink_write, &sink);
+        if (ret > 0 && !sink.positionless) {
+            int stored = splice_store_pos(pf_out, off_out, sink.pos);
+            if (stored) ret = stored;
+        }
+    } else {
+        uint64_t pos = 0;
+        if (splice_positionless(pf_in))
+            ret = off_in ? -ESPIPE : EOK;
+        else
+            ret = splice_load_pos(pf_in, off_in, &pos);
+        if (!ret) ret = splice_sink_init(&sink, proc, pf_out, 0, nonblock);
+        if (!ret) ret = splice_from_file(proc, pf_in, &pos, &sink, len);
+        if (ret > 0 && !splice_positionless(pf_in)) {
+            int stored = splice_store_pos(pf_in, off_in, pos);
+            if (stored) ret = stored;
+        }
+    }
+
+out:
+    process_file_put(pf_in);
+    process_file_put(pf_out);
+    return ret;
 }
 
-/* tee syscall */
+/* tee syscall: duplicate pipe data into another pipe without consuming it */
 int64_t sys_tee_impl(uint64_t fd_in, uint64_t fd_out, uint64_t len, uint64_t flags, uint64_t arg4, uint64_t arg5)
 {
     (void)arg4;
     (void)arg5;
+    if (flags & ~(uint64_t)SPLICE_F_ALL) return -EINVAL;
+    process_t *proc = process_current();
+    if (!proc) return -ESRCH;
+    if (!len) return 0;
+
+    process_file_t *pf_in  = process_fd_get(proc, (int)fd_in);
+    process_file_t *pf_out = process_fd_get(proc, (int)fd_out);
+    if (!pf_in || !pf_out) {
+        if (pf_in) process_file_put(pf_in);
+        if (pf_out) process_file_put(pf_out);
+        return -EBADF;
+    }
+
+    int64_t ret = splice_check_access(pf_in, false);
+    if (!ret) ret = splice_check_access(pf_out, true);
+    if (!ret && (!pipe_node_is_pipe(pf_in->node) || !pipe_node_is_pipe(pf_out->node))) ret = -EINVAL;
+    if (!ret) {
+        uint64_t nonblock = (flags & SPLICE_F_NONBLOCK) ? O_NONBLOCK : 0;
+        ret               = pipe_transfer(pf_in->node, pf_in->private_data, pf_out->node, pf_out->private_data, nonblock | ((pf_in->flags | pf_out->flags) & O_NONBLOCK), len, false);
+    }
+
+    process_file_put(pf_in);
+    process_file_put(pf_out);
+    return ret;
+}
+
+/*
+ * copy_file_range syscall: copy between two regular files inside the kernel,
+ * straight from the source's cached pages into the destination.
+ */
+int64_t sys_copy_file_range_impl(uint64_t fd_in, uint64_t off_in, uint64_t fd_out, uint64_t off_out, uint64_t len, uint64_t flags)
+{
     if (flags) return -EINVAL;
-    return sys_splice_impl(fd_in, 0, fd_out, 0, len, 0);
+    process_t *proc = process_current();
+    if (!proc) return -ESRCH;
+
+    process_file_t *pf_in  = process_fd_get(proc, (int)fd_in);
+    process_file_t *pf_out = process_fd_get(proc, (int)fd_out);
+    if (!pf_in || !pf_out) {
+        if (pf_in) process_file_put(pf_in);
+        if (pf_out) process_file_put(pf_out);
+        return -EBADF;
+    }
+
+    uint64_t      pos = 0;
+    splice_sink_t sink;
+    int64_t       ret = splice_check_access(pf_in, false);
+    if (!ret) ret = splice_check_access(pf_out, true);
+    if (!ret && (pf_out->flags & O_APPEND)) ret = -EBADF;
+    if (!ret && ((pf_in->node->type | pf_out->node->type) & file_dir)) ret = -EISDIR;
+    if (!ret && (splice_positionless(pf_in) || splice_positionless(pf_out))) ret = -EINVAL;
+    if (!ret) ret = splice_load_pos(pf_in, off_in, &pos);
+    if (!ret) ret = splice_sink_init(&sink, proc, pf_out, off_out, 0);
+    if (ret || !len) goto out;
+
+    /* Overlapping ranges of one file would read back what was just copied. */
+    if (pf_in->node == pf_out->node && pos < sink.pos + len && sink.pos < pos + len) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    ret = splice_from_file(proc, pf_in, &pos, &sink, len);
+    if (ret > 0) {
+        int stored = splice_store_pos(pf_in, off_in, pos);
+        if (!stored) stored = splice_store_pos(pf_out, off_out, sink.pos);
+        if (stored) ret = stored;
+    }
+
+out:
+    process_file_put(pf_in);
+    process_file_put(pf_out);
+    return ret;
 }
 
 /* vmsplice syscall: unsupported */
@@ -12,6 +12,7 @@
 #include <fs/core/vfs.h>
 #include <kernel/errno.h>
 #include <kernel/printk.h>
+#include <kernel/timer/hrtimer.h>
 #include <kernel/timer/timer.h>
 #include <libs/std/stddef.h>
 #include <libs/std/stdint.h>
@@ -41,6 +42,8 @@ static spinlock_t   timerfd_list_lock;
 static uint64_t     timerfd_next_monotonic_ns = UINT64_MAX;
 static uint64_t     timerfd_next_realtime_ns  = UINT64_MAX;
 static uint64_t     timerfd_deadline_generation;
+static hrtimer_t    timerfd_hrtimer;
+static spinlock_t   timerfd_hrtimer_lock;
 
 /* Publish an earlier deadline without making the timer interrupt scan lists. */
 static void timerfd_deadline_min(uint64_t clockid, uint64_t deadline_ns)
@@ -61,6 +64,35 @@ bool timerfd_deferred_due(uint64_t monotonic_ns)
     return realtime_ns >= 0 && (uint64_t)realtime_ns >= real;
 }
 
+/* hrtimer callback: let the timer bottom half expire the due timerfds. */
+static void timerfd_hrtimer_expired(hrtimer_t *timer)
+{
+    (void)timer;
+    timer_queue_deferred_work();
+}
+
+/* Arm the shared high-resolution timer for the earliest published deadline. */
+static void timerfd_arm_hrtimer(void)
+{
+    uint64_t expires = __atomic_load_n(&timerfd_next_monotonic_ns, __ATOMIC_ACQUIRE);
+    uint64_t real    = __atomic_load_n(&timerfd_next_realtime_ns, __ATOMIC_ACQUIRE);
+    if (real != UINT64_MAX) {
+        /* Project the realtime deadline onto the monotonic timeline. */
+        int64_t  realtime_ns = timer_realtime_ns();
+        uint64_t now_ns      = timer_monotonic_ns();
+        uint64_t ahead       = realtime_ns > 0 && real > (uint64_t)realtime_ns ? real - (uint64_t)realtime_ns : 0;
+        uint64_t when        = ahead > UINT64_MAX - now_ns ? UINT64_MAX : now_ns + ahead;
+        if (when < expires) expires = when;
+    }
+
+    spin_lock(&timerfd_hrtimer_lock);
+    if (expires == UINT64_MAX)
+        (void)hrtimer_cancel(&timerfd_hrtimer);
+    else
+        (void)hrtimer_start(&timerfd_hrtimer, expires); // without a timer queue the tick still runs due timers
+    spin_unlock(&timerfd_hrtimer_lock);
+}
+
 /* Convert a timespec to nanoseconds, validating the input. */
 static int timerfd_timespec_to_ns(const timerfd_timespec_t *ts, uint64_t *ns)
 {
@@ -406,6 +438,7 @@ int sys_timerfd_settime(int fd, int flags, const void *new_value, void *old_valu
     spin_unlock(&ctx->lock);
     __atomic_add_fetch(&timerfd_deadline_generation, 1, __ATOMIC_RELEASE);
     if (armed) timerfd_deadline_min(clockid, deadline);
+    timerfd_arm_hrtimer();
     process_file_put(file);
     return EOK;
 }
@@ -497,6 +530,7 @@ void timerfd_tick(void)
         __atomic_store_n(&timerfd_next_monotonic_ns, 0, __ATOMIC_RELEASE);
         __atomic_store_n(&timerfd_next_realtime_ns, 0, __ATOMIC_RELEASE);
     }
+    timerfd_arm_hrtimer();
 }
 
 /* Register the timerfd filesystem callback set */
@@ -506,6 +540,7 @@ void timerfd_init(void)
     __atomic_store_n(&timerfd_next_monotonic_ns, UINT64_MAX, __ATOMIC_RELEASE);
     __atomic_store_n(&timerfd_next_realtime_ns, UINT64_MAX, __ATOMIC_RELEASE);
     __atomic_store_n(&timerfd_deadline_generation, 0, __ATOMIC_RELEASE);
+    hrtimer_init(&timerfd_hrtimer, timerfd_hrtimer_expired, NULL);
     vfs_callback_t cb = calloc(1, sizeof(struct vfs_callback));
     if (!cb) {
         plogk("timerfd: Failed to allocate callback.\n");
@@ -0,0 +1,187 @@
+/*
+ *
+ *      hrtimer.c
+ *      High-resolution timers
+ *
+ *      2026/10/17 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <arch/smp.h>
+#include <kernel/errno.h>
+#include <kernel/printk.h>
+#include <kernel/timer/hrtimer.h>
+#include <kernel/timer/timer.h>
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+#include <libs/std/stdlib.h>
+#include <mem/heap.h>
+#include <sync/spin_lock.h>
+
+/*
+ * Each CPU owns an expiry-ordered red-black tree of timers.  Timers are
+ * always armed on the local CPU and expire from that CPU's timer interrupt:
+ * the periodic tick while the CPU is busy, or the one-shot event the tick
+ * layer programs for the earliest expiry while the CPU idles.
+ */
+
+static hrtimer_base_t *hrtimer_bases;
+static uint32_t        hrtimer_base_count;
+
+/* Return the timer whose queue node is given */
+static hrtimer_t *node_to_timer(const rb_node_t *node)
+{
+    return rb_entry(node, hrtimer_t, node);
+}
+
+/* Order timers by expiry; equal deadlines keep their arming order. */
+static int hrtimer_less(const rb_node_t *a, const rb_node_t *b)
+{
+    return node_to_timer(a)->expires < node_to_timer(b)->expires;
+}
+
+/* Unlink a pending timer from its queue (base lock held). */
+static void hrtimer_dequeue_locked(hrtimer_t *timer)
+{
+    rb_erase_augmented(&timer->base->root, &timer->node, NULL, NULL);
+    __atomic_store_n(&timer->base, NULL, __ATOMIC_RELEASE);
+}
+
+/* Allocate the per-CPU timer queues. */
+void hrtimer_init_cpus(uint32_t cpu_count)
+{
+    if (hrtimer_bases || !cpu_count) return;
+
+    hrtimer_bases = calloc(cpu_count, sizeof(hrtimer_base_t));
+    if (!hrtimer_bases) {
+        plogk("hrtimer: Cannot allocate per-CPU timer queues.\n");
+        return;
+    }
+    for (uint32_t i = 0; i < cpu_count; i++) rb_init_root(&hrtimer_bases[i].root);
+    hrtimer_base_count = cpu_count;
+}
+
+/* Prepare a timer; it stays inactive until hrtimer_start(). */
+void hrtimer_init(hrtimer_t *timer, hrtimer_fn_t function, void *data)
+{
+    if (!timer) return;
+    timer->node     = (rb_node_t) {0};
+    timer->expires  = 0;
+    timer->function = function;
+    timer->data     = data;
+    timer->base     = NULL;
+}
+
+/* Lock the queue a timer is pending on, retrying if it moves meanwhile. */
+static hrtimer_base_t *hrtimer_lock_base(hrtimer_t *timer, uint64_t *rflags)
+{
+    for (;;) {
+        hrtimer_base_t *base = __atomic_load_n(&timer->base, __ATOMIC_ACQUIRE);
+        if (!base) return NULL;
+        *rflags = spin_lock_irqsave(&base->lock);
+        if (__atomic_load_n(&timer->base, __ATOMIC_ACQUIRE) == base) return base;
+        spin_unlock_irqrestore(&base->lock, *rflags);
+    }
+}
+
+/* (Re)arm a timer on the current CPU for an absolute CLOCK_MONOTONIC deadline. */
+int hrtimer_start(hrtimer_t *timer, uint64_t expires_ns)
+{
+    uint64_t rflags;
+
+    if (!timer || !timer->function) return -EINVAL;
+
+    hrtimer_base_t *base = hrtimer_lock_base(timer, &rflags);
+    if (base) {
+        hrtimer_dequeue_locked(timer);
+        spin_unlock_irqrestore(&base->lock, rflags);
+    }
+
+    uint32_t cpu = get_current_cpu_id();
+    if (!hrtimer_bases || cpu >= hrtimer_base_count) return -ENODEV; // caller falls back to the tick
+
+    base           = &hrtimer_bases[cpu];
+    rflags         = spin_lock_irqsave(&base->lock);
+    timer->expires = expires_ns;
+    rb_insert_augmented(&base->root, &timer->node, hrtimer_less, NULL, NULL);
+    __atomic_store_n(&timer->base, base, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&base->lock, rflags);
+    return EOK;
+}
+
+/* Disarm a timer, waiting for a callback running on another CPU. */
+bool hrtimer_cancel(hrtimer_t *timer)
+{
+    uint64_t rflags;
+    bool     pending = false;
+
+    if (!timer) return false;
+
+    hrtimer_base_t *base = hrtimer_lock_base(timer, &rflags);
+    if (base) {
+        hrtimer_dequeue_locked(timer);
+        spin_unlock_irqrestore(&base->lock, rflags);
+        pending = true;
+    }
+
+    /* The callback may still be executing after it was dequeued for expiry. */
+    for (uint32_t i = 0; hrtimer_bases && i < hrtimer_base_count; i++)
+        while (__atomic_load_n(&hrtimer_bases[i].running, __ATOMIC_ACQUIRE) == timer) __asm__ volatile("pause");
+    return pending;
+}
+
+/* Whether a timer is pending. */
+bool hrtimer_active(const hrtimer_t *timer)
+{
+    return timer && __atomic_load_n(&timer->base, __ATOMIC_ACQUIRE) != NULL;
+}
+
+/* Earliest pending expiry on a CPU, or UINT64_MAX. */
+uint64_t hrtimer_next_expiry(uint32_t cpu)
+{
+    if (!hrtimer_bases || cpu >= hrtimer_base_count) return UINT64_MAX;
+
+    hrtimer_base_t *base   = &hrtimer_bases[cpu];
+    uint64_t        rflags = spin_lock_irqsave(&base->lock);
+    rb_node_t      *first  = rb_first(&base->root);
+    uint64_t        next   = first ? node_to_timer(first)->expires : UINT64_MAX;
+    spin_unlock_irqrestore(&base->lock, rflags);
+    return next;
+}
+
+/* Run the expired timers of the current CPU (timer interrupt context). */
+void hrtimer_run_queues(void)
+{
+    uint32_t cpu = get_current_cpu_id();
+    if (!hrtimer_bases || cpu >= hrtimer_base_count) return;
+
+    hrtimer_base_t *base = &hrtimer_bases[cpu];
+    if (rb_is_empty(&base->root)) return;
+
+    uint64_t now    = timer_monotonic_ns();
+    uint64_t rflags = spin_lock_irqsave(&base->lock);
+    for (;;) {
+        rb_node_t *first = rb_first(&base->root);
+        if (!first) break;
+
+        hrtimer_t *timer = node_to_timer(first);
+        if (timer->expires > now) break;
+
+        /*
+         * Publish the running callback before dropping the lock so that
+         * hrtimer_cancel() on another CPU waits for it to return.  The
+         * callback may re-arm its own timer.
+         */
+        hrtimer_dequeue_locked(timer);
+        __atomic_store_n(&base->running, timer, __ATOMIC_RELEASE);
+        spin_unlock_irqrestore(&base->lock, rflags);
+
+        timer->function(timer);
+
+        rflags = spin_lock_irqsave(&base->lock);
+        __atomic_store_n(&base->running, NULL, __ATOMIC_RELEASE);
+        base->expired++;
+    }
+    spin_unlock_irqrestore(&base->lock, rflags);
+}
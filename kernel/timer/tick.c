@@ -0,0 +1,160 @@
+/*
+ *
+ *      tick.c
+ *      Periodic tick and tickless idle
+ *
+ *      2026/10/17 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <arch/smp.h>
+#include <drivers/firmware/apic.h>
+#include <kernel/printk.h>
+#include <kernel/timer/hrtimer.h>
+#include <kernel/timer/tick.h>
+#include <kernel/timer/timer.h>
+#include <libs/std/stddef.h>
+#include <libs/std/stdint.h>
+#include <libs/std/stdlib.h>
+#include <mem/heap.h>
+#include <process/sched.h>
+
+/*
+ * Build system may pre-define these via -D in the Makefile.
+ * TICK_NOHZ=0 keeps the periodic tick running on idle CPUs.
+ */
+#ifndef TICK_NOHZ
+#    define TICK_NOHZ 1
+#endif
+#ifndef TICK_NOHZ_MAX_NS
+#    define TICK_NOHZ_MAX_NS TIMER_NSEC_PER_SEC // longest one-shot sleep of an idle AP
+#endif
+
+#define TICK_NOHZ_MIN_NS        (2 * TIMER_TICK_NS)        // shorter idle periods keep the tick
+#define TICK_NOHZ_TIMEKEEPER_NS (TIMER_NSEC_PER_SEC / 100U) // CPU 0 still runs deferred timer work at 100 Hz
+
+/*
+ * CPU 0 owns the global tick count.  While its tick is stopped, readers
+ * derive the current count from the time it stopped instead of waiting for
+ * the next catch-up.
+ */
+static tick_cpu_t *tick_cpus;
+static uint32_t    tick_cpu_count;
+static uint64_t    tick_timekeeper_base_ns; // CPU 0 stop_ns while stopped, else 0
+static uint64_t    tick_timekeeper_base;    // scheduler.ticks when CPU 0's tick stopped
+
+/* Allocate per-CPU tick and high-resolution timer state. */
+void tick_init(uint32_t cpu_count)
+{
+    if (!cpu_count) cpu_count = 1;
+    hrtimer_init_cpus(cpu_count);
+
+    tick_cpus = calloc(cpu_count, sizeof(tick_cpu_t));
+    if (!tick_cpus) {
+        plogk("tick: Cannot allocate per-CPU tick state, keeping the periodic tick.\n");
+        return;
+    }
+    for (uint32_t i = 0; i < cpu_count; i++) tick_cpus[i].next_event = UINT64_MAX;
+    tick_cpu_count = cpu_count;
+    plogk("tick: %s, high-resolution timers on %u CPU(s).\n", TICK_NOHZ ? "Tickless idle" : "Periodic tick", cpu_count);
+}
+
+/* Tick state of the current CPU, or NULL before tick_init() */
+static tick_cpu_t *tick_local(uint32_t *cpu)
+{
+    *cpu = get_current_cpu_id();
+    return tick_cpus && *cpu < tick_cpu_count ? &tick_cpus[*cpu] : NULL;
+}
+
+/* Account the whole ticks elapsed since stop_ns, carrying the remainder. */
+static void tick_nohz_catchup(uint32_t cpu, tick_cpu_t *tick, uint64_t now)
+{
+    if (now <= tick->stop_ns) return;
+    uint64_t skipped = (now - tick->stop_ns) / TIMER_TICK_NS;
+    if (!skipped) return;
+    tick->stop_ns += skipped * TIMER_TICK_NS;
+    sched_tick_skipped(cpu, skipped);
+}
+
+/* Up-to-date global tick count while CPU 0's tick is stopped (lock-free). */
+uint64_t tick_nohz_jiffies(uint64_t ticks)
+{
+    uint64_t base_ns = __atomic_load_n(&tick_timekeeper_base_ns, __ATOMIC_ACQUIRE);
+    if (!base_ns) return ticks;
+
+    uint64_t now     = timer_monotonic_ns();
+    uint64_t derived = __atomic_load_n(&tick_timekeeper_base, __ATOMIC_RELAXED) + (now > base_ns ? (now - base_ns) / TIMER_TICK_NS : 0);
+    return derived > ticks ? derived : ticks;
+}
+
+/* Timer interrupt hook: run expired hrtimers and catch up after a one-shot idle event. */
+bool tick_handle_interrupt(void)
+{
+    hrtimer_run_queues();
+
+    uint32_t    cpu;
+    tick_cpu_t *tick = tick_local(&cpu);
+    if (!tick || !tick->stopped) return true;
+
+    /* The idle loop restarts the periodic tick once this interrupt returns. */
+    tick_nohz_catchup(cpu, tick, timer_monotonic_ns());
+    return false;
+}
+
+/* Switch a CPU's tick to a one-shot event at next. */
+static void tick_nohz_stop(tick_cpu_t *tick, uint64_t now, uint64_t next)
+{
+    tick->stop_ns    = now - tick->carry_ns;
+    tick->next_event = next;
+    tick->stops++;
+    __atomic_store_n(&tick->stopped, 1, __ATOMIC_RELEASE);
+}
+
+/* Stop the periodic tick before halting, programming the next timer event instead. */
+void tick_nohz_idle_enter(void)
+{
+    uint32_t    cpu;
+    tick_cpu_t *tick = tick_local(&cpu);
+
+    if (!TICK_NOHZ || !tick || tick->stopped || !__atomic_load_n(&scheduler.started, __ATOMIC_ACQUIRE) || !cpu_rqs) return;
+    if (__atomic_load_n(&cpu_rqs[cpu].nr_running, __ATOMIC_ACQUIRE) || __atomic_load_n(&cpu_rqs[cpu].need_resched, __ATOMIC_ACQUIRE)) return;
+
+    uint64_t now  = timer_monotonic_ns();
+    uint64_t next = hrtimer_next_expiry(cpu);
+    uint64_t cap  = now + (cpu == 0 ? TICK_NOHZ_TIMEKEEPER_NS : TICK_NOHZ_MAX_NS);
+    if (cap < next) next = cap;
+
+    /*
+     * Tick deadlines are only ever queued on the CPU that is running, so
+     * this CPU's own timer tree cannot gain an earlier entry while it halts.
+     */
+    uint64_t ticks = sched_ticks();
+    uint64_t wake  = sched_next_timer_tick(cpu);
+    uint64_t ahead = wake > ticks ? wake - ticks : 0;
+    if (next > now && ahead < (next - now) / TIMER_TICK_NS) next = now + ahead * TIMER_TICK_NS;
+    if (next < now + TICK_NOHZ_MIN_NS) return;
+
+    if (cpu == 0) {
+        __atomic_store_n(&tick_timekeeper_base, ticks, __ATOMIC_RELAXED);
+        __atomic_store_n(&tick_timekeeper_base_ns, now - tick->carry_ns, __ATOMIC_RELEASE);
+    }
+    tick_nohz_stop(tick, now, next);
+    lapic_timer_oneshot(next - now);
+}
+
+/* Restart the periodic tick after the idle halt, accounting the ticks it skipped. */
+void tick_nohz_idle_exit(void)
+{
+    uint32_t    cpu;
+    tick_cpu_t *tick = tick_local(&cpu);
+    if (!tick || !tick->stopped) return;
+
+    uint64_t now = timer_monotonic_ns();
+    tick_nohz_catchup(cpu, tick, now);
+    tick->carry_ns   = now > tick->stop_ns ? now - tick->stop_ns : 0;
+    tick->next_event = UINT64_MAX;
+    if (cpu == 0) __atomic_store_n(&tick_timekeeper_base_ns, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&tick->stopped, 0, __ATOMIC_RELEASE);
+    lapic_timer_periodic();
+}
@@ -18,6 +18,7 @@
 #include <kernel/errno.h>
 #include <kernel/interrupt/interrupt.h>
 #include <kernel/printk.h>
+#include <kernel/timer/tick.h>
 #include <kernel/timer/timer.h>
 #include <libs/std/math.h>
 #include <libs/std/stdint.h>
@@ -78,7 +79,7 @@ static int timer_deferred_worker(void *arg)
 }
 
 /* Ask the deferred-timer worker to run once */
-static void timer_queue_deferred_work(void)
+void timer_queue_deferred_work(void)
 {
     bool wake = false;
 
@@ -183,6 +184,9 @@ void timer_handle_frame(syscall_frame_t *frame)
     task_t  *interrupted = current_task();
     if (interrupted && interrupted->process) signal_itimer_cpu_tick(interrupted->process, (frame->cs & 3U) == 3U);
     send_eoi();
+
+    /* Expire high-resolution timers; a one-shot idle event carries no periodic tick work. */
+    bool periodic = tick_handle_interrupt();
     if (cpu_id == 0 && timer_deferred_registered) {
         uint64_t now_ticks     = sched_ticks();
         uint64_t base_interval = TIMER_HZ / 100U;
@@ -197,6 +201,8 @@ void timer_handle_frame(syscall_frame_t *frame)
         }
     }
 
+    if (!periodic) return;
+
     /* Keep CPU-local/global maintenance ahead of the possible context switch. */
     sched_tick((frame->cs & 3U) == 3U);
     if ((frame->cs & 3U) == 3U) (void)signal_deliver_if_pending(frame);
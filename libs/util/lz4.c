@@ -0,0 +1,171 @@
+/*
+ *
+ *      lz4.c
+ *      LZ4 block compression
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <kernel/errno.h>
+#include <libs/std/stdbool.h>
+#include <libs/std/string.h>
+#include <libs/util/lz4.h>
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5  // the block always ends in at least this many literals
+#define LZ4_MF_LIMIT      12 // no match may start this close to the end
+#define LZ4_HASH_BITS     12
+#define LZ4_SKIP_TRIGGER  6 // scan faster through data that keeps missing
+
+/*
+ * Block format
+ * A block is a run of sequences.  Each starts with a token whose high
+ * nibble is the literal count and low nibble the match length minus four;
+ * a nibble of 15 continues in following bytes of 255 plus a final
+ * remainder.  The literals follow the token, then a little-endian 16-bit
+ * back offset and the match length continuation.  The last sequence
+ * carries literals only.
+ */
+
+/* Read four unaligned bytes. */
+static inline uint32_t lz4_read32(const uint8_t *p)
+{
+    uint32_t value;
+    __builtin_memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/* Hash the four bytes at a position into the match table. */
+static inline uint32_t lz4_hash(uint32_t value)
+{
+    return (value * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+/* Emit the continuation bytes for a nibble that saturated at 15. */
+static uint8_t *lz4_put_length(uint8_t *op, size_t length)
+{
+    for (length -= 15; length >= 255; length -= 255) *op++ = 255;
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+/* Compress size bytes into an LZ4 block; returns the block length, or 0 if it does not fit in capacity. */
+size_t lz4_compress(const void *source, size_t size, void *dest, size_t capacity)
+{
+    const uint8_t *src    = source;
+    const uint8_t *ip     = src;
+    const uint8_t *anchor = src;
+    const uint8_t *iend   = src + size;
+    uint8_t       *op     = dest;
+    uint8_t       *oend   = op + capacity;
+    uint16_t       table[1U << LZ4_HASH_BITS];
+
+    if (size > LZ4_MAX_INPUT) return 0;
+    if (size > LZ4_MF_LIMIT) {
+        const uint8_t *mflimit    = iend - LZ4_MF_LIMIT;
+        const uint8_t *matchlimit = iend - LZ4_LAST_LITERALS;
+        uint32_t       misses     = 1U << LZ4_SKIP_TRIGGER;
+        memset(table, 0, sizeof(table));
+        table[lz4_hash(lz4_read32(ip))] = 0;
+        ip++;
+
+        while (ip < mflimit) {
+            uint32_t       hash = lz4_hash(lz4_read32(ip));
+            const uint8_t *ref  = src + table[hash];
+            table[hash]         = (uint16_t)(ip - src);
+            if (ref >= ip || lz4_read32(ref) != lz4_read32(ip)) {
+                ip += misses++ >> LZ4_SKIP_TRIGGER;
+                continue;
+            }
+            misses = 1U << LZ4_SKIP_TRIGGER;
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *end = ip + LZ4_MIN_MATCH;
+            for (const uint8_t *r = ref + LZ4_MIN_MATCH; end < matchlimit && *end == *r; r++) end++;
+
+            size_t literals = (size_t)(ip - anchor);
+            size_t match    = (size_t)(end - ip) - LZ4_MIN_MATCH;
+            if ((size_t)(oend - op) < literals + literals / 255 + match / 255 + 5) return 0;
+
+            uint8_t *token = op++;
+            *token         = (uint8_t)(((literals < 15 ? literals : 15) << 4) | (match < 15 ? match : 15));
+            if (literals >= 15) op = lz4_put_length(op, literals);
+            memcpy(op, anchor, literals);
+            op += literals;
+            uint16_t offset = (uint16_t)(ip - ref);
+            *op++           = (uint8_t)offset;
+            *op++           = (uint8_t)(offset >> 8);
+            if (match >= 15) op = lz4_put_length(op, match);
+
+            /* Seed the table inside the match so the next search sees it. */
+            table[lz4_hash(lz4_read32(end - 2))] = (uint16_t)(end - 2 - src);
+            ip = anchor = end;
+        }
+    }
+
+    size_t literals = (size_t)(iend - anchor);
+    if ((size_t)(oend - op) < literals + literals / 255 + 2) return 0;
+    *op++ = (uint8_t)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) op = lz4_put_length(op, literals);
+    memcpy(op, anchor, literals);
+    op += literals;
+    return (size_t)(op - (uint8_t *)dest);
+}
+
+/* Read a length continuation; returns false if it runs off the input. */
+static bool lz4_get_length(const uint8_t **ip, const uint8_t *iend, size_t *length)
+{
+    uint8_t byte;
+    do {
+        if (*ip >= iend) return false;
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/* Decompress an LZ4 block; returns the decoded length, or a negative errno on malformed input. */
+int lz4_decompress(const void *source, size_t size, void *dest, size_t capacity)
+{
+    const uint8_t *ip   = source;
+    const uint8_t *iend = ip + size;
+    uint8_t       *dst  = dest;
+    uint8_t       *op   = dst;
+    uint8_t       *oend = dst + capacity;
+
+    if (!size) return -EINVAL;
+    while (ip < iend) {
+        uint8_t token    = *ip++;
+        size_t  literals = token >> 4;
+        if (literals == 15 && !lz4_get_length(&ip, iend, &literals)) return -EINVAL;
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) return -EINVAL;
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return -EINVAL;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        size_t match  = token & 15;
+        ip += 2;
+        if (!offset || offset > (size_t)(op - dst)) return -EINVAL;
+        if (match == 15 && !lz4_get_length(&ip, iend, &match)) return -EINVAL;
+        match += LZ4_MIN_MATCH;
+        if (match > (size_t)(oend - op)) return -EINVAL;
+
+        /* Overlapping matches replicate the bytes just written, so copy forwards. */
+        const uint8_t *ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            while (match--) *op++ = *ref++;
+        }
+    }
+    return (int)(op - dst);
+}
@@ -8,14 +8,19 @@
  *
  */
 
+#include <arch/smp.h>
 #include <kernel/printk.h>
 #include <libs/std/stddef.h>
 #include <libs/std/stdint.h>
 #include <libs/std/string.h>
 #include <mem/alloc.h>
+#include <mem/bitmap.h>
 #include <mem/buddy.h>
+#include <mem/frame.h>
+#include <mem/hhdm.h>
 #include <mem/page.h>
 #include <mem/slab.h>
+#include <process/sched.h>
 #include <sync/spin_lock.h>
 
 #define HEAP_MIN_ALIGNMENT 16U
@@ -26,6 +31,7 @@
 #define LARGE_MAGIC        0x4c41524755494e58ULL
 #define OBJECT_FREE        0U
 #define OBJECT_ALLOCATED   1U
+#define OBJECT_CACHED      2U
 #define LARGE_ALLOCATED    1U
 #define SLAB_LIST_NONE     0U
 #define SLAB_LIST_PARTIAL  1U
@@ -33,6 +39,33 @@
 #define SLAB_LIST_EMPTY    3U
 #define FREE_POISON        0x6b
 
+/*
+ * Bonwick-style magazine layer.  Every CPU owns a loaded and a previous
+ * magazine per cache, so the common alloc/free path only touches that CPU's
+ * slot.  The per-CPU lock is uncontended in practice; it exists so that
+ * shrink/reclaim can drain remote CPUs without an IPI.  The depot exchanges
+ * whole magazines and is only visited once per SLAB_MAGAZINE_ROUNDS objects.
+ */
+#define SLAB_MAGAZINE_ROUNDS 14U
+#define SLAB_DEPOT_FULL_MAX  16U
+#define SLAB_PCP_MAX_CPUS    256U
+#define SLAB_CACHELINE       64U
+
+/*
+ * The heap reserves a large virtual window but only backs it with 2 MiB
+ * chunks from the frame allocator as it grows.  Buddy metadata and the chunk
+ * bitmap live in a separate window in front of the data and are mapped with
+ * 4 KiB frames as the buddy's index space grows.  Fully free chunks beyond the
+ * boot population are handed back to the frame allocator by heap_trim().
+ */
+#define HEAP_CHUNK_SIZE   PAGE_2M_SIZE
+#define HEAP_CHUNK_PAGES  (HEAP_CHUNK_SIZE / PAGE_4K_SIZE)
+#define HEAP_CHUNK_ORDER  9U
+#define HEAP_TRIM_SLACK   2U
+#define HEAP_TRIM_BATCH   16U
+#define HEAP_PML4_SPAN    (1ULL << 39)
+#define HEAP_PTE_FLAGS    (PTE_PRESENT | PTE_WRITEABLE)
+
 typedef struct slab_header slab_header_t;
 
 typedef struct slab_object_header {
@@ -60,6 +93,21 @@ typedef struct slab_header {
         uintptr_t             object_start;
 } slab_header_t;
 
+typedef struct slab_magazine {
+        struct slab_magazine *next;
+        uint32_t              rounds;
+        uint32_t              reserved;
+        void                 *objects[SLAB_MAGAZINE_ROUNDS];
+} slab_magazine_t;
+
+typedef struct {
+        spinlock_t       lock;
+        slab_magazine_t *loaded;
+        slab_magazine_t *previous;
+        size_t           allocations;
+        size_t           frees;
+} __attribute__((aligned(SLAB_CACHELINE))) slab_cpu_cache_t;
+
 typedef struct slab_cache {
         spinlock_t     lock;
         char           name[SLAB_NAME_LENGTH];
@@ -83,6 +131,19 @@ typedef struct slab_cache {
         slab_dtor_t    dtor;
         uint8_t        dynamic;
         uint8_t        destroying;
+        uint8_t        no_magazines;
+        uint8_t        cpu_state;
+
+        /* Magazine layer: per-CPU slots plus the shared depot. */
+        slab_cpu_cache_t *cpu;
+        uint32_t          cpu_count;
+        spinlock_t        depot_lock;
+        slab_magazine_t  *depot_full;
+        slab_magazine_t  *depot_empty;
+        size_t            depot_full_count;
+        size_t            depot_empty_count;
+        slab_cache_t     *registry_next;
+        uint32_t          registry_refs; // slab_reclaim() walkers parked on this cache
 } slab_cache_t;
 
 typedef struct {
@@ -102,25 +163,44 @@ typedef struct {
 typedef struct {
         uint8_t          *base;
         size_t            size;
-        size_t            page_count;
-        size_t            metadata_pages;
+        size_t            chunk_count;
+        size_t            resident_chunks;
+        size_t            min_chunks;
+        uint8_t          *metadata;
+        size_t            metadata_mapped;
+        size_t            pages_offset;
+        bitmap_t          populated;
         buddy_allocator_t pages;
         spinlock_t        page_lock;
+        spinlock_t        grow_lock;
         uintptr_t         cookie;
         volatile uint8_t  online;
         error_handler     onerror;
-        size_t            live_allocations;
-        size_t            allocated_bytes;
-        size_t            allocation_calls;
-        size_t            free_calls;
-        size_t            failed_allocations;
 } heap_state_t;
 
-static heap_state_t heap;
+/*
+ * malloc()/free() counters are kept per CPU and folded on demand by
+ * heap_get_stats().  Deltas may be negative on one CPU (allocated on A, freed
+ * on B); unsigned wrap-around makes the folded sum exact regardless.  The
+ * last slot is shared by early boot and CPUs beyond SLAB_PCP_MAX_CPUS.
+ */
+typedef struct {
+        size_t live_allocations;
+        size_t allocated_bytes;
+        size_t allocation_calls;
+        size_t free_calls;
+        size_t failed_allocations;
+} __attribute__((aligned(SLAB_CACHELINE))) heap_cpu_stats_t;
+
+static heap_state_t     heap;
+static heap_cpu_stats_t heap_cpu_stats[SLAB_PCP_MAX_CPUS + 1];
 
 static const size_t size_classes[] = {16, 32, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192};
 #define SIZE_CACHE_COUNT (sizeof(size_classes) / sizeof(size_classes[0]))
-static slab_cache_t size_caches[SIZE_CACHE_COUNT];
+static slab_cache_t  size_caches[SIZE_CACHE_COUNT];
+static slab_cache_t  magazine_cache;
+static slab_cache_t *cache_registry;
+static spinlock_t    cache_registry_lock;
 
 /* Round value up to the next multiple of alignment. */
 static size_t align_up_size(size_t value, size_t alignment)
@@ -168,6 +248,20 @@ static void stat_sub(size_t *value, size_t amount)
     __atomic_sub_fetch(value, amount, __ATOMIC_RELAXED);
 }
 
+/* Early boot allocations all belong to the shared slot; topology is not safe yet. */
+static uint32_t slab_pcp_cpu(void)
+{
+    if (!__atomic_load_n(&scheduler.started, __ATOMIC_ACQUIRE)) return SLAB_PCP_MAX_CPUS;
+    uint32_t cpu = get_current_cpu_id();
+    return cpu < SLAB_PCP_MAX_CPUS ? cpu : SLAB_PCP_MAX_CPUS;
+}
+
+/* Return this CPU's heap counter slot. */
+static heap_cpu_stats_t *heap_stats_local(void)
+{
+    return &heap_cpu_stats[slab_pcp_cpu()];
+}
+
 /* Cap the buddy order to fit the requested number of pages. */
 static unsigned heap_max_order(size_t pages)
 {
@@ -181,17 +275,107 @@ static void *page_address(size_t index)
     return heap.base + index * PAGE_4K_SIZE;
 }
 
+static uint64_t chunk_address(size_t chunk)
+{
+    return (uint64_t)(uintptr_t)heap.base + chunk * HEAP_CHUNK_SIZE;
+}
+
+/* Back metadata bytes [0, bytes) of the metadata window with zeroed frames. */
+static int heap_map_metadata(size_t bytes)
+{
+    bytes = align_up_size(bytes, PAGE_4K_SIZE);
+    while (heap.metadata_mapped < bytes) {
+        uint64_t frame = alloc_frames(1);
+        if (!frame) return -1;
+        memset(phys_to_virt(frame), 0, PAGE_4K_SIZE);
+        page_map_to(get_kernel_pagedir(), (uint64_t)(uintptr_t)heap.metadata + heap.metadata_mapped, frame, HEAP_PTE_FLAGS);
+        heap.metadata_mapped += PAGE_4K_SIZE;
+    }
+    return 0;
+}
+
+/*
+ * Every address space copies the kernel PML4 entries when it is created, so
+ * the top-level tables covering the window must exist before the first
+ * process; chunks mapped later then show up everywhere.
+ */
+static int heap_share_top_level(uintptr_t start, uintptr_t end)
+{
+    page_directory_t *directory = get_kernel_pagedir();
+    for (uintptr_t address = start & ~(uintptr_t)(HEAP_PML4_SPAN - 1); address < end; address += HEAP_PML4_SPAN)
+        if (!page_table_create(&directory->table->entries[(address >> 39) & 0x1ff])) return -1;
+    return 0;
+}
+
+/* Map count fresh 2 MiB chunks at slot first and hand them to the buddy; caller holds grow_lock. */
+static int heap_populate(size_t first, size_t count)
+{
+    size_t end_pages = (first + count) * HEAP_CHUNK_PAGES;
+    if (end_pages > heap.pages.page_count && heap_map_metadata(heap.pages_offset + end_pages * sizeof(buddy_page_t))) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t frame = alloc_frames_2M(1);
+        if (!frame) {
+            while (i--) free_frames_2M(page_unmap_2M(get_kernel_pagedir(), chunk_address(first + i)));
+            return -1;
+        }
+        page_map_to_2M(get_kernel_pagedir(), chunk_address(first + i), frame, HEAP_PTE_FLAGS);
+    }
+
+    uint64_t rflags = spin_lock_irqsave(&heap.page_lock);
+    if (end_pages > heap.pages.page_count) (void)buddy_extend(&heap.pages, end_pages);
+    int result = buddy_add_range(&heap.pages, first * HEAP_CHUNK_PAGES, count * HEAP_CHUNK_PAGES);
+    spin_unlock_irqrestore(&heap.page_lock, rflags);
+    if (result) {
+        plogk("alloc: Cannot add heap chunk %llu to the page buddy\n", (uint64_t)first);
+        return -1;
+    }
+    bitmap_set_range(&heap.populated, first, first + count, 1);
+    heap.resident_chunks += count;
+    return 0;
+}
+
+/* Grow the heap until a block of the given order may be available. */
+static int heap_grow(unsigned order)
+{
+    size_t   count  = order > HEAP_CHUNK_ORDER ? (size_t)1 << (order - HEAP_CHUNK_ORDER) : 1;
+    uint64_t rflags = spin_lock_irqsave(&heap.grow_lock);
+
+    /* Another CPU may have grown the heap while we waited for the lock. */
+    uint64_t page_flags = spin_lock_irqsave(&heap.page_lock);
+    int      available  = 0;
+    for (unsigned found = order; found <= heap.pages.max_order && !available; found++) available = heap.pages.free_head[found] != BUDDY_INDEX_NONE;
+    spin_unlock_irqrestore(&heap.page_lock, page_flags);
+
+    int result = 0;
+    if (!available) {
+        size_t first = SIZE_MAX;
+        for (size_t slot = 0; slot + count <= heap.chunk_count; slot += count) {
+            if (bitmap_range_all(&heap.populated, slot, slot + count, 0)) {
+                first = slot;
+                break;
+            }
+        }
+        result = first == SIZE_MAX ? -1 : heap_populate(first, count);
+    }
+    spin_unlock_irqrestore(&heap.grow_lock, rflags);
+    return result;
+}
+
 /* Tag allocated pages so pointer_owner() can locate the owning block. */
 static size_t page_alloc(unsigned order)
 {
-    uint64_t rflags = spin_lock_irqsave(&heap.page_lock);
-    size_t   index  = buddy_alloc(&heap.pages, order);
-    if (index != SIZE_MAX) {
-        size_t pages = (size_t)1 << order;
-        for (size_t i = 0; i < pages; i++) heap.pages.pages[index + i].tag = (uint32_t)(index + 1);
+    if (order > heap.pages.max_order) return SIZE_MAX;
+    for (;;) {
+        uint64_t rflags = spin_lock_irqsave(&heap.page_lock);
+        size_t   index  = buddy_alloc(&heap.pages, order);
+        if (index != SIZE_MAX) {
+            size_t pages = (size_t)1 << order;
+            for (size_t i = 0; i < pages; i++) heap.pages.pages[index + i].tag = (uint32_t)(index + 1);
+        }
+        spin_unlock_irqrestore(&heap.page_lock, rflags);
+        if (index != SIZE_MAX || heap_grow(order)) return index;
     }
-    spin_unlock_irqrestore(&heap.page_lock, rflags);
-    return index;
 }
 
 static int page_free(size_t index, unsigned order)
@@ -357,29 +541,55 @@ static void slab_release_locked(slab_cache_t *cache, slab_header_t *slab)
     (void)page_free(page_index, order);
 }
 
-/* Take one object from a cache, growing a new slab when empty. */
-static void *cache_alloc_requested(slab_cache_t *cache, size_t requested)
-{
-    if (!cache || cache->destroying) return NULL;
-    uint64_t rflags = spin_lock_irqsave(&cache->lock);
+static int pointer_owner(void *pointer, size_t *owner_index, void **owner);
 
+/* Detach one free object from the cache's slabs, growing a new slab when empty. */
+static slab_object_header_t *object_take_locked(slab_cache_t *cache)
+{
     slab_header_t *slab = cache->partial ? cache->partial : cache->empty;
     if (!slab) slab = slab_create_locked(cache);
-    if (!slab || !slab->free_list) {
-        spin_unlock_irqrestore(&cache->lock, rflags);
-        return NULL;
-    }
+    if (!slab || !slab->free_list) return NULL;
 
     list_remove(cache, slab);
     slab_object_header_t *object = slab->free_list;
     slab->free_list              = object->next_free;
     object->next_free            = NULL;
-    object->requested            = requested;
-    object->state                = OBJECT_ALLOCATED;
     slab->inuse++;
     cache->objects++;
-    cache->allocations++;
     list_insert(cache, slab, slab->inuse == slab->object_count ? SLAB_LIST_FULL : SLAB_LIST_PARTIAL);
+    return object;
+}
+
+/* Put one detached object back on its slab; caller holds cache->lock. */
+static void object_release_locked(slab_cache_t *cache, slab_header_t *slab, slab_object_header_t *object)
+{
+    list_remove(cache, slab);
+    object->requested = 0;
+    object->state     = OBJECT_FREE;
+    object->next_free = slab->free_list;
+    slab->free_list   = object;
+    slab->inuse--;
+    cache->objects--;
+    list_insert(cache, slab, slab->inuse ? SLAB_LIST_PARTIAL : SLAB_LIST_EMPTY);
+
+    /* Retain one warm empty slab per cache and reclaim surplus immediately. */
+    if (!slab->inuse && cache->empty_count > 1) slab_release_locked(cache, slab);
+}
+
+/* Take one object from a cache, growing a new slab when empty. */
+static void *cache_alloc_requested(slab_cache_t *cache, size_t requested)
+{
+    if (!cache || cache->destroying) return NULL;
+    uint64_t rflags = spin_lock_irqsave(&cache->lock);
+
+    slab_object_header_t *object = object_take_locked(cache);
+    if (!object) {
+        spin_unlock_irqrestore(&cache->lock, rflags);
+        return NULL;
+    }
+    object->requested = requested;
+    object->state     = OBJECT_ALLOCATED;
+    cache->allocations++;
 
     void *result = (uint8_t *)object + cache->payload_offset;
     if (cache->ctor) cache->ctor(result);
@@ -387,29 +597,33 @@ static void *cache_alloc_requested(slab_cache_t *cache, size_t requested)
     return result;
 }
 
-/* Put an object back on its slab and update the cache bookkeeping. */
-static int cache_free_object(slab_cache_t *expected, slab_header_t *slab, void *pointer, size_t *released)
+/* Resolve and sanity-check the object header behind a payload pointer. */
+static int object_lookup(slab_cache_t *cache, slab_header_t *slab, void *pointer, slab_object_header_t **result)
 {
-    slab_cache_t *cache = slab ? slab->cache : NULL;
-    if (!cache || (expected && expected != cache)) return -1;
-
-    uint64_t rflags = spin_lock_irqsave(&cache->lock);
-    if (slab->magic != SLAB_MAGIC || slab->cookie != slab_cookie(slab) || slab->cache != cache || slab->list == SLAB_LIST_NONE) {
-        spin_unlock_irqrestore(&cache->lock, rflags);
-        return -2;
-    }
+    if (slab->magic != SLAB_MAGIC || slab->cookie != slab_cookie(slab) || slab->cache != cache) return -2;
 
     uintptr_t payload_start = slab->object_start + cache->payload_offset;
     uintptr_t address       = (uintptr_t)pointer;
-    if (address < payload_start || (address - payload_start) % cache->stride || (address - payload_start) / cache->stride >= slab->object_count) {
-        spin_unlock_irqrestore(&cache->lock, rflags);
-        return -1;
-    }
+    if (address < payload_start || (address - payload_start) % cache->stride || (address - payload_start) / cache->stride >= slab->object_count) return -1;
 
     slab_object_header_t *object = (void *)(address - cache->payload_offset);
-    if (object->magic != SLAB_OBJECT_MAGIC || object->slab != slab || object->cookie != object_cookie(object)) {
+    if (object->magic != SLAB_OBJECT_MAGIC || object->slab != slab || object->cookie != object_cookie(object)) return -2;
+    *result = object;
+    return 0;
+}
+
+/* Put an object back on its slab and update the cache bookkeeping. */
+static int cache_free_object(slab_cache_t *expected, slab_header_t *slab, void *pointer, size_t *released)
+{
+    slab_cache_t *cache = slab ? slab->cache : NULL;
+    if (!cache || (expected && expected != cache)) return -1;
+
+    uint64_t              rflags = spin_lock_irqsave(&cache->lock);
+    slab_object_header_t *object = NULL;
+    int                   result = slab->list == SLAB_LIST_NONE ? -2 : object_lookup(cache, slab, pointer, &object);
+    if (result) {
         spin_unlock_irqrestore(&cache->lock, rflags);
-        return -2;
+        return result;
     }
     if (object->state != OBJECT_ALLOCATED) {
         spin_unlock_irqrestore(&cache->lock, rflags);
@@ -423,23 +637,325 @@ static int cache_free_object(slab_cache_t *expected, slab_header_t *slab, void *
     size_t requested = object->requested;
     if (cache->dtor) cache->dtor(pointer);
     memset(pointer, FREE_POISON, cache->object_size);
-    list_remove(cache, slab);
-    object->requested = 0;
-    object->state     = OBJECT_FREE;
-    object->next_free = slab->free_list;
-    slab->free_list   = object;
-    slab->inuse--;
-    cache->objects--;
+    object_release_locked(cache, slab, object);
     cache->frees++;
-    list_insert(cache, slab, slab->inuse ? SLAB_LIST_PARTIAL : SLAB_LIST_EMPTY);
+    spin_unlock_irqrestore(&cache->lock, rflags);
+    if (released) *released = requested;
+    return 0;
+}
 
-    /* Retain one warm empty slab per cache and reclaim surplus immediately. */
-    if (!slab->inuse && cache->empty_count > 1) slab_release_locked(cache, slab);
+/* Allocate an empty magazine from the internal, magazine-less cache. */
+static slab_magazine_t *magazine_alloc(void)
+{
+    slab_magazine_t *magazine = cache_alloc_requested(&magazine_cache, sizeof(*magazine));
+    if (!magazine) return NULL;
+    magazine->next   = NULL;
+    magazine->rounds = 0;
+    return magazine;
+}
+
+/* Return a magazine shell to the internal cache. */
+static void magazine_free(slab_magazine_t *magazine)
+{
+    size_t owner_index;
+    void  *owner;
+    if (pointer_owner(magazine, &owner_index, &owner)) return;
+    (void)owner_index;
+    (void)cache_free_object(&magazine_cache, (slab_header_t *)owner, magazine, NULL);
+}
+
+/* Return every round of a magazine to the slab layer under one lock hold. */
+static void magazine_flush(slab_cache_t *cache, slab_magazine_t *magazine)
+{
+    if (!magazine->rounds) return;
+    uint64_t rflags = spin_lock_irqsave(&cache->lock);
+    for (uint32_t i = 0; i < magazine->rounds; i++) {
+        slab_object_header_t *object = (void *)((uintptr_t)magazine->objects[i] - cache->payload_offset);
+        if (object->state == OBJECT_CACHED) object_release_locked(cache, object->slab, object);
+    }
+    magazine->rounds = 0;
+    spin_unlock_irqrestore(&cache->lock, rflags);
+}
+
+/* Fill an empty magazine straight from the slab layer, growing at most one slab. */
+static void magazine_fill(slab_cache_t *cache, slab_magazine_t *magazine)
+{
+    uint64_t rflags = spin_lock_irqsave(&cache->lock);
+    while (magazine->rounds < SLAB_MAGAZINE_ROUNDS) {
+        if (magazine->rounds && !cache->partial && !cache->empty) break;
+        slab_object_header_t *object = object_take_locked(cache);
+        if (!object) break;
+        object->state                         = OBJECT_CACHED;
+        magazine->objects[magazine->rounds++] = (uint8_t *)object + cache->payload_offset;
+    }
     spin_unlock_irqrestore(&cache->lock, rflags);
+}
+
+/* Pop a full magazine from the depot. */
+static slab_magazine_t *depot_take_full(slab_cache_t *cache)
+{
+    uint64_t         rflags   = spin_lock_irqsave(&cache->depot_lock);
+    slab_magazine_t *magazine = cache->depot_full;
+    if (magazine) {
+        cache->depot_full = magazine->next;
+        cache->depot_full_count--;
+        magazine->next = NULL;
+    }
+    spin_unlock_irqrestore(&cache->depot_lock, rflags);
+    return magazine;
+}
+
+/* Pop an empty magazine from the depot, allocating one when none is cached. */
+static slab_magazine_t *depot_take_empty(slab_cache_t *cache)
+{
+    uint64_t         rflags   = spin_lock_irqsave(&cache->depot_lock);
+    slab_magazine_t *magazine = cache->depot_empty;
+    if (magazine) {
+        cache->depot_empty = magazine->next;
+        cache->depot_empty_count--;
+        magazine->next = NULL;
+    }
+    spin_unlock_irqrestore(&cache->depot_lock, rflags);
+    return magazine ? magazine : magazine_alloc();
+}
+
+/* Hand a magazine to the depot; overflowing full magazines are flushed to the slabs. */
+static void depot_put(slab_cache_t *cache, slab_magazine_t *magazine)
+{
+    if (magazine->rounds && __atomic_load_n(&cache->depot_full_count, __ATOMIC_RELAXED) >= SLAB_DEPOT_FULL_MAX) magazine_flush(cache, magazine);
+
+    uint64_t rflags = spin_lock_irqsave(&cache->depot_lock);
+    if (magazine->rounds) {
+        magazine->next    = cache->depot_full;
+        cache->depot_full = magazine;
+        cache->depot_full_count++;
+    } else {
+        magazine->next     = cache->depot_empty;
+        cache->depot_empty = magazine;
+        cache->depot_empty_count++;
+    }
+    spin_unlock_irqrestore(&cache->depot_lock, rflags);
+}
+
+/* Return every depot magazine to the slab layer; reports the objects released. */
+static size_t depot_drain(slab_cache_t *cache)
+{
+    uint64_t         rflags = spin_lock_irqsave(&cache->depot_lock);
+    slab_magazine_t *full   = cache->depot_full;
+    slab_magazine_t *empty  = cache->depot_empty;
+    cache->depot_full       = NULL;
+    cache->depot_empty      = NULL;
+    cache->depot_full_count = cache->depot_empty_count = 0;
+    spin_unlock_irqrestore(&cache->depot_lock, rflags);
+
+    size_t objects = 0;
+    while (full) {
+        slab_magazine_t *next = full->next;
+        objects += full->rounds;
+        magazine_flush(cache, full);
+        magazine_free(full);
+        full = next;
+    }
+    while (empty) {
+        slab_magazine_t *next = empty->next;
+        magazine_free(empty);
+        empty = next;
+    }
+    return objects;
+}
+
+/* Flush and release both magazines of one CPU slot. */
+static void cpu_cache_drain(slab_cache_t *cache, slab_cpu_cache_t *cpu)
+{
+    uint64_t         rflags   = spin_lock_irqsave(&cpu->lock);
+    slab_magazine_t *loaded   = cpu->loaded;
+    slab_magazine_t *previous = cpu->previous;
+    cpu->loaded               = NULL;
+    cpu->previous             = NULL;
+    spin_unlock_irqrestore(&cpu->lock, rflags);
+
+    if (loaded) {
+        magazine_flush(cache, loaded);
+        magazine_free(loaded);
+    }
+    if (previous) {
+        magazine_flush(cache, previous);
+        magazine_free(previous);
+    }
+}
+
+/* Allocate the per-CPU slots of a cache once SMP topology is final. */
+static slab_cpu_cache_t *cache_cpu_init(slab_cache_t *cache)
+{
+    uint8_t expected = 0;
+    if (!__atomic_compare_exchange_n(&cache->cpu_state, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return __atomic_load_n(&cache->cpu, __ATOMIC_ACQUIRE);
+
+    uint32_t count = get_cpu_count();
+    if (!count) count = 1;
+    if (count > SLAB_PCP_MAX_CPUS) count = SLAB_PCP_MAX_CPUS;
+
+    slab_cpu_cache_t *cpus = aligned_alloc(SLAB_CACHELINE, count * sizeof(*cpus));
+    if (!cpus) {
+        __atomic_store_n(&cache->cpu_state, 0, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    memset(cpus, 0, count * sizeof(*cpus));
+    cache->cpu_count = count;
+    __atomic_store_n(&cache->cpu, cpus, __ATOMIC_RELEASE);
+    return cpus;
+}
+
+/* Return this CPU's magazine slot, or NULL when the locked path must be used. */
+static slab_cpu_cache_t *cache_cpu(slab_cache_t *cache)
+{
+    if (cache->no_magazines || cache->destroying) return NULL;
+    uint32_t cpu = slab_pcp_cpu();
+    if (cpu >= SLAB_PCP_MAX_CPUS) return NULL;
+
+    slab_cpu_cache_t *cpus = __atomic_load_n(&cache->cpu, __ATOMIC_ACQUIRE);
+    if (!cpus) cpus = cache_cpu_init(cache);
+    return cpus && cpu < cache->cpu_count ? &cpus[cpu] : NULL;
+}
+
+/* Pop a round from the CPU's magazines, exchanging with the depot when both are empty. */
+static void *cpu_cache_pop(slab_cache_t *cache, slab_cpu_cache_t *cpu)
+{
+    if (cpu->loaded && cpu->loaded->rounds) return cpu->loaded->objects[--cpu->loaded->rounds];
+    if (cpu->previous && cpu->previous->rounds) {
+        slab_magazine_t *magazine = cpu->loaded;
+        cpu->loaded               = cpu->previous;
+        cpu->previous             = magazine;
+        return cpu->loaded->objects[--cpu->loaded->rounds];
+    }
+
+    slab_magazine_t *full = depot_take_full(cache);
+    if (!full) {
+        /* Depot is dry: refill the loaded magazine from the slabs in one batch. */
+        if (!cpu->loaded) cpu->loaded = magazine_alloc();
+        if (!cpu->loaded) return NULL;
+        magazine_fill(cache, cpu->loaded);
+        return cpu->loaded->rounds ? cpu->loaded->objects[--cpu->loaded->rounds] : NULL;
+    }
+    if (cpu->previous) depot_put(cache, cpu->previous);
+    cpu->previous = cpu->loaded;
+    cpu->loaded   = full;
+    return cpu->loaded->objects[--cpu->loaded->rounds];
+}
+
+/* Push a round onto the CPU's magazines, exchanging with the depot when both are full. */
+static int cpu_cache_push(slab_cache_t *cache, slab_cpu_cache_t *cpu, void *pointer)
+{
+    if (!cpu->loaded || cpu->loaded->rounds == SLAB_MAGAZINE_ROUNDS) {
+        if (cpu->previous && cpu->previous->rounds < SLAB_MAGAZINE_ROUNDS) {
+            slab_magazine_t *magazine = cpu->loaded;
+            cpu->loaded               = cpu->previous;
+            cpu->previous             = magazine;
+        } else {
+            slab_magazine_t *empty = depot_take_empty(cache);
+            if (!empty) return -1;
+            if (cpu->previous) depot_put(cache, cpu->previous);
+            cpu->previous = cpu->loaded;
+            cpu->loaded   = empty;
+        }
+    }
+    cpu->loaded->objects[cpu->loaded->rounds++] = pointer;
+    return 0;
+}
+
+/* Allocate one object, serving it from this CPU's magazines when possible. */
+static void *cache_alloc(slab_cache_t *cache, size_t requested)
+{
+    slab_cpu_cache_t *cpu = cache ? cache_cpu(cache) : NULL;
+    if (!cpu) return cache_alloc_requested(cache, requested);
+
+    uint64_t rflags  = spin_lock_irqsave(&cpu->lock);
+    void    *pointer = cpu_cache_pop(cache, cpu);
+    if (pointer) cpu->allocations++;
+    spin_unlock_irqrestore(&cpu->lock, rflags);
+    if (!pointer) return cache_alloc_requested(cache, requested);
+
+    slab_object_header_t *object = (void *)((uintptr_t)pointer - cache->payload_offset);
+    object->requested            = requested;
+    __atomic_store_n(&object->state, OBJECT_ALLOCATED, __ATOMIC_RELEASE);
+    if (cache->ctor) cache->ctor(pointer);
+    return pointer;
+}
+
+/* Free one object into this CPU's magazines, falling back to the slab layer. */
+static int cache_free(slab_cache_t *expected, slab_header_t *slab, void *pointer, size_t *released)
+{
+    slab_cache_t     *cache = slab && slab->magic == SLAB_MAGIC ? slab->cache : NULL;
+    slab_cpu_cache_t *cpu   = NULL;
+    if (cache && (!expected || expected == cache)) cpu = cache_cpu(cache);
+    if (!cpu) return cache_free_object(expected, slab, pointer, released);
+
+    slab_object_header_t *object = NULL;
+    int                   result = object_lookup(cache, slab, pointer, &object);
+    if (result) return result;
+    size_t requested = object->requested;
+    if (!requested || requested > cache->object_size) return -2;
+
+    /* The state transition doubles as the double-free check for cached objects. */
+    uint32_t state = OBJECT_ALLOCATED;
+    if (!__atomic_compare_exchange_n(&object->state, &state, OBJECT_CACHED, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return -1;
+    if (cache->dtor) cache->dtor(pointer);
+    memset(pointer, FREE_POISON, cache->object_size);
+    object->requested = 0;
+
+    uint64_t rflags = spin_lock_irqsave(&cpu->lock);
+    result          = cpu_cache_push(cache, cpu, pointer);
+    if (!result) cpu->frees++;
+    spin_unlock_irqrestore(&cpu->lock, rflags);
+
+    if (result) {
+        rflags = spin_lock_irqsave(&cache->lock);
+        object_release_locked(cache, slab, object);
+        cache->frees++;
+        spin_unlock_irqrestore(&cache->lock, rflags);
+    }
     if (released) *released = requested;
     return 0;
 }
 
+/* Drain every CPU slot and the depot of a cache back into its slabs. */
+static void cache_drain_all(slab_cache_t *cache)
+{
+    slab_cpu_cache_t *cpus = __atomic_load_n(&cache->cpu, __ATOMIC_ACQUIRE);
+    if (cpus)
+        for (uint32_t i = 0; i < cache->cpu_count; i++) cpu_cache_drain(cache, &cpus[i]);
+    (void)depot_drain(cache);
+}
+
+/* Make a cache visible to slab_reclaim(). */
+static void cache_register(slab_cache_t *cache)
+{
+    uint64_t rflags      = spin_lock_irqsave(&cache_registry_lock);
+    cache->registry_next = cache_registry;
+    cache_registry       = cache;
+    spin_unlock_irqrestore(&cache_registry_lock, rflags);
+}
+
+/*
+ * Hide a cache from slab_reclaim() before it is torn down.  A reclaim walk
+ * parked on the cache still needs its registry_next, so wait for it to move on.
+ */
+static void cache_unregister(slab_cache_t *cache)
+{
+    uint64_t rflags = spin_lock_irqsave(&cache_registry_lock);
+    while (cache->registry_refs) {
+        spin_unlock_irqrestore(&cache_registry_lock, rflags);
+        __asm__ volatile("pause");
+        rflags = spin_lock_irqsave(&cache_registry_lock);
+    }
+    for (slab_cache_t **link = &cache_registry; *link; link = &(*link)->registry_next) {
+        if (*link == cache) {
+            *link = cache->registry_next;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&cache_registry_lock, rflags);
+}
+
 /* Find the smallest size class that fits size. */
 static slab_cache_t *cache_for_size(size_t size)
 {
@@ -457,8 +973,8 @@ static int pointer_owner(void *pointer, size_t *owner_index, void **owner)
     size_t page = (address - base) / PAGE_4K_SIZE;
 
     uint64_t rflags = spin_lock_irqsave(&heap.page_lock);
-    uint32_t tag    = heap.pages.pages[page].tag;
-    if (!tag || tag > heap.page_count) {
+    uint32_t tag    = page < heap.pages.page_count ? heap.pages.pages[page].tag : 0;
+    if (!tag || tag > heap.pages.page_count) {
         spin_unlock_irqrestore(&heap.page_lock, rflags);
         return -1;
     }
@@ -496,32 +1012,93 @@ static void *large_alloc(size_t alignment, size_t size)
     return (void *)user;
 }
 
-/* Initialize the heap: buddy allocator plus size-class caches. */
-int heap_init(uint8_t *address, size_t size)
+/* Initialize the heap: metadata window, boot chunks, buddy allocator and size-class caches. */
+int heap_init(uint8_t *address, size_t size, size_t initial)
 {
-    if (!address || ((uintptr_t)address & (PAGE_4K_SIZE - 1)) || size < PAGE_4K_SIZE * 16) return -1;
-    size &= ~(PAGE_4K_SIZE - 1);
-    size_t page_count = size / PAGE_4K_SIZE;
-    if (page_count > 0x7fffffffU) return -1;
-    size_t metadata_bytes = page_count * sizeof(buddy_page_t);
-    size_t metadata_pages = (metadata_bytes + PAGE_4K_SIZE - 1) / PAGE_4K_SIZE;
-    if (metadata_pages >= page_count) return -1;
+    if (!address || ((uintptr_t)address & (HEAP_CHUNK_SIZE - 1)) || size < HEAP_CHUNK_SIZE * 2) return -1;
+
+    /* Size the metadata for the whole window; the data chunks follow it. */
+    size_t total_chunks    = size / HEAP_CHUNK_SIZE;
+    size_t bitmap_bytes    = (total_chunks + 7) / 8;
+    size_t pages_offset    = align_up_size(bitmap_bytes, SLAB_CACHELINE);
+    size_t metadata_bytes  = pages_offset + total_chunks * HEAP_CHUNK_PAGES * sizeof(buddy_page_t);
+    size_t metadata_chunks = (metadata_bytes + HEAP_CHUNK_SIZE - 1) / HEAP_CHUNK_SIZE;
+    if (metadata_chunks >= total_chunks) return -1;
+    size_t chunk_count = total_chunks - metadata_chunks;
+    if (chunk_count * HEAP_CHUNK_PAGES > 0x7fffffffU) chunk_count = 0x7fffffffU / HEAP_CHUNK_PAGES;
+    size_t initial_chunks = (initial + HEAP_CHUNK_SIZE - 1) / HEAP_CHUNK_SIZE;
+    if (!initial_chunks) initial_chunks = 1;
+    if (initial_chunks > chunk_count) initial_chunks = chunk_count;
 
     memset(&heap, 0, sizeof(heap));
-    heap.base           = address;
-    heap.size           = size;
-    heap.page_count     = page_count;
-    heap.metadata_pages = metadata_pages;
-    heap.cookie         = (uintptr_t)address ^ size ^ 0x9e3779b97f4a7c15ULL;
-    if (buddy_init(&heap.pages, (buddy_page_t *)address, page_count, heap_max_order(page_count))) return -1;
-    if (buddy_add_range(&heap.pages, metadata_pages, page_count - metadata_pages)) return -1;
-
-    for (size_t i = 0; i < SIZE_CACHE_COUNT; i++)
+    heap.metadata     = address;
+    heap.pages_offset = pages_offset;
+    heap.base         = address + metadata_chunks * HEAP_CHUNK_SIZE;
+    heap.size         = chunk_count * HEAP_CHUNK_SIZE;
+    heap.chunk_count  = chunk_count;
+    heap.cookie       = (uintptr_t)address ^ size ^ 0x9e3779b97f4a7c15ULL;
+
+    uintptr_t window = (uintptr_t)address;
+    if (heap_share_top_level(window, (uintptr_t)heap.base + heap.size)) return -1;
+    if (heap_map_metadata(pages_offset + initial_chunks * HEAP_CHUNK_PAGES * sizeof(buddy_page_t))) return -1;
+    bitmap_init(&heap.populated, heap.metadata, bitmap_bytes);
+    if (buddy_init(&heap.pages, (buddy_page_t *)(heap.metadata + pages_offset), initial_chunks * HEAP_CHUNK_PAGES, heap_max_order(chunk_count * HEAP_CHUNK_PAGES))) return -1;
+    if (heap_populate(0, initial_chunks)) return -1;
+    heap.min_chunks = initial_chunks;
+
+    memset(heap_cpu_stats, 0, sizeof(heap_cpu_stats));
+    cache_registry = NULL;
+    if (cache_init(&magazine_cache, "slab_magazine", sizeof(slab_magazine_t), HEAP_MIN_ALIGNMENT, NULL, NULL, 0)) return -1;
+    magazine_cache.no_magazines = 1;
+    cache_register(&magazine_cache);
+    for (size_t i = 0; i < SIZE_CACHE_COUNT; i++) {
         if (cache_init(&size_caches[i], "kmalloc", size_classes[i], HEAP_MIN_ALIGNMENT, NULL, NULL, 0)) return -1;
+        cache_register(&size_caches[i]);
+    }
     __atomic_store_n(&heap.online, 1, __ATOMIC_RELEASE);
     return 0;
 }
 
+/* Return fully free chunks beyond the boot population to the frame allocator. */
+size_t heap_trim(void)
+{
+    if (!__atomic_load_n(&heap.online, __ATOMIC_ACQUIRE)) return 0;
+
+    size_t   released = 0;
+    uint64_t rflags   = spin_lock_irqsave(&heap.grow_lock);
+    size_t   chunk    = heap.pages.page_count / HEAP_CHUNK_PAGES;
+    while (chunk > heap.min_chunks) {
+        size_t   batch[HEAP_TRIM_BATCH];
+        uint64_t frames[HEAP_TRIM_BATCH];
+        size_t   count = 0;
+
+        /* Claim from the top down, keeping a little slack so the next burst does not regrow. */
+        uint64_t page_flags = spin_lock_irqsave(&heap.page_lock);
+        while (chunk > heap.min_chunks && count < HEAP_TRIM_BATCH) {
+            chunk--;
+            if (heap.pages.free_pages < (HEAP_TRIM_SLACK + 1) * HEAP_CHUNK_PAGES) {
+                chunk = heap.min_chunks;
+                break;
+            }
+            if (bitmap_get(&heap.populated, chunk) && !buddy_claim(&heap.pages, chunk * HEAP_CHUNK_PAGES, HEAP_CHUNK_ORDER)) batch[count++] = chunk;
+        }
+        spin_unlock_irqrestore(&heap.page_lock, page_flags);
+        if (!count) break;
+
+        /* Kernel heap leaves are global: every CPU must drop them before the frames are reused. */
+        for (size_t i = 0; i < count; i++) frames[i] = page_unmap_2M(get_kernel_pagedir(), chunk_address(batch[i]));
+        flush_tlb_all();
+        for (size_t i = 0; i < count; i++) {
+            if (frames[i]) free_frames_2M(frames[i]);
+            bitmap_set(&heap.populated, batch[i], 0);
+        }
+        heap.resident_chunks -= count;
+        released += count;
+    }
+    spin_unlock_irqrestore(&heap.grow_lock, rflags);
+    return released * HEAP_CHUNK_PAGES;
+}
+
 /* Install the handler invoked when a heap error is detected. */
 void heap_onerror(error_handler handler)
 {
@@ -532,17 +1109,18 @@ void heap_onerror(error_handler handler)
 void *malloc(size_t size)
 {
     if (!size || !__atomic_load_n(&heap.online, __ATOMIC_ACQUIRE)) return NULL;
-    stat_add(&heap.allocation_calls, 1);
+    heap_cpu_stats_t *stats = heap_stats_local();
+    stat_add(&stats->allocation_calls, 1);
 
     slab_cache_t *cache  = cache_for_size(size);
-    void         *result = cache ? cache_alloc_requested(cache, size) : large_alloc(HEAP_MIN_ALIGNMENT, size);
+    void         *result = cache ? cache_alloc(cache, size) : large_alloc(HEAP_MIN_ALIGNMENT, size);
     if (!result) {
-        stat_add(&heap.failed_allocations, 1);
-        if (size > size_classes[SIZE_CACHE_COUNT - 1]) plogk("alloc: Failed to allocate %llu bytes (heap limit reached)\n", (uint64_t)size);
+        stat_add(&stats->failed_allocations, 1);
+        if (size > size_classes[SIZE_CACHE_COUNT - 1]) plogk("alloc: Failed to allocate %llu bytes (heap cannot grow)\n", (uint64_t)size);
         return NULL;
     }
-    stat_add(&heap.live_allocations, 1);
-    stat_add(&heap.allocated_bytes, size);
+    stat_add(&stats->live_allocations, 1);
+    stat_add(&stats->allocated_bytes, size);
     return result;
 }
 
@@ -552,15 +1130,16 @@ void *aligned_alloc(size_t alignment, size_t size)
     if (!size || !valid_alignment(alignment) || alignment < sizeof(void *) || !__atomic_load_n(&heap.online, __ATOMIC_ACQUIRE)) return NULL;
     if (alignment <= HEAP_MIN_ALIGNMENT) return malloc(size);
 
-    stat_add(&heap.allocation_calls, 1);
+    heap_cpu_stats_t *stats = heap_stats_local();
+    stat_add(&stats->allocation_calls, 1);
     void *result = large_alloc(alignment, size);
     if (!result) {
-        stat_add(&heap.failed_allocations, 1);
-        if (size > size_classes[SIZE_CACHE_COUNT - 1]) plogk("alloc: Failed to allocate %llu bytes aligned to %llu (heap limit reached)\n", (uint64_t)size, (uint64_t)alignment);
+        stat_add(&stats->failed_allocations, 1);
+        if (size > size_classes[SIZE_CACHE_COUNT - 1]) plogk("alloc: Failed to allocate %llu bytes aligned to %llu (heap cannot grow)\n", (uint64_t)size, (uint64_t)alignment);
         return NULL;
     }
-    stat_add(&heap.live_allocations, 1);
-    stat_add(&heap.allocated_bytes, size);
+    stat_add(&stats->live_allocations, 1);
+    stat_add(&stats->allocated_bytes, size);
     return result;
 }
 
@@ -625,7 +1204,7 @@ void free(void *pointer)
     size_t         released = 0;
     slab_header_t *slab     = owner;
     if (slab->magic == SLAB_MAGIC) {
-        int result = cache_free_object(NULL, slab, pointer, &released);
+        int result = cache_free(NULL, slab, pointer, &released);
         if (result) {
             plogk("alloc: Free of 0x%016llx rejected (slab integrity check failed, err=%d)\n", (uint64_t)(uintptr_t)pointer, result);
             report_error(result == -2 ? layout_error : invalid_free, pointer);
@@ -649,9 +1228,10 @@ void free(void *pointer)
         }
     }
 
-    stat_sub(&heap.live_allocations, 1);
-    stat_sub(&heap.allocated_bytes, released);
-    stat_add(&heap.free_calls, 1);
+    heap_cpu_stats_t *stats = heap_stats_local();
+    stat_sub(&stats->live_allocations, 1);
+    stat_sub(&stats->allocated_bytes, released);
+    stat_add(&stats->free_calls, 1);
 }
 
 /* Resize in place when capacity allows, otherwise move and copy. */
@@ -682,9 +1262,9 @@ void *realloc(void *pointer, size_t new_size)
             ((large_header_t *)owner)->requested = new_size;
         }
         if (new_size > old_size)
-            stat_add(&heap.allocated_bytes, new_size - old_size);
+            stat_add(&heap_stats_local()->allocated_bytes, new_size - old_size);
         else
-            stat_sub(&heap.allocated_bytes, old_size - new_size);
+            stat_sub(&heap_stats_local()->allocated_bytes, old_size - new_size);
         return pointer;
     }
 
@@ -705,13 +1285,14 @@ slab_cache_t *slab_cache_create(const char *name, size_t object_size, size_t ali
         free(cache);
         return NULL;
     }
+    cache_register(cache);
     return cache;
 }
 
 /* Allocate one object from a slab cache. */
 void *slab_cache_alloc(slab_cache_t *cache)
 {
-    return cache_alloc_requested(cache, cache ? cache->object_size : 0);
+    return cache_alloc(cache, cache ? cache->object_size : 0);
 }
 
 /* Return an object to its originating slab cache. */
@@ -722,13 +1303,14 @@ int slab_cache_free(slab_cache_t *cache, void *object)
     void  *owner;
     if (pointer_owner(object, &owner_index, &owner)) return -1;
     (void)owner_index;
-    return cache_free_object(cache, (slab_header_t *)owner, object, NULL);
+    return cache_free(cache, (slab_header_t *)owner, object, NULL);
 }
 
-/* Return all empty slabs to the buddy; reports the pages released. */
+/* Drain the depot, then return all empty slabs to the buddy; reports the pages released. */
 size_t slab_cache_shrink(slab_cache_t *cache)
 {
     if (!cache) return 0;
+    (void)depot_drain(cache);
     uint64_t rflags = spin_lock_irqsave(&cache->lock);
     size_t   pages  = 0;
     while (cache->empty) {
@@ -744,33 +1326,79 @@ size_t slab_cache_shrink(slab_cache_t *cache)
 int slab_cache_destroy(slab_cache_t *cache)
 {
     if (!cache || !cache->dynamic) return -1;
+    cache_unregister(cache);
+    cache_drain_all(cache);
     uint64_t rflags = spin_lock_irqsave(&cache->lock);
     if (cache->objects) {
         spin_unlock_irqrestore(&cache->lock, rflags);
+        cache_register(cache);
         return -1;
     }
     cache->destroying = 1;
     while (cache->empty) slab_release_locked(cache, cache->empty);
     spin_unlock_irqrestore(&cache->lock, rflags);
+    if (cache->cpu) free(cache->cpu);
     free(cache);
     return 0;
 }
 
+/*
+ * Memory-pressure hook: drain every magazine and return empty slabs to the buddy.
+ * The registry lock is only held to step between caches; each cache is pinned
+ * while it is drained and shrunk so interrupts stay enabled for the work itself.
+ */
+size_t slab_reclaim(void)
+{
+    size_t        pages  = 0;
+    uint64_t      rflags = spin_lock_irqsave(&cache_registry_lock);
+    slab_cache_t *cache  = cache_registry;
+    if (cache) cache->registry_refs++;
+    spin_unlock_irqrestore(&cache_registry_lock, rflags);
+
+    while (cache) {
+        if (cache != &magazine_cache) {
+            cache_drain_all(cache);
+            pages += slab_cache_shrink(cache);
+        }
+        rflags             = spin_lock_irqsave(&cache_registry_lock);
+        slab_cache_t *next = cache->registry_next;
+        if (next) next->registry_refs++;
+        cache->registry_refs--;
+        spin_unlock_irqrestore(&cache_registry_lock, rflags);
+        cache = next;
+    }
+    pages += slab_cache_shrink(&magazine_cache);
+    return pages;
+}
+
 /* Snapshot the accounting counters of a slab cache. */
 void slab_cache_get_stats(slab_cache_t *cache, slab_cache_stats_t *stats)
 {
     if (!cache || !stats) return;
+    size_t            allocations = 0, frees = 0;
+    slab_cpu_cache_t *cpus        = __atomic_load_n(&cache->cpu, __ATOMIC_ACQUIRE);
+    if (cpus) {
+        for (uint32_t i = 0; i < cache->cpu_count; i++) {
+            allocations += __atomic_load_n(&cpus[i].allocations, __ATOMIC_RELAXED);
+            frees += __atomic_load_n(&cpus[i].frees, __ATOMIC_RELAXED);
+        }
+    }
+
     uint64_t rflags      = spin_lock_irqsave(&cache->lock);
     stats->object_size   = cache->object_size;
     stats->alignment     = cache->alignment;
-    stats->objects       = cache->objects;
     stats->slabs         = cache->slab_count;
     stats->partial_slabs = cache->partial_count;
     stats->full_slabs    = cache->full_count;
     stats->empty_slabs   = cache->empty_count;
-    stats->allocations   = cache->allocations;
-    stats->frees         = cache->frees;
+    stats->allocations   = cache->allocations + allocations;
+    stats->frees         = cache->frees + frees;
+    size_t slab_objects  = cache->objects;
     spin_unlock_irqrestore(&cache->lock, rflags);
+
+    /* Objects parked in magazines are in use from the slab's view but free to callers. */
+    stats->objects          = stats->allocations - stats->frees;
+    stats->magazine_objects = slab_objects > stats->objects ? slab_objects - stats->objects : 0;
 }
 
 /* Snapshot the global heap usage counters. */
@@ -778,15 +1406,25 @@ void heap_get_stats(heap_stats_t *stats)
 {
     if (!stats) return;
     uint64_t rflags        = spin_lock_irqsave(&heap.page_lock);
-    stats->arena_bytes     = heap.size;
-    stats->metadata_bytes  = heap.metadata_pages * PAGE_4K_SIZE;
+    stats->window_bytes    = heap.size;
+    stats->arena_bytes     = __atomic_load_n(&heap.resident_chunks, __ATOMIC_RELAXED) * HEAP_CHUNK_SIZE;
+    stats->metadata_bytes  = __atomic_load_n(&heap.metadata_mapped, __ATOMIC_RELAXED);
     stats->free_page_bytes = heap.pages.free_pages * PAGE_4K_SIZE;
     spin_unlock_irqrestore(&heap.page_lock, rflags);
-    stats->live_allocations   = __atomic_load_n(&heap.live_allocations, __ATOMIC_RELAXED);
-    stats->allocated_bytes    = __atomic_load_n(&heap.allocated_bytes, __ATOMIC_RELAXED);
-    stats->allocation_calls   = __atomic_load_n(&heap.allocation_calls, __ATOMIC_RELAXED);
-    stats->free_calls         = __atomic_load_n(&heap.free_calls, __ATOMIC_RELAXED);
-    stats->failed_allocations = __atomic_load_n(&heap.failed_allocations, __ATOMIC_RELAXED);
+
+    stats->live_allocations   = 0;
+    stats->allocated_bytes    = 0;
+    stats->allocation_calls   = 0;
+    stats->free_calls         = 0;
+    stats->failed_allocations = 0;
+    for (size_t i = 0; i <= SLAB_PCP_MAX_CPUS; i++) {
+        const heap_cpu_stats_t *cpu = &heap_cpu_stats[i];
+        stats->live_allocations += __atomic_load_n(&cpu->live_allocations, __ATOMIC_RELAXED);
+        stats->allocated_bytes += __atomic_load_n(&cpu->allocated_bytes, __ATOMIC_RELAXED);
+        stats->allocation_calls += __atomic_load_n(&cpu->allocation_calls, __ATOMIC_RELAXED);
+        stats->free_calls += __atomic_load_n(&cpu->free_calls, __ATOMIC_RELAXED);
+        stats->failed_allocations += __atomic_load_n(&cpu->failed_allocations, __ATOMIC_RELAXED);
+    }
 }
 
 /* Verify the invariants of a single slab list. */
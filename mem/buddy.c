@@ -49,12 +49,12 @@ int buddy_init(buddy_allocator_t *allocator, buddy_page_t *metadata, size_t page
         allocator->free_count[order] = 0;
     }
     for (size_t i = 0; i < page_count; i++) {
-        metadata[i].next     = BUDDY_INDEX_NONE;
-        metadata[i].prev     = BUDDY_INDEX_NONE;
-        metadata[i].tag      = 0;
-        metadata[i].order    = 0;
-        metadata[i].state    = BUDDY_PAGE_RESERVED;
-        metadata[i].reserved = 0;
+        metadata[i].next  = BUDDY_INDEX_NONE;
+        metadata[i].prev  = BUDDY_INDEX_NONE;
+        metadata[i].tag   = 0;
+        metadata[i].order = 0;
+        metadata[i].state = BUDDY_PAGE_RESERVED;
+        metadata[i].flags = 0;
     }
     return 0;
 }
@@ -132,6 +132,50 @@ int buddy_add_range(buddy_allocator_t *allocator, size_t start, size_t count)
     return 0;
 }
 
+/* Extend the allocator over more metadata entries, all initially reserved. */
+int buddy_extend(buddy_allocator_t *allocator, size_t page_count)
+{
+    if (!allocator || page_count < allocator->page_count || page_count > 0x7fffffffU) return -1;
+
+    for (size_t i = allocator->page_count; i < page_count; i++) {
+        allocator->pages[i].next  = BUDDY_INDEX_NONE;
+        allocator->pages[i].prev  = BUDDY_INDEX_NONE;
+        allocator->pages[i].tag   = 0;
+        allocator->pages[i].order = 0;
+        allocator->pages[i].state = BUDDY_PAGE_RESERVED;
+        allocator->pages[i].flags = 0;
+    }
+    allocator->page_count = page_count;
+    return 0;
+}
+
+/* Remove a free block covering [index, index + 2^order), splitting off the remainder. */
+int buddy_claim(buddy_allocator_t *allocator, size_t index, unsigned order)
+{
+    if (!allocator || order > allocator->max_order || index >= allocator->page_count) return -1;
+    size_t units = order_units(order);
+    if ((index & (units - 1)) || units > allocator->page_count - index) return -1;
+
+    for (unsigned found = order; found <= allocator->max_order; found++) {
+        size_t head = index & ~(order_units(found) - 1);
+        if (allocator->pages[head].state != BUDDY_PAGE_FREE_HEAD || allocator->pages[head].order != found) continue;
+
+        list_remove(allocator, head, found);
+        while (found > order) {
+            found--;
+            size_t half = order_units(found);
+            if (index >= head + half) {
+                list_add(allocator, head, found);
+                head += half;
+            } else {
+                list_add(allocator, head + half, found);
+            }
+        }
+        return 0;
+    }
+    return -1;
+}
+
 /* Allocate a block of the given order, splitting a larger one if needed. */
 size_t buddy_alloc(buddy_allocator_t *allocator, unsigned order)
 {
@@ -11,24 +11,36 @@
 #include <arch/common.h>
 #include <arch/smp.h>
 #include <boot/limine.h>
+#include <kernel/errno.h>
 #include <kernel/printk.h>
+#include <kernel/timer/timer.h>
 #include <kernel/uinxed.h>
 #include <libs/std/stdbool.h>
 #include <libs/std/stdlib.h>
 #include <libs/std/string.h>
+#include <mem/alloc.h>
 #include <mem/buddy.h>
 #include <mem/frame.h>
 #include <mem/hhdm.h>
 #include <mem/page.h>
 #include <mem/pagecache.h>
+#include <mem/rmap.h>
+#include <mem/slab.h>
 #include <mem/swap.h>
 #include <process/sched.h>
 
-log_buffer_t             frame_log;
-frame_allocator_t        frame_allocator;
-uint64_t                 memory_size = 0;
-static volatile int      frame_reclaim_active;
-static volatile uint32_t frame_reclaim_backoff;
+log_buffer_t                 frame_log;
+frame_allocator_t            frame_allocator;
+uint64_t                     memory_size = 0;
+static volatile int          frame_reclaim_active;
+static volatile uint32_t     frame_reclaim_backoff;
+static frame_reclaim_stats_t frame_reclaim_stats;
+
+/* kswapd: one daemon for the single memory node */
+static wait_queue_t  frame_kswapd_wait;
+static spinlock_t    frame_kswapd_lock;
+static bool          frame_kswapd_pending;
+static volatile bool frame_kswapd_running;
 
 /*
  * Linux serves order-0 allocations from per-CPU pagesets before touching the
@@ -39,6 +51,8 @@ static volatile uint32_t frame_reclaim_backoff;
 #define FRAME_PCP_HIGH      64U
 #define FRAME_PCP_BATCH     16U
 #define FRAME_RECLAIM_BATCH 16U
+#define FRAME_KSWAPD_BATCH  32U
+#define FRAME_KSWAPD_PERIOD TIMER_HZ // idle watermark recheck, in ticks
 
 typedef struct {
         spinlock_t lock;
@@ -159,11 +173,12 @@ static size_t frame_pcp_refill(void)
 }
 
 /* Serialize reclaim so swap I/O cannot recursively enter reclaim allocation. */
-static int frame_try_reclaim(size_t target)
+static int frame_try_reclaim(size_t target, size_t *scanned)
 {
     int expected = 0;
+    *scanned     = 0;
     if (!__atomic_compare_exchange_n(&frame_reclaim_active, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return 0;
-    int reclaimed = swap_reclaim(target);
+    int reclaimed = swap_reclaim(target, scanned);
     __atomic_store_n(&frame_reclaim_active, 0, __ATOMIC_RELEASE);
     return reclaimed;
 }
@@ -171,33 +186,171 @@ static int frame_try_reclaim(size_t target)
 /* Reclaim up to the requested number of free frame pages. */
 int frame_reclaim_pages(size_t target)
 {
-    return target ? frame_try_reclaim(target) : 0;
+    size_t scanned;
+    return target ? frame_try_reclaim(target, &scanned) : 0;
+}
+
+/* Derive the watermarks from usable RAM: min = low / 2, low = 1/32, high = 1/16. */
+void frame_get_watermarks(frame_watermarks_t *watermarks)
+{
+    size_t total    = frame_allocator.origin_frames;
+    watermarks->low = total / 32;
+    if (watermarks->low < 128) watermarks->low = 128;
+    watermarks->min  = watermarks->low / 2;
+    watermarks->high = total / 16;
+    if (watermarks->high < watermarks->low + 64) watermarks->high = watermarks->low + 64;
 }
 
-/* Start reclaim at a low watermark from a VM-safe allocation boundary. */
+/* Snapshot the reclaim counters. */
+void frame_get_reclaim_stats(frame_reclaim_stats_t *stats)
+{
+    stats->scan_kswapd    = __atomic_load_n(&frame_reclaim_stats.scan_kswapd, __ATOMIC_RELAXED);
+    stats->scan_direct    = __atomic_load_n(&frame_reclaim_stats.scan_direct, __ATOMIC_RELAXED);
+    stats->steal_kswapd   = __atomic_load_n(&frame_reclaim_stats.steal_kswapd, __ATOMIC_RELAXED);
+    stats->steal_direct   = __atomic_load_n(&frame_reclaim_stats.steal_direct, __ATOMIC_RELAXED);
+    stats->kswapd_wakeups = __atomic_load_n(&frame_reclaim_stats.kswapd_wakeups, __ATOMIC_RELAXED);
+    stats->alloc_stalls   = __atomic_load_n(&frame_reclaim_stats.alloc_stalls, __ATOMIC_RELAXED);
+}
+
+/* Credit one reclaim pass to kswapd or to direct reclaim. */
+static void frame_reclaim_account(bool kswapd, size_t scanned, size_t reclaimed)
+{
+    __atomic_add_fetch(kswapd ? &frame_reclaim_stats.scan_kswapd : &frame_reclaim_stats.scan_direct, scanned, __ATOMIC_RELAXED);
+    __atomic_add_fetch(kswapd ? &frame_reclaim_stats.steal_kswapd : &frame_reclaim_stats.steal_direct, reclaimed, __ATOMIC_RELAXED);
+}
+
+/*
+ * Clean file-backed cache is cheaper to recover than anonymous memory.
+ * In particular, parallel compilers can otherwise exhaust RAM while the
+ * source/object working set remains reclaimable in the page cache.  This
+ * path is also useful on systems without an active swap area.
+ */
+static size_t frame_shrink_cache(size_t target, bool kswapd)
+{
+    size_t scanned = 0;
+
+    /* Objects parked in slab magazines are the cheapest memory to give back. */
+    (void)slab_reclaim();
+    (void)heap_trim();
+
+    size_t reclaimed = pagecache_reclaim_scan(target, &scanned);
+    frame_reclaim_account(kswapd, scanned, reclaimed);
+    return reclaimed;
+}
+
+/* Page anonymous memory out to swap, if an area has room. */
+static size_t frame_shrink_anon(size_t target, bool kswapd)
+{
+    size_t scanned;
+    if (!swap_has_free_space()) return 0;
+    size_t reclaimed = (size_t)frame_try_reclaim(target, &scanned);
+    frame_reclaim_account(kswapd, scanned, reclaimed);
+    return reclaimed;
+}
+
+/* Reclaim in batches until free memory reaches the high watermark or a pass makes no progress. */
+static void kswapd_balance(void)
+{
+    frame_watermarks_t watermarks;
+    frame_get_watermarks(&watermarks);
+
+    for (;;) {
+        size_t free = __atomic_load_n(&frame_allocator.usable_frames, __ATOMIC_RELAXED);
+        if (free >= watermarks.high || kthread_should_stop()) return;
+
+        size_t target = watermarks.high - free;
+        if (target > FRAME_KSWAPD_BATCH) target = FRAME_KSWAPD_BATCH;
+        size_t reclaimed = frame_shrink_cache(target, true);
+        if (reclaimed < target) reclaimed += frame_shrink_anon(target - reclaimed, true);
+        if (!reclaimed) return;
+    }
+}
+
+/* Background reclaim daemon: sleeps until an allocator crosses the low watermark. */
+static int kswapd_worker(void *arg)
+{
+    (void)arg;
+    __atomic_store_n(&frame_kswapd_running, true, __ATOMIC_RELEASE);
+
+    while (!kthread_should_stop()) {
+        spin_lock(&frame_kswapd_lock);
+        if (!frame_kswapd_pending) {
+            /* Recheck periodically so a missed wakeup cannot leave free memory below low. */
+            wait_queue_prepare(&frame_kswapd_wait);
+            spin_unlock(&frame_kswapd_lock);
+            (void)wait_queue_wait_timed(&frame_kswapd_wait, sched_ticks() + FRAME_KSWAPD_PERIOD);
+
+            frame_watermarks_t watermarks;
+            frame_get_watermarks(&watermarks);
+            spin_lock(&frame_kswapd_lock);
+            if (!frame_kswapd_pending && __atomic_load_n(&frame_allocator.usable_frames, __ATOMIC_RELAXED) > watermarks.low) {
+                spin_unlock(&frame_kswapd_lock);
+                continue;
+            }
+        }
+        frame_kswapd_pending = false;
+        spin_unlock(&frame_kswapd_lock);
+        kswapd_balance();
+    }
+
+    __atomic_store_n(&frame_kswapd_running, false, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Ask kswapd to run one balancing pass. */
+static void kswapd_wake(void)
+{
+    bool wake = false;
+
+    spin_lock(&frame_kswapd_lock);
+    if (!frame_kswapd_pending) {
+        frame_kswapd_pending = true;
+        wake                 = true;
+    }
+    spin_unlock(&frame_kswapd_lock);
+
+    if (wake) {
+        __atomic_add_fetch(&frame_reclaim_stats.kswapd_wakeups, 1, __ATOMIC_RELAXED);
+        (void)wait_queue_wake_one(&frame_kswapd_wait);
+    }
+}
+
+/* Register kswapd before kernel workers start. */
+void kswapd_start_worker(void)
+{
+    wait_queue_init(&frame_kswapd_wait);
+    frame_kswapd_lock    = (spinlock_t) {0};
+    frame_kswapd_pending = false;
+    if (kernel_worker_register("kswapd0", kswapd_worker, NULL, NULL) != EOK) plogk("frame: Unable to register kswapd.\n");
+}
+
+/*
+ * Called at VM-safe points.  Below the low watermark kswapd is woken; the
+ * caller only reclaims itself once free memory falls under min (or cannot
+ * cover the request), or before kswapd exists.
+ */
 void frame_reclaim_if_needed(size_t requested)
 {
-    size_t total = frame_allocator.origin_frames;
-    size_t free  = __atomic_load_n(&frame_allocator.usable_frames, __ATOMIC_RELAXED);
-    size_t low   = total / 32;
-    size_t high  = total / 16;
-    if (low < 128) low = 128;
-    if (high < low + 64) high = low + 64;
-    if (free > low) return;
+    frame_watermarks_t watermarks;
+    frame_get_watermarks(&watermarks);
+    size_t free = __atomic_load_n(&frame_allocator.usable_frames, __ATOMIC_RELAXED);
+    if (free > watermarks.low) return;
+
+    bool kswapd = __atomic_load_n(&frame_kswapd_running, __ATOMIC_ACQUIRE);
+    if (kswapd) {
+        kswapd_wake();
+        if (free > watermarks.min && free > requested) return;
+    }
+    __atomic_add_fetch(&frame_reclaim_stats.alloc_stalls, 1, __ATOMIC_RELAXED);
 
-    /*
-     * Clean file-backed cache is cheaper to recover than anonymous memory.
-     * In particular, parallel compilers can otherwise exhaust RAM while the
-     * source/object working set remains reclaimable in the page cache.  This
-     * path is also useful on systems without an active swap area.
-     */
-    size_t cache_target = high > free ? high - free : requested;
+    size_t cache_target = watermarks.high > free ? watermarks.high - free : requested;
     if (cache_target < requested) cache_target = requested;
     if (cache_target > FRAME_RECLAIM_BATCH) cache_target = FRAME_RECLAIM_BATCH;
-    (void)pagecache_reclaim(cache_target);
+    (void)frame_shrink_cache(cache_target, false);
 
-    free = __atomic_load_n(&frame_allocator.usable_frames, __ATOMIC_RELAXED);
-    if (free > low || !swap_has_free_space()) return;
+    size_t floor = kswapd ? watermarks.min : watermarks.low;
+    free         = __atomic_load_n(&frame_allocator.usable_frames, __ATOMIC_RELAXED);
+    if (free > floor) return;
 
     uint32_t backoff = __atomic_load_n(&frame_reclaim_backoff, __ATOMIC_RELAXED);
     bool     urgent  = free <= requested;
@@ -206,10 +359,10 @@ void frame_reclaim_if_needed(size_t requested)
         return;
     }
 
-    size_t target = high > free ? high - free : requested;
+    size_t target = watermarks.high > free ? watermarks.high - free : requested;
     if (target < requested) target = requested;
     if (target > FRAME_RECLAIM_BATCH) target = FRAME_RECLAIM_BATCH;
-    if (frame_try_reclaim(target) == 0)
+    if (frame_shrink_anon(target, false) == 0)
         __atomic_store_n(&frame_reclaim_backoff, 64, __ATOMIC_RELAXED);
     else
         __atomic_store_n(&frame_reclaim_backoff, 0, __ATOMIC_RELAXED);
@@ -419,20 +572,39 @@ int frame_release_range(uint64_t addr, size_t count)
         buddy_page_t *page  = &frame_allocator.buddy.pages[index];
         page->tag--;
         if (!page->tag) {
-            page->reserved = 1; // exactly this release owns the PCP handoff
+            __atomic_or_fetch(&page->flags, FRAME_PAGE_RELEASED, __ATOMIC_RELAXED); // exactly this release owns the PCP handoff
             released++;
         }
     }
     __atomic_add_fetch(&frame_allocator.usable_frames, released, __ATOMIC_RELAXED);
     spin_unlock(&frame_allocator.lock);
 
-    /* Final references stay as order-0 allocated heads while cached. */
-    if (released)
-        for (size_t i = 0; i < count; i++)
-            if (__atomic_exchange_n(&frame_allocator.buddy.pages[frame_index + i].reserved, 0, __ATOMIC_ACQ_REL)) frame_pcp_put(frame_index + i);
+    /*
+     * Final references stay as order-0 allocated heads while cached.  Only
+     * frames flagged anonymous carry a reverse map to forget, so page cache,
+     * slab and page-table frees never touch rmap_lock.
+     */
+    if (released) {
+        for (size_t i = 0; i < count; i++) {
+            buddy_page_t *page  = &frame_allocator.buddy.pages[frame_index + i];
+            uint16_t      flags = __atomic_load_n(&page->flags, __ATOMIC_ACQUIRE);
+            while ((flags & FRAME_PAGE_RELEASED) && !__atomic_compare_exchange_n(&page->flags, &flags, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+            if (!(flags & FRAME_PAGE_RELEASED)) continue;
+            if (flags & FRAME_PAGE_ANON) rmap_frame_freed((frame_index + i) * PAGE_4K_SIZE);
+            frame_pcp_put(frame_index + i);
+        }
+    }
     return 0;
 }
 
+/* Flag a frame whose final release must also drop its reverse-map record. */
+void frame_mark_anon(uint64_t addr)
+{
+    size_t frame_index = addr / PAGE_4K_SIZE;
+    if (!addr || frame_index >= frame_allocator.frame_count) return;
+    __atomic_or_fetch(&frame_allocator.buddy.pages[frame_index].flags, FRAME_PAGE_ANON, __ATOMIC_RELEASE);
+}
+
 /* Return the reference count of a single frame. */
 uint32_t frame_refcount(uint64_t addr)
 {
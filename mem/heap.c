@@ -26,7 +26,7 @@ uint64_t KERNEL_HEAP_SIZE  = 0;
 
 #define KERNEL_HEAP_SEARCH_BASE 0xffffc00000000000ULL
 #ifndef KERNEL_HEAP_MAX_MIB
-#    define KERNEL_HEAP_MAX_MIB 128
+#    define KERNEL_HEAP_MAX_MIB 512
 #endif
 #define KERNEL_HEAP_MAX_SIZE ((uint64_t)(KERNEL_HEAP_MAX_MIB) * 1024ULL * 1024ULL)
 
@@ -41,29 +41,28 @@ void init_heap(void)
     for (uint64_t i = 0; i < memmap_response->entry_count; i++)
         if (memmap_response->entries[i]->type == LIMINE_MEMMAP_USABLE) usable_ram += memmap_response->entries[i]->length;
 
+    /*
+     * Only the boot floor is backed up front; the rest of the window is
+     * populated in 2 MiB chunks on demand and trimmed again under memory
+     * pressure.  The window also covers the buddy metadata (1/256 of the data).
+     */
+    uint64_t low_memory_floor = usable_ram / 4;
+    if (low_memory_floor > 32ULL * 1024 * 1024) low_memory_floor = 32ULL * 1024 * 1024;
+    low_memory_floor = ALIGN_UP(low_memory_floor, PAGE_2M_SIZE);
+
     if (!KERNEL_HEAP_SIZE && !KERNEL_HEAP_START) {
-        /*
-         * This heap is eagerly backed by physical pages and cannot be
-         * reclaimed.  One eighth of RAM stranded too much memory from Xorg,
-         * file cache and GEM buffers, so reserve one sixteenth while retaining
-         * the established 32 MiB floor on normal-memory machines.
-         */
-        KERNEL_HEAP_SIZE          = usable_ram / 16;
-        uint64_t low_memory_floor = usable_ram / 4;
-        if (low_memory_floor > 32ULL * 1024 * 1024) low_memory_floor = 32ULL * 1024 * 1024;
-        if (KERNEL_HEAP_SIZE < low_memory_floor) KERNEL_HEAP_SIZE = low_memory_floor;
-        if (KERNEL_HEAP_SIZE > KERNEL_HEAP_MAX_SIZE) KERNEL_HEAP_SIZE = KERNEL_HEAP_MAX_SIZE;
-        KERNEL_HEAP_SIZE  = ALIGN_UP(KERNEL_HEAP_SIZE, PAGE_4K_SIZE);
+        uint64_t limit = usable_ram;
+        if (limit > KERNEL_HEAP_MAX_SIZE) limit = KERNEL_HEAP_MAX_SIZE;
+        limit             = ALIGN_UP(limit, PAGE_2M_SIZE);
+        KERNEL_HEAP_SIZE  = limit + ALIGN_UP(limit / 128, PAGE_2M_SIZE) + PAGE_2M_SIZE;
         KERNEL_HEAP_START = walk_page_tables_find_free(get_kernel_pagedir(), KERNEL_HEAP_SEARCH_BASE, KERNEL_HEAP_SIZE, PAGE_2M_SIZE);
         KERNEL_HEAP_START = ALIGN_UP(KERNEL_HEAP_START, PAGE_2M_SIZE);
     }
     if (!KERNEL_HEAP_START || !KERNEL_HEAP_SIZE) krn_halt();
 
-    page_map_range_to_random(get_kernel_pagedir(), KERNEL_HEAP_START, KERNEL_HEAP_SIZE, PTE_PRESENT | PTE_WRITEABLE);
-
     pointer_cast_t cast;
     cast.val = KERNEL_HEAP_START;
-    if (heap_init(cast.ptr, KERNEL_HEAP_SIZE)) krn_halt();
+    if (heap_init(cast.ptr, KERNEL_HEAP_SIZE, low_memory_floor)) krn_halt();
 }
 
 /* Allocate an empty memory */
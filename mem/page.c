@@ -23,6 +23,7 @@
 #include <mem/heap.h>
 #include <mem/hhdm.h>
 #include <mem/page.h>
+#include <mem/rmap.h>
 #include <mem/swap.h>
 #include <process/process.h>
 #include <process/sched.h>
@@ -33,6 +34,34 @@ page_directory_t  kernel_page_dir;
 page_directory_t *current_directory = 0;
 static void       page_enable_global_tlb(void);
 
+/*
+ * With CR4.PCIDE every CPU keeps a few recently used address spaces tagged
+ * in its TLB.  A slot remembers the directory's tlb_generation at the time
+ * its translations were known clean; switching back to a directory whose
+ * generation has not moved reloads CR3 with the no-flush bit set.
+ */
+#define PAGE_PCID_SLOTS 6U
+#define CR3_PCID_MASK   0xfffULL
+#define CR3_NOFLUSH     (1ULL << 63)
+#define CR4_PCIDE       (1ULL << 17)
+#define RFLAGS_IF       (1ULL << 9)
+
+typedef struct {
+        uint64_t id;
+        uint64_t generation;
+} page_pcid_slot_t;
+
+typedef struct {
+        page_directory_t *volatile active;
+        page_pcid_slot_t           slots[PAGE_PCID_SLOTS];
+        uint8_t                    victim;
+        uint8_t                    pcid;
+        uint8_t                    invpcid;
+} page_tlb_cpu_t;
+
+static page_tlb_cpu_t page_tlb_cpus[PAGE_TLB_MAX_CPUS];
+static uint64_t       page_tlb_next_id;
+
 /*
  * GCC/Clang interrupt functions save only the registers selected by their
  * optimiser.  Their slots therefore cannot be addressed by fixed offsets
@@ -158,7 +187,7 @@ void page_fault_handle_frame(page_fault_frame_t *frame)
         process_t *proc = fault_task->process;
         if (!fault_task->uaccess_fault_nofault && proc && proc->user_page_dir) {
             if (present && rw && page_resolve_write_fault(proc, faulting_address) == 0) return;
-            if (!present && swap_fault(proc->user_page_dir, faulting_address) == 0) return;
+            if (!present && swap_fault(proc, faulting_address) == 0) return;
             if (!present && process_demand_fault(proc, faulting_address, rw, 0) == 0) return;
         }
         frame->rax = (uint64_t)(int64_t)-EFAULT;
@@ -170,7 +199,7 @@ void page_fault_handle_frame(page_fault_frame_t *frame)
         process_t *proc = process_current();
         if (proc) {
             if (present && rw && !reserved && proc->user_page_dir && page_resolve_write_fault(proc, faulting_address) == 0) return;
-            if (!present && !reserved && proc->user_page_dir && swap_fault(proc->user_page_dir, faulting_address) == 0) return;
+            if (!present && !reserved && proc->user_page_dir && swap_fault(proc, faulting_address) == 0) return;
             if (!present && !reserved && proc->user_page_dir && process_demand_fault(proc, faulting_address, rw, id) == 0) return;
 
             siginfo_t info = {0};
@@ -470,7 +499,7 @@ int page_clone_user_cow(page_directory_t *child, page_directory_t *parent)
         if ((value & PTE_PRESENT) && !(value & PTE_HUGE)) mark_parent_table_cow(phys_to_virt(value & PAGE_4K_MASK), 3);
     }
 
-    flush_tlb_all();
+    flush_tlb_mm_range(parent, 0, PAGE_USER_SPACE_END);
     spin_unlock(&child->lock);
     spin_unlock(&parent->lock);
     return 0;
@@ -614,7 +643,7 @@ int page_resolve_write_fault(process_t *proc, uintptr_t addr)
             flush_tlb(leaf.base);
             spin_unlock(&directory->lock);
             spin_unlock(&proc->mmap_lock);
-            flush_tlb_all();
+            flush_tlb_mm_range(directory, leaf.base, leaf.base + leaf.size);
             return 0;
         }
         if (frame_retain_range(old_frame, leaf.frame_count)) {
@@ -655,10 +684,11 @@ int page_resolve_write_fault(process_t *proc, uintptr_t addr)
             flush_tlb(leaf.base);
             spin_unlock(&directory->lock);
             spin_unlock(&proc->mmap_lock);
-            flush_tlb_all();
+            flush_tlb_mm_range(directory, leaf.base, leaf.base + leaf.size);
             /* Drop both the replaced mapping and the temporary copy retain. */
             (void)frame_release_range(old_frame, leaf.frame_count);
             (void)frame_release_range(old_frame, leaf.frame_count);
+            if (leaf.size == PAGE_4K_SIZE) rmap_add_anon(new_frame, proc, leaf.base);
             return 0;
         }
 
@@ -752,6 +782,7 @@ page_directory_t *clone_directory(page_directory_t *src)
     new_directory->table       = (page_table_t *)phys_to_virt(frame);
     new_directory->lock.lock   = 0;
     new_directory->lock.rflags = 0;
+    page_directory_tlb_init(new_directory);
     page_table_clear(new_directory->table);
     for (int i = 256; i < 512; i++) new_directory->table->entries[i] = src->table->entries[i];
 
@@ -834,6 +865,9 @@ static int page_map_to_status(page_directory_t *directory, uint64_t addr, uint64
     }
     l1_table->entries[l1_index].value = (frame & PAGE_4K_MASK) | flags;
     flush_tlb(addr);
+
+    /* Rewriting a live leaf must not survive in another CPU's idle PCID. */
+    if (old_value & PTE_PRESENT) __atomic_add_fetch(&directory->tlb_generation, 1, __ATOMIC_SEQ_CST);
     spin_unlock(&directory->lock);
     return 0;
 rollback:
@@ -966,6 +1000,17 @@ not_mapped:
 /* Unmap addr and release its backing frame (splitting huge pages as needed). */
 int page_unmap_release(page_directory_t *directory, uint64_t addr)
 {
+    tlb_batch_t batch;
+    tlb_batch_init(&batch, directory);
+    int result = page_unmap_release_batch(&batch, addr);
+    tlb_batch_finish(&batch);
+    return result;
+}
+
+/* Unmap a user leaf, deferring the shootdown and frame release to the batch. */
+int page_unmap_release_batch(tlb_batch_t *batch, uint64_t addr)
+{
+    page_directory_t *directory = batch->directory;
     if (!directory || !directory->table || ((addr >> 39) & 0x1ff) >= 256) return -1;
 retry_swap:
     spin_lock(&directory->lock);
@@ -1043,9 +1088,8 @@ retry_swap:
     __atomic_store_n(&leaf.entry->value, 0, __ATOMIC_RELEASE);
     flush_tlb(leaf.base);
     spin_unlock(&directory->lock);
-    flush_tlb_all();
-    int result = frame_release_range(leaf.value & leaf.mask, leaf.frame_count);
-    return result;
+    tlb_batch_add(batch, leaf.base, leaf.base + leaf.size, leaf.value & leaf.mask, leaf.frame_count);
+    return 0;
 }
 
 /* Maps a virtual address to a physical frame using 2MB huge pages */
@@ -1071,6 +1115,35 @@ out:
     spin_unlock(&directory->lock);
 }
 
+/* Unmap a 2MB huge page and return its physical frame, or zero if unmapped */
+uint64_t page_unmap_2M(page_directory_t *directory, uint64_t addr)
+{
+    if (!directory || !directory->table) return 0;
+    spin_lock(&directory->lock);
+
+    uint64_t l4_index = (addr >> 39) & 0x1ff;
+    uint64_t l3_index = (addr >> 30) & 0x1ff;
+    uint64_t l2_index = (addr >> 21) & 0x1ff;
+
+    page_table_t *l4  = directory->table;
+    uint64_t      l4e = l4->entries[l4_index].value;
+    if (!(l4e & PTE_PRESENT) || (l4e & PTE_HUGE)) goto not_mapped;
+    page_table_t *l3  = phys_to_virt(l4e & PAGE_4K_MASK);
+    uint64_t      l3e = l3->entries[l3_index].value;
+    if (!(l3e & PTE_PRESENT) || (l3e & PTE_HUGE)) goto not_mapped;
+    page_table_t *l2  = phys_to_virt(l3e & PAGE_4K_MASK);
+    uint64_t      l2e = l2->entries[l2_index].value;
+    if (!(l2e & PTE_PRESENT) || !(l2e & PTE_HUGE)) goto not_mapped;
+
+    l2->entries[l2_index].value = 0;
+    flush_tlb(addr);
+    spin_unlock(&directory->lock);
+    return l2e & PAGE_2M_MASK;
+not_mapped:
+    spin_unlock(&directory->lock);
+    return 0;
+}
+
 /* Maps a virtual address to a physical frame using 1GB huge pages */
 void page_map_to_1G(page_directory_t *directory, uint64_t addr, uint64_t frame, uint64_t flags)
 {
@@ -1091,12 +1164,162 @@ out:
     spin_unlock(&directory->lock);
 }
 
+/* Give a new directory its TLB tag and an empty CPU mask */
+void page_directory_tlb_init(page_directory_t *directory)
+{
+    directory->tlb_id         = __atomic_add_fetch(&page_tlb_next_id, 1, __ATOMIC_RELAXED);
+    directory->tlb_generation = 0;
+    for (size_t i = 0; i < PAGE_TLB_MASK_SIZE; i++) directory->cpu_mask[i] = 0;
+}
+
+/* Logical CPU for TLB bookkeeping; before smp_init() only the BSP (CPU 0) runs. */
+static uint32_t page_tlb_current_cpu(void)
+{
+    return get_cpu_count() ? get_current_cpu_id() : 0;
+}
+
+/* Per-CPU TLB bookkeeping, or NULL for CPUs beyond the tracked range */
+static page_tlb_cpu_t *page_tlb_cpu(uint32_t cpu)
+{
+    return cpu < PAGE_TLB_MAX_CPUS ? &page_tlb_cpus[cpu] : NULL;
+}
+
+/* Load CR3 for root with the given PCID and flush policy */
+static inline void page_load_cr3(uint64_t root, uint64_t pcid, int noflush)
+{
+    uint64_t cr3 = root | pcid | (noflush ? CR3_NOFLUSH : 0);
+    __asm__ volatile("mov %0, %%cr3" ::"r"(cr3) : "memory");
+}
+
+/* Pick the PCID slot for a directory, reporting whether its cached translations are reusable */
+static size_t page_pcid_slot(page_tlb_cpu_t *state, uint64_t id, int *hit)
+{
+    for (size_t i = 0; i < PAGE_PCID_SLOTS; i++) {
+        if (state->slots[i].id == id) {
+            *hit = 1;
+            return i;
+        }
+    }
+    size_t slot           = state->victim;
+    state->victim         = (uint8_t)((slot + 1) % PAGE_PCID_SLOTS);
+    state->slots[slot].id = id;
+    *hit                  = 0;
+    return slot;
+}
+
 /* Switch the page directory of the current process */
 void switch_page_directory(page_directory_t *dir)
 {
-    current_directory            = dir;
-    page_table_t *physical_table = virt_to_phys((uint64_t)dir->table);
-    __asm__ volatile("mov %0, %%cr3" ::"r"(physical_table));
+    uint64_t rflags = get_rflags();
+    disable_intr();
+    current_directory = dir;
+
+    uint64_t        root  = (uint64_t)(uintptr_t)virt_to_phys((uint64_t)dir->table);
+    uint32_t        cpu   = page_tlb_current_cpu();
+    page_tlb_cpu_t *state = page_tlb_cpu(cpu);
+    if (state) __atomic_store_n(&state->active, dir, __ATOMIC_RELEASE);
+
+    if (!state || !dir->tlb_id) {
+        page_load_cr3(root, 0, 0);
+    } else {
+        /*
+         * Join the mask before sampling the generation: a concurrent
+         * flush_tlb_mm_range() either sees this CPU in the mask and sends a
+         * shootdown, or bumped the generation early enough for us to see it.
+         */
+        __atomic_or_fetch(&dir->cpu_mask[cpu / PAGE_TLB_MASK_BITS], 1ULL << (cpu % PAGE_TLB_MASK_BITS), __ATOMIC_SEQ_CST);
+        if (!state->pcid) {
+            page_load_cr3(root, 0, 0);
+        } else {
+            int      hit;
+            size_t   slot       = page_pcid_slot(state, dir->tlb_id, &hit);
+            uint64_t generation = __atomic_load_n(&dir->tlb_generation, __ATOMIC_SEQ_CST);
+            page_load_cr3(root, slot + 1, hit && state->slots[slot].generation == generation);
+
+            /* A shootdown that landed before CR3 was loaded invalidated the old PCID: flush this one. */
+            for (;;) {
+                uint64_t now = __atomic_load_n(&dir->tlb_generation, __ATOMIC_SEQ_CST);
+                if (now == generation) break;
+                generation = now;
+                page_load_cr3(root, slot + 1, 0);
+            }
+            state->slots[slot].generation = generation;
+        }
+    }
+    if (rflags & RFLAGS_IF) enable_intr();
+}
+
+/* Flush a range of directory on this CPU if it is live here, otherwise drop this CPU from its mask */
+void page_tlb_flush_local(page_directory_t *directory, uint64_t start, uint64_t end)
+{
+    uint32_t        cpu   = page_tlb_current_cpu();
+    page_tlb_cpu_t *state = page_tlb_cpu(cpu);
+    if (!state) return;
+
+    if (__atomic_load_n(&state->active, __ATOMIC_ACQUIRE) != directory) {
+        /* Its PCID slot already holds an older generation and is flushed on the next switch. */
+        __atomic_and_fetch(&directory->cpu_mask[cpu / PAGE_TLB_MASK_BITS], ~(1ULL << (cpu % PAGE_TLB_MASK_BITS)), __ATOMIC_SEQ_CST);
+        return;
+    }
+    start = start & ~(PAGE_4K_SIZE - 1);
+    if (end > start && (end - start) / PAGE_4K_SIZE <= PAGE_TLB_FLUSH_CEILING) {
+        for (uint64_t addr = start; addr < end; addr += PAGE_4K_SIZE) flush_tlb(addr);
+        return;
+    }
+    uint64_t cr3 = get_cr3();
+    if (state->invpcid && (cr3 & CR3_PCID_MASK)) {
+        struct {
+                uint64_t pcid;
+                uint64_t address;
+        } descriptor = {cr3 & CR3_PCID_MASK, 0};
+        __asm__ volatile("invpcid %0, %1" ::"m"(descriptor), "r"(1ULL) : "memory"); // Single-context
+        return;
+    }
+    page_load_cr3(cr3 & ~CR3_PCID_MASK, cr3 & CR3_PCID_MASK, 0);
+}
+
+/* Enable PCID tagging on the calling CPU when supported */
+void page_tlb_init_cpu(void)
+{
+    page_tlb_cpu_t *state = page_tlb_cpu(page_tlb_current_cpu());
+    if (!state || !cpu_support_pcid() || (get_cr3() & CR3_PCID_MASK)) return;
+
+    uint64_t cr4;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4 | CR4_PCIDE) : "memory");
+    state->pcid    = 1;
+    state->invpcid = (uint8_t)cpu_support_invpcid();
+}
+
+/* Start an empty shootdown batch for directory */
+void tlb_batch_init(tlb_batch_t *batch, page_directory_t *directory)
+{
+    batch->directory = directory;
+    batch->start     = UINT64_MAX;
+    batch->end       = 0;
+    batch->count     = 0;
+}
+
+/* Shoot down the batched range once, then release the deferred frames */
+void tlb_batch_finish(tlb_batch_t *batch)
+{
+    if (batch->start < batch->end) flush_tlb_mm_range(batch->directory, batch->start, batch->end);
+    for (size_t i = 0; i < batch->count; i++) (void)frame_release_range(batch->frames[i], batch->frame_counts[i]);
+    batch->start = UINT64_MAX;
+    batch->end   = 0;
+    batch->count = 0;
+}
+
+/* Queue a range (and optionally its frames) for the next batch flush */
+void tlb_batch_add(tlb_batch_t *batch, uint64_t start, uint64_t end, uint64_t frame, size_t frame_count)
+{
+    if (frame && batch->count == TLB_BATCH_FRAMES) tlb_batch_finish(batch);
+    if (start < batch->start) batch->start = start;
+    if (end > batch->end) batch->end = end;
+    if (!frame) return;
+    batch->frames[batch->count]       = frame;
+    batch->frame_counts[batch->count] = (uint32_t)frame_count;
+    batch->count++;
 }
 
 /* Maps a contiguous physical memory range to the specified virtual address range */
@@ -1297,4 +1520,5 @@ void page_init(void)
     __asm__ volatile("mov %0, %%cr0" : : "r"(cr0) : "memory");
     page_enable_global_tlb();
     cpu_enable_nx();
+    page_tlb_init_cpu();
 }
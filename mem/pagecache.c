@@ -30,6 +30,7 @@
 #define PAGECACHE_HASH_LOAD     4U
 #define PAGECACHE_READAHEAD_MIN 2U
 #define PAGECACHE_READAHEAD_MAX 16U
+#define PAGECACHE_WRITEBACK_RUN 16U // contiguous dirty pages pushed with one backend write
 
 /* Keep direct reclaim latency bounded for page faults and desktop redraws. */
 #define PAGECACHE_RECLAIM_MIN_SCAN      4096U
@@ -46,6 +47,8 @@
 #define PC_PAGE_READAHEAD  (1U << 7)
 #define PC_PAGE_WAS_DIRTY  (1U << 8)
 
+#define PC_BUFFER_ORPHAN (1U << 31) // page left the cache while buffers still pin its data
+
 typedef struct {
         volatile uint32_t value;
 } pc_lock_t;
@@ -60,6 +63,7 @@ typedef struct pagecache_page {
         void                *data;
         volatile uint32_t    flags;
         volatile uint32_t    references;
+        volatile uint32_t    buffers; // pipe/splice holds on data, plus PC_BUFFER_ORPHAN
         pc_lock_t            lock;
 } pagecache_page_t;
 
@@ -276,6 +280,9 @@ static void pc_free_page(pagecache_page_t *page)
         pc_stat_inc(&pagecache.stats.dirty_evicted);
     else
         pc_stat_inc(&pagecache.stats.clean_evicted);
+
+    /* Outstanding buffers keep the data alive; the last one frees it. */
+    if (__atomic_fetch_or(&page->buffers, PC_BUFFER_ORPHAN, __ATOMIC_ACQ_REL)) return;
     pagecache.allocator.free(page->data, page->physical);
     free(page);
 }
@@ -331,6 +338,51 @@ static int pc_load_locked(pagecache_page_t *page)
     return EOK;
 }
 
+/*
+ * Populate a run of locked, consecutive, not-uptodate pages with a single
+ * backend read through a bounce buffer, so the filesystem sees one range it
+ * can map to multi-block transfers instead of one request per page.
+ */
+static int pc_load_run_locked(pagecache_page_t **pages, size_t count)
+{
+    pagecache_mapping_t *mapping = pages[0]->mapping;
+    uint64_t             start   = pages[0]->index * PAGECACHE_PAGE_SIZE;
+    uint64_t             limit   = __atomic_load_n(&mapping->size, __ATOMIC_ACQUIRE);
+    size_t               total   = start >= limit ? 0 : count * PAGECACHE_PAGE_SIZE;
+    if (total > limit - start) total = (size_t)(limit - start);
+    uint8_t *bounce = count > 1 && total && mapping->ops.read ? malloc(total) : NULL;
+    if (!bounce) {
+        int first_error = EOK;
+        for (size_t i = 0; i < count; i++) {
+            int result = pc_load_locked(pages[i]);
+            if (result && !first_error) first_error = result;
+        }
+        return first_error;
+    }
+
+    int64_t result = mapping->ops.read(mapping->context, bounce, start, total);
+    pc_stat_inc(&pagecache.stats.reads);
+    if (result < 0) {
+        plogk("pagecache: Read failed (pages %llu+%zu, offset %llu, count %zu): %lld\n", (unsigned long long)pages[0]->index, count, (unsigned long long)start, total, (long long)result);
+        for (size_t i = 0; i < count; i++) pages[i]->flags |= PC_PAGE_ERROR;
+        __atomic_store_n(&mapping->error, (int)result, __ATOMIC_RELEASE);
+        free(bounce);
+        return (int)result;
+    }
+    if ((uint64_t)result > total) result = (int64_t)total;
+    for (size_t i = 0; i < count; i++) {
+        size_t offset = i * PAGECACHE_PAGE_SIZE;
+        size_t valid  = (size_t)result > offset ? (size_t)result - offset : 0;
+        if (valid > PAGECACHE_PAGE_SIZE) valid = PAGECACHE_PAGE_SIZE;
+        memset(pages[i]->data, 0, PAGECACHE_PAGE_SIZE);
+        if (valid) memcpy(pages[i]->data, bounce + offset, valid);
+        pages[i]->flags |= PC_PAGE_UPTODATE;
+        pages[i]->flags &= ~PC_PAGE_ERROR;
+    }
+    free(bounce);
+    return EOK;
+}
+
 /* Push a dirty page to the backing store and clear its dirty state. */
 static int pc_writeback_page_locked(pagecache_page_t *page)
 {
@@ -365,6 +417,60 @@ static int pc_writeback_page_locked(pagecache_page_t *page)
     return EOK;
 }
 
+/*
+ * Write back a run of locked, consecutive, dirty pages with a single backend
+ * write through a bounce buffer.  Pages the write fully covered are cleaned;
+ * the rest keep their dirty state and are marked in error.
+ */
+static int pc_writeback_run_locked(pagecache_page_t **pages, size_t count)
+{
+    pagecache_mapping_t *mapping = pages[0]->mapping;
+    uint64_t             start   = pages[0]->index * PAGECACHE_PAGE_SIZE;
+    uint64_t             limit   = __atomic_load_n(&mapping->size, __ATOMIC_ACQUIRE);
+    size_t               total   = start >= limit ? 0 : count * PAGECACHE_PAGE_SIZE;
+    if (total > limit - start) total = (size_t)(limit - start);
+    uint8_t *bounce = count > 1 && total && mapping->ops.write ? malloc(total) : NULL;
+    if (!bounce) {
+        int first_error = EOK;
+        for (size_t i = 0; i < count; i++) {
+            int result = pc_writeback_page_locked(pages[i]);
+            if (result && !first_error) first_error = result;
+        }
+        return first_error;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t offset = i * PAGECACHE_PAGE_SIZE;
+        if (offset < total) memcpy(bounce + offset, pages[i]->data, total - offset < PAGECACHE_PAGE_SIZE ? total - offset : PAGECACHE_PAGE_SIZE);
+        pages[i]->flags |= PC_PAGE_WRITEBACK;
+        pc_stat_inc(&pagecache.stats.writeback);
+    }
+    int64_t result = mapping->ops.write(mapping->context, bounce, start, total);
+    pc_stat_inc(&pagecache.stats.writes);
+    free(bounce);
+
+    size_t written = result < 0 ? 0 : (size_t)result;
+    int    error   = result < 0 ? (int)result : -EIO;
+    if (result < 0 || written != total)
+        plogk("pagecache: Writeback failed for pages %llu+%zu (offset %llu, count %zu, result %lld)\n", (unsigned long long)pages[0]->index, count, (unsigned long long)start, total, (long long)result);
+    for (size_t i = 0; i < count; i++) {
+        size_t offset = i * PAGECACHE_PAGE_SIZE;
+        size_t end    = total - offset < PAGECACHE_PAGE_SIZE ? total : offset + PAGECACHE_PAGE_SIZE;
+        pages[i]->flags &= ~PC_PAGE_WRITEBACK;
+        pc_stat_dec(&pagecache.stats.writeback);
+        if (offset >= total || written >= end) {
+            pages[i]->flags &= ~(PC_PAGE_DIRTY | PC_PAGE_ERROR);
+            pc_stat_dec(&pagecache.stats.dirty);
+            continue;
+        }
+        pages[i]->flags |= PC_PAGE_ERROR;
+        pc_stat_inc(&pagecache.stats.writeback_errors);
+    }
+    if (written == total) return EOK;
+    __atomic_store_n(&mapping->error, error, __ATOMIC_RELEASE);
+    return error;
+}
+
 /* Initialize the page cache with the given allocator and page limit. */
 int pagecache_init(const pagecache_allocator_t *allocator, size_t max_pages)
 {
@@ -516,6 +622,22 @@ void pagecache_put_page(pagecache_page_t *page)
     __atomic_sub_fetch(&page->references, 1, __ATOMIC_ACQ_REL);
 }
 
+/* Pin a page's data for a pipe buffer; the caller must hold a page reference. */
+void pagecache_buffer_get(pagecache_page_t *page)
+{
+    if (!page) return;
+    __atomic_add_fetch(&page->buffers, 1, __ATOMIC_ACQ_REL);
+}
+
+/* Drop a buffer pin, freeing the data if the page already left the cache. */
+void pagecache_buffer_put(pagecache_page_t *page)
+{
+    if (!page) return;
+    if (__atomic_sub_fetch(&page->buffers, 1, __ATOMIC_ACQ_REL) != PC_BUFFER_ORPHAN) return;
+    pagecache.allocator.free(page->data, page->physical);
+    free(page);
+}
+
 /* Lock a page and optionally populate it from the backing store. */
 int pagecache_lock_page(pagecache_page_t *page, int populate)
 {
@@ -570,7 +692,20 @@ void pagecache_mark_dirty(pagecache_page_t *page)
     page->flags |= PC_PAGE_UPTODATE | PC_PAGE_REFERENCED;
 }
 
-/* Prefetch count pages starting at first, returning the first error if strict. */
+/* Load a run of locked readahead pages, then unlock and release them. */
+static int pc_readahead_flush(pagecache_page_t **run, size_t *count)
+{
+    if (!*count) return EOK;
+    int result = pc_load_run_locked(run, *count);
+    for (size_t i = 0; i < *count; i++) {
+        pc_unlock(&run[i]->lock);
+        pagecache_put_page(run[i]);
+    }
+    *count = 0;
+    return result;
+}
+
+/* Prefetch count pages starting at first, one backend read per run of missing pages; the first error is returned if strict. */
 static int pc_readahead_pages(pagecache_mapping_t *mapping, uint64_t first, uint32_t count, int strict)
 {
     uint64_t size       = __atomic_load_n(&mapping->size, __ATOMIC_ACQUIRE);
@@ -579,15 +714,25 @@ static int pc_readahead_pages(pagecache_mapping_t *mapping, uint64_t first, uint
     uint64_t available = file_pages - first;
     if ((uint64_t)count > available) count = (uint32_t)available;
 
-    for (uint32_t offset = 0; offset < count; offset++) {
+    pagecache_page_t *run[PAGECACHE_READAHEAD_MAX];
+    size_t            queued = 0;
+    int               result = EOK;
+    for (uint32_t offset = 0; offset < count && result == EOK; offset++) {
         pagecache_page_t *page = pc_get_page(mapping, first + offset, 1, 0, 0);
-        if (!page) return EOK;
-        int result = pagecache_lock_page(page, 1);
-        if (!result) pagecache_unlock_page(page);
-        pagecache_put_page(page);
-        if (result) return strict ? result : EOK;
+        if (!page) break;
+        pc_lock(&page->lock);
+        if (page->flags & (PC_PAGE_UPTODATE | PC_PAGE_EVICTING)) {
+            pc_unlock(&page->lock);
+            pagecache_put_page(page);
+            result = pc_readahead_flush(run, &queued);
+            continue;
+        }
+        run[queued++] = page;
+        if (queued == PAGECACHE_READAHEAD_MAX) result = pc_readahead_flush(run, &queued);
     }
-    return EOK;
+    int tail = pc_readahead_flush(run, &queued);
+    if (!result) result = tail;
+    return strict ? result : EOK;
 }
 
 /* Adjust the readahead window based on observed sequential access. */
@@ -633,10 +778,14 @@ void pagecache_mmap_readahead(pagecache_mapping_t *mapping, uint64_t index)
     if (mapping) pc_adaptive_readahead(mapping, index, index);
 }
 
-/* Read a range of the mapping into buffer. */
-int64_t pagecache_read(pagecache_mapping_t *mapping, void *buffer, uint64_t offset, size_t size)
+/*
+ * Hand out the cached spans covering [offset, offset + size) to actor, one
+ * locked page at a time.  Reads stop at end of file.  Returns the bytes
+ * handed out, or the first error if nothing was.
+ */
+int64_t pagecache_read_iter(pagecache_mapping_t *mapping, uint64_t offset, size_t size, pagecache_actor_t actor, void *context)
 {
-    if (!mapping || (!buffer && size)) return -EINVAL;
+    if (!mapping || !actor) return -EINVAL;
     uint64_t limit = __atomic_load_n(&mapping->size, __ATOMIC_ACQUIRE);
     if (offset >= limit || !size) return 0;
     if (size > limit - offset) size = (size_t)(limit - offset);
@@ -651,19 +800,39 @@ int64_t pagecache_read(pagecache_mapping_t *mapping, void *buffer, uint64_t offs
         pagecache_page_t *page = pagecache_get_page(mapping, index, 1);
         if (!page) return done ? (int64_t)done : -ENOMEM;
         int result = pagecache_lock_page(page, 1);
-        if (result) {
-            pagecache_put_page(page);
-            return done ? (int64_t)done : result;
+        if (!result) {
+            result = actor(context, page, (char *)page->data + inside, count);
+            pagecache_unlock_page(page);
         }
-        memcpy((char *)buffer + done, (char *)page->data + inside, count);
-        pagecache_unlock_page(page);
         pagecache_put_page(page);
+        if (result) {
+            if (done) break;
+            return result;
+        }
         done += count;
     }
     pc_adaptive_readahead(mapping, offset / PAGECACHE_PAGE_SIZE, (offset + done - 1) / PAGECACHE_PAGE_SIZE);
     return (int64_t)done;
 }
 
+/* Copy a cached span out to a kernel buffer. */
+static int pc_copy_out(void *context, pagecache_page_t *page, void *data, size_t count)
+{
+    (void)page;
+    char **buffer = context;
+    memcpy(*buffer, data, count);
+    *buffer += count;
+    return EOK;
+}
+
+/* Read a range of the mapping into buffer. */
+int64_t pagecache_read(pagecache_mapping_t *mapping, void *buffer, uint64_t offset, size_t size)
+{
+    if (!buffer && size) return -EINVAL;
+    char *cursor = buffer;
+    return pagecache_read_iter(mapping, offset, size, pc_copy_out, &cursor);
+}
+
 /* Grow the mapping size up to end, in the face of concurrent writers. */
 static void pc_extend_size(pagecache_mapping_t *mapping, uint64_t end)
 {
@@ -671,10 +840,16 @@ static void pc_extend_size(pagecache_mapping_t *mapping, uint64_t end)
     while (old < end && !__atomic_compare_exchange_n(&mapping->size, &old, end, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
 }
 
-/* Write a range of buffer into the mapping, marking pages dirty. */
-int64_t pagecache_write(pagecache_mapping_t *mapping, const void *buffer, uint64_t offset, size_t size)
+/*
+ * Let actor fill the spans covering [offset, offset + size), one locked and
+ * uptodate page at a time, marking them dirty and growing the file.  A span
+ * the actor fails on may be partly written, so it is still marked dirty
+ * (without growing the file) to keep the cache and its backing store in
+ * agreement.  Returns the bytes written, or the first error if none were.
+ */
+int64_t pagecache_write_iter(pagecache_mapping_t *mapping, uint64_t offset, size_t size, pagecache_actor_t actor, void *context)
 {
-    if (!mapping || (!buffer && size)) return -EINVAL;
+    if (!mapping || !actor) return -EINVAL;
     if (!mapping->ops.write) return -EROFS;
     if (!size) return 0;
     if (offset > UINT64_MAX - size) return -EFBIG;
@@ -708,9 +883,9 @@ int64_t pagecache_write(pagecache_mapping_t *mapping, const void *buffer, uint64
             uint64_t old_in_page = old_size > page_start ? old_size - page_start : 0;
             if (old_in_page > PAGECACHE_PAGE_SIZE) old_in_page = PAGECACHE_PAGE_SIZE;
             if (inside > old_in_page) memset((char *)page->data + old_in_page, 0, inside - (size_t)old_in_page);
-            memcpy((char *)page->data + inside, (const char *)buffer + done, count);
+            result = actor(context, page, (char *)page->data + inside, count);
             pagecache_mark_dirty(page);
-            pc_extend_size(mapping, page_offset + count);
+            if (!result) pc_extend_size(mapping, page_offset + count);
         }
         pc_unlock(&page->lock);
         pagecache_put_page(page);
@@ -720,6 +895,24 @@ int64_t pagecache_write(pagecache_mapping_t *mapping, const void *buffer, uint64
     return (int64_t)done;
 }
 
+/* Copy a kernel buffer into a cached span. */
+static int pc_copy_in(void *context, pagecache_page_t *page, void *data, size_t count)
+{
+    (void)page;
+    const char **buffer = context;
+    memcpy(data, *buffer, count);
+    *buffer += count;
+    return EOK;
+}
+
+/* Write a range of buffer into the mapping, marking pages dirty. */
+int64_t pagecache_write(pagecache_mapping_t *mapping, const void *buffer, uint64_t offset, size_t size)
+{
+    if (!buffer && size) return -EINVAL;
+    const char *cursor = buffer;
+    return pagecache_write_iter(mapping, offset, size, pc_copy_in, &cursor);
+}
+
 /* Restore the max-heap property at root during heapsort. */
 static void pc_sort_sift_down(pagecache_page_t **pages, size_t root, size_t count)
 {
@@ -807,13 +1000,29 @@ int pagecache_writeback(pagecache_mapping_t *mapping, uint64_t start, uint64_t e
 
     pc_sort_pages(pages, count);
 
+    /* Lock runs of consecutive dirty pages and push each run with one write. */
     int first_error = EOK;
-    for (size_t i = 0; i < count; i++) {
-        pc_lock(&pages[i]->lock);
-        int result = pc_writeback_page_locked(pages[i]);
-        pc_unlock(&pages[i]->lock);
-        pagecache_put_page(pages[i]);
+    for (size_t i = 0; i < count;) {
+        size_t run = 0;
+        while (i + run < count && run < PAGECACHE_WRITEBACK_RUN && (!run || pages[i + run]->index == pages[i + run - 1]->index + 1)) {
+            pc_lock(&pages[i + run]->lock);
+            if (!(pages[i + run]->flags & PC_PAGE_DIRTY)) {
+                pc_unlock(&pages[i + run]->lock);
+                break;
+            }
+            run++;
+        }
+        if (!run) {
+            pagecache_put_page(pages[i++]); // cleaned since it was collected
+            continue;
+        }
+        int result = pc_writeback_run_locked(&pages[i], run);
         if (result && !first_error) first_error = result;
+        for (size_t j = 0; j < run; j++) {
+            pc_unlock(&pages[i + j]->lock);
+            pagecache_put_page(pages[i + j]);
+        }
+        i += run;
     }
     free((void *)pages);
     if (!first_error && mapping->ops.sync && (flags & PAGECACHE_WB_SYNC)) first_error = mapping->ops.sync(mapping->context);
@@ -996,8 +1205,8 @@ int pagecache_readahead(pagecache_mapping_t *mapping, uint64_t offset, size_t si
     return EOK;
 }
 
-/* Free clean pages up to target, writing back dirty candidates. */
-size_t pagecache_reclaim(size_t target)
+/* Free clean pages up to target, writing back dirty candidates; report LRU pages examined. */
+size_t pagecache_reclaim_scan(size_t target, size_t *scanned_out)
 {
     bool   unlimited   = target == SIZE_MAX;
     size_t scan_budget = SIZE_MAX;
@@ -1018,7 +1227,7 @@ size_t pagecache_reclaim(size_t target)
             previous = page->lru_prev;
             scanned++;
             if ((page->mapping->flags & PAGECACHE_MAPPING_UNEVICTABLE) || __atomic_load_n(&page->mapping->pins, __ATOMIC_ACQUIRE)) continue;
-            if (__atomic_load_n(&page->references, __ATOMIC_ACQUIRE)) continue;
+            if (__atomic_load_n(&page->references, __ATOMIC_ACQUIRE) || __atomic_load_n(&page->buffers, __ATOMIC_ACQUIRE)) continue;
             if (!pc_trylock(&page->lock)) continue;
             if (page->flags & (PC_PAGE_WRITEBACK | PC_PAGE_EVICTING)) {
                 pc_unlock(&page->lock);
@@ -1106,9 +1315,16 @@ size_t pagecache_reclaim(size_t target)
         reclaimed++;
         pc_stat_inc(&pagecache.stats.reclaimed);
     }
+    if (scanned_out) *scanned_out = scanned;
     return reclaimed;
 }
 
+/* Free clean pages up to target, writing back dirty candidates. */
+size_t pagecache_reclaim(size_t target)
+{
+    return pagecache_reclaim_scan(target, NULL);
+}
+
 /* Snapshot the global page cache statistics. */
 void pagecache_get_stats(pagecache_stats_t *stats)
 {
@@ -0,0 +1,324 @@
+/*
+ *
+ *      rmap.c
+ *      Anonymous page reverse mapping and LRU
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <kernel/printk.h>
+#include <libs/std/stdlib.h>
+#include <mem/frame.h>
+#include <mem/heap.h>
+#include <mem/hhdm.h>
+#include <mem/page.h>
+#include <mem/rmap.h>
+#include <mem/slab.h>
+#include <process/process.h>
+#include <sync/spin_lock.h>
+
+#define RMAP_HASH_MIN  1024U
+#define RMAP_HASH_FRAC 8U // one bucket per this many frames of RAM
+
+/* One (process, virtual address) that maps an anonymous frame. */
+typedef struct anon_mapping {
+        pid_t                pid;
+        uintptr_t            address;
+        struct anon_mapping *next;
+} anon_mapping_t;
+
+/* Per-frame record: hash linkage, LRU position and the chain of mappings. */
+typedef struct anon_page {
+        uint64_t          frame;
+        struct anon_page *hash_next;
+        struct anon_page *lru_prev;
+        struct anon_page *lru_next;
+        anon_mapping_t   *mappings;
+        uint8_t           lru;      // RMAP_LRU_ACTIVE / RMAP_LRU_INACTIVE
+        bool              isolated; // off the lists, owned by a scanner
+        bool              dead;     // frame freed while isolated
+} anon_page_t;
+
+typedef struct {
+        anon_page_t *head;
+        anon_page_t *tail;
+        uint64_t     count;
+} anon_lru_t;
+
+static anon_page_t  *rmap_hash_boot[RMAP_HASH_MIN];
+static anon_page_t **rmap_hash      = rmap_hash_boot;
+static uint64_t      rmap_hash_mask = RMAP_HASH_MIN - 1;
+static anon_lru_t    rmap_lru[2];
+static spinlock_t    rmap_lock;
+static slab_cache_t *rmap_page_cache;
+static slab_cache_t *rmap_mapping_cache;
+static uint64_t      rmap_activated;
+static uint64_t      rmap_deactivated;
+
+/* Bucket for a physical frame (rmap_lock held). */
+static inline anon_page_t **rmap_bucket(uint64_t frame)
+{
+    return &rmap_hash[(frame / PAGE_4K_SIZE) & rmap_hash_mask];
+}
+
+/* Find the record for frame (rmap_lock held). */
+static anon_page_t *rmap_lookup_locked(uint64_t frame)
+{
+    for (anon_page_t *page = *rmap_bucket(frame); page; page = page->hash_next)
+        if (page->frame == frame) return page;
+    return NULL;
+}
+
+/* Link a record into the hash (rmap_lock held). */
+static void rmap_hash_locked(anon_page_t *page)
+{
+    anon_page_t **bucket = rmap_bucket(page->frame);
+    page->hash_next      = *bucket;
+    *bucket              = page;
+}
+
+/* Unlink a record from the hash (rmap_lock held). */
+static void rmap_unhash_locked(anon_page_t *page)
+{
+    anon_page_t **link = rmap_bucket(page->frame);
+    while (*link && *link != page) link = &(*link)->hash_next;
+    if (*link) *link = page->hash_next;
+}
+
+/* Insert at the head (most recent end) of an LRU list (rmap_lock held). */
+static void rmap_lru_add_locked(anon_page_t *page, int lru)
+{
+    anon_lru_t *list = &rmap_lru[lru];
+    page->lru        = (uint8_t)lru;
+    page->lru_prev   = NULL;
+    page->lru_next   = list->head;
+    if (list->head)
+        list->head->lru_prev = page;
+    else
+        list->tail = page;
+    list->head = page;
+    list->count++;
+}
+
+/* Remove from whichever LRU list holds the page (rmap_lock held). */
+static void rmap_lru_del_locked(anon_page_t *page)
+{
+    anon_lru_t *list = &rmap_lru[page->lru];
+    if (page->lru_prev)
+        page->lru_prev->lru_next = page->lru_next;
+    else
+        list->head = page->lru_next;
+    if (page->lru_next)
+        page->lru_next->lru_prev = page->lru_prev;
+    else
+        list->tail = page->lru_prev;
+    page->lru_prev = NULL;
+    page->lru_next = NULL;
+    list->count--;
+}
+
+/* Free a detached record and its mapping chain; never called with rmap_lock held. */
+static void rmap_free_page(anon_page_t *page)
+{
+    anon_mapping_t *mapping = page->mappings;
+    while (mapping) {
+        anon_mapping_t *next = mapping->next;
+        (void)slab_cache_free(rmap_mapping_cache, mapping);
+        mapping = next;
+    }
+    (void)slab_cache_free(rmap_page_cache, page);
+}
+
+/* Size the frame hash; called once the heap is up. */
+void rmap_init(void)
+{
+    rmap_page_cache    = slab_cache_create("anon_page", sizeof(anon_page_t), 8, NULL, NULL);
+    rmap_mapping_cache = slab_cache_create("anon_mapping", sizeof(anon_mapping_t), 8, NULL, NULL);
+    if (!rmap_page_cache || !rmap_mapping_cache) plogk("rmap: Cache creation failed, anonymous reclaim disabled.\n");
+
+    uint64_t size = RMAP_HASH_MIN;
+    while (size < frame_allocator.origin_frames / RMAP_HASH_FRAC) size <<= 1;
+    if (size == RMAP_HASH_MIN) return;
+
+    anon_page_t **table = calloc(size, sizeof(*table));
+    if (!table) {
+        plogk("rmap: Hash allocation failed, using %u boot buckets\n", RMAP_HASH_MIN);
+        return;
+    }
+    spin_lock(&rmap_lock);
+    rmap_hash      = table;
+    rmap_hash_mask = size - 1;
+    spin_unlock(&rmap_lock);
+}
+
+/* Attach one mapping to frame, creating its record on first use. */
+static void rmap_add_pid(uint64_t frame, pid_t pid, uintptr_t address, bool tracked_only)
+{
+    if (!rmap_page_cache || !rmap_mapping_cache || pid <= 0) return;
+    if (tracked_only) {
+        spin_lock(&rmap_lock);
+        bool tracked = rmap_lookup_locked(frame) != NULL;
+        spin_unlock(&rmap_lock);
+        if (!tracked) return;
+    }
+
+    anon_mapping_t *mapping = slab_cache_alloc(rmap_mapping_cache);
+    anon_page_t    *fresh   = tracked_only ? NULL : slab_cache_alloc(rmap_page_cache);
+    if (!mapping || (!tracked_only && !fresh)) goto out;
+
+    spin_lock(&rmap_lock);
+    anon_page_t *page = rmap_lookup_locked(frame);
+    if (!page && fresh) {
+        frame_mark_anon(frame);
+        page           = fresh;
+        fresh          = NULL;
+        page->frame    = frame;
+        page->mappings = NULL;
+        page->isolated = false;
+        page->dead     = false;
+        rmap_hash_locked(page);
+        rmap_lru_add_locked(page, RMAP_LRU_INACTIVE);
+    }
+    if (page) {
+        anon_mapping_t *cursor = page->mappings;
+        while (cursor && (cursor->pid != pid || cursor->address != address)) cursor = cursor->next;
+        if (!cursor) {
+            mapping->pid     = pid;
+            mapping->address = address;
+            mapping->next    = page->mappings;
+            page->mappings   = mapping;
+            mapping          = NULL;
+        }
+    }
+    spin_unlock(&rmap_lock);
+out:
+    if (mapping) (void)slab_cache_free(rmap_mapping_cache, mapping);
+    if (fresh) (void)slab_cache_free(rmap_page_cache, fresh);
+}
+
+/* Record that proc maps the anonymous frame at address, adding it to the inactive list if new. */
+void rmap_add_anon(uint64_t frame, process_t *proc, uintptr_t address)
+{
+    if (!frame || !proc || !proc->task) return;
+    rmap_add_pid(frame & PAGE_4K_MASK, (pid_t)proc->task->pid, address & ~(uintptr_t)(PAGE_4K_SIZE - 1), false);
+}
+
+/* Walk one child table level, chaining the child onto frames already tracked for the parent. */
+static void rmap_clone_table(page_table_t *table, int level, uintptr_t base, pid_t pid)
+{
+    uint64_t shift = level == 4 ? 39 : (level == 3 ? 30 : (level == 2 ? 21 : 12));
+    for (uint32_t i = 0; i < (level == 4 ? 256U : 512U); i++) {
+        uint64_t  value   = __atomic_load_n(&table->entries[i].value, __ATOMIC_ACQUIRE);
+        uintptr_t address = base | ((uintptr_t)i << shift);
+        if (!(value & PTE_PRESENT) || (value & PTE_HUGE)) continue;
+        if (level == 1) {
+            if ((value & PTE_USER) && !(value & PTE_SHARED)) rmap_add_pid(value & PAGE_4K_MASK, pid, address, true);
+        } else {
+            rmap_clone_table(phys_to_virt(value & PAGE_4K_MASK), level - 1, address, pid);
+        }
+    }
+}
+
+/* Add the child's mappings of every tracked frame after a fork's COW clone. */
+void rmap_clone_user(page_directory_t *directory, process_t *child)
+{
+    if (!directory || !directory->table || !child || !child->task || !rmap_page_cache) return;
+    spin_lock(&directory->lock);
+    rmap_clone_table(directory->table, 4, 0, (pid_t)child->task->pid);
+    spin_unlock(&directory->lock);
+}
+
+/* Forget a frame whose last reference was just dropped. */
+void rmap_frame_freed(uint64_t frame)
+{
+    if (!rmap_page_cache) return;
+    spin_lock(&rmap_lock);
+    anon_page_t *page = rmap_lookup_locked(frame);
+    if (page) {
+        rmap_unhash_locked(page);
+        if (page->isolated) {
+            page->dead = true;
+            page       = NULL;
+        } else {
+            rmap_lru_del_locked(page);
+        }
+    }
+    spin_unlock(&rmap_lock);
+    if (page) rmap_free_page(page);
+}
+
+/* Take the tail of the active or inactive list for scanning. */
+bool rmap_isolate(bool active, rmap_scan_t *scan)
+{
+    spin_lock(&rmap_lock);
+    anon_page_t *page = rmap_lru[active ? RMAP_LRU_ACTIVE : RMAP_LRU_INACTIVE].tail;
+    if (!page) {
+        spin_unlock(&rmap_lock);
+        return false;
+    }
+    rmap_lru_del_locked(page);
+    page->isolated = true;
+    scan->page     = page;
+    scan->frame    = page->frame;
+    scan->count    = 0;
+    for (anon_mapping_t *mapping = page->mappings; mapping && scan->count < RMAP_SCAN_MAPPINGS; mapping = mapping->next) {
+        scan->pid[scan->count]     = mapping->pid;
+        scan->address[scan->count] = mapping->address;
+        scan->count++;
+    }
+    spin_unlock(&rmap_lock);
+    return true;
+}
+
+/* Return an isolated page to an LRU list, dropping mappings flagged in stale_mask. */
+void rmap_putback(rmap_scan_t *scan, int lru, uint32_t stale_mask)
+{
+    anon_page_t    *page  = scan->page;
+    anon_mapping_t *stale = NULL;
+
+    spin_lock(&rmap_lock);
+    page->isolated = false;
+    if (!page->dead) {
+        for (uint32_t i = 0; i < scan->count; i++) {
+            if (!(stale_mask & (1U << i))) continue;
+            anon_mapping_t **link = &page->mappings;
+            while (*link && ((*link)->pid != scan->pid[i] || (*link)->address != scan->address[i])) link = &(*link)->next;
+            if (!*link) continue;
+            anon_mapping_t *mapping = *link;
+            *link                   = mapping->next;
+            mapping->next           = stale;
+            stale                   = mapping;
+        }
+        if (lru == RMAP_LRU_FORGET || !page->mappings) {
+            rmap_unhash_locked(page);
+            page->dead = true;
+        } else {
+            if (lru == RMAP_LRU_ACTIVE && page->lru == RMAP_LRU_INACTIVE) rmap_activated++;
+            if (lru == RMAP_LRU_INACTIVE && page->lru == RMAP_LRU_ACTIVE) rmap_deactivated++;
+            rmap_lru_add_locked(page, lru);
+        }
+    }
+    bool dead = page->dead;
+    spin_unlock(&rmap_lock);
+
+    while (stale) {
+        anon_mapping_t *next = stale->next;
+        (void)slab_cache_free(rmap_mapping_cache, stale);
+        stale = next;
+    }
+    if (dead) rmap_free_page(page);
+    scan->page = NULL;
+}
+
+/* Report LRU sizes and aging counters. */
+void rmap_get_stats(rmap_stats_t *stats)
+{
+    spin_lock(&rmap_lock);
+    stats->active      = rmap_lru[RMAP_LRU_ACTIVE].count;
+    stats->inactive    = rmap_lru[RMAP_LRU_INACTIVE].count;
+    stats->activated   = rmap_activated;
+    stats->deactivated = rmap_deactivated;
+    spin_unlock(&rmap_lock);
+}
@@ -22,6 +22,7 @@
 #else
 #    include <arch/common.h>
 #    include <arch/smp.h>
+#    include <drivers/block/core/bio.h>
 #    include <drivers/block/core/blockdev.h>
 #    include <fs/core/vfs.h>
 #    include <kernel/errno.h>
@@ -33,6 +34,8 @@
 #    include <mem/heap.h>
 #    include <mem/hhdm.h>
 #    include <mem/page.h>
+#    include <mem/rmap.h>
+#    include <mem/zram.h>
 #    include <process/process.h>
 #    include <sync/spin_lock.h>
 #endif
@@ -137,27 +140,79 @@ int swap_slot_map_init(swap_slot_map_t *map, uint64_t *bitmap, uint32_t *refs, u
     return 0;
 }
 
-/* Reserve a free slot, advancing the cluster cursor; 0 if none remain. */
-uint64_t swap_slot_alloc(swap_slot_map_t *map)
+/* Count free slots from slot onward, stopping at want or the end of the map. */
+static uint64_t swap_slot_free_run(const swap_slot_map_t *map, uint64_t slot, uint64_t want)
+{
+    uint64_t run = 0;
+    while (run < want && slot + run <= map->slots && !swap_slot_used(map, slot + run)) run++;
+    return run;
+}
+
+/*
+ * Find a free slot by bitmap word, starting at the cluster holding start
+ * and wrapping once. With whole set, only a completely free cluster counts.
+ */
+static uint64_t swap_slot_scan(const swap_slot_map_t *map, uint64_t start, int whole)
 {
-    if (!map || !map->slots) return 0;
-    uint64_t start = map->cluster_next;
-    if (start < 1 || start > map->slots) start = 1;
-
-    for (uint64_t scanned = 0; scanned < map->slots; scanned++) {
-        uint64_t slot = start + scanned;
-        if (slot > map->slots) slot -= map->slots;
-        if (!swap_slot_used(map, slot)) {
-            swap_slot_set(map, slot, 1);
-            map->refs[slot]   = 1;
-            map->cluster_next = slot == map->slots ? 1 : slot + 1;
-            map->free_slots--;
-            return slot;
+    uint64_t words = (map->slots + 64) / 64;
+    uint64_t first = start / SWAP_CLUSTER_SLOTS;
+    for (uint64_t scanned = 0; scanned < words; scanned++) {
+        uint64_t word = (first + scanned) % words;
+        uint64_t bits = map->bitmap[word];
+        uint64_t base = word * SWAP_CLUSTER_SLOTS;
+        if (whole) {
+            if (!bits && base + SWAP_CLUSTER_SLOTS - 1 <= map->slots) return base ? base : 1;
+            continue;
+        }
+        if (bits == UINT64_MAX) continue;
+        for (uint64_t bit = 0; bit < 64; bit++) {
+            uint64_t slot = base + bit;
+            if (slot > map->slots) break;
+            if (slot && !(bits & (1ULL << bit))) return slot;
         }
     }
     return 0;
 }
 
+/*
+ * Reserve up to want contiguous free slots (at most one cluster) and
+ * return the first, or 0 if the map is full. The run continues the current
+ * cluster when it can, then takes a fresh cluster, and only falls back to
+ * a scattered free slot once no cluster is wholly free.
+ */
+uint64_t swap_slot_alloc_run(swap_slot_map_t *map, uint64_t want, uint64_t *count)
+{
+    if (count) *count = 0;
+    if (!map || !map->slots || !map->free_slots || !want) return 0;
+    if (want > SWAP_CLUSTER_SLOTS) want = SWAP_CLUSTER_SLOTS;
+
+    uint64_t slot = map->cluster_next;
+    if (slot < 1 || slot > map->slots) slot = 1;
+    uint64_t run = swap_slot_free_run(map, slot, want);
+    if (run < want) {
+        uint64_t fresh = swap_slot_scan(map, slot, 1);
+        if (!fresh) fresh = run ? slot : swap_slot_scan(map, slot, 0);
+        if (!fresh) return 0;
+        slot = fresh;
+        run  = swap_slot_free_run(map, slot, want);
+    }
+
+    for (uint64_t i = 0; i < run; i++) {
+        swap_slot_set(map, slot + i, 1);
+        map->refs[slot + i] = 1;
+    }
+    map->free_slots -= run;
+    map->cluster_next = slot + run > map->slots ? 1 : slot + run;
+    if (count) *count = run;
+    return slot;
+}
+
+/* Reserve one free slot near the cluster cursor; 0 if none remain. */
+uint64_t swap_slot_alloc(swap_slot_map_t *map)
+{
+    return swap_slot_alloc_run(map, 1, NULL);
+}
+
 /* Add a reference to a used slot. */
 int swap_slot_retain(swap_slot_map_t *map, uint64_t slot)
 {
@@ -188,6 +243,7 @@ uint32_t swap_slot_refs(const swap_slot_map_t *map, uint64_t slot)
 typedef enum {
     SWAP_BACKEND_BLOCK,
     SWAP_BACKEND_FILE,
+    SWAP_BACKEND_ZRAM,
 } swap_backend_t;
 
 typedef struct swap_area {
@@ -198,6 +254,7 @@ typedef struct swap_area {
         swap_backend_t    backend;
         blockdev_device_t device;
         vfs_node_t        file;
+        zram_device_t    *zram;
         swap_slot_map_t   slots;
         spinlock_t        lock;
         uint64_t          pages_in;
@@ -205,13 +262,43 @@ typedef struct swap_area {
         char              path[VFS_PATH_MAX];
 } swap_area_t;
 
-static swap_area_t swap_areas[SWAP_MAX_AREAS];
-static spinlock_t  swap_lock;
-
-/* Transfer one swap page between a slot and its block or file backend. */
+/*
+ * Swap cache
+ * A page read from a slot stays indexed by (type, slot) until the slot
+ * is freed or reclaim drops it, so faults through other PTEs sharing the
+ * slot and pages brought in by readahead are served from memory. Each
+ * entry holds one frame reference; an entry still being read is a
+ * placeholder that other faults sleep on, in a wait queue hashed by slot.
+ */
+typedef struct swap_cache_entry {
+        uint64_t                 slot;
+        uint64_t                 frame;
+        uint8_t                  type;
+        bool                     uptodate;  // clear while the read is in flight
+        bool                     dropped;   // slot freed during the read; the reader frees the entry
+        bool                     readahead; // read speculatively and not yet faulted on
+        struct swap_cache_entry *next;
+} swap_cache_entry_t;
+
+#    define SWAP_CACHE_HASH 256U
+#    define SWAP_CACHE_WAIT 64U // wait queues for in-flight placeholders
+
+static swap_area_t         swap_areas[SWAP_MAX_AREAS];
+static spinlock_t          swap_lock;
+static swap_cache_entry_t *swap_cache_hash[SWAP_CACHE_HASH];
+static spinlock_t          swap_cache_lock;
+static wait_queue_t        swap_cache_waitq[SWAP_CACHE_WAIT];
+static uint32_t            swap_cache_hand;
+static uint64_t            swap_cache_pages;
+static uint64_t            swap_cache_hits;
+static uint64_t            swap_readahead_pages;
+static uint64_t            swap_readahead_hits;
+
+/* Transfer one swap page between a slot and its block, file or zram backend. */
 static int swap_area_io(const swap_area_t *area, uint64_t slot, void *buffer, int write)
 {
     if (!area || !area->active || !slot || slot > area->slots.slots) return -EINVAL;
+    if (area->backend == SWAP_BACKEND_ZRAM) return write ? zram_write_page(area->zram, slot, buffer) : zram_read_page(area->zram, slot, buffer);
     uint64_t offset = slot * SWAP_PAGE_SIZE;
     if (area->backend == SWAP_BACKEND_BLOCK) return write ? blockdev_write_bytes(&area->device, offset, buffer, SWAP_PAGE_SIZE) : blockdev_read_bytes(&area->device, offset, buffer, SWAP_PAGE_SIZE);
 
@@ -220,21 +307,206 @@ static int swap_area_io(const swap_area_t *area, uint64_t slot, void *buffer, in
     return actual == SWAP_PAGE_SIZE ? EOK : -EIO;
 }
 
+/* Transfer pages to or from consecutive slots, as a single request on a block backend. */
+static int swap_area_io_run(const swap_area_t *area, uint64_t slot, void **buffers, size_t count, int write)
+{
+    if (!area || !slot || !count || count > area->slots.slots || slot > area->slots.slots - count + 1) return -EINVAL;
+    if (count > 1 && area->backend == SWAP_BACKEND_BLOCK && !(SWAP_PAGE_SIZE % area->device.sector_size)) {
+        bio_t bio;
+        int   result = EOK;
+        bio_init(&bio, &area->device, write ? BIO_WRITE : BIO_READ, slot * (SWAP_PAGE_SIZE / area->device.sector_size));
+        for (size_t i = 0; i < count && result == EOK; i++) result = bio_add_vec(&bio, buffers[i], SWAP_PAGE_SIZE);
+        if (result == EOK) {
+            result = bio_submit_wait(&bio);
+            bio_release_vecs(&bio);
+            return result;
+        }
+        bio_release_vecs(&bio);
+    }
+    for (size_t i = 0; i < count; i++) {
+        int result = swap_area_io(area, slot + i, buffers[i], write);
+        if (result != EOK) return result;
+    }
+    return EOK;
+}
+
 /* Resolve a swap device type to its active area, if any. */
 static swap_area_t *swap_area_for_type(uint32_t type)
 {
     return type < SWAP_MAX_AREAS && swap_areas[type].active ? &swap_areas[type] : NULL;
 }
 
-/* Retain or release the slot referenced by a swap entry. */
+/* Bucket for a swap slot (swap_cache_lock held). */
+static inline swap_cache_entry_t **swap_cache_bucket(uint32_t type, uint64_t slot)
+{
+    return &swap_cache_hash[(slot * SWAP_MAX_AREAS + type) % SWAP_CACHE_HASH];
+}
+
+/* Wait queue for readers of a slot's placeholder; sleepers prepare under swap_cache_lock. */
+static inline wait_queue_t *swap_cache_wait_queue(uint32_t type, uint64_t slot)
+{
+    return &swap_cache_waitq[(slot * SWAP_MAX_AREAS + type) % SWAP_CACHE_WAIT];
+}
+
+/* Find the cache entry for a slot (swap_cache_lock held). */
+static swap_cache_entry_t *swap_cache_lookup_locked(uint32_t type, uint64_t slot)
+{
+    for (swap_cache_entry_t *entry = *swap_cache_bucket(type, slot); entry; entry = entry->next)
+        if (entry->type == type && entry->slot == slot) return entry;
+    return NULL;
+}
+
+/* Unlink an entry from its bucket (swap_cache_lock held). */
+static void swap_cache_unhash_locked(swap_cache_entry_t *entry)
+{
+    swap_cache_entry_t **link = swap_cache_bucket(entry->type, entry->slot);
+    while (*link && *link != entry) link = &(*link)->next;
+    if (*link) *link = entry->next;
+    swap_cache_pages--;
+}
+
+/* Release an entry's frame and the entry itself; never called with a swap lock held. */
+static void swap_cache_free(swap_cache_entry_t *entry)
+{
+    if (!entry) return;
+    if (entry->frame) (void)frame_release_range(entry->frame, 1);
+    free(entry);
+}
+
+/*
+ * Detach the cached page of a slot whose last reference is gone (area
+ * lock held). A placeholder is only marked, as its reader still owns it.
+ */
+static swap_cache_entry_t *swap_cache_forget(uint32_t type, uint64_t slot)
+{
+    spin_lock(&swap_cache_lock);
+    swap_cache_entry_t *entry = swap_cache_lookup_locked(type, slot);
+    if (entry) {
+        swap_cache_unhash_locked(entry);
+        if (!entry->uptodate) {
+            entry->dropped = true;
+            entry          = NULL;
+        }
+    }
+    spin_unlock(&swap_cache_lock);
+    return entry;
+}
+
+/* Add a placeholder for a slot about to be read, if the slot is still referenced and not cached. */
+static bool swap_cache_insert(swap_area_t *area, uint64_t slot, swap_cache_entry_t *entry, uint64_t frame, bool readahead)
+{
+    bool inserted = false;
+    spin_lock(&area->lock);
+    spin_lock(&swap_cache_lock);
+    if (swap_slot_refs(&area->slots, slot) && !swap_cache_lookup_locked(area->type, slot)) {
+        swap_cache_entry_t **bucket = swap_cache_bucket(area->type, slot);
+        entry->slot                 = slot;
+        entry->frame                = frame;
+        entry->type                 = area->type;
+        entry->uptodate             = false;
+        entry->dropped              = false;
+        entry->readahead            = readahead;
+        entry->next                 = *bucket;
+        *bucket                     = entry;
+        swap_cache_pages++;
+        inserted = true;
+    }
+    spin_unlock(&swap_cache_lock);
+    spin_unlock(&area->lock);
+    return inserted;
+}
+
+/* Publish placeholders once their read finished and wake their waiters; failed or dropped ones are freed. */
+static void swap_cache_complete(swap_cache_entry_t **entries, size_t count, int result)
+{
+    spin_lock(&swap_cache_lock);
+    for (size_t i = 0; i < count; i++) {
+        swap_cache_entry_t *entry = entries[i];
+        wait_queue_wake_all(swap_cache_wait_queue(entry->type, entry->slot));
+        if (result == EOK && !entry->dropped) {
+            entry->uptodate = true;
+            entries[i]      = NULL;
+        } else if (!entry->dropped) {
+            swap_cache_unhash_locked(entry);
+        }
+    }
+    spin_unlock(&swap_cache_lock);
+    for (size_t i = 0; i < count; i++) swap_cache_free(entries[i]);
+}
+
+/* Take a reference on the cached page of a slot, sleeping through an in-flight read; 0 on a miss. */
+static uint64_t swap_cache_get(uint32_t type, uint64_t slot)
+{
+    spin_lock(&swap_cache_lock);
+    for (;;) {
+        swap_cache_entry_t *entry = swap_cache_lookup_locked(type, slot);
+        if (!entry) {
+            spin_unlock(&swap_cache_lock);
+            return 0;
+        }
+        if (entry->uptodate) {
+            uint64_t frame = entry->frame;
+            (void)frame_retain_range(frame, 1);
+            swap_cache_hits++;
+            if (entry->readahead) swap_readahead_hits++;
+            entry->readahead = false;
+            spin_unlock(&swap_cache_lock);
+            return frame;
+        }
+        wait_queue_prepare(swap_cache_wait_queue(type, slot));
+        spin_unlock(&swap_cache_lock);
+        wait_queue_sleep();
+        spin_lock(&swap_cache_lock);
+    }
+}
+
+/* Drop up to target cached pages that no PTE maps; their contents are still in swap. */
+static size_t swap_cache_shrink(size_t target)
+{
+    swap_cache_entry_t *victims = NULL;
+    size_t              dropped = 0;
+    spin_lock(&swap_cache_lock);
+    for (uint32_t scanned = 0; scanned < SWAP_CACHE_HASH && dropped < target && swap_cache_pages; scanned++) {
+        swap_cache_entry_t **link = &swap_cache_hash[swap_cache_hand];
+        swap_cache_hand           = (swap_cache_hand + 1) % SWAP_CACHE_HASH;
+        while (*link && dropped < target) {
+            swap_cache_entry_t *entry = *link;
+            if (!entry->uptodate || frame_refcount(entry->frame) != 1) {
+                link = &entry->next;
+                continue;
+            }
+            *link       = entry->next;
+            entry->next = victims;
+            victims     = entry;
+            swap_cache_pages--;
+            dropped++;
+        }
+    }
+    spin_unlock(&swap_cache_lock);
+    while (victims) {
+        swap_cache_entry_t *next = victims->next;
+        swap_cache_free(victims);
+        victims = next;
+    }
+    return dropped;
+}
+
+/* Retain or release the slot referenced by a swap entry, dropping its cached page with the last reference. */
 static int swap_area_retain_entry(uint64_t pte, int retain)
 {
     if (!swap_entry_is_swap(pte)) return -EINVAL;
     swap_area_t *area = swap_area_for_type(swap_entry_type(pte));
     if (!area) return -EINVAL;
+    uint64_t            slot   = swap_entry_offset(pte);
+    swap_cache_entry_t *cached = NULL;
     spin_lock(&area->lock);
-    int result = retain ? swap_slot_retain(&area->slots, swap_entry_offset(pte)) : swap_slot_release(&area->slots, swap_entry_offset(pte));
+    int result = retain ? swap_slot_retain(&area->slots, slot) : swap_slot_release(&area->slots, slot);
+    if (!retain && !result && !swap_slot_refs(&area->slots, slot)) {
+        cached = swap_cache_forget(area->type, slot);
+        if (area->backend == SWAP_BACKEND_ZRAM) zram_discard_page(area->zram, slot);
+    }
     spin_unlock(&area->lock);
+    swap_cache_free(cached);
     return result ? -EINVAL : EOK;
 }
 
@@ -257,6 +529,7 @@ void swap_init(void)
     memset(swap_areas, 0, sizeof(swap_areas));
     swap_lock.lock   = 0;
     swap_lock.rflags = 0;
+    for (uint32_t i = 0; i < SWAP_CACHE_WAIT; i++) wait_queue_init(&swap_cache_waitq[i]);
 #    endif
 }
 
@@ -277,14 +550,12 @@ static int swap_area_alloc(uint8_t *type, swap_area_t **area)
     return -EPERM;
 }
 
-/* Decode the swap header and allocate the area's slot tracking tables. */
-static int swap_area_setup_slots(swap_area_t *area, uint64_t pages, const uint8_t header[SWAP_PAGE_SIZE])
+/* Allocate the slot tracking tables for slots 1..slots. */
+static int swap_area_alloc_slots(swap_area_t *area, uint64_t slots)
 {
-    swap_header_info_t info;
-    if (swap_header_decode(header, SWAP_PAGE_SIZE, pages, &info)) return -EINVAL;
-    size_t words       = (size_t)((info.slots + 64) / 64);
+    size_t words       = (size_t)((slots + 64) / 64);
     area->slots.bitmap = calloc(words, sizeof(uint64_t));
-    area->slots.refs   = calloc((size_t)info.slots + 1, sizeof(uint32_t));
+    area->slots.refs   = calloc((size_t)slots + 1, sizeof(uint32_t));
     if (!area->slots.bitmap || !area->slots.refs) {
         free(area->slots.bitmap);
         free(area->slots.refs);
@@ -292,10 +563,18 @@ static int swap_area_setup_slots(swap_area_t *area, uint64_t pages, const uint8_
         area->slots.refs   = NULL;
         return -ENOMEM;
     }
-    if (swap_slot_map_init(&area->slots, area->slots.bitmap, area->slots.refs, info.slots)) return -ENOMEM;
+    if (swap_slot_map_init(&area->slots, area->slots.bitmap, area->slots.refs, slots)) return -ENOMEM;
     return EOK;
 }
 
+/* Decode the swap header and allocate the area's slot tracking tables. */
+static int swap_area_setup_slots(swap_area_t *area, uint64_t pages, const uint8_t header[SWAP_PAGE_SIZE])
+{
+    swap_header_info_t info;
+    if (swap_header_decode(header, SWAP_PAGE_SIZE, pages, &info)) return -EINVAL;
+    return swap_area_alloc_slots(area, info.slots);
+}
+
 /* Bring a swap file or partition online as a backing area. */
 int swap_activate_path(const char *path, uint32_t flags)
 {
@@ -323,8 +602,17 @@ int swap_activate_path(const char *path, uint32_t flags)
     area->lock.rflags = 0;
     strncpy(area->path, path, sizeof(area->path) - 1);
 
-    uint8_t header[SWAP_PAGE_SIZE];
-    if (!strncmp(path, "/dev/", 5) && blockdev_open_name(path, &area->device) == EOK) {
+    /* A zram device carries no swap header: page 0 stays unused so slots map straight onto its pages. */
+    uint8_t        header[SWAP_PAGE_SIZE];
+    zram_device_t *zram = zram_lookup_path(path);
+    if (zram) {
+        uint64_t pages;
+        result = zram_claim(zram, &pages);
+        if (!result && (result = swap_area_alloc_slots(area, pages - 1)) != 0) zram_unclaim(zram); // NOLINT(bugprone-assignment-in-if-condition)
+        if (result) goto fail;
+        area->backend = SWAP_BACKEND_ZRAM;
+        area->zram    = zram;
+    } else if (!strncmp(path, "/dev/", 5) && blockdev_open_name(path, &area->device) == EOK) {
         if (area->device.read_only || !area->device.sector_size || area->device.sector_count > UINT64_MAX / area->device.sector_size) {
             result = -EROFS;
             goto fail;
@@ -392,9 +680,96 @@ static page_table_entry_t *swap_pte_lookup(page_directory_t *directory, uintptr_
     return &table->entries[(address >> 12) & 0x1ff];
 }
 
-/* Page in the swapped-out frame at address and restore its PTE. */
-int swap_fault(page_directory_t *directory, uintptr_t address)
+/* Report whether the PTE at address is an idle swap entry for the given slot of area (directory lock held). */
+static bool swap_readahead_match(page_directory_t *directory, const swap_area_t *area, uintptr_t address, uint64_t slot)
+{
+    page_table_entry_t *pte   = swap_pte_lookup(directory, address);
+    uint64_t            value = pte ? __atomic_load_n(&pte->value, __ATOMIC_ACQUIRE) : 0;
+    return swap_entry_is_swap(value) && !(value & PTE_SWAP_BUSY) && swap_entry_type(value) == area->type && swap_entry_offset(value) == slot;
+}
+
+/*
+ * Read the slot behind a faulting entry into the swap cache, together with
+ * the neighbouring virtual pages whose slots continue it on disk, as one
+ * request. Returns the faulting page in *frame with a reference for the
+ * caller, or -EEXIST if another fault is already reading the slot.
+ */
+static int swap_read_around(page_directory_t *directory, swap_area_t *area, uintptr_t address, uint64_t entry, uint64_t *frame)
+{
+    uint64_t            slot                    = swap_entry_offset(entry);
+    uintptr_t           base                    = ALIGN_DOWN(address, SWAP_READAHEAD * SWAP_PAGE_SIZE);
+    size_t              index                   = (size_t)((address - base) / SWAP_PAGE_SIZE);
+    size_t              lo                      = index;
+    size_t              hi                      = index;
+    uint64_t            frames[SWAP_READAHEAD]  = {0};
+    swap_cache_entry_t *entries[SWAP_READAHEAD] = {0};
+    void               *buffers[SWAP_READAHEAD];
+
+    /*
+     * Clustered swap-out keeps neighbouring pages in neighbouring slots.  A
+     * zram read is a decompression, not a seek, so reading ahead there would
+     * only duplicate pages the pool already holds compressed.
+     */
+    if (area->backend != SWAP_BACKEND_ZRAM && __atomic_load_n(&swap_cache_pages, __ATOMIC_RELAXED) < SWAP_CACHE_MAX) {
+        spin_lock(&directory->lock);
+        while (hi + 1 < SWAP_READAHEAD && swap_readahead_match(directory, area, base + (hi + 1) * SWAP_PAGE_SIZE, slot + (hi + 1 - index))) hi++;
+        while (lo > 0 && slot > index - lo + 1 && swap_readahead_match(directory, area, base + (lo - 1) * SWAP_PAGE_SIZE, slot - (index - lo + 1))) lo--;
+        spin_unlock(&directory->lock);
+    }
+
+    for (size_t i = lo; i <= hi; i++) {
+        frames[i] = alloc_frames_noreclaim(1);
+        if (!frames[i] && i == index && frame_reclaim_pages(1) > 0) frames[i] = alloc_frames_noreclaim(1);
+        if (frames[i]) entries[i] = malloc(sizeof(swap_cache_entry_t));
+    }
+
+    int result = -ENOMEM;
+    if (frames[index] && entries[index]) result = swap_cache_insert(area, slot, entries[index], frames[index], false) ? EOK : -EEXIST;
+    if (result == EOK) {
+        /* Speculative neighbours stop at the first page that cannot be cached. */
+        for (size_t i = index + 1; i <= hi; i++) {
+            if (frames[i] && entries[i] && swap_cache_insert(area, slot + (i - index), entries[i], frames[i], true)) continue;
+            hi = i - 1;
+            break;
+        }
+        for (size_t i = index; i > lo; i--) {
+            if (frames[i - 1] && entries[i - 1] && swap_cache_insert(area, slot - (index - i + 1), entries[i - 1], frames[i - 1], true)) continue;
+            lo = i;
+            break;
+        }
+
+        for (size_t i = lo; i <= hi; i++) buffers[i] = phys_to_virt(frames[i]);
+        result = swap_area_io_run(area, slot - (index - lo), &buffers[lo], hi - lo + 1, 0);
+        if (result == EOK) {
+            (void)frame_retain_range(frames[index], 1);
+            *frame = frames[index];
+            __atomic_add_fetch(&area->pages_in, hi - lo + 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&swap_readahead_pages, hi - lo, __ATOMIC_RELAXED);
+        }
+        swap_cache_complete(&entries[lo], hi - lo + 1, result);
+    } else {
+        hi = index;
+        lo = index + 1;
+    }
+
+    /* Release whatever never made it into the cache. */
+    for (size_t i = 0; i < SWAP_READAHEAD; i++) {
+        if (i >= lo && i <= hi) continue;
+        if (frames[i]) (void)frame_release_range(frames[i], 1);
+        free(entries[i]);
+    }
+    return result;
+}
+
+/*
+ * Page in the swapped-out frame at address and restore its PTE. The page
+ * comes from the swap cache when another mapping or readahead already
+ * brought it in; while other PTEs still share the slot, a private writable
+ * page is mapped copy-on-write.
+ */
+int swap_fault(process_t *proc, uintptr_t address)
 {
+    page_directory_t *directory = proc ? proc->user_page_dir : NULL;
     if (!directory) return -EINVAL;
     address = ALIGN_DOWN(address, SWAP_PAGE_SIZE);
 
@@ -415,12 +790,20 @@ int swap_fault(page_directory_t *directory, uintptr_t address)
     __atomic_store_n(&pte->value, entry | PTE_SWAP_BUSY, __ATOMIC_RELEASE);
     flush_tlb(address);
     spin_unlock(&directory->lock);
-    flush_tlb_all();
-
-    swap_area_t *area  = swap_area_for_type(swap_entry_type(entry));
-    uint64_t     frame = area ? alloc_frames_noreclaim(1) : 0;
-    if (area && !frame && frame_reclaim_pages(1) > 0) frame = alloc_frames_noreclaim(1);
-    int result = (!frame || !area) ? -ENOMEM : swap_area_io(area, swap_entry_offset(entry), phys_to_virt(frame), 0);
+    flush_tlb_mm_range(directory, address, address + SWAP_PAGE_SIZE);
+
+    swap_area_t *area   = swap_area_for_type(swap_entry_type(entry));
+    uint64_t     frame  = 0;
+    int          result = -ENOMEM;
+    while (area) {
+        frame = swap_cache_get(area->type, swap_entry_offset(entry));
+        if (frame) {
+            result = EOK;
+            break;
+        }
+        result = swap_read_around(directory, area, address, entry, &frame);
+        if (result != -EEXIST) break;
+    }
 
     spin_lock(&directory->lock);
     pte = swap_pte_lookup(directory, address);
@@ -430,11 +813,12 @@ int swap_fault(page_directory_t *directory, uintptr_t address)
         return -EAGAIN;
     }
     if (result == EOK) {
+        /* Dropping the last slot reference also drops the cache's frame reference. */
+        (void)swap_entry_release_pte(entry);
         uint64_t flags = swap_entry_pte_flags(entry) | PTE_PRESENT;
+        if ((flags & PTE_WRITEABLE) && !(flags & PTE_SHARED) && frame_refcount(frame) > 1) flags = (flags & ~PTE_WRITEABLE) | PTE_COW;
         __atomic_store_n(&pte->value, frame | flags, __ATOMIC_RELEASE);
         flush_tlb(address);
-        (void)swap_entry_release_pte(entry);
-        area->pages_in++;
     } else {
         if (result != -ENOMEM) plogk("swap: Swap-in failed type=%u slot=%llu addr=0x%016llx err=%d\n", swap_entry_type(entry), swap_entry_offset(entry), (uint64_t)address, result);
         __atomic_store_n(&pte->value, entry, __ATOMIC_RELEASE);
@@ -442,7 +826,8 @@ int swap_fault(page_directory_t *directory, uintptr_t address)
         if (frame) (void)frame_release_range(frame, 1);
     }
     spin_unlock(&directory->lock);
-    flush_tlb_all();
+    flush_tlb_mm_range(directory, address, address + SWAP_PAGE_SIZE);
+    if (result == EOK) rmap_add_anon(frame, proc, address);
     return result;
 }
 
@@ -451,12 +836,12 @@ static void swap_release_slot(swap_area_t *area, uint64_t slot)
 {
     if (!area || !slot) return;
     spin_lock(&area->lock);
-    (void)swap_slot_release(&area->slots, slot);
+    if (!swap_slot_release(&area->slots, slot) && area->backend == SWAP_BACKEND_ZRAM && !swap_slot_refs(&area->slots, slot)) zram_discard_page(area->zram, slot);
     spin_unlock(&area->lock);
 }
 
-/* Page out one user frame, giving recently accessed pages a second chance. */
-static int swap_out_page(page_directory_t *directory, uintptr_t address, bool force)
+/* Reserve up to want consecutive slots on the highest-priority area. */
+static swap_area_t *swap_alloc_slots(size_t want, uint64_t *slot, uint64_t *count)
 {
     swap_area_t *best = NULL;
     spin_lock(&swap_lock);
@@ -465,55 +850,67 @@ static int swap_out_page(page_directory_t *directory, uintptr_t address, bool fo
         if (!area->active || area->draining) continue;
         if (!best || area->priority > best->priority) best = area;
     }
-    uint64_t slot = 0;
+    *slot = 0;
     if (best) {
         spin_lock(&best->lock);
-        slot = swap_slot_alloc(&best->slots);
+        *slot = swap_slot_alloc_run(&best->slots, want, count);
         spin_unlock(&best->lock);
     }
     spin_unlock(&swap_lock);
-    if (!slot) return -ENOSPC;
+    return *slot ? best : NULL;
+}
 
+/* One page queued for clustered swap-out, with the rmap scan that chose it. */
+typedef struct swap_out_item {
+        rmap_scan_t scan;
+        uint32_t    owner;      // index of the single live mapping in scan
+        uint32_t    stale_mask; // scan mappings found stale
+        uint64_t    slot;
+        uint64_t    value; // PTE before swap-out, restored if the write fails
+        uint64_t    entry; // busy swap entry installed during the write
+        int         result;
+} swap_out_item_t;
+
+/* Replace the item's PTE with a busy swap entry, provided it still privately maps the scanned frame. */
+static int swap_out_prepare(page_directory_t *directory, swap_area_t *area, swap_out_item_t *item)
+{
+    uintptr_t address = item->scan.address[item->owner];
     spin_lock(&directory->lock);
     page_table_entry_t *pte   = swap_pte_lookup(directory, address);
     uint64_t            value = pte ? __atomic_load_n(&pte->value, __ATOMIC_ACQUIRE) : 0;
-    if (!pte || !(value & PTE_PRESENT) || !(value & PTE_USER) || (value & (PTE_SHARED | PTE_HUGE)) || frame_refcount(value & PAGE_4K_MASK) != 1) {
-        spin_unlock(&directory->lock);
-        swap_release_slot(best, slot);
-        return -EAGAIN;
-    }
-    if (!force && (value & PTE_ACCESSED)) {
-        __atomic_store_n(&pte->value, value & ~PTE_ACCESSED, __ATOMIC_RELEASE);
-        flush_tlb(address);
+    if (!pte || !(value & PTE_PRESENT) || !(value & PTE_USER) || (value & (PTE_SHARED | PTE_HUGE)) || (value & PAGE_4K_MASK) != item->scan.frame
+        || frame_refcount(value & PAGE_4K_MASK) != 1) {
         spin_unlock(&directory->lock);
-        flush_tlb_all();
-        swap_release_slot(best, slot);
         return -EAGAIN;
     }
-
-    uint64_t entry = swap_entry_encode(best->type, slot, value & ~PAGE_4K_MASK) | PTE_SWAP_BUSY;
-    __atomic_store_n(&pte->value, entry, __ATOMIC_RELEASE);
+    item->value = value;
+    item->entry = swap_entry_encode(area->type, item->slot, value & ~PAGE_4K_MASK) | PTE_SWAP_BUSY;
+    __atomic_store_n(&pte->value, item->entry, __ATOMIC_RELEASE);
     flush_tlb(address);
     spin_unlock(&directory->lock);
 
     /* No CPU may keep writing the frame while it is copied to swap. */
-    flush_tlb_all();
-
-    int result = swap_area_io(best, slot, phys_to_virt(value & PAGE_4K_MASK), 1);
+    flush_tlb_mm_range(directory, address, address + SWAP_PAGE_SIZE);
+    return EOK;
+}
 
-    bool release_frame = false;
-    bool release_slot  = false;
+/* Publish or roll back a prepared swap-out after its write. */
+static int swap_out_finish(page_directory_t *directory, swap_area_t *area, swap_out_item_t *item, int result)
+{
+    uintptr_t address       = item->scan.address[item->owner];
+    bool      release_frame = false;
+    bool      release_slot  = false;
     spin_lock(&directory->lock);
-    pte = swap_pte_lookup(directory, address);
-    if (pte && __atomic_load_n(&pte->value, __ATOMIC_ACQUIRE) == entry) {
+    page_table_entry_t *pte = swap_pte_lookup(directory, address);
+    if (pte && __atomic_load_n(&pte->value, __ATOMIC_ACQUIRE) == item->entry) {
         if (result == EOK) {
-            __atomic_add_fetch(&best->pages_out, 1, __ATOMIC_RELAXED);
-            __atomic_store_n(&pte->value, entry & ~PTE_SWAP_BUSY, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&area->pages_out, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&pte->value, item->entry & ~PTE_SWAP_BUSY, __ATOMIC_RELEASE);
             flush_tlb(address);
             release_frame = true;
         } else {
-            plogk("swap: Swap-out failed type=%u slot=%llu addr=0x%016llx err=%d\n", best->type, slot, (uint64_t)address, result);
-            __atomic_store_n(&pte->value, value, __ATOMIC_RELEASE);
+            plogk("swap: Swap-out failed type=%u slot=%llu addr=0x%016llx err=%d\n", area->type, item->slot, (uint64_t)address, result);
+            __atomic_store_n(&pte->value, item->value, __ATOMIC_RELEASE);
             flush_tlb(address);
             release_slot = true;
         }
@@ -523,49 +920,185 @@ static int swap_out_page(page_directory_t *directory, uintptr_t address, bool fo
     }
     spin_unlock(&directory->lock);
 
-    if (release_frame) {
-        flush_tlb_all();
-        (void)frame_release_range(value & PAGE_4K_MASK, 1);
+    flush_tlb_mm_range(directory, address, address + SWAP_PAGE_SIZE);
+    if (release_frame) (void)frame_release_range(item->value & PAGE_4K_MASK, 1);
+    if (release_slot) swap_release_slot(area, item->slot);
+    return result;
+}
+
+/*
+ * Swap out items that all belong to one process, under its mmap lock.
+ * They are sorted by address, so neighbouring virtual pages get
+ * consecutive slots and each run of them is written as one request.
+ */
+static size_t swap_out_process(swap_out_item_t *items, size_t count)
+{
+    size_t     freed = 0;
+    process_t *proc  = process_find_get((pid_t)items[0].scan.pid[items[0].owner]);
+    for (size_t i = 0; i < count; i++) items[i].result = proc ? -ENOSPC : -ESRCH;
+    if (!proc) return 0;
+
+    spin_lock(&proc->mmap_lock);
+    page_directory_t *directory = proc->user_page_dir;
+    for (size_t done = 0; directory && done < count;) {
+        uint64_t     slot;
+        uint64_t     got;
+        swap_area_t *area = swap_alloc_slots(count - done, &slot, &got);
+        if (!area) break;
+
+        swap_out_item_t *run = &items[done];
+        for (size_t i = 0; i < got; i++) {
+            run[i].slot   = slot + i;
+            run[i].result = swap_out_prepare(directory, area, &run[i]);
+            if (run[i].result != EOK) swap_release_slot(area, run[i].slot);
+        }
+        for (size_t i = 0; i < got;) {
+            if (run[i].result != EOK) {
+                i++;
+                continue;
+            }
+            void  *buffers[SWAP_WRITE_BATCH];
+            size_t end = i;
+            while (end < got && run[end].result == EOK) {
+                buffers[end - i] = phys_to_virt(run[end].value & PAGE_4K_MASK);
+                end++;
+            }
+            int result = swap_area_io_run(area, slot + i, buffers, end - i, 1);
+            for (; i < end; i++) {
+                run[i].result = swap_out_finish(directory, area, &run[i], result);
+                if (run[i].result == EOK) freed++;
+            }
+        }
+        done += got;
     }
-    if (release_slot) {
-        flush_tlb_all();
-        swap_release_slot(best, slot);
+    spin_unlock(&proc->mmap_lock);
+    process_put(proc);
+    return freed;
+}
+
+/* Write out a batch of queued pages and return their scans to the LRU. */
+static size_t swap_out_batch(swap_out_item_t *items, size_t count)
+{
+    /* Group by process, then order by address; the batch is small enough for insertion sort. */
+    for (size_t i = 1; i < count; i++) {
+        swap_out_item_t item = items[i];
+        int64_t         pid  = item.scan.pid[item.owner];
+        uintptr_t       va   = item.scan.address[item.owner];
+        size_t          j    = i;
+        for (; j > 0; j--) {
+            int64_t   prev_pid = items[j - 1].scan.pid[items[j - 1].owner];
+            uintptr_t prev_va  = items[j - 1].scan.address[items[j - 1].owner];
+            if (prev_pid < pid || (prev_pid == pid && prev_va < va)) break;
+            items[j] = items[j - 1];
+        }
+        items[j] = item;
     }
-    return result;
+
+    size_t freed = 0;
+    for (size_t first = 0; first < count;) {
+        size_t  last = first + 1;
+        int64_t pid  = items[first].scan.pid[items[first].owner];
+        while (last < count && items[last].scan.pid[items[last].owner] == pid) last++;
+        freed += swap_out_process(&items[first], last - first);
+        first = last;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (items[i].result == EOK)
+            rmap_putback(&items[i].scan, RMAP_LRU_FORGET, items[i].stale_mask | (1U << items[i].owner));
+        else
+            rmap_putback(&items[i].scan, RMAP_LRU_INACTIVE, items[i].stale_mask);
+    }
+    return freed;
 }
 
-/* One bounded anonymous-page scan. */
-static size_t swap_reclaim_pass(size_t target, bool force)
+/*
+ * Test and clear the accessed bit of one rmap mapping. Returns 1 if the
+ * page was referenced, 0 if not, or -ESRCH once the process or the mapping
+ * is gone.
+ */
+static int swap_mapping_referenced(pid_t pid, uintptr_t address, uint64_t frame)
 {
-    size_t     reclaimed = 0;
-    size_t     scanned   = 0;
-    size_t     budget    = target > SIZE_MAX / 32 ? SIZE_MAX : target * 32;
-    size_t     cursor    = 0;
-    process_t *proc;
-    if (budget < 256) budget = 256;
-    while (reclaimed < target && scanned < budget && (proc = process_iterate_get(&cursor)) != NULL) {
-        if (proc->user_page_dir) {
-            spin_lock(&proc->mmap_lock);
-            for (vm_area_t *vma = proc->mmap_list; vma && reclaimed < target && scanned < budget; vma = vma->next) {
-                if (vma->vm_file || (vma->flags & VM_SHARED)) continue;
-                for (uintptr_t va = vma->start; va < vma->end && reclaimed < target && scanned < budget; va += SWAP_PAGE_SIZE) {
-                    scanned++;
-                    if (swap_out_page(proc->user_page_dir, va, force) == EOK) reclaimed++;
-                }
+    process_t *proc = process_find_get(pid);
+    if (!proc) return -ESRCH;
+    page_directory_t *directory = proc->user_page_dir;
+    int               result    = -ESRCH;
+    if (directory) {
+        spin_lock(&directory->lock);
+        page_table_entry_t *pte   = swap_pte_lookup(directory, address);
+        uint64_t            value = pte ? __atomic_load_n(&pte->value, __ATOMIC_ACQUIRE) : 0;
+        if ((value & PTE_PRESENT) && (value & PAGE_4K_MASK) == frame) {
+            result = (value & PTE_ACCESSED) != 0;
+            if (result) {
+                __atomic_and_fetch(&pte->value, ~PTE_ACCESSED, __ATOMIC_ACQ_REL);
+                flush_tlb(address);
             }
-            spin_unlock(&proc->mmap_lock);
         }
-        process_put(proc);
+        spin_unlock(&directory->lock);
+        if (result == 1) flush_tlb_mm_range(directory, address, address + SWAP_PAGE_SIZE);
     }
-    return reclaimed;
+    process_put(proc);
+    return result;
 }
 
-/* Reclaim up to target pages; the first pass preserves recently used pages. */
-int swap_reclaim(size_t target)
+/*
+ * Reclaim up to target pages. Unmapped swap-cache pages go first, as they
+ * cost no I/O. Anonymous pages are then aged on the rmap LRU lists: the
+ * active list is trimmed whenever it outgrows the inactive one, pages
+ * referenced since the last scan are promoted, and unreferenced inactive
+ * pages with a single owner are queued and written out in clusters. Pages
+ * still shared after a fork stay resident.
+ */
+int swap_reclaim(size_t target, size_t *scanned)
 {
-    if (!target) return 0;
-    size_t reclaimed = swap_reclaim_pass(target, false);
-    if (reclaimed < target) reclaimed += swap_reclaim_pass(target - reclaimed, true);
+    swap_out_item_t batch[SWAP_WRITE_BATCH];
+    size_t          queued    = 0;
+    size_t          examined  = 0;
+    size_t          reclaimed = target ? swap_cache_shrink(target) : 0;
+    size_t          budget    = target > SIZE_MAX / 32 ? SIZE_MAX : target * 32;
+    if (budget < 256) budget = 256;
+
+    while (reclaimed + queued < target && examined < budget) {
+        rmap_stats_t lists;
+        rmap_scan_t  scan;
+        rmap_get_stats(&lists);
+        bool active = lists.active > lists.inactive;
+        if (!rmap_isolate(active, &scan) && !rmap_isolate(!active, &scan)) break;
+        examined++;
+
+        uint32_t stale_mask = 0;
+        uint32_t live       = 0;
+        uint32_t owner      = 0;
+        bool     referenced = false;
+        for (uint32_t i = 0; i < scan.count; i++) {
+            int result = swap_mapping_referenced((pid_t)scan.pid[i], scan.address[i], scan.frame);
+            if (result < 0) {
+                stale_mask |= 1U << i;
+                continue;
+            }
+            if (result) referenced = true;
+            owner = i;
+            live++;
+        }
+
+        if (live == 1 && !referenced && !active) {
+            batch[queued].scan       = scan;
+            batch[queued].owner      = owner;
+            batch[queued].stale_mask = stale_mask;
+            if (++queued == SWAP_WRITE_BATCH) {
+                reclaimed += swap_out_batch(batch, queued);
+                queued = 0;
+            }
+            continue;
+        }
+        int lru = RMAP_LRU_INACTIVE;
+        if (!live)
+            lru = RMAP_LRU_FORGET;
+        else if (referenced)
+            lru = RMAP_LRU_ACTIVE;
+        rmap_putback(&scan, lru, stale_mask);
+    }
+    if (queued) reclaimed += swap_out_batch(batch, queued);
+    if (scanned) *scanned = examined;
     return (int)reclaimed;
 }
 
@@ -586,7 +1119,7 @@ bool swap_has_free_space(void)
 }
 
 /* Page in every frame of type held by one address-space subtree. */
-static int swapoff_area_in(page_directory_t *directory, page_table_t *table, int level, uintptr_t base, uint32_t type)
+static int swapoff_area_in(process_t *proc, page_table_t *table, int level, uintptr_t base, uint32_t type)
 {
     uint64_t shift = level == 4 ? 39 : (level == 3 ? 30 : (level == 2 ? 21 : 12));
     for (uint32_t i = 0; i < 512; i++) {
@@ -594,12 +1127,12 @@ static int swapoff_area_in(page_directory_t *directory, page_table_t *table, int
         uintptr_t address = base | ((uintptr_t)i << shift);
         if (level == 1) {
             if (swap_entry_is_swap(value) && swap_entry_type(value) == type) {
-                int result = swap_fault(directory, address);
+                int result = swap_fault(proc, address);
                 if (result) return result;
             }
         } else if (value & PTE_PRESENT) {
             if (value & PTE_HUGE) continue;
-            int result = swapoff_area_in(directory, phys_to_virt(value & PAGE_4K_MASK), level - 1, address, type);
+            int result = swapoff_area_in(proc, phys_to_virt(value & PAGE_4K_MASK), level - 1, address, type);
             if (result) return result;
         }
     }
@@ -626,7 +1159,7 @@ int swap_deactivate_path(const char *path)
     process_t *proc;
     int        result = EOK;
     while ((proc = process_iterate_get(&cursor)) != NULL) {
-        if (proc->user_page_dir) result = swapoff_area_in(proc->user_page_dir, proc->user_page_dir->table, 4, 0, area->type);
+        if (proc->user_page_dir) result = swapoff_area_in(proc, proc->user_page_dir->table, 4, 0, area->type);
         process_put(proc);
         if (result) break;
     }
@@ -647,6 +1180,8 @@ int swap_deactivate_path(const char *path)
     if (area->backend == SWAP_BACKEND_FILE) {
         area->file->flags &= ~VFS_NODE_SWAPFILE;
         vfs_close(area->file);
+    } else if (area->backend == SWAP_BACKEND_ZRAM) {
+        zram_unclaim(area->zram);
     } else {
         blockdev_release(&area->device);
     }
@@ -675,6 +1210,13 @@ void swap_get_stats(swap_stats_t *stats)
     }
     spin_unlock(&swap_lock);
     stats->free_pages = stats->total_pages - stats->used_pages;
+
+    spin_lock(&swap_cache_lock);
+    stats->cache_pages    = swap_cache_pages;
+    stats->cache_hits     = swap_cache_hits;
+    stats->readahead      = swap_readahead_pages;
+    stats->readahead_hits = swap_readahead_hits;
+    spin_unlock(&swap_cache_lock);
 }
 
 /* Emit the /proc/swaps header plus one line per active swap area. */
@@ -691,7 +1233,7 @@ int swap_format_proc_swaps(char *buf, size_t cap)
         spin_lock(&area->lock);
         uint64_t used = area->slots.slots - area->slots.free_slots;
         spin_unlock(&area->lock);
-        int n = snprintf(buf + off, cap - off, "%s\t\t\t\t%s\t\t%llu\t%llu\t%d\n", area->path, area->backend == SWAP_BACKEND_BLOCK ? "partition" : "file", (unsigned long long)area->slots.slots,
+        int n = snprintf(buf + off, cap - off, "%s\t\t\t\t%s\t\t%llu\t%llu\t%d\n", area->path, area->backend == SWAP_BACKEND_FILE ? "file" : "partition", (unsigned long long)area->slots.slots,
                          (unsigned long long)used, area->priority);
         if (n <= 0 || off + (size_t)n >= cap) break;
         off += (size_t)n;
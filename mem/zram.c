@@ -0,0 +1,376 @@
+/*
+ *
+ *      zram.c
+ *      Compressed in-memory swap store
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <kernel/errno.h>
+#include <kernel/printk.h>
+#include <libs/std/stdlib.h>
+#include <libs/std/string.h>
+#include <libs/util/lz4.h>
+#include <mem/frame.h>
+#include <mem/heap.h>
+#include <mem/hhdm.h>
+#include <mem/page.h>
+#include <mem/zram.h>
+#include <sync/spin_lock.h>
+
+/*
+ * Pool layout
+ * Compressed pages live in a size-class pool: every pool frame serves a
+ * single class, starts with a zram_zpage_t header and is carved into
+ * equal objects threaded on an in-page free list.  A payload that would
+ * sit alone in a frame is stored uncompressed instead, and a page made
+ * of one repeated word keeps only that word.
+ */
+#define ZRAM_CLASS_SIZE   32U   // size-class granularity
+#define ZRAM_ZPAGE_HEADER 32U   // pool frame header ahead of the objects
+#define ZRAM_HUGE_SIZE    2016U // largest class that still fits twice in a pool frame
+#define ZRAM_CLASSES      (ZRAM_HUGE_SIZE / ZRAM_CLASS_SIZE)
+
+#define ZRAM_SLOT_SAME 0x1 // handle holds the fill word
+#define ZRAM_SLOT_HUGE 0x2 // handle is a frame holding the page uncompressed
+
+typedef struct zram_zpage {
+        struct zram_zpage *next;
+        struct zram_zpage *prev;
+        uint16_t           size_class;
+        uint16_t           used;
+        uint16_t           free_head; // offset of the first free object, 0 when full
+} zram_zpage_t;
+
+typedef struct zram_slot {
+        uint64_t handle; // object address, huge frame or fill word
+        uint16_t size;   // payload bytes; 0 for same-filled and empty slots
+        uint8_t  flags;
+} zram_slot_t;
+
+struct zram_device {
+        char          name[8];
+        spinlock_t    lock;
+        bool          claimed;
+        uint64_t      disksize;
+        uint64_t      pages;
+        zram_slot_t  *table;
+        zram_zpage_t *partial[ZRAM_CLASSES]; // pool frames with a free object
+        uint64_t      pool_frames;
+        uint64_t      pool_frames_max;
+        uint64_t      compr_bytes;
+        uint64_t      stored;
+        uint64_t      same;
+        uint64_t      huge;
+        uint64_t      reads;
+        uint64_t      writes;
+        uint64_t      failed_reads;
+        uint64_t      failed_writes;
+};
+
+static zram_device_t zram_devices[ZRAM_DEVICES];
+
+/* Set up the zram devices; disk sizes default to half of RAM until configured. */
+void zram_init(void)
+{
+#if CONFIG_ZRAM
+    frame_stats_t stats;
+    frame_get_stats(&stats);
+    for (uint32_t i = 0; i < ZRAM_DEVICES; i++) {
+        zram_device_t *zram = &zram_devices[i];
+        memset(zram, 0, sizeof(*zram));
+        snprintf(zram->name, sizeof(zram->name), ZRAM_NAME "%u", i);
+        zram->disksize = (uint64_t)stats.total_frames / 2 * PAGE_4K_SIZE;
+    }
+#endif
+}
+
+/* Return device id, or NULL past the last one. */
+zram_device_t *zram_get_device(uint32_t id)
+{
+    return CONFIG_ZRAM && id < ZRAM_DEVICES ? &zram_devices[id] : NULL;
+}
+
+/* Resolve a /dev/zramN path to its device. */
+zram_device_t *zram_lookup_path(const char *path)
+{
+    if (!CONFIG_ZRAM || !path || strncmp(path, "/dev/", 5)) return NULL;
+    for (uint32_t i = 0; i < ZRAM_DEVICES; i++)
+        if (!strcmp(path + 5, zram_devices[i].name)) return &zram_devices[i];
+    return NULL;
+}
+
+/* Return the device's name, e.g. "zram0". */
+const char *zram_device_name(const zram_device_t *zram)
+{
+    return zram ? zram->name : NULL;
+}
+
+/* Change the disk size in bytes; fails with -EBUSY while the device is in use. */
+int zram_set_disksize(zram_device_t *zram, uint64_t bytes)
+{
+    if (!zram) return -EINVAL;
+    spin_lock(&zram->lock);
+    if (zram->claimed) {
+        spin_unlock(&zram->lock);
+        return -EBUSY;
+    }
+    zram->disksize = bytes & ~(PAGE_4K_SIZE - 1);
+    spin_unlock(&zram->lock);
+    return EOK;
+}
+
+/* Take an object from a class, carving a fresh pool frame if none has room (lock held). */
+static uint8_t *zram_pool_alloc_locked(zram_device_t *zram, uint32_t size_class)
+{
+    zram_zpage_t *zpage = zram->partial[size_class];
+    if (!zpage) {
+        uint64_t frame = alloc_frames_noreclaim(1);
+        if (!frame) return NULL;
+        uint32_t object   = (size_class + 1) * ZRAM_CLASS_SIZE;
+        zpage             = phys_to_virt(frame);
+        zpage->size_class = (uint16_t)size_class;
+        zpage->used       = 0;
+        zpage->free_head  = ZRAM_ZPAGE_HEADER;
+        for (uint32_t offset = ZRAM_ZPAGE_HEADER; offset + object <= PAGE_4K_SIZE; offset += object)
+            *(uint16_t *)((uint8_t *)zpage + offset) = offset + 2 * object <= PAGE_4K_SIZE ? (uint16_t)(offset + object) : 0;
+        zpage->prev               = NULL;
+        zpage->next               = NULL;
+        zram->partial[size_class] = zpage;
+        if (++zram->pool_frames > zram->pool_frames_max) zram->pool_frames_max = zram->pool_frames;
+    }
+
+    uint8_t *object  = (uint8_t *)zpage + zpage->free_head;
+    zpage->free_head = *(uint16_t *)object;
+    zpage->used++;
+    if (!zpage->free_head) {
+        zram->partial[size_class] = zpage->next;
+        if (zpage->next) zpage->next->prev = NULL;
+        zpage->next = NULL;
+    }
+    return object;
+}
+
+/* Return an object to its frame, releasing the frame once it is empty (lock held). */
+static void zram_pool_free_locked(zram_device_t *zram, uint8_t *object)
+{
+    zram_zpage_t *zpage = (zram_zpage_t *)((uintptr_t)object & ~(PAGE_4K_SIZE - 1));
+    bool          full  = !zpage->free_head;
+    *(uint16_t *)object = zpage->free_head;
+    zpage->free_head    = (uint16_t)(object - (uint8_t *)zpage);
+    zpage->used--;
+
+    if (full) {
+        zpage->prev = NULL;
+        zpage->next = zram->partial[zpage->size_class];
+        if (zpage->next) zpage->next->prev = zpage;
+        zram->partial[zpage->size_class] = zpage;
+    }
+    if (zpage->used) return;
+    if (zpage->prev)
+        zpage->prev->next = zpage->next;
+    else
+        zram->partial[zpage->size_class] = zpage->next;
+    if (zpage->next) zpage->next->prev = zpage->prev;
+    (void)frame_release_range((uint64_t)virt_to_phys((uint64_t)zpage), 1);
+    zram->pool_frames--;
+}
+
+/* Empty a slot and undo its accounting (lock held). */
+static void zram_slot_free_locked(zram_device_t *zram, uint64_t index)
+{
+    zram_slot_t *slot = &zram->table[index];
+    if (!slot->flags && !slot->size) return;
+    if (slot->flags & ZRAM_SLOT_SAME) {
+        zram->same--;
+    } else if (slot->flags & ZRAM_SLOT_HUGE) {
+        (void)frame_release_range(slot->handle, 1);
+        zram->pool_frames--;
+        zram->huge--;
+    } else {
+        zram_pool_free_locked(zram, (uint8_t *)slot->handle);
+    }
+    zram->compr_bytes -= slot->size;
+    zram->stored--;
+    memset(slot, 0, sizeof(*slot));
+}
+
+/* Take exclusive use of a device and allocate its slot table; returns the page count. */
+int zram_claim(zram_device_t *zram, uint64_t *pages)
+{
+    if (!zram || !pages) return -EINVAL;
+    spin_lock(&zram->lock);
+    uint64_t count   = zram->disksize / PAGE_4K_SIZE;
+    bool     claimed = zram->claimed;
+    spin_unlock(&zram->lock);
+    if (claimed) return -EBUSY;
+    if (count < 2) return -EINVAL;
+
+    zram_slot_t *table = calloc((size_t)count, sizeof(zram_slot_t));
+    if (!table) return -ENOMEM;
+    spin_lock(&zram->lock);
+    if (zram->claimed || zram->disksize / PAGE_4K_SIZE != count) {
+        spin_unlock(&zram->lock);
+        free(table);
+        return -EBUSY;
+    }
+    zram->table   = table;
+    zram->pages   = count;
+    zram->claimed = true;
+    spin_unlock(&zram->lock);
+    *pages = count;
+    return EOK;
+}
+
+/* Free every stored page and release a claimed device. */
+void zram_unclaim(zram_device_t *zram)
+{
+    if (!zram) return;
+    spin_lock(&zram->lock);
+    zram_slot_t *table = zram->table;
+    if (!zram->claimed) {
+        spin_unlock(&zram->lock);
+        return;
+    }
+    for (uint64_t index = 0; index < zram->pages; index++) zram_slot_free_locked(zram, index);
+    zram->table   = NULL;
+    zram->pages   = 0;
+    zram->claimed = false;
+    spin_unlock(&zram->lock);
+    free(table);
+}
+
+/* Check whether a page is one 64-bit word repeated. */
+static bool zram_page_same_filled(const void *page, uint64_t *word)
+{
+    const uint64_t *words = page;
+    for (size_t i = 1; i < PAGE_4K_SIZE / sizeof(uint64_t); i++)
+        if (words[i] != words[0]) return false;
+    *word = words[0];
+    return true;
+}
+
+/* Compress and store one 4 KiB page at index, replacing what was there. */
+int zram_write_page(zram_device_t *zram, uint64_t index, const void *page)
+{
+    uint8_t     buffer[ZRAM_HUGE_SIZE];
+    zram_slot_t slot = {0};
+    if (!zram || !page) return -EINVAL;
+
+    /* Compress before taking the lock; only the pool copy happens under it. */
+    if (zram_page_same_filled(page, &slot.handle)) {
+        slot.flags = ZRAM_SLOT_SAME;
+    } else {
+        slot.size = (uint16_t)lz4_compress(page, PAGE_4K_SIZE, buffer, sizeof(buffer));
+        if (!slot.size) {
+            slot.handle = alloc_frames_noreclaim(1);
+            if (!slot.handle) goto fail;
+            memcpy(phys_to_virt(slot.handle), page, PAGE_4K_SIZE);
+            slot.size  = PAGE_4K_SIZE;
+            slot.flags = ZRAM_SLOT_HUGE;
+        }
+    }
+
+    spin_lock(&zram->lock);
+    if (!zram->claimed || index >= zram->pages) {
+        spin_unlock(&zram->lock);
+        if (slot.flags & ZRAM_SLOT_HUGE) (void)frame_release_range(slot.handle, 1);
+        return -EINVAL;
+    }
+    if (!slot.flags) {
+        uint8_t *object = zram_pool_alloc_locked(zram, (slot.size - 1) / ZRAM_CLASS_SIZE);
+        if (!object) {
+            spin_unlock(&zram->lock);
+            goto fail;
+        }
+        memcpy(object, buffer, slot.size);
+        slot.handle = (uint64_t)object;
+    } else if (slot.flags & ZRAM_SLOT_HUGE) {
+        if (++zram->pool_frames > zram->pool_frames_max) zram->pool_frames_max = zram->pool_frames;
+        zram->huge++;
+    } else {
+        zram->same++;
+    }
+    zram_slot_free_locked(zram, index);
+    zram->table[index] = slot;
+    zram->compr_bytes += slot.size;
+    zram->stored++;
+    zram->writes++;
+    spin_unlock(&zram->lock);
+    return EOK;
+fail:
+    spin_lock(&zram->lock);
+    zram->failed_writes++;
+    spin_unlock(&zram->lock);
+    return -ENOMEM;
+}
+
+/* Decompress the page at index into a 4 KiB buffer; an empty index reads as zeros. */
+int zram_read_page(zram_device_t *zram, uint64_t index, void *page)
+{
+    uint8_t     buffer[ZRAM_HUGE_SIZE];
+    zram_slot_t slot;
+    if (!zram || !page) return -EINVAL;
+
+    /* Copy the payload out under the lock and decompress after dropping it. */
+    spin_lock(&zram->lock);
+    if (!zram->claimed || index >= zram->pages) {
+        spin_unlock(&zram->lock);
+        return -EINVAL;
+    }
+    slot = zram->table[index];
+    if (slot.flags & ZRAM_SLOT_HUGE)
+        memcpy(page, phys_to_virt(slot.handle), PAGE_4K_SIZE);
+    else if (slot.size)
+        memcpy(buffer, (const void *)slot.handle, slot.size);
+    zram->reads++;
+    spin_unlock(&zram->lock);
+
+    if (slot.flags & ZRAM_SLOT_HUGE) return EOK;
+    if (!slot.size) {
+        uint64_t *words = page;
+        for (size_t i = 0; i < PAGE_4K_SIZE / sizeof(uint64_t); i++) words[i] = slot.handle;
+        return EOK;
+    }
+    if (lz4_decompress(buffer, slot.size, page, PAGE_4K_SIZE) == (int)PAGE_4K_SIZE) return EOK;
+
+    spin_lock(&zram->lock);
+    zram->failed_reads++;
+    spin_unlock(&zram->lock);
+    plogk("zram: %s: Corrupt page at index %llu.\n", zram->name, (unsigned long long)index);
+    return -EIO;
+}
+
+/* Drop the page at index. */
+void zram_discard_page(zram_device_t *zram, uint64_t index)
+{
+    if (!zram) return;
+    spin_lock(&zram->lock);
+    if (zram->claimed && index < zram->pages) zram_slot_free_locked(zram, index);
+    spin_unlock(&zram->lock);
+}
+
+/* Snapshot a device's usage and compression counters. */
+void zram_get_stats(zram_device_t *zram, zram_stats_t *stats)
+{
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!zram) return;
+    spin_lock(&zram->lock);
+    stats->disksize        = zram->disksize;
+    stats->orig_data_size  = zram->stored * PAGE_4K_SIZE;
+    stats->compr_data_size = zram->compr_bytes;
+    stats->mem_used_total  = zram->pool_frames * PAGE_4K_SIZE;
+    stats->mem_used_max    = zram->pool_frames_max * PAGE_4K_SIZE;
+    stats->same_pages      = zram->same;
+    stats->huge_pages      = zram->huge;
+    stats->pages_stored    = zram->stored;
+    stats->num_reads       = zram->reads;
+    stats->num_writes      = zram->writes;
+    stats->failed_reads    = zram->failed_reads;
+    stats->failed_writes   = zram->failed_writes;
+    stats->initstate       = zram->claimed;
+    spin_unlock(&zram->lock);
+}
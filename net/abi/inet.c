@@ -19,6 +19,7 @@
 #include <net/ipv4/icmp.h>
 #include <net/socket.h>
 #include <net/transport/tcp.h>
+#include <net/transport/tcp_cong.h>
 #include <net/transport/udp.h>
 #include <process/process.h>
 #include <process/sched.h>
@@ -61,8 +62,6 @@ typedef struct inet_core_socket {
         uint32_t        rcvbuf;
         uint64_t        sndtimeo_ticks;
         uint64_t        rcvtimeo_ticks;
-        uint8_t        *rx_data;
-        size_t          rx_length;
         tcp_endpoint_t *pending_accept;
         wait_queue_t    wait;
         spinlock_t      event_lock;
@@ -200,15 +199,6 @@ static int inet_event_wait(inet_core_socket_t *sock, uint64_t generation, uint64
     return inet_signal_pending() ? -ERESTARTSYS : EOK;
 }
 
-/* Drain pending TCP data into the socket RX buffer. */
-static int inet_tcp_fill(inet_core_socket_t *sock)
-{
-    if (!sock->rx_data || sock->rx_length >= TCP_RX_BUFFER_MAX) return 0;
-    int ret = tcp_receive(sock->endpoint.tcp, sock->rx_data + sock->rx_length, TCP_RX_BUFFER_MAX - sock->rx_length);
-    if (ret > 0) sock->rx_length += (size_t)ret;
-    return ret;
-}
-
 static uint16_t abi_be16(uint16_t value)
 {
     return (uint16_t)((value << 8) | (value >> 8));
@@ -360,13 +350,7 @@ static int core_create(int family, int type, int protocol, uint32_t flags, void
         return -ENOMEM;
     }
     if (type == SOCK_STREAM) {
-        sock->rx_data = malloc(TCP_RX_BUFFER_MAX);
-        if (!sock->rx_data) {
-            plogk("inet: Socket RX buffer alloc failed (%u bytes)\n", (unsigned)TCP_RX_BUFFER_MAX);
-            tcp_close(sock->endpoint.tcp);
-            free(sock);
-            return -ENOMEM;
-        }
+        sock->rcvbuf = TCP_RX_BUFFER_DEFAULT;
         tcp_set_event_callback(sock->endpoint.tcp, inet_tcp_event, sock);
     } else if (type == SOCK_DGRAM) {
         udp_set_event_callback(sock->endpoint.udp, inet_udp_event, sock);
@@ -388,7 +372,6 @@ static void core_close(void *context)
         tcp_set_event_callback(sock->endpoint.tcp, NULL, NULL);
         if (sock->pending_accept) tcp_close(sock->pending_accept);
         tcp_close(sock->endpoint.tcp);
-        free(sock->rx_data);
     } else {
         icmp_set_event_callback(sock->endpoint.icmp, NULL, NULL);
         icmp_close(sock->endpoint.icmp);
@@ -560,13 +543,6 @@ static int core_accept(void *context, void **accepted, struct sockaddr *addr, ui
     sock->local_address = listener->local_address;
     sock->local_port    = listener->local_port;
     sock->endpoint.tcp  = endpoint;
-    sock->rx_data       = malloc(TCP_RX_BUFFER_MAX);
-    if (!sock->rx_data) {
-        plogk("inet: Accept socket RX buffer alloc failed (%u bytes)\n", (unsigned)TCP_RX_BUFFER_MAX);
-        tcp_close(endpoint);
-        free(sock);
-        return -ENOMEM;
-    }
     tcp_set_event_callback(sock->endpoint.tcp, inet_tcp_event, sock);
     tcp_endpoint_info_t info;
     if (!tcp_get_info(endpoint, &info)) {
@@ -649,16 +625,9 @@ static int core_recvfrom(void *context, void *buf, size_t len, int flags, struct
         uint64_t deadline = sock->rcvtimeo_ticks ? sched_ticks() + sock->rcvtimeo_ticks : 0;
         for (;;) {
             uint64_t generation = inet_event_snapshot(sock);
-            (void)inet_tcp_fill(sock);
-            size_t available = sock->rx_length;
-            if (available) {
-                size_t take = available < len - copied ? available : len - copied;
-                memcpy((uint8_t *)buf + copied, sock->rx_data, take);
-                copied += take;
-                if (!(flags & MSG_PEEK)) {
-                    memmove(sock->rx_data, sock->rx_data + take, sock->rx_length - take);
-                    sock->rx_length -= take;
-                }
+            int      ret        = tcp_receive(sock->endpoint.tcp, (uint8_t *)buf + copied, len - copied, (flags & MSG_PEEK) != 0);
+            if (ret > 0) {
+                copied += (size_t)ret;
                 if (!(flags & MSG_WAITALL) || copied == len || (flags & MSG_PEEK)) return (int)copied;
             }
             tcp_state_t state = tcp_get_state(sock->endpoint.tcp);
@@ -833,6 +802,13 @@ static int core_setsockopt(void *context, int level, int option, const void *val
                 return -ENOPROTOOPT;
         }
     }
+    if (level == SOL_TCP && option == TCP_CONGESTION && sock->type == SOCK_STREAM) {
+        char name[TCP_CA_NAME_MAX] = {0};
+        memcpy(name, value, length < sizeof(name) - 1 ? length : sizeof(name) - 1);
+        int id = tcp_congestion_id(name);
+        if (id < 0) return id;
+        return tcp_set_option(sock->endpoint.tcp, TCP_OPTION_CONGESTION, (uint32_t)id);
+    }
     if (level == SOL_TCP) {
         if (option != TCP_NODELAY || sock->type != SOCK_STREAM) return -ENOPROTOOPT;
         if (length < sizeof(int)) return -EINVAL;
@@ -867,6 +843,11 @@ static int core_setsockopt(void *context, int level, int option, const void *val
             return EOK;
         case SO_RCVBUF :
             if (val <= 0) return -EINVAL;
+            if (sock->type == SOCK_STREAM) {
+                int status = tcp_set_option(sock->endpoint.tcp, TCP_OPTION_RCVBUF, (uint32_t)val);
+                if (status) return status;
+                return tcp_get_option(sock->endpoint.tcp, TCP_OPTION_RCVBUF, &sock->rcvbuf);
+            }
             sock->rcvbuf = (uint32_t)val > SOCK_BUF_MAX ? SOCK_BUF_MAX : (uint32_t)val;
             return EOK;
         default :
@@ -951,6 +932,17 @@ static int core_getsockopt(void *context, int level, int option, void *value, ui
         *length = sizeof(tv);
         return EOK;
     }
+    if (level == SOL_TCP && option == TCP_CONGESTION && sock->type == SOCK_STREAM) {
+        tcp_endpoint_info_t info;
+        char                name[TCP_CA_NAME_MAX] = {0};
+        int                 status                = tcp_get_info(sock->endpoint.tcp, &info);
+        if (status) return status;
+        memcpy(name, info.congestion, strlen(info.congestion));
+        size_t size = *length < sizeof(name) ? *length : sizeof(name);
+        memcpy(value, name, size);
+        *length = size;
+        return EOK;
+    }
     if (level == SOL_TCP) {
         if (option != TCP_NODELAY || sock->type != SOCK_STREAM) return -ENOPROTOOPT;
         val = sock->nodelay;
@@ -1000,8 +992,7 @@ static int core_poll(void *context, size_t events)
         if (sock->pending_accept) ready |= INET_POLLIN;
     } else {
         tcp_state_t state = tcp_get_state(sock->endpoint.tcp);
-        (void)inet_tcp_fill(sock);
-        if (sock->rx_length || state == TCP_CLOSE_WAIT || state == TCP_CLOSED || state == TCP_TIME_WAIT) ready |= INET_POLLIN;
+        if (tcp_readiness(sock->endpoint.tcp) & TCP_READY_READ) ready |= INET_POLLIN;
         if (state == TCP_ESTABLISHED || state == TCP_CLOSE_WAIT) ready |= INET_POLLOUT;
         if (sock->connecting && state != TCP_SYN_SENT) {
             ready |= INET_POLLOUT;
@@ -119,8 +119,8 @@ uint16_t net_checksum(const void *data, size_t length)
     return net_checksum_finish(net_checksum_add(0, data, length));
 }
 
-/* Compute the IPv4 pseudo-header checksum for a transport segment. */
-uint16_t net_checksum_ipv4_pseudo(uint32_t source, uint32_t destination, uint8_t protocol, const void *data, size_t length)
+/* Partial sum of the IPv4 pseudo header. */
+static uint32_t net_checksum_ipv4_pseudo_sum(uint32_t source, uint32_t destination, uint8_t protocol, size_t length)
 {
     uint8_t pseudo[12];
     net_write_be32(pseudo, source);
@@ -128,7 +128,19 @@ uint16_t net_checksum_ipv4_pseudo(uint32_t source, uint32_t destination, uint8_t
     pseudo[8] = 0;
     pseudo[9] = protocol;
     net_write_be16(pseudo + 10, (uint16_t)length);
-    return net_checksum_finish(net_checksum_add(net_checksum_add(0, pseudo, sizeof(pseudo)), data, length));
+    return net_checksum_add(0, pseudo, sizeof(pseudo));
+}
+
+/* Compute the IPv4 pseudo-header checksum for a transport segment. */
+uint16_t net_checksum_ipv4_pseudo(uint32_t source, uint32_t destination, uint8_t protocol, const void *data, size_t length)
+{
+    return net_checksum_finish(net_checksum_add(net_checksum_ipv4_pseudo_sum(source, destination, protocol, length), data, length));
+}
+
+/* Folded, uncomplemented pseudo-header sum to seed a checksum the device completes. */
+uint16_t net_checksum_ipv4_pseudo_partial(uint32_t source, uint32_t destination, uint8_t protocol, size_t length)
+{
+    return (uint16_t)~net_checksum_finish(net_checksum_ipv4_pseudo_sum(source, destination, protocol, length));
 }
 
 /* Allocate a packet buffer with room for a protocol header in the headroom. */
@@ -202,9 +214,13 @@ net_pbuf_t *net_pbuf_from(const void *data, size_t length, size_t headroom)
     return pbuf;
 }
 
+/* Copy a packet buffer, keeping any pending checksum offload. */
 net_pbuf_t *net_pbuf_clone(const net_pbuf_t *pbuf, size_t headroom)
 {
-    return pbuf ? net_pbuf_from(pbuf->data, pbuf->length, headroom) : NULL;
+    if (!pbuf) return NULL;
+    net_pbuf_t *clone = net_pbuf_from(pbuf->data, pbuf->length, headroom);
+    if (clone && pbuf->csum_partial) net_pbuf_checksum_partial(clone, clone->data + (pbuf->csum_start - net_pbuf_headroom(pbuf)), pbuf->csum_offset);
+    return clone;
 }
 
 /* Take a reference on a packet buffer. */
@@ -250,6 +266,26 @@ void *net_pbuf_pull(net_pbuf_t *pbuf, size_t length)
     return pbuf->data;
 }
 
+/* Leave the checksum of the transport header at start to the device; its field must hold the pseudo-header sum. */
+void net_pbuf_checksum_partial(net_pbuf_t *pbuf, const void *start, size_t offset)
+{
+    if (!pbuf) return;
+    pbuf->csum_start   = (uint16_t)((const uint8_t *)start - pbuf->storage);
+    pbuf->csum_offset  = (uint16_t)offset;
+    pbuf->csum_partial = 1;
+}
+
+/* Finish a partial checksum in software, for paths the device cannot offload. */
+void net_pbuf_checksum_resolve(net_pbuf_t *pbuf)
+{
+    if (!pbuf || !pbuf->csum_partial) return;
+    uint8_t *start     = pbuf->storage + pbuf->csum_start;
+    size_t   length    = (size_t)(pbuf->data + pbuf->length - start);
+    uint16_t checksum  = net_checksum(start, length);
+    net_write_be16(start + pbuf->csum_offset, checksum ? checksum : UINT16_MAX);
+    pbuf->csum_partial = 0;
+}
+
 /* Truncate the packet to the given length. */
 int net_pbuf_trim(net_pbuf_t *pbuf, size_t length)
 {
@@ -569,6 +605,7 @@ void net_init(void)
 #endif
     arp_init();
     ndp_init();
+    tcp_init();
     dhcp_init();
 }
 
@@ -598,6 +635,7 @@ int netdev_tx(net_device_t *device, net_pbuf_t *packet)
 {
     if (!device || !packet) return -EINVAL;
     if (!device->registered || (device->flags & (NETDEV_F_UP | NETDEV_F_RUNNING)) != (NETDEV_F_UP | NETDEV_F_RUNNING)) return -ENETDOWN;
+    if (packet->csum_partial && !(device->flags & NETDEV_F_TX_CSUM)) net_pbuf_checksum_resolve(packet);
     size_t length = packet->length;
     int    status = device->ops->xmit(device, packet);
     spin_lock(&device->lock);
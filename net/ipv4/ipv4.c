@@ -185,8 +185,8 @@ static uint16_t ipv4_next_id(void)
 }
 
 /* Build one IPv4 fragment with the given flags/offset and transmit it. */
-static int ipv4_emit_fragment(net_device_t *device, uint32_t next_hop, uint32_t source, uint32_t destination, uint8_t protocol, uint8_t ttl, uint16_t id, uint16_t flags_offset, const uint8_t *data,
-                              size_t length)
+static int ipv4_emit_fragment(net_device_t *device, uint32_t next_hop, uint32_t source, uint32_t destination, uint8_t protocol, uint8_t ttl, uint16_t id, uint16_t flags_offset,
+                              const net_pbuf_t *packet, size_t offset, size_t length)
 {
     net_pbuf_t *fragment = net_pbuf_alloc(IPV4_HEADER_MIN + length, NET_PBUF_HEADROOM);
     if (!fragment) {
@@ -204,7 +204,8 @@ static int ipv4_emit_fragment(net_device_t *device, uint32_t next_hop, uint32_t
     header[9] = protocol;
     net_write_be32(header + 12, source);
     net_write_be32(header + 16, destination);
-    if (length) memcpy(header + IPV4_HEADER_MIN, data, length);
+    if (length) memcpy(header + IPV4_HEADER_MIN, packet->data + offset, length);
+    if (packet->csum_partial) net_pbuf_checksum_partial(fragment, header + IPV4_HEADER_MIN + (packet->csum_start - net_pbuf_headroom(packet)), packet->csum_offset);
     net_write_be16(header + 10, net_checksum(header, IPV4_HEADER_MIN));
     int status = arp_resolve(device, next_hop, fragment);
     net_pbuf_free(fragment);
@@ -244,6 +245,8 @@ int ipv4_output(net_device_t *device, uint32_t source, uint32_t destination, uin
         if (release) netdev_put(device);
         return -EMSGSIZE;
     }
+    /* Only an unfragmented datagram can leave its transport checksum to the device. */
+    if (packet->csum_partial && (packet->length > fragment_payload || !(device->flags & NETDEV_F_TX_CSUM))) net_pbuf_checksum_resolve(packet);
     uint16_t id     = ipv4_next_id();
     int      result = 0;
     for (size_t offset = 0; offset < packet->length || (!packet->length && !offset);) {
@@ -251,7 +254,7 @@ int ipv4_output(net_device_t *device, uint32_t source, uint32_t destination, uin
         if (length > fragment_payload) length = fragment_payload;
         uint16_t fragment = (uint16_t)(offset / 8U);
         if (offset + length < packet->length) fragment |= IPV4_FLAG_MF;
-        int status = ipv4_emit_fragment(device, next_hop, source, destination, protocol, ttl, id, fragment, packet->data + offset, length);
+        int status = ipv4_emit_fragment(device, next_hop, source, destination, protocol, ttl, id, fragment, packet, offset, length);
         if (status && status != -EINPROGRESS) {
             result = status;
             break;
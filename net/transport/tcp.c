@@ -11,10 +11,15 @@
 #include <kernel/errno.h>
 #include <kernel/printk.h>
 #include <kernel/timer/timer.h>
+#include <libs/list/intrusive_list.h>
+#include <libs/std/stddef.h>
 #include <libs/std/string.h>
+#include <libs/util/rbtree.h>
 #include <mem/heap.h>
+#include <mem/slab.h>
 #include <net/core/endian.h>
 #include <net/transport/tcp.h>
+#include <net/transport/tcp_cong.h>
 #include <process/sched.h>
 
 #define TCP_HEADER_LEN      20U
@@ -31,6 +36,22 @@
 #define TCP_RTO_MAX         ((uint64_t)60U * TIMER_HZ)
 #define TCP_PERSIST_MIN     TIMER_HZ
 #define TCP_TIME_WAIT_TICKS ((uint64_t)60U * TIMER_HZ)
+#define TCP_HASH_LOCKS      64U    // lock stripes, also the initial bucket count
+#define TCP_HASH_MAX_SIZE   65536U // bucket limit for the connection and listener tables
+#define TCP_HASH_LOAD       2U     // average chain length that triggers a resize
+#define TCP_BIND_BUCKETS    256U   // local-port buckets for bind conflict checks
+#define TCP_TIMER_BATCH     32U    // due PCBs popped per timer-tree pass in tcp_timer()
+#define TCP_WSCALE_LOCAL    7U     // our window shift: TCP_RX_BUFFER_MAX >> 7 fits the 16-bit field
+#define TCP_WSCALE_MAX      14U    // RFC 7323 ceiling on a peer's shift
+#define TCP_SACK_BLOCKS_MAX 4U     // SACK blocks that fit the option space without timestamps
+#define TCP_OPTIONS_MAX     40U
+#define TCP_OPT_EOL         0U
+#define TCP_OPT_NOP         1U
+#define TCP_OPT_MSS         2U
+#define TCP_OPT_WSCALE      3U
+#define TCP_OPT_SACK_PERM   4U
+#define TCP_OPT_SACK        5U
+#define TCP_OPT_TIMESTAMP   8U
 
 typedef struct tcp_tx_record {
         struct tcp_tx_record *next;
@@ -42,6 +63,8 @@ typedef struct tcp_tx_record {
         uint64_t              deadline; // tick at which retransmission fires
         uint64_t              sent_at;  // last transmission tick, for RTT sampling
         uint8_t               retransmitted;
+        uint8_t               sacked;        // peer holds it out of order (SACK scoreboard)
+        uint8_t               recovery_sent; // already retransmitted in this recovery episode
         uint8_t               data[];
 } tcp_tx_record_t;
 
@@ -54,11 +77,42 @@ typedef struct tcp_ooo_record {
         uint8_t                data[];
 } tcp_ooo_record_t;
 
+/* Options carried by an inbound segment */
+typedef struct tcp_options {
+        uint16_t mss;
+        uint8_t  wscale;
+        uint8_t  has_wscale;
+        uint8_t  sack_ok;
+        uint8_t  has_timestamp;
+        uint8_t  sack_count;
+        uint32_t tsval;
+        uint32_t tsecr;
+        uint32_t sack[TCP_SACK_BLOCKS_MAX][2]; // left and right edge of each block
+} tcp_options_t;
+
+/*
+ * Connection and listener tables
+ * Bucket i is guarded by locks[i % TCP_HASH_LOCKS].  The bucket count is
+ * always a multiple of the stripe count, so doubling the table only moves a
+ * PCB between buckets under the same stripe, and a resize takes every
+ * stripe.  A stripe is never held while taking an endpoint lock: lookups pin
+ * the PCB with a reference and lock it after dropping the stripe.
+ */
+typedef struct tcp_hash_table {
+        tcp_endpoint_t **buckets;
+        uint32_t         bucket_count;
+        uint32_t         count;
+        spinlock_t       locks[TCP_HASH_LOCKS];
+        tcp_endpoint_t  *inline_buckets[TCP_HASH_LOCKS];
+} tcp_hash_table_t;
+
 /*
  * tcp_endpoint_t: per-connection control block
  * One PCB per socket. Sending and receive windows, retransmission
  * state, keepalive/persist timers and the accept queue are all kept
- * here. All fields are guarded by endpoint->lock.
+ * here. All fields are guarded by endpoint->lock, except the table
+ * links (guarded by the table stripe or tcp_bind_lock), the timer-tree
+ * link (guarded by tcp_timer_lock) and refcount.
  */
 
 typedef struct tcp_endpoint {
@@ -77,11 +131,22 @@ typedef struct tcp_endpoint {
         uint32_t             snd_wl1;
         uint32_t             snd_wl2;
         uint32_t             rcv_nxt;
-        uint16_t             peer_window;
+        uint32_t             peer_window; // already shifted by snd_wscale
         uint16_t             peer_mss;
-        uint16_t             rx_length;
-        uint16_t             ooo_length;
-        uint8_t             *rx_data;
+        uint8_t              snd_wscale; // shift the peer applies to the windows it advertises
+        uint8_t              rcv_wscale; // shift we apply to the windows we advertise
+        uint8_t              wscale_ok;
+        uint8_t              ts_ok;
+        uint8_t              sack_ok;
+        uint8_t             *rx_data; // receive ring of rx_capacity bytes
+        uint32_t             rx_capacity;
+        uint32_t             rx_head; // ring offset of the oldest unread byte
+        uint32_t             rx_length;
+        uint32_t             ooo_length;
+        uint32_t             rcv_wnd_sent; // window carried by our last segment
+        uint32_t             ts_recent;    // latest TSval from the peer, echoed as TSecr
+        uint32_t             last_ack_sent;
+        uint32_t             highest_sack; // one past the highest byte the peer has SACKed
         int                  error;
         uint8_t              bound;
         uint8_t              backlog;
@@ -92,8 +157,6 @@ typedef struct tcp_endpoint {
         uint64_t             last_received;
         uint64_t             keepalive_deadline;
         uint64_t             persist_deadline;
-        uint32_t             cwnd;
-        uint32_t             ssthresh;
         uint32_t             rto;
         uint32_t             srtt;
         uint32_t             rttvar;
@@ -114,25 +177,52 @@ typedef struct tcp_endpoint {
         uint8_t              fast_recovery;
         uint8_t              persist_needed;
         uint8_t              persist_byte;
-        uint8_t              ooo_count;
+        uint16_t             ooo_count;
         uint8_t              orphaned;
+        uint8_t              destroyed;
+        uint16_t             child_count; // listener: pending and unaccepted children
+        uint32_t             refcount;
+        uint32_t             hash;        // key hash in the table named by table
+        tcp_hash_table_t    *table;       // connection or listener table holding the PCB
+        struct tcp_endpoint *hash_next;
+        struct tcp_endpoint *bind_next;
+        ilist_node_t         children; // listener: pending and unaccepted children
+        ilist_node_t         sibling;  // child: link on parent->children
         struct tcp_endpoint *parent;
         struct tcp_endpoint *accept_queue[TCP_ACCEPT_MAX];
         tcp_tx_record_t     *tx_head;
+        tcp_tx_record_t     *tx_tail;
+        uint32_t             tx_count;
         tcp_ooo_record_t    *ooo_head;
         wait_queue_t         wait;
         spinlock_t           lock;
         tcp_event_callback_t event_callback;
         void                *event_context;
+        /* Congestion control and pacing */
+        const tcp_congestion_ops_t *cc_ops;
+        tcp_cc_t                    cc;
+        uint64_t                    pacing_stamp;   // tick the token bucket was last refilled
+        uint32_t                    pacing_tokens;  // bytes that may leave before the next refill
+        uint8_t                     pacing_blocked; // tcp_send stopped on the pacer; the timer wakes writers
+        /* Timer tree */
+        rb_node_t timer_node;   // link on tcp_timer_root, keyed by timer_due
+        uint64_t  timer_due;    // tick the PCB is queued for; only lowered while queued
+        uint8_t   timer_queued; // on tcp_timer_root, holding a reference
 } tcp_endpoint_t;
 
 /* Globals and sequence helpers */
 
-static tcp_endpoint_t *tcp_table[TCP_ENDPOINT_MAX];
-static spinlock_t      tcp_table_lock;
-static spinlock_t      tcp_iss_lock;
-static uint16_t        tcp_ephemeral = TCP_EPHEMERAL_FIRST;
-static uint32_t        tcp_iss_counter;
+static tcp_hash_table_t tcp_established = {.buckets = tcp_established.inline_buckets, .bucket_count = TCP_HASH_LOCKS};
+static tcp_hash_table_t tcp_listeners   = {.buckets = tcp_listeners.inline_buckets, .bucket_count = TCP_HASH_LOCKS};
+static tcp_endpoint_t  *tcp_bind_table[TCP_BIND_BUCKETS];
+static spinlock_t       tcp_bind_lock;
+static rb_root_t        tcp_timer_root = RB_ROOT_INIT; // PCBs with a pending timer, earliest due first
+static spinlock_t       tcp_timer_lock;                // leaf lock, nests inside endpoint->lock
+static slab_cache_t    *tcp_endpoint_cache;
+static uint32_t         tcp_hash_seed;
+static spinlock_t       tcp_iss_lock;
+static uint16_t         tcp_ephemeral = TCP_EPHEMERAL_FIRST;
+static uint32_t         tcp_iss_counter;
 
 static int  tcp_emit(tcp_endpoint_t *endpoint, uint32_t sequence, uint32_t acknowledgment, uint8_t flags, const void *data, size_t length, int track);
 static int  tcp_autobind(tcp_endpoint_t *endpoint, uint32_t address);
@@ -216,18 +306,27 @@ int net_tcp_parse6(const void *data, size_t length, const struct in6_addr *sourc
     return 0;
 }
 
-/* Advertise the current receive window (free space in the RX buffer) */
-static uint16_t tcp_window(const tcp_endpoint_t *endpoint)
+/* Current receive window (free space in the RX ring) */
+static uint32_t tcp_window(const tcp_endpoint_t *endpoint)
 {
-    return (uint16_t)(TCP_RX_BUFFER_MAX - endpoint->rx_length - endpoint->ooo_length);
+    uint32_t used = endpoint->rx_length + endpoint->ooo_length;
+    return endpoint->rx_capacity > used ? endpoint->rx_capacity - used : 0;
 }
 
-/* Count segments currently queued for retransmission */
-static unsigned tcp_tx_count(const tcp_endpoint_t *endpoint)
+/* Window a segment can carry after shifting by shift and clamping to the 16-bit field */
+static uint32_t tcp_window_advertisable(const tcp_endpoint_t *endpoint, unsigned shift)
 {
-    unsigned count = 0;
-    for (const tcp_tx_record_t *record = endpoint->tx_head; record; record = record->next) count++;
-    return count;
+    uint32_t window = tcp_window(endpoint) >> shift;
+    if (window > UINT16_MAX) window = UINT16_MAX;
+    return window << shift;
+}
+
+/* Window field for an outgoing segment: unscaled on SYNs, shifted by rcv_wscale otherwise */
+static uint16_t tcp_window_field(tcp_endpoint_t *endpoint, uint8_t flags)
+{
+    unsigned shift         = (flags & TCP_FLAG_SYN) ? 0 : endpoint->rcv_wscale;
+    endpoint->rcv_wnd_sent = tcp_window_advertisable(endpoint, shift);
+    return (uint16_t)(endpoint->rcv_wnd_sent >> shift);
 }
 
 /* Compute the ready-event mask for poll/select (caller holds the lock) */
@@ -238,8 +337,8 @@ static uint32_t tcp_ready_locked(const tcp_endpoint_t *endpoint)
     if (endpoint->rx_length || endpoint->state == TCP_CLOSE_WAIT || endpoint->state == TCP_CLOSED || endpoint->state == TCP_TIME_WAIT) ready |= TCP_READY_READ;
     if (endpoint->state == TCP_ESTABLISHED || endpoint->state == TCP_CLOSE_WAIT) {
         uint32_t flight = endpoint->snd_nxt - endpoint->snd_una;
-        uint32_t limit  = endpoint->peer_window < endpoint->cwnd ? endpoint->peer_window : endpoint->cwnd;
-        if (!endpoint->error && tcp_tx_count(endpoint) < TCP_TX_SEGMENT_MAX && flight < limit) ready |= TCP_READY_WRITE;
+        uint32_t limit  = endpoint->peer_window < endpoint->cc.cwnd ? endpoint->peer_window : endpoint->cc.cwnd;
+        if (!endpoint->error && !endpoint->pacing_blocked && endpoint->tx_count < TCP_TX_SEGMENT_MAX && flight < limit) ready |= TCP_READY_WRITE;
     }
     if (endpoint->error) ready |= TCP_READY_ERROR;
     if (endpoint->state == TCP_CLOSE_WAIT || endpoint->state == TCP_CLOSED || endpoint->state == TCP_TIME_WAIT) ready |= TCP_READY_HANGUP;
@@ -262,6 +361,8 @@ static void tcp_fail_locked(tcp_endpoint_t *endpoint, int error)
     endpoint->error = error;
     tcp_records_free(endpoint->tx_head);
     endpoint->tx_head            = NULL;
+    endpoint->tx_tail            = NULL;
+    endpoint->tx_count           = 0;
     endpoint->persist_deadline   = 0;
     endpoint->keepalive_deadline = 0;
 }
@@ -275,80 +376,454 @@ static uint32_t tcp_new_iss(void)
     return iss;
 }
 
+/* Free a chain of transmitted-but-unacked segments */
+static void tcp_records_free(tcp_tx_record_t *record)
+{
+    while (record) {
+        tcp_tx_record_t *next = record->next;
+        free(record);
+        record = next;
+    }
+}
+
+/* Free a chain of queued out-of-order segments */
+static void tcp_ooo_free(tcp_ooo_record_t *record)
+{
+    while (record) {
+        tcp_ooo_record_t *next = record->next;
+        free(record);
+        record = next;
+    }
+}
+
+/* Pin a PCB so it stays allocated after the table stripe is dropped */
+static void tcp_endpoint_get(tcp_endpoint_t *endpoint)
+{
+    __atomic_add_fetch(&endpoint->refcount, 1, __ATOMIC_RELAXED);
+}
+
+/* Drop a reference, freeing the PCB with the last one */
+static void tcp_endpoint_put(tcp_endpoint_t *endpoint)
+{
+    if (__atomic_sub_fetch(&endpoint->refcount, 1, __ATOMIC_ACQ_REL)) return;
+    tcp_records_free(endpoint->tx_head);
+    tcp_ooo_free(endpoint->ooo_head);
+    free(endpoint->rx_data);
+    slab_cache_free(tcp_endpoint_cache, endpoint);
+}
+
+/* Timer tree */
+
+static int tcp_timer_less(const rb_node_t *a, const rb_node_t *b)
+{
+    return rb_entry(a, tcp_endpoint_t, timer_node)->timer_due < rb_entry(b, tcp_endpoint_t, timer_node)->timer_due;
+}
+
+/*
+ * Earliest tick at which tcp_timer_endpoint() has work for this PCB,
+ * following its order of checks; 0 means as soon as possible and
+ * UINT64_MAX means no timer is pending (caller holds endpoint->lock).
+ */
+static uint64_t tcp_timer_due_locked(const tcp_endpoint_t *endpoint)
+{
+    const tcp_tx_record_t *record = endpoint->tx_head;
+    uint64_t               due    = UINT64_MAX;
+    if (endpoint->pacing_blocked || (endpoint->orphaned && endpoint->state == TCP_CLOSED)) return 0;
+    if (endpoint->state == TCP_TIME_WAIT || endpoint->state == TCP_FIN_WAIT_2) due = endpoint->time_wait_until;
+    if (record && record->length && !endpoint->peer_window && endpoint->state != TCP_SYN_SENT && endpoint->state != TCP_SYN_RECEIVED)
+        return endpoint->persist_deadline < due ? endpoint->persist_deadline : due;
+    if (!endpoint->peer_window && endpoint->persist_needed && endpoint->persist_deadline && endpoint->persist_deadline < due) due = endpoint->persist_deadline;
+    if (record && record->deadline < due) due = record->deadline;
+    if (!record && endpoint->keepalive_enabled && endpoint->state == TCP_ESTABLISHED && endpoint->keepalive_deadline < due) due = endpoint->keepalive_deadline;
+    return due;
+}
+
+/*
+ * Queue the PCB on the timer tree for its next due tick, no earlier than
+ * the next tick.  A queued PCB is only ever moved earlier; a stale entry
+ * costs one visit, after which tcp_timer_endpoint() requeues it exactly.
+ * Call after changing any deadline (caller holds endpoint->lock).
+ */
+static void tcp_timer_schedule_locked(tcp_endpoint_t *endpoint)
+{
+    uint64_t due  = tcp_timer_due_locked(endpoint);
+    uint64_t soon = sched_ticks() + 1;
+    if (endpoint->destroyed || due == UINT64_MAX) return;
+    if (due < soon) due = soon;
+    if (__atomic_load_n(&endpoint->timer_queued, __ATOMIC_ACQUIRE) && endpoint->timer_due <= due) return;
+
+    spin_lock(&tcp_timer_lock);
+    if (endpoint->timer_queued) {
+        if (endpoint->timer_due <= due) {
+            spin_unlock(&tcp_timer_lock);
+            return;
+        }
+        rb_erase_augmented(&tcp_timer_root, &endpoint->timer_node, NULL, NULL);
+    } else
+        tcp_endpoint_get(endpoint);
+    endpoint->timer_due = due;
+    rb_insert_augmented(&tcp_timer_root, &endpoint->timer_node, tcp_timer_less, NULL, NULL);
+    __atomic_store_n(&endpoint->timer_queued, 1, __ATOMIC_RELEASE);
+    spin_unlock(&tcp_timer_lock);
+}
+
+/* Take a destroyed PCB off the timer tree and drop the tree's reference */
+static void tcp_timer_cancel(tcp_endpoint_t *endpoint)
+{
+    spin_lock(&tcp_timer_lock);
+    int queued = endpoint->timer_queued;
+    if (queued) {
+        rb_erase_augmented(&tcp_timer_root, &endpoint->timer_node, NULL, NULL);
+        __atomic_store_n(&endpoint->timer_queued, 0, __ATOMIC_RELEASE);
+    }
+    spin_unlock(&tcp_timer_lock);
+    if (queued) tcp_endpoint_put(endpoint);
+}
+
+/* Table hashing and lookup */
+
+/* FNV-1a step, seeded at boot so remote peers cannot aim at one chain */
+static uint32_t tcp_hash_bytes(uint32_t hash, const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ bytes[i]) * 16777619U;
+    return hash;
+}
+
+/* Hash a connection 4-tuple; addresses are 4 or 16 bytes wide */
+static uint32_t tcp_tuple_hash(const void *local, const void *remote, size_t address_length, uint16_t local_port, uint16_t remote_port)
+{
+    uint32_t ports = (uint32_t)local_port << 16 | remote_port;
+    uint32_t hash  = tcp_hash_bytes(2166136261U ^ tcp_hash_seed, local, address_length);
+    hash           = tcp_hash_bytes(hash, remote, address_length);
+    return tcp_hash_bytes(hash, &ports, sizeof(ports));
+}
+
+/* Hash a listener key; address_length is 0 for a wildcard bind */
+static uint32_t tcp_listen_hash(const void *local, size_t address_length, uint16_t port)
+{
+    uint32_t hash = tcp_hash_bytes(2166136261U ^ tcp_hash_seed, local, address_length);
+    return tcp_hash_bytes(hash, &port, sizeof(port));
+}
+
+/* Connection-table key of a PCB with both ends set */
+static uint32_t tcp_endpoint_hash(const tcp_endpoint_t *endpoint)
+{
+    if (endpoint->native6)
+        return tcp_tuple_hash(endpoint->local_address6.bytes, endpoint->remote_address6.bytes, sizeof(ipv6_address_t), endpoint->local_port, endpoint->remote_port);
+    return tcp_tuple_hash(&endpoint->local_address, &endpoint->remote_address, sizeof(uint32_t), endpoint->local_port, endpoint->remote_port);
+}
+
+/* Listener-table key of a bound PCB */
+static uint32_t tcp_listener_hash(const tcp_endpoint_t *endpoint)
+{
+    if (endpoint->native6 && !ipv6_address_is_unspecified(&endpoint->local_address6))
+        return tcp_listen_hash(endpoint->local_address6.bytes, sizeof(ipv6_address_t), endpoint->local_port);
+    if (!endpoint->native6 && endpoint->local_address) return tcp_listen_hash(&endpoint->local_address, sizeof(uint32_t), endpoint->local_port);
+    return tcp_listen_hash(NULL, 0, endpoint->local_port);
+}
+
+/* True if two connected PCBs share a 4-tuple */
+static int tcp_same_tuple(const tcp_endpoint_t *a, const tcp_endpoint_t *b)
+{
+    if (a->native6 != b->native6 || a->local_port != b->local_port || a->remote_port != b->remote_port) return 0;
+    if (a->native6) return ipv6_address_equal(&a->local_address6, &b->local_address6) && ipv6_address_equal(&a->remote_address6, &b->remote_address6);
+    return a->local_address == b->local_address && a->remote_address == b->remote_address;
+}
+
+/* True if a PCB may take IPv4 traffic (AF_INET, or a dual-stack AF_INET6 wildcard) */
+static int tcp_accepts_v4(const tcp_endpoint_t *endpoint)
+{
+    return endpoint->family == AF_INET || (endpoint->family == AF_INET6 && !endpoint->v6only && ipv6_address_is_unspecified(&endpoint->local_address6));
+}
+
+/* Take the stripe guarding the bucket of hash. */
+static spinlock_t *tcp_hash_lock(tcp_hash_table_t *table, uint32_t hash)
+{
+    spinlock_t *lock = &table->locks[hash & (TCP_HASH_LOCKS - 1)];
+    spin_lock(lock);
+    return lock;
+}
+
+/* Head of the chain for hash; the caller holds the matching stripe. */
+static tcp_endpoint_t **tcp_hash_bucket(tcp_hash_table_t *table, uint32_t hash)
+{
+    return &table->buckets[hash & (table->bucket_count - 1)];
+}
+
+/*
+ * Double a table once its chains pass the load factor.  Growth is
+ * best-effort: allocation failure only keeps the old valid table.
+ */
+static void tcp_hash_grow(tcp_hash_table_t *table)
+{
+    for (unsigned i = 0; i < TCP_HASH_LOCKS; i++) spin_lock(&table->locks[i]);
+    tcp_endpoint_t **old_buckets = NULL;
+    if (table->bucket_count < TCP_HASH_MAX_SIZE && __atomic_load_n(&table->count, __ATOMIC_RELAXED) >= table->bucket_count * TCP_HASH_LOAD) {
+        uint32_t         new_count   = table->bucket_count << 1;
+        tcp_endpoint_t **new_buckets = calloc(new_count, sizeof(*new_buckets)); // NOLINT(bugprone-sizeof-expression)
+        if (new_buckets) {
+            for (uint32_t i = 0; i < table->bucket_count; i++) {
+                tcp_endpoint_t *endpoint = table->buckets[i];
+                while (endpoint) {
+                    tcp_endpoint_t *next   = endpoint->hash_next;
+                    uint32_t        bucket = endpoint->hash & (new_count - 1);
+                    endpoint->hash_next    = new_buckets[bucket];
+                    new_buckets[bucket]    = endpoint;
+                    endpoint               = next;
+                }
+            }
+            if (table->buckets != table->inline_buckets) old_buckets = table->buckets;
+            table->buckets      = new_buckets;
+            table->bucket_count = new_count;
+        }
+    }
+    for (unsigned i = TCP_HASH_LOCKS; i-- > 0;) spin_unlock(&table->locks[i]);
+    free(old_buckets);
+}
+
+/*
+ * Link a PCB into a table under hash.  With unique set the insert fails if a
+ * connection with the same 4-tuple is already present.
+ */
+static int tcp_hash_insert(tcp_hash_table_t *table, tcp_endpoint_t *endpoint, uint32_t hash, int unique)
+{
+    spinlock_t      *lock   = tcp_hash_lock(table, hash);
+    tcp_endpoint_t **bucket = tcp_hash_bucket(table, hash);
+    if (unique) {
+        for (tcp_endpoint_t *ep = *bucket; ep; ep = ep->hash_next) {
+            if (ep->hash == hash && tcp_same_tuple(ep, endpoint)) {
+                spin_unlock(lock);
+                return -EADDRINUSE;
+            }
+        }
+    }
+    endpoint->hash      = hash;
+    endpoint->table     = table;
+    endpoint->hash_next = *bucket;
+    *bucket             = endpoint;
+
+    /* The count spans every stripe, so only an atomic update keeps it exact. */
+    int grow = __atomic_add_fetch(&table->count, 1, __ATOMIC_RELAXED) >= table->bucket_count * TCP_HASH_LOAD && table->bucket_count < TCP_HASH_MAX_SIZE;
+    spin_unlock(lock);
+    if (grow) tcp_hash_grow(table);
+    return 0;
+}
+
+/* Unlink a PCB from whichever table holds it */
+static void tcp_hash_remove(tcp_endpoint_t *endpoint)
+{
+    tcp_hash_table_t *table = endpoint->table;
+    if (!table) return;
+    spinlock_t      *lock = tcp_hash_lock(table, endpoint->hash);
+    tcp_endpoint_t **link = tcp_hash_bucket(table, endpoint->hash);
+    while (*link && *link != endpoint) link = &(*link)->hash_next;
+    if (*link) {
+        *link = endpoint->hash_next;
+        __atomic_sub_fetch(&table->count, 1, __ATOMIC_RELAXED);
+    }
+    endpoint->table     = NULL;
+    endpoint->hash_next = NULL;
+    spin_unlock(lock);
+}
+
+/* Find the IPv4 connection for a segment, returned with a reference held */
+static tcp_endpoint_t *tcp_lookup(const ipv4_info_t *ip, uint16_t source_port, uint16_t destination_port)
+{
+    uint32_t        hash     = tcp_tuple_hash(&ip->destination, &ip->source, sizeof(uint32_t), destination_port, source_port);
+    spinlock_t     *lock     = tcp_hash_lock(&tcp_established, hash);
+    tcp_endpoint_t *endpoint = *tcp_hash_bucket(&tcp_established, hash);
+    for (; endpoint; endpoint = endpoint->hash_next) {
+        if (endpoint->hash == hash && !endpoint->native6 && endpoint->local_port == destination_port && endpoint->remote_port == source_port && endpoint->local_address == ip->destination
+            && endpoint->remote_address == ip->source) {
+            tcp_endpoint_get(endpoint);
+            break;
+        }
+    }
+    spin_unlock(lock);
+    return endpoint;
+}
+
+/* Find the IPv6 connection for a segment, returned with a reference held */
+static tcp_endpoint_t *tcp_lookup6(const ipv6_info_t *ip, uint16_t source_port, uint16_t destination_port)
+{
+    uint32_t        hash     = tcp_tuple_hash(ip->destination.bytes, ip->source.bytes, sizeof(ipv6_address_t), destination_port, source_port);
+    spinlock_t     *lock     = tcp_hash_lock(&tcp_established, hash);
+    tcp_endpoint_t *endpoint = *tcp_hash_bucket(&tcp_established, hash);
+    for (; endpoint; endpoint = endpoint->hash_next) {
+        if (endpoint->hash == hash && endpoint->native6 && endpoint->local_port == destination_port && endpoint->remote_port == source_port
+            && ipv6_address_equal(&endpoint->local_address6, &ip->destination) && ipv6_address_equal(&endpoint->remote_address6, &ip->source)) {
+            tcp_endpoint_get(endpoint);
+            break;
+        }
+    }
+    spin_unlock(lock);
+    return endpoint;
+}
+
+/* Find the IPv4 listener for a port, preferring an exact address over a wildcard */
+static tcp_endpoint_t *tcp_lookup_listener(const ipv4_info_t *ip, uint16_t destination_port)
+{
+    for (int wildcard = 0; wildcard < 2; wildcard++) {
+        uint32_t        address  = wildcard ? 0 : ip->destination;
+        uint32_t        hash     = tcp_listen_hash(&address, wildcard ? 0 : sizeof(uint32_t), destination_port);
+        spinlock_t     *lock     = tcp_hash_lock(&tcp_listeners, hash);
+        tcp_endpoint_t *endpoint = *tcp_hash_bucket(&tcp_listeners, hash);
+        for (; endpoint; endpoint = endpoint->hash_next) {
+            if (endpoint->hash == hash && endpoint->local_port == destination_port && tcp_accepts_v4(endpoint) && endpoint->local_address == address) {
+                tcp_endpoint_get(endpoint);
+                break;
+            }
+        }
+        spin_unlock(lock);
+        if (endpoint) return endpoint;
+    }
+    return NULL;
+}
+
+/* Find the IPv6 listener for a port, preferring an exact address over a wildcard */
+static tcp_endpoint_t *tcp_lookup_listener6(const ipv6_info_t *ip, uint16_t destination_port)
+{
+    for (int wildcard = 0; wildcard < 2; wildcard++) {
+        uint32_t        hash     = tcp_listen_hash(ip->destination.bytes, wildcard ? 0 : sizeof(ipv6_address_t), destination_port);
+        spinlock_t     *lock     = tcp_hash_lock(&tcp_listeners, hash);
+        tcp_endpoint_t *endpoint = *tcp_hash_bucket(&tcp_listeners, hash);
+        for (; endpoint; endpoint = endpoint->hash_next) {
+            if (endpoint->hash != hash || endpoint->family != AF_INET6 || endpoint->local_port != destination_port) continue;
+            if (wildcard ? ipv6_address_is_unspecified(&endpoint->local_address6) : ipv6_address_equal(&endpoint->local_address6, &ip->destination)) {
+                tcp_endpoint_get(endpoint);
+                break;
+            }
+        }
+        spin_unlock(lock);
+        if (endpoint) return endpoint;
+    }
+    return NULL;
+}
+
+/* Bind table: every bound PCB, keyed by local port, guarded by tcp_bind_lock */
+
+static void tcp_bind_insert_locked(tcp_endpoint_t *endpoint)
+{
+    tcp_endpoint_t **bucket = &tcp_bind_table[endpoint->local_port & (TCP_BIND_BUCKETS - 1)];
+    endpoint->bind_next     = *bucket;
+    *bucket                 = endpoint;
+}
+
+static void tcp_bind_remove(tcp_endpoint_t *endpoint)
+{
+    spin_lock(&tcp_bind_lock);
+    tcp_endpoint_t **link = &tcp_bind_table[endpoint->local_port & (TCP_BIND_BUCKETS - 1)];
+    while (*link && *link != endpoint) link = &(*link)->bind_next;
+    if (*link) *link = endpoint->bind_next;
+    endpoint->bind_next = NULL;
+    spin_unlock(&tcp_bind_lock);
+}
+
 /* True if the IPv4 local address/port pair is already bound. */
 static int tcp_port_used_locked(uint32_t address, uint16_t port, const tcp_endpoint_t *ignore)
 {
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++) {
-        tcp_endpoint_t *ep = tcp_table[i];
-        if (ep && ep != ignore && ep->bound && ep->local_port == port && (!ep->local_address || !address || ep->local_address == address)) return 1;
-    }
+    for (tcp_endpoint_t *ep = tcp_bind_table[port & (TCP_BIND_BUCKETS - 1)]; ep; ep = ep->bind_next)
+        if (ep != ignore && ep->bound && ep->local_port == port && (!ep->local_address || !address || ep->local_address == address)) return 1;
     return 0;
 }
 
 /* True if the IPv6 local address/port pair is already bound. */
 static int tcp_port_used6_locked(const ipv6_address_t *address, uint16_t port, const tcp_endpoint_t *ignore)
 {
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++) {
-        tcp_endpoint_t *ep = tcp_table[i];
-        if (!ep || ep == ignore || !ep->bound || ep->local_port != port) continue;
+    for (tcp_endpoint_t *ep = tcp_bind_table[port & (TCP_BIND_BUCKETS - 1)]; ep; ep = ep->bind_next) {
+        if (ep == ignore || !ep->bound || ep->local_port != port) continue;
         if (ipv6_address_is_unspecified(&ep->local_address6) || ipv6_address_is_unspecified(address) || ipv6_address_equal(&ep->local_address6, address)) return 1;
     }
     return 0;
 }
 
-/* Insert a PCB into the first free global table slot. */
-static int tcp_insert_locked(tcp_endpoint_t *endpoint)
+/* Congestion control */
+
+/* Switch algorithms, keeping the current window but starting the algorithm's private state afresh. */
+static void tcp_cc_select(tcp_endpoint_t *endpoint, const tcp_congestion_ops_t *ops)
+{
+    endpoint->cc_ops = ops;
+    memset(endpoint->cc.priv, 0, sizeof(endpoint->cc.priv));
+    if (ops->init) ops->init(&endpoint->cc);
+}
+
+/* Refresh the connection facts the algorithm reads before calling one of its hooks. */
+static void tcp_cc_sync(tcp_endpoint_t *endpoint)
 {
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++) {
-        if (!tcp_table[i]) {
-            tcp_table[i] = endpoint;
-            return 0;
-        }
-    }
-    return -ENOSPC;
+    endpoint->cc.mss         = endpoint->peer_mss;
+    endpoint->cc.flight      = endpoint->snd_nxt - endpoint->snd_una;
+    endpoint->cc.in_recovery = endpoint->fast_recovery;
 }
 
-/* Allocate a fresh PCB and insert it into the global table */
-static tcp_endpoint_t *tcp_alloc_locked(void)
+/*
+ * Refill the pacing token bucket at the algorithm's pacing rate and return
+ * the bytes that may be sent now, or UINT32_MAX when the connection is
+ * unpaced.  The bucket holds at most two ticks' worth (and never less than
+ * two segments) so an idle connection cannot bank a line-rate burst.
+ */
+static uint32_t tcp_pacing_refill(tcp_endpoint_t *endpoint, uint64_t now)
 {
-    tcp_endpoint_t *endpoint = calloc(1, sizeof(*endpoint));
+    uint64_t rate = endpoint->cc_ops->pacing_rate ? endpoint->cc_ops->pacing_rate(&endpoint->cc) : 0;
+    if (!rate) {
+        endpoint->pacing_stamp = now;
+        return UINT32_MAX;
+    }
+    uint64_t burst = rate * 2U / TIMER_HZ;
+    if (burst < 2U * (uint64_t)endpoint->peer_mss) burst = 2U * (uint64_t)endpoint->peer_mss;
+    if (burst > UINT32_MAX / 2) burst = UINT32_MAX / 2;
+    uint64_t elapsed = now - endpoint->pacing_stamp;
+    if (elapsed > TIMER_HZ) elapsed = TIMER_HZ;
+    uint64_t earned = rate * elapsed / TIMER_HZ;
+    if (earned) {
+        uint64_t tokens         = endpoint->pacing_tokens + earned;
+        endpoint->pacing_tokens = tokens > burst ? (uint32_t)burst : (uint32_t)tokens;
+        endpoint->pacing_stamp  = now;
+    }
+    return endpoint->pacing_tokens;
+}
+
+/* PCB lifetime */
+
+/* Allocate a fresh, unhashed PCB holding one reference, with an rx_capacity-byte receive ring */
+static tcp_endpoint_t *tcp_alloc(uint32_t rx_capacity)
+{
+    tcp_endpoint_t *endpoint = tcp_endpoint_cache ? slab_cache_alloc(tcp_endpoint_cache) : NULL;
     if (!endpoint) {
         plogk("tcp: PCB alloc failed.\n");
         return NULL;
     }
-    endpoint->rx_data = malloc(TCP_RX_BUFFER_MAX);
+    memset(endpoint, 0, sizeof(*endpoint));
+    endpoint->rx_data = malloc(rx_capacity);
     if (!endpoint->rx_data) {
-        plogk("tcp: RX buffer alloc failed (%u bytes)\n", (unsigned)TCP_RX_BUFFER_MAX);
-        free(endpoint);
+        plogk("tcp: RX buffer alloc failed (%u bytes)\n", (unsigned)rx_capacity);
+        slab_cache_free(tcp_endpoint_cache, endpoint);
         return NULL;
     }
+    endpoint->rx_capacity        = rx_capacity;
     endpoint->state              = TCP_CLOSED;
     endpoint->peer_window        = UINT16_MAX;
     endpoint->peer_mss           = TCP_DEFAULT_MSS;
-    endpoint->cwnd               = TCP_LOCAL_MSS;
-    endpoint->ssthresh           = UINT16_MAX;
+    endpoint->cc.cwnd            = TCP_LOCAL_MSS;
+    endpoint->cc.ssthresh        = UINT32_MAX;
+    endpoint->cc.mss             = TCP_DEFAULT_MSS;
     endpoint->rto                = TCP_RTO_TICKS;
     endpoint->keepalive_idle     = TCP_KEEPIDLE_DEFAULT_TICKS;
     endpoint->keepalive_interval = TCP_KEEPINTVL_DEFAULT_TICKS;
     endpoint->keepalive_count    = TCP_KEEPCNT_DEFAULT;
     endpoint->syn_retries        = TCP_SYN_RETRIES_DEFAULT;
     endpoint->data_retries       = TCP_DATA_RETRIES_DEFAULT;
+    endpoint->refcount           = 1;
+    tcp_cc_select(endpoint, tcp_congestion_default());
+    ilist_init(&endpoint->children);
     wait_queue_init(&endpoint->wait);
-    if (tcp_insert_locked(endpoint)) {
-        plogk("tcp: PCB table full.\n");
-        free(endpoint->rx_data);
-        free(endpoint);
-        return NULL;
-    }
     return endpoint;
 }
 
 tcp_endpoint_t *tcp_open_family(uint16_t family)
 {
-    spin_lock(&tcp_table_lock);
-    tcp_endpoint_t *endpoint = tcp_alloc_locked();
+    tcp_endpoint_t *endpoint = tcp_alloc(TCP_RX_BUFFER_DEFAULT);
     if (endpoint) endpoint->family = family;
-    spin_unlock(&tcp_table_lock);
     return endpoint;
 }
 
@@ -358,24 +833,72 @@ tcp_endpoint_t *tcp_open(void)
     return tcp_open_family(AF_INET);
 }
 
-/* Free a chain of transmitted-but-unacked segments */
-static void tcp_records_free(tcp_tx_record_t *record)
+/* Drop a child from its listener's child list and accept queue. */
+static void tcp_detach_child(tcp_endpoint_t *parent, tcp_endpoint_t *child)
 {
-    while (record) {
-        tcp_tx_record_t *next = record->next;
-        free(record);
-        record = next;
+    spin_lock(&parent->lock);
+    if (ilist_is_linked(&child->sibling)) {
+        ilist_remove(&child->sibling);
+        parent->child_count--;
+    }
+    for (unsigned i = 0; i < TCP_ACCEPT_MAX; i++) {
+        if (parent->accept_queue[i] != child) continue;
+        parent->accept_queue[i] = NULL;
+        if (parent->accept_count) parent->accept_count--;
     }
+    spin_unlock(&parent->lock);
 }
 
-/* Free a chain of queued out-of-order segments */
-static void tcp_ooo_free(tcp_ooo_record_t *record)
+/*
+ * Tear a PCB down: unhash it so no new segment can find it, detach it from
+ * its listener, destroy any children it still owns (listeners), and drop the
+ * owner's reference.  Lookups that already pinned the PCB keep the memory
+ * until they finish; they only ever see it CLOSED.
+ */
+static void tcp_destroy(tcp_endpoint_t *endpoint)
 {
-    while (record) {
-        tcp_ooo_record_t *next = record->next;
-        free(record);
-        record = next;
+    spin_lock(&endpoint->lock);
+    if (endpoint->destroyed) {
+        spin_unlock(&endpoint->lock);
+        return;
     }
+    endpoint->destroyed       = 1;
+    endpoint->state           = TCP_CLOSED;
+    tcp_endpoint_t   *parent  = endpoint->parent;
+    tcp_tx_record_t  *records = endpoint->tx_head;
+    tcp_ooo_record_t *ooo     = endpoint->ooo_head;
+    endpoint->parent          = NULL;
+    endpoint->tx_head         = NULL;
+    endpoint->tx_tail         = NULL;
+    endpoint->tx_count        = 0;
+    endpoint->ooo_head        = NULL;
+    endpoint->accept_count    = 0;
+    memset(endpoint->accept_queue, 0, sizeof(endpoint->accept_queue));
+    spin_unlock(&endpoint->lock);
+
+    tcp_timer_cancel(endpoint);
+    tcp_hash_remove(endpoint);
+    if (endpoint->bound) tcp_bind_remove(endpoint);
+    if (parent) {
+        tcp_detach_child(parent, endpoint);
+        tcp_endpoint_put(parent);
+    }
+    for (;;) {
+        spin_lock(&endpoint->lock);
+        if (ilist_is_empty(&endpoint->children)) {
+            spin_unlock(&endpoint->lock);
+            break;
+        }
+        tcp_endpoint_t *child = container_of(endpoint->children.next, tcp_endpoint_t, sibling);
+        ilist_remove(&child->sibling);
+        endpoint->child_count--;
+        spin_unlock(&endpoint->lock);
+        tcp_destroy(child);
+    }
+    wait_queue_wake_all(&endpoint->wait);
+    tcp_records_free(records);
+    tcp_ooo_free(ooo);
+    tcp_endpoint_put(endpoint);
 }
 
 /* Close a socket: send FIN on established connections, tear down the PCB */
@@ -389,34 +912,6 @@ void tcp_close(tcp_endpoint_t *endpoint)
         spin_unlock(&endpoint->lock);
         return;
     }
-    if (endpoint->state == TCP_CLOSED) {
-        endpoint->orphaned        = 1;
-        tcp_tx_record_t  *records = endpoint->tx_head;
-        tcp_ooo_record_t *ooo     = endpoint->ooo_head;
-        endpoint->tx_head         = NULL;
-        endpoint->ooo_head        = NULL;
-        spin_unlock(&endpoint->lock);
-        spin_lock(&tcp_table_lock);
-        for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++)
-            if (tcp_table[i] == endpoint) tcp_table[i] = NULL;
-        spin_unlock(&tcp_table_lock);
-        if (endpoint->parent) {
-            tcp_endpoint_t *parent = endpoint->parent;
-            spin_lock(&parent->lock);
-            for (unsigned i = 0; i < TCP_ACCEPT_MAX; i++) {
-                if (parent->accept_queue[i] != endpoint) continue;
-                parent->accept_queue[i] = NULL;
-                if (parent->accept_count) parent->accept_count--;
-            }
-            spin_unlock(&parent->lock);
-        }
-        wait_queue_wake_all(&endpoint->wait);
-        tcp_records_free(records);
-        tcp_ooo_free(ooo);
-        free(endpoint->rx_data);
-        free(endpoint);
-        return;
-    }
     if (endpoint->state == TCP_ESTABLISHED || endpoint->state == TCP_CLOSE_WAIT) {
         tcp_state_t next = endpoint->state == TCP_ESTABLISHED ? TCP_FIN_WAIT_1 : TCP_LAST_ACK;
         if (!tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_FIN | TCP_FLAG_ACK, NULL, 0, 1)) {
@@ -427,49 +922,10 @@ void tcp_close(tcp_endpoint_t *endpoint)
             return;
         }
     }
-    endpoint->state           = TCP_CLOSED;
-    endpoint->orphaned        = 0;
-    tcp_tx_record_t  *records = endpoint->tx_head;
-    tcp_ooo_record_t *ooo     = endpoint->ooo_head;
-    endpoint->tx_head         = NULL;
-    endpoint->ooo_head        = NULL;
+    endpoint->state    = TCP_CLOSED;
+    endpoint->orphaned = 1;
     spin_unlock(&endpoint->lock);
-    spin_lock(&tcp_table_lock);
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++)
-        if (tcp_table[i] == endpoint) tcp_table[i] = NULL;
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++) {
-        tcp_endpoint_t *child = tcp_table[i];
-        if (!child || child->parent != endpoint) continue;
-        for (unsigned j = 0; j < TCP_ACCEPT_MAX; j++) {
-            if (endpoint->accept_queue[j] == child) {
-                endpoint->accept_queue[j] = NULL;
-                if (endpoint->accept_count) endpoint->accept_count--;
-                break;
-            }
-        }
-        tcp_table[i] = NULL;
-        tcp_records_free(child->tx_head);
-        tcp_ooo_free(child->ooo_head);
-        free(child->rx_data);
-        free(child);
-    }
-    spin_unlock(&tcp_table_lock);
-    if (endpoint->parent) {
-        tcp_endpoint_t *parent = endpoint->parent;
-        spin_lock(&parent->lock);
-        for (unsigned i = 0; i < TCP_ACCEPT_MAX; i++) {
-            if (parent->accept_queue[i] != endpoint) continue;
-            parent->accept_queue[i] = NULL;
-            if (parent->accept_count) parent->accept_count--;
-        }
-        spin_unlock(&parent->lock);
-    }
-    memset(endpoint->accept_queue, 0, sizeof(endpoint->accept_queue));
-    wait_queue_wake_all(&endpoint->wait);
-    tcp_records_free(records);
-    tcp_ooo_free(ooo);
-    free(endpoint->rx_data);
-    free(endpoint);
+    tcp_destroy(endpoint);
 }
 
 /* Bind a local address/port, or autobind an ephemeral port if port == 0 */
@@ -477,15 +933,16 @@ int tcp_bind(tcp_endpoint_t *endpoint, uint32_t address, uint16_t port)
 {
     if (!endpoint) return -EINVAL;
     if (!port) return tcp_autobind(endpoint, address);
-    spin_lock(&tcp_table_lock);
+    spin_lock(&tcp_bind_lock);
     if (endpoint->bound || tcp_port_used_locked(address, port, endpoint)) {
-        spin_unlock(&tcp_table_lock);
+        spin_unlock(&tcp_bind_lock);
         return endpoint->bound ? -EINVAL : -EADDRINUSE;
     }
     endpoint->local_address = address;
     endpoint->local_port    = port;
     endpoint->bound         = 1;
-    spin_unlock(&tcp_table_lock);
+    tcp_bind_insert_locked(endpoint);
+    spin_unlock(&tcp_bind_lock);
     return 0;
 }
 
@@ -498,15 +955,16 @@ int tcp_bind6(tcp_endpoint_t *endpoint, const ipv6_address_t *address, uint16_t
         if (!status) endpoint->local_address6 = *address;
         return status;
     }
-    spin_lock(&tcp_table_lock);
+    spin_lock(&tcp_bind_lock);
     if (endpoint->bound || tcp_port_used6_locked(address, port, endpoint)) {
-        spin_unlock(&tcp_table_lock);
+        spin_unlock(&tcp_bind_lock);
         return endpoint->bound ? -EINVAL : -EADDRINUSE;
     }
     endpoint->local_address6 = *address;
     endpoint->local_port     = port;
     endpoint->bound          = 1;
-    spin_unlock(&tcp_table_lock);
+    tcp_bind_insert_locked(endpoint);
+    spin_unlock(&tcp_bind_lock);
     return 0;
 }
 
@@ -514,7 +972,7 @@ int tcp_bind6(tcp_endpoint_t *endpoint, const ipv6_address_t *address, uint16_t
 static int tcp_autobind(tcp_endpoint_t *endpoint, uint32_t address)
 {
     if (endpoint->bound) return 0;
-    spin_lock(&tcp_table_lock);
+    spin_lock(&tcp_bind_lock);
     for (unsigned n = 0; n <= UINT16_MAX - TCP_EPHEMERAL_FIRST; n++) {
         uint16_t port = tcp_ephemeral++;
         if (tcp_ephemeral < TCP_EPHEMERAL_FIRST) tcp_ephemeral = TCP_EPHEMERAL_FIRST;
@@ -522,11 +980,12 @@ static int tcp_autobind(tcp_endpoint_t *endpoint, uint32_t address)
             endpoint->local_address = address;
             endpoint->local_port    = port;
             endpoint->bound         = 1;
-            spin_unlock(&tcp_table_lock);
+            tcp_bind_insert_locked(endpoint);
+            spin_unlock(&tcp_bind_lock);
             return 0;
         }
     }
-    spin_unlock(&tcp_table_lock);
+    spin_unlock(&tcp_bind_lock);
     return -EADDRINUSE;
 }
 
@@ -535,12 +994,14 @@ int tcp_listen(tcp_endpoint_t *endpoint, unsigned backlog)
 {
     if (!endpoint || !endpoint->bound || !backlog) return -EINVAL;
     spin_lock(&endpoint->lock);
-    if (endpoint->state != TCP_CLOSED) {
+    if (endpoint->state != TCP_CLOSED || endpoint->destroyed) {
         spin_unlock(&endpoint->lock);
         return -EINVAL;
     }
     endpoint->backlog = (uint8_t)(backlog > TCP_ACCEPT_MAX ? TCP_ACCEPT_MAX : backlog);
     endpoint->state   = TCP_LISTEN;
+    tcp_hash_remove(endpoint);
+    tcp_hash_insert(&tcp_listeners, endpoint, tcp_listener_hash(endpoint), 0);
     spin_unlock(&endpoint->lock);
     return 0;
 }
@@ -558,14 +1019,98 @@ tcp_endpoint_t *tcp_accept(tcp_endpoint_t *endpoint)
             endpoint->accept_queue[index] = NULL;
             endpoint->accept_head         = (uint8_t)((index + 1) % TCP_ACCEPT_MAX);
             endpoint->accept_count--;
-            accepted->parent = NULL;
+            if (ilist_is_linked(&accepted->sibling)) {
+                ilist_remove(&accepted->sibling);
+                endpoint->child_count--;
+            }
             break;
         }
     }
     spin_unlock(&endpoint->lock);
+    if (!accepted) return NULL;
+
+    /* The child's reference on its listener goes with the parent pointer. */
+    spin_lock(&accepted->lock);
+    int release = accepted->parent == endpoint;
+    if (release) accepted->parent = NULL;
+    spin_unlock(&accepted->lock);
+    if (release) tcp_endpoint_put(endpoint);
     return accepted;
 }
 
+/* Describe the OOO queue as SACK blocks, merging adjacent records; returns the block count. */
+static unsigned tcp_sack_blocks(const tcp_endpoint_t *endpoint, uint32_t blocks[][2], unsigned max)
+{
+    unsigned count = 0;
+    for (const tcp_ooo_record_t *record = endpoint->ooo_head; record; record = record->next) {
+        uint32_t end = record->sequence + record->length + record->fin;
+        if (count && blocks[count - 1][1] == record->sequence) {
+            blocks[count - 1][1] = end;
+            continue;
+        }
+        if (count == max) break;
+        blocks[count][0] = record->sequence;
+        blocks[count][1] = end;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Lay out the options of an outgoing segment, returning their length (a
+ * multiple of four).  An active SYN offers every extension, a SYN-ACK echoes
+ * the ones the peer offered, and later segments carry timestamps and SACK
+ * blocks once negotiated.
+ */
+static size_t tcp_write_options(const tcp_endpoint_t *endpoint, uint8_t flags, uint8_t *options)
+{
+    if (flags & TCP_FLAG_RST) return 0;
+    size_t length     = 0;
+    int    offer      = (flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) == TCP_FLAG_SYN;
+    int    timestamps = offer || endpoint->ts_ok;
+    if (flags & TCP_FLAG_SYN) {
+        options[length++] = TCP_OPT_MSS;
+        options[length++] = 4;
+        net_write_be16(options + length, TCP_LOCAL_MSS);
+        length += 2;
+        if (offer || endpoint->sack_ok) {
+            options[length++] = TCP_OPT_NOP;
+            options[length++] = TCP_OPT_NOP;
+            options[length++] = TCP_OPT_SACK_PERM;
+            options[length++] = 2;
+        }
+        if (offer || endpoint->wscale_ok) {
+            options[length++] = TCP_OPT_NOP;
+            options[length++] = TCP_OPT_WSCALE;
+            options[length++] = 3;
+            options[length++] = TCP_WSCALE_LOCAL;
+        }
+    }
+    if (timestamps) {
+        options[length++] = TCP_OPT_NOP;
+        options[length++] = TCP_OPT_NOP;
+        options[length++] = TCP_OPT_TIMESTAMP;
+        options[length++] = 10;
+        net_write_be32(options + length, (uint32_t)sched_ticks());
+        net_write_be32(options + length + 4, endpoint->ts_recent);
+        length += 8;
+    }
+    if (!(flags & TCP_FLAG_SYN) && endpoint->sack_ok && endpoint->ooo_head) {
+        uint32_t blocks[TCP_SACK_BLOCKS_MAX][2];
+        unsigned count    = tcp_sack_blocks(endpoint, blocks, timestamps ? TCP_SACK_BLOCKS_MAX - 1U : TCP_SACK_BLOCKS_MAX);
+        options[length++] = TCP_OPT_NOP;
+        options[length++] = TCP_OPT_NOP;
+        options[length++] = TCP_OPT_SACK;
+        options[length++] = (uint8_t)(2U + 8U * count);
+        for (unsigned i = 0; i < count; i++) {
+            net_write_be32(options + length, blocks[i][0]);
+            net_write_be32(options + length + 4, blocks[i][1]);
+            length += 8;
+        }
+    }
+    return length;
+}
+
 /*
  * Segment emission
  * Build a TCP segment, checksum it, and hand it to the IP layer.
@@ -573,7 +1118,9 @@ tcp_endpoint_t *tcp_accept(tcp_endpoint_t *endpoint)
  */
 static int tcp_emit(tcp_endpoint_t *endpoint, uint32_t sequence, uint32_t acknowledgment, uint8_t flags, const void *data, size_t length, int track)
 {
-    size_t header_length = TCP_HEADER_LEN + ((flags & TCP_FLAG_SYN) ? 4U : 0U);
+    uint8_t options[TCP_OPTIONS_MAX];
+    size_t  options_length = tcp_write_options(endpoint, flags, options);
+    size_t  header_length  = TCP_HEADER_LEN + options_length;
     if (length > UINT16_MAX - header_length) return -EMSGSIZE;
     net_device_t  *device;
     uint32_t       next_hop;
@@ -594,17 +1141,19 @@ static int tcp_emit(tcp_endpoint_t *endpoint, uint32_t sequence, uint32_t acknow
     net_write_be32(tcp + 8, acknowledgment);
     tcp[12] = (uint8_t)((header_length / 4U) << 4);
     tcp[13] = flags;
-    net_write_be16(tcp + 14, tcp_window(endpoint));
-    if (flags & TCP_FLAG_SYN) {
-        tcp[20] = 2;
-        tcp[21] = 4;
-        net_write_be16(tcp + 22, TCP_LOCAL_MSS);
-    }
+    net_write_be16(tcp + 14, tcp_window_field(endpoint, flags));
+    if (options_length) memcpy(tcp + TCP_HEADER_LEN, options, options_length);
+    if (flags & TCP_FLAG_ACK) endpoint->last_ack_sent = acknowledgment;
     if (length) memcpy(tcp + header_length, data, length);
     if (endpoint->native6 && ipv6_address_is_unspecified(&endpoint->local_address6)) endpoint->local_address6 = source6;
-    uint16_t checksum = endpoint->native6 ? net_checksum_ipv6_pseudo(&endpoint->local_address6, &endpoint->remote_address6, IPV6_NEXT_TCP, tcp, packet->length) :
-                                            net_checksum_ipv4_pseudo(endpoint->local_address, endpoint->remote_address, IPV4_PROTO_TCP, tcp, packet->length);
-    net_write_be16(tcp + 16, checksum);
+    if (!endpoint->native6 && (device->flags & NETDEV_F_TX_CSUM)) {
+        net_write_be16(tcp + 16, net_checksum_ipv4_pseudo_partial(endpoint->local_address, endpoint->remote_address, IPV4_PROTO_TCP, packet->length));
+        net_pbuf_checksum_partial(packet, tcp, 16);
+    } else {
+        uint16_t checksum = endpoint->native6 ? net_checksum_ipv6_pseudo(&endpoint->local_address6, &endpoint->remote_address6, IPV6_NEXT_TCP, tcp, packet->length) :
+                                                net_checksum_ipv4_pseudo(endpoint->local_address, endpoint->remote_address, IPV4_PROTO_TCP, tcp, packet->length);
+        net_write_be16(tcp + 16, checksum);
+    }
     tcp_tx_record_t *record          = NULL;
     uint32_t         sequence_length = (uint32_t)length + !!(flags & TCP_FLAG_SYN) + !!(flags & TCP_FLAG_FIN);
     if (track && sequence_length) {
@@ -624,6 +1173,8 @@ static int tcp_emit(tcp_endpoint_t *endpoint, uint32_t sequence, uint32_t acknow
         record->deadline      = sched_ticks() + endpoint->rto;
         record->sent_at       = sched_ticks();
         record->retransmitted = 0;
+        record->sacked        = 0;
+        record->recovery_sent = 0;
         if (length) memcpy(record->data, data, length);
     }
     status = endpoint->native6 ? ipv6_output(device, &endpoint->local_address6, &endpoint->remote_address6, IPV6_NEXT_TCP, 64, packet) :
@@ -635,9 +1186,13 @@ static int tcp_emit(tcp_endpoint_t *endpoint, uint32_t sequence, uint32_t acknow
         return status;
     }
     if (record) {
-        tcp_tx_record_t **tail = &endpoint->tx_head;
-        while (*tail) tail = &(*tail)->next;
-        *tail = record;
+        if (endpoint->tx_tail)
+            endpoint->tx_tail->next = record;
+        else
+            endpoint->tx_head = record;
+        endpoint->tx_tail = record;
+        endpoint->tx_count++;
+        tcp_timer_schedule_locked(endpoint);
     }
     return 0;
 }
@@ -650,23 +1205,33 @@ int tcp_connect(tcp_endpoint_t *endpoint, uint32_t address, uint16_t port)
     uint32_t      next_hop;
     int           status = ipv4_route(address, &device, &next_hop);
     if (status) return status;
-    status = tcp_autobind(endpoint, device->ipv4_address);
+    uint32_t source = device->ipv4_address;
+    status          = tcp_autobind(endpoint, source);
     netdev_put(device);
     if (status) return status;
     spin_lock(&endpoint->lock);
-    if (endpoint->state != TCP_CLOSED) {
+    if (endpoint->state != TCP_CLOSED || endpoint->destroyed) {
         spin_unlock(&endpoint->lock);
         return -EALREADY;
     }
+
+    /* The connection table is keyed on the exact tuple, so pin the source address now. */
+    if (!endpoint->local_address) endpoint->local_address = source;
     endpoint->remote_address = address;
     endpoint->native6        = 0;
     endpoint->remote_port    = port;
-    endpoint->snd_una        = tcp_new_iss();
-    endpoint->snd_nxt        = endpoint->snd_una + 1;
-    endpoint->state          = TCP_SYN_SENT;
-    endpoint->last_received  = sched_ticks();
-    endpoint->error          = 0;
-    status                   = tcp_emit(endpoint, endpoint->snd_una, 0, TCP_FLAG_SYN, NULL, 0, 1);
+    tcp_hash_remove(endpoint);
+    status = tcp_hash_insert(&tcp_established, endpoint, tcp_endpoint_hash(endpoint), 1);
+    if (status) {
+        spin_unlock(&endpoint->lock);
+        return status;
+    }
+    endpoint->snd_una       = tcp_new_iss();
+    endpoint->snd_nxt       = endpoint->snd_una + 1;
+    endpoint->state         = TCP_SYN_SENT;
+    endpoint->last_received = sched_ticks();
+    endpoint->error         = 0;
+    status                  = tcp_emit(endpoint, endpoint->snd_una, 0, TCP_FLAG_SYN, NULL, 0, 1);
     if (status) endpoint->state = TCP_CLOSED;
     spin_unlock(&endpoint->lock);
     return status ? status : -EINPROGRESS;
@@ -683,7 +1248,7 @@ int tcp_connect6(tcp_endpoint_t *endpoint, const ipv6_address_t *address, uint16
     netdev_put(device);
     if (status) return status;
     spin_lock(&endpoint->lock);
-    if (endpoint->state != TCP_CLOSED) {
+    if (endpoint->state != TCP_CLOSED || endpoint->destroyed) {
         spin_unlock(&endpoint->lock);
         return -EALREADY;
     }
@@ -691,18 +1256,24 @@ int tcp_connect6(tcp_endpoint_t *endpoint, const ipv6_address_t *address, uint16
     endpoint->native6         = 1;
     endpoint->remote_address6 = *address;
     endpoint->remote_port     = port;
-    endpoint->snd_una         = tcp_new_iss();
-    endpoint->snd_nxt         = endpoint->snd_una + 1;
-    endpoint->state           = TCP_SYN_SENT;
-    endpoint->last_received   = sched_ticks();
-    endpoint->error           = 0;
-    status                    = tcp_emit(endpoint, endpoint->snd_una, 0, TCP_FLAG_SYN, NULL, 0, 1);
+    tcp_hash_remove(endpoint);
+    status = tcp_hash_insert(&tcp_established, endpoint, tcp_endpoint_hash(endpoint), 1);
+    if (status) {
+        spin_unlock(&endpoint->lock);
+        return status;
+    }
+    endpoint->snd_una       = tcp_new_iss();
+    endpoint->snd_nxt       = endpoint->snd_una + 1;
+    endpoint->state         = TCP_SYN_SENT;
+    endpoint->last_received = sched_ticks();
+    endpoint->error         = 0;
+    status                  = tcp_emit(endpoint, endpoint->snd_una, 0, TCP_FLAG_SYN, NULL, 0, 1);
     if (status) endpoint->state = TCP_CLOSED;
     spin_unlock(&endpoint->lock);
     return status ? status : -EINPROGRESS;
 }
 
-/* Send data, segmenting by the peer MSS and honoring the congestion window */
+/* Send data, segmenting by the peer MSS and honoring the congestion window and pacing rate */
 int tcp_send(tcp_endpoint_t *endpoint, const void *data, size_t length)
 {
     if (!endpoint || (!data && length)) return -EINVAL;
@@ -719,10 +1290,9 @@ int tcp_send(tcp_endpoint_t *endpoint, const void *data, size_t length)
     }
     size_t sent = 0;
     while (sent < length) {
-        unsigned records     = tcp_tx_count(endpoint);
         uint32_t flight      = endpoint->snd_nxt - endpoint->snd_una;
-        uint32_t send_window = endpoint->peer_window < endpoint->cwnd ? endpoint->peer_window : endpoint->cwnd;
-        if (records >= TCP_TX_SEGMENT_MAX || send_window <= flight) {
+        uint32_t send_window = endpoint->peer_window < endpoint->cc.cwnd ? endpoint->peer_window : endpoint->cc.cwnd;
+        if (endpoint->tx_count >= TCP_TX_SEGMENT_MAX || send_window <= flight) {
             if (!endpoint->peer_window) {
                 if (!endpoint->tx_head && !endpoint->persist_needed && sent < length) {
                     endpoint->persist_byte   = ((const uint8_t *)data)[sent];
@@ -740,20 +1310,33 @@ int tcp_send(tcp_endpoint_t *endpoint, const void *data, size_t length)
         if (chunk > endpoint->peer_mss) chunk = endpoint->peer_mss;
         if (chunk > allowed) chunk = allowed;
         if (!chunk) break;
+        uint32_t budget = tcp_pacing_refill(endpoint, sched_ticks());
+        if (budget < chunk) {
+            endpoint->pacing_blocked = 1;
+            break;
+        }
         int status = tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK | TCP_FLAG_PSH, (const uint8_t *)data + sent, chunk, 1);
         if (status) {
             spin_unlock(&endpoint->lock);
             return sent ? (int)sent : status;
         }
+        if (budget != UINT32_MAX) endpoint->pacing_tokens -= (uint32_t)chunk;
         endpoint->snd_nxt += (uint32_t)chunk;
         sent += chunk;
     }
+    tcp_timer_schedule_locked(endpoint);
     spin_unlock(&endpoint->lock);
     return sent ? (int)sent : -EAGAIN;
 }
 
-/* Copy received bytes out of the RX buffer, updating the advertised window */
-int tcp_receive(tcp_endpoint_t *endpoint, void *data, size_t capacity)
+/*
+ * Copy received bytes out of the RX ring (leaving them queued when peek is
+ * set).  A window update goes out once the window a segment can carry has
+ * grown by two segments or half the buffer beyond what was last advertised;
+ * without window scaling that value saturates at 64 KiB, so a large buffer
+ * being drained does not ACK every read.
+ */
+int tcp_receive(tcp_endpoint_t *endpoint, void *data, size_t capacity, int peek)
 {
     if (!endpoint || (!data && capacity)) return -EINVAL;
     spin_lock(&endpoint->lock);
@@ -764,10 +1347,19 @@ int tcp_receive(tcp_endpoint_t *endpoint, void *data, size_t capacity)
     }
     size_t copied = endpoint->rx_length < capacity ? endpoint->rx_length : capacity;
     if (copied) {
-        memcpy(data, endpoint->rx_data, copied);
-        memmove(endpoint->rx_data, endpoint->rx_data + copied, endpoint->rx_length - copied);
-        endpoint->rx_length -= (uint16_t)copied;
-        if (tcp_window(endpoint) > copied) tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
+        size_t first = endpoint->rx_capacity - endpoint->rx_head;
+        if (first > copied) first = copied;
+        memcpy(data, endpoint->rx_data + endpoint->rx_head, first);
+        if (copied > first) memcpy((uint8_t *)data + first, endpoint->rx_data, copied - first);
+    }
+    if (copied && !peek) {
+        endpoint->rx_head += (uint32_t)copied;
+        if (endpoint->rx_head >= endpoint->rx_capacity) endpoint->rx_head -= endpoint->rx_capacity;
+        endpoint->rx_length -= (uint32_t)copied;
+        if (!endpoint->rx_length) endpoint->rx_head = 0;
+        uint32_t advertisable = tcp_window_advertisable(endpoint, endpoint->rcv_wscale);
+        uint32_t growth       = advertisable > endpoint->rcv_wnd_sent ? advertisable - endpoint->rcv_wnd_sent : 0;
+        if (growth && (growth >= 2U * TCP_LOCAL_MSS || growth >= endpoint->rx_capacity / 2)) tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
     }
     spin_unlock(&endpoint->lock);
     return (int)copied;
@@ -816,6 +1408,30 @@ int tcp_get_error(tcp_endpoint_t *endpoint)
     return error;
 }
 
+/* Resize the RX ring, keeping queued bytes in order; called with the lock held. */
+static int tcp_rx_resize_locked(tcp_endpoint_t *endpoint, uint32_t capacity)
+{
+    uint32_t used = endpoint->rx_length + endpoint->ooo_length;
+    if (capacity < TCP_RX_BUFFER_MIN) capacity = TCP_RX_BUFFER_MIN;
+    if (capacity > TCP_RX_BUFFER_MAX) capacity = TCP_RX_BUFFER_MAX;
+    if (capacity < used) capacity = used;
+    if (capacity == endpoint->rx_capacity) return 0;
+    uint8_t *data = malloc(capacity);
+    if (!data) {
+        plogk("tcp: RX buffer resize failed (%u bytes)\n", (unsigned)capacity);
+        return -ENOMEM;
+    }
+    uint32_t first = endpoint->rx_capacity - endpoint->rx_head;
+    if (first > endpoint->rx_length) first = endpoint->rx_length;
+    memcpy(data, endpoint->rx_data + endpoint->rx_head, first);
+    memcpy(data + first, endpoint->rx_data, endpoint->rx_length - first);
+    free(endpoint->rx_data);
+    endpoint->rx_data     = data;
+    endpoint->rx_capacity = capacity;
+    endpoint->rx_head     = 0;
+    return 0;
+}
+
 int tcp_set_option(tcp_endpoint_t *endpoint, tcp_option_t option, uint32_t value)
 {
     if (!endpoint) return -EINVAL;
@@ -857,6 +1473,15 @@ int tcp_set_option(tcp_endpoint_t *endpoint, tcp_option_t option, uint32_t value
             else
                 endpoint->data_retries = (uint8_t)value;
             break;
+        case TCP_OPTION_RCVBUF :
+            status = tcp_rx_resize_locked(endpoint, value);
+            break;
+        case TCP_OPTION_CONGESTION :
+            if (!tcp_congestion_get(value))
+                status = -ENOENT;
+            else
+                tcp_cc_select(endpoint, tcp_congestion_get(value));
+            break;
         default :
             status = -ENOPROTOOPT;
             break;
@@ -865,6 +1490,7 @@ int tcp_set_option(tcp_endpoint_t *endpoint, tcp_option_t option, uint32_t value
         endpoint->keepalive_probe_count = 0;
         endpoint->keepalive_deadline    = sched_ticks() + endpoint->keepalive_idle;
     }
+    tcp_timer_schedule_locked(endpoint);
     spin_unlock(&endpoint->lock);
     return status;
 }
@@ -893,6 +1519,12 @@ int tcp_get_option(tcp_endpoint_t *endpoint, tcp_option_t option, uint32_t *valu
         case TCP_OPTION_DATA_RETRIES :
             *value = endpoint->data_retries;
             break;
+        case TCP_OPTION_RCVBUF :
+            *value = endpoint->rx_capacity;
+            break;
+        case TCP_OPTION_CONGESTION :
+            *value = (uint32_t)tcp_congestion_id(endpoint->cc_ops->name);
+            break;
         default :
             status = -ENOPROTOOPT;
             break;
@@ -918,85 +1550,209 @@ static void tcp_trim_acked_record(tcp_tx_record_t *record, uint32_t acknowledgme
     }
 }
 
-/* Process an ACK: drop completed records, update RTT, and grow cwnd. */
-static void tcp_ack_records(tcp_endpoint_t *endpoint, uint32_t acknowledgment)
+/* Fold one RTT sample (in ticks) into SRTT/RTTVAR and recompute the RTO. */
+static void tcp_rtt_sample(tcp_endpoint_t *endpoint, uint32_t sample)
+{
+    if (!sample) sample = 1;
+    if (!endpoint->srtt) {
+        endpoint->srtt   = sample << 3;
+        endpoint->rttvar = sample << 1;
+    } else {
+        int32_t error = (int32_t)sample - (int32_t)(endpoint->srtt >> 3);
+        endpoint->srtt += error;
+        if (error < 0) error = -error;
+        endpoint->rttvar = (uint32_t)((int32_t)endpoint->rttvar + (error - (int32_t)(endpoint->rttvar >> 2)));
+    }
+    uint32_t rto  = (endpoint->srtt >> 3) + endpoint->rttvar;
+    endpoint->rto = rto < TCP_RTO_MIN ? TCP_RTO_MIN : (rto > TCP_RTO_MAX ? TCP_RTO_MAX : rto);
+    endpoint->cc.srtt = endpoint->srtt >> 3;
+    if (!endpoint->cc.min_rtt || sample < endpoint->cc.min_rtt) endpoint->cc.min_rtt = sample;
+}
+
+/* RTT measured from an echoed timestamp (RFC 7323 section 4), or 0 if the segment has none. */
+static uint32_t tcp_timestamp_rtt(const tcp_endpoint_t *endpoint, const tcp_options_t *options)
+{
+    if (!endpoint->ts_ok || !options->has_timestamp || !options->tsecr) return 0;
+    uint32_t sample = (uint32_t)sched_ticks() - options->tsecr;
+    return sample > TCP_RTO_MAX ? 0 : (sample ? sample : 1);
+}
+
+/*
+ * First record still worth retransmitting in this recovery episode: the head
+ * if it has not been resent yet, otherwise (with SACK) the lowest un-SACKed
+ * record lying below the highest SACKed byte.
+ */
+static tcp_tx_record_t *tcp_next_hole(const tcp_endpoint_t *endpoint)
+{
+    tcp_tx_record_t *record = endpoint->tx_head;
+    if (!record) return NULL;
+    if (!record->sacked && !record->recovery_sent) return record;
+    if (!endpoint->sack_ok) return NULL;
+    for (record = record->next; record && seq_before(record->sequence, endpoint->highest_sack); record = record->next)
+        if (!record->sacked && !record->recovery_sent) return record;
+    return NULL;
+}
+
+/* Retransmit the next hole in the scoreboard, if any. */
+static void tcp_retransmit_hole(tcp_endpoint_t *endpoint, uint64_t now)
+{
+    tcp_tx_record_t *record = tcp_next_hole(endpoint);
+    if (!record) return;
+    tcp_emit(endpoint, record->sequence, endpoint->rcv_nxt, record->flags, record->data, record->length, 0);
+    record->retransmitted = 1;
+    record->recovery_sent = 1;
+    record->deadline      = now + endpoint->rto;
+    endpoint->retransmissions++;
+}
+
+/* Mark records covered by the peer's SACK blocks (RFC 2018 scoreboard). */
+static void tcp_sack_update(tcp_endpoint_t *endpoint, const tcp_options_t *options)
+{
+    if (!endpoint->sack_ok) return;
+    for (unsigned i = 0; i < options->sack_count; i++) {
+        uint32_t left  = options->sack[i][0];
+        uint32_t right = options->sack[i][1];
+        if (!seq_before(left, right) || seq_before(left, endpoint->snd_una) || seq_after(right, endpoint->snd_nxt)) continue;
+        for (tcp_tx_record_t *record = endpoint->tx_head; record && seq_before(record->sequence, right); record = record->next)
+            if (!seq_before(record->sequence, left) && !seq_after(record->end_sequence, right)) record->sacked = 1;
+        if (seq_after(right, endpoint->highest_sack)) endpoint->highest_sack = right;
+    }
+}
+
+/* Forget the scoreboard after a retransmission timeout; the peer may have reneged. */
+static void tcp_sack_reset(tcp_endpoint_t *endpoint)
+{
+    for (tcp_tx_record_t *record = endpoint->tx_head; record; record = record->next) {
+        record->sacked        = 0;
+        record->recovery_sent = 0;
+    }
+    endpoint->highest_sack = endpoint->snd_una;
+}
+
+/* Enter fast recovery on the third duplicate ACK: the algorithm picks ssthresh, then resend the first hole. */
+static void tcp_enter_recovery(tcp_endpoint_t *endpoint, uint64_t now)
+{
+    tcp_cc_sync(endpoint);
+    endpoint->cc_ops->on_loss(&endpoint->cc, now);
+    endpoint->cc.cwnd       = endpoint->cc.ssthresh + 3U * endpoint->peer_mss;
+    endpoint->recover       = endpoint->snd_nxt;
+    endpoint->fast_recovery = 1;
+    for (tcp_tx_record_t *record = endpoint->tx_head; record; record = record->next) record->recovery_sent = 0;
+    tcp_retransmit_hole(endpoint, now);
+}
+
+/*
+ * Process an ACK: drop completed records, update RTT, and let the congestion
+ * algorithm grow cwnd.  A timestamp-derived rtt_sample, when non-zero,
+ * replaces per-record timing.  Partial ACKs during recovery resend the next
+ * scoreboard hole.
+ */
+static void tcp_ack_records(tcp_endpoint_t *endpoint, uint32_t acknowledgment, uint32_t rtt_sample)
 {
     uint32_t newly_acked = acknowledgment - endpoint->snd_una;
     uint64_t now         = sched_ticks();
+    uint32_t sample      = rtt_sample;
     while (endpoint->tx_head && !seq_before(acknowledgment, endpoint->tx_head->end_sequence)) {
         tcp_tx_record_t *record = endpoint->tx_head;
         endpoint->tx_head       = record->next;
-        if (!record->retransmitted) {
-            uint32_t sample = (uint32_t)(now - record->sent_at);
-            if (!sample) sample = 1;
-            if (!endpoint->srtt) {
-                endpoint->srtt   = sample << 3;
-                endpoint->rttvar = sample << 1;
-            } else {
-                int32_t error = (int32_t)sample - (int32_t)(endpoint->srtt >> 3);
-                endpoint->srtt += error;
-                if (error < 0) error = -error;
-                endpoint->rttvar = (uint32_t)((int32_t)endpoint->rttvar + (error - (int32_t)(endpoint->rttvar >> 2)));
-            }
-            uint32_t rto  = (endpoint->srtt >> 3) + endpoint->rttvar;
-            endpoint->rto = rto < TCP_RTO_MIN ? TCP_RTO_MIN : (rto > TCP_RTO_MAX ? TCP_RTO_MAX : rto);
+        endpoint->tx_count--;
+        if (!rtt_sample && !record->retransmitted) {
+            sample = (uint32_t)(now - record->sent_at);
+            tcp_rtt_sample(endpoint, sample);
         }
         free(record);
     }
+    if (!endpoint->tx_head) endpoint->tx_tail = NULL;
+    if (rtt_sample) tcp_rtt_sample(endpoint, rtt_sample);
     if (endpoint->tx_head && seq_after(acknowledgment, endpoint->tx_head->sequence)) tcp_trim_acked_record(endpoint->tx_head, acknowledgment);
     endpoint->snd_una = acknowledgment;
+    if (seq_before(endpoint->highest_sack, acknowledgment)) endpoint->highest_sack = acknowledgment;
     if (newly_acked) {
         if (endpoint->fast_recovery) {
             if (!seq_before(acknowledgment, endpoint->recover)) {
                 endpoint->fast_recovery = 0;
-                endpoint->cwnd          = endpoint->ssthresh;
+                endpoint->cc.cwnd       = endpoint->cc.ssthresh;
             } else {
-                endpoint->cwnd          = endpoint->ssthresh + endpoint->peer_mss;
-                tcp_tx_record_t *record = endpoint->tx_head;
-                if (record) {
-                    tcp_emit(endpoint, record->sequence, endpoint->rcv_nxt, record->flags, record->data, record->length, 0);
-                    record->retransmitted = 1;
-                    record->deadline      = now + endpoint->rto;
-                    endpoint->retransmissions++;
-                }
+                endpoint->cc.cwnd = endpoint->cc.ssthresh + endpoint->peer_mss;
+                tcp_retransmit_hole(endpoint, now);
             }
-        } else if (endpoint->cwnd < endpoint->ssthresh)
-            endpoint->cwnd += newly_acked < endpoint->peer_mss ? newly_acked : endpoint->peer_mss;
-        else {
-            uint32_t increase = endpoint->peer_mss * endpoint->peer_mss / endpoint->cwnd;
-            endpoint->cwnd += increase ? increase : 1;
         }
+        tcp_cc_sync(endpoint);
+        endpoint->cc_ops->on_ack(&endpoint->cc, newly_acked, sample, now);
         endpoint->duplicate_acks = 0;
         endpoint->last_ack       = acknowledgment;
     }
 }
 
-/* Extract the MSS option from a TCP header, clamping to sane bounds. */
-static uint16_t tcp_parse_mss(const uint8_t *tcp, size_t header_length)
+/* Decode the options of an inbound segment, clamping MSS and window shift to sane bounds. */
+static void tcp_parse_options(const uint8_t *tcp, size_t header_length, tcp_options_t *options)
 {
+    memset(options, 0, sizeof(*options));
+    options->mss  = TCP_DEFAULT_MSS;
     size_t offset = TCP_HEADER_LEN;
     while (offset < header_length) {
         uint8_t kind = tcp[offset];
-        if (!kind) break;
-        if (kind == 1) {
+        if (kind == TCP_OPT_EOL) break;
+        if (kind == TCP_OPT_NOP) {
             offset++;
             continue;
         }
         if (offset + 2 > header_length || tcp[offset + 1] < 2 || offset + tcp[offset + 1] > header_length) break;
-        if (kind == 2 && tcp[offset + 1] == 4) {
-            uint16_t mss = net_read_be16(tcp + offset + 2);
-            if (mss < TCP_DEFAULT_MSS) return TCP_DEFAULT_MSS;
-            return mss > TCP_LOCAL_MSS ? TCP_LOCAL_MSS : mss;
+        const uint8_t *option = tcp + offset;
+        uint8_t        length = option[1];
+        if (kind == TCP_OPT_MSS && length == 4) {
+            uint16_t mss = net_read_be16(option + 2);
+            options->mss = mss < TCP_DEFAULT_MSS ? TCP_DEFAULT_MSS : (mss > TCP_LOCAL_MSS ? TCP_LOCAL_MSS : mss);
+        } else if (kind == TCP_OPT_WSCALE && length == 3) {
+            options->has_wscale = 1;
+            options->wscale     = option[2] > TCP_WSCALE_MAX ? TCP_WSCALE_MAX : option[2];
+        } else if (kind == TCP_OPT_SACK_PERM && length == 2) {
+            options->sack_ok = 1;
+        } else if (kind == TCP_OPT_TIMESTAMP && length == 10) {
+            options->has_timestamp = 1;
+            options->tsval         = net_read_be32(option + 2);
+            options->tsecr         = net_read_be32(option + 6);
+        } else if (kind == TCP_OPT_SACK && length >= 10 && (length - 2U) % 8U == 0) {
+            for (size_t at = 2; at < length && options->sack_count < TCP_SACK_BLOCKS_MAX; at += 8) {
+                options->sack[options->sack_count][0] = net_read_be32(option + at);
+                options->sack[options->sack_count][1] = net_read_be32(option + at + 4);
+                options->sack_count++;
+            }
         }
-        offset += tcp[offset + 1];
+        offset += length;
     }
-    return TCP_DEFAULT_MSS;
+}
+
+/* Adopt the extensions offered in the peer's SYN or SYN-ACK. */
+static void tcp_negotiate(tcp_endpoint_t *endpoint, const tcp_options_t *options)
+{
+    endpoint->peer_mss     = options->mss;
+    endpoint->wscale_ok    = options->has_wscale;
+    endpoint->snd_wscale   = options->has_wscale ? options->wscale : 0;
+    endpoint->rcv_wscale   = options->has_wscale ? TCP_WSCALE_LOCAL : 0;
+    endpoint->sack_ok      = options->sack_ok;
+    endpoint->ts_ok        = options->has_timestamp;
+    endpoint->ts_recent    = options->tsval;
+    endpoint->highest_sack = endpoint->snd_una;
+}
+
+/*
+ * PAWS (RFC 7323 section 5): reject a non-SYN segment whose TSval is older
+ * than TS.Recent, otherwise refresh TS.Recent when the segment covers the
+ * last acknowledgment we sent.  Returns -1 if the segment must be dropped.
+ */
+static int tcp_check_timestamp(tcp_endpoint_t *endpoint, const tcp_options_t *options, uint32_t sequence, uint8_t flags)
+{
+    if (!endpoint->ts_ok || !options->has_timestamp || (flags & (TCP_FLAG_SYN | TCP_FLAG_RST))) return 0;
+    if ((int32_t)(options->tsval - endpoint->ts_recent) < 0) return -1;
+    if (!seq_after(sequence, endpoint->last_ack_sent)) endpoint->ts_recent = options->tsval;
+    return 0;
 }
 
 /* Insert an out-of-order segment into the sorted OOO queue. */
 static int tcp_queue_ooo(tcp_endpoint_t *endpoint, uint32_t sequence, const uint8_t *data, size_t length, int fin)
 {
-    if ((!length && !fin) || endpoint->ooo_count >= TCP_OOO_SEGMENT_MAX || length > UINT16_MAX || length > TCP_RX_BUFFER_MAX - endpoint->rx_length - endpoint->ooo_length) return -ENOBUFS;
+    if ((!length && !fin) || endpoint->ooo_count >= TCP_OOO_SEGMENT_MAX || length > UINT16_MAX || length > tcp_window(endpoint)) return -ENOBUFS;
     tcp_ooo_record_t **position = &endpoint->ooo_head;
     while (*position && seq_before((*position)->sequence, sequence)) position = &(*position)->next;
     if (*position && (*position)->sequence == sequence) return 0;
@@ -1018,7 +1774,7 @@ static int tcp_queue_ooo(tcp_endpoint_t *endpoint, uint32_t sequence, const uint
     if (length) memcpy(record->data, data, length);
     *position = record;
     endpoint->ooo_count++;
-    endpoint->ooo_length += (uint16_t)length;
+    endpoint->ooo_length += (uint32_t)length;
     return 0;
 }
 
@@ -1033,60 +1789,62 @@ static void tcp_received_fin(tcp_endpoint_t *endpoint)
     else if (endpoint->state == TCP_FIN_WAIT_2) {
         endpoint->state           = TCP_TIME_WAIT;
         endpoint->time_wait_until = sched_ticks() + TCP_TIME_WAIT_TICKS;
+        tcp_timer_schedule_locked(endpoint);
     }
 }
 
-/* Move contiguous OOO segments into the RX buffer once their sequence is next. */
+/* Append in-order bytes at the tail of the RX ring and advance rcv_nxt; the caller checked the space. */
+static void tcp_rx_append(tcp_endpoint_t *endpoint, const uint8_t *data, size_t length)
+{
+    uint32_t tail = endpoint->rx_head + endpoint->rx_length;
+    if (tail >= endpoint->rx_capacity) tail -= endpoint->rx_capacity;
+    size_t first = endpoint->rx_capacity - tail;
+    if (first > length) first = length;
+    memcpy(endpoint->rx_data + tail, data, first);
+    if (length > first) memcpy(endpoint->rx_data, data + first, length - first);
+    endpoint->rx_length += (uint32_t)length;
+    endpoint->rcv_nxt += (uint32_t)length;
+}
+
+/* Move contiguous OOO segments into the RX ring once their sequence is next. */
 static void tcp_drain_ooo(tcp_endpoint_t *endpoint)
 {
     while (endpoint->ooo_head && endpoint->ooo_head->sequence == endpoint->rcv_nxt) {
         tcp_ooo_record_t *record = endpoint->ooo_head;
-        if (record->length > TCP_RX_BUFFER_MAX - endpoint->rx_length) break;
+        if (record->length > endpoint->rx_capacity - endpoint->rx_length) break;
         endpoint->ooo_head = record->next;
         endpoint->ooo_count--;
         endpoint->ooo_length -= record->length;
-        if (record->length) {
-            memcpy(endpoint->rx_data + endpoint->rx_length, record->data, record->length);
-            endpoint->rx_length += record->length;
-            endpoint->rcv_nxt += record->length;
-        }
+        if (record->length) tcp_rx_append(endpoint, record->data, record->length);
         if (record->fin) tcp_received_fin(endpoint);
         free(record);
     }
 }
 
-/* Match an IPv4 4-tuple to a PCB, also returning any matching listener. */
-static tcp_endpoint_t *tcp_lookup_locked(const ipv4_info_t *ip, uint16_t source_port, uint16_t destination_port, tcp_endpoint_t **listener)
+/* Queue a segment's payload and FIN: in order into the RX ring, beyond rcv_nxt into the OOO queue. */
+static void tcp_receive_data(tcp_endpoint_t *endpoint, uint32_t sequence, uint8_t flags, const uint8_t *payload, size_t payload_length)
 {
-    *listener = NULL;
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++) {
-        tcp_endpoint_t *ep = tcp_table[i];
-        if (!ep || (ep->family != AF_INET && (ep->family != AF_INET6 || ep->v6only || !ipv6_address_is_unspecified(&ep->local_address6))) || !ep->bound || ep->local_port != destination_port
-            || (ep->local_address && ep->local_address != ip->destination))
-            continue;
-        if (ep->state == TCP_LISTEN)
-            *listener = ep;
-        else if (ep->remote_address == ip->source && ep->remote_port == source_port)
-            return ep;
+    uint32_t data_sequence   = sequence + !!(flags & TCP_FLAG_SYN);
+    size_t   accepted_length = payload_length;
+    int      fin             = !!(flags & TCP_FLAG_FIN);
+    if (seq_before(data_sequence, endpoint->rcv_nxt)) {
+        uint32_t overlap = endpoint->rcv_nxt - data_sequence;
+        if (overlap >= accepted_length) {
+            if (overlap > accepted_length || !fin) fin = 0;
+            accepted_length = 0;
+        } else {
+            payload += overlap;
+            accepted_length -= overlap;
+        }
+        data_sequence = endpoint->rcv_nxt;
     }
-    return NULL;
-}
-
-/* Match an IPv6 4-tuple to a PCB, also returning any matching listener. */
-static tcp_endpoint_t *tcp_lookup6_locked(const ipv6_info_t *ip, uint16_t source_port, uint16_t destination_port, tcp_endpoint_t **listener)
-{
-    *listener = NULL;
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++) {
-        tcp_endpoint_t *ep = tcp_table[i];
-        if (!ep || ep->family != AF_INET6 || !ep->bound || ep->local_port != destination_port
-            || (!ipv6_address_is_unspecified(&ep->local_address6) && !ipv6_address_equal(&ep->local_address6, &ip->destination)))
-            continue;
-        if (ep->state == TCP_LISTEN)
-            *listener = ep;
-        else if (ipv6_address_equal(&ep->remote_address6, &ip->source) && ep->remote_port == source_port)
-            return ep;
+    if (seq_after(data_sequence, endpoint->rcv_nxt)) {
+        if (data_sequence - endpoint->rcv_nxt <= tcp_window(endpoint)) tcp_queue_ooo(endpoint, data_sequence, payload, accepted_length, fin);
+    } else if (accepted_length <= endpoint->rx_capacity - endpoint->rx_length) {
+        if (accepted_length) tcp_rx_append(endpoint, payload, accepted_length);
+        if (fin) tcp_received_fin(endpoint);
+        tcp_drain_ooo(endpoint);
     }
-    return NULL;
 }
 
 /* Send an RST reply for a segment that matched no connection. */
@@ -1104,17 +1862,36 @@ static int tcp_reset_reply(const ipv4_info_t *ip, uint16_t source_port, uint16_t
     return tcp_emit(&temporary, 0, ack, TCP_FLAG_RST | TCP_FLAG_ACK, NULL, 0, 0);
 }
 
+/*
+ * Hang a new SYN_RECEIVED child off its listener and publish it in the
+ * connection and bind tables.  The child pins the listener through its
+ * parent pointer.  Called with the listener locked.
+ */
+static int tcp_adopt_child(tcp_endpoint_t *listener, tcp_endpoint_t *child)
+{
+    tcp_endpoint_get(listener);
+    child->parent = listener;
+    ilist_insert_before(&listener->children, &child->sibling);
+    listener->child_count++;
+    spin_lock(&tcp_bind_lock);
+    tcp_bind_insert_locked(child);
+    spin_unlock(&tcp_bind_lock);
+    return tcp_hash_insert(&tcp_established, child, tcp_endpoint_hash(child), 1);
+}
+
 /* Create a SYN_RECEIVED child for an IPv4 SYN on a listener. */
-static int tcp_passive_open(tcp_endpoint_t *listener, const ipv4_info_t *ip, uint16_t source_port, uint32_t sequence, uint16_t peer_mss)
+static int tcp_passive_open(tcp_endpoint_t *listener, const ipv4_info_t *ip, uint16_t source_port, uint32_t sequence, const tcp_options_t *options)
 {
-    unsigned pending = 0;
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++)
-        if (tcp_table[i] && tcp_table[i]->parent == listener) pending++;
-    if (pending >= listener->backlog) return -ENOBUFS;
-    tcp_endpoint_t *child = tcp_alloc_locked();
+    spin_lock(&listener->lock);
+    if (listener->state != TCP_LISTEN || listener->child_count >= listener->backlog) {
+        spin_unlock(&listener->lock);
+        return -ENOBUFS;
+    }
+    tcp_endpoint_t *child = tcp_alloc(listener->rx_capacity);
     if (!child) {
         plogk("tcp: Passive open alloc failed (local port=%u peer=%u.%u.%u.%u:%u)\n", (unsigned)listener->local_port, (unsigned)(ip->source >> 24) & 0xff, (unsigned)(ip->source >> 16) & 0xff,
               (unsigned)(ip->source >> 8) & 0xff, (unsigned)ip->source & 0xff, (unsigned)source_port);
+        spin_unlock(&listener->lock);
         return -ENOBUFS;
     }
     child->bound              = 1;
@@ -1129,7 +1906,6 @@ static int tcp_passive_open(tcp_endpoint_t *listener, const ipv4_info_t *ip, uin
     child->snd_una            = tcp_new_iss();
     child->snd_nxt            = child->snd_una + 1;
     child->state              = TCP_SYN_RECEIVED;
-    child->peer_mss           = peer_mss;
     child->last_received      = sched_ticks();
     child->keepalive_idle     = listener->keepalive_idle;
     child->keepalive_interval = listener->keepalive_interval;
@@ -1137,29 +1913,32 @@ static int tcp_passive_open(tcp_endpoint_t *listener, const ipv4_info_t *ip, uin
     child->syn_retries        = listener->syn_retries;
     child->data_retries       = listener->data_retries;
     child->keepalive_enabled  = listener->keepalive_enabled;
-    child->parent             = listener;
-    spin_lock(&child->lock);
-    int status = tcp_emit(child, child->snd_una, child->rcv_nxt, TCP_FLAG_SYN | TCP_FLAG_ACK, NULL, 0, 1);
-    spin_unlock(&child->lock);
-    if (status) {
-        for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++)
-            if (tcp_table[i] == child) tcp_table[i] = NULL;
-        free(child->rx_data);
-        free(child);
+    tcp_cc_select(child, listener->cc_ops);
+    tcp_negotiate(child, options);
+
+    int status = tcp_adopt_child(listener, child);
+    spin_unlock(&listener->lock);
+    if (!status) {
+        spin_lock(&child->lock);
+        status = tcp_emit(child, child->snd_una, child->rcv_nxt, TCP_FLAG_SYN | TCP_FLAG_ACK, NULL, 0, 1);
+        spin_unlock(&child->lock);
     }
+    if (status) tcp_destroy(child);
     return status;
 }
 
 /* Create a SYN_RECEIVED child for an IPv6 SYN on a listener. */
-static int tcp_passive_open6(tcp_endpoint_t *listener, const ipv6_info_t *ip, uint16_t source_port, uint32_t sequence, uint16_t peer_mss)
+static int tcp_passive_open6(tcp_endpoint_t *listener, const ipv6_info_t *ip, uint16_t source_port, uint32_t sequence, const tcp_options_t *options)
 {
-    unsigned pending = 0;
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++)
-        if (tcp_table[i] && tcp_table[i]->parent == listener) pending++;
-    if (pending >= listener->backlog) return -ENOBUFS;
-    tcp_endpoint_t *child = tcp_alloc_locked();
+    spin_lock(&listener->lock);
+    if (listener->state != TCP_LISTEN || listener->child_count >= listener->backlog) {
+        spin_unlock(&listener->lock);
+        return -ENOBUFS;
+    }
+    tcp_endpoint_t *child = tcp_alloc(listener->rx_capacity);
     if (!child) {
         plogk("tcp: Passive open6 alloc failed (local port=%u peer=%u)\n", (unsigned)listener->local_port, (unsigned)source_port);
+        spin_unlock(&listener->lock);
         return -ENOBUFS;
     }
     child->bound           = 1;
@@ -1174,18 +1953,18 @@ static int tcp_passive_open6(tcp_endpoint_t *listener, const ipv6_info_t *ip, ui
     child->snd_una         = tcp_new_iss();
     child->snd_nxt         = child->snd_una + 1;
     child->state           = TCP_SYN_RECEIVED;
-    child->peer_mss        = peer_mss;
     child->last_received   = sched_ticks();
-    child->parent          = listener;
-    spin_lock(&child->lock);
-    int status = tcp_emit(child, child->snd_una, child->rcv_nxt, TCP_FLAG_SYN | TCP_FLAG_ACK, NULL, 0, 1);
-    spin_unlock(&child->lock);
-    if (status) {
-        for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++)
-            if (tcp_table[i] == child) tcp_table[i] = NULL;
-        free(child->rx_data);
-        free(child);
+    tcp_cc_select(child, listener->cc_ops);
+    tcp_negotiate(child, options);
+
+    int status = tcp_adopt_child(listener, child);
+    spin_unlock(&listener->lock);
+    if (!status) {
+        spin_lock(&child->lock);
+        status = tcp_emit(child, child->snd_una, child->rcv_nxt, TCP_FLAG_SYN | TCP_FLAG_ACK, NULL, 0, 1);
+        spin_unlock(&child->lock);
     }
+    if (status) tcp_destroy(child);
     return status;
 }
 
@@ -1201,49 +1980,51 @@ int tcp_input6(net_device_t *device, const ipv6_info_t *ip, net_pbuf_t *packet)
     uint32_t sequence         = net_read_be32(tcp + 4);
     uint32_t acknowledgment   = net_read_be32(tcp + 8);
     uint8_t  flags            = tcp[13];
-    uint16_t window           = net_read_be16(tcp + 14);
+    uint32_t window           = net_read_be16(tcp + 14);
     size_t   payload_length   = packet->length - header_length;
     if (!source_port || !destination_port || (flags & (TCP_FLAG_SYN | TCP_FLAG_FIN)) == (TCP_FLAG_SYN | TCP_FLAG_FIN)) goto bad;
+    tcp_options_t options;
+    tcp_parse_options(tcp, header_length, &options);
 
-    spin_lock(&tcp_table_lock);
-    tcp_endpoint_t *listener;
-    tcp_endpoint_t *endpoint = tcp_lookup6_locked(ip, source_port, destination_port, &listener);
+    tcp_endpoint_t *endpoint = tcp_lookup6(ip, source_port, destination_port);
     if (!endpoint) {
+        tcp_endpoint_t *listener = tcp_lookup_listener6(ip, destination_port);
         if (listener && (flags & TCP_FLAG_SYN) && !(flags & TCP_FLAG_ACK)) {
-            spin_lock(&listener->lock);
-            int status = tcp_passive_open6(listener, ip, source_port, sequence, tcp_parse_mss(tcp, header_length));
-            spin_unlock(&listener->lock);
-            spin_unlock(&tcp_table_lock);
+            int status = tcp_passive_open6(listener, ip, source_port, sequence, &options);
+            tcp_endpoint_put(listener);
             net_pbuf_free(packet);
             return status;
         }
-        spin_unlock(&tcp_table_lock);
+        if (listener) tcp_endpoint_put(listener);
         net_pbuf_free(packet);
         return -ECONNREFUSED;
     }
     spin_lock(&endpoint->lock);
-    spin_unlock(&tcp_table_lock);
+    if (!(flags & TCP_FLAG_SYN)) window <<= endpoint->snd_wscale;
     if (flags & TCP_FLAG_RST) {
         int acceptable = endpoint->state == TCP_SYN_SENT ? ((flags & TCP_FLAG_ACK) && acknowledgment == endpoint->snd_nxt) :
                                                            (!seq_before(sequence, endpoint->rcv_nxt) && !seq_after(sequence, endpoint->rcv_nxt + tcp_window(endpoint)));
         if (!acceptable) {
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
         endpoint->state          = TCP_CLOSED;
         endpoint->error          = ECONNRESET;
         tcp_event_callback_t cb  = endpoint->event_callback;
+        tcp_timer_schedule_locked(endpoint);
         void                *ctx = endpoint->event_context;
         wait_queue_wake_all(&endpoint->wait);
         spin_unlock(&endpoint->lock);
         if (cb) cb(endpoint, TCP_READY_ERROR | TCP_READY_READ | TCP_READY_HANGUP, ctx);
+        tcp_endpoint_put(endpoint);
         net_pbuf_free(packet);
         return -ECONNRESET;
     }
     endpoint->peer_window = window;
     if (endpoint->state == TCP_TIME_WAIT) {
-        uint16_t receive_window = tcp_window(endpoint);
+        uint32_t receive_window = tcp_window(endpoint);
         int      acceptable     = receive_window ? (!seq_before(sequence, endpoint->rcv_nxt) && seq_before(sequence, endpoint->rcv_nxt + receive_window)) : sequence == endpoint->rcv_nxt;
         if (acceptable) {
             uint32_t segment_end = sequence + (uint32_t)payload_length + !!(flags & TCP_FLAG_FIN);
@@ -1251,9 +2032,17 @@ int tcp_input6(net_device_t *device, const ipv6_info_t *ip, net_pbuf_t *packet)
             tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
         }
         spin_unlock(&endpoint->lock);
+        tcp_endpoint_put(endpoint);
         net_pbuf_free(packet);
         return 0;
     }
+    if (tcp_check_timestamp(endpoint, &options, sequence, flags)) {
+        tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
+        spin_unlock(&endpoint->lock);
+        tcp_endpoint_put(endpoint);
+        net_pbuf_free(packet);
+        return -EAGAIN;
+    }
     uint64_t now6                   = sched_ticks();
     endpoint->last_received         = now6;
     endpoint->keepalive_probe_count = 0;
@@ -1261,24 +2050,29 @@ int tcp_input6(net_device_t *device, const ipv6_info_t *ip, net_pbuf_t *packet)
     if (flags & TCP_FLAG_ACK) {
         if (seq_before(acknowledgment, endpoint->snd_una) || seq_after(acknowledgment, endpoint->snd_nxt)) {
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EBADMSG;
         }
-        if (seq_after(acknowledgment, endpoint->snd_una)) tcp_ack_records(endpoint, acknowledgment);
+        tcp_sack_update(endpoint, &options);
+        if (seq_after(acknowledgment, endpoint->snd_una)) tcp_ack_records(endpoint, acknowledgment, tcp_timestamp_rtt(endpoint, &options));
     }
+    tcp_timer_schedule_locked(endpoint);
     if (endpoint->state == TCP_SYN_SENT) {
         if ((flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) != (TCP_FLAG_SYN | TCP_FLAG_ACK) || acknowledgment != endpoint->snd_nxt) {
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
-        endpoint->rcv_nxt  = sequence + 1;
-        endpoint->peer_mss = tcp_parse_mss(tcp, header_length);
-        endpoint->state    = TCP_ESTABLISHED;
+        endpoint->rcv_nxt = sequence + 1;
+        endpoint->state   = TCP_ESTABLISHED;
+        tcp_negotiate(endpoint, &options);
         tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
     } else if (endpoint->state == TCP_SYN_RECEIVED) {
         if (!(flags & TCP_FLAG_ACK) || acknowledgment != endpoint->snd_nxt || sequence != endpoint->rcv_nxt) {
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
@@ -1305,14 +2099,16 @@ int tcp_input6(net_device_t *device, const ipv6_info_t *ip, net_pbuf_t *packet)
                && endpoint->state != TCP_LAST_ACK) {
         plogk("tcp: Segment on closed connection (local=%u remote=%u:%u)\n", (unsigned)endpoint->local_port, (unsigned)endpoint->remote_port, (unsigned)source_port);
         spin_unlock(&endpoint->lock);
+        tcp_endpoint_put(endpoint);
         net_pbuf_free(packet);
         return -ENOTCONN;
     } else if (endpoint->state != TCP_SYN_SENT && endpoint->state != TCP_SYN_RECEIVED) {
-        uint16_t receive_window = tcp_window(endpoint);
+        uint32_t receive_window = tcp_window(endpoint);
         int      sequence_valid = receive_window ? (!seq_before(sequence, endpoint->rcv_nxt) && seq_before(sequence, endpoint->rcv_nxt + receive_window)) : sequence == endpoint->rcv_nxt;
         if (!sequence_valid && !(payload_length && seq_before(sequence, endpoint->rcv_nxt) && seq_after(sequence + (uint32_t)payload_length, endpoint->rcv_nxt))) {
             tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
@@ -1326,40 +2122,17 @@ int tcp_input6(net_device_t *device, const ipv6_info_t *ip, net_pbuf_t *packet)
     } else if (endpoint->state == TCP_LAST_ACK && !seq_before(endpoint->snd_una, endpoint->snd_nxt))
         endpoint->state = TCP_CLOSED;
     if (payload_length || (flags & TCP_FLAG_FIN)) {
-        uint32_t       data_sequence   = sequence + !!(flags & TCP_FLAG_SYN);
-        const uint8_t *payload         = tcp + header_length;
-        size_t         accepted_length = payload_length;
-        int            fin             = !!(flags & TCP_FLAG_FIN);
-        if (seq_before(data_sequence, endpoint->rcv_nxt)) {
-            uint32_t overlap = endpoint->rcv_nxt - data_sequence;
-            if (overlap >= accepted_length) {
-                if (overlap > accepted_length || !fin) fin = 0;
-                accepted_length = 0;
-            } else {
-                payload += overlap;
-                accepted_length -= overlap;
-            }
-            data_sequence = endpoint->rcv_nxt;
-        }
-        if (seq_after(data_sequence, endpoint->rcv_nxt)) {
-            if (data_sequence - endpoint->rcv_nxt <= tcp_window(endpoint)) tcp_queue_ooo(endpoint, data_sequence, payload, accepted_length, fin);
-        } else if (accepted_length <= TCP_RX_BUFFER_MAX - endpoint->rx_length) {
-            if (accepted_length) {
-                memcpy(endpoint->rx_data + endpoint->rx_length, payload, accepted_length);
-                endpoint->rx_length += (uint16_t)accepted_length;
-                endpoint->rcv_nxt += (uint32_t)accepted_length;
-            }
-            if (fin) tcp_received_fin(endpoint);
-            tcp_drain_ooo(endpoint);
-        }
+        tcp_receive_data(endpoint, sequence, flags, tcp + header_length, payload_length);
         tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
     }
+    tcp_timer_schedule_locked(endpoint);
     uint32_t             ready6 = tcp_ready_locked(endpoint);
     tcp_event_callback_t cb6    = endpoint->event_callback;
     void                *ctx6   = endpoint->event_context;
     wait_queue_wake_all(&endpoint->wait);
     spin_unlock(&endpoint->lock);
     if (cb6) cb6(endpoint, ready6, ctx6);
+    tcp_endpoint_put(endpoint);
     net_pbuf_free(packet);
     return 0;
 bad:
@@ -1379,57 +2152,61 @@ int tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
     if (!ip || !packet || packet->length < TCP_HEADER_LEN) goto bad;
     uint8_t *tcp           = packet->data;
     size_t   header_length = (size_t)(tcp[12] >> 4) * 4U;
-    if (header_length < TCP_HEADER_LEN || header_length > packet->length || net_checksum_ipv4_pseudo(ip->source, ip->destination, IPV4_PROTO_TCP, tcp, packet->length) != 0) goto bad;
+    if (header_length < TCP_HEADER_LEN || header_length > packet->length
+        || (!packet->csum_verified && net_checksum_ipv4_pseudo(ip->source, ip->destination, IPV4_PROTO_TCP, tcp, packet->length) != 0))
+        goto bad;
     uint16_t source_port      = net_read_be16(tcp);
     uint16_t destination_port = net_read_be16(tcp + 2);
     uint32_t sequence         = net_read_be32(tcp + 4);
     uint32_t acknowledgment   = net_read_be32(tcp + 8);
     uint8_t  flags            = tcp[13];
-    uint16_t window           = net_read_be16(tcp + 14);
+    uint32_t window           = net_read_be16(tcp + 14);
     size_t   payload_length   = packet->length - header_length;
     if (!source_port || !destination_port || (flags & (TCP_FLAG_SYN | TCP_FLAG_FIN)) == (TCP_FLAG_SYN | TCP_FLAG_FIN)) goto bad;
+    tcp_options_t options;
+    tcp_parse_options(tcp, header_length, &options);
 
-    spin_lock(&tcp_table_lock);
-    tcp_endpoint_t *listener;
-    tcp_endpoint_t *endpoint = tcp_lookup_locked(ip, source_port, destination_port, &listener);
+    tcp_endpoint_t *endpoint = tcp_lookup(ip, source_port, destination_port);
     if (!endpoint) {
+        tcp_endpoint_t *listener = tcp_lookup_listener(ip, destination_port);
         if (listener && (flags & TCP_FLAG_SYN) && !(flags & TCP_FLAG_ACK)) {
-            spin_lock(&listener->lock);
-            int status = tcp_passive_open(listener, ip, source_port, sequence, tcp_parse_mss(tcp, header_length));
-            spin_unlock(&listener->lock);
-            spin_unlock(&tcp_table_lock);
+            int status = tcp_passive_open(listener, ip, source_port, sequence, &options);
+            tcp_endpoint_put(listener);
             net_pbuf_free(packet);
             return status;
         }
-        spin_unlock(&tcp_table_lock);
+        if (listener) tcp_endpoint_put(listener);
         int status = tcp_reset_reply(ip, source_port, destination_port, sequence, acknowledgment, flags, payload_length);
         net_pbuf_free(packet);
         return status ? status : -ECONNREFUSED;
     }
     spin_lock(&endpoint->lock);
-    spin_unlock(&tcp_table_lock);
+    if (!(flags & TCP_FLAG_SYN)) window <<= endpoint->snd_wscale;
 
     if (flags & TCP_FLAG_RST) {
         int acceptable = endpoint->state == TCP_SYN_SENT ? ((flags & TCP_FLAG_ACK) && acknowledgment == endpoint->snd_nxt) :
                                                            (!seq_before(sequence, endpoint->rcv_nxt) && !seq_after(sequence, endpoint->rcv_nxt + tcp_window(endpoint)));
         if (!acceptable) {
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
         endpoint->state              = TCP_CLOSED;
         endpoint->error              = ECONNRESET;
         tcp_event_callback_t cb_rst  = endpoint->event_callback;
+        tcp_timer_schedule_locked(endpoint);
         void                *ctx_rst = endpoint->event_context;
         wait_queue_wake_all(&endpoint->wait);
         spin_unlock(&endpoint->lock);
         if (cb_rst) cb_rst(endpoint, TCP_READY_ERROR | TCP_READY_READ | TCP_READY_HANGUP, ctx_rst);
+        tcp_endpoint_put(endpoint);
         net_pbuf_free(packet);
         return -ECONNRESET;
     }
     uint64_t now = sched_ticks();
     if (endpoint->state == TCP_TIME_WAIT) {
-        uint16_t receive_window = tcp_window(endpoint);
+        uint32_t receive_window = tcp_window(endpoint);
         int      acceptable     = receive_window ? (!seq_before(sequence, endpoint->rcv_nxt) && seq_before(sequence, endpoint->rcv_nxt + receive_window)) : sequence == endpoint->rcv_nxt;
         if (acceptable) {
             uint32_t segment_end = sequence + (uint32_t)payload_length + !!(flags & TCP_FLAG_FIN);
@@ -1437,19 +2214,28 @@ int tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
             tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
         }
         spin_unlock(&endpoint->lock);
+        tcp_endpoint_put(endpoint);
         net_pbuf_free(packet);
         return 0;
     }
     if (endpoint->state != TCP_SYN_SENT && endpoint->state != TCP_SYN_RECEIVED && endpoint->state != TCP_LISTEN) {
-        uint16_t receive_window = tcp_window(endpoint);
+        uint32_t receive_window = tcp_window(endpoint);
         int      sequence_valid = receive_window ? (!seq_before(sequence, endpoint->rcv_nxt) && seq_before(sequence, endpoint->rcv_nxt + receive_window)) : sequence == endpoint->rcv_nxt;
         if (!sequence_valid && !(payload_length && seq_before(sequence, endpoint->rcv_nxt) && seq_after(sequence + (uint32_t)payload_length, endpoint->rcv_nxt))) {
             tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
     }
+    if (tcp_check_timestamp(endpoint, &options, sequence, flags)) {
+        tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
+        spin_unlock(&endpoint->lock);
+        tcp_endpoint_put(endpoint);
+        net_pbuf_free(packet);
+        return -EAGAIN;
+    }
     endpoint->last_received         = now;
     endpoint->keepalive_probe_count = 0;
     endpoint->keepalive_deadline    = endpoint->keepalive_enabled ? now + endpoint->keepalive_idle : 0;
@@ -1457,10 +2243,12 @@ int tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
         if (seq_before(acknowledgment, endpoint->snd_una) || seq_after(acknowledgment, endpoint->snd_nxt)) {
             tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EBADMSG;
         }
-        uint16_t previous_window = endpoint->peer_window;
+        uint32_t previous_window = endpoint->peer_window;
+        tcp_sack_update(endpoint, &options);
         if (seq_after(sequence, endpoint->snd_wl1) || (sequence == endpoint->snd_wl1 && !seq_before(acknowledgment, endpoint->snd_wl2))) {
             endpoint->peer_window = window;
             endpoint->snd_wl1     = sequence;
@@ -1480,36 +2268,30 @@ int tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
             }
         }
         if (acknowledgment == endpoint->snd_una && endpoint->tx_head && endpoint->peer_window && window == previous_window && !payload_length && !(flags & (TCP_FLAG_SYN | TCP_FLAG_FIN))) {
-            if (++endpoint->duplicate_acks == 3) {
-                uint32_t flight    = endpoint->snd_nxt - endpoint->snd_una;
-                endpoint->ssthresh = flight / 2;
-                if (endpoint->ssthresh < 2U * endpoint->peer_mss) endpoint->ssthresh = 2U * endpoint->peer_mss;
-                endpoint->cwnd          = endpoint->ssthresh + 3U * endpoint->peer_mss;
-                endpoint->recover       = endpoint->snd_nxt;
-                endpoint->fast_recovery = 1;
-                tcp_tx_record_t *record = endpoint->tx_head;
-                tcp_emit(endpoint, record->sequence, endpoint->rcv_nxt, record->flags, record->data, record->length, 0);
-                record->retransmitted = 1;
-                record->deadline      = now + endpoint->rto;
-                endpoint->retransmissions++;
-            } else if (endpoint->duplicate_acks > 3)
-                endpoint->cwnd += endpoint->peer_mss;
+            if (++endpoint->duplicate_acks == 3)
+                tcp_enter_recovery(endpoint, now);
+            else if (endpoint->duplicate_acks > 3) {
+                endpoint->cc.cwnd += endpoint->peer_mss;
+                tcp_retransmit_hole(endpoint, now);
+            }
         } else if (seq_after(acknowledgment, endpoint->snd_una))
-            tcp_ack_records(endpoint, acknowledgment);
+            tcp_ack_records(endpoint, acknowledgment, tcp_timestamp_rtt(endpoint, &options));
     }
+    tcp_timer_schedule_locked(endpoint);
 
     if (endpoint->state == TCP_SYN_SENT) {
         if ((flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) != (TCP_FLAG_SYN | TCP_FLAG_ACK) || acknowledgment != endpoint->snd_nxt) {
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
         endpoint->rcv_nxt     = sequence + 1;
-        endpoint->peer_mss    = tcp_parse_mss(tcp, header_length);
         endpoint->peer_window = window;
         endpoint->snd_wl1     = sequence;
         endpoint->snd_wl2     = acknowledgment;
         endpoint->state       = TCP_ESTABLISHED;
+        tcp_negotiate(endpoint, &options);
         tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
     } else if (endpoint->state == TCP_SYN_RECEIVED && (flags & TCP_FLAG_SYN) && !(flags & TCP_FLAG_ACK)) {
         tcp_tx_record_t *record = endpoint->tx_head;
@@ -1519,11 +2301,13 @@ int tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
             record->deadline      = sched_ticks() + endpoint->rto;
         }
         spin_unlock(&endpoint->lock);
+        tcp_endpoint_put(endpoint);
         net_pbuf_free(packet);
         return 0;
     } else if (endpoint->state == TCP_SYN_RECEIVED) {
         if (!(flags & TCP_FLAG_ACK) || acknowledgment != endpoint->snd_nxt || sequence != endpoint->rcv_nxt) {
             spin_unlock(&endpoint->lock);
+            tcp_endpoint_put(endpoint);
             net_pbuf_free(packet);
             return -EAGAIN;
         }
@@ -1552,6 +2336,7 @@ int tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
                && endpoint->state != TCP_LAST_ACK) {
         plogk("tcp: Segment on closed connection (local=%u remote=%u:%u)\n", (unsigned)endpoint->local_port, (unsigned)endpoint->remote_port, (unsigned)source_port);
         spin_unlock(&endpoint->lock);
+        tcp_endpoint_put(endpoint);
         net_pbuf_free(packet);
         return -ENOTCONN;
     }
@@ -1566,40 +2351,17 @@ int tcp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
         endpoint->state = TCP_CLOSED;
 
     if (payload_length || (flags & TCP_FLAG_FIN)) {
-        uint32_t       data_sequence   = sequence + !!(flags & TCP_FLAG_SYN);
-        const uint8_t *payload         = tcp + header_length;
-        size_t         accepted_length = payload_length;
-        int            fin             = !!(flags & TCP_FLAG_FIN);
-        if (seq_before(data_sequence, endpoint->rcv_nxt)) {
-            uint32_t overlap = endpoint->rcv_nxt - data_sequence;
-            if (overlap >= accepted_length) {
-                if (overlap > accepted_length || !fin) fin = 0;
-                accepted_length = 0;
-            } else {
-                payload += overlap;
-                accepted_length -= overlap;
-            }
-            data_sequence = endpoint->rcv_nxt;
-        }
-        if (seq_after(data_sequence, endpoint->rcv_nxt)) {
-            if (data_sequence - endpoint->rcv_nxt <= tcp_window(endpoint)) tcp_queue_ooo(endpoint, data_sequence, payload, accepted_length, fin);
-        } else if (accepted_length <= TCP_RX_BUFFER_MAX - endpoint->rx_length) {
-            if (accepted_length) {
-                memcpy(endpoint->rx_data + endpoint->rx_length, payload, accepted_length);
-                endpoint->rx_length += (uint16_t)accepted_length;
-                endpoint->rcv_nxt += (uint32_t)accepted_length;
-            }
-            if (fin) tcp_received_fin(endpoint);
-            tcp_drain_ooo(endpoint);
-        }
+        tcp_receive_data(endpoint, sequence, flags, tcp + header_length, payload_length);
         tcp_emit(endpoint, endpoint->snd_nxt, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
     }
+    tcp_timer_schedule_locked(endpoint);
     uint32_t             ready = tcp_ready_locked(endpoint);
     tcp_event_callback_t cb    = endpoint->event_callback;
     void                *ctx   = endpoint->event_context;
     wait_queue_wake_all(&endpoint->wait);
     spin_unlock(&endpoint->lock);
     if (cb) cb(endpoint, ready, ctx);
+    tcp_endpoint_put(endpoint);
     net_pbuf_free(packet);
     return 0;
 bad:
@@ -1607,112 +2369,132 @@ bad:
     return -EBADMSG;
 }
 
-/*
- * Periodic timer
- * Called once per tick. Drives retransmission with exponential
- * backoff, zero-window persist probes, keepalive probes and the
- * TIME_WAIT expiry. Event callbacks are deferred until after the
- * global table lock is released.
- */
-void tcp_timer(uint64_t now_ticks)
+/* Run the retransmission, persist, keepalive and TIME_WAIT timers of one PCB, and release paced writers. */
+static void tcp_timer_endpoint(tcp_endpoint_t *endpoint, uint64_t now_ticks)
 {
-    tcp_endpoint_t      *deferred_ep[TCP_ENDPOINT_MAX];
-    tcp_event_callback_t deferred_cb[TCP_ENDPOINT_MAX];
-    void                *deferred_ctx[TCP_ENDPOINT_MAX];
-    uint32_t             deferred_ready[TCP_ENDPOINT_MAX];
-    int                  deferred_count = 0;
-
-    spin_lock(&tcp_table_lock);
-    for (unsigned i = 0; i < TCP_ENDPOINT_MAX; i++) {
-        tcp_endpoint_t *endpoint = tcp_table[i];
-        if (!endpoint) continue;
-        spin_lock(&endpoint->lock);
-        if ((endpoint->state == TCP_TIME_WAIT || endpoint->state == TCP_FIN_WAIT_2) && now_ticks >= endpoint->time_wait_until) endpoint->state = TCP_CLOSED;
-        int              failed = 0;
-        tcp_tx_record_t *record = endpoint->tx_head;
-        if (record && record->length && !endpoint->peer_window && endpoint->state != TCP_SYN_SENT && endpoint->state != TCP_SYN_RECEIVED) {
-            if (!endpoint->persist_deadline) {
-                endpoint->persist_interval = endpoint->rto > TCP_PERSIST_MIN ? endpoint->rto : TCP_PERSIST_MIN;
-                endpoint->persist_deadline = now_ticks + endpoint->persist_interval;
-            } else if (now_ticks >= endpoint->persist_deadline) {
-                tcp_emit(endpoint, endpoint->snd_nxt - 1U, endpoint->rcv_nxt, TCP_FLAG_ACK, record->data, 1, 0);
-                endpoint->persist_probes_sent++;
-                uint64_t doubled_ticks     = (uint64_t)endpoint->persist_interval * 2U;
-                endpoint->persist_interval = doubled_ticks > TCP_RTO_MAX ? TCP_RTO_MAX : (uint32_t)doubled_ticks;
-                endpoint->persist_deadline = now_ticks + endpoint->persist_interval;
-            }
-        } else if (!endpoint->peer_window && endpoint->persist_needed && endpoint->persist_deadline && now_ticks >= endpoint->persist_deadline) {
-            tcp_emit(endpoint, endpoint->snd_nxt - 1U, endpoint->rcv_nxt, TCP_FLAG_ACK, &endpoint->persist_byte, 1, 0);
+    spin_lock(&endpoint->lock);
+    if ((endpoint->state == TCP_TIME_WAIT || endpoint->state == TCP_FIN_WAIT_2) && now_ticks >= endpoint->time_wait_until) endpoint->state = TCP_CLOSED;
+    int              failed = 0;
+    tcp_tx_record_t *record = endpoint->tx_head;
+    if (record && record->length && !endpoint->peer_window && endpoint->state != TCP_SYN_SENT && endpoint->state != TCP_SYN_RECEIVED) {
+        if (!endpoint->persist_deadline) {
+            endpoint->persist_interval = endpoint->rto > TCP_PERSIST_MIN ? endpoint->rto : TCP_PERSIST_MIN;
+            endpoint->persist_deadline = now_ticks + endpoint->persist_interval;
+        } else if (now_ticks >= endpoint->persist_deadline) {
+            tcp_emit(endpoint, endpoint->snd_nxt - 1U, endpoint->rcv_nxt, TCP_FLAG_ACK, record->data, 1, 0);
             endpoint->persist_probes_sent++;
             uint64_t doubled_ticks     = (uint64_t)endpoint->persist_interval * 2U;
             endpoint->persist_interval = doubled_ticks > TCP_RTO_MAX ? TCP_RTO_MAX : (uint32_t)doubled_ticks;
             endpoint->persist_deadline = now_ticks + endpoint->persist_interval;
-        } else if (record && now_ticks >= record->deadline) {
-            uint8_t retry_limit = (endpoint->state == TCP_SYN_SENT || endpoint->state == TCP_SYN_RECEIVED) ? endpoint->syn_retries : endpoint->data_retries;
-            if (record->retries >= retry_limit) {
-                plogk("tcp: Retransmission timed out (local=%u remote=%u state=%u)\n", (unsigned)endpoint->local_port, (unsigned)endpoint->remote_port, (unsigned)endpoint->state);
-                tcp_fail_locked(endpoint, ETIMEDOUT);
-                failed = 1;
-            } else {
-                int status = tcp_emit(endpoint, record->sequence, endpoint->rcv_nxt, record->flags, record->data, record->length, 0);
-                record->retries++;
-                if (!status) {
-                    record->retransmitted = 1;
-                    endpoint->retransmissions++;
-                    uint32_t flight    = endpoint->snd_nxt - endpoint->snd_una;
-                    endpoint->ssthresh = flight / 2;
-                    if (endpoint->ssthresh < 2U * endpoint->peer_mss) endpoint->ssthresh = 2U * endpoint->peer_mss;
-                    endpoint->cwnd          = endpoint->peer_mss;
-                    endpoint->fast_recovery = 0;
-                }
-                uint32_t shift   = record->retries > 5 ? 5 : record->retries;
-                uint32_t backoff = endpoint->rto << shift;
-                record->deadline = now_ticks + (backoff > TCP_RTO_MAX ? TCP_RTO_MAX : backoff);
-            }
-        } else if (endpoint->keepalive_enabled && endpoint->state == TCP_ESTABLISHED && !record && now_ticks >= endpoint->keepalive_deadline) {
-            if (endpoint->keepalive_probe_count >= endpoint->keepalive_count) {
-                plogk("tcp: Keepalive timed out (local=%u remote=%u)\n", (unsigned)endpoint->local_port, (unsigned)endpoint->remote_port);
-                tcp_fail_locked(endpoint, ETIMEDOUT);
-                failed = 1;
-            } else {
-                tcp_emit(endpoint, endpoint->snd_nxt - 1U, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
-                endpoint->keepalive_probe_count++;
-                endpoint->keepalive_probes_sent++;
-                endpoint->keepalive_deadline = now_ticks + endpoint->keepalive_interval;
-            }
         }
-        if (failed) {
-            wait_queue_wake_all(&endpoint->wait);
-            if (!endpoint->orphaned) {
-                deferred_ep[deferred_count]    = endpoint;
-                deferred_cb[deferred_count]    = endpoint->event_callback;
-                deferred_ctx[deferred_count]   = endpoint->event_context;
-                deferred_ready[deferred_count] = tcp_ready_locked(endpoint);
-                deferred_count++;
-                spin_unlock(&endpoint->lock);
-            } else {
-                spin_unlock(&endpoint->lock);
-                tcp_table[i] = NULL;
-                tcp_records_free(endpoint->tx_head);
-                tcp_ooo_free(endpoint->ooo_head);
-                free(endpoint->rx_data);
-                free(endpoint);
-            }
+    } else if (!endpoint->peer_window && endpoint->persist_needed && endpoint->persist_deadline && now_ticks >= endpoint->persist_deadline) {
+        tcp_emit(endpoint, endpoint->snd_nxt - 1U, endpoint->rcv_nxt, TCP_FLAG_ACK, &endpoint->persist_byte, 1, 0);
+        endpoint->persist_probes_sent++;
+        uint64_t doubled_ticks     = (uint64_t)endpoint->persist_interval * 2U;
+        endpoint->persist_interval = doubled_ticks > TCP_RTO_MAX ? TCP_RTO_MAX : (uint32_t)doubled_ticks;
+        endpoint->persist_deadline = now_ticks + endpoint->persist_interval;
+    } else if (record && now_ticks >= record->deadline) {
+        uint8_t retry_limit = (endpoint->state == TCP_SYN_SENT || endpoint->state == TCP_SYN_RECEIVED) ? endpoint->syn_retries : endpoint->data_retries;
+        if (record->retries >= retry_limit) {
+            plogk("tcp: Retransmission timed out (local=%u remote=%u state=%u)\n", (unsigned)endpoint->local_port, (unsigned)endpoint->remote_port, (unsigned)endpoint->state);
+            tcp_fail_locked(endpoint, ETIMEDOUT);
+            failed = 1;
         } else {
-            int destroy = endpoint->orphaned && endpoint->state == TCP_CLOSED;
-            spin_unlock(&endpoint->lock);
-            if (destroy) {
-                tcp_table[i] = NULL;
-                tcp_records_free(endpoint->tx_head);
-                tcp_ooo_free(endpoint->ooo_head);
-                free(endpoint->rx_data);
-                free(endpoint);
+            tcp_sack_reset(endpoint);
+            int status = tcp_emit(endpoint, record->sequence, endpoint->rcv_nxt, record->flags, record->data, record->length, 0);
+            record->retries++;
+            if (!status) {
+                record->retransmitted = 1;
+                endpoint->retransmissions++;
+                endpoint->fast_recovery = 0;
+                tcp_cc_sync(endpoint);
+                endpoint->cc_ops->on_rto(&endpoint->cc, now_ticks);
             }
+            uint32_t shift   = record->retries > 5 ? 5 : record->retries;
+            uint32_t backoff = endpoint->rto << shift;
+            record->deadline = now_ticks + (backoff > TCP_RTO_MAX ? TCP_RTO_MAX : backoff);
         }
+    } else if (endpoint->keepalive_enabled && endpoint->state == TCP_ESTABLISHED && !record && now_ticks >= endpoint->keepalive_deadline) {
+        if (endpoint->keepalive_probe_count >= endpoint->keepalive_count) {
+            plogk("tcp: Keepalive timed out (local=%u remote=%u)\n", (unsigned)endpoint->local_port, (unsigned)endpoint->remote_port);
+            tcp_fail_locked(endpoint, ETIMEDOUT);
+            failed = 1;
+        } else {
+            tcp_emit(endpoint, endpoint->snd_nxt - 1U, endpoint->rcv_nxt, TCP_FLAG_ACK, NULL, 0, 0);
+            endpoint->keepalive_probe_count++;
+            endpoint->keepalive_probes_sent++;
+            endpoint->keepalive_deadline = now_ticks + endpoint->keepalive_interval;
+        }
+    }
+    int paced = 0;
+    if (!failed && endpoint->pacing_blocked && tcp_pacing_refill(endpoint, now_ticks) >= endpoint->peer_mss) {
+        endpoint->pacing_blocked = 0;
+        paced                    = 1;
     }
-    spin_unlock(&tcp_table_lock);
-    for (int i = 0; i < deferred_count; i++)
-        if (deferred_cb[i]) deferred_cb[i](deferred_ep[i], deferred_ready[i], deferred_ctx[i]);
+    if (failed) {
+        wait_queue_wake_all(&endpoint->wait);
+        int                  orphaned = endpoint->orphaned;
+        tcp_event_callback_t callback = endpoint->event_callback;
+        void                *context  = endpoint->event_context;
+        uint32_t             ready    = tcp_ready_locked(endpoint);
+        if (!orphaned) tcp_timer_schedule_locked(endpoint);
+        spin_unlock(&endpoint->lock);
+        if (orphaned)
+            tcp_destroy(endpoint);
+        else if (callback)
+            callback(endpoint, ready, context);
+    } else {
+        int                  destroy  = endpoint->orphaned && endpoint->state == TCP_CLOSED;
+        tcp_event_callback_t callback = paced ? endpoint->event_callback : NULL;
+        void                *context  = endpoint->event_context;
+        uint32_t             ready    = callback ? tcp_ready_locked(endpoint) : 0;
+        if (paced) wait_queue_wake_all(&endpoint->wait);
+        if (!destroy) tcp_timer_schedule_locked(endpoint);
+        spin_unlock(&endpoint->lock);
+        if (destroy)
+            tcp_destroy(endpoint);
+        else if (callback)
+            callback(endpoint, ready, context);
+    }
+}
+
+/*
+ * Periodic timer
+ * Called once per tick. Drives retransmission with exponential
+ * backoff, zero-window persist probes, keepalive probes and the
+ * TIME_WAIT expiry. Only PCBs whose earliest deadline has passed are
+ * visited: they are popped off the timer tree in batches and requeued
+ * for their next deadline by tcp_timer_endpoint(). Event callbacks run
+ * with no timer or table lock held.
+ */
+void tcp_timer(uint64_t now_ticks)
+{
+    tcp_endpoint_t *batch[TCP_TIMER_BATCH];
+    unsigned        count;
+    do {
+        count = 0;
+        spin_lock(&tcp_timer_lock);
+        while (count < TCP_TIMER_BATCH && !rb_is_empty(&tcp_timer_root)) {
+            tcp_endpoint_t *endpoint = rb_entry(rb_first(&tcp_timer_root), tcp_endpoint_t, timer_node);
+            if (endpoint->timer_due > now_ticks) break;
+            rb_erase_augmented(&tcp_timer_root, &endpoint->timer_node, NULL, NULL);
+            __atomic_store_n(&endpoint->timer_queued, 0, __ATOMIC_RELEASE);
+            batch[count++] = endpoint; // the tree's reference moves to the batch
+        }
+        spin_unlock(&tcp_timer_lock);
+        for (unsigned i = 0; i < count; i++) {
+            tcp_timer_endpoint(batch[i], now_ticks);
+            tcp_endpoint_put(batch[i]);
+        }
+    } while (count == TCP_TIMER_BATCH);
+}
+
+/* Create the PCB cache and seed the table hash; called once from net_init(). */
+void tcp_init(void)
+{
+    tcp_hash_seed      = (uint32_t)timer_realtime_ns() ^ tcp_new_iss();
+    tcp_endpoint_cache = slab_cache_create("tcp_endpoint", sizeof(tcp_endpoint_t), 64, NULL, NULL);
+    if (!tcp_endpoint_cache) plogk("tcp: PCB cache creation failed.\n");
 }
 
 /* Poll the ready-event mask without blocking (used by select/poll) */
@@ -1740,7 +2522,8 @@ int tcp_get_info(tcp_endpoint_t *endpoint, tcp_endpoint_info_t *info)
     info->state               = endpoint->state;
     info->receive_queued      = endpoint->rx_length;
     info->send_unacknowledged = endpoint->snd_nxt - endpoint->snd_una;
-    info->congestion_window   = endpoint->cwnd;
+    info->congestion_window   = endpoint->cc.cwnd;
+    info->ssthresh            = endpoint->cc.ssthresh;
     info->receive_window      = tcp_window(endpoint);
     info->send_window         = endpoint->peer_window;
     info->peer_mss            = endpoint->peer_mss;
@@ -1749,7 +2532,7 @@ int tcp_get_info(tcp_endpoint_t *endpoint, tcp_endpoint_info_t *info)
     info->keepalive_probes    = endpoint->keepalive_probes_sent;
     info->persist_probes      = endpoint->persist_probes_sent;
     info->duplicate_acks      = endpoint->duplicate_acks;
-    info->queued_segments     = tcp_tx_count(endpoint);
+    info->queued_segments     = endpoint->tx_count;
     info->last_received_ticks = endpoint->last_received;
     uint64_t next_timer       = endpoint->time_wait_until;
     if (endpoint->tx_head && !endpoint->persist_deadline && (!next_timer || endpoint->tx_head->deadline < next_timer)) next_timer = endpoint->tx_head->deadline;
@@ -1757,6 +2540,12 @@ int tcp_get_info(tcp_endpoint_t *endpoint, tcp_endpoint_info_t *info)
     if (endpoint->keepalive_deadline && (!next_timer || endpoint->keepalive_deadline < next_timer)) next_timer = endpoint->keepalive_deadline;
     info->next_timer_ticks  = next_timer;
     info->keepalive_enabled = endpoint->keepalive_enabled;
+    info->send_wscale       = endpoint->snd_wscale;
+    info->receive_wscale    = endpoint->rcv_wscale;
+    info->timestamps        = endpoint->ts_ok;
+    info->sack              = endpoint->sack_ok;
+    info->pacing_rate       = endpoint->cc_ops->pacing_rate ? endpoint->cc_ops->pacing_rate(&endpoint->cc) : 0;
+    info->congestion        = endpoint->cc_ops->name;
     spin_unlock(&endpoint->lock);
     return 0;
 }
@@ -0,0 +1,147 @@
+/*
+ *
+ *      tcp_bbr.c
+ *      BBR-style model-based congestion control with pacing
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <kernel/timer/timer.h>
+#include <net/transport/tcp_cong.h>
+
+#define BBR_BW_ROUNDS      10U  // rounds a bandwidth maximum is trusted before it may decay
+#define BBR_STARTUP_GAIN   289U // 2/ln(2), per 100
+#define BBR_DRAIN_GAIN     35U  // inverse of the startup gain, per 100
+#define BBR_CWND_GAIN      200U // cwnd allowance over the BDP in steady state, per 100
+#define BBR_FULL_BW_ROUNDS 3U   // rounds without 25% growth that end STARTUP
+#define BBR_CYCLE_LENGTH   8U
+#define BBR_MIN_SEGMENTS   4U
+
+typedef enum bbr_mode {
+    BBR_STARTUP,
+    BBR_DRAIN,
+    BBR_PROBE_BW,
+} bbr_mode_t;
+
+/* Per-connection model, overlaid on tcp_cc_t.priv */
+typedef struct bbr {
+        uint64_t btl_bw;          // windowed-max delivery rate, bytes per second
+        uint64_t full_bw;         // bandwidth STARTUP last grew to
+        uint64_t round_start;     // tick the current round began, 0 = none yet
+        uint64_t round_delivered; // bytes acknowledged in the current round
+        uint32_t bw_age;          // rounds since btl_bw was last raised
+        uint8_t  mode;            // bbr_mode_t
+        uint8_t  cycle_index;     // PROBE_BW gain phase
+        uint8_t  full_bw_count;
+} bbr_t;
+
+_Static_assert(sizeof(bbr_t) <= sizeof(((tcp_cc_t *)0)->priv), "bbr state exceeds tcp_cc_t.priv");
+
+/* PROBE_BW pacing gains: probe above the estimate, drain the excess, then cruise. */
+static const uint16_t bbr_cycle_gain[BBR_CYCLE_LENGTH] = {125, 75, 100, 100, 100, 100, 100, 100};
+
+/* Estimated bandwidth-delay product in bytes, 0 until both terms are known. */
+static uint64_t bbr_bdp(const bbr_t *bbr, const tcp_cc_t *cc)
+{
+    return bbr->btl_bw * cc->min_rtt / TIMER_HZ;
+}
+
+/* Feed a per-round delivery-rate sample into the windowed max filter. */
+static void bbr_update_bw(bbr_t *bbr, uint64_t sample)
+{
+    if (sample >= bbr->btl_bw || ++bbr->bw_age >= BBR_BW_ROUNDS) {
+        bbr->btl_bw = sample;
+        bbr->bw_age = 0;
+    }
+}
+
+/* Per-round state machine: detect a full pipe, drain the queue, cycle probing gains. */
+static void bbr_end_round(bbr_t *bbr, const tcp_cc_t *cc)
+{
+    switch (bbr->mode) {
+        case BBR_STARTUP :
+            if (bbr->btl_bw >= bbr->full_bw * 5U / 4U) {
+                bbr->full_bw       = bbr->btl_bw;
+                bbr->full_bw_count = 0;
+            } else if (++bbr->full_bw_count >= BBR_FULL_BW_ROUNDS)
+                bbr->mode = BBR_DRAIN;
+            break;
+        case BBR_DRAIN :
+            if (cc->flight <= bbr_bdp(bbr, cc)) {
+                bbr->mode        = BBR_PROBE_BW;
+                bbr->cycle_index = 0;
+            }
+            break;
+        default :
+            bbr->cycle_index = (uint8_t)((bbr->cycle_index + 1U) % BBR_CYCLE_LENGTH);
+            break;
+    }
+}
+
+/* Sample delivery once per round and size the window to a gain of the estimated BDP. */
+static void bbr_on_ack(tcp_cc_t *cc, uint32_t acked, uint32_t rtt, uint64_t now)
+{
+    (void)rtt;
+    bbr_t *bbr = (bbr_t *)cc->priv;
+    bbr->round_delivered += acked;
+    if (!bbr->round_start) bbr->round_start = now;
+
+    /* A round lasts one minimum RTT; its delivery rate is one bandwidth sample. */
+    uint64_t round   = cc->min_rtt ? cc->min_rtt : (cc->srtt ? cc->srtt : 1U);
+    uint64_t elapsed = now - bbr->round_start;
+    if (elapsed >= round) {
+        bbr_update_bw(bbr, bbr->round_delivered * TIMER_HZ / elapsed);
+        bbr->round_delivered = 0;
+        bbr->round_start     = now;
+        bbr_end_round(bbr, cc);
+    }
+    if (cc->in_recovery) return;
+
+    uint64_t floor = (uint64_t)BBR_MIN_SEGMENTS * cc->mss;
+    if (bbr->mode == BBR_STARTUP) {
+        cc->cwnd += acked;
+        return;
+    }
+    uint64_t target = bbr_bdp(bbr, cc) * (bbr->mode == BBR_DRAIN ? BBR_STARTUP_GAIN : BBR_CWND_GAIN) / 100U;
+    if (target < floor) target = floor;
+    cc->cwnd = target > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)target;
+}
+
+/* Loss is not a congestion signal for the model: recovery ends where it began. */
+static void bbr_on_loss(tcp_cc_t *cc, uint64_t now)
+{
+    (void)now;
+    cc->ssthresh = cc->cwnd;
+}
+
+/* After a timeout restart from one segment; the next ACK restores the model's window. */
+static void bbr_on_rto(tcp_cc_t *cc, uint64_t now)
+{
+    (void)now;
+    cc->ssthresh = cc->cwnd;
+    cc->cwnd     = cc->mss;
+}
+
+/* Pace at the bottleneck bandwidth scaled by the current mode's gain, in bytes per second. */
+static uint64_t bbr_pacing_rate(const tcp_cc_t *cc)
+{
+    const bbr_t *bbr = (const bbr_t *)cc->priv;
+    unsigned     gain;
+    if (bbr->mode == BBR_STARTUP)
+        gain = BBR_STARTUP_GAIN;
+    else if (bbr->mode == BBR_DRAIN)
+        gain = BBR_DRAIN_GAIN;
+    else
+        gain = bbr_cycle_gain[bbr->cycle_index];
+    return bbr->btl_bw * gain / 100U;
+}
+
+const tcp_congestion_ops_t tcp_bbr_ops = {
+    .name        = "bbr",
+    .on_ack      = bbr_on_ack,
+    .on_loss     = bbr_on_loss,
+    .on_rto      = bbr_on_rto,
+    .pacing_rate = bbr_pacing_rate,
+};
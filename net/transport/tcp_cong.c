@@ -0,0 +1,103 @@
+/*
+ *
+ *      tcp_cong.c
+ *      TCP congestion control registry and NewReno
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <kernel/errno.h>
+#include <libs/std/string.h>
+#include <net/transport/tcp_cong.h>
+
+static const tcp_congestion_ops_t *const tcp_congestion_table[] = {&tcp_cubic_ops, &tcp_reno_ops, &tcp_bbr_ops};
+
+#define TCP_CONGESTION_COUNT (sizeof(tcp_congestion_table) / sizeof(tcp_congestion_table[0]))
+
+static const tcp_congestion_ops_t *volatile tcp_congestion_default_ops = &tcp_cubic_ops;
+
+/* Halve the flight, never below two segments (RFC 5681 equation 4). */
+static uint32_t reno_half_flight(const tcp_cc_t *cc)
+{
+    uint32_t ssthresh = cc->flight / 2;
+    return ssthresh < 2U * cc->mss ? 2U * cc->mss : ssthresh;
+}
+
+/* Slow start below ssthresh, then one segment per window. */
+static void reno_on_ack(tcp_cc_t *cc, uint32_t acked, uint32_t rtt, uint64_t now)
+{
+    (void)rtt;
+    (void)now;
+    if (cc->in_recovery) return;
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd += acked < cc->mss ? acked : cc->mss;
+        return;
+    }
+    uint32_t increase = cc->mss * cc->mss / cc->cwnd;
+    cc->cwnd += increase ? increase : 1;
+}
+
+static void reno_on_loss(tcp_cc_t *cc, uint64_t now)
+{
+    (void)now;
+    cc->ssthresh = reno_half_flight(cc);
+}
+
+static void reno_on_rto(tcp_cc_t *cc, uint64_t now)
+{
+    (void)now;
+    cc->ssthresh = reno_half_flight(cc);
+    cc->cwnd     = cc->mss;
+}
+
+const tcp_congestion_ops_t tcp_reno_ops = {
+    .name    = "reno",
+    .on_ack  = reno_on_ack,
+    .on_loss = reno_on_loss,
+    .on_rto  = reno_on_rto,
+};
+
+/* Algorithm at index id, or NULL. */
+const tcp_congestion_ops_t *tcp_congestion_get(unsigned id)
+{
+    return id < TCP_CONGESTION_COUNT ? tcp_congestion_table[id] : NULL;
+}
+
+/* Index of the named algorithm, or -ENOENT. */
+int tcp_congestion_id(const char *name)
+{
+    if (!name) return -EINVAL;
+    for (unsigned i = 0; i < TCP_CONGESTION_COUNT; i++)
+        if (!strcmp(tcp_congestion_table[i]->name, name)) return (int)i;
+    return -ENOENT;
+}
+
+const tcp_congestion_ops_t *tcp_congestion_default(void)
+{
+    return tcp_congestion_default_ops;
+}
+
+/* Switch the algorithm given to new sockets; existing connections keep theirs. */
+int tcp_congestion_set_default(const char *name)
+{
+    int id = tcp_congestion_id(name);
+    if (id < 0) return id;
+    tcp_congestion_default_ops = tcp_congestion_table[id];
+    return 0;
+}
+
+void tcp_congestion_available(char *buffer, size_t size)
+{
+    size_t length = 0;
+    if (!buffer || !size) return;
+    buffer[0] = '\0';
+    for (unsigned i = 0; i < TCP_CONGESTION_COUNT; i++) {
+        size_t name_length = strlen(tcp_congestion_table[i]->name);
+        if (length + !!i + name_length + 1 > size) break;
+        if (i) buffer[length++] = ' ';
+        memcpy(buffer + length, tcp_congestion_table[i]->name, name_length + 1);
+        length += name_length;
+    }
+}
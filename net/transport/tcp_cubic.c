@@ -0,0 +1,136 @@
+/*
+ *
+ *      tcp_cubic.c
+ *      CUBIC congestion control (RFC 8312)
+ *
+ *      2026/10/18 By JiTianYu391
+ *      Copyright (C) 2020 ViudiraTech, based on the Apache 2.0 license.
+ *
+ */
+
+#include <kernel/timer/timer.h>
+#include <net/transport/tcp_cong.h>
+
+#define CUBIC_BETA       717U    // multiplicative decrease, per 1024 (0.7)
+#define CUBIC_FAST_CONV  870U    // W_max shrink under fast convergence, per 1024 ((1 + beta) / 2)
+#define CUBIC_RENO_ALPHA 541U    // TCP-friendly additive increase, per 1024 (3 * (1 - beta) / (1 + beta))
+#define CUBIC_T_MAX_MS   100000U // clamp on |t - K| so the cube stays within 64 bits
+
+/* Per-connection CUBIC state, overlaid on tcp_cc_t.priv */
+typedef struct cubic {
+        uint64_t epoch_start; // tick the current growth epoch began, 0 = none
+        uint64_t w_max;       // window (bytes) just before the last reduction
+        uint64_t origin;      // plateau of the cubic curve (bytes)
+        uint64_t k_ms;        // time to climb back to origin, in milliseconds
+        uint64_t w_est;       // TCP-friendly Reno estimate (bytes)
+} cubic_t;
+
+_Static_assert(sizeof(cubic_t) <= sizeof(((tcp_cc_t *)0)->priv), "cubic state exceeds tcp_cc_t.priv");
+
+/* Integer cube root, rounded down. */
+static uint64_t cubic_cbrt(uint64_t value)
+{
+    uint64_t root = 0;
+    for (int shift = 63; shift >= 0; shift -= 3) {
+        root <<= 1;
+        uint64_t next = root + 1;
+        if ((value >> shift) >= 3 * root * next + 1) {
+            value -= (3 * root * next + 1) << shift;
+            root = next;
+        }
+    }
+    return root;
+}
+
+/* Convert timer ticks to milliseconds. */
+static uint64_t cubic_ticks_ms(uint64_t ticks)
+{
+    return ticks * 1000U / TIMER_HZ;
+}
+
+/* Start a growth epoch: K = cbrt((W_max - cwnd) / C) with C = 0.4 segments/s^3. */
+static void cubic_begin_epoch(cubic_t *ca, const tcp_cc_t *cc, uint64_t now)
+{
+    ca->epoch_start = now ? now : 1;
+    ca->w_est       = cc->cwnd;
+    if (ca->w_max > cc->cwnd) {
+        ca->k_ms   = cubic_cbrt((ca->w_max - cc->cwnd) * 2500000000ULL / cc->mss);
+        ca->origin = ca->w_max;
+    } else {
+        ca->k_ms   = 0;
+        ca->origin = cc->cwnd;
+    }
+}
+
+/* Window the cubic curve reaches t_ms milliseconds into the epoch. */
+static uint64_t cubic_target(const cubic_t *ca, const tcp_cc_t *cc, uint64_t t_ms)
+{
+    uint64_t offset = t_ms > ca->k_ms ? t_ms - ca->k_ms : ca->k_ms - t_ms;
+    if (offset > CUBIC_T_MAX_MS) offset = CUBIC_T_MAX_MS;
+    uint64_t delta = offset * offset * offset * cc->mss * 4U / 10000000000ULL;
+    if (t_ms > ca->k_ms) return ca->origin + delta;
+    return ca->origin > delta ? ca->origin - delta : 0;
+}
+
+/* Slow-start below ssthresh, then grow toward the cubic curve one ACK at a time. */
+static void cubic_on_ack(tcp_cc_t *cc, uint32_t acked, uint32_t rtt, uint64_t now)
+{
+    (void)rtt;
+    cubic_t *ca = (cubic_t *)cc->priv;
+    if (cc->in_recovery) return;
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd += acked < cc->mss ? acked : cc->mss;
+        return;
+    }
+    if (!ca->epoch_start) cubic_begin_epoch(ca, cc, now);
+
+    /* Aim one RTT ahead, and never below what Reno would have reached. */
+    uint64_t t_ms   = cubic_ticks_ms(now - ca->epoch_start + cc->min_rtt);
+    uint64_t target = cubic_target(ca, cc, t_ms);
+    ca->w_est += (uint64_t)acked * cc->mss * CUBIC_RENO_ALPHA / 1024U / cc->cwnd;
+    if (target < ca->w_est) target = ca->w_est;
+
+    uint64_t increase;
+    if (target > cc->cwnd) {
+        increase = (target - cc->cwnd) * acked / cc->cwnd;
+        if (increase > acked / 2U) increase = acked / 2U; // at most 1.5x per RTT
+    } else
+        increase = (uint64_t)acked * cc->mss / (100U * (uint64_t)cc->cwnd);
+    if (!increase) increase = 1;
+    cc->cwnd = cc->cwnd + increase > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)(cc->cwnd + increase);
+}
+
+/* Remember the window we backed off from and cut it by beta. */
+static void cubic_reduce(tcp_cc_t *cc)
+{
+    cubic_t *ca = (cubic_t *)cc->priv;
+    if (cc->cwnd < ca->w_max)
+        ca->w_max = (uint64_t)cc->cwnd * CUBIC_FAST_CONV / 1024U;
+    else
+        ca->w_max = cc->cwnd;
+    ca->epoch_start = 0;
+    uint32_t ssthresh = (uint32_t)((uint64_t)cc->cwnd * CUBIC_BETA / 1024U);
+    cc->ssthresh      = ssthresh < 2U * cc->mss ? 2U * cc->mss : ssthresh;
+}
+
+/* Fast retransmit: back off by beta and start a new epoch. */
+static void cubic_on_loss(tcp_cc_t *cc, uint64_t now)
+{
+    (void)now;
+    cubic_reduce(cc);
+}
+
+/* After a timeout back off as for loss, then restart from one segment. */
+static void cubic_on_rto(tcp_cc_t *cc, uint64_t now)
+{
+    (void)now;
+    cubic_reduce(cc);
+    cc->cwnd = cc->mss;
+}
+
+const tcp_congestion_ops_t tcp_cubic_ops = {
+    .name    = "cubic",
+    .on_ack  = cubic_on_ack,
+    .on_loss = cubic_on_loss,
+    .on_rto  = cubic_on_rto,
+};
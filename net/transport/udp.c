@@ -284,9 +284,14 @@ int udp_send(udp_endpoint_t *ep, const void *data, size_t length, uint32_t desti
     net_write_be16(packet->data + 4, (uint16_t)packet->length);
     net_write_be16(packet->data + 6, 0);
     if (length) memcpy(packet->data + UDP_HEADER_LEN, data, length);
-    uint32_t source   = ep->local_address ? ep->local_address : device->ipv4_address;
-    uint16_t checksum = net_checksum_ipv4_pseudo(source, destination, IPV4_PROTO_UDP, packet->data, packet->length);
-    net_write_be16(packet->data + 6, checksum ? checksum : UINT16_MAX);
+    uint32_t source = ep->local_address ? ep->local_address : device->ipv4_address;
+    if (device->flags & NETDEV_F_TX_CSUM) {
+        net_write_be16(packet->data + 6, net_checksum_ipv4_pseudo_partial(source, destination, IPV4_PROTO_UDP, packet->length));
+        net_pbuf_checksum_partial(packet, packet->data, 6);
+    } else {
+        uint16_t checksum = net_checksum_ipv4_pseudo(source, destination, IPV4_PROTO_UDP, packet->data, packet->length);
+        net_write_be16(packet->data + 6, checksum ? checksum : UINT16_MAX);
+    }
     status = ipv4_output(device, source, destination, IPV4_PROTO_UDP, 64, packet);
     net_pbuf_free(packet);
     netdev_put(device);
@@ -368,7 +373,7 @@ int udp_input(net_device_t *device, const ipv4_info_t *ip, net_pbuf_t *packet)
     uint16_t length           = net_read_be16(packet->data + 4);
     uint16_t checksum         = net_read_be16(packet->data + 6);
     if (!destination_port || length < UDP_HEADER_LEN || length > packet->length) goto bad;
-    if (checksum && net_checksum_ipv4_pseudo(ip->source, ip->destination, IPV4_PROTO_UDP, packet->data, length) != 0) goto bad;
+    if (checksum && !packet->csum_verified && net_checksum_ipv4_pseudo(ip->source, ip->destination, IPV4_PROTO_UDP, packet->data, length) != 0) goto bad;
     udp_endpoint_t *target = NULL;
     spin_lock(&udp_table_lock);
     for (unsigned i = 0; i < UDP_ENDPOINT_MAX; i++) {
@@ -180,8 +180,8 @@ ifneq ($(CONFIG_SOCKET_ACCEPT_QUEUE_MAX),)
   C_CONFIG += -DSOCK_ACCEPT_QUEUE_MAX=$(CONFIG_SOCKET_ACCEPT_QUEUE_MAX)
 endif
 
-ifneq ($(CONFIG_EPOLL_MAX_FDS),)
-  C_CONFIG += -DEPOLL_MAX_FDS=$(CONFIG_EPOLL_MAX_FDS)
+ifneq ($(CONFIG_EPOLL_MAX_WATCHES),)
+  C_CONFIG += -DEPOLL_MAX_WATCHES=$(CONFIG_EPOLL_MAX_WATCHES)
 endif
 
 ifneq ($(CONFIG_FUTEX_HASH_BITS),)
@@ -278,6 +278,12 @@ else
   C_CONFIG += -DCONFIG_SWAP=0
 endif
 
+ifeq ($(CONFIG_ZRAM), y)
+  C_CONFIG += -DCONFIG_ZRAM=1
+else
+  C_CONFIG += -DCONFIG_ZRAM=0
+endif
+
 ifeq ($(CONFIG_INPUT_EVDEV), y)
   C_CONFIG += -DCONFIG_INPUT_EVDEV=1
 else